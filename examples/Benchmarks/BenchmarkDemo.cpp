@@ -25,6 +25,8 @@ subject to the following restrictions:
 #include "HaltonData.h"
 #include "landscapeData.h"
 #include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletCollision/BroadphaseCollision/btGridBroadphase.h"
+#include "../CommonInterfaces/CommonParameterInterface.h"
 
 #include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
 
@@ -36,6 +38,11 @@ class btDynamicsWorld;
 #define NUMRAYS 500
 #define USE_PARALLEL_RAYCASTS 1
 
+// collide 4-wide SIMD copies of the broadphase trees, to compare with the binary trees
+static bool gBenchmarkWideDbvt = false;
+// use the uniform grid broadphase instead of the dbvt, takes effect on reset
+static bool gBenchmarkGridBroadphase = false;
+
 class btRigidBody;
 class btBroadphaseInterface;
 class btCollisionShape;
@@ -54,6 +61,13 @@ class BenchmarkDemo : public CommonRigidBodyMTBase
 	btAlignedObjectArray<class RagDoll*> m_ragdolls;
 
 	int m_benchmark;
+	bool m_gridBroadphase;
+
+#ifdef USE_BT_CLOCK
+	btClock m_stepTimer;
+	unsigned long m_stepMicroseconds;
+	int m_stepCount;
+#endif  //USE_BT_CLOCK
 
 	void myinit()
 	{
@@ -86,8 +100,13 @@ class BenchmarkDemo : public CommonRigidBodyMTBase
 public:
 	BenchmarkDemo(struct GUIHelperInterface* helper, int benchmark)
 		: CommonRigidBodyMTBase(helper),
-		  m_benchmark(benchmark)
+		  m_benchmark(benchmark),
+		  m_gridBroadphase(false)
 	{
+#ifdef USE_BT_CLOCK
+		m_stepMicroseconds = 0;
+		m_stepCount = 0;
+#endif  //USE_BT_CLOCK
 	}
 	virtual ~BenchmarkDemo()
 	{
@@ -318,11 +337,46 @@ public:
 
 static btRaycastBar2 raycastBar;
 
+static void toggleWideDbvtCallback(int buttonId, bool buttonState, void* userPointer)
+{
+	gBenchmarkWideDbvt = buttonState;
+}
+
+static void toggleGridBroadphaseCallback(int buttonId, bool buttonState, void* userPointer)
+{
+	gBenchmarkGridBroadphase = buttonState;
+}
+
 void BenchmarkDemo::stepSimulation(float deltaTime)
 {
 	if (m_dynamicsWorld)
 	{
+		if (!m_gridBroadphase)
+		{
+			btDbvtBroadphase* broadphase = static_cast<btDbvtBroadphase*>(m_broadphase);
+			if (broadphase->getWideCollide() != gBenchmarkWideDbvt)
+			{
+				broadphase->setWideCollide(gBenchmarkWideDbvt);
+#ifdef USE_BT_CLOCK
+				m_stepMicroseconds = 0;
+				m_stepCount = 0;
+#endif  //USE_BT_CLOCK
+			}
+		}
+		updateThreadScalingBenchmark();
+#ifdef USE_BT_CLOCK
+		m_stepTimer.reset();
+#endif  //USE_BT_CLOCK
 		m_dynamicsWorld->stepSimulation(deltaTime);
+#ifdef USE_BT_CLOCK
+		m_stepMicroseconds += m_stepTimer.getTimeMicroseconds();
+		if (++m_stepCount == 100)
+		{
+			printf("%s broadphase: %f ms per step\n", m_gridBroadphase ? "grid" : (gBenchmarkWideDbvt ? "4-wide dbvt" : "binary dbvt"), m_stepMicroseconds * 0.001f / m_stepCount);
+			m_stepMicroseconds = 0;
+			m_stepCount = 0;
+		}
+#endif  //USE_BT_CLOCK
 	}
 
 	if (m_benchmark == 7)
@@ -340,6 +394,15 @@ void BenchmarkDemo::initPhysics()
 	setCameraDistance(btScalar(100.));
 
 	createEmptyDynamicsWorld();
+
+	m_gridBroadphase = gBenchmarkGridBroadphase;
+	if (m_gridBroadphase)
+	{
+		//the world is still empty, so the broadphase can be replaced. the cells fit a rotated 2x2x2 box
+		delete m_broadphase;
+		m_broadphase = new btGridBroadphase(btScalar(4.));
+		m_dynamicsWorld->setBroadphase(m_broadphase);
+	}
 	/////collision configuration contains default setup for memory, collision setup
 	//btDefaultCollisionConstructionInfo cci;
 	//cci.m_defaultMaxPersistentManifoldPoolSize = 32768;
@@ -376,6 +439,19 @@ void BenchmarkDemo::initPhysics()
 
 	m_dynamicsWorld->setGravity(btVector3(0, -10, 0));
 
+	{
+		ButtonParams button("Wide dbvt broadphase", 0, true);
+		button.m_initialState = gBenchmarkWideDbvt;
+		button.m_callback = toggleWideDbvtCallback;
+		m_guiHelper->getParameterInterface()->registerButtonParameter(button);
+	}
+	{
+		ButtonParams button("Grid broadphase (on reset)", 0, true);
+		button.m_initialState = gBenchmarkGridBroadphase;
+		button.m_callback = toggleGridBroadphaseCallback;
+		m_guiHelper->getParameterInterface()->registerButtonParameter(button);
+	}
+
 	if (m_benchmark < 5)
 	{
 		///create a few basic rigid bodies
@@ -32,8 +32,11 @@ class btCollisionShape;
 #include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h"
 #include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
 #include "BulletDynamics/ConstraintSolver/btNNCGConstraintSolver.h"
+#include "BulletDynamics/ConstraintSolver/btNNCGConstraintSolverMt.h"
+#include "BulletDynamics/ConstraintSolver/btPartitionedConstraintSolverMt.h"
 #include "BulletDynamics/MLCPSolvers/btMLCPSolver.h"
 #include "BulletDynamics/MLCPSolvers/btSolveProjectedGaussSeidel.h"
+#include "BulletDynamics/MLCPSolvers/btSolveSparseProjectedGaussSeidel.h"
 #include "BulletDynamics/MLCPSolvers/btDantzigSolver.h"
 #include "BulletDynamics/MLCPSolvers/btLemkeSolver.h"
 
@@ -111,10 +114,121 @@ public:
 	{
 		return mRecords[rt].getAverageTime();
 	}
+	unsigned long long getAccumulatedTime(RecordType rt) const
+	{
+		return mRecords[rt].mAccum;
+	}
+	int getCallCount(RecordType rt) const
+	{
+		return mRecords[rt].mCallCount;
+	}
 };
 
 static Profiler gProfiler;
 
+#if BT_THREADSAFE
+static void setNumThreads(int numThreads);
+
+// steps the simulation with 1, 2, 4 ... max threads and prints the average step and narrowphase times.
+// update is called between the calls to stepSimulation, so the thread count never changes during a step
+class ThreadScalingBenchmark
+{
+	enum
+	{
+		kWarmupSteps = 10,
+		kMeasuredSteps = 60,
+		kMaxResults = 16
+	};
+	int mNumThreads;
+	int mRestoreNumThreads;
+	int mStep;
+	unsigned long long mStartStepTime;
+	int mStartStepCount;
+	unsigned long long mStartDispatchTime;
+	int mStartDispatchCount;
+	int mNumResults;
+	int mResultThreads[kMaxResults];
+	float mResultStepTime[kMaxResults];
+	float mResultDispatchTime[kMaxResults];
+
+	void printResults() const
+	{
+		printf("thread scaling benchmark (%s, %d steps per thread count)\n", btGetTaskScheduler()->getName(), int(kMeasuredSteps));
+		printf("threads   step ms   speedup   narrowphase ms   speedup\n");
+		for (int i = 0; i < mNumResults; ++i)
+		{
+			printf("%7d %9.3f %9.2f %16.3f %9.2f\n",
+				   mResultThreads[i],
+				   mResultStepTime[i],
+				   mResultStepTime[i] > 0.0f ? mResultStepTime[0] / mResultStepTime[i] : 0.0f,
+				   mResultDispatchTime[i],
+				   mResultDispatchTime[i] > 0.0f ? mResultDispatchTime[0] / mResultDispatchTime[i] : 0.0f);
+		}
+	}
+
+public:
+	bool mEnabled;
+
+	ThreadScalingBenchmark()
+	{
+		mEnabled = false;
+		mNumThreads = 0;
+	}
+	void update()
+	{
+		if (!mEnabled || btGetTaskScheduler() == NULL)
+		{
+			mNumThreads = 0;
+			return;
+		}
+		if (mNumThreads == 0)
+		{
+			mRestoreNumThreads = btGetTaskScheduler()->getNumThreads();
+			mNumResults = 0;
+			mNumThreads = 1;
+			mStep = 0;
+			setNumThreads(mNumThreads);
+			return;
+		}
+		++mStep;
+		if (mStep == kWarmupSteps)
+		{
+			mStartStepTime = gProfiler.getAccumulatedTime(Profiler::kRecordInternalTimeStep);
+			mStartStepCount = gProfiler.getCallCount(Profiler::kRecordInternalTimeStep);
+			mStartDispatchTime = gProfiler.getAccumulatedTime(Profiler::kRecordDispatchAllCollisionPairs);
+			mStartDispatchCount = gProfiler.getCallCount(Profiler::kRecordDispatchAllCollisionPairs);
+		}
+		else if (mStep == kWarmupSteps + kMeasuredSteps)
+		{
+			unsigned long long stepTime = gProfiler.getAccumulatedTime(Profiler::kRecordInternalTimeStep) - mStartStepTime;
+			int stepCount = gProfiler.getCallCount(Profiler::kRecordInternalTimeStep) - mStartStepCount;
+			unsigned long long dispatchTime = gProfiler.getAccumulatedTime(Profiler::kRecordDispatchAllCollisionPairs) - mStartDispatchTime;
+			int dispatchCount = gProfiler.getCallCount(Profiler::kRecordDispatchAllCollisionPairs) - mStartDispatchCount;
+			mResultThreads[mNumResults] = mNumThreads;
+			mResultStepTime[mNumResults] = stepCount > 0 ? float(stepTime) * 0.001f / float(stepCount) : 0.0f;
+			mResultDispatchTime[mNumResults] = dispatchCount > 0 ? float(dispatchTime) * 0.001f / float(dispatchCount) : 0.0f;
+			++mNumResults;
+			int maxNumThreads = btGetTaskScheduler()->getMaxNumThreads();
+			if (mNumThreads < maxNumThreads && mNumResults < kMaxResults)
+			{
+				mNumThreads = btMin(mNumThreads * 2, maxNumThreads);
+				mStep = 0;
+				setNumThreads(mNumThreads);
+			}
+			else
+			{
+				printResults();
+				setNumThreads(mRestoreNumThreads);
+				mEnabled = false;
+				mNumThreads = 0;
+			}
+		}
+	}
+};
+
+static ThreadScalingBenchmark gThreadScalingBenchmark;
+#endif  // #if BT_THREADSAFE
+
 class ProfileHelper
 {
 	Profiler::RecordType mRecType;
@@ -237,7 +351,7 @@ public:
 	MyDiscreteDynamicsWorld(btDispatcher * dispatcher,
 							btBroadphaseInterface * pairCache,
 							btConstraintSolverPoolMt * constraintSolver,
-							btSequentialImpulseConstraintSolverMt * constraintSolverMt,
+							btConstraintSolver * constraintSolverMt,
 							btCollisionConfiguration * collisionConfiguration) : btDiscreteDynamicsWorldMt(dispatcher, pairCache, constraintSolver, constraintSolverMt, collisionConfiguration)
 	{
 		btSimulationIslandManagerMt* islandMgr = static_cast<btSimulationIslandManagerMt*>(m_islandManager);
@@ -254,11 +368,18 @@ btConstraintSolver* createSolverByType(SolverType t)
 			return new btSequentialImpulseConstraintSolver();
 		case SOLVER_TYPE_SEQUENTIAL_IMPULSE_MT:
 			return new MySequentialImpulseConstraintSolverMt();
+		case SOLVER_TYPE_PARTITIONED_MT:
+			return new btPartitionedConstraintSolverMt();
 		case SOLVER_TYPE_NNCG:
 			return new btNNCGConstraintSolver();
+		case SOLVER_TYPE_NNCG_MT:
+			return new btNNCGConstraintSolverMt();
 		case SOLVER_TYPE_MLCP_PGS:
 			mlcpSolver = new btSolveProjectedGaussSeidel();
 			break;
+		case SOLVER_TYPE_MLCP_SPARSE_PGS:
+			mlcpSolver = new btSolveSparseProjectedGaussSeidel();
+			break;
 		case SOLVER_TYPE_MLCP_DANTZIG:
 			mlcpSolver = new btDantzigSolver();
 			break;
@@ -354,6 +475,8 @@ static int gSolverMode = SOLVER_SIMD |
 						 // SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS |
 						 // SOLVER_USE_2_FRICTION_DIRECTIONS |
 						 0;
+static bool gIncrementalIslands = false;
+static bool gParallelIslandBuilding = false;
 static btScalar gSliderSolverIterations = 10.0f;                                                        // should be int
 static btScalar gSliderNumThreads = 1.0f;                                                               // should be int
 static btScalar gSliderIslandBatchingThreshold = 0.0f;                                                  // should be int
@@ -411,6 +534,32 @@ static void toggleSolverModeCallback(int buttonId, bool buttonState, void* userP
 	}
 }
 
+static void toggleIncrementalIslandsCallback(int buttonId, bool buttonState, void* userPointer)
+{
+	gIncrementalIslands = buttonState;
+	if (CommonRigidBodyMTBase* crb = reinterpret_cast<CommonRigidBodyMTBase*>(userPointer))
+	{
+		if (crb->m_dynamicsWorld)
+		{
+			crb->m_dynamicsWorld->getSimulationIslandManager()->setIncrementalIslands(gIncrementalIslands);
+			crb->m_dynamicsWorld->setForceUpdateAllAabbs(!gIncrementalIslands);
+		}
+	}
+}
+
+static void toggleParallelIslandBuildingCallback(int buttonId, bool buttonState, void* userPointer)
+{
+	gParallelIslandBuilding = buttonState;
+	if (CommonRigidBodyMTBase* crb = reinterpret_cast<CommonRigidBodyMTBase*>(userPointer))
+	{
+		if (crb->m_dynamicsWorld && crb->m_multithreadedWorld)
+		{
+			btSimulationIslandManagerMt* islandMgr = static_cast<btSimulationIslandManagerMt*>(crb->m_dynamicsWorld->getSimulationIslandManager());
+			islandMgr->setParallelIslandBuilding(gParallelIslandBuilding);
+		}
+	}
+}
+
 void setSolverTypeComboBoxCallback(int combobox, const char* item, void* userPointer)
 {
 	const char** items = static_cast<const char**>(userPointer);
@@ -490,6 +639,7 @@ static void setSolverIterationCountCallback(float val, void* userPtr)
 static void setLargeIslandManifoldCountCallback(float val, void* userPtr)
 {
 	btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching = int(gSliderIslandBatchingThreshold);
+	btPartitionedConstraintSolverMt::s_minimumContactManifoldsForPartitioning = int(gSliderIslandBatchingThreshold);
 }
 
 static void setMinBatchSizeCallback(float val, void* userPtr)
@@ -540,12 +690,16 @@ void CommonRigidBodyMTBase::createEmptyDynamicsWorld()
 		btConstraintSolverPoolMt* solverPool;
 		{
 			SolverType poolSolverType = m_solverType;
-			if (poolSolverType == SOLVER_TYPE_SEQUENTIAL_IMPULSE_MT)
+			if (poolSolverType == SOLVER_TYPE_SEQUENTIAL_IMPULSE_MT || poolSolverType == SOLVER_TYPE_PARTITIONED_MT)
 			{
 				// pool solvers shouldn't be parallel solvers, we don't allow that kind of
 				// nested parallelism because of performance issues
 				poolSolverType = SOLVER_TYPE_SEQUENTIAL_IMPULSE;
 			}
+			else if (poolSolverType == SOLVER_TYPE_NNCG_MT)
+			{
+				poolSolverType = SOLVER_TYPE_NNCG;
+			}
 			btConstraintSolver* solvers[BT_MAX_THREAD_COUNT];
 			int maxThreadCount = BT_MAX_THREAD_COUNT;
 			for (int i = 0; i < maxThreadCount; ++i)
@@ -555,12 +709,13 @@ void CommonRigidBodyMTBase::createEmptyDynamicsWorld()
 			solverPool = new btConstraintSolverPoolMt(solvers, maxThreadCount);
 			m_solver = solverPool;
 		}
-		btSequentialImpulseConstraintSolverMt* solverMt = NULL;
-		if (m_solverType == SOLVER_TYPE_SEQUENTIAL_IMPULSE_MT)
+		btConstraintSolver* solverMt = NULL;
+		if (m_solverType == SOLVER_TYPE_SEQUENTIAL_IMPULSE_MT || m_solverType == SOLVER_TYPE_PARTITIONED_MT || m_solverType == SOLVER_TYPE_NNCG_MT)
 		{
-			solverMt = new MySequentialImpulseConstraintSolverMt();
+			solverMt = createSolverByType(m_solverType);
 		}
 		btDiscreteDynamicsWorld* world = new MyDiscreteDynamicsWorld(m_dispatcher, m_broadphase, solverPool, solverMt, m_collisionConfiguration);
+		static_cast<btSimulationIslandManagerMt*>(world->getSimulationIslandManager())->setParallelIslandBuilding(gParallelIslandBuilding);
 		m_dynamicsWorld = world;
 		m_multithreadedWorld = true;
 		btAssert(btGetTaskScheduler() != NULL);
@@ -581,12 +736,16 @@ void CommonRigidBodyMTBase::createEmptyDynamicsWorld()
 		m_broadphase = new btDbvtBroadphase();
 
 		SolverType solverType = m_solverType;
-		if (solverType == SOLVER_TYPE_SEQUENTIAL_IMPULSE_MT)
+		if (solverType == SOLVER_TYPE_SEQUENTIAL_IMPULSE_MT || solverType == SOLVER_TYPE_PARTITIONED_MT)
 		{
 			// using the parallel solver with the single-threaded world works, but is
 			// disabled here to avoid confusion
 			solverType = SOLVER_TYPE_SEQUENTIAL_IMPULSE;
 		}
+		else if (solverType == SOLVER_TYPE_NNCG_MT)
+		{
+			solverType = SOLVER_TYPE_NNCG;
+		}
 		m_solver = createSolverByType(solverType);
 
 		m_dynamicsWorld = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
@@ -596,9 +755,18 @@ void CommonRigidBodyMTBase::createEmptyDynamicsWorld()
 	m_dynamicsWorld->setGravity(btVector3(0, -10, 0));
 	m_dynamicsWorld->getSolverInfo().m_solverMode = gSolverMode;
 	m_dynamicsWorld->getSolverInfo().m_numIterations = btMax(1, int(gSliderSolverIterations));
+	m_dynamicsWorld->getSimulationIslandManager()->setIncrementalIslands(gIncrementalIslands);
+	m_dynamicsWorld->setForceUpdateAllAabbs(!gIncrementalIslands);
 	createDefaultParameters();
 }
 
+void CommonRigidBodyMTBase::updateThreadScalingBenchmark()
+{
+#if BT_THREADSAFE
+	gThreadScalingBenchmark.update();
+#endif  // #if BT_THREADSAFE
+}
+
 void CommonRigidBodyMTBase::createDefaultParameters()
 {
 	if (m_multithreadCapable)
@@ -705,6 +873,39 @@ void CommonRigidBodyMTBase::createDefaultParameters()
 		button.m_userPointer = this;
 		m_guiHelper->getParameterInterface()->registerButtonParameter(button);
 	}
+	{
+		ButtonParams button("Solver SoA contact rows", 0, true);
+		button.m_buttonId = SOLVER_SOA_CONTACT_ROWS;
+		button.m_initialState = !!(gSolverMode & button.m_buttonId);
+		button.m_callback = toggleSolverModeCallback;
+		button.m_userPointer = this;
+		m_guiHelper->getParameterInterface()->registerButtonParameter(button);
+	}
+	{
+		ButtonParams button("Solver persistent pools", 0, true);
+		button.m_buttonId = SOLVER_PERSISTENT_POOLS;
+		button.m_initialState = !!(gSolverMode & button.m_buttonId);
+		button.m_callback = toggleSolverModeCallback;
+		button.m_userPointer = this;
+		m_guiHelper->getParameterInterface()->registerButtonParameter(button);
+	}
+	{
+		// stops converged islands early, needs a residual threshold above 0
+		ButtonParams button("Solver adaptive island iterations", 0, true);
+		button.m_buttonId = SOLVER_ADAPTIVE_ISLAND_ITERATIONS;
+		button.m_initialState = !!(gSolverMode & button.m_buttonId);
+		button.m_callback = toggleSolverModeCallback;
+		button.m_userPointer = this;
+		m_guiHelper->getParameterInterface()->registerButtonParameter(button);
+	}
+	{
+		// keeps sleeping islands across steps, and skips the AABBs of sleeping objects
+		ButtonParams button("Incremental sleeping islands", 0, true);
+		button.m_initialState = gIncrementalIslands;
+		button.m_callback = toggleIncrementalIslandsCallback;
+		button.m_userPointer = this;
+		m_guiHelper->getParameterInterface()->registerButtonParameter(button);
+	}
 	if (m_multithreadedWorld)
 	{
 #if BT_THREADSAFE
@@ -766,6 +967,7 @@ void CommonRigidBodyMTBase::createDefaultParameters()
 			{
 				sBatchingMethodComboBoxItems[btBatchedConstraints::BATCHING_METHOD_SPATIAL_GRID_2D] = "Batching: 2D Grid";
 				sBatchingMethodComboBoxItems[btBatchedConstraints::BATCHING_METHOD_SPATIAL_GRID_3D] = "Batching: 3D Grid";
+				sBatchingMethodComboBoxItems[btBatchedConstraints::BATCHING_METHOD_GRAPH_COLORING] = "Batching: Graph Coloring";
 			};
 			ComboBoxParams comboParams;
 			comboParams.m_userPointer = sBatchingMethodComboBoxItems;
@@ -804,6 +1006,14 @@ void CommonRigidBodyMTBase::createDefaultParameters()
 			button.m_callback = boolPtrButtonCallback;
 			m_guiHelper->getParameterInterface()->registerButtonParameter(button);
 		}
+		{
+			// builds the simulation islands with a concurrent union find
+			ButtonParams button("Parallel island building", 0, true);
+			button.m_initialState = gParallelIslandBuilding;
+			button.m_callback = toggleParallelIslandBuildingCallback;
+			button.m_userPointer = this;
+			m_guiHelper->getParameterInterface()->registerButtonParameter(button);
+		}
 		{
 			ButtonParams button("Allow Nested ParallelFor", 0, true);
 			button.m_initialState = btSequentialImpulseConstraintSolverMt::s_allowNestedParallelForLoops;
@@ -811,6 +1021,15 @@ void CommonRigidBodyMTBase::createDefaultParameters()
 			button.m_callback = boolPtrButtonCallback;
 			m_guiHelper->getParameterInterface()->registerButtonParameter(button);
 		}
+		{
+			// create a button to run the thread scaling benchmark, results are printed to the console
+			ButtonParams button("Thread scaling benchmark", 0, true);
+			bool* ptr = &gThreadScalingBenchmark.mEnabled;
+			button.m_initialState = *ptr;
+			button.m_userPointer = ptr;
+			button.m_callback = boolPtrButtonCallback;
+			m_guiHelper->getParameterInterface()->registerButtonParameter(button);
+		}
 #endif  // #if BT_THREADSAFE
 	}
 }
@@ -864,14 +1083,17 @@ void CommonRigidBodyMTBase::drawScreenText()
 		}
 		{
 			int sm = gSolverMode;
-			sprintf(msg, "solver %s mode [%s%s%s%s%s%s]",
+			sprintf(msg, "solver %s mode [%s%s%s%s%s%s%s%s%s]",
 					getSolverTypeName(m_solverType),
 					sm & SOLVER_SIMD ? "SIMD" : "",
 					sm & SOLVER_RANDMIZE_ORDER ? " randomize" : "",
 					sm & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS ? " interleave" : "",
 					sm & SOLVER_USE_2_FRICTION_DIRECTIONS ? " friction2x" : "",
 					sm & SOLVER_ENABLE_FRICTION_DIRECTION_CACHING ? " frictionDirCaching" : "",
-					sm & SOLVER_USE_WARMSTARTING ? " warm" : "");
+					sm & SOLVER_USE_WARMSTARTING ? " warm" : "",
+					sm & SOLVER_SOA_CONTACT_ROWS ? " soaRows" : "",
+					sm & SOLVER_PERSISTENT_POOLS ? " persistentPools" : "",
+					sm & SOLVER_ADAPTIVE_ISLAND_ITERATIONS ? " adaptiveIslands" : "");
 			m_guiHelper->getAppInterface()->drawText(msg, xCoord, yCoord, 0.4f);
 			yCoord += yStep;
 		}
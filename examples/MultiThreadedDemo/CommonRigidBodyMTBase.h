@@ -14,8 +14,11 @@ enum SolverType
 {
 	SOLVER_TYPE_SEQUENTIAL_IMPULSE,
 	SOLVER_TYPE_SEQUENTIAL_IMPULSE_MT,
+	SOLVER_TYPE_PARTITIONED_MT,
 	SOLVER_TYPE_NNCG,
+	SOLVER_TYPE_NNCG_MT,
 	SOLVER_TYPE_MLCP_PGS,
+	SOLVER_TYPE_MLCP_SPARSE_PGS,
 	SOLVER_TYPE_MLCP_DANTZIG,
 	SOLVER_TYPE_MLCP_LEMKE,
 
@@ -30,10 +33,16 @@ inline const char* getSolverTypeName(SolverType t)
 			return "SequentialImpulse";
 		case SOLVER_TYPE_SEQUENTIAL_IMPULSE_MT:
 			return "SequentialImpulseMt";
+		case SOLVER_TYPE_PARTITIONED_MT:
+			return "PartitionedMt";
 		case SOLVER_TYPE_NNCG:
 			return "NNCG";
+		case SOLVER_TYPE_NNCG_MT:
+			return "NNCGMt";
 		case SOLVER_TYPE_MLCP_PGS:
 			return "MLCP ProjectedGaussSeidel";
+		case SOLVER_TYPE_MLCP_SPARSE_PGS:
+			return "MLCP Sparse ProjectedGaussSeidel";
 		case SOLVER_TYPE_MLCP_DANTZIG:
 			return "MLCP Dantzig";
 		case SOLVER_TYPE_MLCP_LEMKE:
@@ -79,10 +88,14 @@ struct CommonRigidBodyMTBase : public CommonExampleInterface
 	virtual void createDefaultParameters();
 	virtual void createEmptyDynamicsWorld();
 
+	// changes the thread count of the thread scaling benchmark, call it before stepping the world
+	void updateThreadScalingBenchmark();
+
 	virtual void stepSimulation(float deltaTime)
 	{
 		if (m_dynamicsWorld)
 		{
+			updateThreadScalingBenchmark();
 			m_dynamicsWorld->stepSimulation(deltaTime);
 		}
 	}
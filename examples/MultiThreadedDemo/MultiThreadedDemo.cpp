@@ -127,6 +127,7 @@ public:
 				m_groundBody->setLinearVelocity(vel);
 			}
 			// always step by 1/60 for benchmarking
+			updateThreadScalingBenchmark();
 			m_dynamicsWorld->stepSimulation(1.0f / 60.0f, 0);
 		}
 #if 0
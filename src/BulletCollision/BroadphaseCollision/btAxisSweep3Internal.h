@@ -142,6 +142,7 @@ public:
 	virtual void getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const;
 
 	virtual void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0));
+	virtual void rayTestPacket(btBroadphaseRayPacketCallback& callback);
 	virtual void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
 
 	void quantize(BP_FP_INT_TYPE* out, const btVector3& point, int isMax) const;
@@ -271,6 +272,19 @@ void btAxisSweep3Internal<BP_FP_INT_TYPE>::rayTest(const btVector3& rayFrom, con
 	}
 }
 
+template <typename BP_FP_INT_TYPE>
+void btAxisSweep3Internal<BP_FP_INT_TYPE>::rayTestPacket(btBroadphaseRayPacketCallback& callback)
+{
+	if (m_raycastAccelerator)
+	{
+		m_raycastAccelerator->rayTestPacket(callback);
+	}
+	else
+	{
+		btBroadphaseInterface::rayTestPacket(callback);
+	}
+}
+
 template <typename BP_FP_INT_TYPE>
 void btAxisSweep3Internal<BP_FP_INT_TYPE>::aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback)
 {
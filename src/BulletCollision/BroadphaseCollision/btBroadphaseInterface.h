@@ -41,8 +41,66 @@ protected:
 	btBroadphaseRayCallback() {}
 };
 
+///btBroadphaseRayPacketCallback receives the proxies hit by a packet of up to 32 rays, traversed together by rayTestPacket.
+///the ray parameter runs from 0 at m_rayFrom[i] to 1 at m_rayTo[i]. process can lower m_lambdaMax[i] to shorten ray i
+struct btBroadphaseRayPacketCallback
+{
+	enum
+	{
+		MAX_RAYS = 32  // one bit per ray in the ray masks
+	};
+	const btVector3* m_rayFrom;
+	const btVector3* m_rayTo;
+	btScalar* m_lambdaMax;
+	int m_numRays;
+
+	virtual ~btBroadphaseRayPacketCallback() {}
+	///rayMask has bit i set for each ray i that overlaps the proxy aabb
+	virtual void process(const btBroadphaseProxy* proxy, unsigned int rayMask) = 0;
+
+protected:
+	btBroadphaseRayPacketCallback() : m_rayFrom(0), m_rayTo(0), m_lambdaMax(0), m_numRays(0) {}
+};
+
 #include "LinearMath/btVector3.h"
 
+///forwards the proxies hit by a single ray to a btBroadphaseRayPacketCallback, used by the default rayTestPacket
+struct btBroadphaseRayPacketAdapter : public btBroadphaseRayCallback
+{
+	btBroadphaseRayPacketCallback& m_packetCallback;
+	int m_ray;
+	btScalar m_rayLength;
+
+	btBroadphaseRayPacketAdapter(btBroadphaseRayPacketCallback& packetCallback, int ray)
+		: m_packetCallback(packetCallback),
+		  m_ray(ray)
+	{
+		btVector3 rayDir = packetCallback.m_rayTo[ray] - packetCallback.m_rayFrom[ray];
+		m_rayLength = rayDir.length();
+		if (m_rayLength > SIMD_EPSILON)
+		{
+			rayDir /= m_rayLength;
+		}
+		m_rayDirectionInverse[0] = rayDir[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[0];
+		m_rayDirectionInverse[1] = rayDir[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[1];
+		m_rayDirectionInverse[2] = rayDir[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[2];
+		m_signs[0] = m_rayDirectionInverse[0] < 0.0;
+		m_signs[1] = m_rayDirectionInverse[1] < 0.0;
+		m_signs[2] = m_rayDirectionInverse[2] < 0.0;
+		m_lambda_max = m_rayLength * packetCallback.m_lambdaMax[ray];
+	}
+
+	virtual bool process(const btBroadphaseProxy* proxy)
+	{
+		///terminate further ray tests, once the ray is shortened to zero
+		if (m_packetCallback.m_lambdaMax[m_ray] <= btScalar(0.))
+			return false;
+		m_packetCallback.process(proxy, 1u << m_ray);
+		m_lambda_max = m_rayLength * m_packetCallback.m_lambdaMax[m_ray];
+		return true;
+	}
+};
+
 ///The btBroadphaseInterface class provides an interface to detect aabb-overlapping object pairs.
 ///Some implementations for this broadphase interface include btAxisSweep3, bt32BitAxisSweep3 and btDbvtBroadphase.
 ///The actual overlapping pair management, storage, adding and removing of pairs is dealt by the btOverlappingPairCache class.
@@ -58,6 +116,18 @@ public:
 
 	virtual void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0)) = 0;
 
+	///rayTestPacket traverses the broadphase once for a packet of coherent rays, see btBroadphaseRayPacketCallback.
+	///the default implementation calls rayTest for each ray. it must be safe to call from several threads at once
+	virtual void rayTestPacket(btBroadphaseRayPacketCallback& callback)
+	{
+		btAssert(callback.m_numRays <= btBroadphaseRayPacketCallback::MAX_RAYS);
+		for (int i = 0; i < callback.m_numRays; ++i)
+		{
+			btBroadphaseRayPacketAdapter rayCallback(callback, i);
+			rayTest(callback.m_rayFrom[i], callback.m_rayTo[i], rayCallback);
+		}
+	}
+
 	virtual void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) = 0;
 
 	///calculateOverlappingPairs is optional: incremental algorithms (sweep and prune) might do it during the set aabb
@@ -703,6 +703,208 @@ void btDbvt::extractLeaves(const btDbvtNode* node, btAlignedObjectArray<const bt
 	}
 }
 
+//
+static DBVT_INLINE btScalar wideHalfArea(const btDbvtVolume& v)
+{
+	const btVector3 l = v.Lengths();
+	return (l.x() * l.y() + l.y() * l.z() + l.z() * l.x());
+}
+
+//
+void btDbvtWide::clear()
+{
+	m_nodes.resize(0);
+	m_leaves.resize(0);
+	m_parents.resize(0);
+	m_leafLanes.resize(0);
+	m_stkStack.resize(0);
+	m_bldStack.resize(0);
+}
+
+//
+void btDbvtWide::build(const btDbvtNode* root)
+{
+	m_nodes.resize(0);
+	m_leaves.resize(0);
+	m_parents.resize(0);
+	m_leafLanes.resize(0);
+	if (!root)
+		return;
+	m_nodes.expandNonInitializing();
+	m_parents.push_back(-1);
+	m_bldStack.resize(0);
+	m_bldStack.push_back(sStkBN(root, 0));
+	do
+	{
+		const sStkBN p = m_bldStack[m_bldStack.size() - 1];
+		m_bldStack.pop_back();
+		/* gather up to WIDTH descendants	*/
+		const btDbvtNode* lanes[btDbvtWideNode::WIDTH];
+		int count;
+		if (p.node->isleaf())
+		{
+			lanes[0] = p.node;
+			count = 1;
+		}
+		else
+		{
+			lanes[0] = p.node->childs[0];
+			lanes[1] = p.node->childs[1];
+			count = 2;
+			while (count < btDbvtWideNode::WIDTH)
+			{
+				int best = -1;
+				btScalar bestArea = 0;
+				for (int i = 0; i < count; ++i)
+				{
+					if (lanes[i]->isinternal())
+					{
+						const btScalar area = wideHalfArea(lanes[i]->volume);
+						if ((best < 0) || (area > bestArea))
+						{
+							best = i;
+							bestArea = area;
+						}
+					}
+				}
+				if (best < 0)
+					break;
+				const btDbvtNode* n = lanes[best];
+				lanes[best] = n->childs[0];
+				lanes[count++] = n->childs[1];
+			}
+		}
+		/* allocate the children before taking a reference, the node array may grow	*/
+		int childs[btDbvtWideNode::WIDTH];
+		for (int i = 0; i < count; ++i)
+		{
+			if (lanes[i]->isleaf())
+			{
+				childs[i] = ~m_leaves.size();
+				m_leaves.push_back(lanes[i]);
+				m_leafLanes.push_back(p.index * btDbvtWideNode::WIDTH + i);
+			}
+			else
+			{
+				childs[i] = m_nodes.size();
+				m_nodes.expandNonInitializing();
+				m_parents.push_back(p.index * btDbvtWideNode::WIDTH + i);
+				m_bldStack.push_back(sStkBN(lanes[i], childs[i]));
+			}
+		}
+		btDbvtWideNode& node = m_nodes[p.index];
+		node.count = count;
+		for (int i = 0; i < btDbvtWideNode::WIDTH; ++i)
+		{
+			if (i < count)
+			{
+				const btDbvtVolume& v = lanes[i]->volume;
+				for (int k = 0; k < 3; ++k)
+				{
+					node.mi[k][i] = v.Mins()[k];
+					node.mx[k][i] = v.Maxs()[k];
+				}
+				node.childs[i] = childs[i];
+			}
+			else
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					node.mi[k][i] = BT_LARGE_FLOAT;
+					node.mx[k][i] = -BT_LARGE_FLOAT;
+				}
+				node.childs[i] = 0;
+			}
+		}
+	} while (m_bldStack.size() > 0);
+}
+
+//
+void btDbvtWide::update(int index)
+{
+	const int location = m_leafLanes[index];
+	btAssert(location >= 0);
+	const int node = location / btDbvtWideNode::WIDTH;
+	const int lane = location % btDbvtWideNode::WIDTH;
+	const btDbvtVolume& v = m_leaves[index]->volume;
+	btDbvtWideNode& n = m_nodes[node];
+	for (int k = 0; k < 3; ++k)
+	{
+		n.mi[k][lane] = v.Mins()[k];
+		n.mx[k][lane] = v.Maxs()[k];
+	}
+	refit(node);
+}
+
+//
+void btDbvtWide::remove(int index)
+{
+	const int location = m_leafLanes[index];
+	btAssert(location >= 0);
+	m_leafLanes[index] = -1;
+	m_leaves[index] = 0;
+	int node = location / btDbvtWideNode::WIDTH;
+	int lane = location % btDbvtWideNode::WIDTH;
+	for (;;)
+	{
+		/* move the last lane into the hole	*/
+		btDbvtWideNode& n = m_nodes[node];
+		const int last = --n.count;
+		if (lane != last)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				n.mi[k][lane] = n.mi[k][last];
+				n.mx[k][lane] = n.mx[k][last];
+			}
+			const int c = n.childs[last];
+			n.childs[lane] = c;
+			if (c < 0)
+				m_leafLanes[~c] = node * btDbvtWideNode::WIDTH + lane;
+			else
+				m_parents[c] = node * btDbvtWideNode::WIDTH + lane;
+		}
+		for (int k = 0; k < 3; ++k)
+		{
+			n.mi[k][last] = BT_LARGE_FLOAT;
+			n.mx[k][last] = -BT_LARGE_FLOAT;
+		}
+		n.childs[last] = 0;
+		/* an empty node is removed from its parent, it stays unreferenced in m_nodes	*/
+		const int parent = m_parents[node];
+		if ((n.count > 0) || (parent < 0))
+			break;
+		m_parents[node] = -1;
+		node = parent / btDbvtWideNode::WIDTH;
+		lane = parent % btDbvtWideNode::WIDTH;
+	}
+	refit(node);
+}
+
+//
+void btDbvtWide::refit(int node)
+{
+	for (int parent = m_parents[node]; parent >= 0; parent = m_parents[node])
+	{
+		const btDbvtWideNode& n = m_nodes[node];
+		btDbvtWideNode& p = m_nodes[parent / btDbvtWideNode::WIDTH];
+		const int lane = parent % btDbvtWideNode::WIDTH;
+		for (int k = 0; k < 3; ++k)
+		{
+			btScalar mi = n.mi[k][0];
+			btScalar mx = n.mx[k][0];
+			for (int i = 1; i < n.count; ++i)
+			{
+				mi = btMin(mi, n.mi[k][i]);
+				mx = btMax(mx, n.mx[k][i]);
+			}
+			p.mi[k][lane] = mi;
+			p.mx[k][lane] = mx;
+		}
+		node = parent / btDbvtWideNode::WIDTH;
+	}
+}
+
 //
 #if DBVT_ENABLE_BENCHMARK
 
@@ -220,6 +220,64 @@ struct btDbvntNode
     }
 };
 
+/* btDbvtWideNode			*/
+ATTRIBUTE_ALIGNED16(struct)
+btDbvtWideNode
+{
+	enum
+	{
+		WIDTH = 4
+	};
+	btScalar mi[3][WIDTH];  // Children mins, one row per axis
+	btScalar mx[3][WIDTH];  // Children maxs, one row per axis
+	int childs[WIDTH];      // Node index if >= 0, ~leaf index otherwise
+	int count;              // Used children, the bounds of unused lanes never overlap
+};
+
+/* btDbvtWideVolume: a volume broadcast to all lanes	*/
+struct btDbvtWideVolume
+{
+#if defined(BT_USE_SSE)
+	__m128 mi[3];
+	__m128 mx[3];
+	DBVT_INLINE void set(int axis, btScalar vmi, btScalar vmx)
+	{
+		mi[axis] = _mm_set1_ps(vmi);
+		mx[axis] = _mm_set1_ps(vmx);
+	}
+#elif defined(BT_USE_NEON)
+	float32x4_t mi[3];
+	float32x4_t mx[3];
+	DBVT_INLINE void set(int axis, btScalar vmi, btScalar vmx)
+	{
+		mi[axis] = vdupq_n_f32(vmi);
+		mx[axis] = vdupq_n_f32(vmx);
+	}
+#else
+	btScalar mi[3];
+	btScalar mx[3];
+	DBVT_INLINE void set(int axis, btScalar vmi, btScalar vmx)
+	{
+		mi[axis] = vmi;
+		mx[axis] = vmx;
+	}
+#endif
+	DBVT_INLINE btDbvtWideVolume(const btDbvtVolume& v)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			set(i, v.Mins()[i], v.Maxs()[i]);
+		}
+	}
+	DBVT_INLINE btDbvtWideVolume(const btDbvtWideNode& n, int lane)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			set(i, n.mi[i][lane], n.mx[i][lane]);
+		}
+	}
+};
+
 typedef btAlignedObjectArray<const btDbvtNode*> btNodeStack;
 
 ///The btDbvt class implements a fast dynamic bounding volume tree based on axis aligned bounding boxes (aabb tree).
@@ -456,6 +514,69 @@ private:
 	btDbvt(const btDbvt&) {}
 };
 
+///The btDbvtWide class is a read only copy of a btDbvt with up to 4 children per node.
+///The children bounds are stored as structure of arrays, so a volume is tested against all children of a node with one SSE/NEON instruction sequence.
+///The copy references the leaves of the source tree, so it has to be built again after the source tree is modified.
+struct btDbvtWide
+{
+	typedef btDbvt::ICollide ICollide;
+	/* Stack elements	*/
+	struct sStkWW
+	{
+		int a;
+		int b;
+		sStkWW() {}
+		sStkWW(int na, int nb) : a(na), b(nb) {}
+	};
+	struct sStkBN
+	{
+		const btDbvtNode* node;
+		int index;
+		sStkBN() {}
+		sStkBN(const btDbvtNode* n, int i) : node(n), index(i) {}
+	};
+
+	// Fields
+	btAlignedObjectArray<btDbvtWideNode> m_nodes;     // m_nodes[0] is the root
+	btAlignedObjectArray<const btDbvtNode*> m_leaves;  // Leaves of the source tree
+	btAlignedObjectArray<int> m_parents;               // Parent node * WIDTH + lane of each node, -1 for the root
+	btAlignedObjectArray<int> m_leafLanes;             // Node * WIDTH + lane of each leaf, -1 once removed
+	btAlignedObjectArray<sStkWW> m_stkStack;
+	btAlignedObjectArray<sStkBN> m_bldStack;
+
+	// Methods
+	void clear();
+	bool empty() const { return (0 == m_nodes.size()); }
+	///collapses the source tree, the nodes with the largest volume are opened first to fill the 4 lanes
+	void build(const btDbvtNode* root);
+	const btDbvtNode* leaf(int child) const { return (m_leaves[~child]); }
+	///copies the current volume of the source leaf m_leaves[index] and refits its ancestors, the nodes are not rebalanced
+	void update(int index);
+	///removes the leaf m_leaves[index] and refits its ancestors, the other leaves keep their index
+	void remove(int index);
+
+	///calls policy.Process(leaf0,leaf1) for the overlapping leaves of both trees, or all overlapping leaf pairs if other is this tree
+	DBVT_PREFIX
+	void collideTT(const btDbvtWide& other,
+				   DBVT_IPOLICY);
+	DBVT_PREFIX
+	void collideTV(const btDbvtVolume& volume,
+				   DBVT_IPOLICY) const;
+	DBVT_PREFIX
+	void collideTVNoStackAlloc(const btDbvtVolume& volume,
+							   btAlignedObjectArray<int>& stack,
+							   DBVT_IPOLICY) const;
+
+	// Helpers
+	///returns a bit per child of n that overlaps the volume
+	static DBVT_INLINE int overlapMask(const btDbvtWideNode& n, const btDbvtWideVolume& v);
+
+private:
+	DBVT_PREFIX
+	DBVT_INLINE void pushPair(int a, const btDbvtWide& other, int b, DBVT_IPOLICY);
+	void refit(int node);
+};
+
 //
 // Inline's
 //
@@ -1557,6 +1678,186 @@ inline void btDbvt::collideTU(const btDbvtNode* root,
 	}
 }
 
+//
+DBVT_INLINE int btDbvtWide::overlapMask(const btDbvtWideNode& n, const btDbvtWideVolume& v)
+{
+#if defined(BT_USE_SSE)
+	__m128 rt = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(n.mi[0]), v.mx[0]), _mm_cmple_ps(v.mi[0], _mm_load_ps(n.mx[0])));
+	rt = _mm_and_ps(rt, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(n.mi[1]), v.mx[1]), _mm_cmple_ps(v.mi[1], _mm_load_ps(n.mx[1]))));
+	rt = _mm_and_ps(rt, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(n.mi[2]), v.mx[2]), _mm_cmple_ps(v.mi[2], _mm_load_ps(n.mx[2]))));
+	return (_mm_movemask_ps(rt));
+#elif defined(BT_USE_NEON)
+	static const uint32_t bits[4] = {1, 2, 4, 8};
+	uint32x4_t rt = vandq_u32(vcleq_f32(vld1q_f32(n.mi[0]), v.mx[0]), vcleq_f32(v.mi[0], vld1q_f32(n.mx[0])));
+	rt = vandq_u32(rt, vandq_u32(vcleq_f32(vld1q_f32(n.mi[1]), v.mx[1]), vcleq_f32(v.mi[1], vld1q_f32(n.mx[1]))));
+	rt = vandq_u32(rt, vandq_u32(vcleq_f32(vld1q_f32(n.mi[2]), v.mx[2]), vcleq_f32(v.mi[2], vld1q_f32(n.mx[2]))));
+	rt = vandq_u32(rt, vld1q_u32(bits));
+	const uint32x2_t rs = vorr_u32(vget_low_u32(rt), vget_high_u32(rt));
+	return (int(vget_lane_u32(rs, 0) | vget_lane_u32(rs, 1)));
+#else
+	int mask = 0;
+	for (int i = 0; i < btDbvtWideNode::WIDTH; ++i)
+	{
+		if ((n.mi[0][i] <= v.mx[0]) && (v.mi[0] <= n.mx[0][i]) &&
+			(n.mi[1][i] <= v.mx[1]) && (v.mi[1] <= n.mx[1][i]) &&
+			(n.mi[2][i] <= v.mx[2]) && (v.mi[2] <= n.mx[2][i]))
+		{
+			mask |= 1 << i;
+		}
+	}
+	return (mask);
+#endif
+}
+
+//
+DBVT_PREFIX
+DBVT_INLINE void btDbvtWide::pushPair(int a, const btDbvtWide& other, int b, DBVT_IPOLICY)
+{
+	if ((a < 0) && (b < 0))
+	{
+		policy.Process(leaf(a), other.leaf(b));
+	}
+	else
+	{
+		m_stkStack.push_back(sStkWW(a, b));
+	}
+}
+
+//
+DBVT_PREFIX
+inline void btDbvtWide::collideTT(const btDbvtWide& other,
+								  DBVT_IPOLICY)
+{
+	DBVT_CHECKTYPE
+	if (empty() || other.empty())
+		return;
+	const bool self = (&other == this);
+	m_stkStack.resize(0);
+	m_stkStack.push_back(sStkWW(0, 0));
+	do
+	{
+		const sStkWW p = m_stkStack[m_stkStack.size() - 1];
+		m_stkStack.pop_back();
+		if ((p.a >= 0) && (p.b >= 0))
+		{
+			const btDbvtWideNode& na = m_nodes[p.a];
+			const btDbvtWideNode& nb = other.m_nodes[p.b];
+			if (self && (p.a == p.b))
+			{
+				for (int i = 0; i < na.count; ++i)
+				{
+					const int ci = na.childs[i];
+					if (ci >= 0)
+					{
+						m_stkStack.push_back(sStkWW(ci, ci));
+					}
+					const int mask = overlapMask(na, btDbvtWideVolume(na, i)) & ~((2 << i) - 1);
+					for (int j = i + 1; j < na.count; ++j)
+					{
+						if (mask & (1 << j))
+						{
+							pushPair(ci, other, na.childs[j], policy);
+						}
+					}
+				}
+			}
+			else
+			{
+				for (int i = 0; i < na.count; ++i)
+				{
+					const int mask = overlapMask(nb, btDbvtWideVolume(na, i));
+					for (int j = 0; j < nb.count; ++j)
+					{
+						if (mask & (1 << j))
+						{
+							pushPair(na.childs[i], other, nb.childs[j], policy);
+						}
+					}
+				}
+			}
+		}
+		else if (p.a >= 0)
+		{
+			const btDbvtWideNode& na = m_nodes[p.a];
+			const int mask = overlapMask(na, btDbvtWideVolume(other.leaf(p.b)->volume));
+			for (int i = 0; i < na.count; ++i)
+			{
+				if (mask & (1 << i))
+				{
+					pushPair(na.childs[i], other, p.b, policy);
+				}
+			}
+		}
+		else
+		{
+			const btDbvtWideNode& nb = other.m_nodes[p.b];
+			const int mask = overlapMask(nb, btDbvtWideVolume(leaf(p.a)->volume));
+			for (int j = 0; j < nb.count; ++j)
+			{
+				if (mask & (1 << j))
+				{
+					pushPair(p.a, other, nb.childs[j], policy);
+				}
+			}
+		}
+	} while (m_stkStack.size() > 0);
+}
+
+//
+DBVT_PREFIX
+inline void btDbvtWide::collideTV(const btDbvtVolume& volume,
+								  DBVT_IPOLICY) const
+{
+	DBVT_CHECKTYPE
+	if (!empty())
+	{
+		btAlignedObjectArray<int> stack;
+#ifndef BT_DISABLE_STACK_TEMP_MEMORY
+		char tempmemory[btDbvt::SIMPLE_STACKSIZE * sizeof(int)];
+		stack.initializeFromBuffer(tempmemory, 0, btDbvt::SIMPLE_STACKSIZE);
+#else
+		stack.reserve(btDbvt::SIMPLE_STACKSIZE);
+#endif  //BT_DISABLE_STACK_TEMP_MEMORY
+		collideTVNoStackAlloc(volume, stack, policy);
+	}
+}
+
+//
+DBVT_PREFIX
+inline void btDbvtWide::collideTVNoStackAlloc(const btDbvtVolume& volume,
+											  btAlignedObjectArray<int>& stack,
+											  DBVT_IPOLICY) const
+{
+	DBVT_CHECKTYPE
+	if (!empty())
+	{
+		const btDbvtWideVolume v(volume);
+		stack.resize(0);
+		stack.push_back(0);
+		do
+		{
+			const btDbvtWideNode& n = m_nodes[stack[stack.size() - 1]];
+			stack.pop_back();
+			const int mask = overlapMask(n, v);
+			for (int i = 0; i < n.count; ++i)
+			{
+				if (mask & (1 << i))
+				{
+					const int c = n.childs[i];
+					if (c < 0)
+					{
+						policy.Process(leaf(c));
+					}
+					else
+					{
+						stack.push_back(c);
+					}
+				}
+			}
+		} while (stack.size() > 0);
+	}
+}
+
 //
 // PP Cleanup
 //
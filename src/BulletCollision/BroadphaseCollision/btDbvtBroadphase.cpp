@@ -123,6 +123,84 @@ struct btDbvtTreeCollider : btDbvt::ICollide
 	}
 };
 
+/* Parallel refit	*/
+struct btDbvtRefitUpdater : btIParallelForBody
+{
+	btDbvtNode* const* m_roots;
+	btDbvtRefitUpdater(btDbvtNode* const* roots) : m_roots(roots) {}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		btAlignedObjectArray<btDbvtNode*> nodes;
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			// gather internal nodes parent first, then merge children back to front
+			nodes.resizeNoInitialize(0);
+			nodes.push_back(m_roots[i]);
+			for (int j = 0; j < nodes.size(); ++j)
+			{
+				btDbvtNode* node = nodes[j];
+				if (node->childs[0]->isinternal()) nodes.push_back(node->childs[0]);
+				if (node->childs[1]->isinternal()) nodes.push_back(node->childs[1]);
+			}
+			for (int j = nodes.size() - 1; j >= 0; --j)
+			{
+				btDbvtNode* node = nodes[j];
+				Merge(node->childs[0]->volume, node->childs[1]->volume, node->volume);
+			}
+		}
+	}
+};
+
+/* Parallel tree collider	*/
+struct btDbvtTaskCollider : btDbvt::ICollide
+{
+	btOverlappingPairCache* m_paircache;
+	btAlignedObjectArray<btDbvtProxy*>* m_pairs;
+	int m_count;
+	btDbvtTaskCollider(btOverlappingPairCache* paircache, btAlignedObjectArray<btDbvtProxy*>* pairs) : m_paircache(paircache), m_pairs(pairs), m_count(0) {}
+	void Process(const btDbvtNode* na, const btDbvtNode* nb)
+	{
+		if (na != nb)
+		{
+			if (m_paircache)
+			{
+				m_paircache->addOverlappingPair((btDbvtProxy*)na->data, (btDbvtProxy*)nb->data);
+				++m_count;
+			}
+			else
+			{
+				m_pairs->push_back((btDbvtProxy*)na->data);
+				m_pairs->push_back((btDbvtProxy*)nb->data);
+			}
+		}
+	}
+};
+
+struct btDbvtCollideUpdater : btIParallelForBody
+{
+	btDbvt* m_set;
+	const btDbvt::sStkNN* m_tasks;
+	btOverlappingPairCache* m_paircache;
+	btAlignedObjectArray<btDbvtProxy*>* m_pairs;
+	int volatile* m_numReported;
+	btDbvtCollideUpdater(btDbvt* set, const btDbvt::sStkNN* tasks, btOverlappingPairCache* paircache, btAlignedObjectArray<btDbvtProxy*>* pairs, int volatile* numReported) : m_set(set), m_tasks(tasks), m_paircache(paircache), m_pairs(pairs), m_numReported(numReported) {}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			// a concurrent pair cache takes the pairs directly and sorts them in endConcurrentAdd,
+			// otherwise each task owns its output, so the merged pair order does not depend on the thread count.
+			// collideTT uses a local stack, unlike collideTTpersistentStack
+			btDbvtTaskCollider collider(m_paircache, m_paircache ? 0 : &m_pairs[i]);
+			m_set->collideTT(m_tasks[i].a, m_tasks[i].b, collider);
+			if (m_numReported)
+			{
+				btAtomicFetchAdd(m_numReported, collider.m_count);
+			}
+		}
+	}
+};
+
 //
 // btDbvtBroadphase
 //
@@ -132,6 +210,10 @@ btDbvtBroadphase::btDbvtBroadphase(btOverlappingPairCache* paircache)
 {
 	m_deferedcollide = false;
 	m_needcleanup = true;
+	m_parallelcollide = false;
+	m_needrefit = false;
+	m_widecollide = false;
+	m_fixedchanged = true;
 	m_releasepaircache = (paircache != 0) ? false : true;
 	m_prediction = 0;
 	m_stageCurrent = 0;
@@ -191,7 +273,7 @@ btBroadphaseProxy* btDbvtBroadphase::createProxy(const btVector3& aabbMin,
 	proxy->m_uniqueId = ++m_gid;
 	proxy->leaf = m_sets[0].insert(aabb, proxy);
 	listappend(proxy, m_stageRoots[m_stageCurrent]);
-	if (!m_deferedcollide)
+	if (!m_deferedcollide && !m_parallelcollide && !m_widecollide)
 	{
 		btDbvtTreeCollider collider(this);
 		collider.proxy = proxy;
@@ -207,7 +289,10 @@ void btDbvtBroadphase::destroyProxy(btBroadphaseProxy* absproxy,
 {
 	btDbvtProxy* proxy = (btDbvtProxy*)absproxy;
 	if (proxy->stage == STAGECOUNT)
+	{
 		m_sets[1].remove(proxy->leaf);
+		m_fixedchanged = true;
+	}
 	else
 		m_sets[0].remove(proxy->leaf);
 	listremove(proxy, m_stageRoots[proxy->stage]);
@@ -283,6 +368,111 @@ void btDbvtBroadphase::rayTest(const btVector3& rayFrom, const btVector3& rayTo,
 							  callback);
 }
 
+/* Rays of a packet in structure of arrays layout, 4 rays per group	*/
+struct btDbvtRayPacket
+{
+	enum
+	{
+		MAX_GROUPS = btBroadphaseRayPacketCallback::MAX_RAYS / 4
+	};
+	ATTRIBUTE_ALIGNED16(btScalar org[3][MAX_GROUPS * 4]);
+	ATTRIBUTE_ALIGNED16(btScalar inv[3][MAX_GROUPS * 4]);
+	ATTRIBUTE_ALIGNED16(btScalar lambda[MAX_GROUPS * 4]);
+	int numGroups;
+	unsigned all;
+	btDbvtRayPacket(const btBroadphaseRayPacketCallback& callback)
+	{
+		const int n = callback.m_numRays;
+		numGroups = (n + 3) / 4;
+		all = n < 32 ? ((1u << n) - 1) : ~0u;
+		for (int i = 0; i < numGroups * 4; ++i)
+		{
+			if (i < n)
+			{
+				const btVector3 dir = callback.m_rayTo[i] - callback.m_rayFrom[i];
+				for (int k = 0; k < 3; ++k)
+				{
+					org[k][i] = callback.m_rayFrom[i][k];
+					inv[k][i] = dir[k] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / dir[k];
+				}
+				lambda[i] = callback.m_lambdaMax[i];
+			}
+			else
+			{
+				/* Padding rays never hit	*/
+				for (int k = 0; k < 3; ++k)
+				{
+					org[k][i] = 0;
+					inv[k][i] = 1;
+				}
+				lambda[i] = -1;
+			}
+		}
+	}
+	/* Rays of mask that overlap volume	*/
+	unsigned overlap(const btDbvtVolume& volume, unsigned mask) const
+	{
+		unsigned hits = 0;
+		for (int g = 0; g < numGroups; ++g)
+		{
+			if ((mask >> (g * 4)) & 15)
+			{
+				hits |= btRayAabbPacket4(&org[0][g * 4], &inv[0][g * 4], MAX_GROUPS * 4, &lambda[g * 4], volume.Mins(), volume.Maxs()) << (g * 4);
+			}
+		}
+		return (hits & mask);
+	}
+};
+
+//
+static void rayTestPacketInternal(const btDbvtNode* root,
+								  btDbvtRayPacket& packet,
+								  btBroadphaseRayPacketCallback& callback,
+								  btAlignedObjectArray<btDbvt::sStkNP>& stack)
+{
+	if (root)
+	{
+		btAssert(stack.size() == 0);
+		stack.push_back(btDbvt::sStkNP(root, packet.all));
+		do
+		{
+			const btDbvt::sStkNP se = stack[stack.size() - 1];
+			stack.pop_back();
+			const unsigned mask = packet.overlap(se.node->volume, unsigned(se.mask));
+			if (mask)
+			{
+				if (se.node->isinternal())
+				{
+					stack.push_back(btDbvt::sStkNP(se.node->childs[0], mask));
+					stack.push_back(btDbvt::sStkNP(se.node->childs[1], mask));
+				}
+				else
+				{
+					callback.process((btDbvtProxy*)se.node->data, mask);
+					/* The callback may have shortened the rays	*/
+					for (int i = 0; i < callback.m_numRays; ++i)
+					{
+						if (mask & (1u << i)) packet.lambda[i] = callback.m_lambdaMax[i];
+					}
+				}
+			}
+		} while (stack.size());
+	}
+}
+
+//
+void btDbvtBroadphase::rayTestPacket(btBroadphaseRayPacketCallback& callback)
+{
+	btAssert(callback.m_numRays <= btBroadphaseRayPacketCallback::MAX_RAYS);
+	btDbvtRayPacket packet(callback);
+	/* Local stack, so that threads can trace packets concurrently	*/
+	ATTRIBUTE_ALIGNED16(char tempmemory[btDbvt::DOUBLE_STACKSIZE * sizeof(btDbvt::sStkNP)]);
+	btAlignedObjectArray<btDbvt::sStkNP> stack;
+	stack.initializeFromBuffer(tempmemory, 0, btDbvt::DOUBLE_STACKSIZE);
+	rayTestPacketInternal(m_sets[0].m_root, packet, callback, stack);
+	rayTestPacketInternal(m_sets[1].m_root, packet, callback, stack);
+}
+
 struct BroadphaseAabbTester : btDbvt::ICollide
 {
 	btBroadphaseAabbCallback& m_aabbCallback;
@@ -324,6 +514,7 @@ void btDbvtBroadphase::setAabb(btBroadphaseProxy* absproxy,
 		if (proxy->stage == STAGECOUNT)
 		{ /* fixed -> dynamic set	*/
 			m_sets[1].remove(proxy->leaf);
+			m_fixedchanged = true;
 			proxy->leaf = m_sets[0].insert(aabb, proxy);
 			docollide = true;
 		}
@@ -338,7 +529,19 @@ void btDbvtBroadphase::setAabb(btBroadphaseProxy* absproxy,
 				if (delta[0] < 0) velocity[0] = -velocity[0];
 				if (delta[1] < 0) velocity[1] = -velocity[1];
 				if (delta[2] < 0) velocity[2] = -velocity[2];
-				if (
+				if (m_parallelcollide)
+				{ /* Refit later		*/
+					if (!proxy->leaf->volume.Contain(aabb))
+					{
+						aabb.Expand(btVector3(gDbvtMargin, gDbvtMargin, gDbvtMargin));
+						aabb.SignedExpand(velocity);
+						proxy->leaf->volume = aabb;
+						m_needrefit = true;
+						++m_updates_done;
+						docollide = true;
+					}
+				}
+				else if (
 					m_sets[0].update(proxy->leaf, aabb, velocity, gDbvtMargin)
 
 				)
@@ -362,7 +565,7 @@ void btDbvtBroadphase::setAabb(btBroadphaseProxy* absproxy,
 		if (docollide)
 		{
 			m_needcleanup = true;
-			if (!m_deferedcollide)
+			if (!m_deferedcollide && !m_parallelcollide && !m_widecollide)
 			{
 				btDbvtTreeCollider collider(this);
 				m_sets[1].collideTTpersistentStack(m_sets[1].m_root, proxy->leaf, collider);
@@ -385,6 +588,7 @@ void btDbvtBroadphase::setAabbForceUpdate(btBroadphaseProxy* absproxy,
 	if (proxy->stage == STAGECOUNT)
 	{ /* fixed -> dynamic set	*/
 		m_sets[1].remove(proxy->leaf);
+		m_fixedchanged = true;
 		proxy->leaf = m_sets[0].insert(aabb, proxy);
 		docollide = true;
 	}
@@ -404,7 +608,7 @@ void btDbvtBroadphase::setAabbForceUpdate(btBroadphaseProxy* absproxy,
 	if (docollide)
 	{
 		m_needcleanup = true;
-		if (!m_deferedcollide)
+		if (!m_deferedcollide && !m_parallelcollide && !m_widecollide)
 		{
 			btDbvtTreeCollider collider(this);
 			m_sets[1].collideTTpersistentStack(m_sets[1].m_root, proxy->leaf, collider);
@@ -527,6 +731,12 @@ void btDbvtBroadphase::collide(btDispatcher* dispatcher)
 */
 
 	SPC(m_profiling.m_total);
+	/* refit				*/
+	if (m_needrefit)
+	{
+		refitParallel(m_sets[0]);
+		m_needrefit = false;
+	}
 	/* optimize				*/
 	m_sets[0].optimizeIncremental(1 + (m_sets[0].m_leaves * m_dupdates) / 100);
 	if (m_fixedleft)
@@ -534,6 +744,7 @@ void btDbvtBroadphase::collide(btDispatcher* dispatcher)
 		const int count = 1 + (m_sets[1].m_leaves * m_fupdates) / 100;
 		m_sets[1].optimizeIncremental(1 + (m_sets[1].m_leaves * m_fupdates) / 100);
 		m_fixedleft = btMax<int>(0, m_fixedleft - count);
+		m_fixedchanged = true;
 	}
 	/* dynamic -> fixed set	*/
 	m_stageCurrent = (m_stageCurrent + 1) % STAGECOUNT;
@@ -562,9 +773,40 @@ void btDbvtBroadphase::collide(btDispatcher* dispatcher)
 			current = next;
 		} while (current);
 		m_fixedleft = m_sets[1].m_leaves;
+		m_fixedchanged = true;
 		m_needcleanup = true;
 	}
 	/* collide dynamics		*/
+	if (m_parallelcollide)
+	{
+		{
+			SPC(m_profiling.m_fdcollide);
+			collideParallel(m_sets[0].m_root, m_sets[1].m_root);
+		}
+		{
+			SPC(m_profiling.m_ddcollide);
+			collideParallel(m_sets[0].m_root, m_sets[0].m_root);
+		}
+	}
+	else if (m_widecollide)
+	{
+		btDbvtTreeCollider collider(this);
+		m_wide[0].build(m_sets[0].m_root);
+		if (m_fixedchanged)
+		{
+			m_wide[1].build(m_sets[1].m_root);
+			m_fixedchanged = false;
+		}
+		{
+			SPC(m_profiling.m_fdcollide);
+			m_wide[0].collideTT(m_wide[1], collider);
+		}
+		{
+			SPC(m_profiling.m_ddcollide);
+			m_wide[0].collideTT(m_wide[0], collider);
+		}
+	}
+	else
 	{
 		btDbvtTreeCollider collider(this);
 		if (m_deferedcollide)
@@ -623,11 +865,114 @@ void btDbvtBroadphase::collide(btDispatcher* dispatcher)
 	m_updates_call /= 2;
 }
 
+//
+void btDbvtBroadphase::refitParallel(btDbvt& set)
+{
+	if (!set.m_root || set.m_root->isleaf())
+		return;
+	/* split the tree into subtrees, the nodes above them are refitted serially	*/
+	const int minTasks = 256;
+	m_refitTop.resizeNoInitialize(0);
+	m_refitRoots.resizeNoInitialize(0);
+	m_refitRoots.push_back(set.m_root);
+	int current = 0;
+	while ((current < m_refitRoots.size()) && (m_refitRoots.size() - current < minTasks))
+	{
+		btDbvtNode* node = m_refitRoots[current++];
+		m_refitTop.push_back(node);
+		if (node->childs[0]->isinternal()) m_refitRoots.push_back(node->childs[0]);
+		if (node->childs[1]->isinternal()) m_refitRoots.push_back(node->childs[1]);
+	}
+	const int numTasks = m_refitRoots.size() - current;
+	if (numTasks > 0)
+	{
+		btDbvtRefitUpdater updater(&m_refitRoots[current]);
+		btParallelFor(0, numTasks, 1, updater);
+	}
+	for (int i = m_refitTop.size() - 1; i >= 0; --i)
+	{
+		btDbvtNode* node = m_refitTop[i];
+		Merge(node->childs[0]->volume, node->childs[1]->volume, node->volume);
+	}
+}
+
+//
+void btDbvtBroadphase::collideParallel(const btDbvtNode* root0, const btDbvtNode* root1)
+{
+	if (!root0 || !root1)
+		return;
+	/* expand the node pairs breadth first until there is enough work to share	*/
+	const int minTasks = 256;
+	m_collideTasks.resizeNoInitialize(0);
+	m_collideTasks.push_back(btDbvt::sStkNN(root0, root1));
+	int current = 0;
+	while ((current < m_collideTasks.size()) && (m_collideTasks.size() - current < minTasks))
+	{
+		const btDbvt::sStkNN p = m_collideTasks[current];
+		if (p.a == p.b)
+		{
+			if (p.a->isleaf())
+				break;
+			m_collideTasks.push_back(btDbvt::sStkNN(p.a->childs[0], p.a->childs[0]));
+			m_collideTasks.push_back(btDbvt::sStkNN(p.a->childs[1], p.a->childs[1]));
+			m_collideTasks.push_back(btDbvt::sStkNN(p.a->childs[0], p.a->childs[1]));
+		}
+		else if (Intersect(p.a->volume, p.b->volume))
+		{
+			if (p.a->isleaf() && p.b->isleaf())
+				break;
+			if (p.a->isinternal() && (p.b->isleaf() || (p.a->volume.Lengths().length2() >= p.b->volume.Lengths().length2())))
+			{
+				m_collideTasks.push_back(btDbvt::sStkNN(p.a->childs[0], p.b));
+				m_collideTasks.push_back(btDbvt::sStkNN(p.a->childs[1], p.b));
+			}
+			else
+			{
+				m_collideTasks.push_back(btDbvt::sStkNN(p.a, p.b->childs[0]));
+				m_collideTasks.push_back(btDbvt::sStkNN(p.a, p.b->childs[1]));
+			}
+		}
+		++current;
+	}
+	const int numTasks = m_collideTasks.size() - current;
+	if (numTasks == 0)
+		return;
+	if (m_paircache->hasConcurrentAdd())
+	{
+		/* count every reported pair like the serial path does, this drives the clean up budget	*/
+		int volatile numReported = 0;
+		m_paircache->beginConcurrentAdd(0);
+		btDbvtCollideUpdater updater(&m_sets[0], &m_collideTasks[current], m_paircache, 0, &numReported);
+		btParallelFor(0, numTasks, 1, updater);
+		m_paircache->endConcurrentAdd();
+		m_newpairs += numReported;
+		return;
+	}
+	if (m_taskPairs.size() < numTasks)
+	{
+		m_taskPairs.resize(numTasks);
+	}
+	btDbvtCollideUpdater updater(&m_sets[0], &m_collideTasks[current], 0, &m_taskPairs[0], 0);
+	btParallelFor(0, numTasks, 1, updater);
+	/* merge in task order	*/
+	for (int i = 0; i < numTasks; ++i)
+	{
+		btAlignedObjectArray<btDbvtProxy*>& pairs = m_taskPairs[i];
+		for (int j = 0; j < pairs.size(); j += 2)
+		{
+			m_paircache->addOverlappingPair(pairs[j], pairs[j + 1]);
+			++m_newpairs;
+		}
+		pairs.resizeNoInitialize(0);
+	}
+}
+
 //
 void btDbvtBroadphase::optimize()
 {
 	m_sets[0].optimizeTopDown();
 	m_sets[1].optimizeTopDown();
+	m_fixedchanged = true;
 }
 
 //
@@ -670,6 +1015,9 @@ void btDbvtBroadphase::resetPool(btDispatcher* dispatcher)
 		//reset internal dynamic tree data structures
 		m_sets[0].clear();
 		m_sets[1].clear();
+		m_wide[0].clear();
+		m_wide[1].clear();
+		m_fixedchanged = true;
 
 		m_deferedcollide = false;
 		m_needcleanup = true;
@@ -88,7 +88,16 @@ struct btDbvtBroadphase : btBroadphaseInterface
 	bool m_releasepaircache;                    // Release pair cache on delete
 	bool m_deferedcollide;                      // Defere dynamic/static collision to collide call
 	bool m_needcleanup;                         // Need to run cleanup?
+	bool m_parallelcollide;                     // Refit and collide with btParallelFor (implies defered collide)
+	bool m_needrefit;                           // Dynamic set has leaves updated in place
+	bool m_widecollide;                         // Collide 4-wide copies of the sets (implies defered collide)
+	bool m_fixedchanged;                        // Fixed set changed since its wide copy was built
+	btDbvtWide m_wide[2];                       // 4-wide copies of the sets
 	btAlignedObjectArray<btAlignedObjectArray<const btDbvtNode*> > m_rayTestStacks;
+	btAlignedObjectArray<btDbvtNode*> m_refitRoots;                       // Subtrees refitted by parallel tasks
+	btAlignedObjectArray<btDbvtNode*> m_refitTop;                         // Nodes above the refit subtrees
+	btAlignedObjectArray<btDbvt::sStkNN> m_collideTasks;                  // Node pairs collided by parallel tasks
+	btAlignedObjectArray<btAlignedObjectArray<btDbvtProxy*> > m_taskPairs;  // Per task pair output, merged in task order
 #if DBVT_BP_PROFILE
 	btClock m_clock;
 	struct
@@ -105,12 +114,15 @@ struct btDbvtBroadphase : btBroadphaseInterface
 	~btDbvtBroadphase();
 	void collide(btDispatcher* dispatcher);
 	void optimize();
+	void refitParallel(btDbvt& set);
+	void collideParallel(const btDbvtNode* root0, const btDbvtNode* root1);
 
 	/* btBroadphaseInterface Implementation	*/
 	btBroadphaseProxy* createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int shapeType, void* userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher* dispatcher);
 	virtual void destroyProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher);
 	virtual void setAabb(btBroadphaseProxy* proxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* dispatcher);
 	virtual void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0));
+	virtual void rayTestPacket(btBroadphaseRayPacketCallback& callback);
 	virtual void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
 
 	virtual void getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const;
@@ -134,6 +146,31 @@ struct btDbvtBroadphase : btBroadphaseInterface
 		return m_prediction;
 	}
 
+	///when enabled, moving proxies are updated in place and the dynamic tree is refitted in parallel during calculateOverlappingPairs.
+	///dynamic-dynamic and dynamic-fixed pairs are also found in parallel, and merged into the pair cache in a deterministic order.
+	///the tree bounds are stale until the next calculateOverlappingPairs, so queries should run after the broadphase update.
+	///with a btConcurrentOverlappingPairCache the pairs are added from the worker threads directly. requires btSetTaskScheduler
+	void setParallelCollide(bool parallelCollide)
+	{
+		m_parallelcollide = parallelCollide;
+	}
+	bool getParallelCollide() const
+	{
+		return m_parallelcollide;
+	}
+
+	///when enabled, calculateOverlappingPairs collides 4-wide SIMD copies of the dynamic and fixed trees instead of the binary trees.
+	///the dynamic copy is built every update, the fixed copy only when the fixed set changes. it has no effect with parallel collide
+	void setWideCollide(bool wideCollide)
+	{
+		m_widecollide = wideCollide;
+		m_fixedchanged = true;
+	}
+	bool getWideCollide() const
+	{
+		return m_widecollide;
+	}
+
 	///this setAabbForceUpdate is similar to setAabb but always forces the aabb update.
 	///it is not part of the btBroadphaseInterface but specific to btDbvtBroadphase.
 	///it bypasses certain optimizations that prevent aabb updates (when the aabb shrinks), see
@@ -26,6 +26,7 @@ struct btCollisionObjectWrapper;
 
 class btPersistentManifold;
 class btPoolAllocator;
+class btConvexConvexAlgorithm;
 
 struct btDispatcherInfo
 {
@@ -105,6 +106,17 @@ public:
 	virtual void* allocateCollisionAlgorithm(int size) = 0;
 
 	virtual void freeCollisionAlgorithm(void* ptr) = 0;
+
+	///returns true when the dispatcher takes over the closest point query of a convex pair, to run many of them at once with btGjkBatch.
+	///the dispatcher then calls btConvexConvexAlgorithm::processCollisionBatched before dispatchAllCollisionPairs returns
+	virtual bool deferConvexConvexPair(btConvexConvexAlgorithm* algorithm, const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap, btScalar maximumDistanceSquared)
+	{
+		(void)algorithm;
+		(void)body0Wrap;
+		(void)body1Wrap;
+		(void)maximumDistanceSquared;
+		return false;
+	}
 };
 
 #endif  //BT_DISPATCHER_H
@@ -0,0 +1,672 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btGridBroadphase.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
+
+#include <new>
+
+//the loops below run on the calling thread when no task scheduler is set
+static void btGridParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+{
+#if BT_THREADSAFE
+	if (btGetTaskScheduler())
+	{
+		btParallelFor(iBegin, iEnd, grainSize, body);
+		return;
+	}
+#endif
+	body.forLoop(iBegin, iEnd);
+}
+
+enum
+{
+	BT_GRID_SORT_CHUNK = 4096,  // proxies per radix sort task
+	BT_GRID_RADIX = 256,
+	BT_GRID_PAIR_CHUNK = 256,  // small proxies per pair finding task
+	BT_GRID_LARGE_CHUNK = 4,   // large proxies per pair finding task
+	BT_GRID_CELL_LIMIT = 1 << 30
+};
+
+static SIMD_FORCE_INLINE int btGridCellCoord(btScalar center, btScalar invCellSize)
+{
+	const btScalar c = btMax(btMin(center * invCellSize, btScalar(BT_GRID_CELL_LIMIT)), -btScalar(BT_GRID_CELL_LIMIT));
+	//round towards minus infinity
+	int i = int(c);
+	if (btScalar(i) > c)
+	{
+		--i;
+	}
+	return i;
+}
+
+//the b3GpuGridBroadphase hash constants, but linear in x: the cells of a row map to consecutive buckets,
+//so a row of cells is a contiguous range of the sorted proxies. unsigned arithmetic for negative cells
+static SIMD_FORCE_INLINE unsigned int btGridCellHash(int x, int y, int z, unsigned int hashMask)
+{
+	return ((unsigned int)x + (unsigned int)y * 19349663u + (unsigned int)z * 83492791u) & hashMask;
+}
+
+struct btGridClassifyLoop : public btIParallelForBody
+{
+	btGridBroadphaseProxy* const* m_proxies;
+	unsigned int* m_keys;
+	int* m_values;
+	btScalar m_cellSize;
+	unsigned int m_hashMask;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const btScalar invCellSize = btScalar(1.) / m_cellSize;
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btGridBroadphaseProxy* proxy = m_proxies[i];
+			const btVector3 extents = proxy->m_aabbMax - proxy->m_aabbMin;
+			unsigned int key = m_hashMask + 1;
+			if (extents.getX() <= m_cellSize && extents.getY() <= m_cellSize && extents.getZ() <= m_cellSize)
+			{
+				const btVector3 center = (proxy->m_aabbMin + proxy->m_aabbMax) * btScalar(0.5);
+				key = btGridCellHash(btGridCellCoord(center.getX(), invCellSize),
+									 btGridCellCoord(center.getY(), invCellSize),
+									 btGridCellCoord(center.getZ(), invCellSize), m_hashMask);
+			}
+			m_keys[i] = key;
+			m_values[i] = i;
+		}
+	}
+};
+
+struct btGridHistogramLoop : public btIParallelForBody
+{
+	const unsigned int* m_keys;
+	int* m_histograms;
+	int m_numKeys;
+	int m_shift;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int chunk = iBegin; chunk < iEnd; ++chunk)
+		{
+			int* histogram = &m_histograms[chunk * BT_GRID_RADIX];
+			for (int d = 0; d < BT_GRID_RADIX; ++d)
+			{
+				histogram[d] = 0;
+			}
+			const int end = btMin(m_numKeys, (chunk + 1) * BT_GRID_SORT_CHUNK);
+			for (int i = chunk * BT_GRID_SORT_CHUNK; i < end; ++i)
+			{
+				histogram[(m_keys[i] >> m_shift) & (BT_GRID_RADIX - 1)]++;
+			}
+		}
+	}
+};
+
+struct btGridScatterLoop : public btIParallelForBody
+{
+	const unsigned int* m_keys;
+	const int* m_values;
+	unsigned int* m_sortedKeys;
+	int* m_sortedValues;
+	const int* m_offsets;
+	int m_numKeys;
+	int m_shift;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		int offsets[BT_GRID_RADIX];
+		for (int chunk = iBegin; chunk < iEnd; ++chunk)
+		{
+			for (int d = 0; d < BT_GRID_RADIX; ++d)
+			{
+				offsets[d] = m_offsets[chunk * BT_GRID_RADIX + d];
+			}
+			const int end = btMin(m_numKeys, (chunk + 1) * BT_GRID_SORT_CHUNK);
+			for (int i = chunk * BT_GRID_SORT_CHUNK; i < end; ++i)
+			{
+				const unsigned int key = m_keys[i];
+				const int dst = offsets[(key >> m_shift) & (BT_GRID_RADIX - 1)]++;
+				m_sortedKeys[dst] = key;
+				m_sortedValues[dst] = m_values[i];
+			}
+		}
+	}
+};
+
+struct btGridClearCellsLoop : public btIParallelForBody
+{
+	int* m_cellStart;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_cellStart[i] = -1;
+		}
+	}
+};
+
+struct btGridCellBoundsLoop : public btIParallelForBody
+{
+	btGridBroadphaseProxy* const* m_proxies;
+	const unsigned int* m_keys;
+	const int* m_values;
+	btGridSortedProxy* m_sortedProxies;
+	int* m_cellStart;
+	int* m_cellEnd;
+	int m_numSmallProxies;
+	btScalar m_cellSize;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const btScalar invCellSize = btScalar(1.) / m_cellSize;
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btGridBroadphaseProxy* proxy = m_proxies[m_values[i]];
+			btGridSortedProxy& sorted = m_sortedProxies[i];
+			sorted.m_aabbMin = proxy->m_aabbMin;
+			sorted.m_aabbMax = proxy->m_aabbMax;
+			sorted.m_uniqueId = proxy->m_uniqueId;
+			sorted.m_proxy = proxy;
+			if (i < m_numSmallProxies)
+			{
+				const btVector3 center = (proxy->m_aabbMin + proxy->m_aabbMax) * btScalar(0.5);
+				sorted.m_cell[0] = btGridCellCoord(center.getX(), invCellSize);
+				sorted.m_cell[1] = btGridCellCoord(center.getY(), invCellSize);
+				sorted.m_cell[2] = btGridCellCoord(center.getZ(), invCellSize);
+
+				const unsigned int key = m_keys[i];
+				if (i == 0 || m_keys[i - 1] != key)
+				{
+					m_cellStart[key] = i;
+				}
+				if (i == m_numSmallProxies - 1 || m_keys[i + 1] != key)
+				{
+					m_cellEnd[key] = i + 1;
+				}
+			}
+		}
+	}
+};
+
+struct btGridPairLoop : public btIParallelForBody
+{
+	const btGridSortedProxy* m_sortedProxies;
+	const int* m_cellStart;
+	const int* m_cellEnd;
+	btOverlappingPairCache* m_pairCache;                    // pairs are added directly when set
+	btAlignedObjectArray<btBroadphaseProxy*>* m_taskPairs;  // otherwise stored per task
+	int m_numProxies;
+	int m_numSmallProxies;
+	int m_numSmallTasks;
+	btScalar m_cellSize;
+	unsigned int m_hashMask;
+
+	void addPair(btAlignedObjectArray<btBroadphaseProxy*>* pairs, const btGridSortedProxy& proxy0, const btGridSortedProxy& proxy1) const
+	{
+		if (m_pairCache)
+		{
+			m_pairCache->addOverlappingPair(proxy0.m_proxy, proxy1.m_proxy);
+		}
+		else
+		{
+			pairs->push_back(proxy0.m_proxy);
+			pairs->push_back(proxy1.m_proxy);
+		}
+	}
+
+	//tests the proxies of the cells xMin..xMax of a row, from sorted index firstIndex on.
+	//the proxies of other cells with the same hash are skipped
+	void findRowPairs(btAlignedObjectArray<btBroadphaseProxy*>* pairs, const btGridSortedProxy& proxy0, int firstIndex, int xMin, int xMax, int y, int z) const
+	{
+		const unsigned int firstBucket = btGridCellHash(xMin, y, z, m_hashMask);
+		const unsigned int numBuckets = unsigned(xMax - xMin) + 1;
+		if (firstBucket + numBuckets - 1 > m_hashMask)
+		{
+			//the row wraps around the table
+			for (int x = xMin; x <= xMax; ++x)
+			{
+				findRowPairs(pairs, proxy0, firstIndex, x, x, y, z);
+			}
+			return;
+		}
+		int start = -1;
+		int stop = -1;
+		for (unsigned int bucket = firstBucket; bucket < firstBucket + numBuckets; ++bucket)
+		{
+			if (m_cellStart[bucket] >= 0)
+			{
+				if (start < 0)
+				{
+					start = m_cellStart[bucket];
+				}
+				stop = m_cellEnd[bucket];
+			}
+		}
+		for (int j = btMax(start, firstIndex); j < stop; ++j)
+		{
+			const btGridSortedProxy& proxy1 = m_sortedProxies[j];
+			if (proxy1.m_cell[1] == y && proxy1.m_cell[2] == z && proxy1.m_cell[0] >= xMin && proxy1.m_cell[0] <= xMax &&
+				TestAabbAgainstAabb2(proxy0.m_aabbMin, proxy0.m_aabbMax, proxy1.m_aabbMin, proxy1.m_aabbMax))
+			{
+				addPair(pairs, proxy0, proxy1);
+			}
+		}
+	}
+
+	void findSmallPairs(int task) const
+	{
+		btAlignedObjectArray<btBroadphaseProxy*>* pairs = m_taskPairs ? &m_taskPairs[task] : 0;
+		const int end = btMin(m_numSmallProxies, (task + 1) * BT_GRID_PAIR_CHUNK);
+		for (int i = task * BT_GRID_PAIR_CHUNK; i < end; ++i)
+		{
+			//half of the 27 neighbour cells: the proxies of the own cell sorted after this one, the next cell of the row and the 4 next rows
+			const btGridSortedProxy& proxy0 = m_sortedProxies[i];
+			const int x = proxy0.m_cell[0];
+			const int y = proxy0.m_cell[1];
+			const int z = proxy0.m_cell[2];
+			findRowPairs(pairs, proxy0, i + 1, x, x, y, z);
+			findRowPairs(pairs, proxy0, 0, x + 1, x + 1, y, z);
+			findRowPairs(pairs, proxy0, 0, x - 1, x + 1, y + 1, z);
+			findRowPairs(pairs, proxy0, 0, x - 1, x + 1, y - 1, z + 1);
+			findRowPairs(pairs, proxy0, 0, x - 1, x + 1, y, z + 1);
+			findRowPairs(pairs, proxy0, 0, x - 1, x + 1, y + 1, z + 1);
+		}
+	}
+
+	//large proxies visit the cells they overlap, or test all small proxies when that is cheaper.
+	//they are tested against the large proxies with a higher id
+	void findLargePairs(int task) const
+	{
+		btAlignedObjectArray<btBroadphaseProxy*>* pairs = m_taskPairs ? &m_taskPairs[task] : 0;
+		const btScalar invCellSize = btScalar(1.) / m_cellSize;
+		const int begin = m_numSmallProxies + (task - m_numSmallTasks) * BT_GRID_LARGE_CHUNK;
+		const int end = btMin(m_numProxies, begin + BT_GRID_LARGE_CHUNK);
+		for (int i = begin; i < end; ++i)
+		{
+			const btGridSortedProxy& proxy0 = m_sortedProxies[i];
+			//a small proxy reaches at most half a cell beyond its center cell
+			int cellMin[3], cellMax[3];
+			btScalar numCells = btScalar(1.);
+			for (int k = 0; k < 3; ++k)
+			{
+				cellMin[k] = btGridCellCoord(proxy0.m_aabbMin[k], invCellSize) - 1;
+				cellMax[k] = btGridCellCoord(proxy0.m_aabbMax[k], invCellSize) + 1;
+				numCells *= btScalar(cellMax[k] - cellMin[k] + 1);
+			}
+			if (numCells < btScalar(m_numSmallProxies))
+			{
+				for (int z = cellMin[2]; z <= cellMax[2]; ++z)
+				{
+					for (int y = cellMin[1]; y <= cellMax[1]; ++y)
+					{
+						findRowPairs(pairs, proxy0, 0, cellMin[0], cellMax[0], y, z);
+					}
+				}
+			}
+			else
+			{
+				for (int j = 0; j < m_numSmallProxies; ++j)
+				{
+					const btGridSortedProxy& proxy1 = m_sortedProxies[j];
+					if (TestAabbAgainstAabb2(proxy0.m_aabbMin, proxy0.m_aabbMax, proxy1.m_aabbMin, proxy1.m_aabbMax))
+					{
+						addPair(pairs, proxy0, proxy1);
+					}
+				}
+			}
+			for (int j = m_numSmallProxies; j < m_numProxies; ++j)
+			{
+				const btGridSortedProxy& proxy1 = m_sortedProxies[j];
+				if (proxy0.m_uniqueId < proxy1.m_uniqueId &&
+					TestAabbAgainstAabb2(proxy0.m_aabbMin, proxy0.m_aabbMax, proxy1.m_aabbMin, proxy1.m_aabbMax))
+				{
+					addPair(pairs, proxy0, proxy1);
+				}
+			}
+		}
+	}
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int task = iBegin; task < iEnd; ++task)
+		{
+			if (task < m_numSmallTasks)
+			{
+				findSmallPairs(task);
+			}
+			else
+			{
+				findLargePairs(task);
+			}
+		}
+	}
+};
+
+btGridBroadphase::btGridBroadphase(btScalar cellSize, btOverlappingPairCache* overlappingPairCache)
+	: m_cellSize(cellSize),
+	  m_pairCache(overlappingPairCache),
+	  m_ownsPairCache(false),
+	  m_gid(0),
+	  m_numSmallProxies(0),
+	  m_hashMask(0)
+{
+	btAssert(cellSize > btScalar(0.));
+	if (!overlappingPairCache)
+	{
+		void* mem = btAlignedAlloc(sizeof(btHashedOverlappingPairCache), 16);
+		m_pairCache = new (mem) btHashedOverlappingPairCache();
+		m_ownsPairCache = true;
+	}
+}
+
+btGridBroadphase::~btGridBroadphase()
+{
+	for (int i = 0; i < m_proxies.size(); i++)
+	{
+		m_proxies[i]->~btGridBroadphaseProxy();
+		btAlignedFree(m_proxies[i]);
+	}
+	if (m_ownsPairCache)
+	{
+		m_pairCache->~btOverlappingPairCache();
+		btAlignedFree(m_pairCache);
+	}
+}
+
+btBroadphaseProxy* btGridBroadphase::createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int /*shapeType*/, void* userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher* /*dispatcher*/)
+{
+	btGridBroadphaseProxy* proxy = new (btAlignedAlloc(sizeof(btGridBroadphaseProxy), 16)) btGridBroadphaseProxy(aabbMin, aabbMax, userPtr,
+																												collisionFilterGroup,
+																												collisionFilterMask);
+	proxy->m_uniqueId = ++m_gid;
+	proxy->m_index = m_proxies.size();
+	m_proxies.push_back(proxy);
+	return proxy;
+}
+
+void btGridBroadphase::destroyProxy(btBroadphaseProxy* absproxy, btDispatcher* dispatcher)
+{
+	btGridBroadphaseProxy* proxy = static_cast<btGridBroadphaseProxy*>(absproxy);
+	m_pairCache->removeOverlappingPairsContainingProxy(proxy, dispatcher);
+
+	const int index = proxy->m_index;
+	btAssert(m_proxies[index] == proxy);
+	m_proxies[index] = m_proxies[m_proxies.size() - 1];
+	m_proxies[index]->m_index = index;
+	m_proxies.pop_back();
+
+	proxy->~btGridBroadphaseProxy();
+	btAlignedFree(proxy);
+}
+
+void btGridBroadphase::setAabb(btBroadphaseProxy* proxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* /*dispatcher*/)
+{
+	proxy->m_aabbMin = aabbMin;
+	proxy->m_aabbMax = aabbMax;
+}
+
+void btGridBroadphase::getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const
+{
+	aabbMin = proxy->m_aabbMin;
+	aabbMax = proxy->m_aabbMax;
+}
+
+void btGridBroadphase::rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin, const btVector3& aabbMax)
+{
+	(void)rayTo;
+	btVector3 bounds[2];
+	for (int i = 0; i < m_proxies.size(); i++)
+	{
+		btGridBroadphaseProxy* proxy = m_proxies[i];
+		bounds[0] = proxy->m_aabbMin - aabbMax;
+		bounds[1] = proxy->m_aabbMax - aabbMin;
+		btScalar tmin;
+		if (btRayAabb2(rayFrom, rayCallback.m_rayDirectionInverse, rayCallback.m_signs, bounds, tmin, btScalar(0.), rayCallback.m_lambda_max))
+		{
+			rayCallback.process(proxy);
+		}
+	}
+}
+
+void btGridBroadphase::aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback)
+{
+	for (int i = 0; i < m_proxies.size(); i++)
+	{
+		btGridBroadphaseProxy* proxy = m_proxies[i];
+		if (TestAabbAgainstAabb2(aabbMin, aabbMax, proxy->m_aabbMin, proxy->m_aabbMax))
+		{
+			callback.process(proxy);
+		}
+	}
+}
+
+void btGridBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher)
+{
+	BT_PROFILE("btGridBroadphase::calculateOverlappingPairs");
+	if (m_proxies.size() == 0)
+	{
+		m_numSmallProxies = 0;
+		return;
+	}
+
+	//at least two buckets per proxy, this keeps the hash collisions rare
+	unsigned int hashSize = 64;
+	while (hashSize < unsigned(m_proxies.size()) * 2)
+	{
+		hashSize <<= 1;
+	}
+	m_hashMask = hashSize - 1;
+
+	sortProxies();
+	findCellBounds();
+	findPairs();
+	removeSeparatedPairs(dispatcher);
+}
+
+//stable LSD radix sort of the proxies by cell hash, the large proxies have the highest key and end up last
+void btGridBroadphase::sortProxies()
+{
+	BT_PROFILE("sortProxies");
+	const int numProxies = m_proxies.size();
+	m_keys.resizeNoInitialize(numProxies);
+	m_values.resizeNoInitialize(numProxies);
+	m_sortedKeys.resizeNoInitialize(numProxies);
+	m_sortedValues.resizeNoInitialize(numProxies);
+
+	int numBits = 1;
+	while ((m_hashMask + 1) >> numBits)
+	{
+		++numBits;
+	}
+	const int numPasses = (numBits + 7) / 8;
+
+	//each pass swaps the buffers, start in the buffer that makes the last pass write m_sortedKeys
+	unsigned int* keys = (numPasses & 1) ? &m_keys[0] : &m_sortedKeys[0];
+	int* values = (numPasses & 1) ? &m_values[0] : &m_sortedValues[0];
+	unsigned int* sortedKeys = (numPasses & 1) ? &m_sortedKeys[0] : &m_keys[0];
+	int* sortedValues = (numPasses & 1) ? &m_sortedValues[0] : &m_values[0];
+
+	btGridClassifyLoop classify;
+	classify.m_proxies = &m_proxies[0];
+	classify.m_keys = keys;
+	classify.m_values = values;
+	classify.m_cellSize = m_cellSize;
+	classify.m_hashMask = m_hashMask;
+	btGridParallelFor(0, numProxies, 256, classify);
+
+	const int numChunks = (numProxies + BT_GRID_SORT_CHUNK - 1) / BT_GRID_SORT_CHUNK;
+	m_histograms.resizeNoInitialize(numChunks * BT_GRID_RADIX);
+	for (int pass = 0; pass < numPasses; ++pass)
+	{
+		const int shift = pass * 8;
+
+		btGridHistogramLoop histogram;
+		histogram.m_keys = keys;
+		histogram.m_histograms = &m_histograms[0];
+		histogram.m_numKeys = numProxies;
+		histogram.m_shift = shift;
+		btGridParallelFor(0, numChunks, 1, histogram);
+
+		//digit major, chunk minor: each chunk writes its keys after the same digit of the previous chunks
+		int sum = 0;
+		for (int d = 0; d < BT_GRID_RADIX; ++d)
+		{
+			for (int chunk = 0; chunk < numChunks; ++chunk)
+			{
+				const int count = m_histograms[chunk * BT_GRID_RADIX + d];
+				m_histograms[chunk * BT_GRID_RADIX + d] = sum;
+				sum += count;
+			}
+		}
+
+		btGridScatterLoop scatter;
+		scatter.m_keys = keys;
+		scatter.m_values = values;
+		scatter.m_sortedKeys = sortedKeys;
+		scatter.m_sortedValues = sortedValues;
+		scatter.m_offsets = &m_histograms[0];
+		scatter.m_numKeys = numProxies;
+		scatter.m_shift = shift;
+		btGridParallelFor(0, numChunks, 1, scatter);
+
+		btSwap(keys, sortedKeys);
+		btSwap(values, sortedValues);
+	}
+	btAssert(keys == &m_sortedKeys[0]);
+
+	m_numSmallProxies = numProxies;
+	while (m_numSmallProxies > 0 && m_sortedKeys[m_numSmallProxies - 1] > m_hashMask)
+	{
+		--m_numSmallProxies;
+	}
+}
+
+void btGridBroadphase::findCellBounds()
+{
+	BT_PROFILE("findCellBounds");
+	const int numProxies = m_proxies.size();
+	m_cellStart.resizeNoInitialize(int(m_hashMask) + 1);
+	m_cellEnd.resizeNoInitialize(int(m_hashMask) + 1);
+	m_sortedProxies.resizeNoInitialize(numProxies);
+
+	btGridClearCellsLoop clear;
+	clear.m_cellStart = &m_cellStart[0];
+	btGridParallelFor(0, m_cellStart.size(), 1024, clear);
+
+	btGridCellBoundsLoop bounds;
+	bounds.m_proxies = &m_proxies[0];
+	bounds.m_keys = &m_sortedKeys[0];
+	bounds.m_values = &m_sortedValues[0];
+	bounds.m_sortedProxies = &m_sortedProxies[0];
+	bounds.m_cellStart = &m_cellStart[0];
+	bounds.m_cellEnd = &m_cellEnd[0];
+	bounds.m_numSmallProxies = m_numSmallProxies;
+	bounds.m_cellSize = m_cellSize;
+	btGridParallelFor(0, numProxies, 1024, bounds);
+}
+
+void btGridBroadphase::findPairs()
+{
+	BT_PROFILE("findPairs");
+	const int numProxies = m_proxies.size();
+	const int numSmallTasks = (m_numSmallProxies + BT_GRID_PAIR_CHUNK - 1) / BT_GRID_PAIR_CHUNK;
+	const int numLargeTasks = (numProxies - m_numSmallProxies + BT_GRID_LARGE_CHUNK - 1) / BT_GRID_LARGE_CHUNK;
+	const int numTasks = numSmallTasks + numLargeTasks;
+
+	btGridPairLoop pairLoop;
+	pairLoop.m_sortedProxies = &m_sortedProxies[0];
+	pairLoop.m_cellStart = &m_cellStart[0];
+	pairLoop.m_cellEnd = &m_cellEnd[0];
+	pairLoop.m_pairCache = 0;
+	pairLoop.m_taskPairs = 0;
+	pairLoop.m_numProxies = numProxies;
+	pairLoop.m_numSmallProxies = m_numSmallProxies;
+	pairLoop.m_numSmallTasks = numSmallTasks;
+	pairLoop.m_cellSize = m_cellSize;
+	pairLoop.m_hashMask = m_hashMask;
+
+	if (m_pairCache->hasConcurrentAdd())
+	{
+		pairLoop.m_pairCache = m_pairCache;
+		m_pairCache->beginConcurrentAdd(0);
+		btGridParallelFor(0, numTasks, 1, pairLoop);
+		m_pairCache->endConcurrentAdd();
+		return;
+	}
+
+	if (m_taskPairs.size() < numTasks)
+	{
+		m_taskPairs.resize(numTasks);
+	}
+	pairLoop.m_taskPairs = &m_taskPairs[0];
+	btGridParallelFor(0, numTasks, 1, pairLoop);
+	//merge in task order
+	for (int i = 0; i < numTasks; ++i)
+	{
+		btAlignedObjectArray<btBroadphaseProxy*>& pairs = m_taskPairs[i];
+		for (int j = 0; j < pairs.size(); j += 2)
+		{
+			m_pairCache->addOverlappingPair(pairs[j], pairs[j + 1]);
+		}
+		pairs.resizeNoInitialize(0);
+	}
+}
+
+void btGridBroadphase::removeSeparatedPairs(btDispatcher* dispatcher)
+{
+	BT_PROFILE("removeSeparatedPairs");
+	btBroadphasePairArray& pairs = m_pairCache->getOverlappingPairArray();
+	int numPairs = pairs.size();
+	for (int i = 0; i < numPairs; ++i)
+	{
+		btBroadphasePair& pair = pairs[i];
+		btBroadphaseProxy* proxy0 = pair.m_pProxy0;
+		btBroadphaseProxy* proxy1 = pair.m_pProxy1;
+		if (!TestAabbAgainstAabb2(proxy0->m_aabbMin, proxy0->m_aabbMax, proxy1->m_aabbMin, proxy1->m_aabbMax))
+		{
+			m_pairCache->removeOverlappingPair(proxy0, proxy1, dispatcher);
+			--numPairs;
+			--i;
+		}
+	}
+}
+
+void btGridBroadphase::getBroadphaseAabb(btVector3& aabbMin, btVector3& aabbMax) const
+{
+	if (m_proxies.size() == 0)
+	{
+		aabbMin.setValue(0, 0, 0);
+		aabbMax.setValue(0, 0, 0);
+		return;
+	}
+	aabbMin = m_proxies[0]->m_aabbMin;
+	aabbMax = m_proxies[0]->m_aabbMax;
+	for (int i = 1; i < m_proxies.size(); i++)
+	{
+		aabbMin.setMin(m_proxies[i]->m_aabbMin);
+		aabbMax.setMax(m_proxies[i]->m_aabbMax);
+	}
+}
+
+void btGridBroadphase::resetPool(btDispatcher* /*dispatcher*/)
+{
+	//the grid is rebuilt every calculateOverlappingPairs, only the unique ids could be reset
+	if (m_proxies.size() == 0)
+	{
+		m_gid = 0;
+	}
+}
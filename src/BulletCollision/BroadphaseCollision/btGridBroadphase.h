@@ -0,0 +1,124 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_GRID_BROADPHASE_H
+#define BT_GRID_BROADPHASE_H
+
+#include "btBroadphaseInterface.h"
+#include "btOverlappingPairCache.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+struct btGridBroadphaseProxy : public btBroadphaseProxy
+{
+	int m_index;  // index in btGridBroadphase::m_proxies
+
+	btGridBroadphaseProxy(const btVector3& aabbMin, const btVector3& aabbMax, void* userPtr, int collisionFilterGroup, int collisionFilterMask)
+		: btBroadphaseProxy(aabbMin, aabbMax, userPtr, collisionFilterGroup, collisionFilterMask),
+		  m_index(-1)
+	{
+	}
+};
+
+///proxy data gathered in cell order, so the pair search reads contiguous memory
+ATTRIBUTE_ALIGNED16(struct)
+btGridSortedProxy
+{
+	btVector3 m_aabbMin;
+	btVector3 m_aabbMax;
+	int m_cell[3];
+	int m_uniqueId;
+	btGridBroadphaseProxy* m_proxy;
+};
+
+///The btGridBroadphase is a CPU port of the b3GpuGridBroadphase: a uniform grid, rebuilt from scratch every calculateOverlappingPairs.
+///Proxies are binned by the cell of their aabb center, sorted by a hash of that cell with a radix sort, and each proxy is tested against the proxies of the neighbouring cells.
+///Every stage runs with btParallelFor when a task scheduler is set, and the reported pairs do not depend on the number of threads.
+///It works best when most objects are about the same size: proxies larger than the cell size visit all the cells they overlap.
+///Use btDbvtBroadphase for worlds with a wide range of object sizes.
+class btGridBroadphase : public btBroadphaseInterface
+{
+protected:
+	btScalar m_cellSize;
+	btOverlappingPairCache* m_pairCache;
+	bool m_ownsPairCache;
+	int m_gid;
+	int m_numSmallProxies;  // proxies that fit a cell, the large proxies are sorted after them
+	unsigned int m_hashMask;
+
+	btAlignedObjectArray<btGridBroadphaseProxy*> m_proxies;
+	btAlignedObjectArray<unsigned int> m_keys;  // cell hash per proxy, m_hashMask+1 for large proxies
+	btAlignedObjectArray<unsigned int> m_sortedKeys;
+	btAlignedObjectArray<int> m_values;  // proxy indices, in the order of the sorted keys
+	btAlignedObjectArray<int> m_sortedValues;
+	btAlignedObjectArray<int> m_histograms;  // radix sort digit counts per chunk
+	btAlignedObjectArray<int> m_cellStart;
+	btAlignedObjectArray<int> m_cellEnd;
+	btAlignedObjectArray<btGridSortedProxy> m_sortedProxies;
+	btAlignedObjectArray<btAlignedObjectArray<btBroadphaseProxy*> > m_taskPairs;  // Per task pair output, merged in task order
+
+	void sortProxies();
+	void findCellBounds();
+	void findPairs();
+	void removeSeparatedPairs(btDispatcher* dispatcher);
+
+public:
+	btGridBroadphase(btScalar cellSize = btScalar(1.), btOverlappingPairCache* overlappingPairCache = 0);
+	virtual ~btGridBroadphase();
+
+	virtual btBroadphaseProxy* createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int shapeType, void* userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher* dispatcher);
+	virtual void destroyProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher);
+	virtual void setAabb(btBroadphaseProxy* proxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* dispatcher);
+	virtual void getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const;
+
+	virtual void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0));
+	virtual void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
+
+	virtual void calculateOverlappingPairs(btDispatcher* dispatcher);
+
+	virtual btOverlappingPairCache* getOverlappingPairCache()
+	{
+		return m_pairCache;
+	}
+	virtual const btOverlappingPairCache* getOverlappingPairCache() const
+	{
+		return m_pairCache;
+	}
+
+	virtual void getBroadphaseAabb(btVector3& aabbMin, btVector3& aabbMax) const;
+
+	virtual void resetPool(btDispatcher* dispatcher);
+
+	virtual void printStats()
+	{
+	}
+
+	///the cell size should be at least the largest extent of the typical object, larger objects take the slow path
+	void setCellSize(btScalar cellSize)
+	{
+		btAssert(cellSize > btScalar(0.));
+		m_cellSize = cellSize;
+	}
+	btScalar getCellSize() const
+	{
+		return m_cellSize;
+	}
+
+	int getNumLargeProxies() const
+	{
+		return m_proxies.size() - m_numSmallProxies;
+	}
+};
+
+#endif  //BT_GRID_BROADPHASE_H
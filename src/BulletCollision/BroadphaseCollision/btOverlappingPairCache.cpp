@@ -18,6 +18,7 @@ subject to the following restrictions:
 #include "btDispatcher.h"
 #include "btCollisionAlgorithm.h"
 #include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btThreads.h"
 
 #include <stdio.h>
 
@@ -441,6 +442,468 @@ void btHashedOverlappingPairCache::sortOverlappingPairs(btDispatcher* dispatcher
 	}
 }
 
+btConcurrentOverlappingPairCache::btConcurrentOverlappingPairCache() : m_overlapFilterCallback(0),
+																	   m_ghostPairCallback(0),
+																	   m_concurrentCount(0),
+																	   m_concurrentStart(0),
+																	   m_concurrentAdding(false)
+{
+	int initialAllocatedSize = 2;
+	m_overlappingPairArray.reserve(initialAllocatedSize);
+	rebuildSlots(initialAllocatedSize);
+#if BT_THREADSAFE
+	m_overflowProxies.resize(BT_MAX_THREAD_COUNT);
+#else
+	m_overflowProxies.resize(1);
+#endif
+}
+
+btConcurrentOverlappingPairCache::~btConcurrentOverlappingPairCache()
+{
+}
+
+void btConcurrentOverlappingPairCache::rebuildSlots(int pairCapacity)
+{
+	// keep the load factor of the open addressing table at or below one half
+	int numSlots = 16;
+	while (numSlots < pairCapacity * 2)
+	{
+		numSlots *= 2;
+	}
+	m_slots.resizeNoInitialize(numSlots);
+	for (int i = 0; i < numSlots; ++i)
+	{
+		m_slots[i].m_pairIndex = SLOT_EMPTY;
+	}
+
+	const int mask = numSlots - 1;
+	for (int i = 0; i < m_overlappingPairArray.size(); ++i)
+	{
+		const btBroadphasePair& pair = m_overlappingPairArray[i];
+		const int uid0 = pair.m_pProxy0->getUid();
+		const int uid1 = pair.m_pProxy1->getUid();
+		int slot = static_cast<int>(getHash(static_cast<unsigned int>(uid0), static_cast<unsigned int>(uid1)) & mask);
+		while (m_slots[slot].m_pairIndex != SLOT_EMPTY)
+		{
+			slot = (slot + 1) & mask;
+		}
+		m_slots[slot].m_pairIndex = i;
+		m_slots[slot].m_uid0 = uid0;
+		m_slots[slot].m_uid1 = uid1;
+	}
+}
+
+int btConcurrentOverlappingPairCache::findSlot(int uid0, int uid1) const
+{
+	const int numSlots = m_slots.size();
+	const int mask = numSlots - 1;
+	int slot = static_cast<int>(getHash(static_cast<unsigned int>(uid0), static_cast<unsigned int>(uid1)) & mask);
+	for (int probe = 0; probe < numSlots; ++probe)
+	{
+		const Slot& s = m_slots[slot];
+		int index = *static_cast<const int volatile*>(&s.m_pairIndex);
+		if (index == SLOT_EMPTY)
+		{
+			return -1;
+		}
+		while (index == SLOT_BUSY)
+		{
+			index = *static_cast<const int volatile*>(&s.m_pairIndex);
+		}
+#if BT_THREADSAFE
+		btFullMemoryFence();
+#endif
+		if ((s.m_uid0 == uid0) && (s.m_uid1 == uid1))
+		{
+			return slot;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return -1;
+}
+
+void btConcurrentOverlappingPairCache::removeSlot(int slot)
+{
+	// backward shift deletion, keeps the probe sequences intact without tombstones
+	const int mask = m_slots.size() - 1;
+	int hole = slot;
+	int next = slot;
+	for (;;)
+	{
+		next = (next + 1) & mask;
+		const Slot& s = m_slots[next];
+		if (s.m_pairIndex == SLOT_EMPTY)
+		{
+			break;
+		}
+		const int home = static_cast<int>(getHash(static_cast<unsigned int>(s.m_uid0), static_cast<unsigned int>(s.m_uid1)) & mask);
+		// the entry at 'next' can only move to 'hole' if its home is not cyclically in (hole, next]
+		const bool stays = (hole <= next) ? ((hole < home) && (home <= next)) : ((hole < home) || (home <= next));
+		if (!stays)
+		{
+			m_slots[hole] = s;
+			hole = next;
+		}
+	}
+	m_slots[hole].m_pairIndex = SLOT_EMPTY;
+}
+
+btBroadphasePair* btConcurrentOverlappingPairCache::addOverlappingPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	if (!needsBroadphaseCollision(proxy0, proxy1))
+		return 0;
+
+	if (m_concurrentAdding)
+	{
+		return internalAddPairConcurrent(proxy0, proxy1);
+	}
+
+	const int count = m_overlappingPairArray.size();
+	btBroadphasePair* pair = internalAddPair(proxy0, proxy1);
+
+	//this is where we add an actual pair, so also call the 'ghost'
+	if (m_ghostPairCallback && (m_overlappingPairArray.size() > count))
+		m_ghostPairCallback->addOverlappingPair(proxy0, proxy1);
+
+	return pair;
+}
+
+btBroadphasePair* btConcurrentOverlappingPairCache::internalAddPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	if (proxy0->m_uniqueId > proxy1->m_uniqueId)
+		btSwap(proxy0, proxy1);
+	const int uid0 = proxy0->getUid();
+	const int uid1 = proxy1->getUid();
+
+	int existing = findSlot(uid0, uid1);
+	if (existing >= 0)
+	{
+		btAssert(m_slots[existing].m_pairIndex >= 0);
+		return &m_overlappingPairArray[m_slots[existing].m_pairIndex];
+	}
+
+	const int count = m_overlappingPairArray.size();
+	if (count == m_overlappingPairArray.capacity())
+	{
+		m_overlappingPairArray.reserve(count ? count * 2 : 2);
+		rebuildSlots(m_overlappingPairArray.capacity());
+	}
+
+	const int mask = m_slots.size() - 1;
+	int slot = static_cast<int>(getHash(static_cast<unsigned int>(uid0), static_cast<unsigned int>(uid1)) & mask);
+	while (m_slots[slot].m_pairIndex != SLOT_EMPTY)
+	{
+		slot = (slot + 1) & mask;
+	}
+	m_slots[slot].m_pairIndex = count;
+	m_slots[slot].m_uid0 = uid0;
+	m_slots[slot].m_uid1 = uid1;
+
+	void* mem = &m_overlappingPairArray.expandNonInitializing();
+	btBroadphasePair* pair = new (mem) btBroadphasePair(*proxy0, *proxy1);
+	pair->m_algorithm = 0;
+	pair->m_internalTmpValue = 0;
+	return pair;
+}
+
+btBroadphasePair* btConcurrentOverlappingPairCache::internalAddPairConcurrent(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	if (proxy0->m_uniqueId > proxy1->m_uniqueId)
+		btSwap(proxy0, proxy1);
+	const int uid0 = proxy0->getUid();
+	const int uid1 = proxy1->getUid();
+
+	const int numSlots = m_slots.size();
+	const int mask = numSlots - 1;
+	int slot = static_cast<int>(getHash(static_cast<unsigned int>(uid0), static_cast<unsigned int>(uid1)) & mask);
+	for (int probe = 0; probe < numSlots; ++probe)
+	{
+		Slot& s = m_slots[slot];
+		int volatile* state = &s.m_pairIndex;
+		int index = *state;
+		if (index == SLOT_EMPTY)
+		{
+			index = btAtomicCompareExchange(state, SLOT_EMPTY, SLOT_BUSY);
+			if (index == SLOT_EMPTY)
+			{
+				// this thread owns the slot, publish the pair index once the pair is written
+				s.m_uid0 = uid0;
+				s.m_uid1 = uid1;
+				int pairIndex = btAtomicFetchAdd(&m_concurrentCount, 1);
+				btBroadphasePair* pair = 0;
+				if (pairIndex < m_overlappingPairArray.size())
+				{
+					pair = new (&m_overlappingPairArray[pairIndex]) btBroadphasePair(*proxy0, *proxy1);
+					pair->m_internalTmpValue = 0;
+				}
+				else
+				{
+					btAlignedObjectArray<btBroadphaseProxy*>& overflow = m_overflowProxies[btGetCurrentThreadIndex()];
+					overflow.push_back(proxy0);
+					overflow.push_back(proxy1);
+					pairIndex = SLOT_OVERFLOW;
+				}
+#if BT_THREADSAFE
+				btFullMemoryFence();
+#endif
+				*state = pairIndex;
+				return pair;
+			}
+		}
+		while (index == SLOT_BUSY)
+		{
+			index = *state;
+		}
+#if BT_THREADSAFE
+		btFullMemoryFence();
+#endif
+		if ((s.m_uid0 == uid0) && (s.m_uid1 == uid1))
+		{
+			return (index >= 0) ? &m_overlappingPairArray[index] : 0;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	// the table is full, defer to endConcurrentAdd
+	btAlignedObjectArray<btBroadphaseProxy*>& overflow = m_overflowProxies[btGetCurrentThreadIndex()];
+	overflow.push_back(proxy0);
+	overflow.push_back(proxy1);
+	return 0;
+}
+
+void btConcurrentOverlappingPairCache::beginConcurrentAdd(int expectedNewPairs)
+{
+	btAssert(!m_concurrentAdding);
+	const int count = m_overlappingPairArray.size();
+	const int required = count + btMax(expectedNewPairs, btMax(count / 2, 64));
+	if (m_overlappingPairArray.capacity() < required)
+	{
+		m_overlappingPairArray.reserve(required);
+		rebuildSlots(m_overlappingPairArray.capacity());
+	}
+	m_concurrentStart = count;
+	m_concurrentCount = count;
+	// expose the reserved pairs, endConcurrentAdd shrinks the array to the pairs actually added
+	m_overlappingPairArray.resizeNoInitialize(m_overlappingPairArray.capacity());
+	m_concurrentAdding = true;
+}
+
+void btConcurrentOverlappingPairCache::endConcurrentAdd()
+{
+	btAssert(m_concurrentAdding);
+	m_concurrentAdding = false;
+	m_overlappingPairArray.resizeNoInitialize(btMin(int(m_concurrentCount), m_overlappingPairArray.size()));
+
+	// second phase of the grow, insert the pairs that did not fit
+	int numOverflow = 0;
+	for (int i = 0; i < m_overflowProxies.size(); ++i)
+	{
+		numOverflow += m_overflowProxies[i].size() / 2;
+	}
+	if (numOverflow > 0)
+	{
+		m_overlappingPairArray.reserve(btMax(m_overlappingPairArray.capacity() * 2, m_overlappingPairArray.size() + numOverflow));
+		rebuildSlots(m_overlappingPairArray.capacity());
+		for (int i = 0; i < m_overflowProxies.size(); ++i)
+		{
+			btAlignedObjectArray<btBroadphaseProxy*>& overflow = m_overflowProxies[i];
+			for (int j = 0; j < overflow.size(); j += 2)
+			{
+				internalAddPair(overflow[j], overflow[j + 1]);
+			}
+			overflow.resizeNoInitialize(0);
+		}
+	}
+
+	// the new pairs are in thread arrival order, sort them for determinism
+	const int numNew = m_overlappingPairArray.size() - m_concurrentStart;
+	if (numNew > 1)
+	{
+		m_sortBuffer.resizeNoInitialize(numNew);
+		for (int i = 0; i < numNew; ++i)
+		{
+			m_sortBuffer[i] = m_overlappingPairArray[m_concurrentStart + i];
+		}
+		m_sortBuffer.quickSort(btBroadphasePairSortPredicate());
+		for (int i = 0; i < numNew; ++i)
+		{
+			const int pairIndex = m_concurrentStart + i;
+			const btBroadphasePair& pair = m_sortBuffer[i];
+			m_overlappingPairArray[pairIndex] = pair;
+			m_slots[findSlot(pair.m_pProxy0->getUid(), pair.m_pProxy1->getUid())].m_pairIndex = pairIndex;
+		}
+	}
+
+	if (m_ghostPairCallback)
+	{
+		for (int i = m_concurrentStart; i < m_overlappingPairArray.size(); ++i)
+		{
+			m_ghostPairCallback->addOverlappingPair(m_overlappingPairArray[i].m_pProxy0, m_overlappingPairArray[i].m_pProxy1);
+		}
+	}
+}
+
+btBroadphasePair* btConcurrentOverlappingPairCache::findPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	if (proxy0->m_uniqueId > proxy1->m_uniqueId)
+		btSwap(proxy0, proxy1);
+	int slot = findSlot(proxy0->getUid(), proxy1->getUid());
+	if (slot < 0)
+	{
+		return NULL;
+	}
+	int index = m_slots[slot].m_pairIndex;
+	if (index < 0)
+	{
+		return NULL;
+	}
+	return &m_overlappingPairArray[index];
+}
+
+void* btConcurrentOverlappingPairCache::removeOverlappingPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, btDispatcher* dispatcher)
+{
+	btAssert(!m_concurrentAdding);
+	if (proxy0->m_uniqueId > proxy1->m_uniqueId)
+		btSwap(proxy0, proxy1);
+
+	int slot = findSlot(proxy0->getUid(), proxy1->getUid());
+	if (slot < 0)
+	{
+		return 0;
+	}
+	const int pairIndex = m_slots[slot].m_pairIndex;
+	btAssert(pairIndex >= 0 && pairIndex < m_overlappingPairArray.size());
+
+	btBroadphasePair* pair = &m_overlappingPairArray[pairIndex];
+	cleanOverlappingPair(*pair, dispatcher);
+	void* userData = pair->m_internalInfo1;
+
+	removeSlot(slot);
+
+	if (m_ghostPairCallback)
+		m_ghostPairCallback->removeOverlappingPair(proxy0, proxy1, dispatcher);
+
+	// move the last pair into the spot of the removed pair
+	const int lastPairIndex = m_overlappingPairArray.size() - 1;
+	if (lastPairIndex != pairIndex)
+	{
+		const btBroadphasePair& last = m_overlappingPairArray[lastPairIndex];
+		int lastSlot = findSlot(last.m_pProxy0->getUid(), last.m_pProxy1->getUid());
+		btAssert(lastSlot >= 0);
+		m_slots[lastSlot].m_pairIndex = pairIndex;
+		m_overlappingPairArray[pairIndex] = last;
+	}
+	m_overlappingPairArray.pop_back();
+
+	return userData;
+}
+
+void btConcurrentOverlappingPairCache::cleanOverlappingPair(btBroadphasePair& pair, btDispatcher* dispatcher)
+{
+	if (pair.m_algorithm && dispatcher)
+	{
+		pair.m_algorithm->~btCollisionAlgorithm();
+		dispatcher->freeCollisionAlgorithm(pair.m_algorithm);
+		pair.m_algorithm = 0;
+	}
+}
+
+void btConcurrentOverlappingPairCache::cleanProxyFromPairs(btBroadphaseProxy* proxy, btDispatcher* dispatcher)
+{
+	for (int i = 0; i < m_overlappingPairArray.size(); ++i)
+	{
+		btBroadphasePair& pair = m_overlappingPairArray[i];
+		if ((pair.m_pProxy0 == proxy) ||
+			(pair.m_pProxy1 == proxy))
+		{
+			cleanOverlappingPair(pair, dispatcher);
+		}
+	}
+}
+
+void btConcurrentOverlappingPairCache::removeOverlappingPairsContainingProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher)
+{
+	for (int i = 0; i < m_overlappingPairArray.size();)
+	{
+		btBroadphasePair& pair = m_overlappingPairArray[i];
+		if ((pair.m_pProxy0 == proxy) ||
+			(pair.m_pProxy1 == proxy))
+		{
+			removeOverlappingPair(pair.m_pProxy0, pair.m_pProxy1, dispatcher);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+void btConcurrentOverlappingPairCache::processAllOverlappingPairs(btOverlapCallback* callback, btDispatcher* dispatcher)
+{
+	BT_PROFILE("btConcurrentOverlappingPairCache::processAllOverlappingPairs");
+	for (int i = 0; i < m_overlappingPairArray.size();)
+	{
+		btBroadphasePair* pair = &m_overlappingPairArray[i];
+		if (callback->processOverlap(*pair))
+		{
+			removeOverlappingPair(pair->m_pProxy0, pair->m_pProxy1, dispatcher);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+void btConcurrentOverlappingPairCache::processAllOverlappingPairs(btOverlapCallback* callback, btDispatcher* dispatcher, const struct btDispatcherInfo& dispatchInfo)
+{
+	if (!dispatchInfo.m_deterministicOverlappingPairs)
+	{
+		processAllOverlappingPairs(callback, dispatcher);
+		return;
+	}
+
+	btBroadphasePairArray& pa = getOverlappingPairArray();
+	btAlignedObjectArray<MyPairIndex> indices;
+	{
+		BT_PROFILE("sortOverlappingPairs");
+		indices.resize(pa.size());
+		for (int i = 0; i < indices.size(); i++)
+		{
+			const btBroadphasePair& p = pa[i];
+			indices[i].m_uidA0 = p.m_pProxy0->m_uniqueId;
+			indices[i].m_uidA1 = p.m_pProxy1->m_uniqueId;
+			indices[i].m_orgIndex = i;
+		}
+		indices.quickSort(MyPairIndeSortPredicate());
+	}
+	{
+		BT_PROFILE("btConcurrentOverlappingPairCache::processAllOverlappingPairs");
+		// removal moves pairs around, so remove after visiting all of them
+		btBroadphasePairArray& removals = m_sortBuffer;
+		removals.resizeNoInitialize(0);
+		for (int i = 0; i < indices.size(); i++)
+		{
+			btBroadphasePair* pair = &pa[indices[i].m_orgIndex];
+			if (callback->processOverlap(*pair))
+			{
+				removals.push_back(*pair);
+			}
+		}
+		for (int i = 0; i < removals.size(); i++)
+		{
+			removeOverlappingPair(removals[i].m_pProxy0, removals[i].m_pProxy1, dispatcher);
+		}
+	}
+}
+
+void btConcurrentOverlappingPairCache::sortOverlappingPairs(btDispatcher* dispatcher)
+{
+	(void)dispatcher;
+	m_overlappingPairArray.quickSort(btBroadphasePairSortPredicate());
+	rebuildSlots(m_overlappingPairArray.capacity());
+}
+
 void* btSortedOverlappingPairCache::removeOverlappingPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, btDispatcher* dispatcher)
 {
 	if (!hasDeferredRemoval())
@@ -80,6 +80,20 @@ public:
 	virtual void setInternalGhostPairCallback(btOverlappingPairCallback* ghostPairCallback) = 0;
 
 	virtual void sortOverlappingPairs(btDispatcher* dispatcher) = 0;
+
+	///returns true if addOverlappingPair can be called from several threads between beginConcurrentAdd and endConcurrentAdd
+	virtual bool hasConcurrentAdd() const
+	{
+		return false;
+	}
+
+	virtual void beginConcurrentAdd(int /*expectedNewPairs*/)
+	{
+	}
+
+	virtual void endConcurrentAdd()
+	{
+	}
 };
 
 /// Hash-space based Pair Cache, thanks to Erin Catto, Box2D, http://www.box2d.org, and Pierre Terdiman, Codercorner, http://codercorner.com
@@ -253,6 +267,162 @@ private:
 	virtual void sortOverlappingPairs(btDispatcher * dispatcher);
 };
 
+///btConcurrentOverlappingPairCache is a hashed pair cache that accepts addOverlappingPair calls from many threads.
+///It uses open addressing with atomic slots instead of the chained m_hashTable/m_next of btHashedOverlappingPairCache.
+///Between beginConcurrentAdd and endConcurrentAdd only addOverlappingPair and findPair may be called, and the pair array must not be accessed.
+///Pairs that do not fit the reserved space are kept aside and inserted by endConcurrentAdd after growing the tables (two-phase grow).
+///endConcurrentAdd also sorts the new pairs, so the pair order does not depend on thread timing.
+///Outside of a concurrent add it behaves like btHashedOverlappingPairCache, removal is single-threaded.
+///btDbvtBroadphase adds its pairs concurrently when setParallelCollide is on. btAxisSweep3 finds its pairs while it sorts the moved edges one proxy
+///at a time, which cannot be split between threads, so it accepts this cache in its constructor but only adds pairs outside of a concurrent add.
+ATTRIBUTE_ALIGNED16(class)
+btConcurrentOverlappingPairCache : public btOverlappingPairCache
+{
+	struct Slot
+	{
+		int m_pairIndex;
+		int m_uid0;
+		int m_uid1;
+	};
+
+	enum
+	{
+		SLOT_EMPTY = -1,
+		SLOT_BUSY = -2,
+		SLOT_OVERFLOW = -3
+	};
+
+	btBroadphasePairArray m_overlappingPairArray;
+	btOverlapFilterCallback* m_overlapFilterCallback;
+	btOverlappingPairCallback* m_ghostPairCallback;
+
+	btAlignedObjectArray<Slot> m_slots;
+	btAlignedObjectArray<btAlignedObjectArray<btBroadphaseProxy*> > m_overflowProxies;
+	btBroadphasePairArray m_sortBuffer;
+	int volatile m_concurrentCount;
+	int m_concurrentStart;
+	bool m_concurrentAdding;
+
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btConcurrentOverlappingPairCache();
+	virtual ~btConcurrentOverlappingPairCache();
+
+	virtual bool hasConcurrentAdd() const
+	{
+		return true;
+	}
+
+	///reserve room for the pairs added concurrently, pairs beyond the reserved space are deferred to endConcurrentAdd
+	virtual void beginConcurrentAdd(int expectedNewPairs);
+
+	virtual void endConcurrentAdd();
+
+	bool isConcurrentAdding() const
+	{
+		return m_concurrentAdding;
+	}
+
+	SIMD_FORCE_INLINE bool needsBroadphaseCollision(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1) const
+	{
+		if (m_overlapFilterCallback)
+			return m_overlapFilterCallback->needBroadphaseCollision(proxy0, proxy1);
+
+		bool collides = (proxy0->m_collisionFilterGroup & proxy1->m_collisionFilterMask) != 0;
+		collides = collides && (proxy1->m_collisionFilterGroup & proxy0->m_collisionFilterMask);
+
+		return collides;
+	}
+
+	// Add a pair and return the new pair. If the pair already exists,
+	// no new pair is created and the old one is returned.
+	// During a concurrent add, 0 is returned for pairs deferred to endConcurrentAdd.
+	virtual btBroadphasePair* addOverlappingPair(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1);
+
+	virtual void* removeOverlappingPair(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1, btDispatcher * dispatcher);
+
+	void removeOverlappingPairsContainingProxy(btBroadphaseProxy * proxy, btDispatcher * dispatcher);
+
+	void cleanProxyFromPairs(btBroadphaseProxy * proxy, btDispatcher * dispatcher);
+
+	void cleanOverlappingPair(btBroadphasePair & pair, btDispatcher * dispatcher);
+
+	virtual void processAllOverlappingPairs(btOverlapCallback*, btDispatcher * dispatcher);
+
+	virtual void processAllOverlappingPairs(btOverlapCallback * callback, btDispatcher * dispatcher, const struct btDispatcherInfo& dispatchInfo);
+
+	btBroadphasePair* findPair(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1);
+
+	virtual btBroadphasePair* getOverlappingPairArrayPtr()
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	const btBroadphasePair* getOverlappingPairArrayPtr() const
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	btBroadphasePairArray& getOverlappingPairArray()
+	{
+		return m_overlappingPairArray;
+	}
+
+	const btBroadphasePairArray& getOverlappingPairArray() const
+	{
+		return m_overlappingPairArray;
+	}
+
+	int getNumOverlappingPairs() const
+	{
+		return m_overlappingPairArray.size();
+	}
+
+	btOverlapFilterCallback* getOverlapFilterCallback()
+	{
+		return m_overlapFilterCallback;
+	}
+
+	void setOverlapFilterCallback(btOverlapFilterCallback * callback)
+	{
+		m_overlapFilterCallback = callback;
+	}
+
+	virtual bool hasDeferredRemoval()
+	{
+		return false;
+	}
+
+	virtual void setInternalGhostPairCallback(btOverlappingPairCallback * ghostPairCallback)
+	{
+		m_ghostPairCallback = ghostPairCallback;
+	}
+
+	virtual void sortOverlappingPairs(btDispatcher * dispatcher);
+
+private:
+	btBroadphasePair* internalAddPair(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1);
+	btBroadphasePair* internalAddPairConcurrent(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1);
+	int findSlot(int uid0, int uid1) const;
+	void removeSlot(int slot);
+	void rebuildSlots(int pairCapacity);
+
+	SIMD_FORCE_INLINE unsigned int getHash(unsigned int proxyId1, unsigned int proxyId2) const
+	{
+		unsigned int key = proxyId1 | (proxyId2 << 16);
+		// Thomas Wang's hash
+
+		key += ~(key << 15);
+		key ^= (key >> 10);
+		key += (key << 3);
+		key ^= (key >> 6);
+		key += ~(key << 11);
+		key ^= (key >> 16);
+		return key;
+	}
+};
+
 ///btSortedOverlappingPairCache maintains the objects with overlapping AABB
 ///Typically managed by the Broadphase, Axis3Sweep or btSimpleBroadphase
 class btSortedOverlappingPairCache : public btOverlappingPairCache
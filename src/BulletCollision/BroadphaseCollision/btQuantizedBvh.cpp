@@ -765,6 +765,126 @@ void btQuantizedBvh::reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCa
 	*/
 }
 
+void btQuantizedBvh::reportRayPacketOverlappingNodex(btNodeRayPacketOverlapCallback* nodeCallback, const btVector3* raySource, const btVector3* rayTarget, btScalar* lambdaMax, int numRays) const
+{
+	const int stride = btNodeRayPacketOverlapCallback::MAX_RAYS;
+	btAssert(numRays > 0 && numRays <= stride);
+
+	//rays in structure of arrays layout, padded to a multiple of 4 with rays that never hit
+	ATTRIBUTE_ALIGNED16(btScalar rayFrom[3 * stride]);
+	ATTRIBUTE_ALIGNED16(btScalar rayInvDirection[3 * stride]);
+	ATTRIBUTE_ALIGNED16(btScalar rayLambda[stride]);
+	const int numGroups = (numRays + 3) / 4;
+	btVector3 rayAabbMin = raySource[0];
+	btVector3 rayAabbMax = raySource[0];
+	for (int i = 0; i < numGroups * 4; i++)
+	{
+		if (i < numRays)
+		{
+			const btVector3 rayDir = rayTarget[i] - raySource[i];
+			for (int k = 0; k < 3; k++)
+			{
+				rayFrom[k * stride + i] = raySource[i][k];
+				rayInvDirection[k * stride + i] = rayDir[k] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[k];
+			}
+			rayLambda[i] = lambdaMax[i];
+			rayAabbMin.setMin(raySource[i]);
+			rayAabbMax.setMax(raySource[i]);
+			rayAabbMin.setMin(raySource[i] + rayDir * lambdaMax[i]);
+			rayAabbMax.setMax(raySource[i] + rayDir * lambdaMax[i]);
+		}
+		else
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				rayFrom[k * stride + i] = btScalar(0.0);
+				rayInvDirection[k * stride + i] = btScalar(1.0);
+			}
+			rayLambda[i] = btScalar(-1.0);
+		}
+	}
+
+	/* Quick pruning by quantized box around the whole packet */
+	unsigned short int quantizedQueryAabbMin[3] = {0, 0, 0};
+	unsigned short int quantizedQueryAabbMax[3] = {0, 0, 0};
+	if (m_useQuantization)
+	{
+		quantizeWithClamp(quantizedQueryAabbMin, rayAabbMin, 0);
+		quantizeWithClamp(quantizedQueryAabbMax, rayAabbMax, 1);
+	}
+
+	int curIndex = 0;
+	while (curIndex < m_curNodeIndex)
+	{
+		bool isLeafNode;
+		int escapeIndex;
+		int subPart = 0;
+		int triangleIndex = 0;
+		//PCK: unsigned instead of bool
+		unsigned aabbOverlap;
+		btVector3 bounds[2];
+		if (m_useQuantization)
+		{
+			const btQuantizedBvhNode* node = &m_quantizedContiguousNodes[curIndex];
+			isLeafNode = node->isLeafNode();
+			escapeIndex = isLeafNode ? 1 : node->getEscapeIndex();
+			if (isLeafNode)
+			{
+				subPart = node->getPartId();
+				triangleIndex = node->getTriangleIndex();
+			}
+			aabbOverlap = testQuantizedAabbAgainstQuantizedAabb(quantizedQueryAabbMin, quantizedQueryAabbMax, node->m_quantizedAabbMin, node->m_quantizedAabbMax);
+			if (aabbOverlap)
+			{
+				bounds[0] = unQuantize(node->m_quantizedAabbMin);
+				bounds[1] = unQuantize(node->m_quantizedAabbMax);
+			}
+		}
+		else
+		{
+			const btOptimizedBvhNode* node = &m_contiguousNodes[curIndex];
+			isLeafNode = node->m_escapeIndex == -1;
+			escapeIndex = node->m_escapeIndex;
+			subPart = node->m_subPart;
+			triangleIndex = node->m_triangleIndex;
+			aabbOverlap = TestAabbAgainstAabb2(rayAabbMin, rayAabbMax, node->m_aabbMinOrg, node->m_aabbMaxOrg);
+			if (aabbOverlap)
+			{
+				bounds[0] = node->m_aabbMinOrg;
+				bounds[1] = node->m_aabbMaxOrg;
+			}
+		}
+
+		unsigned rayMask = 0;
+		if (aabbOverlap)
+		{
+			for (int g = 0; g < numGroups; g++)
+			{
+				rayMask |= btRayAabbPacket4(rayFrom + g * 4, rayInvDirection + g * 4, stride, rayLambda + g * 4, bounds[0], bounds[1]) << (g * 4);
+			}
+		}
+
+		if (isLeafNode && rayMask)
+		{
+			nodeCallback->processNode(subPart, triangleIndex, rayMask);
+			//the callback may have shortened the rays
+			for (int i = 0; i < numRays; i++)
+			{
+				rayLambda[i] = lambdaMax[i];
+			}
+		}
+
+		if (rayMask || isLeafNode)
+		{
+			curIndex++;
+		}
+		else
+		{
+			curIndex += escapeIndex;
+		}
+	}
+}
+
 void btQuantizedBvh::swapLeafNodes(int i, int splitIndex)
 {
 	if (m_useQuantization)
@@ -152,6 +152,21 @@ public:
 	virtual void processNode(int subPart, int triangleIndex) = 0;
 };
 
+///btNodeRayPacketOverlapCallback receives the leaf nodes hit by a packet of rays, see btQuantizedBvh::reportRayPacketOverlappingNodex
+class btNodeRayPacketOverlapCallback
+{
+public:
+	enum
+	{
+		MAX_RAYS = 8
+	};
+
+	virtual ~btNodeRayPacketOverlapCallback(){};
+
+	///rayMask has bit i set for each ray i that overlaps the node
+	virtual void processNode(int subPart, int triangleIndex, unsigned int rayMask) = 0;
+};
+
 #include "LinearMath/btAlignedAllocator.h"
 #include "LinearMath/btAlignedObjectArray.h"
 
@@ -322,6 +337,9 @@ public:
 	void reportAabbOverlappingNodex(btNodeOverlapCallback * nodeCallback, const btVector3& aabbMin, const btVector3& aabbMax) const;
 	void reportRayOverlappingNodex(btNodeOverlapCallback * nodeCallback, const btVector3& raySource, const btVector3& rayTarget) const;
 	void reportBoxCastOverlappingNodex(btNodeOverlapCallback * nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax) const;
+	///walks the tree once for a packet of up to btNodeRayPacketOverlapCallback::MAX_RAYS rays, testing the nodes against 4 rays at a time.
+	///lambdaMax[i] limits the parameter of ray i along rayTarget[i] - raySource[i], the callback may lower it to shorten the ray
+	void reportRayPacketOverlappingNodex(btNodeRayPacketOverlapCallback * nodeCallback, const btVector3* raySource, const btVector3* rayTarget, btScalar* lambdaMax, int numRays) const;
 
 	SIMD_FORCE_INLINE void quantize(unsigned short* out, const btVector3& point, int isMax) const
 	{
@@ -19,25 +19,52 @@ subject to the following restrictions:
 #include "BulletCollision/BroadphaseCollision/btCollisionAlgorithm.h"
 
 #include "BulletCollision/CollisionShapes/btCollisionShape.h"
+#include "BulletCollision/CollisionShapes/btConvexShape.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
 #include "LinearMath/btPoolAllocator.h"
 #include "BulletCollision/CollisionDispatch/btCollisionConfiguration.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
+#include "BulletCollision/CollisionDispatch/btConvexConvexAlgorithm.h"
+#include "BulletCollision/CollisionDispatch/btManifoldResult.h"
 
 btCollisionDispatcherMt::btCollisionDispatcherMt(btCollisionConfiguration* config, int grainSize)
 	: btCollisionDispatcher(config)
 {
-	m_batchManifoldsPtr.resize(btGetTaskScheduler()->getNumThreads());
-	m_batchReleasePtr.resize(btGetTaskScheduler()->getNumThreads());
+	m_threadData.resize(BT_MAX_THREAD_COUNT);
+
+	m_threadManifoldPoolSize = btMax(m_persistentManifoldPoolAllocator->getMaxCount() / 8, 16);
+	m_threadAlgorithmPoolSize = btMax(m_collisionAlgorithmPoolAllocator->getMaxCount() / 8, 16);
 
 	m_grainSize = grainSize;  // iterations per task
 
+	m_convexPairBatching = false;
+	m_minConvexPairBatchSize = 64;
+
 	btFullMemoryFence();
 	m_batchUpdating = false;
+	m_deferringConvexPairs = false;
 	btFullMemoryFence();
 }
 
+btCollisionDispatcherMt::~btCollisionDispatcherMt()
+{
+	for (int i = 0; i < m_threadData.size(); ++i)
+	{
+		ThreadData& data = m_threadData[i];
+		if (data.m_manifoldPool)
+		{
+			data.m_manifoldPool->~btPoolAllocator();
+			btAlignedFree(data.m_manifoldPool);
+		}
+		if (data.m_algorithmPool)
+		{
+			data.m_algorithmPool->~btPoolAllocator();
+			btAlignedFree(data.m_algorithmPool);
+		}
+	}
+}
+
 btPersistentManifold* btCollisionDispatcherMt::getNewManifold(const btCollisionObject* body0, const btCollisionObject* body1)
 {
 	//optional relative contact breaking threshold, turned on by default (use setDispatcherFlags to switch off feature for improved performance)
@@ -47,7 +74,26 @@ btPersistentManifold* btCollisionDispatcherMt::getNewManifold(const btCollisionO
 
 	btScalar contactProcessingThreshold = btMin(body0->getContactProcessingThreshold(), body1->getContactProcessingThreshold());
 
-	void* mem = m_persistentManifoldPoolAllocator->allocate(sizeof(btPersistentManifold));
+	bool batchUpdating = m_batchUpdating;
+	btFullMemoryFence();
+
+	ThreadData* threadData = 0;
+	void* mem = NULL;
+	if (batchUpdating)
+	{
+		// use the pool of this thread, no other thread allocates from it
+		int current_thread_index = btGetCurrentThreadIndex();
+		btAssert(current_thread_index < m_threadData.size());
+		threadData = &m_threadData[current_thread_index];
+		if (threadData->m_manifoldPool)
+		{
+			mem = threadData->m_manifoldPool->allocate(sizeof(btPersistentManifold));
+		}
+	}
+	if (NULL == mem)
+	{
+		mem = m_persistentManifoldPoolAllocator->allocate(sizeof(btPersistentManifold));
+	}
 	if (NULL == mem)
 	{
 		//we got a pool memory overflow, by default we fallback to dynamically allocate memory. If we require a contiguous contact pool then assert.
@@ -64,9 +110,6 @@ btPersistentManifold* btCollisionDispatcherMt::getNewManifold(const btCollisionO
 	}
 	btPersistentManifold* manifold = new (mem) btPersistentManifold(body0, body1, 0, contactBreakingThreshold, contactProcessingThreshold);
 
-	bool batchUpdating = m_batchUpdating;
-	btFullMemoryFence();
-
 	if (!batchUpdating)
 	{
 		// batch updater will update manifold pointers array after finishing, so
@@ -77,9 +120,11 @@ btPersistentManifold* btCollisionDispatcherMt::getNewManifold(const btCollisionO
 	}
 	else
 	{
-		int current_thread_index = btGetCurrentThreadIndex();
-		btAssert(current_thread_index < m_batchManifoldsPtr.size());
-		m_batchManifoldsPtr[current_thread_index].push_back(manifold);
+		BatchManifold batchManifold;
+		batchManifold.m_pairIndex = threadData->m_pairIndex;
+		batchManifold.m_order = threadData->m_newManifolds.size();
+		batchManifold.m_manifold = manifold;
+		threadData->m_newManifolds.push_back(batchManifold);
 	}
 
 	return manifold;
@@ -104,8 +149,13 @@ void btCollisionDispatcherMt::releaseManifold(btPersistentManifold* manifold)
 		m_manifoldsPtr.pop_back();
 	} else {
 		int current_thread_index = btGetCurrentThreadIndex();
-		btAssert(current_thread_index < m_batchReleasePtr.size());
-		m_batchReleasePtr[current_thread_index].push_back(manifold);
+		btAssert(current_thread_index < m_threadData.size());
+		ThreadData& threadData = m_threadData[current_thread_index];
+		BatchManifold batchManifold;
+		batchManifold.m_pairIndex = threadData.m_pairIndex;
+		batchManifold.m_order = threadData.m_releasedManifolds.size();
+		batchManifold.m_manifold = manifold;
+		threadData.m_releasedManifolds.push_back(batchManifold);
 		return;
 	}
 
@@ -113,18 +163,94 @@ void btCollisionDispatcherMt::releaseManifold(btPersistentManifold* manifold)
 	if (m_persistentManifoldPoolAllocator->validPtr(manifold))
 	{
 		m_persistentManifoldPoolAllocator->freeMemory(manifold);
+		return;
 	}
-	else
+	// the pools of the threads are created in thread order
+	for (int i = 0; i < m_threadData.size() && m_threadData[i].m_manifoldPool; ++i)
+	{
+		btPoolAllocator* pool = m_threadData[i].m_manifoldPool;
+		if (pool->validPtr(manifold))
+		{
+			pool->freeMemory(manifold);
+			return;
+		}
+	}
+	btAlignedFree(manifold);
+}
+
+void* btCollisionDispatcherMt::allocateCollisionAlgorithm(int size)
+{
+	bool batchUpdating = m_batchUpdating;
+	btFullMemoryFence();
+
+	if (batchUpdating)
+	{
+		int current_thread_index = btGetCurrentThreadIndex();
+		btAssert(current_thread_index < m_threadData.size());
+		btPoolAllocator* pool = m_threadData[current_thread_index].m_algorithmPool;
+		if (pool && size <= pool->getElementSize())
+		{
+			if (void* mem = pool->allocate(size))
+			{
+				return mem;
+			}
+		}
+	}
+	return btCollisionDispatcher::allocateCollisionAlgorithm(size);
+}
+
+void btCollisionDispatcherMt::freeCollisionAlgorithm(void* ptr)
+{
+	// algorithms can be freed by another thread than the one that allocated them, the pools lock on free
+	for (int i = 0; i < m_threadData.size() && m_threadData[i].m_algorithmPool; ++i)
+	{
+		btPoolAllocator* pool = m_threadData[i].m_algorithmPool;
+		if (pool->validPtr(ptr))
+		{
+			pool->freeMemory(ptr);
+			return;
+		}
+	}
+	btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+}
+
+bool btCollisionDispatcherMt::deferConvexConvexPair(btConvexConvexAlgorithm* algorithm, const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap, btScalar maximumDistanceSquared)
+{
+	bool deferring = m_deferringConvexPairs;
+	btFullMemoryFence();
+
+	// only the pairs of the near callback are deferred, they are replayed from their collision objects
+	if (!deferring || body0Wrap->m_parent || body1Wrap->m_parent ||
+		body0Wrap->getCollisionShape() != body0Wrap->getCollisionObject()->getCollisionShape() ||
+		body1Wrap->getCollisionShape() != body1Wrap->getCollisionObject()->getCollisionShape())
+	{
+		return false;
+	}
+	// curved shapes with their own support function, such as cylinders and cones, converge too slowly to gain from the batch
+	const btConvexShape* shape0 = static_cast<const btConvexShape*>(body0Wrap->getCollisionShape());
+	const btConvexShape* shape1 = static_cast<const btConvexShape*>(body1Wrap->getCollisionShape());
+	if ((!btGjkBatch::hasBoxSupport(shape0) && !shape0->isPolyhedral()) || (!btGjkBatch::hasBoxSupport(shape1) && !shape1->isPolyhedral()))
 	{
-		btAlignedFree(manifold);
+		return false;
 	}
+	int current_thread_index = btGetCurrentThreadIndex();
+	btAssert(current_thread_index < m_threadData.size());
+	ThreadData& threadData = m_threadData[current_thread_index];
+	DeferredConvexPair& pair = threadData.m_convexPairs.expandNonInitializing();
+	pair.m_algorithm = algorithm;
+	pair.m_body0 = body0Wrap->getCollisionObject();
+	pair.m_body1 = body1Wrap->getCollisionObject();
+	pair.m_maximumDistanceSquared = maximumDistanceSquared;
+	pair.m_shapeKey = (btGjkBatch::hasBoxSupport(shape0) ? 0 : 1) + (btGjkBatch::hasBoxSupport(shape1) ? 0 : 2);
+	pair.m_pairIndex = threadData.m_pairIndex;
+	return true;
 }
 
 struct CollisionDispatcherUpdater : public btIParallelForBody
 {
 	btBroadphasePair* mPairArray;
 	btNearCallback mCallback;
-	btCollisionDispatcher* mDispatcher;
+	btCollisionDispatcherMt* mDispatcher;
 	const btDispatcherInfo* mInfo;
 
 	CollisionDispatcherUpdater()
@@ -136,14 +262,150 @@ struct CollisionDispatcherUpdater : public btIParallelForBody
 	}
 	void forLoop(int iBegin, int iEnd) const
 	{
+		btCollisionDispatcherMt::ThreadData& threadData = mDispatcher->m_threadData[btGetCurrentThreadIndex()];
 		for (int i = iBegin; i < iEnd; ++i)
 		{
 			btBroadphasePair* pair = &mPairArray[i];
+			threadData.m_pairIndex = i;
 			mCallback(*pair, *mDispatcher, *mInfo);
 		}
 	}
 };
 
+// computes the closest points of groups of btGjkBatch::WIDTH deferred pairs
+struct ConvexPairBatchUpdater : public btIParallelForBody
+{
+	btCollisionDispatcherMt* mDispatcher;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const btAlignedObjectArray<btCollisionDispatcherMt::DeferredConvexPair>& convexPairs = mDispatcher->m_convexPairs;
+		btGjkBatchPair* gjkPairs = &mDispatcher->m_gjkPairs[0];
+		btGjkBatchResult* gjkResults = &mDispatcher->m_gjkResults[0];
+		int first = iBegin * btGjkBatch::WIDTH;
+		int last = btMin(iEnd * int(btGjkBatch::WIDTH), convexPairs.size());
+		for (int i = first; i < last; ++i)
+		{
+			const btCollisionDispatcherMt::DeferredConvexPair& pair = convexPairs[i];
+			btGjkBatchPair& gjkPair = gjkPairs[i];
+			gjkPair.m_transformA = pair.m_body0->getWorldTransform();
+			gjkPair.m_transformB = pair.m_body1->getWorldTransform();
+			gjkPair.m_shapeA = static_cast<const btConvexShape*>(pair.m_body0->getCollisionShape());
+			gjkPair.m_shapeB = static_cast<const btConvexShape*>(pair.m_body1->getCollisionShape());
+			gjkPair.m_maximumDistanceSquared = pair.m_maximumDistanceSquared;
+		}
+		btGjkBatch::getClosestPoints(gjkPairs + first, gjkResults + first, last - first);
+	}
+};
+
+// finishes the deferred pairs like the default near callback
+struct ConvexPairUpdater : public btIParallelForBody
+{
+	btCollisionDispatcherMt* mDispatcher;
+	const btDispatcherInfo* mInfo;
+	const btGjkBatchResult* mResults;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		btCollisionDispatcherMt::ThreadData& threadData = mDispatcher->m_threadData[btGetCurrentThreadIndex()];
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btCollisionDispatcherMt::DeferredConvexPair& pair = mDispatcher->m_convexPairs[i];
+			threadData.m_pairIndex = pair.m_pairIndex;
+			btCollisionObjectWrapper obj0Wrap(0, pair.m_body0->getCollisionShape(), pair.m_body0, pair.m_body0->getWorldTransform(), -1, -1);
+			btCollisionObjectWrapper obj1Wrap(0, pair.m_body1->getCollisionShape(), pair.m_body1, pair.m_body1->getWorldTransform(), -1, -1);
+			btManifoldResult contactPointResult(&obj0Wrap, &obj1Wrap);
+			pair.m_algorithm->processCollisionBatched(&obj0Wrap, &obj1Wrap, *mInfo, &contactPointResult, mResults ? &mResults[i] : 0);
+		}
+	}
+};
+
+struct btDeferredConvexPairSortPredicate
+{
+	template <typename T>
+	bool operator()(const T& a, const T& b) const
+	{
+		if (a.m_shapeKey != b.m_shapeKey)
+		{
+			return a.m_shapeKey < b.m_shapeKey;
+		}
+		return a.m_pairIndex < b.m_pairIndex;
+	}
+};
+
+struct btBatchManifoldSortPredicate
+{
+	template <typename T>
+	bool operator()(const T& a, const T& b) const
+	{
+		if (a.m_pairIndex != b.m_pairIndex)
+		{
+			return a.m_pairIndex < b.m_pairIndex;
+		}
+		return a.m_order < b.m_order;
+	}
+};
+
+// gathers the manifolds created or released by all threads, in the order of the pairs that created or released them
+void btCollisionDispatcherMt::mergeBatchManifolds(bool released)
+{
+	m_mergeBuffer.resizeNoInitialize(0);
+	for (int i = 0; i < m_threadData.size(); ++i)
+	{
+		btAlignedObjectArray<BatchManifold>& batchManifolds = released ? m_threadData[i].m_releasedManifolds : m_threadData[i].m_newManifolds;
+		for (int j = 0; j < batchManifolds.size(); ++j)
+		{
+			m_mergeBuffer.push_back(batchManifolds[j]);
+		}
+		batchManifolds.resizeNoInitialize(0);
+	}
+	if (m_mergeBuffer.size() > 1)
+	{
+		m_mergeBuffer.quickSort(btBatchManifoldSortPredicate());
+	}
+}
+
+// computes the closest points of the pairs deferred by all threads, and finishes their collision algorithms
+void btCollisionDispatcherMt::processConvexPairs(const btDispatcherInfo& info)
+{
+	m_convexPairs.resizeNoInitialize(0);
+	for (int i = 0; i < m_threadData.size(); ++i)
+	{
+		btAlignedObjectArray<DeferredConvexPair>& convexPairs = m_threadData[i].m_convexPairs;
+		for (int j = 0; j < convexPairs.size(); ++j)
+		{
+			m_convexPairs.push_back(convexPairs[j]);
+		}
+		convexPairs.resizeNoInitialize(0);
+	}
+	const int numPairs = m_convexPairs.size();
+	if (numPairs == 0)
+	{
+		return;
+	}
+	// the lanes of a batch are independent, the sort only keeps the pairs with box support functions together
+	m_convexPairs.quickSort(btDeferredConvexPairSortPredicate());
+
+	const btGjkBatchResult* results = 0;
+	if (numPairs >= m_minConvexPairBatchSize)
+	{
+		m_gjkPairs.resizeNoInitialize(numPairs);
+		m_gjkResults.resizeNoInitialize(numPairs);
+
+		ConvexPairBatchUpdater batchUpdater;
+		batchUpdater.mDispatcher = this;
+		const int numGroups = (numPairs + btGjkBatch::WIDTH - 1) / btGjkBatch::WIDTH;
+		btParallelFor(0, numGroups, btMax(m_grainSize / int(btGjkBatch::WIDTH), 1), batchUpdater);
+		results = &m_gjkResults[0];
+	}
+
+	ConvexPairUpdater updater;
+	updater.mDispatcher = this;
+	updater.mInfo = &info;
+	updater.mResults = results;
+	btParallelFor(0, numPairs, m_grainSize, updater);
+}
+
 void btCollisionDispatcherMt::dispatchAllCollisionPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& info, btDispatcher* dispatcher)
 {
 	const int pairCount = pairCache->getNumOverlappingPairs();
@@ -151,44 +413,58 @@ void btCollisionDispatcherMt::dispatchAllCollisionPairs(btOverlappingPairCache*
 	{
 		return;
 	}
+
+	// create the pools of the threads that can take part
+	const int numThreads = btMin(int(btGetTaskScheduler()->getNumThreads()), m_threadData.size());
+	for (int i = 0; i < numThreads; ++i)
+	{
+		ThreadData& data = m_threadData[i];
+		if (!data.m_manifoldPool)
+		{
+			void* mem = btAlignedAlloc(sizeof(btPoolAllocator), 16);
+			data.m_manifoldPool = new (mem) btPoolAllocator(sizeof(btPersistentManifold), m_threadManifoldPoolSize);
+		}
+		if (!data.m_algorithmPool)
+		{
+			void* mem = btAlignedAlloc(sizeof(btPoolAllocator), 16);
+			data.m_algorithmPool = new (mem) btPoolAllocator(m_collisionAlgorithmPoolAllocator->getElementSize(), m_threadAlgorithmPoolSize);
+		}
+	}
+
 	CollisionDispatcherUpdater updater;
 	updater.mCallback = getNearCallback();
 	updater.mPairArray = pairCache->getOverlappingPairArrayPtr();
 	updater.mDispatcher = this;
 	updater.mInfo = &info;
 
+	// the deferred pairs are finished like the default near callback does, a custom callback dispatches all pairs itself
+	bool deferConvexPairs = m_convexPairBatching && updater.mCallback == defaultNearCallback && info.m_dispatchFunc == btDispatcherInfo::DISPATCH_DISCRETE;
+
 	btFullMemoryFence();
 	m_batchUpdating = true;
+	m_deferringConvexPairs = deferConvexPairs;
 	btFullMemoryFence();
 
 	btParallelFor(0, pairCount, m_grainSize, updater);
 
 	btFullMemoryFence();
-	m_batchUpdating = false;
+	m_deferringConvexPairs = false;
 	btFullMemoryFence();
 
-	// merge new manifolds, if any
-	for (int i = 0; i < m_batchManifoldsPtr.size(); ++i)
+	if (deferConvexPairs)
 	{
-		btAlignedObjectArray<btPersistentManifold*>& batchManifoldsPtr = m_batchManifoldsPtr[i];
-
-		for (int j = 0; j < batchManifoldsPtr.size(); ++j)
-		{
-			m_manifoldsPtr.push_back(batchManifoldsPtr[j]);
-		}
-
-		batchManifoldsPtr.resizeNoInitialize(0);
+		processConvexPairs(info);
 	}
 
-	// remove batched remove manifolds.
-	for (int i = 0; i < m_batchReleasePtr.size(); ++i)
+	btFullMemoryFence();
+	m_batchUpdating = false;
+	btFullMemoryFence();
+
+	// merge new manifolds, if any
+	mergeBatchManifolds(false);
+	for (int i = 0; i < m_mergeBuffer.size(); ++i)
 	{
-		btAlignedObjectArray<btPersistentManifold*>& batchManifoldsPtr = m_batchReleasePtr[i];
-		for (int j = 0; j < batchManifoldsPtr.size(); ++j)
-		{
-			releaseManifold(batchManifoldsPtr[j]);
-		}
-		batchManifoldsPtr.resizeNoInitialize(0);
+		m_manifoldsPtr.push_back(m_mergeBuffer[i].m_manifold);
 	}
 
 	// update the indices (used when releasing manifolds)
@@ -196,4 +472,11 @@ void btCollisionDispatcherMt::dispatchAllCollisionPairs(btOverlappingPairCache*
 	{
 		m_manifoldsPtr[i]->m_index1a = i;
 	}
+
+	// remove batched remove manifolds.
+	mergeBatchManifolds(true);
+	for (int i = 0; i < m_mergeBuffer.size(); ++i)
+	{
+		releaseManifold(m_mergeBuffer[i].m_manifold);
+	}
 }
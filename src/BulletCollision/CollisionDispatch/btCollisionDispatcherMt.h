@@ -17,22 +17,100 @@ subject to the following restrictions:
 #define BT_COLLISION_DISPATCHER_MT_H
 
 #include "BulletCollision/CollisionDispatch/btCollisionDispatcher.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkBatch.h"
 #include "LinearMath/btThreads.h"
 
+class btPoolAllocator;
+
+///btCollisionDispatcherMt dispatches the overlapping pairs with btParallelFor.
+///While the pairs are dispatched, each thread allocates manifolds and collision algorithms from its own pools,
+///so the threads do not contend on the shared pools of the collision configuration.
+///The manifolds created and released by the threads are merged in pair order, the result does not depend on the thread timing.
+///With setConvexPairBatching, the closest points of the convex pairs are computed together with btGjkBatch, after all pairs are dispatched.
 class btCollisionDispatcherMt : public btCollisionDispatcher
 {
 public:
 	btCollisionDispatcherMt(btCollisionConfiguration* config, int grainSize = 40);
+	virtual ~btCollisionDispatcherMt();
 
 	virtual btPersistentManifold* getNewManifold(const btCollisionObject* body0, const btCollisionObject* body1) BT_OVERRIDE;
 	virtual void releaseManifold(btPersistentManifold* manifold) BT_OVERRIDE;
 
 	virtual void dispatchAllCollisionPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& info, btDispatcher* dispatcher) BT_OVERRIDE;
 
+	virtual void* allocateCollisionAlgorithm(int size) BT_OVERRIDE;
+	virtual void freeCollisionAlgorithm(void* ptr) BT_OVERRIDE;
+
+	virtual bool deferConvexConvexPair(btConvexConvexAlgorithm* algorithm, const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap, btScalar maximumDistanceSquared) BT_OVERRIDE;
+
+	///number of manifolds and collision algorithms in each per-thread pool, by default 1/8 of the shared pools.
+	///the pools of the threads are created on first use, when a pool is full the shared pool is used
+	void setThreadPoolSizes(int manifoldPoolSize, int algorithmPoolSize)
+	{
+		m_threadManifoldPoolSize = manifoldPoolSize;
+		m_threadAlgorithmPoolSize = algorithmPoolSize;
+	}
+
+	///computes the closest points of the convex pairs with btGjkBatch, when a dispatch has at least minBatchSize of them.
+	///only pairs dispatched by the default near callback are batched, and the contact points can differ slightly from btGjkPairDetector
+	void setConvexPairBatching(bool enable, int minBatchSize = 64)
+	{
+		m_convexPairBatching = enable;
+		m_minConvexPairBatchSize = minBatchSize;
+	}
+	bool getConvexPairBatching() const
+	{
+		return m_convexPairBatching;
+	}
+
 protected:
-	btAlignedObjectArray<btAlignedObjectArray<btPersistentManifold*> > m_batchManifoldsPtr;
-	btAlignedObjectArray<btAlignedObjectArray<btPersistentManifold*> > m_batchReleasePtr;
+	friend struct CollisionDispatcherUpdater;
+	friend struct ConvexPairBatchUpdater;
+	friend struct ConvexPairUpdater;
+
+	struct BatchManifold
+	{
+		int m_pairIndex;  // index of the pair that was dispatched
+		int m_order;      // order within the thread, a pair is dispatched by a single thread
+		btPersistentManifold* m_manifold;
+	};
+
+	struct DeferredConvexPair
+	{
+		btConvexConvexAlgorithm* m_algorithm;
+		const btCollisionObject* m_body0;
+		const btCollisionObject* m_body1;
+		btScalar m_maximumDistanceSquared;
+		int m_shapeKey;   // pairs of shapes with the same support functions are batched together
+		int m_pairIndex;  // index of the pair that was dispatched
+	};
+
+	struct ThreadData
+	{
+		btPoolAllocator* m_manifoldPool;
+		btPoolAllocator* m_algorithmPool;
+		btAlignedObjectArray<BatchManifold> m_newManifolds;
+		btAlignedObjectArray<BatchManifold> m_releasedManifolds;
+		btAlignedObjectArray<DeferredConvexPair> m_convexPairs;
+		int m_pairIndex;  // pair currently dispatched by the thread
+
+		ThreadData() : m_manifoldPool(0), m_algorithmPool(0), m_pairIndex(0) {}
+	};
+
+	void mergeBatchManifolds(bool released);
+	void processConvexPairs(const btDispatcherInfo& info);
+
+	btAlignedObjectArray<ThreadData> m_threadData;
+	btAlignedObjectArray<BatchManifold> m_mergeBuffer;
+	btAlignedObjectArray<DeferredConvexPair> m_convexPairs;
+	btAlignedObjectArray<btGjkBatchPair> m_gjkPairs;
+	btAlignedObjectArray<btGjkBatchResult> m_gjkResults;
+	int m_threadManifoldPoolSize;
+	int m_threadAlgorithmPoolSize;
 	bool volatile m_batchUpdating;
+	bool volatile m_deferringConvexPairs;
+	bool m_convexPairBatching;
+	int m_minConvexPairBatchSize;
 	int m_grainSize;
 };
 
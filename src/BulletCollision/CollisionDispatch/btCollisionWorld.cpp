@@ -34,6 +34,7 @@ subject to the following restrictions:
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btQuickprof.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 #include "BulletCollision/CollisionShapes/btConvexPolyhedron.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
 
@@ -909,7 +910,10 @@ void btCollisionWorld::objectQuerySingleInternal(const btConvexShape* castShape,
 				if (tree)
 				{
 					const ATTRIBUTE_ALIGNED16(btDbvtVolume) bounds = btDbvtVolume::FromMM(fromLocalAabbMin, fromLocalAabbMax);
-					tree->collideTV(tree->m_root, bounds, callback);
+					if (const btDbvtWide* wideTree = compoundShape->getWideAabbTree())
+						wideTree->collideTV(bounds, callback);
+					else
+						tree->collideTV(tree->m_root, bounds, callback);
 				}
 				else
 				{
@@ -1017,6 +1021,195 @@ void btCollisionWorld::rayTest(const btVector3& rayFromWorld, const btVector3& r
 #endif  //USE_BRUTEFORCE_RAYBROADPHASE
 }
 
+///records the closest hit of one ray of a rayTestBatch packet
+struct btBatchedRayResultCallback : public btCollisionWorld::RayResultCallback
+{
+	btCollisionWorld::BatchedRayResult* m_result;
+	btVector3 m_rayFromWorld;
+	btVector3 m_rayToWorld;
+
+	virtual btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult, bool normalInWorldSpace)
+	{
+		//caller already does the filter on the m_closestHitFraction
+		btAssert(rayResult.m_hitFraction <= m_closestHitFraction);
+
+		m_closestHitFraction = rayResult.m_hitFraction;
+		m_collisionObject = rayResult.m_collisionObject;
+		m_result->m_collisionObject = m_collisionObject;
+		m_result->m_hitFraction = rayResult.m_hitFraction;
+		if (normalInWorldSpace)
+		{
+			m_result->m_hitNormalWorld = rayResult.m_hitNormalLocal;
+		}
+		else
+		{
+			///need to transform normal into worldspace
+			m_result->m_hitNormalWorld = m_collisionObject->getWorldTransform().getBasis() * rayResult.m_hitNormalLocal;
+		}
+		m_result->m_hitPointWorld.setInterpolate3(m_rayFromWorld, m_rayToWorld, rayResult.m_hitFraction);
+		return rayResult.m_hitFraction;
+	}
+};
+
+///casts the rays of a packet against the proxies found by btBroadphaseInterface::rayTestPacket
+struct btBatchedRayPacketCallback : public btBroadphaseRayPacketCallback
+{
+	btBatchedRayResultCallback* m_resultCallbacks;
+
+	///casts the rays of a btBvhTriangleMeshShape in packets, with one bvh walk per packet instead of one per ray
+	void processTriangleMesh(btCollisionObject* collisionObject, const int* rays, int numRays)
+	{
+		const btBvhTriangleMeshShape* triangleMesh = (const btBvhTriangleMeshShape*)collisionObject->getCollisionShape();
+		const btTransform& colObjWorldTransform = collisionObject->getWorldTransform();
+		const btTransform worldTocollisionObject = colObjWorldTransform.inverse();
+		btVector3 rayFromLocal[btNodeRayPacketOverlapCallback::MAX_RAYS];
+		btVector3 rayToLocal[btNodeRayPacketOverlapCallback::MAX_RAYS];
+		btTriangleRayHit hits[btNodeRayPacketOverlapCallback::MAX_RAYS];
+		//there is at least one ray, the packet only reads the first numRays entries
+		btAssert(numRays > 0);
+		int j = 0;
+		do
+		{
+			const int i = rays[j];
+			rayFromLocal[j] = worldTocollisionObject * m_rayFrom[i];
+			rayToLocal[j] = worldTocollisionObject * m_rayTo[i];
+			hits[j].m_hitFraction = m_resultCallbacks[i].m_closestHitFraction;
+		} while (++j < numRays);
+		triangleMesh->performRaycastPacket(rayFromLocal, rayToLocal, numRays, hits, m_resultCallbacks[rays[0]].m_flags);
+		for (j = 0; j < numRays; ++j)
+		{
+			if (hits[j].m_triangleIndex >= 0)
+			{
+				const int i = rays[j];
+				btCollisionWorld::LocalShapeInfo shapeInfo;
+				shapeInfo.m_shapePart = hits[j].m_partId;
+				shapeInfo.m_triangleIndex = hits[j].m_triangleIndex;
+				btCollisionWorld::LocalRayResult rayResult(collisionObject,
+														   &shapeInfo,
+														   colObjWorldTransform.getBasis() * hits[j].m_hitNormalLocal,
+														   hits[j].m_hitFraction);
+				m_resultCallbacks[i].addSingleResult(rayResult, true);
+				m_lambdaMax[i] = m_resultCallbacks[i].m_closestHitFraction;
+			}
+		}
+	}
+
+	virtual void process(const btBroadphaseProxy* proxy, unsigned int rayMask)
+	{
+		btCollisionObject* collisionObject = (btCollisionObject*)proxy->m_clientObject;
+		const bool isTriangleMesh = collisionObject->getCollisionShape()->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE;
+		int meshRays[btNodeRayPacketOverlapCallback::MAX_RAYS];
+		int numMeshRays = 0;
+		for (int i = 0; i < m_numRays; ++i)
+		{
+			btBatchedRayResultCallback& resultCallback = m_resultCallbacks[i];
+			///skip rays that already reached zero
+			if ((rayMask & (1u << i)) && resultCallback.m_closestHitFraction > btScalar(0.) &&
+				resultCallback.needsCollision(collisionObject->getBroadphaseHandle()))
+			{
+				if (isTriangleMesh)
+				{
+					meshRays[numMeshRays++] = i;
+					if (numMeshRays == btNodeRayPacketOverlapCallback::MAX_RAYS)
+					{
+						processTriangleMesh(collisionObject, meshRays, numMeshRays);
+						numMeshRays = 0;
+					}
+					continue;
+				}
+				btTransform rayFromTrans;
+				btTransform rayToTrans;
+				rayFromTrans.setIdentity();
+				rayFromTrans.setOrigin(m_rayFrom[i]);
+				rayToTrans.setIdentity();
+				rayToTrans.setOrigin(m_rayTo[i]);
+				btCollisionWorld::rayTestSingle(rayFromTrans, rayToTrans,
+												collisionObject,
+												collisionObject->getCollisionShape(),
+												collisionObject->getWorldTransform(),
+												resultCallback);
+				m_lambdaMax[i] = resultCallback.m_closestHitFraction;
+			}
+		}
+		if (numMeshRays)
+		{
+			processTriangleMesh(collisionObject, meshRays, numMeshRays);
+		}
+	}
+};
+
+struct btRayTestBatchLoop : public btIParallelForBody
+{
+	enum
+	{
+		PACKET_SIZE = 16
+	};
+	btBroadphaseInterface* m_broadphase;
+	const btVector3* m_rayFromWorld;
+	const btVector3* m_rayToWorld;
+	int m_numRays;
+	btCollisionWorld::BatchedRayResult* m_results;
+	int m_collisionFilterGroup;
+	int m_collisionFilterMask;
+	unsigned int m_flags;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		btBatchedRayResultCallback resultCallbacks[PACKET_SIZE];
+		btScalar lambdaMax[PACKET_SIZE];
+		for (int packet = iBegin; packet < iEnd; ++packet)
+		{
+			const int first = packet * PACKET_SIZE;
+			btBatchedRayPacketCallback packetCallback;
+			packetCallback.m_rayFrom = m_rayFromWorld + first;
+			packetCallback.m_rayTo = m_rayToWorld + first;
+			packetCallback.m_lambdaMax = lambdaMax;
+			packetCallback.m_numRays = btMin(int(PACKET_SIZE), m_numRays - first);
+			packetCallback.m_resultCallbacks = resultCallbacks;
+			for (int i = 0; i < packetCallback.m_numRays; ++i)
+			{
+				btBatchedRayResultCallback& resultCallback = resultCallbacks[i];
+				resultCallback.m_closestHitFraction = btScalar(1.);
+				resultCallback.m_collisionObject = 0;
+				resultCallback.m_collisionFilterGroup = m_collisionFilterGroup;
+				resultCallback.m_collisionFilterMask = m_collisionFilterMask;
+				resultCallback.m_flags = m_flags;
+				resultCallback.m_rayFromWorld = m_rayFromWorld[first + i];
+				resultCallback.m_rayToWorld = m_rayToWorld[first + i];
+				resultCallback.m_result = &m_results[first + i];
+				resultCallback.m_result->m_collisionObject = 0;
+				resultCallback.m_result->m_hitFraction = btScalar(1.);
+				lambdaMax[i] = btScalar(1.);
+			}
+			m_broadphase->rayTestPacket(packetCallback);
+		}
+	}
+};
+
+void btCollisionWorld::rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, BatchedRayResult* results,
+									int collisionFilterGroup, int collisionFilterMask, unsigned int flags) const
+{
+	BT_PROFILE("rayTestBatch");
+	btRayTestBatchLoop rayLoop;
+	rayLoop.m_broadphase = m_broadphasePairCache;
+	rayLoop.m_rayFromWorld = rayFromWorld;
+	rayLoop.m_rayToWorld = rayToWorld;
+	rayLoop.m_numRays = numRays;
+	rayLoop.m_results = results;
+	rayLoop.m_collisionFilterGroup = collisionFilterGroup;
+	rayLoop.m_collisionFilterMask = collisionFilterMask;
+	rayLoop.m_flags = flags;
+	const int numPackets = (numRays + btRayTestBatchLoop::PACKET_SIZE - 1) / btRayTestBatchLoop::PACKET_SIZE;
+#if BT_THREADSAFE
+	if (btGetTaskScheduler())
+	{
+		btParallelFor(0, numPackets, 4, rayLoop);
+		return;
+	}
+#endif
+	rayLoop.forLoop(0, numPackets);
+}
+
 struct btSingleSweepCallback : public btBroadphaseRayCallback
 {
 	btTransform m_convexFromTrans;
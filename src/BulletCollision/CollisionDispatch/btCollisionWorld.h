@@ -264,6 +264,15 @@ public:
 		}
 	};
 
+	///BatchedRayResult is the closest hit of one ray of rayTestBatch, m_collisionObject is 0 when the ray hits nothing
+	struct BatchedRayResult
+	{
+		const btCollisionObject* m_collisionObject;
+		btVector3 m_hitNormalWorld;
+		btVector3 m_hitPointWorld;
+		btScalar m_hitFraction;
+	};
+
 	struct AllHitsRayResultCallback : public RayResultCallback
 	{
 		AllHitsRayResultCallback(const btVector3& rayFromWorld, const btVector3& rayToWorld)
@@ -433,6 +442,13 @@ public:
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value returned by the callback.
 	virtual void rayTest(const btVector3& rayFromWorld, const btVector3& rayToWorld, RayResultCallback& resultCallback) const;
 
+	/// rayTestBatch finds the closest hit of numRays rays and writes it to results[i], without a user callback per hit.
+	/// Neighbouring rays are traversed through the broadphase together in packets, so coherent rays (a lidar scan line, a camera tile) should be adjacent.
+	/// Rays against a btBvhTriangleMeshShape are also cast in packets, see btBvhTriangleMeshShape::performRaycastPacket.
+	/// The packets are cast in parallel with btParallelFor when a task scheduler is set. flags are the EFlags of btRaycastCallback.h
+	void rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, BatchedRayResult* results,
+					  int collisionFilterGroup = btBroadphaseProxy::DefaultFilter, int collisionFilterMask = btBroadphaseProxy::AllFilter, unsigned int flags = 0) const;
+
 	/// convexTest performs a swept convex cast on all objects in the btCollisionWorld, and calls the resultCallback
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value return by the callback.
 	void convexSweepTest(const btConvexShape* castShape, const btTransform& from, const btTransform& to, ConvexResultCallback& resultCallback, btScalar allowedCcdPenetration = btScalar(0.)) const;
@@ -290,7 +290,14 @@ void btCompoundCollisionAlgorithm::processCollision(const btCollisionObjectWrapp
 
 		const ATTRIBUTE_ALIGNED16(btDbvtVolume) bounds = btDbvtVolume::FromMM(localAabbMin, localAabbMax);
 		//process all children, that overlap with  the given AABB bounds
-		tree->collideTVNoStackAlloc(tree->m_root, bounds, stack2, callback);
+		if (const btDbvtWide* wideTree = compoundShape->getWideAabbTree())
+		{
+			wideTree->collideTVNoStackAlloc(bounds, m_wideStack, callback);
+		}
+		else
+		{
+			tree->collideTVNoStackAlloc(tree->m_root, bounds, stack2, callback);
+		}
 	}
 	else
 	{
@@ -48,6 +48,7 @@ subject to the following restrictions:
 
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpa2.h"
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkBatch.h"
 #include "BulletCollision/NarrowPhaseCollision/btPolyhedralContactClipping.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
 
@@ -267,10 +268,57 @@ struct btPerturbedContactResult : public btManifoldResult
 
 extern btScalar gContactBreakingThreshold;
 
+///reports the closest points of a btGjkBatch like btGjkPairDetector::getClosestPoints, returns false when btGjkPairDetector is still needed
+static bool btReportBatchedClosestPoints(const btGjkBatchResult& batchResult, const btConvexShape* min0, const btConvexShape* min1, btGjkPairDetector& gjkPairDetector, const btGjkPairDetector::ClosestPointInput& input, btDiscreteCollisionDetectorInterface::Result& output)
+{
+	if (batchResult.m_status == btGjkBatch::BT_GJK_BATCH_FAR)
+	{
+		// m_distance is a lower bound, it is enough when it is beyond the maximum distance of this query
+		if (batchResult.m_distance * batchResult.m_distance <= input.m_maximumDistanceSquared)
+		{
+			return false;
+		}
+		gjkPairDetector.setCachedSeparatingAxis(batchResult.m_normalOnB);
+		return true;
+	}
+	if (batchResult.m_status != btGjkBatch::BT_GJK_BATCH_SEPARATED)
+	{
+		return false;
+	}
+	gjkPairDetector.setCachedSeparatingAxis(batchResult.m_normalOnB);
+	btScalar marginB = min1->getMarginNonVirtual();
+	btScalar distance = batchResult.m_distance - min0->getMarginNonVirtual() - marginB;
+	if ((distance < 0) || (distance * distance < input.m_maximumDistanceSquared))
+	{
+		output.addContactPoint(batchResult.m_normalOnB, batchResult.m_pointOnB + batchResult.m_normalOnB * marginB, distance);
+	}
+	return true;
+}
+
 //
 // Convex-Convex collision algorithm
 //
 void btConvexConvexAlgorithm ::processCollision(const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap, const btDispatcherInfo& dispatchInfo, btManifoldResult* resultOut)
+{
+	processCollisionInternal(body0Wrap, body1Wrap, dispatchInfo, resultOut, 0);
+}
+
+void btConvexConvexAlgorithm ::processCollisionBatched(const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap, const btDispatcherInfo& dispatchInfo, btManifoldResult* resultOut, const btGjkBatchResult* batchResult)
+{
+	//too far apart for new contacts, and without perturbation there is nothing else to compute
+	if (batchResult && batchResult->m_status == btGjkBatch::BT_GJK_BATCH_FAR && !m_numPerturbationIterations && m_manifoldPtr)
+	{
+		resultOut->setPersistentManifold(m_manifoldPtr);
+		if (m_ownManifold)
+		{
+			resultOut->refreshContactPoints();
+		}
+		return;
+	}
+	processCollisionInternal(body0Wrap, body1Wrap, dispatchInfo, resultOut, batchResult);
+}
+
+void btConvexConvexAlgorithm ::processCollisionInternal(const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap, const btDispatcherInfo& dispatchInfo, btManifoldResult* resultOut, const btGjkBatchResult* batchResult)
 {
 	if (!m_manifoldPtr)
 	{
@@ -366,6 +414,19 @@ void btConvexConvexAlgorithm ::processCollision(const btCollisionObjectWrapper*
 #endif  //USE_SEPDISTANCE_UTIL2
 
 	{
+		//the dispatcher can take the closest point query, to run it with btGjkBatch and call processCollisionBatched later.
+		//the separating axis test of polyhedra and 2d shapes do not use the closest points of GJK, they stay here
+		if (!batchResult && !min0->isConvex2d() && !min1->isConvex2d() &&
+			!(dispatchInfo.m_enableSatConvex && min0->isPolyhedral() && min1->isPolyhedral() &&
+			  ((btPolyhedralConvexShape*)min0)->getConvexPolyhedron() && ((btPolyhedralConvexShape*)min1)->getConvexPolyhedron()))
+		{
+			btScalar maximumDistance = min0->getMargin() + min1->getMargin() + m_manifoldPtr->getContactBreakingThreshold() + resultOut->m_closestPointDistanceThreshold;
+			if (m_dispatcher->deferConvexConvexPair(this, body0Wrap, body1Wrap, maximumDistance * maximumDistance))
+			{
+				return;
+			}
+		}
+
 		btGjkPairDetector::ClosestPointInput input;
 		btVoronoiSimplexSolver simplexSolver;
 		btGjkPairDetector gjkPairDetector(min0, min1, &simplexSolver, m_pdSolver);
@@ -501,7 +562,10 @@ void btConvexConvexAlgorithm ::processCollision(const btCollisionObjectWrapper*
 					gjkPairDetector.getClosestPoints(input, *resultOut, dispatchInfo.m_debugDraw);
 #else
 
-					gjkPairDetector.getClosestPoints(input, withoutMargin, dispatchInfo.m_debugDraw);
+					if (!batchResult || !btReportBatchedClosestPoints(*batchResult, min0, min1, gjkPairDetector, input, withoutMargin))
+					{
+						gjkPairDetector.getClosestPoints(input, withoutMargin, dispatchInfo.m_debugDraw);
+					}
 					//gjkPairDetector.getClosestPoints(input,dummy,dispatchInfo.m_debugDraw);
 #endif  //ZERO_MARGIN
 					//btScalar l2 = gjkPairDetector.getCachedSeparatingAxis().length2();
@@ -696,7 +760,10 @@ void btConvexConvexAlgorithm ::processCollision(const btCollisionObjectWrapper*
 			}
 		}
 
-		gjkPairDetector.getClosestPoints(input, *resultOut, dispatchInfo.m_debugDraw);
+		if (!batchResult || !btReportBatchedClosestPoints(*batchResult, min0, min1, gjkPairDetector, input, *resultOut))
+		{
+			gjkPairDetector.getClosestPoints(input, *resultOut, dispatchInfo.m_debugDraw);
+		}
 
 		//now perform 'm_numPerturbationIterations' collision queries with the perturbated collision objects
 
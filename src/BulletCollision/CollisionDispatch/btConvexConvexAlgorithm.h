@@ -27,6 +27,7 @@ subject to the following restrictions:
 #include "BulletCollision/NarrowPhaseCollision/btPolyhedralContactClipping.h"
 
 class btConvexPenetrationDepthSolver;
+struct btGjkBatchResult;
 
 ///Enabling USE_SEPDISTANCE_UTIL2 requires 100% reliable distance computation. However, when using large size ratios GJK can be imprecise
 ///so the distance is not conservative. In that case, enabling this USE_SEPDISTANCE_UTIL2 would result in failing/missing collisions.
@@ -57,6 +58,8 @@ class btConvexConvexAlgorithm : public btActivatingCollisionAlgorithm
 
 	///cache separating vector to speedup collision detection
 
+	void processCollisionInternal(const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap, const btDispatcherInfo& dispatchInfo, btManifoldResult* resultOut, const btGjkBatchResult* batchResult);
+
 public:
 	btConvexConvexAlgorithm(btPersistentManifold* mf, const btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap, btConvexPenetrationDepthSolver* pdSolver, int numPerturbationIterations, int minimumPointsPerturbationThreshold);
 
@@ -64,6 +67,10 @@ public:
 
 	virtual void processCollision(const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap, const btDispatcherInfo& dispatchInfo, btManifoldResult* resultOut);
 
+	///finishes a pair deferred with btDispatcher::deferConvexConvexPair, using the closest points computed by btGjkBatch.
+	///when batchResult is 0, or when its status is btGjkBatch::BT_GJK_BATCH_FAILED, the closest points are computed with btGjkPairDetector
+	void processCollisionBatched(const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap, const btDispatcherInfo& dispatchInfo, btManifoldResult* resultOut, const btGjkBatchResult* batchResult);
+
 	virtual btScalar calculateTimeOfImpact(btCollisionObject* body0, btCollisionObject* body1, const btDispatcherInfo& dispatchInfo, btManifoldResult* resultOut);
 
 	virtual void getAllContactManifolds(btManifoldArray& manifoldArray)
@@ -24,12 +24,19 @@ subject to the following restrictions:
 //#include <stdio.h>
 #include "LinearMath/btQuickprof.h"
 
-btSimulationIslandManager::btSimulationIslandManager() : m_splitIslands(true)
+btSimulationIslandManager::btSimulationIslandManager() : m_splitIslands(true),
+														   m_incrementalIslands(false),
+														   m_sleepingIslandTagOffset(0)
 {
 }
 
 btSimulationIslandManager::~btSimulationIslandManager()
 {
+	for (int i = 0; i < m_sleepingIslands.size(); ++i)
+	{
+		m_sleepingIslands[i]->~SleepingIsland();
+		btAlignedFree(m_sleepingIslands[i]);
+	}
 }
 
 void btSimulationIslandManager::initUnionFind(int n)
@@ -45,6 +52,8 @@ void btSimulationIslandManager::findUnions(btDispatcher* /* dispatcher */, btCol
 		if (numOverlappingPairs)
 		{
 			btBroadphasePair* pairPtr = pairCachePtr->getOverlappingPairArrayPtr();
+			// with incremental islands every awake body has its own tag, so two bodies with the same tag are in one sleeping island
+			const bool skipSleepingPairs = m_incrementalIslands;
 
 			for (int i = 0; i < numOverlappingPairs; i++)
 			{
@@ -55,6 +64,10 @@ void btSimulationIslandManager::findUnions(btDispatcher* /* dispatcher */, btCol
 				if (((colObj0) && ((colObj0)->mergesSimulationIslands())) &&
 					((colObj1) && ((colObj1)->mergesSimulationIslands())))
 				{
+					if (skipSleepingPairs && (colObj0->getIslandTag() == colObj1->getIslandTag()))
+					{
+						continue;
+					}
 					m_unionFind.unite((colObj0)->getIslandTag(),
 									  (colObj1)->getIslandTag());
 				}
@@ -66,6 +79,12 @@ void btSimulationIslandManager::findUnions(btDispatcher* /* dispatcher */, btCol
 #ifdef STATIC_SIMULATION_ISLAND_OPTIMIZATION
 void btSimulationIslandManager::updateActivationState(btCollisionWorld* colWorld, btDispatcher* dispatcher)
 {
+	if (m_incrementalIslands)
+	{
+		updateActivationStateIncremental(colWorld);
+		findUnions(dispatcher, colWorld);
+		return;
+	}
 	// put the index into m_controllers into m_tag
 	int index = 0;
 	{
@@ -91,6 +110,11 @@ void btSimulationIslandManager::updateActivationState(btCollisionWorld* colWorld
 
 void btSimulationIslandManager::storeIslandActivationState(btCollisionWorld* colWorld)
 {
+	if (m_incrementalIslands)
+	{
+		storeIslandActivationStateIncremental(colWorld);
+		return;
+	}
 	// put the islandId ('find' value) into m_tag
 	{
 		int index = 0;
@@ -164,6 +188,290 @@ void btSimulationIslandManager::storeIslandActivationState(btCollisionWorld* col
 
 #endif  //STATIC_SIMULATION_ISLAND_OPTIMIZATION
 
+void btSimulationIslandManager::setIncrementalIslands(bool incrementalIslands)
+{
+	if (incrementalIslands != m_incrementalIslands)
+	{
+		clearSleepingIslands();
+		m_incrementalIslands = incrementalIslands;
+	}
+}
+
+void btSimulationIslandManager::clearSleepingIslands()
+{
+	// keep the allocated islands for reuse
+	m_freeSleepingIslands.resize(0);
+	for (int i = m_sleepingIslands.size() - 1; i >= 0; --i)
+	{
+		m_sleepingIslands[i]->m_bodies.resize(0);
+		m_sleepingIslands[i]->m_worldIndices.resize(0);
+		m_freeSleepingIslands.push_back(i);
+	}
+	m_pendingSleepingIslands.resize(0);
+}
+
+void btSimulationIslandManager::addSleepingIsland(btCollisionObjectArray& collisionObjects, int startIslandIndex, int endIslandIndex)
+{
+	int islandId = getUnionFind().getElement(startIslandIndex).m_id;
+	int iSleepingIsland;
+	if (m_freeSleepingIslands.size())
+	{
+		iSleepingIsland = m_freeSleepingIslands[m_freeSleepingIslands.size() - 1];
+		m_freeSleepingIslands.pop_back();
+	}
+	else
+	{
+		iSleepingIsland = m_sleepingIslands.size();
+		m_sleepingIslands.push_back(new (btAlignedAlloc(sizeof(SleepingIsland), 16)) SleepingIsland());
+	}
+	SleepingIsland* island = m_sleepingIslands[iSleepingIsland];
+	for (int idx = startIslandIndex; idx < endIslandIndex; idx++)
+	{
+		int i = getUnionFind().getElement(idx).m_sz;
+		btCollisionObject* colObj0 = collisionObjects[i];
+		if (colObj0->getIslandTag() == islandId)
+		{
+			island->m_bodies.push_back(colObj0);
+			island->m_worldIndices.push_back(i);
+		}
+	}
+	if (island->m_bodies.size() == 0)
+	{
+		m_freeSleepingIslands.push_back(iSleepingIsland);
+		return;
+	}
+	// the manifolds and constraints of this step still use the island id, so the island tags are set by the next updateActivationState
+	m_pendingSleepingIslands.push_back(iSleepingIsland);
+}
+
+void btSimulationIslandManager::updateActivationStateIncremental(btCollisionWorld* colWorld)
+{
+	btCollisionObjectArray& collisionObjects = colWorld->getCollisionObjectArray();
+	int numObjects = collisionObjects.size();
+
+	// the tags of sleeping islands must stay above the union find elements of the awake bodies
+	if (numObjects > m_sleepingIslandTagOffset)
+	{
+		int tagOffset = 1024;
+		while (tagOffset < numObjects)
+		{
+			tagOffset *= 2;
+		}
+		clearSleepingIslands();
+		m_sleepingIslandTagOffset = tagOffset;
+	}
+	int tagOffset = m_sleepingIslandTagOffset;
+	int numSleepingIslands = m_sleepingIslands.size();
+
+	for (int iPending = 0; iPending < m_pendingSleepingIslands.size(); ++iPending)
+	{
+		int iSleepingIsland = m_pendingSleepingIslands[iPending];
+		SleepingIsland* island = m_sleepingIslands[iSleepingIsland];
+		int numBodies = 0;
+		for (int i = 0; i < island->m_bodies.size(); ++i)
+		{
+			btCollisionObject* colObj0 = island->m_bodies[i];
+			int iObj = island->m_worldIndices[i];
+			// skip bodies that were removed from the world since the island fell asleep
+			if (iObj < numObjects && collisionObjects[iObj] == colObj0)
+			{
+				colObj0->setIslandTag(tagOffset + iSleepingIsland);
+				island->m_bodies[numBodies] = colObj0;
+				island->m_worldIndices[numBodies] = iObj;
+				numBodies++;
+			}
+		}
+		island->m_bodies.resize(numBodies);
+		island->m_worldIndices.resize(numBodies);
+		if (numBodies == 0)
+		{
+			m_freeSleepingIslands.push_back(iSleepingIsland);
+		}
+	}
+	m_pendingSleepingIslands.resize(0);
+
+	for (int iSleepingIsland = 0; iSleepingIsland < numSleepingIslands; ++iSleepingIsland)
+	{
+		m_sleepingIslands[iSleepingIsland]->m_numFound = 0;
+		m_sleepingIslands[iSleepingIsland]->m_isWoken = false;
+	}
+
+	// give each awake body its own union find element, and count the bodies still asleep in each sleeping island
+	m_awakeObjects.resize(0);
+	for (int i = 0; i < numObjects; i++)
+	{
+		btCollisionObject* collisionObject = collisionObjects[i];
+		if (collisionObject->isStaticOrKinematicObject())
+		{
+			collisionObject->setIslandTag(-1);
+			collisionObject->setCompanionId(-2);
+			collisionObject->setHitFraction(btScalar(1.));
+			continue;
+		}
+		int iSleepingIsland = collisionObject->getIslandTag() - tagOffset;
+		if (iSleepingIsland >= 0 && iSleepingIsland < numSleepingIslands && m_sleepingIslands[iSleepingIsland]->m_bodies.size())
+		{
+			if (collisionObject->getActivationState() == ISLAND_SLEEPING)
+			{
+				m_sleepingIslands[iSleepingIsland]->m_numFound++;
+				continue;
+			}
+			// activated since the island fell asleep
+			m_sleepingIslands[iSleepingIsland]->m_isWoken = true;
+		}
+		collisionObject->setIslandTag(m_awakeObjects.size());
+		m_awakeObjects.push_back(i);
+	}
+
+	// the elements of the sleeping islands start at the tag offset, the elements in between are never used
+	int numAwake = m_awakeObjects.size();
+	m_unionFind.allocate(tagOffset + numSleepingIslands);
+	for (int i = 0; i < numAwake; i++)
+	{
+		m_unionFind.getElement(i).m_id = i;
+		m_unionFind.getElement(i).m_sz = 1;
+	}
+	for (int i = tagOffset; i < tagOffset + numSleepingIslands; i++)
+	{
+		m_unionFind.getElement(i).m_id = i;
+		m_unionFind.getElement(i).m_sz = 1;
+	}
+}
+
+void btSimulationIslandManager::storeIslandActivationStateIncremental(btCollisionWorld* colWorld)
+{
+	btCollisionObjectArray& collisionObjects = colWorld->getCollisionObjectArray();
+	int numObjects = collisionObjects.size();
+	int tagOffset = m_sleepingIslandTagOffset;
+	int numAwake = m_awakeObjects.size();
+	int numSleepingIslands = m_sleepingIslands.size();
+
+	// a sleeping island wakes up when one of its bodies was activated or removed,
+	for (int iSleepingIsland = 0; iSleepingIsland < numSleepingIslands; ++iSleepingIsland)
+	{
+		SleepingIsland* island = m_sleepingIslands[iSleepingIsland];
+		if (island->m_bodies.size() && island->m_numFound != island->m_bodies.size())
+		{
+			island->m_isWoken = true;
+		}
+	}
+	// or when it was merged with an awake body
+	m_islandRoots.resizeNoInitialize(numAwake);
+	for (int i = 0; i < numAwake; i++)
+	{
+		int root = m_unionFind.find(i);
+		m_islandRoots[i] = root;
+		if (root >= tagOffset)
+		{
+			m_sleepingIslands[root - tagOffset]->m_isWoken = true;
+		}
+	}
+	// or with a sleeping island that wakes up
+	for (int iSleepingIsland = 0; iSleepingIsland < numSleepingIslands; ++iSleepingIsland)
+	{
+		if (m_sleepingIslands[iSleepingIsland]->m_isWoken)
+		{
+			int root = m_unionFind.find(tagOffset + iSleepingIsland);
+			if (root >= tagOffset)
+			{
+				m_sleepingIslands[root - tagOffset]->m_isWoken = true;
+			}
+		}
+	}
+
+	// the bodies of woken islands get their own elements after the awake bodies
+	bool needsScan = false;
+	for (int iSleepingIsland = 0; iSleepingIsland < numSleepingIslands; ++iSleepingIsland)
+	{
+		SleepingIsland* island = m_sleepingIslands[iSleepingIsland];
+		if (island->m_bodies.size() == 0)
+		{
+			continue;
+		}
+		int root = m_unionFind.find(tagOffset + iSleepingIsland);
+		if (root < tagOffset || m_sleepingIslands[root - tagOffset]->m_isWoken)
+		{
+			int tag = tagOffset + iSleepingIsland;
+			int i;
+			for (i = 0; i < island->m_bodies.size(); ++i)
+			{
+				int iObj = island->m_worldIndices[i];
+				if (iObj >= numObjects || collisionObjects[iObj] != island->m_bodies[i])
+				{
+					break;
+				}
+			}
+			if (i < island->m_bodies.size())
+			{
+				// bodies were removed from the world, so the others may have moved in the collision object array
+				needsScan = true;
+				island->m_numFound = -1;
+				continue;
+			}
+			for (i = 0; i < island->m_bodies.size(); ++i)
+			{
+				// bodies that were activated already have an element
+				if (island->m_bodies[i]->getIslandTag() == tag)
+				{
+					m_awakeObjects.push_back(island->m_worldIndices[i]);
+					m_islandRoots.push_back(root);
+				}
+			}
+			island->m_bodies.resize(0);
+			island->m_worldIndices.resize(0);
+			m_freeSleepingIslands.push_back(iSleepingIsland);
+		}
+	}
+	if (needsScan)
+	{
+		for (int i = 0; i < numObjects; i++)
+		{
+			int iSleepingIsland = collisionObjects[i]->getIslandTag() - tagOffset;
+			if (iSleepingIsland >= 0 && iSleepingIsland < numSleepingIslands && m_sleepingIslands[iSleepingIsland]->m_numFound == -1)
+			{
+				m_awakeObjects.push_back(i);
+				m_islandRoots.push_back(m_unionFind.find(tagOffset + iSleepingIsland));
+			}
+		}
+		for (int iSleepingIsland = 0; iSleepingIsland < numSleepingIslands; ++iSleepingIsland)
+		{
+			SleepingIsland* island = m_sleepingIslands[iSleepingIsland];
+			if (island->m_numFound == -1)
+			{
+				island->m_bodies.resize(0);
+				island->m_worldIndices.resize(0);
+				m_freeSleepingIslands.push_back(iSleepingIsland);
+			}
+		}
+	}
+
+	// replace the union find by one of only the awake elements, and put the islandId into m_tag
+	int numElements = m_awakeObjects.size();
+	m_islandIds.resize(numAwake + numSleepingIslands);
+	for (int i = 0; i < m_islandIds.size(); i++)
+	{
+		m_islandIds[i] = -1;
+	}
+	m_unionFind.allocate(numElements);
+	for (int i = 0; i < numElements; i++)
+	{
+		int root = m_islandRoots[i];
+		int& islandId = m_islandIds[root < tagOffset ? root : numAwake + root - tagOffset];
+		if (islandId < 0)
+		{
+			islandId = i;
+		}
+		btElement& element = m_unionFind.getElement(i);
+		element.m_id = islandId;
+		//Set the correct object offset in Collision Object Array
+		element.m_sz = m_awakeObjects[i];
+		btCollisionObject* collisionObject = collisionObjects[m_awakeObjects[i]];
+		collisionObject->setIslandTag(islandId);
+		collisionObject->setCompanionId(-1);
+		collisionObject->setHitFraction(btScalar(1.));
+	}
+}
+
 inline int getIslandId(const btPersistentManifold* lhs)
 {
 	int islandId;
@@ -264,6 +572,10 @@ void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher, btCollisi
 					colObj0->setActivationState(ISLAND_SLEEPING);
 				}
 			}
+			if (m_incrementalIslands)
+			{
+				addSleepingIsland(collisionObjects, startIslandIndex, endIslandIndex);
+			}
 		}
 		else
 		{
@@ -27,6 +27,13 @@ class btDispatcher;
 class btPersistentManifold;
 
 ///SimulationIslandManager creates and handles simulation islands, using btUnionFind
+///
+///With setIncrementalIslands(true), islands that fall asleep are kept across steps. Each sleeping island takes a single
+///element of the union find, so its bodies, manifolds and constraints cost nothing in the island building until a body
+///wakes up, or an awake body or a constraint connects to the island. The island tags of its bodies are then
+///getSleepingIslandTagOffset() plus the index of the sleeping island, which is never the id of an awake island.
+///Sleeping objects are not moved, so with btCollisionWorld::setForceUpdateAllAabbs(false) they are skipped by
+///updateAabbs and stay in place in the broadphase as well.
 class btSimulationIslandManager
 {
 	btUnionFind m_unionFind;
@@ -36,6 +43,30 @@ class btSimulationIslandManager
 
 	bool m_splitIslands;
 
+	//the bodies of an island that fell asleep, kept by the incremental mode
+	struct SleepingIsland
+	{
+		btAlignedObjectArray<btCollisionObject*> m_bodies;
+		btAlignedObjectArray<int> m_worldIndices;  // index of each body in the collision object array
+		int m_numFound;                            // bodies found asleep by updateActivationState
+		bool m_isWoken;
+	};
+	bool m_incrementalIslands;
+	int m_sleepingIslandTagOffset;
+	btAlignedObjectArray<SleepingIsland*> m_sleepingIslands;  // a sleeping island is free when it has no bodies
+	btAlignedObjectArray<int> m_freeSleepingIslands;
+	btAlignedObjectArray<int> m_pendingSleepingIslands;  // fell asleep in the last buildIslands, the island tags are not set yet
+	btAlignedObjectArray<int> m_awakeObjects;            // collision object index per union find element
+	btAlignedObjectArray<int> m_islandRoots;
+	btAlignedObjectArray<int> m_islandIds;
+
+	void updateActivationStateIncremental(btCollisionWorld* colWorld);
+	void storeIslandActivationStateIncremental(btCollisionWorld* colWorld);
+	void clearSleepingIslands();
+
+protected:
+	void addSleepingIsland(btCollisionObjectArray& collisionObjects, int startIslandIndex, int endIslandIndex);
+
 public:
 	btSimulationIslandManager();
 	virtual ~btSimulationIslandManager();
@@ -47,7 +78,7 @@ public:
 	virtual void updateActivationState(btCollisionWorld* colWorld, btDispatcher* dispatcher);
 	virtual void storeIslandActivationState(btCollisionWorld* world);
 
-	void findUnions(btDispatcher* dispatcher, btCollisionWorld* colWorld);
+	virtual void findUnions(btDispatcher* dispatcher, btCollisionWorld* colWorld);
 
 	struct IslandCallback
 	{
@@ -70,6 +101,22 @@ public:
 	{
 		m_splitIslands = doSplitIslands;
 	}
+
+	bool getIncrementalIslands() const
+	{
+		return m_incrementalIslands;
+	}
+	void setIncrementalIslands(bool incrementalIslands);
+
+	int getSleepingIslandTagOffset() const
+	{
+		return m_sleepingIslandTagOffset;
+	}
+	// sleeping islands kept by the incremental mode
+	int getNumSleepingIslands() const
+	{
+		return m_sleepingIslands.size() - m_freeSleepingIslands.size();
+	}
 };
 
 #endif  //BT_SIMULATION_ISLAND_MANAGER_H
@@ -0,0 +1,477 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btSweptSphereBatch.h"
+#include "btCollisionWorld.h"
+#include "btCollisionDispatcher.h"
+#include "BulletCollision/CollisionShapes/btSphereShape.h"
+#include "BulletCollision/CollisionShapes/btCapsuleShape.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
+
+//the loops below run on the calling thread when no task scheduler is set
+static void btSweepParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+{
+#if BT_THREADSAFE
+	if (btGetTaskScheduler())
+	{
+		btParallelFor(iBegin, iEnd, grainSize, body);
+		return;
+	}
+#endif
+	body.forLoop(iBegin, iEnd);
+}
+
+enum
+{
+	BT_SWEEP_OBJECT_CHUNK = 256  // collision objects per candidate finding task
+};
+
+//sweeps a point against a sphere. returns false when the point moves away from the sphere or misses it
+static bool btSweepPointSphere(const btVector3& from, const btVector3& motion, const btVector3& center, btScalar radius, btScalar& fraction, btVector3& normal)
+{
+	const btVector3 rel = from - center;
+	const btScalar c = rel.length2() - radius * radius;
+	if (c <= btScalar(0.))
+	{
+		//starts inside, the normal check of the caller decides if this is a hit
+		fraction = btScalar(0.);
+		normal = rel.length2() > SIMD_EPSILON ? rel.normalized() : -motion.normalized();
+		return true;
+	}
+	const btScalar b = rel.dot(motion);
+	if (b >= btScalar(0.))
+	{
+		return false;
+	}
+	const btScalar a = motion.length2();
+	const btScalar discriminant = b * b - a * c;
+	if (discriminant < btScalar(0.))
+	{
+		return false;
+	}
+	const btScalar t = (-b - btSqrt(discriminant)) / a;
+	if (t > btScalar(1.))
+	{
+		return false;
+	}
+	fraction = t;
+	normal = (rel + motion * t).normalized();
+	return true;
+}
+
+//sweeps a point against a capsule, as the union of the cylinder between the end spheres and the two end spheres
+static bool btSweepPointCapsule(const btVector3& from, const btVector3& motion, const btVector3& center, const btVector3& axis, btScalar halfHeight, btScalar radius, btScalar& fraction, btVector3& normal)
+{
+	const btVector3 rel = from - center;
+	const btScalar fromAxial = rel.dot(axis);
+	const btVector3 closest = axis * btClamped(fromAxial, -halfHeight, halfHeight);
+	if ((rel - closest).length2() <= radius * radius)
+	{
+		fraction = btScalar(0.);
+		const btVector3 dir = rel - closest;
+		normal = dir.length2() > SIMD_EPSILON ? dir.normalized() : -motion.normalized();
+		return true;
+	}
+
+	bool hit = false;
+	fraction = BT_LARGE_FLOAT;
+	const btVector3 radial = rel - axis * fromAxial;
+	const btVector3 radialMotion = motion - axis * motion.dot(axis);
+	const btScalar a = radialMotion.length2();
+	const btScalar b = radial.dot(radialMotion);
+	const btScalar c = radial.length2() - radius * radius;
+	if (a > SIMD_EPSILON && b < btScalar(0.) && c > btScalar(0.))
+	{
+		const btScalar discriminant = b * b - a * c;
+		if (discriminant >= btScalar(0.))
+		{
+			const btScalar t = (-b - btSqrt(discriminant)) / a;
+			if (t <= btScalar(1.) && btFabs(fromAxial + motion.dot(axis) * t) <= halfHeight)
+			{
+				hit = true;
+				fraction = t;
+				normal = (radial + radialMotion * t).normalized();
+			}
+		}
+	}
+	for (int end = 0; end < 2; ++end)
+	{
+		const btVector3 endCenter = center + axis * (end ? halfHeight : -halfHeight);
+		btScalar endFraction;
+		btVector3 endNormal;
+		if (btSweepPointSphere(from, motion, endCenter, radius, endFraction, endNormal) && endFraction < fraction)
+		{
+			hit = true;
+			fraction = endFraction;
+			normal = endNormal;
+		}
+	}
+	return hit;
+}
+
+//same filter as btClosestNotMeConvexResultCallback::addSingleResult, for the shapes without an analytic sweep
+struct btSweptSphereResultCallback : public btCollisionWorld::ConvexResultCallback
+{
+	btVector3 m_motion;
+	btScalar m_allowedPenetration;
+	btVector3 m_hitNormalWorld;
+	btVector3 m_hitPointWorld;
+
+	virtual btScalar addSingleResult(btCollisionWorld::LocalConvexResult& convexResult, bool normalInWorldSpace)
+	{
+		//ignore result if there is no contact response
+		if (!convexResult.m_hitCollisionObject->hasContactResponse())
+			return 1.f;
+
+		//don't report time of impact for motion away from the contact normal (or causes minor penetration)
+		if (convexResult.m_hitNormalLocal.dot(m_motion) >= -m_allowedPenetration)
+			return 1.f;
+
+		m_closestHitFraction = convexResult.m_hitFraction;
+		if (normalInWorldSpace)
+		{
+			m_hitNormalWorld = convexResult.m_hitNormalLocal;
+		}
+		else
+		{
+			m_hitNormalWorld = convexResult.m_hitCollisionObject->getWorldTransform().getBasis() * convexResult.m_hitNormalLocal;
+		}
+		m_hitPointWorld = convexResult.m_hitPointLocal;
+		return convexResult.m_hitFraction;
+	}
+};
+
+struct btSweptSphereCandidateLoop : public btIParallelForBody
+{
+	struct Collector : public btDbvt::ICollide
+	{
+		const btSweptSphere* m_sweeps;
+		btCollisionObject* m_collisionObject;
+		btBroadphaseProxy* m_proxy;
+		int m_objectIndex;
+		btOverlappingPairCache* m_pairCache;
+		btDispatcher* m_dispatcher;
+		btAlignedObjectArray<int>* m_pairs;
+
+		void Process(const btDbvtNode* leaf)
+		{
+			const int sweepIndex = leaf->dataAsInt;
+			const btSweptSphere& sweep = m_sweeps[sweepIndex];
+			btCollisionObject* me = sweep.m_collisionObject;
+			if (m_collisionObject == me)
+				return;
+			if (!((m_proxy->m_collisionFilterGroup & sweep.m_collisionFilterMask) && (sweep.m_collisionFilterGroup & m_proxy->m_collisionFilterMask)))
+				return;
+			if (m_pairCache->getOverlapFilterCallback() && !m_pairCache->needsBroadphaseCollision(m_proxy, me->getBroadphaseHandle()))
+				return;
+			if (!m_dispatcher->needsCollision(me, m_collisionObject) || !m_dispatcher->needsResponse(me, m_collisionObject))
+				return;
+			m_pairs->push_back(sweepIndex);
+			m_pairs->push_back(m_objectIndex);
+		}
+	};
+
+	const btDbvtWide* m_tree;
+	const btSweptSphere* m_sweeps;
+	btCollisionObject* const* m_objects;
+	int m_numObjects;
+	btOverlappingPairCache* m_pairCache;
+	btDispatcher* m_dispatcher;
+	btAlignedObjectArray<btAlignedObjectArray<int> >* m_taskPairs;
+	btAlignedObjectArray<btAlignedObjectArray<int> >* m_taskStacks;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		Collector collector;
+		collector.m_sweeps = m_sweeps;
+		collector.m_pairCache = m_pairCache;
+		collector.m_dispatcher = m_dispatcher;
+		for (int task = iBegin; task < iEnd; ++task)
+		{
+			btAlignedObjectArray<int>& pairs = (*m_taskPairs)[task];
+			btAlignedObjectArray<int>& stack = (*m_taskStacks)[task];
+			pairs.resize(0);
+			collector.m_pairs = &pairs;
+			const int end = btMin(m_numObjects, (task + 1) * BT_SWEEP_OBJECT_CHUNK);
+			for (int i = task * BT_SWEEP_OBJECT_CHUNK; i < end; ++i)
+			{
+				btCollisionObject* collisionObject = m_objects[i];
+				btBroadphaseProxy* proxy = collisionObject->getBroadphaseHandle();
+				if (proxy == 0 || !collisionObject->hasContactResponse())
+					continue;
+				collector.m_collisionObject = collisionObject;
+				collector.m_proxy = proxy;
+				collector.m_objectIndex = i;
+				m_tree->collideTVNoStackAlloc(btDbvtVolume::FromMM(proxy->m_aabbMin, proxy->m_aabbMax), stack, collector);
+			}
+		}
+	}
+};
+
+struct btSweptSphereImpactLoop : public btIParallelForBody
+{
+	const btSweptSphere* m_sweeps;
+	const int* m_pairSweeps;
+	const int* m_pairObjects;
+	btCollisionObject* const* m_objects;
+	btScalar m_allowedPenetration;
+	btSweptSphereHit* m_hits;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int k = iBegin; k < iEnd; ++k)
+		{
+			const btSweptSphere& sweep = m_sweeps[m_pairSweeps[k]];
+			btCollisionObject* collisionObject = m_objects[m_pairObjects[k]];
+			const btCollisionShape* shape = collisionObject->getCollisionShape();
+			const btTransform& transform = collisionObject->getWorldTransform();
+			const btVector3 motion = sweep.m_to - sweep.m_from;
+
+			btScalar fraction = btScalar(1.);
+			btVector3 normal(0, 0, 0);
+			btVector3 point(0, 0, 0);
+			bool analytic = true;
+			bool hit = false;
+			switch (shape->getShapeType())
+			{
+				case SPHERE_SHAPE_PROXYTYPE:
+				{
+					const btSphereShape* sphere = static_cast<const btSphereShape*>(shape);
+					hit = btSweepPointSphere(sweep.m_from, motion, transform.getOrigin(), sweep.m_radius + sphere->getRadius(), fraction, normal);
+					break;
+				}
+				case CAPSULE_SHAPE_PROXYTYPE:
+				{
+					const btCapsuleShape* capsule = static_cast<const btCapsuleShape*>(shape);
+					hit = btSweepPointCapsule(sweep.m_from, motion, transform.getOrigin(), transform.getBasis().getColumn(capsule->getUpAxis()),
+											  capsule->getHalfHeight(), sweep.m_radius + capsule->getRadius(), fraction, normal);
+					break;
+				}
+				default:
+					analytic = false;
+			}
+
+			if (analytic)
+			{
+				//don't report time of impact for motion away from the contact normal (or causes minor penetration)
+				if (hit && normal.dot(motion) < -m_allowedPenetration)
+				{
+					point = sweep.m_from + motion * fraction - normal * sweep.m_radius;
+				}
+				else
+				{
+					fraction = btScalar(1.);
+				}
+			}
+			else
+			{
+				btSphereShape castShape(sweep.m_radius);
+				btTransform from, to;
+				from.setIdentity();
+				from.setOrigin(sweep.m_from);
+				to.setIdentity();
+				to.setOrigin(sweep.m_to);
+				btSweptSphereResultCallback callback;
+				callback.m_motion = motion;
+				callback.m_allowedPenetration = m_allowedPenetration;
+				btCollisionWorld::objectQuerySingle(&castShape, from, to, collisionObject, shape, transform, callback, btScalar(0.));
+				if (callback.hasHit())
+				{
+					fraction = callback.m_closestHitFraction;
+					normal = callback.m_hitNormalWorld;
+					point = callback.m_hitPointWorld;
+				}
+			}
+
+			btSweptSphereHit& result = m_hits[k];
+			result.m_hitNormalWorld = normal;
+			result.m_hitPointWorld = point;
+			result.m_hitCollisionObject = collisionObject;
+			result.m_hitFraction = fraction;
+		}
+	}
+};
+
+struct btSweptSphereReduceLoop : public btIParallelForBody
+{
+	const int* m_pairStart;
+	const btSweptSphereHit* m_pairHits;
+	btSweptSphereHit* m_hits;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btSweptSphereHit& hit = m_hits[i];
+			hit.m_hitCollisionObject = 0;
+			hit.m_hitFraction = btScalar(1.);
+			//the candidates of a sweep are in world array order, so the first of equal hits wins for any thread count
+			for (int k = m_pairStart[i]; k < m_pairStart[i + 1]; ++k)
+			{
+				if (m_pairHits[k].m_hitFraction < hit.m_hitFraction)
+				{
+					hit = m_pairHits[k];
+				}
+			}
+		}
+	}
+};
+
+btSweptSphereBatch::btSweptSphereBatch()
+{
+}
+
+btSweptSphereBatch::~btSweptSphereBatch()
+{
+	m_tree.clear();
+}
+
+void btSweptSphereBatch::reset(int numCollisionObjects)
+{
+	m_sweeps.resize(0);
+	m_sweepIndices.resize(0);
+	m_sweepIndices.resize(numCollisionObjects, -1);
+}
+
+void btSweptSphereBatch::addSweep(btCollisionObject* collisionObject, const btVector3& to, btScalar radius)
+{
+	btAssert(collisionObject->getWorldArrayIndex() >= 0 && collisionObject->getWorldArrayIndex() < m_sweepIndices.size());
+	m_sweepIndices[collisionObject->getWorldArrayIndex()] = m_sweeps.size();
+	btSweptSphere& sweep = m_sweeps.expandNonInitializing();
+	sweep.m_from = collisionObject->getWorldTransform().getOrigin();
+	sweep.m_to = to;
+	sweep.m_radius = radius;
+	sweep.m_collisionObject = collisionObject;
+	sweep.m_collisionFilterGroup = collisionObject->getBroadphaseHandle()->m_collisionFilterGroup;
+	sweep.m_collisionFilterMask = collisionObject->getBroadphaseHandle()->m_collisionFilterMask;
+}
+
+int btSweptSphereBatch::findSweep(const btCollisionObject* collisionObject) const
+{
+	const int index = collisionObject->getWorldArrayIndex();
+	if (index >= 0 && index < m_sweepIndices.size())
+	{
+		return m_sweepIndices[index];
+	}
+	return -1;
+}
+
+void btSweptSphereBatch::findCandidates(btCollisionWorld* world)
+{
+	BT_PROFILE("findCandidates");
+	const int numSweeps = m_sweeps.size();
+	m_tree.clear();
+	for (int i = 0; i < numSweeps; ++i)
+	{
+		const btSweptSphere& sweep = m_sweeps[i];
+		const btVector3 extents(sweep.m_radius, sweep.m_radius, sweep.m_radius);
+		btVector3 aabbMin = sweep.m_from;
+		btVector3 aabbMax = sweep.m_from;
+		aabbMin.setMin(sweep.m_to);
+		aabbMax.setMax(sweep.m_to);
+		btDbvtNode* leaf = m_tree.insert(btDbvtVolume::FromMM(aabbMin - extents, aabbMax + extents), 0);
+		leaf->dataAsInt = i;
+	}
+	m_wideTree.build(m_tree.m_root);
+
+	btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	const int numObjects = objects.size();
+	const int numTasks = (numObjects + BT_SWEEP_OBJECT_CHUNK - 1) / BT_SWEEP_OBJECT_CHUNK;
+	if (m_taskPairs.size() < numTasks)
+	{
+		m_taskPairs.resize(numTasks);
+		m_taskStacks.resize(numTasks);
+	}
+	btSweptSphereCandidateLoop candidates;
+	candidates.m_tree = &m_wideTree;
+	candidates.m_sweeps = &m_sweeps[0];
+	candidates.m_objects = numObjects ? &objects[0] : 0;
+	candidates.m_numObjects = numObjects;
+	candidates.m_pairCache = world->getBroadphase()->getOverlappingPairCache();
+	candidates.m_dispatcher = world->getDispatcher();
+	candidates.m_taskPairs = &m_taskPairs;
+	candidates.m_taskStacks = &m_taskStacks;
+	btSweepParallelFor(0, numTasks, 1, candidates);
+
+	//group the candidates by sweep with a stable counting sort, they stay in world array order within a sweep
+	m_pairStart.resize(0);
+	m_pairStart.resize(numSweeps + 1, 0);
+	for (int task = 0; task < numTasks; ++task)
+	{
+		const btAlignedObjectArray<int>& pairs = m_taskPairs[task];
+		for (int k = 0; k < pairs.size(); k += 2)
+		{
+			m_pairStart[pairs[k] + 1]++;
+		}
+	}
+	for (int i = 0; i < numSweeps; ++i)
+	{
+		m_pairStart[i + 1] += m_pairStart[i];
+	}
+	const int numPairs = m_pairStart[numSweeps];
+	m_pairSweeps.resizeNoInitialize(numPairs);
+	m_pairObjects.resizeNoInitialize(numPairs);
+	for (int task = 0; task < numTasks; ++task)
+	{
+		const btAlignedObjectArray<int>& pairs = m_taskPairs[task];
+		for (int k = 0; k < pairs.size(); k += 2)
+		{
+			const int pair = m_pairStart[pairs[k]]++;
+			m_pairSweeps[pair] = pairs[k];
+			m_pairObjects[pair] = pairs[k + 1];
+		}
+	}
+	//the scatter moved every start to the next sweep
+	for (int i = numSweeps; i > 0; --i)
+	{
+		m_pairStart[i] = m_pairStart[i - 1];
+	}
+	m_pairStart[0] = 0;
+}
+
+void btSweptSphereBatch::sweep(btCollisionWorld* world, btScalar allowedPenetration)
+{
+	BT_PROFILE("btSweptSphereBatch::sweep");
+	const int numSweeps = m_sweeps.size();
+	m_hits.resizeNoInitialize(numSweeps);
+	if (numSweeps == 0)
+	{
+		return;
+	}
+
+	findCandidates(world);
+
+	const int numPairs = m_pairSweeps.size();
+	m_pairHits.resizeNoInitialize(numPairs);
+	if (numPairs)
+	{
+		BT_PROFILE("timeOfImpact");
+		btSweptSphereImpactLoop impact;
+		impact.m_sweeps = &m_sweeps[0];
+		impact.m_pairSweeps = &m_pairSweeps[0];
+		impact.m_pairObjects = &m_pairObjects[0];
+		impact.m_objects = &world->getCollisionObjectArray()[0];
+		impact.m_allowedPenetration = allowedPenetration;
+		impact.m_hits = &m_pairHits[0];
+		btSweepParallelFor(0, numPairs, 16, impact);
+	}
+
+	btSweptSphereReduceLoop reduce;
+	reduce.m_pairStart = &m_pairStart[0];
+	reduce.m_pairHits = numPairs ? &m_pairHits[0] : 0;
+	reduce.m_hits = &m_hits[0];
+	btSweepParallelFor(0, numSweeps, 256, reduce);
+}
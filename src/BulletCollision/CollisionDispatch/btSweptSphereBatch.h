@@ -0,0 +1,100 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SWEPT_SPHERE_BATCH_H
+#define BT_SWEPT_SPHERE_BATCH_H
+
+#include "BulletCollision/BroadphaseCollision/btDbvt.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+class btCollisionObject;
+class btCollisionWorld;
+
+ATTRIBUTE_ALIGNED16(struct)
+btSweptSphere
+{
+	btVector3 m_from;
+	btVector3 m_to;
+	btScalar m_radius;
+	btCollisionObject* m_collisionObject;  // the swept object, it is never hit by its own sweep
+	int m_collisionFilterGroup;
+	int m_collisionFilterMask;
+};
+
+///the closest hit of a btSweptSphere, m_hitFraction is 1 when nothing was hit
+ATTRIBUTE_ALIGNED16(struct)
+btSweptSphereHit
+{
+	btVector3 m_hitNormalWorld;  // points from the hit object towards the sphere
+	btVector3 m_hitPointWorld;
+	const btCollisionObject* m_hitCollisionObject;
+	btScalar m_hitFraction;
+};
+
+///The btSweptSphereBatch sweeps many spheres through a btCollisionWorld at once. btDiscreteDynamicsWorld uses it for batched continuous collision detection.
+///The swept bounds of all spheres are put in a 4-wide btDbvtWide, and every collision object is tested against it once, instead of a broadphase query per sphere.
+///Sphere and capsule candidates get an analytic time of impact, the other shapes go through btCollisionWorld::objectQuerySingle like btCollisionWorld::convexSweepTest.
+///The candidates, the times of impact and the closest hit per sphere are computed with btParallelFor when a task scheduler is set.
+///Equal hit fractions are resolved by the world array index of the hit object, so the hits do not depend on the number of threads.
+class btSweptSphereBatch
+{
+protected:
+	btAlignedObjectArray<btSweptSphere> m_sweeps;
+	btAlignedObjectArray<btSweptSphereHit> m_hits;
+	btAlignedObjectArray<int> m_sweepIndices;  // sweep index per world array index, -1 for objects without a sweep
+	btDbvt m_tree;                             // swept bounds, the leaves store the sweep index
+	btDbvtWide m_wideTree;
+	btAlignedObjectArray<btAlignedObjectArray<int> > m_taskPairs;  // sweep and world array index per candidate, per task
+	btAlignedObjectArray<btAlignedObjectArray<int> > m_taskStacks;
+	btAlignedObjectArray<int> m_pairSweeps;   // sweep index per candidate, the candidates are grouped by sweep
+	btAlignedObjectArray<int> m_pairObjects;  // world array index per candidate
+	btAlignedObjectArray<int> m_pairStart;    // first candidate of each sweep, and the total at the end
+	btAlignedObjectArray<btSweptSphereHit> m_pairHits;
+
+	void findCandidates(btCollisionWorld* world);
+
+public:
+	btSweptSphereBatch();
+	~btSweptSphereBatch();
+
+	///removes all sweeps, numCollisionObjects is the number of objects in the world that will be swept against
+	void reset(int numCollisionObjects);
+
+	///adds a sweep of a sphere from the origin of the object to 'to', using the collision filter of its broadphase proxy
+	void addSweep(btCollisionObject* collisionObject, const btVector3& to, btScalar radius);
+
+	///computes the closest hit of every sweep.
+	///like btClosestNotMeConvexResultCallback, hits are ignored when the sphere does not move into the hit normal by more than allowedPenetration,
+	///or when the objects do not need a collision response
+	void sweep(btCollisionWorld* world, btScalar allowedPenetration);
+
+	int getNumSweeps() const
+	{
+		return m_sweeps.size();
+	}
+	const btSweptSphere& getSweep(int index) const
+	{
+		return m_sweeps[index];
+	}
+	const btSweptSphereHit& getHit(int index) const
+	{
+		return m_hits[index];
+	}
+
+	///returns the index of the sweep of a collision object, or -1 when it has none
+	int findSweep(const btCollisionObject* collisionObject) const;
+};
+
+#endif  //BT_SWEPT_SPHERE_BATCH_H
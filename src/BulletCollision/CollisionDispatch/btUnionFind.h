@@ -17,6 +17,7 @@ subject to the following restrictions:
 #define BT_UNION_FIND_H
 
 #include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
 
 #define USE_PATH_COMPRESSION 1
 
@@ -118,6 +119,46 @@ public:
 		}
 		return x;
 	}
+
+	//findConcurrent and uniteConcurrent can be called from several threads at the same time, but not together with find and unite.
+	//uniteConcurrent links the root with the larger index to the other root, so the sets do not depend on the order of the unions.
+	int findConcurrent(int x)
+	{
+		while (true)
+		{
+			int parent = *static_cast<int volatile*>(&m_elements[x].m_id);
+			if (parent == x)
+			{
+				return x;
+			}
+			int grandParent = *static_cast<int volatile*>(&m_elements[parent].m_id);
+			if (grandParent != parent)
+			{
+				//path halving, skipped if another thread changed the link in the meantime
+				btAtomicCompareExchange(&m_elements[x].m_id, parent, grandParent);
+			}
+			x = grandParent;
+		}
+	}
+
+	void uniteConcurrent(int p, int q)
+	{
+		while (true)
+		{
+			int i = findConcurrent(p), j = findConcurrent(q);
+			if (i == j)
+				return;
+			if (i < j)
+			{
+				btSwap(i, j);
+			}
+			//fails if another thread linked the root i first, then try again from the new roots
+			if (btAtomicCompareExchange(&m_elements[i].m_id, i, j) == i)
+				return;
+			p = i;
+			q = j;
+		}
+	}
 };
 
 #endif  //BT_UNION_FIND_H
@@ -17,7 +17,10 @@ subject to the following restrictions:
 
 #include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
 #include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
 
 ///Bvh Concave triangle mesh is a static-triangle mesh shape with Bounding Volume Hierarchy optimization.
 ///Uses an interface to access the triangles to allow for sharing graphics/physics triangles.
@@ -161,6 +164,291 @@ void btBvhTriangleMeshShape::performRaycast(btTriangleCallback* callback, const
 	m_bvh->reportRayOverlappingNodex(&myNodeCallback, raySource, rayTarget);
 }
 
+//Moller-Trumbore test of one triangle against 4 rays stored axis by axis, stride scalars apart.
+//returns bit i set when ray i hits the triangle for a parameter in (0,lambda[i]), writes the parameters to hitFraction
+//and sets bit i of backfaces when ray i starts behind the triangle. u, v and 1-u-v may be down to -edgeTolerance, so a ray
+//through a shared edge hits one of the triangles, but hits that close to an edge can differ from btTriangleRaycastCallback
+static unsigned btRayTrianglePacket4(const btScalar* rayFrom, const btScalar* rayDir, int stride, const btScalar* lambda,
+									 const btVector3* triangle, bool filterBackfaces, btScalar* hitFraction, unsigned& backfaces)
+{
+	const btVector3 e1 = triangle[1] - triangle[0];
+	const btVector3 e2 = triangle[2] - triangle[0];
+	const btScalar edgeTolerance = btScalar(0.0001);
+#if defined(BT_USE_SSE)
+	const __m128 dx = _mm_load_ps(rayDir);
+	const __m128 dy = _mm_load_ps(rayDir + stride);
+	const __m128 dz = _mm_load_ps(rayDir + 2 * stride);
+	const __m128 sx = _mm_sub_ps(_mm_load_ps(rayFrom), _mm_set1_ps(triangle[0][0]));
+	const __m128 sy = _mm_sub_ps(_mm_load_ps(rayFrom + stride), _mm_set1_ps(triangle[0][1]));
+	const __m128 sz = _mm_sub_ps(_mm_load_ps(rayFrom + 2 * stride), _mm_set1_ps(triangle[0][2]));
+	const __m128 e1x = _mm_set1_ps(e1[0]), e1y = _mm_set1_ps(e1[1]), e1z = _mm_set1_ps(e1[2]);
+	const __m128 e2x = _mm_set1_ps(e2[0]), e2y = _mm_set1_ps(e2[1]), e2z = _mm_set1_ps(e2[2]);
+	//p = d x e2, q = s x e1
+	const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+	const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+	const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+	const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+	const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+	const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+	const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.f), det);
+	const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+	const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+	const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 tolerance = _mm_set1_ps(-edgeTolerance);
+	__m128 hit = filterBackfaces ? _mm_cmpgt_ps(det, zero) : _mm_cmpneq_ps(det, zero);
+	hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(u, tolerance), _mm_cmpge_ps(v, tolerance)));
+	hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.f + edgeTolerance)));
+	hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, _mm_load_ps(lambda))));
+	_mm_store_ps(hitFraction, t);
+	backfaces = unsigned(_mm_movemask_ps(_mm_cmplt_ps(det, zero)));
+	return unsigned(_mm_movemask_ps(hit));
+#elif defined(BT_USE_NEON)
+	static const uint32_t bits[4] = {1, 2, 4, 8};
+	const float32x4_t dx = vld1q_f32(rayDir);
+	const float32x4_t dy = vld1q_f32(rayDir + stride);
+	const float32x4_t dz = vld1q_f32(rayDir + 2 * stride);
+	const float32x4_t sx = vsubq_f32(vld1q_f32(rayFrom), vdupq_n_f32(triangle[0][0]));
+	const float32x4_t sy = vsubq_f32(vld1q_f32(rayFrom + stride), vdupq_n_f32(triangle[0][1]));
+	const float32x4_t sz = vsubq_f32(vld1q_f32(rayFrom + 2 * stride), vdupq_n_f32(triangle[0][2]));
+	const float32x4_t e1x = vdupq_n_f32(e1[0]), e1y = vdupq_n_f32(e1[1]), e1z = vdupq_n_f32(e1[2]);
+	const float32x4_t e2x = vdupq_n_f32(e2[0]), e2y = vdupq_n_f32(e2[1]), e2z = vdupq_n_f32(e2[2]);
+	//p = d x e2, q = s x e1
+	const float32x4_t px = vmlsq_f32(vmulq_f32(dy, e2z), dz, e2y);
+	const float32x4_t py = vmlsq_f32(vmulq_f32(dz, e2x), dx, e2z);
+	const float32x4_t pz = vmlsq_f32(vmulq_f32(dx, e2y), dy, e2x);
+	const float32x4_t qx = vmlsq_f32(vmulq_f32(sy, e1z), sz, e1y);
+	const float32x4_t qy = vmlsq_f32(vmulq_f32(sz, e1x), sx, e1z);
+	const float32x4_t qz = vmlsq_f32(vmulq_f32(sx, e1y), sy, e1x);
+	const float32x4_t det = vmlaq_f32(vmlaq_f32(vmulq_f32(e1x, px), e1y, py), e1z, pz);
+	//reciprocal estimate refined with two Newton-Raphson steps
+	float32x4_t invDet = vrecpeq_f32(det);
+	invDet = vmulq_f32(vrecpsq_f32(det, invDet), invDet);
+	invDet = vmulq_f32(vrecpsq_f32(det, invDet), invDet);
+	const float32x4_t u = vmulq_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(sx, px), sy, py), sz, pz), invDet);
+	const float32x4_t v = vmulq_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(dx, qx), dy, qy), dz, qz), invDet);
+	const float32x4_t t = vmulq_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(e2x, qx), e2y, qy), e2z, qz), invDet);
+	const float32x4_t zero = vdupq_n_f32(0);
+	const float32x4_t tolerance = vdupq_n_f32(-edgeTolerance);
+	uint32x4_t hit = filterBackfaces ? vcgtq_f32(det, zero) : vmvnq_u32(vceqq_f32(det, zero));
+	hit = vandq_u32(hit, vandq_u32(vcgeq_f32(u, tolerance), vcgeq_f32(v, tolerance)));
+	hit = vandq_u32(hit, vcleq_f32(vaddq_f32(u, v), vdupq_n_f32(1.f + edgeTolerance)));
+	hit = vandq_u32(hit, vandq_u32(vcgtq_f32(t, zero), vcltq_f32(t, vld1q_f32(lambda))));
+	vst1q_f32(hitFraction, t);
+	const uint32x4_t back = vandq_u32(vcltq_f32(det, zero), vld1q_u32(bits));
+	const uint32x2_t bs = vorr_u32(vget_low_u32(back), vget_high_u32(back));
+	backfaces = unsigned(vget_lane_u32(bs, 0) | vget_lane_u32(bs, 1));
+	hit = vandq_u32(hit, vld1q_u32(bits));
+	const uint32x2_t hs = vorr_u32(vget_low_u32(hit), vget_high_u32(hit));
+	return unsigned(vget_lane_u32(hs, 0) | vget_lane_u32(hs, 1));
+#else
+	unsigned mask = 0;
+	backfaces = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		const btVector3 d(rayDir[i], rayDir[stride + i], rayDir[2 * stride + i]);
+		const btVector3 s = btVector3(rayFrom[i], rayFrom[stride + i], rayFrom[2 * stride + i]) - triangle[0];
+		const btVector3 p = d.cross(e2);
+		const btVector3 q = s.cross(e1);
+		const btScalar det = e1.dot(p);
+		hitFraction[i] = btScalar(0.);
+		if (det < btScalar(0.))
+		{
+			backfaces |= 1u << i;
+		}
+		if (filterBackfaces ? (det <= btScalar(0.)) : (det == btScalar(0.)))
+		{
+			continue;
+		}
+		const btScalar invDet = btScalar(1.) / det;
+		const btScalar u = s.dot(p) * invDet;
+		const btScalar v = d.dot(q) * invDet;
+		const btScalar t = e2.dot(q) * invDet;
+		hitFraction[i] = t;
+		if ((u >= -edgeTolerance) && (v >= -edgeTolerance) && (u + v <= btScalar(1.) + edgeTolerance) &&
+			(t > btScalar(0.)) && (t < lambda[i]))
+		{
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+#endif
+}
+
+///intersects the triangles of the leaf nodes hit by a packet of rays, keeping the closest hit of each ray
+struct btTriangleRayPacketCallback : public btNodeRayPacketOverlapCallback
+{
+	const btStridingMeshInterface* m_meshInterface;
+	btTriangleRayHit* m_hits;
+	unsigned int m_flags;
+	int m_numGroups;
+	ATTRIBUTE_ALIGNED16(btScalar m_rayFrom[3 * MAX_RAYS]);
+	ATTRIBUTE_ALIGNED16(btScalar m_rayDir[3 * MAX_RAYS]);
+	ATTRIBUTE_ALIGNED16(btScalar m_lambda[MAX_RAYS]);
+
+	btTriangleRayPacketCallback(const btStridingMeshInterface* meshInterface, const btVector3* raySource, const btVector3* rayTarget, int numRays, btTriangleRayHit* hits, unsigned int flags)
+		: m_meshInterface(meshInterface),
+		  m_hits(hits),
+		  m_flags(flags),
+		  m_numGroups((numRays + 3) / 4)
+	{
+		for (int i = 0; i < m_numGroups * 4; i++)
+		{
+			//padding rays have a zero direction, they never hit
+			const bool active = i < numRays;
+			const btVector3 rayDir = active ? rayTarget[i] - raySource[i] : btVector3(0, 0, 0);
+			for (int k = 0; k < 3; k++)
+			{
+				m_rayFrom[k * MAX_RAYS + i] = active ? raySource[i][k] : btScalar(0.);
+				m_rayDir[k * MAX_RAYS + i] = rayDir[k];
+			}
+			m_lambda[i] = active ? hits[i].m_hitFraction : btScalar(-1.);
+		}
+	}
+
+	virtual void processNode(int nodeSubPart, int nodeTriangleIndex, unsigned int rayMask)
+	{
+		btVector3 triangle[3];
+		const unsigned char* vertexbase;
+		int numverts;
+		PHY_ScalarType type;
+		int stride;
+		const unsigned char* indexbase;
+		int indexstride;
+		int numfaces;
+		PHY_ScalarType indicestype;
+
+		m_meshInterface->getLockedReadOnlyVertexIndexBase(
+			&vertexbase,
+			numverts,
+			type,
+			stride,
+			&indexbase,
+			indexstride,
+			numfaces,
+			indicestype,
+			nodeSubPart);
+
+		unsigned int* gfxbase = (unsigned int*)(indexbase + nodeTriangleIndex * indexstride);
+
+		const btVector3& meshScaling = m_meshInterface->getScaling();
+		for (int j = 2; j >= 0; j--)
+		{
+			int graphicsindex = 0;
+			switch (indicestype)
+			{
+				case PHY_INTEGER: graphicsindex = gfxbase[j]; break;
+				case PHY_SHORT: graphicsindex = ((unsigned short*)gfxbase)[j]; break;
+				case PHY_UCHAR: graphicsindex = ((unsigned char*)gfxbase)[j]; break;
+				default: btAssert(0);
+			}
+
+			if (type == PHY_FLOAT)
+			{
+				float* graphicsbase = (float*)(vertexbase + graphicsindex * stride);
+				triangle[j] = btVector3(graphicsbase[0] * meshScaling.getX(), graphicsbase[1] * meshScaling.getY(), graphicsbase[2] * meshScaling.getZ());
+			}
+			else
+			{
+				double* graphicsbase = (double*)(vertexbase + graphicsindex * stride);
+				triangle[j] = btVector3(btScalar(graphicsbase[0]) * meshScaling.getX(), btScalar(graphicsbase[1]) * meshScaling.getY(), btScalar(graphicsbase[2]) * meshScaling.getZ());
+			}
+		}
+		m_meshInterface->unLockReadOnlyVertexBase(nodeSubPart);
+
+		const bool filterBackfaces = (m_flags & btTriangleRaycastCallback::kF_FilterBackfaces) != 0;
+		for (int g = 0; g < m_numGroups; g++)
+		{
+			const unsigned groupMask = (rayMask >> (g * 4)) & 15;
+			if (!groupMask)
+			{
+				continue;
+			}
+			ATTRIBUTE_ALIGNED16(btScalar hitFraction[4]);
+			unsigned backfaces;
+			const unsigned hit = groupMask & btRayTrianglePacket4(m_rayFrom + g * 4, m_rayDir + g * 4, MAX_RAYS, m_lambda + g * 4, triangle, filterBackfaces, hitFraction, backfaces);
+			for (int i = 0; i < 4; i++)
+			{
+				if (hit & (1u << i))
+				{
+					btTriangleRayHit& rayHit = m_hits[g * 4 + i];
+					btVector3 triangleNormal = (triangle[1] - triangle[0]).cross(triangle[2] - triangle[0]);
+					triangleNormal.normalize();
+					//@BP Mod - Allow for unflipped normal when raycasting against backfaces
+					if (((m_flags & btTriangleRaycastCallback::kF_KeepUnflippedNormal) == 0) && (backfaces & (1u << i)))
+					{
+						triangleNormal = -triangleNormal;
+					}
+					rayHit.m_hitNormalLocal = triangleNormal;
+					rayHit.m_hitFraction = hitFraction[i];
+					rayHit.m_partId = nodeSubPart;
+					rayHit.m_triangleIndex = nodeTriangleIndex;
+					m_lambda[g * 4 + i] = hitFraction[i];
+				}
+			}
+		}
+	}
+};
+
+void btBvhTriangleMeshShape::performRaycastPacket(const btVector3* raySource, const btVector3* rayTarget, int numRays, btTriangleRayHit* hits, unsigned int flags) const
+{
+	btAssert(numRays <= btNodeRayPacketOverlapCallback::MAX_RAYS);
+	if (numRays <= 0)
+	{
+		return;
+	}
+	for (int i = 0; i < numRays; i++)
+	{
+		hits[i].m_partId = -1;
+		hits[i].m_triangleIndex = -1;
+	}
+	btTriangleRayPacketCallback packetCallback(m_meshInterface, raySource, rayTarget, numRays, hits, flags);
+	m_bvh->reportRayPacketOverlappingNodex(&packetCallback, raySource, rayTarget, packetCallback.m_lambda, numRays);
+}
+
+struct btRaycastBatchLoop : public btIParallelForBody
+{
+	const btBvhTriangleMeshShape* m_triangleMesh;
+	const btVector3* m_raySource;
+	const btVector3* m_rayTarget;
+	int m_numRays;
+	btTriangleRayHit* m_hits;
+	unsigned int m_flags;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const int packetSize = btNodeRayPacketOverlapCallback::MAX_RAYS;
+		for (int packet = iBegin; packet < iEnd; ++packet)
+		{
+			const int first = packet * packetSize;
+			m_triangleMesh->performRaycastPacket(m_raySource + first, m_rayTarget + first, btMin(packetSize, m_numRays - first), m_hits + first, m_flags);
+		}
+	}
+};
+
+void btBvhTriangleMeshShape::performRaycastBatch(const btVector3* raySource, const btVector3* rayTarget, int numRays, btTriangleRayHit* hits, unsigned int flags) const
+{
+	BT_PROFILE("performRaycastBatch");
+	btRaycastBatchLoop rayLoop;
+	rayLoop.m_triangleMesh = this;
+	rayLoop.m_raySource = raySource;
+	rayLoop.m_rayTarget = rayTarget;
+	rayLoop.m_numRays = numRays;
+	rayLoop.m_hits = hits;
+	rayLoop.m_flags = flags;
+	const int packetSize = btNodeRayPacketOverlapCallback::MAX_RAYS;
+	const int numPackets = (numRays + packetSize - 1) / packetSize;
+#if BT_THREADSAFE
+	if (btGetTaskScheduler())
+	{
+		btParallelFor(0, numPackets, 8, rayLoop);
+		return;
+	}
+#endif
+	rayLoop.forLoop(0, numPackets);
+}
+
 void btBvhTriangleMeshShape::performConvexcast(btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax)
 {
 	struct MyNodeOverlapCallback : public btNodeOverlapCallback
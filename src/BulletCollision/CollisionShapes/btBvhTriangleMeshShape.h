@@ -21,6 +21,16 @@ subject to the following restrictions:
 #include "LinearMath/btAlignedAllocator.h"
 #include "btTriangleInfoMap.h"
 
+///btTriangleRayHit is the closest triangle hit by one ray of btBvhTriangleMeshShape::performRaycastPacket.
+///m_hitFraction is the ray parameter limit on input, m_triangleIndex stays -1 when the ray hits nothing below it
+struct btTriangleRayHit
+{
+	btVector3 m_hitNormalLocal;
+	btScalar m_hitFraction;
+	int m_partId;
+	int m_triangleIndex;
+};
+
 ///The btBvhTriangleMeshShape is a static-triangle mesh shape, it can only be used for fixed/non-moving objects.
 ///If you required moving concave triangle meshes, it is recommended to perform convex decomposition
 ///using HACD, see Bullet/Demos/ConvexDecompositionDemo.
@@ -61,6 +71,15 @@ public:
 	}
 
 	void performRaycast(btTriangleCallback * callback, const btVector3& raySource, const btVector3& rayTarget);
+	///performRaycastPacket finds the closest triangle hit by each of up to btNodeRayPacketOverlapCallback::MAX_RAYS rays in local space.
+	///the bvh is walked once for the whole packet and each triangle is intersected with 4 rays at a time (Moller-Trumbore).
+	///hits match btTriangleRaycastCallback away from the triangle edges, and flags are its EFlags. the barycentric coordinates of a hit may be down to -0.0001,
+	///while btTriangleRaycastCallback scales its edge tolerance with the triangle area, so a ray right on an edge can hit another triangle than btTriangleRaycastCallback.
+	///it is safe to call from several threads at once
+	void performRaycastPacket(const btVector3* raySource, const btVector3* rayTarget, int numRays, btTriangleRayHit* hits, unsigned int flags = 0) const;
+	///performRaycastBatch casts any number of rays with performRaycastPacket, in parallel with btParallelFor when a task scheduler is set.
+	///neighbouring rays share packets, so coherent rays should be adjacent
+	void performRaycastBatch(const btVector3* raySource, const btVector3* rayTarget, int numRays, btTriangleRayHit* hits, unsigned int flags = 0) const;
 	void performConvexcast(btTriangleCallback * callback, const btVector3& boxSource, const btVector3& boxTarget, const btVector3& boxMin, const btVector3& boxMax);
 
 	virtual void processAllTriangles(btTriangleCallback * callback, const btVector3& aabbMin, const btVector3& aabbMax) const;
@@ -22,6 +22,7 @@ btCompoundShape::btCompoundShape(bool enableDynamicAabbTree, const int initialCh
 	: m_localAabbMin(btScalar(BT_LARGE_FLOAT), btScalar(BT_LARGE_FLOAT), btScalar(BT_LARGE_FLOAT)),
 	  m_localAabbMax(btScalar(-BT_LARGE_FLOAT), btScalar(-BT_LARGE_FLOAT), btScalar(-BT_LARGE_FLOAT)),
 	  m_dynamicAabbTree(0),
+	  m_wideAabbTree(0),
 	  m_updateRevision(1),
 	  m_collisionMargin(btScalar(0.)),
 	  m_localScaling(btScalar(1.), btScalar(1.), btScalar(1.))
@@ -40,6 +41,11 @@ btCompoundShape::btCompoundShape(bool enableDynamicAabbTree, const int initialCh
 
 btCompoundShape::~btCompoundShape()
 {
+	if (m_wideAabbTree)
+	{
+		m_wideAabbTree->~btDbvtWide();
+		btAlignedFree(m_wideAabbTree);
+	}
 	if (m_dynamicAabbTree)
 	{
 		m_dynamicAabbTree->~btDbvt();
@@ -81,6 +87,7 @@ void btCompoundShape::addChildShape(const btTransform& localTransform, btCollisi
 	}
 
 	m_children.push_back(child);
+	updateWideAabbTree();
 }
 
 void btCompoundShape::updateChildTransform(int childIndex, const btTransform& newChildTransform, bool shouldRecalculateLocalAabb)
@@ -96,6 +103,10 @@ void btCompoundShape::updateChildTransform(int childIndex, const btTransform& ne
 		bounds = btDbvtVolume::FromMM(localAabbMin, localAabbMax);
 		//int index = m_children.size()-1;
 		m_dynamicAabbTree->update(m_children[childIndex].m_node, bounds);
+		if (m_wideAabbTree)
+		{
+			m_wideAabbTree->update(m_wideAabbTreeLeaves[childIndex]);
+		}
 	}
 
 	if (shouldRecalculateLocalAabb)
@@ -110,6 +121,12 @@ void btCompoundShape::removeChildShapeByIndex(int childShapeIndex)
 	btAssert(childShapeIndex >= 0 && childShapeIndex < m_children.size());
 	if (m_dynamicAabbTree)
 	{
+		if (m_wideAabbTree)
+		{
+			m_wideAabbTree->remove(m_wideAabbTreeLeaves[childShapeIndex]);
+			m_wideAabbTreeLeaves.swap(childShapeIndex, m_children.size() - 1);
+			m_wideAabbTreeLeaves.pop_back();
+		}
 		m_dynamicAabbTree->remove(m_children[childShapeIndex].m_node);
 	}
 	m_children.swap(childShapeIndex, m_children.size() - 1);
@@ -274,6 +291,8 @@ void btCompoundShape::setLocalScaling(const btVector3& scaling)
 
 	m_localScaling = scaling;
 	recalculateLocalAabb();
+	//all children moved, rebuild instead of keeping the refitted copy
+	updateWideAabbTree();
 }
 
 void btCompoundShape::createAabbTreeFromChildren()
@@ -296,6 +315,45 @@ void btCompoundShape::createAabbTreeFromChildren()
 			size_t index2 = index;
 			child.m_node = m_dynamicAabbTree->insert(bounds, reinterpret_cast<void*>(index2));
 		}
+		updateWideAabbTree();
+	}
+}
+
+void btCompoundShape::setUseWideAabbTree(bool useWideAabbTree)
+{
+	if (useWideAabbTree && !m_wideAabbTree)
+	{
+		void* mem = btAlignedAlloc(sizeof(btDbvtWide), 16);
+		m_wideAabbTree = new (mem) btDbvtWide();
+		updateWideAabbTree();
+	}
+	else if (!useWideAabbTree && m_wideAabbTree)
+	{
+		m_wideAabbTree->~btDbvtWide();
+		btAlignedFree(m_wideAabbTree);
+		m_wideAabbTree = 0;
+		m_wideAabbTreeLeaves.resize(0);
+	}
+}
+
+void btCompoundShape::updateWideAabbTree()
+{
+	if (m_wideAabbTree)
+	{
+		if (m_dynamicAabbTree)
+		{
+			m_wideAabbTree->build(m_dynamicAabbTree->m_root);
+			m_wideAabbTreeLeaves.resize(m_children.size());
+			for (int i = 0; i < m_wideAabbTree->m_leaves.size(); ++i)
+			{
+				m_wideAabbTreeLeaves[m_wideAabbTree->m_leaves[i]->dataAsInt] = i;
+			}
+		}
+		else
+		{
+			m_wideAabbTree->clear();
+			m_wideAabbTreeLeaves.resize(0);
+		}
 	}
 }
 
@@ -26,6 +26,7 @@ subject to the following restrictions:
 
 //class btOptimizedBvh;
 struct btDbvt;
+struct btDbvtWide;
 
 ATTRIBUTE_ALIGNED16(struct)
 btCompoundShapeChild
@@ -62,6 +63,10 @@ protected:
 
 	btDbvt* m_dynamicAabbTree;
 
+	///optional 4-wide SIMD copy of m_dynamicAabbTree, rebuilt when children are added and refitted when they move or are removed
+	btDbvtWide* m_wideAabbTree;
+	btAlignedObjectArray<int> m_wideAabbTreeLeaves;  // per child, its leaf in m_wideAabbTree
+
 	///increment m_updateRevision when adding/removing/replacing child shapes, so that some caches can be updated
 	int m_updateRevision;
 
@@ -69,6 +74,8 @@ protected:
 
 	btVector3 m_localScaling;
 
+	void updateWideAabbTree();
+
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
@@ -155,6 +162,16 @@ public:
 
 	void createAabbTreeFromChildren();
 
+	///keeps a 4-wide SIMD copy of the dynamic aabb tree, that btCompoundCollisionAlgorithm and convex sweeps use to cull the children.
+	///every addChildShape rebuilds the copy, so enable it after adding the children. updateChildTransform and the removal of
+	///children refit the copy in place, it is not rebalanced until the next rebuild
+	void setUseWideAabbTree(bool useWideAabbTree);
+
+	const btDbvtWide* getWideAabbTree() const
+	{
+		return m_wideAabbTree;
+	}
+
 	///computes the exact moment of inertia and the transform from the coordinate system defined by the principal axes of the moment of inertia
 	///and the center of mass to the current coordinate system. "masses" points to an array of masses of the children. The resulting transform
 	///"principal" has to be applied inversely to all children transforms in order for the local coordinate system of the compound
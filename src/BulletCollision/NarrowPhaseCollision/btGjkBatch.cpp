@@ -0,0 +1,696 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btGjkBatch.h"
+#include "BulletCollision/CollisionShapes/btConvexShape.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+#include "BulletCollision/CollisionShapes/btCapsuleShape.h"
+
+#if defined(BT_USE_DOUBLE_PRECISION)
+#define BT_GJK_BATCH_REL_ERROR2 btScalar(1.0e-12)
+#else
+#define BT_GJK_BATCH_REL_ERROR2 btScalar(1.0e-6)
+#endif
+
+//relative error accepted when GJK stops making progress
+#define BT_GJK_BATCH_STALL_ERROR2 btScalar(1.0e-3)
+
+#define BT_GJK_BATCH_MAX_ITERATIONS 32
+
+extern btScalar gGjkEpaPenetrationTolerance;
+
+//4 lanes of btScalar, masks have all bits set in the lanes where they are true
+#if defined(BT_USE_SSE)
+typedef __m128 btGjkLane;
+
+static SIMD_FORCE_INLINE btGjkLane btGjkSplat(btScalar x) { return _mm_set1_ps(x); }
+static SIMD_FORCE_INLINE btGjkLane btGjkLoad(const btScalar* p) { return _mm_load_ps(p); }
+static SIMD_FORCE_INLINE void btGjkStore(btScalar* p, btGjkLane a) { _mm_store_ps(p, a); }
+static SIMD_FORCE_INLINE btGjkLane btGjkAdd(btGjkLane a, btGjkLane b) { return _mm_add_ps(a, b); }
+static SIMD_FORCE_INLINE btGjkLane btGjkSub(btGjkLane a, btGjkLane b) { return _mm_sub_ps(a, b); }
+static SIMD_FORCE_INLINE btGjkLane btGjkMul(btGjkLane a, btGjkLane b) { return _mm_mul_ps(a, b); }
+static SIMD_FORCE_INLINE btGjkLane btGjkDiv(btGjkLane a, btGjkLane b) { return _mm_div_ps(a, b); }
+static SIMD_FORCE_INLINE btGjkLane btGjkLess(btGjkLane a, btGjkLane b) { return _mm_cmplt_ps(a, b); }
+static SIMD_FORCE_INLINE btGjkLane btGjkAnd(btGjkLane a, btGjkLane b) { return _mm_and_ps(a, b); }
+static SIMD_FORCE_INLINE btGjkLane btGjkSelect(btGjkLane mask, btGjkLane a, btGjkLane b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+static SIMD_FORCE_INLINE int btGjkMoveMask(btGjkLane mask) { return _mm_movemask_ps(mask); }
+#elif defined(BT_USE_NEON)
+typedef float32x4_t btGjkLane;
+
+static SIMD_FORCE_INLINE btGjkLane btGjkSplat(btScalar x) { return vdupq_n_f32(x); }
+static SIMD_FORCE_INLINE btGjkLane btGjkLoad(const btScalar* p) { return vld1q_f32(p); }
+static SIMD_FORCE_INLINE void btGjkStore(btScalar* p, btGjkLane a) { vst1q_f32(p, a); }
+static SIMD_FORCE_INLINE btGjkLane btGjkAdd(btGjkLane a, btGjkLane b) { return vaddq_f32(a, b); }
+static SIMD_FORCE_INLINE btGjkLane btGjkSub(btGjkLane a, btGjkLane b) { return vsubq_f32(a, b); }
+static SIMD_FORCE_INLINE btGjkLane btGjkMul(btGjkLane a, btGjkLane b) { return vmulq_f32(a, b); }
+static SIMD_FORCE_INLINE btGjkLane btGjkDiv(btGjkLane a, btGjkLane b)
+{
+	btGjkLane v = vrecpeq_f32(b);      // v ~ 1/b
+	v = vmulq_f32(v, vrecpsq_f32(b, v));  // two Newton-Raphson steps
+	v = vmulq_f32(v, vrecpsq_f32(b, v));
+	return vmulq_f32(a, v);
+}
+static SIMD_FORCE_INLINE btGjkLane btGjkLess(btGjkLane a, btGjkLane b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+static SIMD_FORCE_INLINE btGjkLane btGjkAnd(btGjkLane a, btGjkLane b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+static SIMD_FORCE_INLINE btGjkLane btGjkSelect(btGjkLane mask, btGjkLane a, btGjkLane b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+static SIMD_FORCE_INLINE int btGjkMoveMask(btGjkLane mask)
+{
+	static const uint32_t bits[4] = {1, 2, 4, 8};
+	const uint32x4_t rt = vandq_u32(vreinterpretq_u32_f32(mask), vld1q_u32(bits));
+	const uint32x2_t rs = vorr_u32(vget_low_u32(rt), vget_high_u32(rt));
+	return int(vget_lane_u32(rs, 0) | vget_lane_u32(rs, 1));
+}
+#else
+struct btGjkLane
+{
+	btScalar m[4];  // masks are 1 or 0
+};
+
+static SIMD_FORCE_INLINE btGjkLane btGjkSplat(btScalar x)
+{
+	btGjkLane r;
+	r.m[0] = r.m[1] = r.m[2] = r.m[3] = x;
+	return r;
+}
+static SIMD_FORCE_INLINE btGjkLane btGjkLoad(const btScalar* p)
+{
+	btGjkLane r;
+	r.m[0] = p[0];
+	r.m[1] = p[1];
+	r.m[2] = p[2];
+	r.m[3] = p[3];
+	return r;
+}
+static SIMD_FORCE_INLINE void btGjkStore(btScalar* p, btGjkLane a)
+{
+	p[0] = a.m[0];
+	p[1] = a.m[1];
+	p[2] = a.m[2];
+	p[3] = a.m[3];
+}
+#define BT_GJK_LANE_OP(name, expr)                                   \
+	static SIMD_FORCE_INLINE btGjkLane name(btGjkLane a, btGjkLane b) \
+	{                                                                 \
+		btGjkLane r;                                                  \
+		for (int i = 0; i < 4; ++i)                                   \
+		{                                                             \
+			r.m[i] = (expr);                                          \
+		}                                                             \
+		return r;                                                     \
+	}
+BT_GJK_LANE_OP(btGjkAdd, a.m[i] + b.m[i])
+BT_GJK_LANE_OP(btGjkSub, a.m[i] - b.m[i])
+BT_GJK_LANE_OP(btGjkMul, a.m[i] * b.m[i])
+BT_GJK_LANE_OP(btGjkDiv, a.m[i] / b.m[i])
+BT_GJK_LANE_OP(btGjkLess, a.m[i] < b.m[i] ? btScalar(1.) : btScalar(0.))
+BT_GJK_LANE_OP(btGjkAnd, (a.m[i] != btScalar(0.)) && (b.m[i] != btScalar(0.)) ? btScalar(1.) : btScalar(0.))
+#undef BT_GJK_LANE_OP
+static SIMD_FORCE_INLINE btGjkLane btGjkSelect(btGjkLane mask, btGjkLane a, btGjkLane b)
+{
+	btGjkLane r;
+	for (int i = 0; i < 4; ++i)
+	{
+		r.m[i] = mask.m[i] != btScalar(0.) ? a.m[i] : b.m[i];
+	}
+	return r;
+}
+static SIMD_FORCE_INLINE int btGjkMoveMask(btGjkLane mask)
+{
+	int bits = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		bits |= mask.m[i] != btScalar(0.) ? (1 << i) : 0;
+	}
+	return bits;
+}
+#endif
+
+//a support function of one side of the pairs of a lane group, with the transform and the box extents in lanes
+ATTRIBUTE_ALIGNED16(struct)
+btGjkBatchSupport
+{
+	btScalar m_basis[9][btGjkBatch::WIDTH];  // row major
+	btScalar m_origin[3][btGjkBatch::WIDTH];
+	btScalar m_extents[3][btGjkBatch::WIDTH];
+	btScalar m_local[3][btGjkBatch::WIDTH];  // local direction and support point of the lanes with their own support function
+	const btConvexShape* m_shapes[btGjkBatch::WIDTH];  // 0 for the lanes with box support
+	int m_numShapes;
+
+	//a lane without shape is a point at the origin
+	void init(int lane, const btConvexShape* shape, const btTransform& transform, const btVector3& offset)
+	{
+		const btMatrix3x3& basis = transform.getBasis();
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				m_basis[i * 3 + j][lane] = basis[i][j];
+			}
+			m_origin[i][lane] = transform.getOrigin()[i] - offset[i];
+			m_extents[i][lane] = btScalar(0.);
+		}
+		m_shapes[lane] = 0;
+		switch (shape ? shape->getShapeType() : SPHERE_SHAPE_PROXYTYPE)
+		{
+			case SPHERE_SHAPE_PROXYTYPE:
+				break;
+			case BOX_SHAPE_PROXYTYPE:
+			{
+				const btVector3& halfExtents = static_cast<const btBoxShape*>(shape)->getImplicitShapeDimensions();
+				for (int i = 0; i < 3; ++i)
+				{
+					m_extents[i][lane] = halfExtents[i];
+				}
+				break;
+			}
+			case CAPSULE_SHAPE_PROXYTYPE:
+			{
+				const btCapsuleShape* capsule = static_cast<const btCapsuleShape*>(shape);
+				m_extents[capsule->getUpAxis()][lane] = capsule->getHalfHeight();
+				break;
+			}
+			default:
+				m_shapes[lane] = shape;
+		}
+	}
+
+	void updateNumShapes()
+	{
+		m_numShapes = 0;
+		for (int lane = 0; lane < btGjkBatch::WIDTH; ++lane)
+		{
+			m_numShapes += m_shapes[lane] ? 1 : 0;
+		}
+	}
+
+	//support point in world space, of the shapes without margin
+	SIMD_FORCE_INLINE void getSupport(btGjkLane dx, btGjkLane dy, btGjkLane dz, btGjkLane& sx, btGjkLane& sy, btGjkLane& sz)
+	{
+		//direction in local space
+		btGjkLane lx = btGjkAdd(btGjkAdd(btGjkMul(btGjkLoad(m_basis[0]), dx), btGjkMul(btGjkLoad(m_basis[3]), dy)), btGjkMul(btGjkLoad(m_basis[6]), dz));
+		btGjkLane ly = btGjkAdd(btGjkAdd(btGjkMul(btGjkLoad(m_basis[1]), dx), btGjkMul(btGjkLoad(m_basis[4]), dy)), btGjkMul(btGjkLoad(m_basis[7]), dz));
+		btGjkLane lz = btGjkAdd(btGjkAdd(btGjkMul(btGjkLoad(m_basis[2]), dx), btGjkMul(btGjkLoad(m_basis[5]), dy)), btGjkMul(btGjkLoad(m_basis[8]), dz));
+
+		//the box corner on the side of the direction, like btFsels in localGetSupportVertexWithoutMarginNonVirtual
+		const btGjkLane zero = btGjkSplat(btScalar(0.));
+		btGjkLane ex = btGjkLoad(m_extents[0]);
+		btGjkLane ey = btGjkLoad(m_extents[1]);
+		btGjkLane ez = btGjkLoad(m_extents[2]);
+		btGjkLane px = btGjkSelect(btGjkLess(lx, zero), btGjkSub(zero, ex), ex);
+		btGjkLane py = btGjkSelect(btGjkLess(ly, zero), btGjkSub(zero, ey), ey);
+		btGjkLane pz = btGjkSelect(btGjkLess(lz, zero), btGjkSub(zero, ez), ez);
+
+		if (m_numShapes)
+		{
+			btGjkStore(m_local[0], lx);
+			btGjkStore(m_local[1], ly);
+			btGjkStore(m_local[2], lz);
+			ATTRIBUTE_ALIGNED16(btScalar box[3][btGjkBatch::WIDTH]);
+			btGjkStore(box[0], px);
+			btGjkStore(box[1], py);
+			btGjkStore(box[2], pz);
+			for (int lane = 0; lane < btGjkBatch::WIDTH; ++lane)
+			{
+				if (m_shapes[lane])
+				{
+					const btVector3 s = m_shapes[lane]->localGetSupportVertexWithoutMarginNonVirtual(btVector3(m_local[0][lane], m_local[1][lane], m_local[2][lane]));
+					box[0][lane] = s.getX();
+					box[1][lane] = s.getY();
+					box[2][lane] = s.getZ();
+				}
+			}
+			px = btGjkLoad(box[0]);
+			py = btGjkLoad(box[1]);
+			pz = btGjkLoad(box[2]);
+		}
+
+		sx = btGjkAdd(btGjkAdd(btGjkAdd(btGjkMul(btGjkLoad(m_basis[0]), px), btGjkMul(btGjkLoad(m_basis[1]), py)), btGjkMul(btGjkLoad(m_basis[2]), pz)), btGjkLoad(m_origin[0]));
+		sy = btGjkAdd(btGjkAdd(btGjkAdd(btGjkMul(btGjkLoad(m_basis[3]), px), btGjkMul(btGjkLoad(m_basis[4]), py)), btGjkMul(btGjkLoad(m_basis[5]), pz)), btGjkLoad(m_origin[1]));
+		sz = btGjkAdd(btGjkAdd(btGjkAdd(btGjkMul(btGjkLoad(m_basis[6]), px), btGjkMul(btGjkLoad(m_basis[7]), py)), btGjkMul(btGjkLoad(m_basis[8]), pz)), btGjkLoad(m_origin[2]));
+	}
+};
+
+//Johnson's sub-algorithm of btGjkBatchGroup::closest, for the 4 vertex slots of every lane
+struct btGjkSubSimplexState
+{
+	btGjkLane m_wx[4], m_wy[4], m_wz[4];
+	btGjkLane m_used[4];
+	btGjkLane m_dots[4][4];
+	btGjkLane m_delta[16][4];  // the determinants of each sub-simplex, per vertex
+	btGjkLane m_allLanes;
+	btGjkLane m_bestVV, m_bestX, m_bestY, m_bestZ;
+	btGjkLane m_bestLambda[4];
+	int m_needed;  // bits of the sub-simplices to evaluate
+};
+
+//evaluates the sub-simplex S, then the next ones. S is a constant, so the loops over its vertices unroll.
+//the sub-simplices are visited in increasing order, so the determinants of S without one of its vertices are known
+template <int S>
+struct btGjkSubSimplex
+{
+	static SIMD_FORCE_INLINE void evaluate(btGjkSubSimplexState & state)
+	{
+		if (state.m_needed & (1 << S))
+		{
+			const btGjkLane zero = btGjkSplat(btScalar(0.));
+			btGjkLane valid = state.m_allLanes;
+			btGjkLane sum = zero;
+			for (int j = 0; j < 4; ++j)
+			{
+				if (!(S & (1 << j)))
+				{
+					continue;
+				}
+				const int rest = S & ~(1 << j);
+				if (rest == 0)
+				{
+					state.m_delta[S][j] = btGjkSplat(btScalar(1.));
+				}
+				else
+				{
+					const int k = (rest & 1) ? 0 : (rest & 2) ? 1 : (rest & 4) ? 2 : 3;
+					btGjkLane d = zero;
+					for (int i = 0; i < 4; ++i)
+					{
+						if (rest & (1 << i))
+						{
+							d = btGjkAdd(d, btGjkMul(state.m_delta[rest][i], btGjkSub(state.m_dots[i][k], state.m_dots[i][j])));
+						}
+					}
+					state.m_delta[S][j] = d;
+				}
+				valid = btGjkAnd(valid, btGjkAnd(state.m_used[j], btGjkLess(zero, state.m_delta[S][j])));
+				sum = btGjkAdd(sum, state.m_delta[S][j]);
+			}
+			if (btGjkMoveMask(valid))
+			{
+				//avoid the division by zero in the lanes where S is not valid
+				const btGjkLane invSum = btGjkDiv(btGjkSplat(btScalar(1.)), btGjkSelect(valid, sum, btGjkSplat(btScalar(1.))));
+				btGjkLane lambda[4];
+				btGjkLane x = zero, y = zero, z = zero;
+				for (int j = 0; j < 4; ++j)
+				{
+					lambda[j] = zero;
+					if (S & (1 << j))
+					{
+						lambda[j] = btGjkMul(state.m_delta[S][j], invSum);
+						x = btGjkAdd(x, btGjkMul(lambda[j], state.m_wx[j]));
+						y = btGjkAdd(y, btGjkMul(lambda[j], state.m_wy[j]));
+						z = btGjkAdd(z, btGjkMul(lambda[j], state.m_wz[j]));
+					}
+				}
+				const btGjkLane xx = btGjkAdd(btGjkAdd(btGjkMul(x, x), btGjkMul(y, y)), btGjkMul(z, z));
+				const btGjkLane better = btGjkAnd(valid, btGjkLess(xx, state.m_bestVV));
+				state.m_bestVV = btGjkSelect(better, xx, state.m_bestVV);
+				state.m_bestX = btGjkSelect(better, x, state.m_bestX);
+				state.m_bestY = btGjkSelect(better, y, state.m_bestY);
+				state.m_bestZ = btGjkSelect(better, z, state.m_bestZ);
+				for (int j = 0; j < 4; ++j)
+				{
+					state.m_bestLambda[j] = btGjkSelect(better, lambda[j], state.m_bestLambda[j]);
+				}
+			}
+		}
+		btGjkSubSimplex<S + 1>::evaluate(state);
+	}
+};
+
+template <>
+struct btGjkSubSimplex<16>
+{
+	static SIMD_FORCE_INLINE void evaluate(btGjkSubSimplexState&)
+	{
+	}
+};
+
+//GJK of btGjkBatch::WIDTH pairs at a time, a lane takes the next pair as soon as its pair is done
+ATTRIBUTE_ALIGNED16(struct)
+btGjkBatchGroup
+{
+	btGjkBatchSupport m_supportA;
+	btGjkBatchSupport m_supportB;
+	btScalar m_maximumDistanceSquared[btGjkBatch::WIDTH];
+	//simplex vertices, per vertex slot: the support points on A and B and their difference
+	btScalar m_a[4][3][btGjkBatch::WIDTH];
+	btScalar m_b[4][3][btGjkBatch::WIDTH];
+	btScalar m_w[4][3][btGjkBatch::WIDTH];
+	btScalar m_used[4][btGjkBatch::WIDTH];    // 1 for the used vertex slots
+	btScalar m_lambda[4][btGjkBatch::WIDTH];  // barycentric coordinates of the closest point
+	btScalar m_v[3][btGjkBatch::WIDTH];
+	btScalar m_vv[btGjkBatch::WIDTH];
+	btVector3 m_offset[btGjkBatch::WIDTH];
+	int m_usedSlots[btGjkBatch::WIDTH];  // bits of the used vertex slots
+	int m_iteration[btGjkBatch::WIDTH];
+	int m_pair[btGjkBatch::WIDTH];  // pair index of the lane
+
+	void load(int lane, const btGjkBatchPair& pair, int pairIndex)
+	{
+		//like btGjkPairDetector, work close to the origin
+		m_offset[lane] = (pair.m_transformA.getOrigin() + pair.m_transformB.getOrigin()) * btScalar(0.5);
+		m_supportA.init(lane, pair.m_shapeA, pair.m_transformA, m_offset[lane]);
+		m_supportB.init(lane, pair.m_shapeB, pair.m_transformB, m_offset[lane]);
+		m_maximumDistanceSquared[lane] = pair.m_maximumDistanceSquared;
+		for (int k = 0; k < 4; ++k)
+		{
+			m_used[k][lane] = btScalar(0.);
+			m_lambda[k][lane] = btScalar(0.);
+		}
+		//start with the support in the direction from A to B, this first v is no point of the simplex
+		btVector3 v = pair.m_transformA.getOrigin() - pair.m_transformB.getOrigin();
+		if (v.length2() < SIMD_EPSILON)
+		{
+			v.setValue(btScalar(1.), btScalar(0.), btScalar(0.));
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			m_v[i][lane] = v[i];
+		}
+		m_vv[lane] = v.length2();
+		m_usedSlots[lane] = 0;
+		m_iteration[lane] = 0;
+		m_pair[lane] = pairIndex;
+	}
+
+	void finish(int lane, int status, btScalar distance, btGjkBatchResult* results)
+	{
+		btGjkBatchResult& result = results[m_pair[lane]];
+		result.m_status = status;
+		const btVector3 v(m_v[0][lane], m_v[1][lane], m_v[2][lane]);
+		const btScalar vv = m_vv[lane];
+		result.m_normalOnB = vv > SIMD_EPSILON * SIMD_EPSILON ? v / btSqrt(vv) : btVector3(0, 0, 0);
+		if (status == btGjkBatch::BT_GJK_BATCH_SEPARATED)
+		{
+			btVector3 pointOnA(0, 0, 0);
+			btVector3 pointOnB(0, 0, 0);
+			for (int k = 0; k < 4; ++k)
+			{
+				const btScalar lambda = m_lambda[k][lane];
+				if (lambda > btScalar(0.))
+				{
+					pointOnA += btVector3(m_a[k][0][lane], m_a[k][1][lane], m_a[k][2][lane]) * lambda;
+					pointOnB += btVector3(m_b[k][0][lane], m_b[k][1][lane], m_b[k][2][lane]) * lambda;
+				}
+			}
+			result.m_pointOnA = pointOnA + m_offset[lane];
+			result.m_pointOnB = pointOnB + m_offset[lane];
+			result.m_distance = btSqrt(vv);
+		}
+		else
+		{
+			result.m_pointOnA.setValue(0, 0, 0);
+			result.m_pointOnB.setValue(0, 0, 0);
+			result.m_distance = distance;
+		}
+		m_pair[lane] = -1;
+	}
+
+	void addVertex(int lane, const btScalar* a, const btScalar* b, const btScalar* w)
+	{
+		int slot = 0;
+		while (m_usedSlots[lane] & (1 << slot))
+		{
+			slot++;
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			m_a[slot][i][lane] = a[i];
+			m_b[slot][i][lane] = b[i];
+			m_w[slot][i][lane] = w[i];
+		}
+		m_used[slot][lane] = btScalar(1.);
+		m_usedSlots[lane] |= 1 << slot;
+	}
+
+	//the point of the simplex closest to the origin, and the smallest sub-simplex that contains it.
+	//Johnson's determinants are computed for every sub-simplex of the used slots, and the closest of the sub-simplices
+	//that contain their own closest point wins, that is the closest point of the simplex even when the determinants are not exact
+	void closest(int running, btGjkLane& vx, btGjkLane& vy, btGjkLane& vz, btGjkLane& vv)
+	{
+		btGjkSubSimplexState state;
+		const btGjkLane zero = btGjkSplat(btScalar(0.));
+		for (int k = 0; k < 4; ++k)
+		{
+			state.m_wx[k] = btGjkLoad(m_w[k][0]);
+			state.m_wy[k] = btGjkLoad(m_w[k][1]);
+			state.m_wz[k] = btGjkLoad(m_w[k][2]);
+			state.m_used[k] = btGjkLess(zero, btGjkLoad(m_used[k]));
+		}
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = i; j < 4; ++j)
+			{
+				state.m_dots[i][j] = state.m_dots[j][i] = btGjkAdd(btGjkAdd(btGjkMul(state.m_wx[i], state.m_wx[j]), btGjkMul(state.m_wy[i], state.m_wy[j])), btGjkMul(state.m_wz[i], state.m_wz[j]));
+			}
+		}
+		//only the subsets of the used slots of some running lane are needed
+		state.m_needed = 0;
+		for (int lane = 0; lane < btGjkBatch::WIDTH; ++lane)
+		{
+			if (running & (1 << lane))
+			{
+				const int slots = m_usedSlots[lane];
+				for (int sub = slots; sub; sub = (sub - 1) & slots)
+				{
+					state.m_needed |= 1 << sub;
+				}
+			}
+		}
+		state.m_allLanes = btGjkLess(zero, btGjkSplat(btScalar(1.)));
+		state.m_bestVV = btGjkSplat(BT_LARGE_FLOAT);
+		state.m_bestX = state.m_bestY = state.m_bestZ = zero;
+		for (int j = 0; j < 4; ++j)
+		{
+			state.m_bestLambda[j] = zero;
+		}
+
+		btGjkSubSimplex<1>::evaluate(state);
+
+		vx = state.m_bestX;
+		vy = state.m_bestY;
+		vz = state.m_bestZ;
+		vv = state.m_bestVV;
+		for (int j = 0; j < 4; ++j)
+		{
+			btGjkStore(m_lambda[j], state.m_bestLambda[j]);
+		}
+	}
+
+	void run(const btGjkBatchPair* pairs, btGjkBatchResult* results, int numPairs)
+	{
+		const btGjkLane zero = btGjkSplat(btScalar(0.));
+		const btGjkLane relError = btGjkSplat(BT_GJK_BATCH_REL_ERROR2);
+		const btScalar minimumDistanceSquared = gGjkEpaPenetrationTolerance * gGjkEpaPenetrationTolerance;
+
+		//the idle lanes compute the support of a sphere at the origin
+		for (int k = 0; k < 4; ++k)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				btGjkStore(m_a[k][i], zero);
+				btGjkStore(m_b[k][i], zero);
+				btGjkStore(m_w[k][i], zero);
+			}
+			btGjkStore(m_used[k], zero);
+			btGjkStore(m_lambda[k], zero);
+		}
+		for (int lane = 0; lane < btGjkBatch::WIDTH; ++lane)
+		{
+			m_supportA.init(lane, 0, btTransform::getIdentity(), btVector3(0, 0, 0));
+			m_supportB.init(lane, 0, btTransform::getIdentity(), btVector3(0, 0, 0));
+			m_maximumDistanceSquared[lane] = btScalar(0.);
+			for (int i = 0; i < 3; ++i)
+			{
+				m_v[i][lane] = btScalar(i == 0 ? 1. : 0.);
+			}
+			m_vv[lane] = btScalar(1.);
+			m_usedSlots[lane] = 0;
+			m_iteration[lane] = 0;
+			m_pair[lane] = -1;
+		}
+
+		int next = 0;
+		int running = 0;
+		for (;;)
+		{
+			for (int lane = 0; lane < btGjkBatch::WIDTH; ++lane)
+			{
+				if (running & (1 << lane))
+				{
+					continue;
+				}
+				if (next < numPairs)
+				{
+					load(lane, pairs[next], next);
+					next++;
+					running |= 1 << lane;
+				}
+				else
+				{
+					//no more pairs, skip the support function of the idle lane
+					m_supportA.m_shapes[lane] = 0;
+					m_supportB.m_shapes[lane] = 0;
+				}
+			}
+			if (!running)
+			{
+				break;
+			}
+			m_supportA.updateNumShapes();
+			m_supportB.updateNumShapes();
+
+			btGjkLane vx = btGjkLoad(m_v[0]);
+			btGjkLane vy = btGjkLoad(m_v[1]);
+			btGjkLane vz = btGjkLoad(m_v[2]);
+			btGjkLane vv = btGjkLoad(m_vv);
+			btGjkLane ax, ay, az, bx, by, bz;
+			m_supportA.getSupport(btGjkSub(zero, vx), btGjkSub(zero, vy), btGjkSub(zero, vz), ax, ay, az);
+			m_supportB.getSupport(vx, vy, vz, bx, by, bz);
+			const btGjkLane wx = btGjkSub(ax, bx);
+			const btGjkLane wy = btGjkSub(ay, by);
+			const btGjkLane wz = btGjkSub(az, bz);
+			const btGjkLane vw = btGjkAdd(btGjkAdd(btGjkMul(vx, wx), btGjkMul(vy, wy)), btGjkMul(vz, wz));
+
+			//the distance is at least v.w/|v|, stop when that is beyond the maximum distance
+			const int farMask = btGjkMoveMask(btGjkAnd(btGjkLess(zero, vw), btGjkLess(btGjkMul(vv, btGjkLoad(m_maximumDistanceSquared)), btGjkMul(vw, vw)))) & running;
+			//the distance is at most |v|, stop when the lower bound is close enough
+			const int convergedMask = ~btGjkMoveMask(btGjkLess(btGjkMul(vv, relError), btGjkSub(vv, vw))) & running & ~farMask;
+
+			ATTRIBUTE_ALIGNED16(btScalar lanes[10][btGjkBatch::WIDTH]);
+			btGjkStore(lanes[0], ax);
+			btGjkStore(lanes[1], ay);
+			btGjkStore(lanes[2], az);
+			btGjkStore(lanes[3], bx);
+			btGjkStore(lanes[4], by);
+			btGjkStore(lanes[5], bz);
+			btGjkStore(lanes[6], wx);
+			btGjkStore(lanes[7], wy);
+			btGjkStore(lanes[8], wz);
+			btGjkStore(lanes[9], vw);
+			for (int lane = 0; lane < btGjkBatch::WIDTH; ++lane)
+			{
+				const int bit = 1 << lane;
+				if (farMask & bit)
+				{
+					finish(lane, btGjkBatch::BT_GJK_BATCH_FAR, lanes[9][lane] / btSqrt(m_vv[lane]), results);
+					running &= ~bit;
+				}
+				else if ((convergedMask & bit) && m_iteration[lane])
+				{
+					finish(lane, btGjkBatch::BT_GJK_BATCH_SEPARATED, btScalar(0.), results);
+					running &= ~bit;
+				}
+				else if (running & bit)
+				{
+					const btScalar a[3] = {lanes[0][lane], lanes[1][lane], lanes[2][lane]};
+					const btScalar b[3] = {lanes[3][lane], lanes[4][lane], lanes[5][lane]};
+					const btScalar w[3] = {lanes[6][lane], lanes[7][lane], lanes[8][lane]};
+					addVertex(lane, a, b, w);
+				}
+			}
+			if (!running)
+			{
+				continue;
+			}
+
+			//keep the previous closest point, in case the new one is no improvement
+			ATTRIBUTE_ALIGNED16(btScalar lambda[4][btGjkBatch::WIDTH]);
+			for (int k = 0; k < 4; ++k)
+			{
+				for (int lane = 0; lane < btGjkBatch::WIDTH; ++lane)
+				{
+					lambda[k][lane] = m_lambda[k][lane];
+				}
+			}
+
+			btGjkLane nx, ny, nz, nvv;
+			closest(running, nx, ny, nz, nvv);
+
+			ATTRIBUTE_ALIGNED16(btScalar newV[4][btGjkBatch::WIDTH]);
+			btGjkStore(newV[0], nx);
+			btGjkStore(newV[1], ny);
+			btGjkStore(newV[2], nz);
+			btGjkStore(newV[3], nvv);
+			for (int lane = 0; lane < btGjkBatch::WIDTH; ++lane)
+			{
+				const int bit = 1 << lane;
+				if (!(running & bit))
+				{
+					continue;
+				}
+				//the distance did not decrease, keep the previous closest point when its lower bound is close
+				if (m_iteration[lane] && newV[3][lane] >= m_vv[lane])
+				{
+					for (int k = 0; k < 4; ++k)
+					{
+						m_lambda[k][lane] = lambda[k][lane];
+					}
+					finish(lane, (m_vv[lane] - lanes[9][lane] <= m_vv[lane] * BT_GJK_BATCH_STALL_ERROR2) ? btGjkBatch::BT_GJK_BATCH_SEPARATED : btGjkBatch::BT_GJK_BATCH_FAILED, btScalar(0.), results);
+					running &= ~bit;
+					continue;
+				}
+				//the origin is inside the simplex or close to it
+				const bool inside = m_lambda[0][lane] > btScalar(0.) && m_lambda[1][lane] > btScalar(0.) &&
+									m_lambda[2][lane] > btScalar(0.) && m_lambda[3][lane] > btScalar(0.);
+				if (inside || newV[3][lane] < minimumDistanceSquared || ++m_iteration[lane] >= BT_GJK_BATCH_MAX_ITERATIONS)
+				{
+					finish(lane, btGjkBatch::BT_GJK_BATCH_FAILED, btScalar(0.), results);
+					running &= ~bit;
+					continue;
+				}
+				//drop the vertices that do not support the closest point
+				for (int k = 0; k < 4; ++k)
+				{
+					if (m_lambda[k][lane] <= btScalar(0.))
+					{
+						m_used[k][lane] = btScalar(0.);
+						m_usedSlots[lane] &= ~(1 << k);
+					}
+				}
+				//the first v is no point of the simplex, it can be closer than the first closest point
+				const bool converged = m_iteration[lane] > 1 && m_vv[lane] - newV[3][lane] <= SIMD_EPSILON * m_vv[lane];
+				for (int i = 0; i < 3; ++i)
+				{
+					m_v[i][lane] = newV[i][lane];
+				}
+				m_vv[lane] = newV[3][lane];
+				//like btGjkPairDetector, stop when the distance hardly decreases
+				if (converged)
+				{
+					finish(lane, btGjkBatch::BT_GJK_BATCH_SEPARATED, btScalar(0.), results);
+					running &= ~bit;
+				}
+			}
+		}
+	}
+};
+
+bool btGjkBatch::hasBoxSupport(const btConvexShape* shape)
+{
+	switch (shape->getShapeType())
+	{
+		case SPHERE_SHAPE_PROXYTYPE:
+		case BOX_SHAPE_PROXYTYPE:
+		case CAPSULE_SHAPE_PROXYTYPE:
+			return true;
+		default:
+			return false;
+	}
+}
+
+void btGjkBatch::getClosestPoints(const btGjkBatchPair* pairs, btGjkBatchResult* results, int numPairs)
+{
+	btGjkBatchGroup group;
+	group.run(pairs, results, numPairs);
+}
@@ -0,0 +1,72 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_GJK_BATCH_H
+#define BT_GJK_BATCH_H
+
+#include "LinearMath/btTransform.h"
+
+class btConvexShape;
+
+///a convex pair of a btGjkBatch query
+ATTRIBUTE_ALIGNED16(struct)
+btGjkBatchPair
+{
+	btTransform m_transformA;
+	btTransform m_transformB;
+	const btConvexShape* m_shapeA;
+	const btConvexShape* m_shapeB;
+	btScalar m_maximumDistanceSquared;  // the query stops once the shapes without margin are known to be further apart
+};
+
+///the closest points of a btGjkBatchPair, for the shapes without margin
+ATTRIBUTE_ALIGNED16(struct)
+btGjkBatchResult
+{
+	btVector3 m_pointOnA;
+	btVector3 m_pointOnB;
+	btVector3 m_normalOnB;  // from B towards A
+	btScalar m_distance;    // a lower bound of the distance when m_status is BT_GJK_BATCH_FAR
+	int m_status;
+};
+
+///The btGjkBatch computes the closest points of convex pairs with GJK, btGjkBatch::WIDTH pairs at a time in the lanes of a SIMD register.
+///A lane takes the next pair as soon as its pair is done, so the lanes do not wait for the slowest pair of a group.
+///Boxes, spheres and capsules share a branch free support function: without margin, they are boxes with some zero extents.
+///Other shapes, such as convex hulls, use localGetSupportVertexWithoutMarginNonVirtual in their own lane.
+///The sub-simplex closest to the origin is found with Johnson's determinants, evaluated for all lanes together, for the sub-simplices used by any lane.
+///Only separated pairs are handled: pairs whose shapes without margin touch or overlap get the BT_GJK_BATCH_FAILED status, and should use btGjkPairDetector and its penetration depth solver.
+class btGjkBatch
+{
+public:
+	enum
+	{
+		WIDTH = 4
+	};
+
+	enum Status
+	{
+		BT_GJK_BATCH_SEPARATED,  // m_pointOnA, m_pointOnB and m_distance are the closest points and their distance
+		BT_GJK_BATCH_FAR,        // further apart than m_maximumDistanceSquared
+		BT_GJK_BATCH_FAILED      // touching, overlapping or not converged, use btGjkPairDetector
+	};
+
+	///returns true for the shapes that use the lane wide support function
+	static bool hasBoxSupport(const btConvexShape* shape);
+
+	static void getClosestPoints(const btGjkBatchPair* pairs, btGjkBatchResult* results, int numPairs);
+};
+
+#endif  //BT_GJK_BATCH_H
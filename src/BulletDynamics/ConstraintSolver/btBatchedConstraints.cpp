@@ -98,6 +98,36 @@ bool btBatchedConstraints::validate(btConstraintArray* constraints, const btAlig
 	return errors == 0;
 }
 
+void btBatchedConstraints::getStatistics(Statistics* stats) const
+{
+	stats->m_numRows = m_constraintIndices.size();
+	stats->m_numPhases = m_phases.size();
+	stats->m_numBatches = m_batches.size();
+	stats->m_minBatchSize = m_constraintIndices.size();
+	stats->m_maxBatchSize = 0;
+	stats->m_minBatchesPerPhase = m_batches.size();
+	stats->m_maxBatchesPerPhase = 0;
+	stats->m_numSerialRows = 0;
+	for (int iPhase = 0; iPhase < m_phases.size(); ++iPhase)
+	{
+		const Range& phase = m_phases[iPhase];
+		int numBatches = phase.end - phase.begin;
+		stats->m_minBatchesPerPhase = btMin(stats->m_minBatchesPerPhase, numBatches);
+		stats->m_maxBatchesPerPhase = btMax(stats->m_maxBatchesPerPhase, numBatches);
+		for (int iBatch = phase.begin; iBatch < phase.end; ++iBatch)
+		{
+			const Range& batch = m_batches[iBatch];
+			int batchSize = batch.end - batch.begin;
+			stats->m_minBatchSize = btMin(stats->m_minBatchSize, batchSize);
+			stats->m_maxBatchSize = btMax(stats->m_maxBatchSize, batchSize);
+			if (numBatches == 1)
+			{
+				stats->m_numSerialRows += batchSize;
+			}
+		}
+	}
+}
+
 static void debugDrawSingleBatch(const btBatchedConstraints* bc,
 								 btConstraintArray* constraints,
 								 const btAlignedObjectArray<btSolverBody>& bodies,
@@ -527,6 +557,24 @@ static void writeGrainSizes(btBatchedConstraints* bc)
 	}
 }
 
+static void writeOutPhaseOrder(btBatchedConstraints* bc)
+{
+	typedef btBatchedConstraints::Range Range;
+	// for each phase
+	for (int iPhase = 0; iPhase < bc->m_phases.size(); ++iPhase)
+	{
+		// sort the batches from largest to smallest (can be helpful to some task schedulers)
+		const Range& curBatches = bc->m_phases[iPhase];
+		bc->m_batches.quickSortInternal(BatchCompare, curBatches.begin, curBatches.end - 1);
+	}
+	bc->m_phaseOrder.resize(bc->m_phases.size());
+	for (int i = 0; i < bc->m_phases.size(); ++i)
+	{
+		bc->m_phaseOrder[i] = i;
+	}
+	writeGrainSizes(bc);
+}
+
 static void writeOutBatches(btBatchedConstraints* bc,
 							const int* constraintBatchIds,
 							int numConstraints,
@@ -574,19 +622,7 @@ static void writeOutBatches(btBatchedConstraints* bc,
 		bc->m_constraintIndices.resizeNoInitialize(numConstraints);
 		writeOutConstraintIndicesMt(bc, constraintBatchIds, numConstraints, constraintIdPerBatch, maxNumBatchesPerPhase, numPhases);
 	}
-	// for each phase
-	for (int iPhase = 0; iPhase < bc->m_phases.size(); ++iPhase)
-	{
-		// sort the batches from largest to smallest (can be helpful to some task schedulers)
-		const Range& curBatches = bc->m_phases[iPhase];
-		bc->m_batches.quickSortInternal(BatchCompare, curBatches.begin, curBatches.end - 1);
-	}
-	bc->m_phaseOrder.resize(bc->m_phases.size());
-	for (int i = 0; i < bc->m_phases.size(); ++i)
-	{
-		bc->m_phaseOrder[i] = i;
-	}
-	writeGrainSizes(bc);
+	writeOutPhaseOrder(bc);
 }
 
 //
@@ -1033,6 +1069,237 @@ static void setupSpatialGridBatchesMt(
 	btAssert(batchedConstraints->validate(constraints, bodies));
 }
 
+//
+// setupGraphColoringBatches -- generate batches by coloring the constraint graph
+//
+/*
+
+Constraints are colored so that no two constraints of the same color share a dynamic body. Static and kinematic bodies
+are not mutated when a constraint is solved, so they do not conflict. Each color becomes a phase, and since the constraints
+of a color are independent, the color can be split into batches of any size. Unlike the spatial grid, this does not depend
+on where the bodies are, so dense stacks and piles get the same number of batches per phase as spread out scenes.
+
+1. Find the maximum number of dynamic constraints (rows that repeat the same bodies count once) on any body, the graph needs
+   at least that many colors.
+
+2. Greedily color the constraints in order, using per-body bitmasks of the colors in use. Each constraint takes the first color
+   not used by its bodies that still has room, the room of a color is chosen so that the colors end up about the same size.
+
+3. Each color with enough constraints for 2 batches becomes a phase. It is split into batches of consecutive constraints
+   with about the same number of rows, at most maxBatchSize rows each, and at least one per thread if the batches stay
+   above minBatchSize.
+
+4. Constraints of small colors, and constraints of bodies that already use all colors, are put in a last phase with a single batch.
+*/
+//
+static void setupGraphColoringBatches(
+	btBatchedConstraints* batchedConstraints,
+	btAlignedObjectArray<char>* scratchMemory,
+	btConstraintArray* constraints,
+	const btAlignedObjectArray<btSolverBody>& bodies,
+	int minBatchSize,
+	int maxBatchSize)
+{
+	BT_PROFILE("setupGraphColoringBatches");
+	typedef btBatchedConstraints::Range Range;
+	const int maxNumColors = 32;
+	const int kSerialColor = -1;
+	int numConstraints = constraints->size();
+	int numConstraintRows = constraints->size();
+	int numBodies = bodies.size();
+
+	bool* bodyDynamicFlags = NULL;
+	unsigned int* bodyColorMasks = NULL;
+	btBatchedConstraintInfo* conInfos = NULL;
+	int* constraintColors = NULL;
+	int* colorConstraints = NULL;
+	{
+		PreallocatedMemoryHelper<5> memHelper;
+		memHelper.addChunk((void**)&bodyDynamicFlags, sizeof(bool) * numBodies);
+		memHelper.addChunk((void**)&bodyColorMasks, sizeof(unsigned int) * numBodies);
+		memHelper.addChunk((void**)&conInfos, sizeof(btBatchedConstraintInfo) * numConstraints);
+		memHelper.addChunk((void**)&constraintColors, sizeof(int) * numConstraints);
+		memHelper.addChunk((void**)&colorConstraints, sizeof(int) * numConstraints);
+		size_t scratchSize = memHelper.getSizeToAllocate();
+		// if we need to reallocate
+		if (static_cast<size_t>(scratchMemory->capacity()) < scratchSize)
+		{
+			// allocate 6.25% extra to avoid repeated reallocs
+			scratchMemory->reserve(scratchSize + scratchSize / 16);
+		}
+		scratchMemory->resizeNoInitialize(scratchSize);
+		char* memPtr = &scratchMemory->at(0);
+		memHelper.setChunkPointers(memPtr);
+	}
+
+	numConstraints = initBatchedConstraintInfo(conInfos, constraints);
+
+	// count the dynamic constraints of each body, the masks are used as counters first
+	for (int iBody = 0; iBody < numBodies; ++iBody)
+	{
+		bodyDynamicFlags[iBody] = (bodies[iBody].internalGetInvMass().x() > btScalar(0));
+		bodyColorMasks[iBody] = 0;
+	}
+	unsigned int maxBodyConstraints = 1;
+	for (int iCon = 0; iCon < numConstraints; ++iCon)
+	{
+		const btBatchedConstraintInfo& con = conInfos[iCon];
+		for (int i = 0; i < 2; ++i)
+		{
+			int iBody = con.bodyIds[i];
+			if (bodyDynamicFlags[iBody])
+			{
+				maxBodyConstraints = btMax(maxBodyConstraints, ++bodyColorMasks[iBody]);
+			}
+		}
+	}
+	for (int iBody = 0; iBody < numBodies; ++iBody)
+	{
+		bodyColorMasks[iBody] = 0;
+	}
+
+	// allow a quarter more than an even split, fewer colors means fewer phases
+	int numTargetColors = btMin(int(maxBodyConstraints) + 1, maxNumColors);
+	int colorCapacity = (numConstraintRows + numConstraintRows / 4) / numTargetColors + 1;
+	int colorRows[maxNumColors];
+	int colorCounts[maxNumColors];
+	for (int iColor = 0; iColor < maxNumColors; ++iColor)
+	{
+		colorRows[iColor] = 0;
+		colorCounts[iColor] = 0;
+	}
+	for (int iCon = 0; iCon < numConstraints; ++iCon)
+	{
+		const btBatchedConstraintInfo& con = conInfos[iCon];
+		int iBody0 = con.bodyIds[0];
+		int iBody1 = con.bodyIds[1];
+		unsigned int usedColors = 0;
+		if (bodyDynamicFlags[iBody0])
+		{
+			usedColors |= bodyColorMasks[iBody0];
+		}
+		if (bodyDynamicFlags[iBody1])
+		{
+			usedColors |= bodyColorMasks[iBody1];
+		}
+		int color = kSerialColor;
+		int leastRowsColor = kSerialColor;
+		for (int iColor = 0; iColor < maxNumColors; ++iColor)
+		{
+			if ((usedColors & (1u << iColor)) == 0)
+			{
+				if (colorRows[iColor] + con.numConstraintRows <= colorCapacity)
+				{
+					color = iColor;
+					break;
+				}
+				if (leastRowsColor == kSerialColor || colorRows[iColor] < colorRows[leastRowsColor])
+				{
+					leastRowsColor = iColor;
+				}
+			}
+		}
+		if (color == kSerialColor)
+		{
+			color = leastRowsColor;
+		}
+		constraintColors[iCon] = color;
+		if (color != kSerialColor)
+		{
+			unsigned int colorBit = 1u << color;
+			bodyColorMasks[iBody0] |= colorBit;
+			bodyColorMasks[iBody1] |= colorBit;
+			colorRows[color] += con.numConstraintRows;
+			colorCounts[color]++;
+		}
+	}
+
+	// colors too small for 2 batches are solved in the serial phase
+	int numThreads = btGetTaskScheduler()->getNumThreads();
+	int colorBegin[maxNumColors + 1];
+	int serialBegin = 0;
+	for (int iColor = 0; iColor < maxNumColors; ++iColor)
+	{
+		if (colorRows[iColor] < 2 * minBatchSize)
+		{
+			colorCounts[iColor] = 0;
+		}
+		colorBegin[iColor] = serialBegin;
+		serialBegin += colorCounts[iColor];
+	}
+	colorBegin[maxNumColors] = serialBegin;
+	{
+		int serialEnd = serialBegin;
+		int colorEnd[maxNumColors];
+		for (int iColor = 0; iColor < maxNumColors; ++iColor)
+		{
+			colorEnd[iColor] = colorBegin[iColor];
+		}
+		for (int iCon = 0; iCon < numConstraints; ++iCon)
+		{
+			int color = constraintColors[iCon];
+			if (color != kSerialColor && colorCounts[color] > 0)
+			{
+				colorConstraints[colorEnd[color]++] = iCon;
+			}
+			else
+			{
+				colorConstraints[serialEnd++] = iCon;
+			}
+		}
+		btAssert(serialEnd == numConstraints);
+	}
+
+	btBatchedConstraints* bc = batchedConstraints;
+	bc->m_constraintIndices.resizeNoInitialize(numConstraintRows);
+	bc->m_batches.resizeNoInitialize(0);
+	bc->m_phases.resizeNoInitialize(0);
+	int iConstraintRow = 0;
+	for (int iColor = 0; iColor <= maxNumColors; ++iColor)
+	{
+		int begin = colorBegin[iColor];
+		int end = (iColor < maxNumColors) ? colorBegin[iColor + 1] : numConstraints;
+		if (begin == end)
+		{
+			continue;
+		}
+		int numRows = (iColor < maxNumColors) ? colorRows[iColor] : numConstraintRows - iConstraintRow;
+		int numBatches = 1;
+		if (iColor < maxNumColors)
+		{
+			numBatches = (numRows + maxBatchSize - 1) / maxBatchSize;
+			numBatches = btMax(numBatches, btMin(numThreads, numRows / minBatchSize));
+		}
+		int phaseBegin = bc->m_batches.size();
+		int phaseRowBegin = iConstraintRow;
+		int batchBegin = iConstraintRow;
+		for (int i = begin; i < end; ++i)
+		{
+			const btBatchedConstraintInfo& con = conInfos[colorConstraints[i]];
+			for (int iRow = 0; iRow < con.numConstraintRows; ++iRow)
+			{
+				bc->m_constraintIndices[iConstraintRow++] = con.constraintIndex + iRow;
+			}
+			// close the batch when it reaches its share of the rows of the phase
+			int iBatch = bc->m_batches.size() - phaseBegin;
+			if (iBatch < numBatches - 1 && iConstraintRow - phaseRowBegin >= (numRows * (iBatch + 1)) / numBatches)
+			{
+				bc->m_batches.push_back(Range(batchBegin, iConstraintRow));
+				batchBegin = iConstraintRow;
+			}
+		}
+		if (iConstraintRow > batchBegin)
+		{
+			bc->m_batches.push_back(Range(batchBegin, iConstraintRow));
+		}
+		bc->m_phases.push_back(Range(phaseBegin, bc->m_batches.size()));
+	}
+	btAssert(iConstraintRow == numConstraintRows);
+
+	writeOutPhaseOrder(bc);
+	btAssert(batchedConstraints->validate(constraints, bodies));
+}
+
 static void setupSingleBatch(
 	btBatchedConstraints* bc,
 	int numConstraints)
@@ -1070,8 +1337,15 @@ void btBatchedConstraints::setup(
 {
 	if (constraints->size() >= minBatchSize * 4)
 	{
-		bool use2DGrid = batchingMethod == BATCHING_METHOD_SPATIAL_GRID_2D;
-		setupSpatialGridBatchesMt(this, scratchMemory, constraints, bodies, minBatchSize, maxBatchSize, use2DGrid);
+		if (batchingMethod == BATCHING_METHOD_GRAPH_COLORING)
+		{
+			setupGraphColoringBatches(this, scratchMemory, constraints, bodies, minBatchSize, maxBatchSize);
+		}
+		else
+		{
+			bool use2DGrid = batchingMethod == BATCHING_METHOD_SPATIAL_GRID_2D;
+			setupSpatialGridBatchesMt(this, scratchMemory, constraints, bodies, minBatchSize, maxBatchSize, use2DGrid);
+		}
 		if (s_debugDrawBatches)
 		{
 			debugDrawAllBatches(this, constraints, bodies);
@@ -29,6 +29,7 @@ struct btBatchedConstraints
 	{
 		BATCHING_METHOD_SPATIAL_GRID_2D,
 		BATCHING_METHOD_SPATIAL_GRID_3D,
+		BATCHING_METHOD_GRAPH_COLORING,  // independent of body positions, for dense stacks and piles
 		BATCHING_METHOD_COUNT
 	};
 	struct Range
@@ -39,6 +40,18 @@ struct btBatchedConstraints
 		Range() : begin(0), end(0) {}
 		Range(int _beg, int _end) : begin(_beg), end(_end) {}
 	};
+	// sizes of the phases and batches of the last setup, to tune the min and max batch sizes
+	struct Statistics
+	{
+		int m_numRows;  // solver constraint rows, several for a joint
+		int m_numPhases;
+		int m_numBatches;
+		int m_minBatchSize;
+		int m_maxBatchSize;
+		int m_minBatchesPerPhase;
+		int m_maxBatchesPerPhase;
+		int m_numSerialRows;  // rows in phases of a single batch, which are solved by one thread
+	};
 
 	btAlignedObjectArray<int> m_constraintIndices;
 	btAlignedObjectArray<Range> m_batches;        // each batch is a range of indices in the m_constraintIndices array
@@ -57,6 +70,7 @@ struct btBatchedConstraints
 			   int maxBatchSize,
 			   btAlignedObjectArray<char>* scratchMemory);
 	bool validate(btConstraintArray* constraints, const btAlignedObjectArray<btSolverBody>& bodies) const;
+	void getStatistics(Statistics* stats) const;
 };
 
 #endif  // BT_BATCHED_CONSTRAINTS_H
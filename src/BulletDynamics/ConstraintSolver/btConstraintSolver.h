@@ -27,6 +27,7 @@ struct btBroadphaseProxy;
 class btIDebugDraw;
 class btStackAlloc;
 class btDispatcher;
+struct btSolverAnalyticsData;
 /// btConstraintSolver provides solver interface
 
 enum btConstraintSolverType
@@ -54,6 +55,9 @@ public:
 	virtual void reset() = 0;
 
 	virtual btConstraintSolverType getSolverType() const = 0;
+
+	///analytics of the last solveGroup call if btContactSolverInfo::m_reportSolverAnalytics is set, 0 if the solver does not collect them
+	virtual btSolverAnalyticsData* getSolverAnalyticsData() { return 0; }
 };
 
 #endif  //BT_CONSTRAINT_SOLVER_H
@@ -32,6 +32,9 @@ enum btSolverMode
 	SOLVER_ALLOW_ZERO_LENGTH_FRICTION_DIRECTIONS = 1024,
 	SOLVER_DISABLE_IMPLICIT_CONE_FRICTION = 2048,
 	SOLVER_USE_ARTICULATED_WARMSTARTING = 4096,
+	SOLVER_SOA_CONTACT_ROWS = 8192,  //btSequentialImpulseConstraintSolverMt solves the contact and friction rows of a batch 4 at a time
+	SOLVER_PERSISTENT_POOLS = 16384,  //the solver pools keep some spare capacity and the body to solver body mapping is kept across solver calls
+	SOLVER_ADAPTIVE_ISLAND_ITERATIONS = 32768,  //every island of a solver call stops iterating once its residual reaches m_leastSquaresResidualThreshold
 };
 
 struct btContactSolverInfoData
@@ -68,7 +71,7 @@ struct btContactSolverInfoData
 	btScalar m_restitutionVelocityThreshold;
 	bool m_jointFeedbackInWorldSpace;
 	bool m_jointFeedbackInJointFrame;
-	int m_reportSolverAnalytics;
+	int m_reportSolverAnalytics;  //1: collect btSolverAnalyticsData per solver call and island, 2: also the residual of every iteration
 	int m_numNonContactInnerIterations;
 };
 
@@ -41,6 +41,9 @@ protected:
 
 	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer);
 
+	// the conjugate directions couple all rows of the solver call, so SOLVER_ADAPTIVE_ISLAND_ITERATIONS does not apply
+	virtual void setupSolverIslands(const btContactSolverInfo& /*infoGlobal*/) {}
+
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
@@ -0,0 +1,360 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btNNCGConstraintSolverMt.h"
+
+#include "LinearMath/btQuickprof.h"
+
+btNNCGConstraintSolverMt::btNNCGConstraintSolverMt()
+	: m_deltafLengthSqrPrev(0),
+	  m_onlyForNoneContact(false)
+{
+}
+
+btNNCGConstraintSolverMt::~btNNCGConstraintSolverMt()
+{
+}
+
+btScalar btNNCGConstraintSolverMt::solveGroupCacheFriendlySetup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
+{
+	// the conjugate step changes the applied impulses in the pools, which the SOLVER_SOA_CONTACT_ROWS packets would not see
+	btContactSolverInfo info = infoGlobal;
+	info.m_solverMode &= ~SOLVER_SOA_CONTACT_ROWS;
+	btScalar val = btSequentialImpulseConstraintSolverMt::solveGroupCacheFriendlySetup(bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, info, debugDrawer);
+
+	m_pNC.resizeNoInitialize(m_tmpSolverNonContactConstraintPool.size());
+	m_pC.resizeNoInitialize(m_tmpSolverContactConstraintPool.size());
+	m_pCF.resizeNoInitialize(m_tmpSolverContactFrictionConstraintPool.size());
+	m_pCRF.resizeNoInitialize(m_tmpSolverContactRollingFrictionConstraintPool.size());
+
+	m_deltafNC.resizeNoInitialize(m_tmpSolverNonContactConstraintPool.size());
+	m_deltafC.resizeNoInitialize(m_tmpSolverContactConstraintPool.size());
+	m_deltafCF.resizeNoInitialize(m_tmpSolverContactFrictionConstraintPool.size());
+	m_deltafCRF.resizeNoInitialize(m_tmpSolverContactRollingFrictionConstraintPool.size());
+
+	return val;
+}
+
+btScalar btNNCGConstraintSolverMt::internalComputeDeltaf(btConstraintArray& rows, btAlignedObjectArray<btScalar>& deltaf, int iBegin, int iEnd, bool storeImpulses)
+{
+	btScalar deltaflengthsqr = 0;
+	if (storeImpulses)
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			deltaf[i] = rows[i].m_appliedImpulse;
+		}
+	}
+	else
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			// the same as the return value of resolveSingleConstraintRowGeneric
+			const btSolverConstraint& c = rows[i];
+			btScalar df = c.m_jacDiagABInv != btScalar(0) ? (c.m_appliedImpulse - deltaf[i]) / c.m_jacDiagABInv : btScalar(0);
+			deltaf[i] = df;
+			deltaflengthsqr += df * df;
+		}
+	}
+	return deltaflengthsqr;
+}
+
+struct NNCGComputeDeltafLoop : public btIParallelForBody
+{
+	btNNCGConstraintSolverMt* m_solver;
+	btConstraintArray* m_rows;
+	btAlignedObjectArray<btScalar>* m_deltaf;
+	btAlignedObjectArray<btScalar>* m_blockSums;
+	bool m_storeImpulses;
+	int m_blockSize;
+
+	NNCGComputeDeltafLoop(btNNCGConstraintSolverMt* solver, btConstraintArray* rows, btAlignedObjectArray<btScalar>* deltaf, btAlignedObjectArray<btScalar>* blockSums, bool storeImpulses, int blockSize)
+	{
+		m_solver = solver;
+		m_rows = rows;
+		m_deltaf = deltaf;
+		m_blockSums = blockSums;
+		m_storeImpulses = storeImpulses;
+		m_blockSize = blockSize;
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		BT_PROFILE("NNCGComputeDeltafLoop");
+		for (int iBlock = iBegin; iBlock < iEnd; ++iBlock)
+		{
+			int iRowBegin = iBlock * m_blockSize;
+			int iRowEnd = btMin(iRowBegin + m_blockSize, m_rows->size());
+			(*m_blockSums)[iBlock] = m_solver->internalComputeDeltaf(*m_rows, *m_deltaf, iRowBegin, iRowEnd, m_storeImpulses);
+		}
+	}
+};
+
+btScalar btNNCGConstraintSolverMt::computeDeltaf(btConstraintArray& rows, btAlignedObjectArray<btScalar>& deltaf, bool storeImpulses)
+{
+	// beta depends on the sum, so it is summed over fixed blocks of rows in a fixed order instead of with btParallelSum,
+	// which would make the solution depend on how the task scheduler splits the loop
+	int numBlocks = (rows.size() + DELTAF_BLOCK_SIZE - 1) / DELTAF_BLOCK_SIZE;
+	m_deltafBlockSums.resizeNoInitialize(numBlocks);
+	NNCGComputeDeltafLoop loop(this, &rows, &deltaf, &m_deltafBlockSums, storeImpulses, DELTAF_BLOCK_SIZE);
+	if (m_useBatching)
+	{
+		int grainSize = 1;
+		btParallelFor(0, numBlocks, grainSize, loop);
+	}
+	else
+	{
+		loop.forLoop(0, numBlocks);
+	}
+	btScalar deltaflengthsqr = 0;
+	for (int iBlock = 0; iBlock < numBlocks; ++iBlock)
+	{
+		deltaflengthsqr += m_deltafBlockSums[iBlock];
+	}
+	return deltaflengthsqr;
+}
+
+static SIMD_FORCE_INLINE void applyConjugateDirection(btSolverBody* bodyPool, btSolverConstraint& c, btScalar& p, btScalar deltaf, btScalar beta)
+{
+	btScalar additionaldeltaimpulse = beta * p;
+	c.m_appliedImpulse = btScalar(c.m_appliedImpulse) + additionaldeltaimpulse;
+	p = beta * p + deltaf;
+	btSolverBody& body1 = bodyPool[c.m_solverBodyIdA];
+	btSolverBody& body2 = bodyPool[c.m_solverBodyIdB];
+	body1.internalApplyImpulse(c.m_contactNormal1 * body1.internalGetInvMass(), c.m_angularComponentA, additionaldeltaimpulse);
+	body2.internalApplyImpulse(c.m_contactNormal2 * body2.internalGetInvMass(), c.m_angularComponentB, additionaldeltaimpulse);
+}
+
+void btNNCGConstraintSolverMt::internalApplyConjugateJointDirections(const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd, int iteration, btScalar beta)
+{
+	for (int iiCons = batchBegin; iiCons < batchEnd; ++iiCons)
+	{
+		int iCons = consIndices[iiCons];
+		btSolverConstraint& constraint = m_tmpSolverNonContactConstraintPool[iCons];
+		if (iteration < constraint.m_overrideNumSolverIterations)
+		{
+			applyConjugateDirection(&m_tmpSolverBodyPool[0], constraint, m_pNC[iCons], m_deltafNC[iCons], beta);
+		}
+	}
+}
+
+void btNNCGConstraintSolverMt::internalApplyConjugateContactDirections(const btAlignedObjectArray<int>& contactIndices, int batchBegin, int batchEnd, btScalar beta)
+{
+	// the friction and rolling friction rows of a contact have the bodies of the contact
+	for (int iiCons = batchBegin; iiCons < batchEnd; ++iiCons)
+	{
+		int iContact = contactIndices[iiCons];
+		applyConjugateDirection(&m_tmpSolverBodyPool[0], m_tmpSolverContactConstraintPool[iContact], m_pC[iContact], m_deltafC[iContact], beta);
+
+		int iBegin = iContact * m_numFrictionDirections;
+		int iEnd = iBegin + m_numFrictionDirections;
+		for (int iFriction = iBegin; iFriction < iEnd; ++iFriction)
+		{
+			btAssert(m_tmpSolverContactFrictionConstraintPool[iFriction].m_frictionIndex == iContact);
+			applyConjugateDirection(&m_tmpSolverBodyPool[0], m_tmpSolverContactFrictionConstraintPool[iFriction], m_pCF[iFriction], m_deltafCF[iFriction], beta);
+		}
+
+		int iFirstRollingFriction = m_rollingFrictionIndexTable[iContact];
+		if (iFirstRollingFriction >= 0)
+		{
+			for (int iRollingFric = iFirstRollingFriction; iRollingFric < iFirstRollingFriction + 3 && iRollingFric < m_tmpSolverContactRollingFrictionConstraintPool.size(); ++iRollingFric)
+			{
+				btSolverConstraint& rollingFrictionConstraint = m_tmpSolverContactRollingFrictionConstraintPool[iRollingFric];
+				if (rollingFrictionConstraint.m_frictionIndex != iContact)
+				{
+					break;
+				}
+				applyConjugateDirection(&m_tmpSolverBodyPool[0], rollingFrictionConstraint, m_pCRF[iRollingFric], m_deltafCRF[iRollingFric], beta);
+			}
+		}
+	}
+}
+
+struct NNCGConjugateJointLoop : public btIParallelForBody
+{
+	btNNCGConstraintSolverMt* m_solver;
+	const btBatchedConstraints* m_bc;
+	int m_iteration;
+	btScalar m_beta;
+
+	NNCGConjugateJointLoop(btNNCGConstraintSolverMt* solver, const btBatchedConstraints* bc, int iteration, btScalar beta)
+	{
+		m_solver = solver;
+		m_bc = bc;
+		m_iteration = iteration;
+		m_beta = beta;
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		BT_PROFILE("NNCGConjugateJointLoop");
+		for (int iBatch = iBegin; iBatch < iEnd; ++iBatch)
+		{
+			const btBatchedConstraints::Range& batch = m_bc->m_batches[iBatch];
+			m_solver->internalApplyConjugateJointDirections(m_bc->m_constraintIndices, batch.begin, batch.end, m_iteration, m_beta);
+		}
+	}
+};
+
+struct NNCGConjugateContactLoop : public btIParallelForBody
+{
+	btNNCGConstraintSolverMt* m_solver;
+	const btBatchedConstraints* m_bc;
+	btScalar m_beta;
+
+	NNCGConjugateContactLoop(btNNCGConstraintSolverMt* solver, const btBatchedConstraints* bc, btScalar beta)
+	{
+		m_solver = solver;
+		m_bc = bc;
+		m_beta = beta;
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		BT_PROFILE("NNCGConjugateContactLoop");
+		for (int iBatch = iBegin; iBatch < iEnd; ++iBatch)
+		{
+			const btBatchedConstraints::Range& batch = m_bc->m_batches[iBatch];
+			m_solver->internalApplyConjugateContactDirections(m_bc->m_constraintIndices, batch.begin, batch.end, m_beta);
+		}
+	}
+};
+
+void btNNCGConstraintSolverMt::applyConjugateDirections(int iteration, btScalar beta, const btContactSolverInfo& infoGlobal)
+{
+	BT_PROFILE("applyConjugateDirections");
+	bool applyToContacts = !m_onlyForNoneContact && iteration < infoGlobal.m_numIterations;
+	if (m_useBatching)
+	{
+		// the phases of the sweep, so that no two threads write the same body
+		{
+			const btBatchedConstraints& batchedCons = m_batchedJointConstraints;
+			NNCGConjugateJointLoop loop(this, &batchedCons, iteration, beta);
+			for (int iiPhase = 0; iiPhase < batchedCons.m_phases.size(); ++iiPhase)
+			{
+				int iPhase = batchedCons.m_phaseOrder[iiPhase];
+				const btBatchedConstraints::Range& phase = batchedCons.m_phases[iPhase];
+				int grainSize = 1;
+				btParallelFor(phase.begin, phase.end, grainSize, loop);
+			}
+		}
+		if (applyToContacts)
+		{
+			const btBatchedConstraints& batchedCons = m_batchedContactConstraints;
+			NNCGConjugateContactLoop loop(this, &batchedCons, beta);
+			for (int iiPhase = 0; iiPhase < batchedCons.m_phases.size(); ++iiPhase)
+			{
+				int iPhase = batchedCons.m_phaseOrder[iiPhase];
+				const btBatchedConstraints::Range& phase = batchedCons.m_phases[iPhase];
+				int grainSize = batchedCons.m_phaseGrainSize[iPhase];
+				btParallelFor(phase.begin, phase.end, grainSize, loop);
+			}
+		}
+	}
+	else
+	{
+		btSolverBody* bodyPool = m_tmpSolverBodyPool.size() ? &m_tmpSolverBodyPool[0] : NULL;
+		for (int j = 0; j < m_tmpSolverNonContactConstraintPool.size(); j++)
+		{
+			btSolverConstraint& constraint = m_tmpSolverNonContactConstraintPool[j];
+			if (iteration < constraint.m_overrideNumSolverIterations)
+			{
+				applyConjugateDirection(bodyPool, constraint, m_pNC[j], m_deltafNC[j], beta);
+			}
+		}
+		if (applyToContacts)
+		{
+			for (int j = 0; j < m_tmpSolverContactConstraintPool.size(); j++)
+				applyConjugateDirection(bodyPool, m_tmpSolverContactConstraintPool[j], m_pC[j], m_deltafC[j], beta);
+			for (int j = 0; j < m_tmpSolverContactFrictionConstraintPool.size(); j++)
+				applyConjugateDirection(bodyPool, m_tmpSolverContactFrictionConstraintPool[j], m_pCF[j], m_deltafCF[j], beta);
+			for (int j = 0; j < m_tmpSolverContactRollingFrictionConstraintPool.size(); j++)
+				applyConjugateDirection(bodyPool, m_tmpSolverContactRollingFrictionConstraintPool[j], m_pCRF[j], m_deltafCRF[j], beta);
+		}
+	}
+}
+
+btScalar btNNCGConstraintSolverMt::solveSingleIteration(int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
+{
+	BT_PROFILE("solveSingleIterationNNCGMt");
+	computeDeltaf(m_tmpSolverNonContactConstraintPool, m_deltafNC, true);
+	computeDeltaf(m_tmpSolverContactConstraintPool, m_deltafC, true);
+	computeDeltaf(m_tmpSolverContactFrictionConstraintPool, m_deltafCF, true);
+	computeDeltaf(m_tmpSolverContactRollingFrictionConstraintPool, m_deltafCRF, true);
+
+	// projected Gauss-Seidel sweep
+	btSequentialImpulseConstraintSolverMt::solveSingleIteration(iteration, bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+
+	btScalar deltaflengthsqrNC = computeDeltaf(m_tmpSolverNonContactConstraintPool, m_deltafNC, false);
+	btScalar deltaflengthsqr = deltaflengthsqrNC;
+	deltaflengthsqr += computeDeltaf(m_tmpSolverContactConstraintPool, m_deltafC, false);
+	deltaflengthsqr += computeDeltaf(m_tmpSolverContactFrictionConstraintPool, m_deltafCF, false);
+	deltaflengthsqr += computeDeltaf(m_tmpSolverContactRollingFrictionConstraintPool, m_deltafCRF, false);
+
+	btScalar lengthSqr = m_onlyForNoneContact ? deltaflengthsqrNC : deltaflengthsqr;
+	if (iteration == 0)
+	{
+		for (int j = 0; j < m_tmpSolverNonContactConstraintPool.size(); j++) m_pNC[j] = m_deltafNC[j];
+		if (!m_onlyForNoneContact)
+		{
+			for (int j = 0; j < m_tmpSolverContactConstraintPool.size(); j++) m_pC[j] = m_deltafC[j];
+			for (int j = 0; j < m_tmpSolverContactFrictionConstraintPool.size(); j++) m_pCF[j] = m_deltafCF[j];
+			for (int j = 0; j < m_tmpSolverContactRollingFrictionConstraintPool.size(); j++) m_pCRF[j] = m_deltafCRF[j];
+		}
+	}
+	else
+	{
+		// deltaflengthsqrprev can be 0 only if the solver solved the problem exactly in the previous iteration, see btNNCGConstraintSolver
+		btScalar beta = m_deltafLengthSqrPrev > 0 ? lengthSqr / m_deltafLengthSqrPrev : 2;
+		if (beta > 1)
+		{
+			for (int j = 0; j < m_tmpSolverNonContactConstraintPool.size(); j++) m_pNC[j] = 0;
+			if (!m_onlyForNoneContact)
+			{
+				for (int j = 0; j < m_tmpSolverContactConstraintPool.size(); j++) m_pC[j] = 0;
+				for (int j = 0; j < m_tmpSolverContactFrictionConstraintPool.size(); j++) m_pCF[j] = 0;
+				for (int j = 0; j < m_tmpSolverContactRollingFrictionConstraintPool.size(); j++) m_pCRF[j] = 0;
+			}
+		}
+		else
+		{
+			applyConjugateDirections(iteration, beta, infoGlobal);
+		}
+	}
+	m_deltafLengthSqrPrev = lengthSqr;
+
+	return deltaflengthsqr;
+}
+
+btScalar btNNCGConstraintSolverMt::solveGroupCacheFriendlyFinish(btCollisionObject** bodies, int numBodies, const btContactSolverInfo& infoGlobal)
+{
+	m_pNC.resizeNoInitialize(0);
+	m_pC.resizeNoInitialize(0);
+	m_pCF.resizeNoInitialize(0);
+	m_pCRF.resizeNoInitialize(0);
+
+	m_deltafNC.resizeNoInitialize(0);
+	m_deltafC.resizeNoInitialize(0);
+	m_deltafCF.resizeNoInitialize(0);
+	m_deltafCRF.resizeNoInitialize(0);
+
+	return btSequentialImpulseConstraintSolverMt::solveGroupCacheFriendlyFinish(bodies, numBodies, infoGlobal);
+}
+
+size_t btNNCGConstraintSolverMt::getPoolMemory() const
+{
+	size_t bytes = btSequentialImpulseConstraintSolverMt::getPoolMemory();
+	bytes += (m_pNC.capacity() + m_pC.capacity() + m_pCF.capacity() + m_pCRF.capacity()) * sizeof(btScalar);
+	bytes += (m_deltafNC.capacity() + m_deltafC.capacity() + m_deltafCF.capacity() + m_deltafCRF.capacity()) * sizeof(btScalar);
+	bytes += m_deltafBlockSums.capacity() * sizeof(btScalar);
+	return bytes;
+}
@@ -0,0 +1,88 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_NNCG_CONSTRAINT_SOLVER_MT_H
+#define BT_NNCG_CONSTRAINT_SOLVER_MT_H
+
+#include "btSequentialImpulseConstraintSolverMt.h"
+
+///
+/// btNNCGConstraintSolverMt
+///
+///  A multithreaded variant of btNNCGConstraintSolver, the nonsmooth nonlinear conjugate gradient solver. Every iteration
+///  is a projected Gauss-Seidel sweep of btSequentialImpulseConstraintSolverMt, in parallel over the batches of each phase,
+///  followed by a step along the conjugate directions. The change of the impulse of every row in the sweep is taken from
+///  its applied impulse before and after the sweep. The squared lengths are summed in parallel over fixed blocks of rows,
+///  and the block sums are added in order, so the result does not depend on the number of threads.
+///  The conjugate step goes through the same phases as the sweep, so rows that share a body are never updated at the same time.
+///
+///  Islands that are too small for batching are solved in one thread, like btNNCGConstraintSolver. The solver can be used
+///  in a btConstraintSolverPoolMt.
+///
+///  The conjugate directions are kept per row, so unlike btNNCGConstraintSolver they stay with their rows when
+///  SOLVER_RANDMIZE_ORDER shuffles the rows. SOLVER_SOA_CONTACT_ROWS is ignored, because the row packets keep their own copy
+///  of the applied impulses. With m_onlyForNoneContact, the conjugate step of the joint rows is done after the sweep of the
+///  contact rows instead of before it.
+///
+ATTRIBUTE_ALIGNED16(class)
+btNNCGConstraintSolverMt : public btSequentialImpulseConstraintSolverMt
+{
+protected:
+	static const int DELTAF_BLOCK_SIZE = 512;  // rows per partial sum of the squared deltaf
+
+	btScalar m_deltafLengthSqrPrev;
+
+	btAlignedObjectArray<btScalar> m_pNC;   // p for None Contact constraints
+	btAlignedObjectArray<btScalar> m_pC;    // p for Contact constraints
+	btAlignedObjectArray<btScalar> m_pCF;   // p for ContactFriction constraints
+	btAlignedObjectArray<btScalar> m_pCRF;  // p for ContactRollingFriction constraints
+
+	//The applied impulses before the sweep, and after it the deltaf of the sweep. Indexed like the pools.
+	btAlignedObjectArray<btScalar> m_deltafNC;   // deltaf for NoneContact constraints
+	btAlignedObjectArray<btScalar> m_deltafC;    // deltaf for Contact constraints
+	btAlignedObjectArray<btScalar> m_deltafCF;   // deltaf for ContactFriction constraints
+	btAlignedObjectArray<btScalar> m_deltafCRF;  // deltaf for ContactRollingFriction constraints
+	btAlignedObjectArray<btScalar> m_deltafBlockSums;
+
+	btScalar computeDeltaf(btConstraintArray & rows, btAlignedObjectArray<btScalar> & deltaf, bool storeImpulses);
+	void applyConjugateDirections(int iteration, btScalar beta, const btContactSolverInfo& infoGlobal);
+
+	virtual btScalar solveGroupCacheFriendlyFinish(btCollisionObject * *bodies, int numBodies, const btContactSolverInfo& infoGlobal) BT_OVERRIDE;
+	virtual btScalar solveSingleIteration(int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer) BT_OVERRIDE;
+	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer) BT_OVERRIDE;
+	virtual size_t getPoolMemory() const BT_OVERRIDE;
+
+	// the conjugate directions couple all rows of the solver call, so SOLVER_ADAPTIVE_ISLAND_ITERATIONS does not apply
+	virtual void setupSolverIslands(const btContactSolverInfo& /*infoGlobal*/) BT_OVERRIDE {}
+
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btNNCGConstraintSolverMt();
+	virtual ~btNNCGConstraintSolverMt();
+
+	virtual btConstraintSolverType getSolverType() const BT_OVERRIDE
+	{
+		return BT_NNCG_SOLVER;
+	}
+
+	bool m_onlyForNoneContact;
+
+	btScalar internalComputeDeltaf(btConstraintArray & rows, btAlignedObjectArray<btScalar> & deltaf, int iBegin, int iEnd, bool storeImpulses);
+	void internalApplyConjugateJointDirections(const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd, int iteration, btScalar beta);
+	void internalApplyConjugateContactDirections(const btAlignedObjectArray<int>& contactIndices, int batchBegin, int batchEnd, btScalar beta);
+};
+
+#endif  //BT_NNCG_CONSTRAINT_SOLVER_MT_H
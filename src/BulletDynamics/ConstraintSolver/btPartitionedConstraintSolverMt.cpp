@@ -0,0 +1,578 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btPartitionedConstraintSolverMt.h"
+
+#include "LinearMath/btQuickprof.h"
+
+bool btPartitionedConstraintSolverMt::s_allowNestedParallelForLoops = false;  // some task schedulers don't like nested loops
+int btPartitionedConstraintSolverMt::s_minimumContactManifoldsForPartitioning = 250;
+int btPartitionedConstraintSolverMt::s_numPartitions = 16;
+
+btPartitionedConstraintSolverMt::btPartitionedConstraintSolverMt()
+{
+	m_numPartitions = 0;
+	m_numOriginalSolverBodies = 0;
+}
+
+btPartitionedConstraintSolverMt::~btPartitionedConstraintSolverMt()
+{
+}
+
+bool btPartitionedConstraintSolverMt::useParallelLoops() const
+{
+	return s_allowNestedParallelForLoops || !btThreadsAreRunning();
+}
+
+struct btPartitionSortKeyPredicate
+{
+	bool operator()(const btPartitionedConstraintSolverMt::SortKey& a, const btPartitionedConstraintSolverMt::SortKey& b) const
+	{
+		// ties are broken by the solver body, so the partitions are the same on every platform
+		return a.m_key < b.m_key || (a.m_key == b.m_key && a.m_solverBodyId < b.m_solverBodyId);
+	}
+};
+
+void btPartitionedConstraintSolverMt::splitBodies(int iBegin, int iEnd, int firstPartition, int numPartitions)
+{
+	if (numPartitions == 1)
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_bodyPartitions[m_sortKeys[i].m_solverBodyId] = firstPartition;
+		}
+		return;
+	}
+	// split along the longest axis of the bounds of the body positions, with the number of bodies
+	// on each side proportional to the number of partitions on that side
+	btVector3 bboxMin(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+	btVector3 bboxMax = -bboxMin;
+	for (int i = iBegin; i < iEnd; ++i)
+	{
+		const btVector3& pos = m_tmpSolverBodyPool[m_sortKeys[i].m_solverBodyId].m_worldTransform.getOrigin();
+		bboxMin.setMin(pos);
+		bboxMax.setMax(pos);
+	}
+	int axis = (bboxMax - bboxMin).maxAxis();
+	for (int i = iBegin; i < iEnd; ++i)
+	{
+		SortKey& key = m_sortKeys[i];
+		key.m_key = m_tmpSolverBodyPool[key.m_solverBodyId].m_worldTransform.getOrigin()[axis];
+	}
+	m_sortKeys.quickSortInternal(btPartitionSortKeyPredicate(), iBegin, iEnd - 1);
+
+	int numPartitionsLeft = numPartitions / 2;
+	int iSplit = iBegin + (iEnd - iBegin) * numPartitionsLeft / numPartitions;
+	splitBodies(iBegin, iSplit, firstPartition, numPartitionsLeft);
+	splitBodies(iSplit, iEnd, firstPartition + numPartitionsLeft, numPartitions - numPartitionsLeft);
+}
+
+int btPartitionedConstraintSolverMt::getBodyCopy(int solverBodyId, int partition)
+{
+	int firstCopyId = m_numOriginalSolverBodies;
+	for (int copyId = m_firstBodyCopy[solverBodyId]; copyId >= 0; copyId = m_nextBodyCopy[copyId - firstCopyId])
+	{
+		if (m_bodyCopyPartitions[copyId - firstCopyId] == partition)
+		{
+			return copyId;
+		}
+	}
+	if (m_firstBodyCopy[solverBodyId] < 0)
+	{
+		m_sharedBodies.push_back(solverBodyId);
+	}
+	int copyId = firstCopyId + m_nextBodyCopy.size();
+	m_nextBodyCopy.push_back(m_firstBodyCopy[solverBodyId]);
+	m_bodyCopyPartitions.push_back(partition);
+	m_firstBodyCopy[solverBodyId] = copyId;
+	return copyId;
+}
+
+void btPartitionedConstraintSolverMt::assignRows(btConstraintArray& pool, PartitionRows& partitionRows, int solverMode)
+{
+	int numRows = pool.size();
+	resizeSolverPool(m_rowPartitions, numRows, solverMode);
+	resizeSolverPool(partitionRows.m_rowOffsets, m_numPartitions + 1, solverMode);
+	resizeSolverPool(partitionRows.m_rows, numRows, solverMode);
+	for (int i = 0; i <= m_numPartitions; ++i)
+	{
+		partitionRows.m_rowOffsets[i] = 0;
+	}
+	for (int iRow = 0; iRow < numRows; ++iRow)
+	{
+		btSolverConstraint& row = pool[iRow];
+		int solverBodyIds[2] = {row.m_solverBodyIdA, row.m_solverBodyIdB};
+		// a row goes to the partition of body A, or of body B if A has no mass
+		int partition = m_bodyPartitions[solverBodyIds[0]];
+		if (partition < 0)
+		{
+			partition = btMax(m_bodyPartitions[solverBodyIds[1]], 0);
+		}
+		for (int i = 0; i < 2; ++i)
+		{
+			int solverBodyId = solverBodyIds[i];
+			int bodyPartition = m_bodyPartitions[solverBodyId];
+			if (bodyPartition == partition)
+			{
+				m_bodyUsedByPartition[solverBodyId] = 1;
+			}
+			else if (bodyPartition >= 0)
+			{
+				solverBodyIds[i] = getBodyCopy(solverBodyId, partition);
+			}
+		}
+		row.m_solverBodyIdA = solverBodyIds[0];
+		row.m_solverBodyIdB = solverBodyIds[1];
+		m_rowPartitions[iRow] = partition;
+		partitionRows.m_rowOffsets[partition + 1]++;
+	}
+	for (int i = 0; i < m_numPartitions; ++i)
+	{
+		partitionRows.m_rowOffsets[i + 1] += partitionRows.m_rowOffsets[i];
+	}
+	// counting sort, keeps the order of the rows within a partition
+	for (int iRow = 0; iRow < numRows; ++iRow)
+	{
+		int partition = m_rowPartitions[iRow];
+		partitionRows.m_rows[partitionRows.m_rowOffsets[partition]++] = iRow;
+	}
+	for (int i = m_numPartitions; i > 0; --i)
+	{
+		partitionRows.m_rowOffsets[i] = partitionRows.m_rowOffsets[i - 1];
+	}
+	partitionRows.m_rowOffsets[0] = 0;
+}
+
+void btPartitionedConstraintSolverMt::setupPartitions(const btContactSolverInfo& infoGlobal)
+{
+	BT_PROFILE("setupPartitions");
+	int solverMode = infoGlobal.m_solverMode;
+	int numSolverBodies = m_tmpSolverBodyPool.size();
+	m_numOriginalSolverBodies = numSolverBodies;
+	resizeSolverPool(m_bodyPartitions, numSolverBodies, solverMode);
+	resizeSolverPool(m_bodyUsedByPartition, numSolverBodies, solverMode);
+	resizeSolverPool(m_firstBodyCopy, numSolverBodies, solverMode);
+	resizeSolverPool(m_sortKeys, numSolverBodies, solverMode);
+	int numDynamicBodies = 0;
+	for (int i = 0; i < numSolverBodies; ++i)
+	{
+		m_bodyPartitions[i] = -1;
+		m_bodyUsedByPartition[i] = 0;
+		m_firstBodyCopy[i] = -1;
+		if (isDynamicSolverBody(i))
+		{
+			m_sortKeys[numDynamicBodies].m_solverBodyId = i;
+			numDynamicBodies++;
+		}
+	}
+	m_sortKeys.resizeNoInitialize(numDynamicBodies);
+	m_numPartitions = btMin(s_numPartitions, numDynamicBodies);
+	if (m_numPartitions < 2)
+	{
+		m_numPartitions = 0;
+		return;
+	}
+	splitBodies(0, numDynamicBodies, 0, m_numPartitions);
+
+	m_nextBodyCopy.resizeNoInitialize(0);
+	m_bodyCopyPartitions.resizeNoInitialize(0);
+	assignRows(m_tmpSolverNonContactConstraintPool, m_jointRows, solverMode);
+	assignRows(m_tmpSolverContactConstraintPool, m_contactRows, solverMode);
+	assignRows(m_tmpSolverContactFrictionConstraintPool, m_frictionRows, solverMode);
+	assignRows(m_tmpSolverContactRollingFrictionConstraintPool, m_rollingFrictionRows, solverMode);
+
+	// the copies start with the velocities of their body, including the warmstarting impulses
+	int numAllSolverBodies = numSolverBodies + m_nextBodyCopy.size();
+	resizeSolverPool(m_tmpSolverBodyPool, numAllSolverBodies, solverMode);
+	resizeSolverPool(m_bodyShareCounts, numAllSolverBodies, solverMode);
+	for (int i = 0; i < numAllSolverBodies; ++i)
+	{
+		m_bodyShareCounts[i] = 1;
+	}
+	for (int i = 0; i < m_sharedBodies.size(); ++i)
+	{
+		int solverBodyId = m_sharedBodies[i];
+		int shareCount = m_bodyUsedByPartition[solverBodyId] ? 1 : 0;
+		for (int copyId = m_firstBodyCopy[solverBodyId]; copyId >= 0; copyId = m_nextBodyCopy[copyId - numSolverBodies])
+		{
+			m_tmpSolverBodyPool[copyId] = m_tmpSolverBodyPool[solverBodyId];
+			shareCount++;
+		}
+		m_bodyShareCounts[solverBodyId] = shareCount;
+		for (int copyId = m_firstBodyCopy[solverBodyId]; copyId >= 0; copyId = m_nextBodyCopy[copyId - numSolverBodies])
+		{
+			m_bodyShareCounts[copyId] = shareCount;
+		}
+	}
+
+	// mass splitting: a body shared by n partitions gets n times its inverse mass in each of them,
+	// so the average of the copies converges to the velocities of the unpartitioned island
+	splitMasses(m_tmpSolverNonContactConstraintPool);
+	splitMasses(m_tmpSolverContactConstraintPool);
+	splitMasses(m_tmpSolverContactFrictionConstraintPool);
+	splitMasses(m_tmpSolverContactRollingFrictionConstraintPool);
+	for (int i = 0; i < numAllSolverBodies; ++i)
+	{
+		if (m_bodyShareCounts[i] > 1)
+		{
+			m_tmpSolverBodyPool[i].m_invMass *= btScalar(m_bodyShareCounts[i]);
+		}
+	}
+	resizeSolverPool(m_partitionResiduals, m_numPartitions, solverMode);
+}
+
+void btPartitionedConstraintSolverMt::splitMasses(btConstraintArray& pool)
+{
+	for (int iRow = 0; iRow < pool.size(); ++iRow)
+	{
+		btSolverConstraint& row = pool[iRow];
+		int shareCountA = m_bodyShareCounts[row.m_solverBodyIdA];
+		int shareCountB = m_bodyShareCounts[row.m_solverBodyIdB];
+		if (shareCountA == 1 && shareCountB == 1)
+		{
+			continue;
+		}
+		// inverse effective mass of each side along the row, before the masses are split
+		const btSolverBody& bodyA = m_tmpSolverBodyPool[row.m_solverBodyIdA];
+		const btSolverBody& bodyB = m_tmpSolverBodyPool[row.m_solverBodyIdB];
+		btScalar invMassA = row.m_contactNormal1.dot(row.m_contactNormal1 * bodyA.m_invMass) + row.m_relpos1CrossNormal.dot(row.m_angularComponentA);
+		btScalar invMassB = row.m_contactNormal2.dot(row.m_contactNormal2 * bodyB.m_invMass) + row.m_relpos2CrossNormal.dot(row.m_angularComponentB);
+		btScalar splitInvMass = invMassA * btScalar(shareCountA) + invMassB * btScalar(shareCountB);
+		if (splitInvMass > SIMD_EPSILON)
+		{
+			// the rhs and cfm are proportional to jacDiagABInv
+			btScalar factor = (invMassA + invMassB) / splitInvMass;
+			row.m_jacDiagABInv *= factor;
+			row.m_rhs *= factor;
+			row.m_rhsPenetration *= factor;
+			row.m_cfm *= factor;
+		}
+		row.m_angularComponentA *= btScalar(shareCountA);
+		row.m_angularComponentB *= btScalar(shareCountB);
+	}
+}
+
+btScalar btPartitionedConstraintSolverMt::solveGroupCacheFriendlySetup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
+{
+	btScalar val = btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+
+	m_numPartitions = 0;
+	m_sharedBodies.resizeNoInitialize(0);
+	if (numManifolds >= s_minimumContactManifoldsForPartitioning)
+	{
+		setupPartitions(infoGlobal);
+	}
+	return val;
+}
+
+btScalar btPartitionedConstraintSolverMt::internalSolvePartition(int iPartition, int iteration, const btContactSolverInfo& infoGlobal)
+{
+	btScalar leastSquaresResidual = 0.f;
+
+	///solve all joint constraints
+	for (int i = m_jointRows.m_rowOffsets[iPartition]; i < m_jointRows.m_rowOffsets[iPartition + 1]; ++i)
+	{
+		btSolverConstraint& constraint = m_tmpSolverNonContactConstraintPool[m_jointRows.m_rows[i]];
+		if (iteration < constraint.m_overrideNumSolverIterations)
+		{
+			btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[constraint.m_solverBodyIdA], m_tmpSolverBodyPool[constraint.m_solverBodyIdB], constraint);
+			leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+		}
+	}
+
+	if (iteration < infoGlobal.m_numIterations)
+	{
+		///solve all contact constraints
+		if (infoGlobal.m_solverMode & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS)
+		{
+			int numFrictionDirections = (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS) ? 2 : 1;
+			for (int i = m_contactRows.m_rowOffsets[iPartition]; i < m_contactRows.m_rowOffsets[iPartition + 1]; ++i)
+			{
+				const btSolverConstraint& contact = m_tmpSolverContactConstraintPool[m_contactRows.m_rows[i]];
+				btScalar residual = resolveSingleConstraintRowLowerLimit(m_tmpSolverBodyPool[contact.m_solverBodyIdA], m_tmpSolverBodyPool[contact.m_solverBodyIdB], contact);
+				leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+
+				btScalar totalImpulse = contact.m_appliedImpulse;
+				if (totalImpulse > btScalar(0))
+				{
+					for (int iFriction = 0; iFriction < numFrictionDirections; ++iFriction)
+					{
+						btSolverConstraint& friction = m_tmpSolverContactFrictionConstraintPool[contact.m_frictionIndex + iFriction];
+						friction.m_lowerLimit = -(friction.m_friction * totalImpulse);
+						friction.m_upperLimit = friction.m_friction * totalImpulse;
+
+						residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[friction.m_solverBodyIdA], m_tmpSolverBodyPool[friction.m_solverBodyIdB], friction);
+						leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+					}
+				}
+			}
+		}
+		else
+		{
+			for (int i = m_contactRows.m_rowOffsets[iPartition]; i < m_contactRows.m_rowOffsets[iPartition + 1]; ++i)
+			{
+				const btSolverConstraint& contact = m_tmpSolverContactConstraintPool[m_contactRows.m_rows[i]];
+				btScalar residual = resolveSingleConstraintRowLowerLimit(m_tmpSolverBodyPool[contact.m_solverBodyIdA], m_tmpSolverBodyPool[contact.m_solverBodyIdB], contact);
+				leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+			}
+			// the contact of a friction row is always in the same partition
+			for (int i = m_frictionRows.m_rowOffsets[iPartition]; i < m_frictionRows.m_rowOffsets[iPartition + 1]; ++i)
+			{
+				btSolverConstraint& friction = m_tmpSolverContactFrictionConstraintPool[m_frictionRows.m_rows[i]];
+				btScalar totalImpulse = m_tmpSolverContactConstraintPool[friction.m_frictionIndex].m_appliedImpulse;
+				if (totalImpulse > btScalar(0))
+				{
+					friction.m_lowerLimit = -(friction.m_friction * totalImpulse);
+					friction.m_upperLimit = friction.m_friction * totalImpulse;
+
+					btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[friction.m_solverBodyIdA], m_tmpSolverBodyPool[friction.m_solverBodyIdB], friction);
+					leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+				}
+			}
+		}
+
+		for (int i = m_rollingFrictionRows.m_rowOffsets[iPartition]; i < m_rollingFrictionRows.m_rowOffsets[iPartition + 1]; ++i)
+		{
+			btSolverConstraint& rollingFrictionConstraint = m_tmpSolverContactRollingFrictionConstraintPool[m_rollingFrictionRows.m_rows[i]];
+			btScalar totalImpulse = m_tmpSolverContactConstraintPool[rollingFrictionConstraint.m_frictionIndex].m_appliedImpulse;
+			if (totalImpulse > btScalar(0))
+			{
+				btScalar rollingFrictionMagnitude = rollingFrictionConstraint.m_friction * totalImpulse;
+				if (rollingFrictionMagnitude > rollingFrictionConstraint.m_friction)
+					rollingFrictionMagnitude = rollingFrictionConstraint.m_friction;
+
+				rollingFrictionConstraint.m_lowerLimit = -rollingFrictionMagnitude;
+				rollingFrictionConstraint.m_upperLimit = rollingFrictionMagnitude;
+
+				btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdA], m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdB], rollingFrictionConstraint);
+				leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+			}
+		}
+	}
+	return leastSquaresResidual;
+}
+
+btScalar btPartitionedConstraintSolverMt::internalSolvePartitionSplitImpulse(int iPartition)
+{
+	btScalar leastSquaresResidual = 0.f;
+	for (int i = m_contactRows.m_rowOffsets[iPartition]; i < m_contactRows.m_rowOffsets[iPartition + 1]; ++i)
+	{
+		const btSolverConstraint& contact = m_tmpSolverContactConstraintPool[m_contactRows.m_rows[i]];
+		btScalar residual = resolveSplitPenetrationImpulse(m_tmpSolverBodyPool[contact.m_solverBodyIdA], m_tmpSolverBodyPool[contact.m_solverBodyIdB], contact);
+		leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+	}
+	return leastSquaresResidual;
+}
+
+struct SolvePartitionsLoop : public btIParallelForBody
+{
+	btPartitionedConstraintSolverMt* m_solver;
+	btScalar* m_residuals;
+	int m_iteration;
+	bool m_splitImpulse;
+	const btContactSolverInfo* m_infoGlobal;
+
+	SolvePartitionsLoop(btPartitionedConstraintSolverMt* solver, btScalar* residuals, int iteration, bool splitImpulse, const btContactSolverInfo& infoGlobal)
+	{
+		m_solver = solver;
+		m_residuals = residuals;
+		m_iteration = iteration;
+		m_splitImpulse = splitImpulse;
+		m_infoGlobal = &infoGlobal;
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int iPartition = iBegin; iPartition < iEnd; ++iPartition)
+		{
+			if (m_splitImpulse)
+			{
+				m_residuals[iPartition] = m_solver->internalSolvePartitionSplitImpulse(iPartition);
+			}
+			else
+			{
+				m_residuals[iPartition] = m_solver->internalSolvePartition(iPartition, m_iteration, *m_infoGlobal);
+			}
+		}
+	}
+};
+
+btScalar btPartitionedConstraintSolverMt::solvePartitions(int iteration, bool splitImpulse, const btContactSolverInfo& infoGlobal)
+{
+	SolvePartitionsLoop loop(this, &m_partitionResiduals[0], iteration, splitImpulse, infoGlobal);
+	if (useParallelLoops())
+	{
+		int grainSize = 1;
+		btParallelFor(0, m_numPartitions, grainSize, loop);
+	}
+	else
+	{
+		loop.forLoop(0, m_numPartitions);
+	}
+	btScalar leastSquaresResidual = 0.f;
+	for (int i = 0; i < m_numPartitions; ++i)
+	{
+		leastSquaresResidual = btMax(leastSquaresResidual, m_partitionResiduals[i]);
+	}
+	return leastSquaresResidual;
+}
+
+void btPartitionedConstraintSolverMt::internalAverageSharedBodies(int iBegin, int iEnd, bool splitImpulse)
+{
+	int firstCopyId = m_numOriginalSolverBodies;
+	for (int i = iBegin; i < iEnd; ++i)
+	{
+		int solverBodyId = m_sharedBodies[i];
+		btSolverBody& solverBody = m_tmpSolverBodyPool[solverBodyId];
+		// the body itself only counts if rows of its own partition changed it
+		btVector3 linear(0, 0, 0);
+		btVector3 angular(0, 0, 0);
+		int count = 0;
+		if (m_bodyUsedByPartition[solverBodyId])
+		{
+			linear = splitImpulse ? solverBody.m_pushVelocity : solverBody.m_deltaLinearVelocity;
+			angular = splitImpulse ? solverBody.m_turnVelocity : solverBody.m_deltaAngularVelocity;
+			count++;
+		}
+		for (int copyId = m_firstBodyCopy[solverBodyId]; copyId >= 0; copyId = m_nextBodyCopy[copyId - firstCopyId])
+		{
+			const btSolverBody& copy = m_tmpSolverBodyPool[copyId];
+			linear += splitImpulse ? copy.m_pushVelocity : copy.m_deltaLinearVelocity;
+			angular += splitImpulse ? copy.m_turnVelocity : copy.m_deltaAngularVelocity;
+			count++;
+		}
+		btScalar factor = btScalar(1) / btScalar(count);
+		linear *= factor;
+		angular *= factor;
+		if (splitImpulse)
+		{
+			solverBody.m_pushVelocity = linear;
+			solverBody.m_turnVelocity = angular;
+		}
+		else
+		{
+			solverBody.m_deltaLinearVelocity = linear;
+			solverBody.m_deltaAngularVelocity = angular;
+		}
+		for (int copyId = m_firstBodyCopy[solverBodyId]; copyId >= 0; copyId = m_nextBodyCopy[copyId - firstCopyId])
+		{
+			btSolverBody& copy = m_tmpSolverBodyPool[copyId];
+			copy.m_pushVelocity = solverBody.m_pushVelocity;
+			copy.m_turnVelocity = solverBody.m_turnVelocity;
+			copy.m_deltaLinearVelocity = solverBody.m_deltaLinearVelocity;
+			copy.m_deltaAngularVelocity = solverBody.m_deltaAngularVelocity;
+		}
+	}
+}
+
+struct AverageSharedBodiesLoop : public btIParallelForBody
+{
+	btPartitionedConstraintSolverMt* m_solver;
+	bool m_splitImpulse;
+
+	AverageSharedBodiesLoop(btPartitionedConstraintSolverMt* solver, bool splitImpulse)
+	{
+		m_solver = solver;
+		m_splitImpulse = splitImpulse;
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		m_solver->internalAverageSharedBodies(iBegin, iEnd, m_splitImpulse);
+	}
+};
+
+void btPartitionedConstraintSolverMt::averageSharedBodies(bool splitImpulse)
+{
+	BT_PROFILE("averageSharedBodies");
+	AverageSharedBodiesLoop loop(this, splitImpulse);
+	if (useParallelLoops())
+	{
+		int grainSize = 200;
+		btParallelFor(0, m_sharedBodies.size(), grainSize, loop);
+	}
+	else
+	{
+		loop.forLoop(0, m_sharedBodies.size());
+	}
+}
+
+void btPartitionedConstraintSolverMt::solveGroupCacheFriendlySplitImpulseIterations(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
+{
+	if (m_numPartitions == 0)
+	{
+		btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySplitImpulseIterations(bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+		return;
+	}
+	BT_PROFILE("solveGroupCacheFriendlySplitImpulseIterations");
+	if (infoGlobal.m_splitImpulse)
+	{
+		for (int iteration = 0; iteration < infoGlobal.m_numIterations; iteration++)
+		{
+			btScalar leastSquaresResidual = solvePartitions(iteration, true, infoGlobal);
+			averageSharedBodies(true);
+			if (leastSquaresResidual <= infoGlobal.m_leastSquaresResidualThreshold || iteration >= (infoGlobal.m_numIterations - 1))
+			{
+				break;
+			}
+		}
+	}
+}
+
+void btPartitionedConstraintSolverMt::setupSolverIslands(const btContactSolverInfo& infoGlobal)
+{
+	// a partitioned island is solved by partition
+	if (m_numPartitions == 0)
+	{
+		btSequentialImpulseConstraintSolver::setupSolverIslands(infoGlobal);
+	}
+}
+
+btScalar btPartitionedConstraintSolverMt::solveSingleIteration(int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
+{
+	if (m_numPartitions == 0)
+	{
+		return btSequentialImpulseConstraintSolver::solveSingleIteration(iteration, bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+	}
+	BT_PROFILE("solveSingleIteration");
+	btScalar leastSquaresResidual = solvePartitions(iteration, false, infoGlobal);
+	averageSharedBodies(false);
+	return leastSquaresResidual;
+}
+
+btScalar btPartitionedConstraintSolverMt::solveGroupCacheFriendlyFinish(btCollisionObject** bodies, int numBodies, const btContactSolverInfo& infoGlobal)
+{
+	if (m_numPartitions > 0)
+	{
+		// after the last averaging the copies are the same as their bodies
+		m_tmpSolverBodyPool.resizeNoInitialize(m_numOriginalSolverBodies);
+	}
+	return btSequentialImpulseConstraintSolver::solveGroupCacheFriendlyFinish(bodies, numBodies, infoGlobal);
+}
+
+size_t btPartitionedConstraintSolverMt::getPoolMemory() const
+{
+	size_t bytes = btSequentialImpulseConstraintSolver::getPoolMemory();
+	const PartitionRows* partitionRows[] = {&m_jointRows, &m_contactRows, &m_frictionRows, &m_rollingFrictionRows};
+	for (int i = 0; i < 4; ++i)
+	{
+		bytes += (partitionRows[i]->m_rowOffsets.capacity() + partitionRows[i]->m_rows.capacity()) * sizeof(int);
+	}
+	bytes += (m_bodyPartitions.capacity() + m_firstBodyCopy.capacity() + m_nextBodyCopy.capacity() + m_bodyShareCounts.capacity() +
+			  m_bodyCopyPartitions.capacity() + m_sharedBodies.capacity() + m_rowPartitions.capacity()) *
+			 sizeof(int);
+	bytes += m_bodyUsedByPartition.capacity();
+	bytes += m_sortKeys.capacity() * sizeof(SortKey);
+	bytes += m_partitionResiduals.capacity() * sizeof(btScalar);
+	return bytes;
+}
@@ -0,0 +1,112 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_PARTITIONED_CONSTRAINT_SOLVER_MT_H
+#define BT_PARTITIONED_CONSTRAINT_SOLVER_MT_H
+
+#include "btSequentialImpulseConstraintSolver.h"
+#include "LinearMath/btThreads.h"
+
+///
+/// btPartitionedConstraintSolverMt
+///
+///  A multithreaded solver for very large islands, a block Jacobi / Gauss-Seidel hybrid. The bodies of the island are
+///  split into spatial partitions by recursive bisection, and every constraint row goes to the partition of its
+///  bodies. Each partition is solved with projected Gauss-Seidel, in parallel with the other partitions. A body
+///  touched by rows of several partitions gets a private copy per partition, and after every iteration the
+///  velocities of the copies are averaged, like the Jacobi mode of b3PgsJacobiSolver. The copies share the mass of
+///  their body (mass splitting), so the averaged velocities converge to those of the unpartitioned island.
+///
+///  Unlike the batching of btSequentialImpulseConstraintSolverMt, the result does not depend on the number of
+///  threads, and the partitions are solved in the same way when the solver runs inside a btConstraintSolverPoolMt.
+///  It can be passed to btDiscreteDynamicsWorldMt as the solver for large islands, or used in the solver pool.
+///
+///  Islands with fewer manifolds than s_minimumContactManifoldsForPartitioning are solved like the sequential
+///  impulse solver. Randomized constraint ordering is not applied to partitioned islands, and like
+///  btSequentialImpulseConstraintSolverMt it does not call the obsolete solveConstraintObsolete of the constraints.
+///
+ATTRIBUTE_ALIGNED16(class)
+btPartitionedConstraintSolverMt : public btSequentialImpulseConstraintSolver
+{
+public:
+	// parameters to control partitioning
+	static bool s_allowNestedParallelForLoops;              // whether to solve partitions in parallel inside another parallel loop
+	static int s_minimumContactManifoldsForPartitioning;  // don't partition islands with fewer manifolds than this
+	static int s_numPartitions;
+
+	// body position along the axis of a bisection
+	struct SortKey
+	{
+		btScalar m_key;
+		int m_solverBodyId;
+	};
+
+protected:
+	// rows of one pool sorted by partition
+	struct PartitionRows
+	{
+		btAlignedObjectArray<int> m_rowOffsets;  // first row per partition, and the number of rows at the end
+		btAlignedObjectArray<int> m_rows;
+	};
+	int m_numPartitions;  // of the current solver call, 0 if the island is not partitioned
+	int m_numOriginalSolverBodies;
+	btAlignedObjectArray<int> m_bodyPartitions;       // partition per original solver body, -1 for bodies without mass
+	btAlignedObjectArray<char> m_bodyUsedByPartition;  // whether rows of its own partition touch a body
+	btAlignedObjectArray<int> m_firstBodyCopy;        // per original solver body, -1 if it has no copies
+	btAlignedObjectArray<int> m_nextBodyCopy;         // per copy
+	btAlignedObjectArray<int> m_bodyCopyPartitions;   // per copy
+	btAlignedObjectArray<int> m_sharedBodies;         // original solver bodies that have copies
+	btAlignedObjectArray<int> m_bodyShareCounts;      // per solver body and copy, the number of partitions that share the body
+	btAlignedObjectArray<int> m_rowPartitions;
+	btAlignedObjectArray<SortKey> m_sortKeys;
+	btAlignedObjectArray<btScalar> m_partitionResiduals;
+	PartitionRows m_jointRows;
+	PartitionRows m_contactRows;
+	PartitionRows m_frictionRows;
+	PartitionRows m_rollingFrictionRows;
+
+	void setupPartitions(const btContactSolverInfo& infoGlobal);
+	void splitBodies(int iBegin, int iEnd, int firstPartition, int numPartitions);
+	void assignRows(btConstraintArray & pool, PartitionRows & partitionRows, int solverMode);
+	int getBodyCopy(int solverBodyId, int partition);
+	void splitMasses(btConstraintArray & pool);
+	btScalar solvePartitions(int iteration, bool splitImpulse, const btContactSolverInfo& infoGlobal);
+	void averageSharedBodies(bool splitImpulse);
+	bool useParallelLoops() const;
+
+	virtual void solveGroupCacheFriendlySplitImpulseIterations(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer) BT_OVERRIDE;
+	virtual btScalar solveGroupCacheFriendlyFinish(btCollisionObject * *bodies, int numBodies, const btContactSolverInfo& infoGlobal) BT_OVERRIDE;
+	virtual btScalar solveSingleIteration(int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer) BT_OVERRIDE;
+	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer) BT_OVERRIDE;
+	virtual void setupSolverIslands(const btContactSolverInfo& infoGlobal) BT_OVERRIDE;
+	virtual size_t getPoolMemory() const BT_OVERRIDE;
+
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btPartitionedConstraintSolverMt();
+	virtual ~btPartitionedConstraintSolverMt();
+
+	// partitions of the last solver call, 0 if it was not partitioned
+	int getNumPartitions() const { return m_numPartitions; }
+	// solver bodies that were shared by several partitions in the last solver call
+	int getNumSharedBodies() const { return m_sharedBodies.size(); }
+
+	btScalar internalSolvePartition(int iPartition, int iteration, const btContactSolverInfo& infoGlobal);
+	btScalar internalSolvePartitionSplitImpulse(int iPartition);
+	void internalAverageSharedBodies(int iBegin, int iEnd, bool splitImpulse);
+};
+
+#endif  //BT_PARTITIONED_CONSTRAINT_SOLVER_MT_H
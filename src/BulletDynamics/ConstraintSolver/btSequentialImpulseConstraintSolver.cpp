@@ -354,6 +354,7 @@ btSequentialImpulseConstraintSolver::btSequentialImpulseConstraintSolver()
 {
 	m_btSeed2 = 0;
 	m_cachedSolverMode = 0;
+	m_persistentFixedBodyId = -1;
 	setupSolverFunctions(false);
 }
 
@@ -1303,7 +1304,7 @@ void btSequentialImpulseConstraintSolver::convertJoints(btTypedConstraint** cons
 
 	int totalNumRows = 0;
 
-	m_tmpConstraintSizesPool.resizeNoInitialize(numConstraints);
+	resizeSolverPool(m_tmpConstraintSizesPool, numConstraints, infoGlobal.m_solverMode);
 	//calculate the total number of contraint rows
 	for (int i = 0; i < numConstraints; i++)
 	{
@@ -1328,7 +1329,7 @@ void btSequentialImpulseConstraintSolver::convertJoints(btTypedConstraint** cons
 		}
 		totalNumRows += info1.m_numConstraintRows;
 	}
-	m_tmpSolverNonContactConstraintPool.resizeNoInitialize(totalNumRows);
+	resizeSolverPool(m_tmpSolverNonContactConstraintPool, totalNumRows, infoGlobal.m_solverMode);
 
 	///setup the btSolverConstraints
 	int currentRow = 0;
@@ -1355,9 +1356,164 @@ void btSequentialImpulseConstraintSolver::convertJoints(btTypedConstraint** cons
 	}
 }
 
+static void btApplyGyroscopicForces(btSolverBody& solverBody, btRigidBody* body, const btContactSolverInfo& infoGlobal)
+{
+	btVector3 gyroForce(0, 0, 0);
+	if (body->getFlags() & BT_ENABLE_GYROSCOPIC_FORCE_EXPLICIT)
+	{
+		gyroForce = body->computeGyroscopicForceExplicit(infoGlobal.m_maxGyroscopicForce);
+		solverBody.m_externalTorqueImpulse -= gyroForce * body->getInvInertiaTensorWorld() * infoGlobal.m_timeStep;
+	}
+	if (body->getFlags() & BT_ENABLE_GYROSCOPIC_FORCE_IMPLICIT_WORLD)
+	{
+		gyroForce = body->computeGyroscopicImpulseImplicit_World(infoGlobal.m_timeStep);
+		solverBody.m_externalTorqueImpulse += gyroForce;
+	}
+	if (body->getFlags() & BT_ENABLE_GYROSCOPIC_FORCE_IMPLICIT_BODY)
+	{
+		gyroForce = body->computeGyroscopicImpulseImplicit_Body(infoGlobal.m_timeStep);
+		solverBody.m_externalTorqueImpulse += gyroForce;
+	}
+}
+
+// returns true for the bodies that getOrInitSolverBody gives their own solver body, the others share the fixed body
+static bool btHasOwnSolverBody(btCollisionObject& body)
+{
+	btRigidBody* rb = btRigidBody::upcast(&body);
+#if BT_THREADSAFE
+	return rb && (!rb->isStaticOrKinematicObject() || rb->isKinematicObject());
+#else   // BT_THREADSAFE
+	return rb && (rb->getInvMass() || rb->isKinematicObject());
+#endif  // BT_THREADSAFE
+}
+
+void btSequentialImpulseConstraintSolver::setSolverBodyId(btCollisionObject& body, int solverBodyId)
+{
+#if BT_THREADSAFE
+	// same storage as getOrInitSolverBody, kinematic bodies can be in multiple islands at once
+	if (body.isKinematicObject())
+	{
+		int uniqueId = body.getWorldArrayIndex();
+		if (uniqueId >= m_kinematicBodyUniqueIdToSolverBodyTable.size())
+		{
+			m_kinematicBodyUniqueIdToSolverBodyTable.resize(uniqueId + 1, -1);
+		}
+		m_kinematicBodyUniqueIdToSolverBodyTable[uniqueId] = solverBodyId;
+		return;
+	}
+#endif  // BT_THREADSAFE
+	body.setCompanionId(solverBodyId);
+}
+
+void btSequentialImpulseConstraintSolver::convertPersistentBodies(btCollisionObject** bodies, int numBodies, const btContactSolverInfo& infoGlobal)
+{
+	// The solver bodies are laid out in the order of the bodies, each body either gets the next solver body or shares the fixed body.
+	// So the mapping of the previous call is still valid for the longest prefix of bodies that need the same kind of solver body
+	// as the bodies they replace, and only the bodies after it are mapped from scratch.
+	// A mapping that is longer than the bodies is kept when all bodies match it, for islands that alternate between solver calls.
+	int numKept = 0;
+	int numKeptSolverBodies = 0;
+	int keptFixedBodyId = -1;
+	int maxKept = btMin(numBodies, m_persistentBodies.size());
+	while (numKept < maxKept)
+	{
+		int solverBodyId = m_persistentSolverBodyIds[numKept];
+		bool hadOwnSolverBody = solverBodyId != m_persistentFixedBodyId;
+		if (btHasOwnSolverBody(*bodies[numKept]) != hadOwnSolverBody)
+		{
+			break;
+		}
+		if (!hadOwnSolverBody)
+		{
+			keptFixedBodyId = solverBodyId;
+		}
+		numKeptSolverBodies = btMax(numKeptSolverBodies, solverBodyId + 1);
+		numKept++;
+	}
+
+#if BT_THREADSAFE
+	m_kinematicBodyUniqueIdToSolverBodyTable.resize(0);
+#endif  // BT_THREADSAFE
+	if (numKept < numBodies)
+	{
+		resizeSolverPool(m_persistentBodies, numBodies, infoGlobal.m_solverMode);
+		resizeSolverPool(m_persistentSolverBodyIds, numBodies, infoGlobal.m_solverMode);
+	}
+	if (m_tmpSolverBodyPool.capacity() < numBodies + 1)
+	{
+		m_tmpSolverBodyPool.reserve(numBodies + 1 + numBodies / 16);
+	}
+	m_tmpSolverBodyPool.resizeNoInitialize(numKeptSolverBodies);
+	m_fixedBodyId = keptFixedBodyId;
+	if (m_fixedBodyId >= 0)
+	{
+		initSolverBody(&m_tmpSolverBodyPool[m_fixedBodyId], 0, infoGlobal.m_timeStep);
+	}
+
+	int numReused = 0;
+	for (int i = 0; i < numKept; i++)
+	{
+		btCollisionObject* body = bodies[i];
+		if (body == m_persistentBodies[i])
+		{
+			numReused++;
+		}
+		else
+		{
+			m_persistentBodies[i] = body;
+		}
+		int solverBodyId = m_persistentSolverBodyIds[i];
+		if (solverBodyId == m_fixedBodyId)
+		{
+			body->setCompanionId(-1);
+			continue;
+		}
+		btSolverBody& solverBody = m_tmpSolverBodyPool[solverBodyId];
+		initSolverBody(&solverBody, body, infoGlobal.m_timeStep);
+		setSolverBodyId(*body, solverBodyId);
+
+		btRigidBody* rb = btRigidBody::upcast(body);
+		if (rb && rb->getInvMass())
+		{
+			btApplyGyroscopicForces(solverBody, rb, infoGlobal);
+		}
+	}
+
+	for (int i = numKept; i < numBodies; i++)
+	{
+		bodies[i]->setCompanionId(-1);
+	}
+	for (int i = numKept; i < numBodies; i++)
+	{
+		int bodyId = getOrInitSolverBody(*bodies[i], infoGlobal.m_timeStep);
+		m_persistentBodies[i] = bodies[i];
+		m_persistentSolverBodyIds[i] = bodyId;
+
+		btRigidBody* rb = btRigidBody::upcast(bodies[i]);
+		if (rb && rb->getInvMass())
+		{
+			btApplyGyroscopicForces(m_tmpSolverBodyPool[bodyId], rb, infoGlobal);
+		}
+	}
+	if (numKept < numBodies)
+	{
+		// a fixed body that is only added by the contacts or joints is not part of the mapping
+		m_persistentFixedBodyId = m_fixedBodyId;
+	}
+	m_poolStatistics.m_numReusedSolverBodies += numReused;
+	m_poolStatistics.m_numUpdatedSolverBodies += numKept - numReused;
+	m_poolStatistics.m_numRemappedSolverBodies += numBodies - numKept;
+}
+
 void btSequentialImpulseConstraintSolver::convertBodies(btCollisionObject** bodies, int numBodies, const btContactSolverInfo& infoGlobal)
 {
 	BT_PROFILE("convertBodies");
+	if (infoGlobal.m_solverMode & SOLVER_PERSISTENT_POOLS)
+	{
+		convertPersistentBodies(bodies, numBodies, infoGlobal);
+		return;
+	}
+
 	for (int i = 0; i < numBodies; i++)
 	{
 		bodies[i]->setCompanionId(-1);
@@ -1379,23 +1535,7 @@ void btSequentialImpulseConstraintSolver::convertBodies(btCollisionObject** bodi
 		btRigidBody* body = btRigidBody::upcast(bodies[i]);
 		if (body && body->getInvMass())
 		{
-			btSolverBody& solverBody = m_tmpSolverBodyPool[bodyId];
-			btVector3 gyroForce(0, 0, 0);
-			if (body->getFlags() & BT_ENABLE_GYROSCOPIC_FORCE_EXPLICIT)
-			{
-				gyroForce = body->computeGyroscopicForceExplicit(infoGlobal.m_maxGyroscopicForce);
-				solverBody.m_externalTorqueImpulse -= gyroForce * body->getInvInertiaTensorWorld() * infoGlobal.m_timeStep;
-			}
-			if (body->getFlags() & BT_ENABLE_GYROSCOPIC_FORCE_IMPLICIT_WORLD)
-			{
-				gyroForce = body->computeGyroscopicImpulseImplicit_World(infoGlobal.m_timeStep);
-				solverBody.m_externalTorqueImpulse += gyroForce;
-			}
-			if (body->getFlags() & BT_ENABLE_GYROSCOPIC_FORCE_IMPLICIT_BODY)
-			{
-				gyroForce = body->computeGyroscopicImpulseImplicit_Body(infoGlobal.m_timeStep);
-				solverBody.m_externalTorqueImpulse += gyroForce;
-			}
+			btApplyGyroscopicForces(m_tmpSolverBodyPool[bodyId], body, infoGlobal);
 		}
 	}
 }
@@ -1495,15 +1635,17 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 	int numNonContactPool = m_tmpSolverNonContactConstraintPool.size();
 	int numConstraintPool = m_tmpSolverContactConstraintPool.size();
 	int numFrictionPool = m_tmpSolverContactFrictionConstraintPool.size();
+	int numRollingFrictionPool = m_tmpSolverContactRollingFrictionConstraintPool.size();
 
 	///@todo: use stack allocator for such temporarily memory, same for solver bodies/constraints
-	m_orderNonContactConstraintPool.resizeNoInitialize(numNonContactPool);
+	resizeSolverPool(m_orderNonContactConstraintPool, numNonContactPool, infoGlobal.m_solverMode);
 	if ((infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS))
-		m_orderTmpConstraintPool.resizeNoInitialize(numConstraintPool * 2);
+		resizeSolverPool(m_orderTmpConstraintPool, numConstraintPool * 2, infoGlobal.m_solverMode);
 	else
-		m_orderTmpConstraintPool.resizeNoInitialize(numConstraintPool);
+		resizeSolverPool(m_orderTmpConstraintPool, numConstraintPool, infoGlobal.m_solverMode);
 
-	m_orderFrictionConstraintPool.resizeNoInitialize(numFrictionPool);
+	resizeSolverPool(m_orderFrictionConstraintPool, numFrictionPool, infoGlobal.m_solverMode);
+	resizeSolverPool(m_orderRollingFrictionConstraintPool, numRollingFrictionPool, infoGlobal.m_solverMode);
 	{
 		int i;
 		for (i = 0; i < numNonContactPool; i++)
@@ -1518,56 +1660,33 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 		{
 			m_orderFrictionConstraintPool[i] = i;
 		}
+		for (i = 0; i < numRollingFrictionPool; i++)
+		{
+			m_orderRollingFrictionConstraintPool[i] = i;
+		}
 	}
+	// the islands are set up by solveGroupCacheFriendlyIterations, once the derived solvers have finished their setup
+	m_solverIslands.resize(0);
+	m_activeSolverIslands.resize(0);
 
 	return 0.f;
 }
 
-btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration, btCollisionObject** /*bodies */, int /*numBodies*/, btPersistentManifold** /*manifoldPtr*/, int /*numManifolds*/, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* /*debugDrawer*/)
+void btSequentialImpulseConstraintSolver::shuffleConstraintOrder(btAlignedObjectArray<int>& order, int iBegin, int iEnd)
 {
-	BT_PROFILE("solveSingleIteration");
-	btScalar leastSquaresResidual = 0.f;
-
-	int numNonContactPool = m_tmpSolverNonContactConstraintPool.size();
-	int numConstraintPool = m_tmpSolverContactConstraintPool.size();
-	int numFrictionPool = m_tmpSolverContactFrictionConstraintPool.size();
-
-	if (infoGlobal.m_solverMode & SOLVER_RANDMIZE_ORDER)
+	for (int j = iBegin; j < iEnd; ++j)
 	{
-		if (1)  // uncomment this for a bit less random ((iteration & 7) == 0)
-		{
-			for (int j = 0; j < numNonContactPool; ++j)
-			{
-				int tmp = m_orderNonContactConstraintPool[j];
-				int swapi = btRandInt2(j + 1);
-				m_orderNonContactConstraintPool[j] = m_orderNonContactConstraintPool[swapi];
-				m_orderNonContactConstraintPool[swapi] = tmp;
-			}
-
-			//contact/friction constraints are not solved more than
-			if (iteration < infoGlobal.m_numIterations)
-			{
-				for (int j = 0; j < numConstraintPool; ++j)
-				{
-					int tmp = m_orderTmpConstraintPool[j];
-					int swapi = btRandInt2(j + 1);
-					m_orderTmpConstraintPool[j] = m_orderTmpConstraintPool[swapi];
-					m_orderTmpConstraintPool[swapi] = tmp;
-				}
-
-				for (int j = 0; j < numFrictionPool; ++j)
-				{
-					int tmp = m_orderFrictionConstraintPool[j];
-					int swapi = btRandInt2(j + 1);
-					m_orderFrictionConstraintPool[j] = m_orderFrictionConstraintPool[swapi];
-					m_orderFrictionConstraintPool[swapi] = tmp;
-				}
-			}
-		}
+		int tmp = order[j];
+		int swapi = iBegin + btRandInt2(j - iBegin + 1);
+		order[j] = order[swapi];
+		order[swapi] = tmp;
 	}
+}
 
-	///solve all joint constraints
-	for (int j = 0; j < m_tmpSolverNonContactConstraintPool.size(); j++)
+btScalar btSequentialImpulseConstraintSolver::solveJointRows(int iBegin, int iEnd, int iteration)
+{
+	btScalar leastSquaresResidual = 0.f;
+	for (int j = iBegin; j < iEnd; j++)
 	{
 		btSolverConstraint& constraint = m_tmpSolverNonContactConstraintPool[m_orderNonContactConstraintPool[j]];
 		if (iteration < constraint.m_overrideNumSolverIterations)
@@ -1576,121 +1695,344 @@ btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration
 			leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
 		}
 	}
+	return leastSquaresResidual;
+}
 
-	if (iteration < infoGlobal.m_numIterations)
+void btSequentialImpulseConstraintSolver::solveObsoleteConstraints(btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal)
+{
+	for (int j = 0; j < numConstraints; j++)
 	{
-		for (int j = 0; j < numConstraints; j++)
+		if (constraints[j]->isEnabled())
 		{
-			if (constraints[j]->isEnabled())
-			{
-				int bodyAid = getOrInitSolverBody(constraints[j]->getRigidBodyA(), infoGlobal.m_timeStep);
-				int bodyBid = getOrInitSolverBody(constraints[j]->getRigidBodyB(), infoGlobal.m_timeStep);
-				btSolverBody& bodyA = m_tmpSolverBodyPool[bodyAid];
-				btSolverBody& bodyB = m_tmpSolverBodyPool[bodyBid];
-				constraints[j]->solveConstraintObsolete(bodyA, bodyB, infoGlobal.m_timeStep);
-			}
+			int bodyAid = getOrInitSolverBody(constraints[j]->getRigidBodyA(), infoGlobal.m_timeStep);
+			int bodyBid = getOrInitSolverBody(constraints[j]->getRigidBodyB(), infoGlobal.m_timeStep);
+			btSolverBody& bodyA = m_tmpSolverBodyPool[bodyAid];
+			btSolverBody& bodyB = m_tmpSolverBodyPool[bodyBid];
+			constraints[j]->solveConstraintObsolete(bodyA, bodyB, infoGlobal.m_timeStep);
 		}
+	}
+}
+
+btScalar btSequentialImpulseConstraintSolver::solveContactRows(int contactBegin, int contactEnd, int frictionBegin, int frictionEnd, int rollingFrictionBegin, int rollingFrictionEnd, const btContactSolverInfo& infoGlobal)
+{
+	btScalar leastSquaresResidual = 0.f;
 
-		///solve all contact constraints
-		if (infoGlobal.m_solverMode & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS)
+	///solve all contact constraints
+	if (infoGlobal.m_solverMode & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS)
+	{
+		int multiplier = (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS) ? 2 : 1;
+
+		for (int c = contactBegin; c < contactEnd; c++)
 		{
-			int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
-			int multiplier = (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS) ? 2 : 1;
+			btScalar totalImpulse = 0;
 
-			for (int c = 0; c < numPoolConstraints; c++)
 			{
-				btScalar totalImpulse = 0;
+				const btSolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[c]];
+				btScalar residual = resolveSingleConstraintRowLowerLimit(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA], m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB], solveManifold);
+				leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
 
+				totalImpulse = solveManifold.m_appliedImpulse;
+			}
+			bool applyFriction = true;
+			if (applyFriction)
+			{
 				{
-					const btSolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[c]];
-					btScalar residual = resolveSingleConstraintRowLowerLimit(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA], m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB], solveManifold);
-					leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+					btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[c * multiplier]];
 
-					totalImpulse = solveManifold.m_appliedImpulse;
-				}
-				bool applyFriction = true;
-				if (applyFriction)
-				{
+					if (totalImpulse > btScalar(0))
 					{
-						btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[c * multiplier]];
-
-						if (totalImpulse > btScalar(0))
-						{
-							solveManifold.m_lowerLimit = -(solveManifold.m_friction * totalImpulse);
-							solveManifold.m_upperLimit = solveManifold.m_friction * totalImpulse;
+						solveManifold.m_lowerLimit = -(solveManifold.m_friction * totalImpulse);
+						solveManifold.m_upperLimit = solveManifold.m_friction * totalImpulse;
 
-							btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA], m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB], solveManifold);
-							leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
-						}
+						btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA], m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB], solveManifold);
+						leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
 					}
+				}
 
-					if (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS)
-					{
-						btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[c * multiplier + 1]];
+				if (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS)
+				{
+					btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[c * multiplier + 1]];
 
-						if (totalImpulse > btScalar(0))
-						{
-							solveManifold.m_lowerLimit = -(solveManifold.m_friction * totalImpulse);
-							solveManifold.m_upperLimit = solveManifold.m_friction * totalImpulse;
+					if (totalImpulse > btScalar(0))
+					{
+						solveManifold.m_lowerLimit = -(solveManifold.m_friction * totalImpulse);
+						solveManifold.m_upperLimit = solveManifold.m_friction * totalImpulse;
 
-							btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA], m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB], solveManifold);
-							leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
-						}
+						btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA], m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB], solveManifold);
+						leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
 					}
 				}
 			}
 		}
-		else  //SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS
+	}
+	else  //SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS
+	{
+		//solve the friction constraints after all contact constraints, don't interleave them
+		int j;
+
+		for (j = contactBegin; j < contactEnd; j++)
 		{
-			//solve the friction constraints after all contact constraints, don't interleave them
-			int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
-			int j;
+			const btSolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[j]];
+			btScalar residual = resolveSingleConstraintRowLowerLimit(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA], m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB], solveManifold);
+			leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+		}
 
-			for (j = 0; j < numPoolConstraints; j++)
+		///solve all friction constraints
+
+		for (j = frictionBegin; j < frictionEnd; j++)
+		{
+			btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[j]];
+			btScalar totalImpulse = m_tmpSolverContactConstraintPool[solveManifold.m_frictionIndex].m_appliedImpulse;
+
+			if (totalImpulse > btScalar(0))
 			{
-				const btSolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[j]];
-				btScalar residual = resolveSingleConstraintRowLowerLimit(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA], m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB], solveManifold);
+				solveManifold.m_lowerLimit = -(solveManifold.m_friction * totalImpulse);
+				solveManifold.m_upperLimit = solveManifold.m_friction * totalImpulse;
+
+				btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA], m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB], solveManifold);
 				leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
 			}
+		}
+	}
 
-			///solve all friction constraints
+	for (int j = rollingFrictionBegin; j < rollingFrictionEnd; j++)
+	{
+		btSolverConstraint& rollingFrictionConstraint = m_tmpSolverContactRollingFrictionConstraintPool[m_orderRollingFrictionConstraintPool[j]];
+		btScalar totalImpulse = m_tmpSolverContactConstraintPool[rollingFrictionConstraint.m_frictionIndex].m_appliedImpulse;
+		if (totalImpulse > btScalar(0))
+		{
+			btScalar rollingFrictionMagnitude = rollingFrictionConstraint.m_friction * totalImpulse;
+			if (rollingFrictionMagnitude > rollingFrictionConstraint.m_friction)
+				rollingFrictionMagnitude = rollingFrictionConstraint.m_friction;
 
-			int numFrictionPoolConstraints = m_tmpSolverContactFrictionConstraintPool.size();
-			for (j = 0; j < numFrictionPoolConstraints; j++)
-			{
-				btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[j]];
-				btScalar totalImpulse = m_tmpSolverContactConstraintPool[solveManifold.m_frictionIndex].m_appliedImpulse;
+			rollingFrictionConstraint.m_lowerLimit = -rollingFrictionMagnitude;
+			rollingFrictionConstraint.m_upperLimit = rollingFrictionMagnitude;
 
-				if (totalImpulse > btScalar(0))
-				{
-					solveManifold.m_lowerLimit = -(solveManifold.m_friction * totalImpulse);
-					solveManifold.m_upperLimit = solveManifold.m_friction * totalImpulse;
+			btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdA], m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdB], rollingFrictionConstraint);
+			leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+		}
+	}
+	return leastSquaresResidual;
+}
 
-					btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[solveManifold.m_solverBodyIdA], m_tmpSolverBodyPool[solveManifold.m_solverBodyIdB], solveManifold);
-					leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
-				}
+btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration, btCollisionObject** /*bodies */, int /*numBodies*/, btPersistentManifold** /*manifoldPtr*/, int /*numManifolds*/, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* /*debugDrawer*/)
+{
+	BT_PROFILE("solveSingleIteration");
+	if (m_solverIslands.size())
+	{
+		return solveSolverIslands(iteration, constraints, numConstraints, infoGlobal);
+	}
+	btScalar leastSquaresResidual = 0.f;
+
+	int numNonContactPool = m_tmpSolverNonContactConstraintPool.size();
+	int numConstraintPool = m_tmpSolverContactConstraintPool.size();
+	int numFrictionPool = m_tmpSolverContactFrictionConstraintPool.size();
+	int numRollingFrictionPool = m_tmpSolverContactRollingFrictionConstraintPool.size();
+
+	if (infoGlobal.m_solverMode & SOLVER_RANDMIZE_ORDER)
+	{
+		if (1)  // uncomment this for a bit less random ((iteration & 7) == 0)
+		{
+			shuffleConstraintOrder(m_orderNonContactConstraintPool, 0, numNonContactPool);
+
+			//contact/friction constraints are not solved more than
+			if (iteration < infoGlobal.m_numIterations)
+			{
+				shuffleConstraintOrder(m_orderTmpConstraintPool, 0, numConstraintPool);
+				shuffleConstraintOrder(m_orderFrictionConstraintPool, 0, numFrictionPool);
 			}
 		}
+	}
+
+	///solve all joint constraints
+	leastSquaresResidual = solveJointRows(0, numNonContactPool, iteration);
+
+	if (iteration < infoGlobal.m_numIterations)
+	{
+		solveObsoleteConstraints(constraints, numConstraints, infoGlobal);
+
+		btScalar residual = solveContactRows(0, numConstraintPool, 0, numFrictionPool, 0, numRollingFrictionPool, infoGlobal);
+		leastSquaresResidual = btMax(leastSquaresResidual, residual);
+	}
+	return leastSquaresResidual;
+}
 
-		int numRollingFrictionPoolConstraints = m_tmpSolverContactRollingFrictionConstraintPool.size();
-		for (int j = 0; j < numRollingFrictionPoolConstraints; j++)
+int btSequentialImpulseConstraintSolver::getRowIsland(const btSolverConstraint& row)
+{
+	// rows between bodies without mass go with their first body, they don't join islands
+	int solverBodyId = row.m_solverBodyIdA;
+	if (!isDynamicSolverBody(solverBodyId))
+	{
+		solverBodyId = row.m_solverBodyIdB;
+		if (!isDynamicSolverBody(solverBodyId))
 		{
-			btSolverConstraint& rollingFrictionConstraint = m_tmpSolverContactRollingFrictionConstraintPool[j];
-			btScalar totalImpulse = m_tmpSolverContactConstraintPool[rollingFrictionConstraint.m_frictionIndex].m_appliedImpulse;
-			if (totalImpulse > btScalar(0))
+			solverBodyId = row.m_solverBodyIdA;
+		}
+	}
+	int root = m_solverBodyUnionFind.find(solverBodyId);
+	int iIsland = m_rootSolverIslands[root];
+	if (iIsland < 0)
+	{
+		iIsland = m_solverIslands.size();
+		m_rootSolverIslands[root] = iIsland;
+		btSolverIsland& island = m_solverIslands.expandNonInitializing();
+		const btRigidBody* body = m_tmpSolverBodyPool[solverBodyId].m_originalBody;
+		island.m_islandTag = body ? body->getIslandTag() : -1;
+		island.m_numBodies = 0;
+		island.m_numIterationsUsed = 0;
+		island.m_leastSquaresResidual = 0.f;
+	}
+	return iIsland;
+}
+
+void btSequentialImpulseConstraintSolver::sortRowsByIsland(const btConstraintArray& pool, btAlignedObjectArray<int>& order)
+{
+	// counting sort, the rows of an island keep their order
+	int numIslands = m_solverIslands.size();
+	m_islandRowOffsets.resize(numIslands + 1);
+	for (int i = 0; i <= numIslands; ++i)
+	{
+		m_islandRowOffsets[i] = 0;
+	}
+	for (int i = 0; i < pool.size(); ++i)
+	{
+		m_islandRowOffsets[getRowIsland(pool[i]) + 1]++;
+	}
+	for (int i = 0; i < numIslands; ++i)
+	{
+		m_islandRowOffsets[i + 1] += m_islandRowOffsets[i];
+	}
+	for (int i = 0; i < pool.size(); ++i)
+	{
+		order[m_islandRowOffsets[getRowIsland(pool[i])]++] = i;
+	}
+	// m_islandRowOffsets now holds the end of every island
+}
+
+void btSequentialImpulseConstraintSolver::setupSolverIslands(const btContactSolverInfo& infoGlobal)
+{
+	BT_PROFILE("setupSolverIslands");
+	int numSolverBodies = m_tmpSolverBodyPool.size();
+	m_solverBodyUnionFind.reset(numSolverBodies);
+	m_rootSolverIslands.resize(numSolverBodies);
+	for (int i = 0; i < numSolverBodies; ++i)
+	{
+		m_rootSolverIslands[i] = -1;
+	}
+	// friction and rolling friction rows act on the bodies of their contact row
+	const btConstraintArray* pools[2] = {&m_tmpSolverNonContactConstraintPool, &m_tmpSolverContactConstraintPool};
+	for (int iPool = 0; iPool < 2; ++iPool)
+	{
+		const btConstraintArray& pool = *pools[iPool];
+		for (int i = 0; i < pool.size(); ++i)
+		{
+			int solverBodyIdA = pool[i].m_solverBodyIdA;
+			int solverBodyIdB = pool[i].m_solverBodyIdB;
+			if (isDynamicSolverBody(solverBodyIdA) && isDynamicSolverBody(solverBodyIdB))
 			{
-				btScalar rollingFrictionMagnitude = rollingFrictionConstraint.m_friction * totalImpulse;
-				if (rollingFrictionMagnitude > rollingFrictionConstraint.m_friction)
-					rollingFrictionMagnitude = rollingFrictionConstraint.m_friction;
+				m_solverBodyUnionFind.unite(solverBodyIdA, solverBodyIdB);
+			}
+		}
+	}
+	// islands are numbered in the order of their first row
+	m_solverIslands.resize(0);
+	for (int iPool = 0; iPool < 2; ++iPool)
+	{
+		const btConstraintArray& pool = *pools[iPool];
+		for (int i = 0; i < pool.size(); ++i)
+		{
+			getRowIsland(pool[i]);
+		}
+	}
+	for (int i = 0; i < numSolverBodies; ++i)
+	{
+		int iIsland = m_rootSolverIslands[m_solverBodyUnionFind.find(i)];
+		if (iIsland >= 0 && isDynamicSolverBody(i))
+		{
+			m_solverIslands[iIsland].m_numBodies++;
+		}
+	}
+	int numIslands = m_solverIslands.size();
 
-				rollingFrictionConstraint.m_lowerLimit = -rollingFrictionMagnitude;
-				rollingFrictionConstraint.m_upperLimit = rollingFrictionMagnitude;
+	sortRowsByIsland(m_tmpSolverNonContactConstraintPool, m_orderNonContactConstraintPool);
+	for (int i = 0; i < numIslands; ++i)
+	{
+		m_solverIslands[i].m_jointEnd = m_islandRowOffsets[i];
+		m_solverIslands[i].m_jointBegin = i > 0 ? m_islandRowOffsets[i - 1] : 0;
+	}
+	sortRowsByIsland(m_tmpSolverContactConstraintPool, m_orderTmpConstraintPool);
+	for (int i = 0; i < numIslands; ++i)
+	{
+		m_solverIslands[i].m_contactEnd = m_islandRowOffsets[i];
+		m_solverIslands[i].m_contactBegin = i > 0 ? m_islandRowOffsets[i - 1] : 0;
+	}
+	// with interleaved friction the friction rows of an island follow its contact rows in the same order
+	sortRowsByIsland(m_tmpSolverContactFrictionConstraintPool, m_orderFrictionConstraintPool);
+	for (int i = 0; i < numIslands; ++i)
+	{
+		m_solverIslands[i].m_frictionEnd = m_islandRowOffsets[i];
+		m_solverIslands[i].m_frictionBegin = i > 0 ? m_islandRowOffsets[i - 1] : 0;
+	}
+	sortRowsByIsland(m_tmpSolverContactRollingFrictionConstraintPool, m_orderRollingFrictionConstraintPool);
+	for (int i = 0; i < numIslands; ++i)
+	{
+		m_solverIslands[i].m_rollingFrictionEnd = m_islandRowOffsets[i];
+		m_solverIslands[i].m_rollingFrictionBegin = i > 0 ? m_islandRowOffsets[i - 1] : 0;
+	}
 
-				btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdA], m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdB], rollingFrictionConstraint);
-				leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+	m_activeSolverIslands.resize(numIslands);
+	for (int i = 0; i < numIslands; ++i)
+	{
+		m_activeSolverIslands[i] = i;
+	}
+	if (infoGlobal.m_reportSolverAnalytics)
+	{
+		m_analyticsData.m_islands.resize(numIslands);
+	}
+}
+
+btScalar btSequentialImpulseConstraintSolver::solveSolverIslands(int iteration, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal)
+{
+	if (iteration < infoGlobal.m_numIterations)
+	{
+		solveObsoleteConstraints(constraints, numConstraints, infoGlobal);
+	}
+	bool randomize = (infoGlobal.m_solverMode & SOLVER_RANDMIZE_ORDER) != 0;
+	bool reportResiduals = (infoGlobal.m_reportSolverAnalytics & 2) != 0;
+	btScalar leastSquaresResidual = 0.f;
+	int numActiveIslands = 0;
+	for (int i = 0; i < m_activeSolverIslands.size(); ++i)
+	{
+		int iIsland = m_activeSolverIslands[i];
+		btSolverIsland& island = m_solverIslands[iIsland];
+		if (randomize)
+		{
+			shuffleConstraintOrder(m_orderNonContactConstraintPool, island.m_jointBegin, island.m_jointEnd);
+			if (iteration < infoGlobal.m_numIterations)
+			{
+				shuffleConstraintOrder(m_orderTmpConstraintPool, island.m_contactBegin, island.m_contactEnd);
+				shuffleConstraintOrder(m_orderFrictionConstraintPool, island.m_frictionBegin, island.m_frictionEnd);
 			}
 		}
+		btScalar residual = solveJointRows(island.m_jointBegin, island.m_jointEnd, iteration);
+		if (iteration < infoGlobal.m_numIterations)
+		{
+			residual = btMax(residual, solveContactRows(island.m_contactBegin, island.m_contactEnd, island.m_frictionBegin, island.m_frictionEnd, island.m_rollingFrictionBegin, island.m_rollingFrictionEnd, infoGlobal));
+		}
+		island.m_numIterationsUsed = iteration + 1;
+		island.m_leastSquaresResidual = residual;
+		if (reportResiduals)
+		{
+			m_analyticsData.m_islands[iIsland].m_residuals.push_back(residual);
+		}
+		leastSquaresResidual = btMax(leastSquaresResidual, residual);
+		// an island that has converged is not solved again
+		if (residual > infoGlobal.m_leastSquaresResidualThreshold)
+		{
+			m_activeSolverIslands[numActiveIslands++] = iIsland;
+		}
 	}
+	m_activeSolverIslands.resize(numActiveIslands);
 	return leastSquaresResidual;
 }
 
@@ -1737,10 +2079,26 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlyIterations(
 
 		int maxIterations = m_maxOverrideNumSolverIterations > infoGlobal.m_numIterations ? m_maxOverrideNumSolverIterations : infoGlobal.m_numIterations;
 
+		m_analyticsData.m_islands.resize(0);
+		if (infoGlobal.m_solverMode & SOLVER_ADAPTIVE_ISLAND_ITERATIONS)
+		{
+			setupSolverIslands(infoGlobal);
+		}
+		bool reportIslands = infoGlobal.m_reportSolverAnalytics && m_solverIslands.size() == 0;
+		if (reportIslands)
+		{
+			// the whole solver call is one island
+			m_analyticsData.m_islands.resize(1);
+		}
+
 		for (int iteration = 0; iteration < maxIterations; iteration++)
 			//for ( int iteration = maxIterations-1  ; iteration >= 0;iteration--)
 		{
 			m_leastSquaresResidual = solveSingleIteration(iteration, bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+			if (reportIslands && (infoGlobal.m_reportSolverAnalytics & 2))
+			{
+				m_analyticsData.m_islands[0].m_residuals.push_back(m_leastSquaresResidual);
+			}
 
 			if (m_leastSquaresResidual <= infoGlobal.m_leastSquaresResidualThreshold || (iteration >= (maxIterations - 1)))
 			{
@@ -1758,6 +2116,27 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlyIterations(
 				break;
 			}
 		}
+
+		if (reportIslands)
+		{
+			btSolverIslandAnalyticsData& islandData = m_analyticsData.m_islands[0];
+			islandData.m_islandId = m_analyticsData.m_islandId;
+			islandData.m_numBodies = numBodies;
+			islandData.m_numIterationsUsed = m_analyticsData.m_numIterationsUsed;
+			islandData.m_remainingLeastSquaresResidual = m_leastSquaresResidual;
+		}
+		else if (infoGlobal.m_reportSolverAnalytics)
+		{
+			for (int i = 0; i < m_solverIslands.size(); ++i)
+			{
+				const btSolverIsland& island = m_solverIslands[i];
+				btSolverIslandAnalyticsData& islandData = m_analyticsData.m_islands[i];
+				islandData.m_islandId = island.m_islandTag;
+				islandData.m_numBodies = island.m_numBodies;
+				islandData.m_numIterationsUsed = island.m_numIterationsUsed;
+				islandData.m_remainingLeastSquaresResidual = island.m_leastSquaresResidual;
+			}
+		}
 	}
 	return 0.f;
 }
@@ -1859,6 +2238,7 @@ btScalar btSequentialImpulseConstraintSolver::solveGroup(btCollisionObject** bod
 {
 	BT_PROFILE("solveGroup");
 	//you need to provide at least some bodies
+	size_t poolMemory = getPoolMemory();
 
 	solveGroupCacheFriendlySetup(bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
 
@@ -1866,10 +2246,43 @@ btScalar btSequentialImpulseConstraintSolver::solveGroup(btCollisionObject** bod
 
 	solveGroupCacheFriendlyFinish(bodies, numBodies, infoGlobal);
 
+	m_poolStatistics.m_numSolverCalls++;
+	m_poolStatistics.m_poolMemory = getPoolMemory();
+	if (m_poolStatistics.m_poolMemory != poolMemory)
+	{
+		m_poolStatistics.m_numGrowingSolverCalls++;
+	}
+
 	return 0.f;
 }
 
 void btSequentialImpulseConstraintSolver::reset()
 {
 	m_btSeed2 = 0;
+	m_persistentBodies.resizeNoInitialize(0);
+	m_persistentSolverBodyIds.resizeNoInitialize(0);
+}
+
+size_t btSequentialImpulseConstraintSolver::getPoolMemory() const
+{
+	size_t bytes = m_tmpSolverBodyPool.capacity() * sizeof(btSolverBody);
+	bytes += (m_tmpSolverContactConstraintPool.capacity() +
+			  m_tmpSolverNonContactConstraintPool.capacity() +
+			  m_tmpSolverContactFrictionConstraintPool.capacity() +
+			  m_tmpSolverContactRollingFrictionConstraintPool.capacity()) *
+			 sizeof(btSolverConstraint);
+	bytes += (m_orderTmpConstraintPool.capacity() +
+			  m_orderNonContactConstraintPool.capacity() +
+			  m_orderFrictionConstraintPool.capacity() +
+			  m_orderRollingFrictionConstraintPool.capacity() +
+			  m_kinematicBodyUniqueIdToSolverBodyTable.capacity() +
+			  m_persistentSolverBodyIds.capacity() +
+			  m_activeSolverIslands.capacity() +
+			  m_rootSolverIslands.capacity() +
+			  m_islandRowOffsets.capacity()) *
+			 sizeof(int);
+	bytes += m_solverIslands.capacity() * sizeof(btSolverIsland);
+	bytes += m_tmpConstraintSizesPool.capacity() * sizeof(btTypedConstraint::btConstraintInfo1);
+	bytes += m_persistentBodies.capacity() * sizeof(btCollisionObject*);
+	return bytes;
 }
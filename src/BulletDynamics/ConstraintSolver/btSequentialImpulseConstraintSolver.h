@@ -26,13 +26,33 @@ class btCollisionObject;
 #include "BulletDynamics/ConstraintSolver/btSolverConstraint.h"
 #include "BulletCollision/NarrowPhaseCollision/btManifoldPoint.h"
 #include "BulletDynamics/ConstraintSolver/btConstraintSolver.h"
+#include "BulletCollision/CollisionDispatch/btUnionFind.h"
 
 typedef btScalar (*btSingleConstraintRowSolver)(btSolverBody&, btSolverBody&, const btSolverConstraint&);
 
+///iterations of one island of a solver call, the whole solver call counts as one island without SOLVER_ADAPTIVE_ISLAND_ITERATIONS
+struct btSolverIslandAnalyticsData
+{
+	btSolverIslandAnalyticsData()
+	{
+		m_islandId = -2;
+		m_numBodies = 0;
+		m_numIterationsUsed = -1;
+		m_remainingLeastSquaresResidual = -1;
+	}
+	int m_islandId;
+	int m_numBodies;
+	int m_numIterationsUsed;
+	double m_remainingLeastSquaresResidual;
+	btAlignedObjectArray<double> m_residuals;  // least squares residual of every iteration, if m_reportSolverAnalytics & 2
+};
+
 struct btSolverAnalyticsData
 {
 	btSolverAnalyticsData()
 	{
+		m_numBodies = 0;
+		m_numContactManifolds = 0;
 		m_numSolverCalls = 0;
 		m_numIterationsUsed = -1;
 		m_remainingLeastSquaresResidual = -1;
@@ -44,9 +64,34 @@ struct btSolverAnalyticsData
 	int m_numSolverCalls;
 	int m_numIterationsUsed;
 	double m_remainingLeastSquaresResidual;
+	btAlignedObjectArray<btSolverIslandAnalyticsData> m_islands;  // filled if m_reportSolverAnalytics is set
+};
+
+///counters of the solver pools, to check that SOLVER_PERSISTENT_POOLS does not allocate in steady state
+struct btSolverPoolStatistics
+{
+	btSolverPoolStatistics()
+	{
+		m_numSolverCalls = 0;
+		m_numGrowingSolverCalls = 0;
+		m_poolMemory = 0;
+		m_numReusedSolverBodies = 0;
+		m_numUpdatedSolverBodies = 0;
+		m_numRemappedSolverBodies = 0;
+	}
+	int m_numSolverCalls;
+	int m_numGrowingSolverCalls;    // solver calls in which a pool had to reallocate
+	size_t m_poolMemory;            // bytes reserved by the pools
+	int m_numReusedSolverBodies;    // bodies that kept their solver body from the previous solver call
+	int m_numUpdatedSolverBodies;   // bodies that took over the solver body of another body in the previous solver call
+	int m_numRemappedSolverBodies;  // bodies that were mapped from scratch
 };
 
 ///The btSequentialImpulseConstraintSolver is a fast SIMD implementation of the Projected Gauss Seidel (iterative LCP) method.
+///With SOLVER_PERSISTENT_POOLS the pools grow with some spare capacity and the solver bodies keep their mapping across solver calls,
+///so a scene in steady state solves without allocating, which getPoolStatistics shows.
+///With SOLVER_ADAPTIVE_ISLAND_ITERATIONS the rows of a solver call are split into its connected islands, and an island
+///stops iterating as soon as its residual drops to m_leastSquaresResidualThreshold, while the others keep iterating.
 ATTRIBUTE_ALIGNED16(class)
 btSequentialImpulseConstraintSolver : public btConstraintSolver
 {
@@ -62,6 +107,7 @@ protected:
 	btAlignedObjectArray<int> m_orderTmpConstraintPool;
 	btAlignedObjectArray<int> m_orderNonContactConstraintPool;
 	btAlignedObjectArray<int> m_orderFrictionConstraintPool;
+	btAlignedObjectArray<int> m_orderRollingFrictionConstraintPool;
 	btAlignedObjectArray<btTypedConstraint::btConstraintInfo1> m_tmpConstraintSizesPool;
 	int m_maxOverrideNumSolverIterations;
 	int m_fixedBodyId;
@@ -74,6 +120,12 @@ protected:
 	// index in this solver-local table, indexed by the uniqueId of the body.
 	btAlignedObjectArray<int> m_kinematicBodyUniqueIdToSolverBodyTable;  // only used for multithreading
 
+	// SOLVER_PERSISTENT_POOLS keeps the body to solver body mapping of the previous solver call
+	btAlignedObjectArray<btCollisionObject*> m_persistentBodies;
+	btAlignedObjectArray<int> m_persistentSolverBodyIds;  // solver body per entry of m_persistentBodies
+	int m_persistentFixedBodyId;
+	btSolverPoolStatistics m_poolStatistics;
+
 	btSingleConstraintRowSolver m_resolveSingleConstraintRowGeneric;
 	btSingleConstraintRowSolver m_resolveSingleConstraintRowLowerLimit;
 	btSingleConstraintRowSolver m_resolveSplitPenetrationImpulse;
@@ -82,6 +134,28 @@ protected:
 
 	btScalar m_leastSquaresResidual;
 
+	// SOLVER_ADAPTIVE_ISLAND_ITERATIONS, the rows of an island are a range of each order array
+	struct btSolverIsland
+	{
+		int m_islandTag;
+		int m_numBodies;
+		int m_jointBegin;
+		int m_jointEnd;
+		int m_contactBegin;
+		int m_contactEnd;
+		int m_frictionBegin;
+		int m_frictionEnd;
+		int m_rollingFrictionBegin;
+		int m_rollingFrictionEnd;
+		int m_numIterationsUsed;
+		btScalar m_leastSquaresResidual;
+	};
+	btAlignedObjectArray<btSolverIsland> m_solverIslands;  // empty if the rows are not solved by island
+	btAlignedObjectArray<int> m_activeSolverIslands;      // islands that have not converged yet
+	btAlignedObjectArray<int> m_rootSolverIslands;        // island per union find root
+	btAlignedObjectArray<int> m_islandRowOffsets;
+	btUnionFind m_solverBodyUnionFind;
+
 	void setupFrictionConstraint(btSolverConstraint & solverConstraint, const btVector3& normalAxis, int solverBodyIdA, int solverBodyIdB,
 		btManifoldPoint& cp, const btVector3& rel_pos1, const btVector3& rel_pos2,
 		btCollisionObject* colObj0, btCollisionObject* colObj1, btScalar relaxation,
@@ -117,6 +191,22 @@ protected:
 	void convertJoint(btSolverConstraint * currentConstraintRow, btTypedConstraint * constraint, const btTypedConstraint::btConstraintInfo1& info1, int solverBodyIdA, int solverBodyIdB, const btContactSolverInfo& infoGlobal);
 
 	virtual void convertBodies(btCollisionObject * *bodies, int numBodies, const btContactSolverInfo& infoGlobal);
+	void convertPersistentBodies(btCollisionObject * *bodies, int numBodies, const btContactSolverInfo& infoGlobal);
+	void setSolverBodyId(btCollisionObject & body, int solverBodyId);
+
+	///returns the bytes reserved by the pools, it only grows when a pool reallocates
+	virtual size_t getPoolMemory() const;
+
+	///resizes a pool without initializing it, with SOLVER_PERSISTENT_POOLS a pool that has to grow reserves 1/16 extra
+	template <typename T>
+	static void resizeSolverPool(btAlignedObjectArray<T> & pool, int newSize, int solverMode)
+	{
+		if ((solverMode & SOLVER_PERSISTENT_POOLS) && pool.capacity() < newSize)
+		{
+			pool.reserve(newSize + newSize / 16);
+		}
+		pool.resizeNoInitialize(newSize);
+	}
 
 	btScalar resolveSplitPenetrationSIMD(btSolverBody & bodyA, btSolverBody & bodyB, const btSolverConstraint& contactConstraint)
 	{
@@ -141,6 +231,25 @@ protected:
 		return m_resolveSplitPenetrationImpulse(bodyA, bodyB, contactConstraint);
 	}
 
+	void shuffleConstraintOrder(btAlignedObjectArray<int> & order, int iBegin, int iEnd);
+	btScalar solveJointRows(int iBegin, int iEnd, int iteration);
+	btScalar solveContactRows(int contactBegin, int contactEnd, int frictionBegin, int frictionEnd, int rollingFrictionBegin, int rollingFrictionEnd, const btContactSolverInfo& infoGlobal);
+	void solveObsoleteConstraints(btTypedConstraint * *constraints, int numConstraints, const btContactSolverInfo& infoGlobal);
+
+	///the solver body moves under impulses. m_invMass is not enough, as it is zero for a body with a zero linear factor that can still rotate
+	bool isDynamicSolverBody(int solverBodyId) const
+	{
+		const btRigidBody* body = m_tmpSolverBodyPool[solverBodyId].m_originalBody;
+		return body && body->getInvMass() != btScalar(0.);
+	}
+
+	///splits the rows into the connected islands of the solver call, for SOLVER_ADAPTIVE_ISLAND_ITERATIONS.
+	///Solvers that do not solve the rows with solveSingleIteration of this class leave m_solverIslands empty
+	virtual void setupSolverIslands(const btContactSolverInfo& infoGlobal);
+	int getRowIsland(const btSolverConstraint& row);
+	void sortRowsByIsland(const btConstraintArray& pool, btAlignedObjectArray<int>& order);
+	btScalar solveSolverIslands(int iteration, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal);
+
 protected:
 	void writeBackContacts(int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
 	void writeBackJoints(int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
@@ -167,6 +276,15 @@ public:
 
 	int btRandInt2(int n);
 
+	const btSolverPoolStatistics& getPoolStatistics() const
+	{
+		return m_poolStatistics;
+	}
+	void resetPoolStatistics()
+	{
+		m_poolStatistics = btSolverPoolStatistics();
+	}
+
 	void setRandSeed(unsigned long seed)
 	{
 		m_btSeed2 = seed;
@@ -181,6 +299,11 @@ public:
 		return BT_SEQUENTIAL_IMPULSE_SOLVER;
 	}
 
+	virtual btSolverAnalyticsData* getSolverAnalyticsData()
+	{
+		return &m_analyticsData;
+	}
+
 	btSingleConstraintRowSolver getActiveConstraintRowSolverGeneric()
 	{
 		return m_resolveSingleConstraintRowGeneric;
@@ -33,6 +33,7 @@ btSequentialImpulseConstraintSolverMt::btSequentialImpulseConstraintSolverMt()
 {
 	m_numFrictionDirections = 1;
 	m_useObsoleteJointConstraints = false;
+	m_useContactRowPackets = false;
 
 	btFullMemoryFence();
 	m_useBatching = false;
@@ -43,9 +44,28 @@ btSequentialImpulseConstraintSolverMt::~btSequentialImpulseConstraintSolverMt()
 {
 }
 
+// btBatchedConstraints::setup reserves the exact number of constraints,
+// SOLVER_PERSISTENT_POOLS reserves some extra so small changes of the number of constraints do not reallocate
+static void reserveBatchedConstraints(btBatchedConstraints* bc, int numConstraints, int solverMode)
+{
+	if ((solverMode & SOLVER_PERSISTENT_POOLS) && bc->m_constraintIndices.capacity() < numConstraints)
+	{
+		bc->m_constraintIndices.reserve(numConstraints + numConstraints / 16);
+	}
+}
+
+static size_t getBatchedConstraintsMemory(const btBatchedConstraints& bc)
+{
+	return bc.m_constraintIndices.capacity() * sizeof(int) +
+		   (bc.m_batches.capacity() + bc.m_phases.capacity()) * sizeof(btBatchedConstraints::Range) +
+		   bc.m_phaseGrainSize.capacity() +
+		   bc.m_phaseOrder.capacity() * sizeof(int);
+}
+
 void btSequentialImpulseConstraintSolverMt::setupBatchedContactConstraints()
 {
 	BT_PROFILE("setupBatchedContactConstraints");
+	reserveBatchedConstraints(&m_batchedContactConstraints, m_tmpSolverContactConstraintPool.size(), m_cachedSolverMode);
 	m_batchedContactConstraints.setup(&m_tmpSolverContactConstraintPool,
 									  m_tmpSolverBodyPool,
 									  s_contactBatchingMethod,
@@ -57,6 +77,7 @@ void btSequentialImpulseConstraintSolverMt::setupBatchedContactConstraints()
 void btSequentialImpulseConstraintSolverMt::setupBatchedJointConstraints()
 {
 	BT_PROFILE("setupBatchedJointConstraints");
+	reserveBatchedConstraints(&m_batchedJointConstraints, m_tmpSolverNonContactConstraintPool.size(), m_cachedSolverMode);
 	m_batchedJointConstraints.setup(&m_tmpSolverNonContactConstraintPool,
 									m_tmpSolverBodyPool,
 									s_jointBatchingMethod,
@@ -65,6 +86,21 @@ void btSequentialImpulseConstraintSolverMt::setupBatchedJointConstraints()
 									&m_scratchMemory);
 }
 
+size_t btSequentialImpulseConstraintSolverMt::getPoolMemory() const
+{
+	size_t bytes = btSequentialImpulseConstraintSolver::getPoolMemory();
+	bytes += getBatchedConstraintsMemory(m_batchedContactConstraints);
+	bytes += getBatchedConstraintsMemory(m_batchedJointConstraints);
+	bytes += m_manifoldCachedInfoArray.capacity() * sizeof(btContactManifoldCachedInfo);
+	bytes += m_jointParamsArray.capacity() * sizeof(JointParams);
+	bytes += m_setupBlocks.capacity() * sizeof(SetupBlock);
+	bytes += (m_rollingFrictionIndexTable.capacity() + m_contactRowPackets.capacity() + m_contactRowPacketBodies.capacity()) * sizeof(int);
+	bytes += m_contactBatchPackets.capacity() * sizeof(btBatchedConstraints::Range);
+	bytes += (m_contactRowPacketData.capacity() + m_frictionRowPacketData.capacity()) * sizeof(RowPacket);
+	bytes += m_scratchMemory.capacity();
+	return bytes;
+}
+
 void btSequentialImpulseConstraintSolverMt::internalSetupContactConstraints(int iContactConstraint, const btContactSolverInfo& infoGlobal)
 {
 	btSolverConstraint& contactConstraint = m_tmpSolverContactConstraintPool[iContactConstraint];
@@ -401,6 +437,29 @@ int btSequentialImpulseConstraintSolverMt::getOrInitSolverBodyThreadsafe(btColli
 	return solverBodyId;
 }
 
+int btSequentialImpulseConstraintSolverMt::findSolverBody(const btCollisionObject& body) const
+{
+	//
+	// same mapping as getOrInitSolverBodyThreadsafe, but only reads it, so it can be called from many threads
+	// while no solver bodies are added, returns -1 if the body has no solver body yet
+	//
+	bool isRigidBodyType = btRigidBody::upcast(&body) != NULL;
+	if (isRigidBodyType && !body.isStaticOrKinematicObject())
+	{
+		return body.getCompanionId();
+	}
+	else if (isRigidBodyType && body.isKinematicObject())
+	{
+		int uniqueId = body.getWorldArrayIndex();
+		if (uniqueId < m_kinematicBodyUniqueIdToSolverBodyTable.size())
+		{
+			return m_kinematicBodyUniqueIdToSolverBodyTable[uniqueId];
+		}
+		return -1;
+	}
+	return m_fixedBodyId;
+}
+
 void btSequentialImpulseConstraintSolverMt::internalCollectContactManifoldCachedInfo(btContactManifoldCachedInfo* cachedInfoArray, btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal)
 {
 	BT_PROFILE("internalCollectContactManifoldCachedInfo");
@@ -411,21 +470,11 @@ void btSequentialImpulseConstraintSolverMt::internalCollectContactManifoldCached
 		btCollisionObject* colObj0 = (btCollisionObject*)manifold->getBody0();
 		btCollisionObject* colObj1 = (btCollisionObject*)manifold->getBody1();
 
-		int solverBodyIdA = getOrInitSolverBodyThreadsafe(*colObj0, infoGlobal.m_timeStep);
-		int solverBodyIdB = getOrInitSolverBodyThreadsafe(*colObj1, infoGlobal.m_timeStep);
-
-		cachedInfo->solverBodyIds[0] = solverBodyIdA;
-		cachedInfo->solverBodyIds[1] = solverBodyIdB;
+		// bodies without a solver body yet get -1, and are converted later in manifold order, to stay deterministic
+		cachedInfo->solverBodyIds[0] = findSolverBody(*colObj0);
+		cachedInfo->solverBodyIds[1] = findSolverBody(*colObj1);
 		cachedInfo->numTouchingContacts = 0;
 
-		btSolverBody* solverBodyA = &m_tmpSolverBodyPool[solverBodyIdA];
-		btSolverBody* solverBodyB = &m_tmpSolverBodyPool[solverBodyIdB];
-
-		// A contact manifold between 2 static object should not exist!
-		// check the collision flags of your objects if this assert fires.
-		// Incorrectly set collision object flags can degrade performance in various ways.
-		btAssert(!m_tmpSolverBodyPool[solverBodyIdA].m_invMass.isZero() || !m_tmpSolverBodyPool[solverBodyIdB].m_invMass.isZero());
-
 		int iContact = 0;
 		for (int j = 0; j < manifold->getNumContacts(); j++)
 		{
@@ -445,23 +494,55 @@ void btSequentialImpulseConstraintSolverMt::internalCollectContactManifoldCached
 struct CollectContactManifoldCachedInfoLoop : public btIParallelForBody
 {
 	btSequentialImpulseConstraintSolverMt* m_solver;
-	btSequentialImpulseConstraintSolverMt::btContactManifoldCachedInfo* m_cachedInfoArray;
 	btPersistentManifold** m_manifoldPtr;
+	int m_numManifolds;
 	const btContactSolverInfo* m_infoGlobal;
 
-	CollectContactManifoldCachedInfoLoop(btSequentialImpulseConstraintSolverMt* solver, btSequentialImpulseConstraintSolverMt::btContactManifoldCachedInfo* cachedInfoArray, btPersistentManifold** manifoldPtr, const btContactSolverInfo& infoGlobal)
+	CollectContactManifoldCachedInfoLoop(btSequentialImpulseConstraintSolverMt* solver, btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal)
 	{
 		m_solver = solver;
-		m_cachedInfoArray = cachedInfoArray;
 		m_manifoldPtr = manifoldPtr;
+		m_numManifolds = numManifolds;
 		m_infoGlobal = &infoGlobal;
 	}
 	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
 	{
-		m_solver->internalCollectContactManifoldCachedInfo(m_cachedInfoArray + iBegin, m_manifoldPtr + iBegin, iEnd - iBegin, *m_infoGlobal);
+		for (int iBlock = iBegin; iBlock < iEnd; ++iBlock)
+		{
+			m_solver->internalCollectContactSetupBlock(iBlock, m_manifoldPtr, m_numManifolds, *m_infoGlobal);
+		}
 	}
 };
 
+void btSequentialImpulseConstraintSolverMt::internalCollectContactSetupBlock(int iBlock, btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal)
+{
+	int iBegin = iBlock * CONTACT_SETUP_BLOCK_SIZE;
+	int iEnd = btMin(iBegin + CONTACT_SETUP_BLOCK_SIZE, numManifolds);
+	btContactManifoldCachedInfo* cachedInfoArray = &m_manifoldCachedInfoArray[0];
+	internalCollectContactManifoldCachedInfo(cachedInfoArray + iBegin, manifoldPtr + iBegin, iEnd - iBegin, infoGlobal);
+
+	SetupBlock& block = m_setupBlocks[iBlock];
+	block.m_numRows = 0;
+	block.m_numRollingFrictionRows = 0;
+	block.m_hasMissingSolverBodies = false;
+	for (int iManifold = iBegin; iManifold < iEnd; ++iManifold)
+	{
+		const btContactManifoldCachedInfo& cachedInfo = cachedInfoArray[iManifold];
+		block.m_numRows += cachedInfo.numTouchingContacts;
+		for (int i = 0; i < cachedInfo.numTouchingContacts; ++i)
+		{
+			if (cachedInfo.contactHasRollingFriction[i])
+			{
+				block.m_numRollingFrictionRows += 3;
+			}
+		}
+		if (cachedInfo.solverBodyIds[0] < 0 || cachedInfo.solverBodyIds[1] < 0)
+		{
+			block.m_hasMissingSolverBodies = true;
+		}
+	}
+}
+
 void btSequentialImpulseConstraintSolverMt::internalAllocContactConstraints(const btContactManifoldCachedInfo* cachedInfoArray, int numManifolds)
 {
 	BT_PROFILE("internalAllocContactConstraints");
@@ -512,55 +593,102 @@ void btSequentialImpulseConstraintSolverMt::internalAllocContactConstraints(cons
 struct AllocContactConstraintsLoop : public btIParallelForBody
 {
 	btSequentialImpulseConstraintSolverMt* m_solver;
-	const btSequentialImpulseConstraintSolverMt::btContactManifoldCachedInfo* m_cachedInfoArray;
+	int m_numManifolds;
 
-	AllocContactConstraintsLoop(btSequentialImpulseConstraintSolverMt* solver, btSequentialImpulseConstraintSolverMt::btContactManifoldCachedInfo* cachedInfoArray)
+	AllocContactConstraintsLoop(btSequentialImpulseConstraintSolverMt* solver, int numManifolds)
 	{
 		m_solver = solver;
-		m_cachedInfoArray = cachedInfoArray;
+		m_numManifolds = numManifolds;
 	}
 	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
 	{
-		m_solver->internalAllocContactConstraints(m_cachedInfoArray + iBegin, iEnd - iBegin);
+		for (int iBlock = iBegin; iBlock < iEnd; ++iBlock)
+		{
+			m_solver->internalAllocContactSetupBlock(iBlock, m_numManifolds);
+		}
 	}
 };
 
+void btSequentialImpulseConstraintSolverMt::internalAllocContactSetupBlock(int iBlock, int numManifolds)
+{
+	int iBegin = iBlock * CONTACT_SETUP_BLOCK_SIZE;
+	int iEnd = btMin(iBegin + CONTACT_SETUP_BLOCK_SIZE, numManifolds);
+	btContactManifoldCachedInfo* cachedInfoArray = &m_manifoldCachedInfoArray[0];
+	const SetupBlock& block = m_setupBlocks[iBlock];
+	int contactIndex = block.m_rowOffset;
+	int rollingFrictionIndex = block.m_rollingFrictionRowOffset;
+	for (int iManifold = iBegin; iManifold < iEnd; ++iManifold)
+	{
+		btContactManifoldCachedInfo& cachedInfo = cachedInfoArray[iManifold];
+		cachedInfo.contactIndex = contactIndex;
+		cachedInfo.rollingFrictionIndex = rollingFrictionIndex;
+		contactIndex += cachedInfo.numTouchingContacts;
+		for (int i = 0; i < cachedInfo.numTouchingContacts; ++i)
+		{
+			if (cachedInfo.contactHasRollingFriction[i])
+			{
+				rollingFrictionIndex += 3;
+			}
+		}
+	}
+	internalAllocContactConstraints(cachedInfoArray + iBegin, iEnd - iBegin);
+}
+
 void btSequentialImpulseConstraintSolverMt::allocAllContactConstraints(btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal)
 {
 	BT_PROFILE("allocAllContactConstraints");
-	btAlignedObjectArray<btContactManifoldCachedInfo> cachedInfoArray;  // = m_manifoldCachedInfoArray;
-	cachedInfoArray.resizeNoInitialize(numManifolds);
-	if (/* DISABLES CODE */ (false))
-	{
-		// sequential
-		internalCollectContactManifoldCachedInfo(&cachedInfoArray[0], manifoldPtr, numManifolds, infoGlobal);
-	}
-	else
-	{
-		// may alter ordering of bodies which affects determinism
-		CollectContactManifoldCachedInfoLoop loop(this, &cachedInfoArray[0], manifoldPtr, infoGlobal);
-		int grainSize = 200;
-		btParallelFor(0, numManifolds, grainSize, loop);
+	// The manifolds are split into blocks of a fixed size, so the setup does not depend on the number of threads.
+	// Each block collects its manifolds and counts its rows in parallel, a prefix sum over the blocks gives
+	// the first row of each block, and the blocks write their rows in parallel.
+	int numBlocks = (numManifolds + CONTACT_SETUP_BLOCK_SIZE - 1) / CONTACT_SETUP_BLOCK_SIZE;
+	resizeSolverPool(m_manifoldCachedInfoArray, numManifolds, infoGlobal.m_solverMode);
+	resizeSolverPool(m_setupBlocks, numBlocks, infoGlobal.m_solverMode);
+	{
+		CollectContactManifoldCachedInfoLoop loop(this, manifoldPtr, numManifolds, infoGlobal);
+		int grainSize = 1;
+		btParallelFor(0, numBlocks, grainSize, loop);
 	}
 
 	{
-		// serial part
+		// serial part, only over the blocks
 		int numContacts = 0;
 		int numRollingFrictionConstraints = 0;
-		for (int iManifold = 0; iManifold < numManifolds; ++iManifold)
+		for (int iBlock = 0; iBlock < numBlocks; ++iBlock)
 		{
-			btContactManifoldCachedInfo& cachedInfo = cachedInfoArray[iManifold];
-			cachedInfo.contactIndex = numContacts;
-			cachedInfo.rollingFrictionIndex = numRollingFrictionConstraints;
-			numContacts += cachedInfo.numTouchingContacts;
-			for (int i = 0; i < cachedInfo.numTouchingContacts; ++i)
+			SetupBlock& block = m_setupBlocks[iBlock];
+			if (block.m_hasMissingSolverBodies)
 			{
-				if (cachedInfo.contactHasRollingFriction[i])
+				int iBegin = iBlock * CONTACT_SETUP_BLOCK_SIZE;
+				int iEnd = btMin(iBegin + CONTACT_SETUP_BLOCK_SIZE, numManifolds);
+				for (int iManifold = iBegin; iManifold < iEnd; ++iManifold)
 				{
-					numRollingFrictionConstraints += 3;
+					btContactManifoldCachedInfo& cachedInfo = m_manifoldCachedInfoArray[iManifold];
+					btPersistentManifold* manifold = manifoldPtr[iManifold];
+					if (cachedInfo.solverBodyIds[0] < 0)
+					{
+						cachedInfo.solverBodyIds[0] = getOrInitSolverBodyThreadsafe(*(btCollisionObject*)manifold->getBody0(), infoGlobal.m_timeStep);
+					}
+					if (cachedInfo.solverBodyIds[1] < 0)
+					{
+						cachedInfo.solverBodyIds[1] = getOrInitSolverBodyThreadsafe(*(btCollisionObject*)manifold->getBody1(), infoGlobal.m_timeStep);
+					}
 				}
 			}
+			block.m_rowOffset = numContacts;
+			block.m_rollingFrictionRowOffset = numRollingFrictionConstraints;
+			numContacts += block.m_numRows;
+			numRollingFrictionConstraints += block.m_numRollingFrictionRows;
 		}
+#ifdef BT_DEBUG
+		for (int iManifold = 0; iManifold < numManifolds; ++iManifold)
+		{
+			const btContactManifoldCachedInfo& cachedInfo = m_manifoldCachedInfoArray[iManifold];
+			// A contact manifold between 2 static object should not exist!
+			// check the collision flags of your objects if this assert fires.
+			// Incorrectly set collision object flags can degrade performance in various ways.
+			btAssert(!m_tmpSolverBodyPool[cachedInfo.solverBodyIds[0]].m_invMass.isZero() || !m_tmpSolverBodyPool[cachedInfo.solverBodyIds[1]].m_invMass.isZero());
+		}
+#endif
 		{
 			BT_PROFILE("allocPools");
 			if (m_tmpSolverContactConstraintPool.capacity() < numContacts)
@@ -572,16 +700,16 @@ void btSequentialImpulseConstraintSolverMt::allocAllContactConstraints(btPersist
 				m_tmpSolverContactFrictionConstraintPool.reserve((numContacts + extraReserve) * m_numFrictionDirections);
 				m_tmpSolverContactRollingFrictionConstraintPool.reserve(numRollingFrictionConstraints + extraReserve);
 			}
-			m_tmpSolverContactConstraintPool.resizeNoInitialize(numContacts);
-			m_rollingFrictionIndexTable.resizeNoInitialize(numContacts);
-			m_tmpSolverContactFrictionConstraintPool.resizeNoInitialize(numContacts * m_numFrictionDirections);
-			m_tmpSolverContactRollingFrictionConstraintPool.resizeNoInitialize(numRollingFrictionConstraints);
+			resizeSolverPool(m_tmpSolverContactConstraintPool, numContacts, infoGlobal.m_solverMode);
+			resizeSolverPool(m_rollingFrictionIndexTable, numContacts, infoGlobal.m_solverMode);
+			resizeSolverPool(m_tmpSolverContactFrictionConstraintPool, numContacts * m_numFrictionDirections, infoGlobal.m_solverMode);
+			resizeSolverPool(m_tmpSolverContactRollingFrictionConstraintPool, numRollingFrictionConstraints, infoGlobal.m_solverMode);
 		}
 	}
 	{
-		AllocContactConstraintsLoop loop(this, &cachedInfoArray[0]);
-		int grainSize = 200;
-		btParallelFor(0, numManifolds, grainSize, loop);
+		AllocContactConstraintsLoop loop(this, numManifolds);
+		int grainSize = 1;
+		btParallelFor(0, numBlocks, grainSize, loop);
 	}
 }
 
@@ -610,6 +738,12 @@ void btSequentialImpulseConstraintSolverMt::convertContacts(btPersistentManifold
 			setupBatchedContactConstraints();
 		}
 		setupAllContactConstraints(infoGlobal);
+		if (useBatching && (infoGlobal.m_solverMode & SOLVER_SOA_CONTACT_ROWS))
+		{
+			// the packets copy the rows, so they are set up last
+			setupContactRowPackets();
+			m_useContactRowPackets = true;
+		}
 	}
 }
 
@@ -646,18 +780,51 @@ struct InitJointsLoop : public btIParallelForBody
 {
 	btSequentialImpulseConstraintSolverMt* m_solver;
 	btTypedConstraint** m_constraints;
+	int m_numConstraints;
 
-	InitJointsLoop(btSequentialImpulseConstraintSolverMt* solver, btTypedConstraint** constraints)
+	InitJointsLoop(btSequentialImpulseConstraintSolverMt* solver, btTypedConstraint** constraints, int numConstraints)
 	{
 		m_solver = solver;
 		m_constraints = constraints;
+		m_numConstraints = numConstraints;
 	}
 	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
 	{
-		m_solver->internalInitMultipleJoints(m_constraints, iBegin, iEnd);
+		for (int iBlock = iBegin; iBlock < iEnd; ++iBlock)
+		{
+			m_solver->internalInitJointSetupBlock(iBlock, m_constraints, m_numConstraints);
+		}
 	}
 };
 
+void btSequentialImpulseConstraintSolverMt::internalInitJointSetupBlock(int iBlock, btTypedConstraint** constraints, int numConstraints)
+{
+	int iBegin = iBlock * JOINT_SETUP_BLOCK_SIZE;
+	int iEnd = btMin(iBegin + JOINT_SETUP_BLOCK_SIZE, numConstraints);
+	internalInitMultipleJoints(constraints, iBegin, iEnd);
+
+	SetupBlock& block = m_setupBlocks[iBlock];
+	block.m_numRows = 0;
+	block.m_numRollingFrictionRows = 0;
+	block.m_hasMissingSolverBodies = false;
+	for (int i = iBegin; i < iEnd; ++i)
+	{
+		const btTypedConstraint::btConstraintInfo1& info1 = m_tmpConstraintSizesPool[i];
+		JointParams& params = m_jointParamsArray[i];
+		if (info1.m_numConstraintRows)
+		{
+			btTypedConstraint* constraint = constraints[i];
+			params.m_solverBodyA = findSolverBody(constraint->getRigidBodyA());
+			params.m_solverBodyB = findSolverBody(constraint->getRigidBodyB());
+			if (params.m_solverBodyA < 0 || params.m_solverBodyB < 0)
+			{
+				block.m_hasMissingSolverBodies = true;
+			}
+		}
+		block.m_numRows += info1.m_numConstraintRows;
+	}
+}
+
 void btSequentialImpulseConstraintSolverMt::internalConvertMultipleJoints(const btAlignedObjectArray<JointParams>& jointParamsArray, btTypedConstraint** constraints, int iBegin, int iEnd, const btContactSolverInfo& infoGlobal)
 {
 	BT_PROFILE("internalConvertMultipleJoints");
@@ -682,25 +849,43 @@ void btSequentialImpulseConstraintSolverMt::internalConvertMultipleJoints(const
 struct ConvertJointsLoop : public btIParallelForBody
 {
 	btSequentialImpulseConstraintSolverMt* m_solver;
-	const btAlignedObjectArray<btSequentialImpulseConstraintSolverMt::JointParams>& m_jointParamsArray;
 	btTypedConstraint** m_srcConstraints;
+	int m_numConstraints;
 	const btContactSolverInfo& m_infoGlobal;
 
 	ConvertJointsLoop(btSequentialImpulseConstraintSolverMt* solver,
-					  const btAlignedObjectArray<btSequentialImpulseConstraintSolverMt::JointParams>& jointParamsArray,
 					  btTypedConstraint** srcConstraints,
-					  const btContactSolverInfo& infoGlobal) : m_jointParamsArray(jointParamsArray),
-															   m_infoGlobal(infoGlobal)
+					  int numConstraints,
+					  const btContactSolverInfo& infoGlobal) : m_infoGlobal(infoGlobal)
 	{
 		m_solver = solver;
 		m_srcConstraints = srcConstraints;
+		m_numConstraints = numConstraints;
 	}
 	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
 	{
-		m_solver->internalConvertMultipleJoints(m_jointParamsArray, m_srcConstraints, iBegin, iEnd, m_infoGlobal);
+		for (int iBlock = iBegin; iBlock < iEnd; ++iBlock)
+		{
+			m_solver->internalConvertJointSetupBlock(iBlock, m_srcConstraints, m_numConstraints, m_infoGlobal);
+		}
 	}
 };
 
+void btSequentialImpulseConstraintSolverMt::internalConvertJointSetupBlock(int iBlock, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal)
+{
+	int iBegin = iBlock * JOINT_SETUP_BLOCK_SIZE;
+	int iEnd = btMin(iBegin + JOINT_SETUP_BLOCK_SIZE, numConstraints);
+	int currentRow = m_setupBlocks[iBlock].m_rowOffset;
+	for (int i = iBegin; i < iEnd; ++i)
+	{
+		const btTypedConstraint::btConstraintInfo1& info1 = m_tmpConstraintSizesPool[i];
+		JointParams& params = m_jointParamsArray[i];
+		params.m_solverConstraint = info1.m_numConstraintRows ? currentRow : -1;
+		currentRow += info1.m_numConstraintRows;
+	}
+	internalConvertMultipleJoints(m_jointParamsArray, constraints, iBegin, iEnd, infoGlobal);
+}
+
 void btSequentialImpulseConstraintSolverMt::convertJoints(btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal)
 {
 	bool useBatching = m_useBatching;
@@ -712,55 +897,69 @@ void btSequentialImpulseConstraintSolverMt::convertJoints(btTypedConstraint** co
 		return;
 	}
 	BT_PROFILE("convertJoints");
+	// same scheme as the contacts: getInfo1 and the row counts per block in parallel,
+	// a prefix sum over the blocks, then getInfo2 per block in parallel
 	bool parallelJointSetup = true;
-	m_tmpConstraintSizesPool.resizeNoInitialize(numConstraints);
-	if (parallelJointSetup)
-	{
-		InitJointsLoop loop(this, constraints);
-		int grainSize = 40;
-		btParallelFor(0, numConstraints, grainSize, loop);
-	}
-	else
-	{
-		internalInitMultipleJoints(constraints, 0, numConstraints);
-	}
-
-	int totalNumRows = 0;
-	btAlignedObjectArray<JointParams> jointParamsArray;
-	jointParamsArray.resizeNoInitialize(numConstraints);
-
-	//calculate the total number of contraint rows
-	for (int i = 0; i < numConstraints; i++)
+	int numBlocks = (numConstraints + JOINT_SETUP_BLOCK_SIZE - 1) / JOINT_SETUP_BLOCK_SIZE;
+	resizeSolverPool(m_tmpConstraintSizesPool, numConstraints, infoGlobal.m_solverMode);
+	resizeSolverPool(m_jointParamsArray, numConstraints, infoGlobal.m_solverMode);
+	resizeSolverPool(m_setupBlocks, numBlocks, infoGlobal.m_solverMode);
 	{
-		btTypedConstraint* constraint = constraints[i];
-
-		JointParams& params = jointParamsArray[i];
-		const btTypedConstraint::btConstraintInfo1& info1 = m_tmpConstraintSizesPool[i];
-
-		if (info1.m_numConstraintRows)
+		InitJointsLoop loop(this, constraints, numConstraints);
+		if (parallelJointSetup)
 		{
-			params.m_solverConstraint = totalNumRows;
-			params.m_solverBodyA = getOrInitSolverBody(constraint->getRigidBodyA(), infoGlobal.m_timeStep);
-			params.m_solverBodyB = getOrInitSolverBody(constraint->getRigidBodyB(), infoGlobal.m_timeStep);
+			int grainSize = 1;
+			btParallelFor(0, numBlocks, grainSize, loop);
 		}
 		else
 		{
-			params.m_solverConstraint = -1;
+			loop.forLoop(0, numBlocks);
 		}
-		totalNumRows += info1.m_numConstraintRows;
 	}
-	m_tmpSolverNonContactConstraintPool.resizeNoInitialize(totalNumRows);
 
-	///setup the btSolverConstraints
-	if (parallelJointSetup)
+	//calculate the first row of each block
+	int totalNumRows = 0;
+	for (int iBlock = 0; iBlock < numBlocks; ++iBlock)
 	{
-		ConvertJointsLoop loop(this, jointParamsArray, constraints, infoGlobal);
-		int grainSize = 20;
-		btParallelFor(0, numConstraints, grainSize, loop);
+		SetupBlock& block = m_setupBlocks[iBlock];
+		if (block.m_hasMissingSolverBodies)
+		{
+			int iBegin = iBlock * JOINT_SETUP_BLOCK_SIZE;
+			int iEnd = btMin(iBegin + JOINT_SETUP_BLOCK_SIZE, numConstraints);
+			for (int i = iBegin; i < iEnd; ++i)
+			{
+				if (m_tmpConstraintSizesPool[i].m_numConstraintRows)
+				{
+					btTypedConstraint* constraint = constraints[i];
+					JointParams& params = m_jointParamsArray[i];
+					if (params.m_solverBodyA < 0)
+					{
+						params.m_solverBodyA = getOrInitSolverBodyThreadsafe(constraint->getRigidBodyA(), infoGlobal.m_timeStep);
+					}
+					if (params.m_solverBodyB < 0)
+					{
+						params.m_solverBodyB = getOrInitSolverBodyThreadsafe(constraint->getRigidBodyB(), infoGlobal.m_timeStep);
+					}
+				}
+			}
+		}
+		block.m_rowOffset = totalNumRows;
+		totalNumRows += block.m_numRows;
 	}
-	else
+	resizeSolverPool(m_tmpSolverNonContactConstraintPool, totalNumRows, infoGlobal.m_solverMode);
+
+	///setup the btSolverConstraints
 	{
-		internalConvertMultipleJoints(jointParamsArray, constraints, 0, numConstraints, infoGlobal);
+		ConvertJointsLoop loop(this, constraints, numConstraints, infoGlobal);
+		if (parallelJointSetup)
+		{
+			int grainSize = 1;
+			btParallelFor(0, numBlocks, grainSize, loop);
+		}
+		else
+		{
+			loop.forLoop(0, numBlocks);
+		}
 	}
 	setupBatchedJointConstraints();
 }
@@ -825,7 +1024,7 @@ void btSequentialImpulseConstraintSolverMt::convertBodies(btCollisionObject** bo
 	BT_PROFILE("convertBodies");
 	m_kinematicBodyUniqueIdToSolverBodyTable.resize(0);
 
-	m_tmpSolverBodyPool.resizeNoInitialize(numBodies + 1);
+	resizeSolverPool(m_tmpSolverBodyPool, numBodies + 1, infoGlobal.m_solverMode);
 
 	m_fixedBodyId = numBodies;
 	{
@@ -857,7 +1056,8 @@ btScalar btSequentialImpulseConstraintSolverMt::solveGroupCacheFriendlySetup(
 	btIDebugDraw* debugDrawer)
 {
 	m_numFrictionDirections = (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS) ? 2 : 1;
-	
+	m_useContactRowPackets = false;
+
 	btFullMemoryFence();
 	m_useBatching = false;
 	btFullMemoryFence();
@@ -961,6 +1161,15 @@ void btSequentialImpulseConstraintSolverMt::solveGroupCacheFriendlySplitImpulseI
 	}
 }
 
+void btSequentialImpulseConstraintSolverMt::setupSolverIslands(const btContactSolverInfo& infoGlobal)
+{
+	// batched rows are not split by island, only the unbatched ones that solveSingleIteration of the base class solves
+	if (!m_useBatching)
+	{
+		btSequentialImpulseConstraintSolver::setupSolverIslands(infoGlobal);
+	}
+}
+
 btScalar btSequentialImpulseConstraintSolverMt::solveSingleIteration(int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
 {
 	bool useBatching = m_useBatching;
@@ -1074,7 +1283,7 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactFrictionCo
 			int iEnd = iBegin + m_numFrictionDirections;
 			for (int iFriction = iBegin; iFriction < iEnd; ++iFriction)
 			{
-				btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[iFriction++];
+				btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[iFriction];
 				btAssert(solveManifold.m_frictionIndex == iContact);
 
 				solveManifold.m_lowerLimit = -(solveManifold.m_friction * totalImpulse);
@@ -1090,46 +1299,52 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactFrictionCo
 	return leastSquaresResidual;
 }
 
-btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactRollingFrictionConstraints(const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd)
+btScalar btSequentialImpulseConstraintSolverMt::resolveContactRollingFrictionConstraints(int iContact)
 {
 	btScalar leastSquaresResidual = 0.f;
-	for (int iiCons = batchBegin; iiCons < batchEnd; ++iiCons)
+	int iFirstRollingFriction = m_rollingFrictionIndexTable[iContact];
+	if (iFirstRollingFriction >= 0)
 	{
-		int iContact = consIndices[iiCons];
-		int iFirstRollingFriction = m_rollingFrictionIndexTable[iContact];
-		if (iFirstRollingFriction >= 0)
+		btScalar totalImpulse = m_tmpSolverContactConstraintPool[iContact].m_appliedImpulse;
+		// apply rolling friction
+		if (totalImpulse > 0.0f)
 		{
-			btScalar totalImpulse = m_tmpSolverContactConstraintPool[iContact].m_appliedImpulse;
-			// apply rolling friction
-			if (totalImpulse > 0.0f)
+			int iBegin = iFirstRollingFriction;
+			int iEnd = iBegin + 3;
+			for (int iRollingFric = iBegin; iRollingFric < iEnd; ++iRollingFric)
 			{
-				int iBegin = iFirstRollingFriction;
-				int iEnd = iBegin + 3;
-				for (int iRollingFric = iBegin; iRollingFric < iEnd; ++iRollingFric)
+				btSolverConstraint& rollingFrictionConstraint = m_tmpSolverContactRollingFrictionConstraintPool[iRollingFric];
+				if (rollingFrictionConstraint.m_frictionIndex != iContact)
 				{
-					btSolverConstraint& rollingFrictionConstraint = m_tmpSolverContactRollingFrictionConstraintPool[iRollingFric];
-					if (rollingFrictionConstraint.m_frictionIndex != iContact)
-					{
-						break;
-					}
-					btScalar rollingFrictionMagnitude = rollingFrictionConstraint.m_friction * totalImpulse;
-					if (rollingFrictionMagnitude > rollingFrictionConstraint.m_friction)
-					{
-						rollingFrictionMagnitude = rollingFrictionConstraint.m_friction;
-					}
+					break;
+				}
+				btScalar rollingFrictionMagnitude = rollingFrictionConstraint.m_friction * totalImpulse;
+				if (rollingFrictionMagnitude > rollingFrictionConstraint.m_friction)
+				{
+					rollingFrictionMagnitude = rollingFrictionConstraint.m_friction;
+				}
 
-					rollingFrictionConstraint.m_lowerLimit = -rollingFrictionMagnitude;
-					rollingFrictionConstraint.m_upperLimit = rollingFrictionMagnitude;
+				rollingFrictionConstraint.m_lowerLimit = -rollingFrictionMagnitude;
+				rollingFrictionConstraint.m_upperLimit = rollingFrictionMagnitude;
 
-					btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdA], m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdB], rollingFrictionConstraint);
-					leastSquaresResidual += residual * residual;
-				}
+				btScalar residual = resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdA], m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdB], rollingFrictionConstraint);
+				leastSquaresResidual += residual * residual;
 			}
 		}
 	}
 	return leastSquaresResidual;
 }
 
+btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactRollingFrictionConstraints(const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd)
+{
+	btScalar leastSquaresResidual = 0.f;
+	for (int iiCons = batchBegin; iiCons < batchEnd; ++iiCons)
+	{
+		leastSquaresResidual += resolveContactRollingFrictionConstraints(consIndices[iiCons]);
+	}
+	return leastSquaresResidual;
+}
+
 btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactConstraintsInterleaved(const btAlignedObjectArray<int>& contactIndices,
 																							 int batchBegin,
 																							 int batchEnd)
@@ -1199,6 +1414,515 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactConstraint
 	return leastSquaresResidual;
 }
 
+//4 lanes of btScalar for SOLVER_SOA_CONTACT_ROWS, masks have all bits set in the lanes where they are true
+#if defined(BT_USE_SSE)
+typedef __m128 btSolverLane;
+
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneSplat(btScalar x) { return _mm_set1_ps(x); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneLoad(const btScalar* p) { return _mm_load_ps(p); }
+static SIMD_FORCE_INLINE void btSolverLaneStore(btScalar* p, btSolverLane a) { _mm_store_ps(p, a); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneAdd(btSolverLane a, btSolverLane b) { return _mm_add_ps(a, b); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneSub(btSolverLane a, btSolverLane b) { return _mm_sub_ps(a, b); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneMul(btSolverLane a, btSolverLane b) { return _mm_mul_ps(a, b); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneNeg(btSolverLane a) { return _mm_xor_ps(a, _mm_set1_ps(-0.f)); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneLess(btSolverLane a, btSolverLane b) { return _mm_cmplt_ps(a, b); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneSelect(btSolverLane mask, btSolverLane a, btSolverLane b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+static SIMD_FORCE_INLINE int btSolverLaneMoveMask(btSolverLane mask) { return _mm_movemask_ps(mask); }
+
+//x, y and z of 4 vectors
+static SIMD_FORCE_INLINE void btSolverLaneGather3(const btVector3* const* v, btSolverLane* xyz)
+{
+	__m128 r0 = v[0]->mVec128;
+	__m128 r1 = v[1]->mVec128;
+	__m128 r2 = v[2]->mVec128;
+	__m128 r3 = v[3]->mVec128;
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	xyz[0] = r0;
+	xyz[1] = r1;
+	xyz[2] = r2;
+}
+static SIMD_FORCE_INLINE void btSolverLaneScatter3(const btSolverLane* xyz, btVector3* const* v, int usedLanes)
+{
+	__m128 r0 = xyz[0];
+	__m128 r1 = xyz[1];
+	__m128 r2 = xyz[2];
+	__m128 r3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	v[0]->mVec128 = r0;
+	if (usedLanes & 2) v[1]->mVec128 = r1;
+	if (usedLanes & 4) v[2]->mVec128 = r2;
+	if (usedLanes & 8) v[3]->mVec128 = r3;
+}
+#else
+#if defined(BT_USE_NEON)
+typedef float32x4_t btSolverLane;
+
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneSplat(btScalar x) { return vdupq_n_f32(x); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneLoad(const btScalar* p) { return vld1q_f32(p); }
+static SIMD_FORCE_INLINE void btSolverLaneStore(btScalar* p, btSolverLane a) { vst1q_f32(p, a); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneAdd(btSolverLane a, btSolverLane b) { return vaddq_f32(a, b); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneSub(btSolverLane a, btSolverLane b) { return vsubq_f32(a, b); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneMul(btSolverLane a, btSolverLane b) { return vmulq_f32(a, b); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneNeg(btSolverLane a) { return vnegq_f32(a); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneLess(btSolverLane a, btSolverLane b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneSelect(btSolverLane mask, btSolverLane a, btSolverLane b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+static SIMD_FORCE_INLINE int btSolverLaneMoveMask(btSolverLane mask)
+{
+	static const uint32_t bits[4] = {1, 2, 4, 8};
+	const uint32x4_t rt = vandq_u32(vreinterpretq_u32_f32(mask), vld1q_u32(bits));
+	const uint32x2_t rs = vorr_u32(vget_low_u32(rt), vget_high_u32(rt));
+	return int(vget_lane_u32(rs, 0) | vget_lane_u32(rs, 1));
+}
+#else
+struct btSolverLane
+{
+	btScalar m[4];  // masks are 1 or 0
+};
+
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneSplat(btScalar x)
+{
+	btSolverLane r;
+	r.m[0] = r.m[1] = r.m[2] = r.m[3] = x;
+	return r;
+}
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneLoad(const btScalar* p)
+{
+	btSolverLane r;
+	r.m[0] = p[0];
+	r.m[1] = p[1];
+	r.m[2] = p[2];
+	r.m[3] = p[3];
+	return r;
+}
+static SIMD_FORCE_INLINE void btSolverLaneStore(btScalar* p, btSolverLane a)
+{
+	p[0] = a.m[0];
+	p[1] = a.m[1];
+	p[2] = a.m[2];
+	p[3] = a.m[3];
+}
+#define BT_SOLVER_LANE_OP(name, expr)                                       \
+	static SIMD_FORCE_INLINE btSolverLane name(btSolverLane a, btSolverLane b) \
+	{                                                                        \
+		btSolverLane r;                                                      \
+		for (int i = 0; i < 4; ++i)                                          \
+		{                                                                    \
+			r.m[i] = (expr);                                                 \
+		}                                                                    \
+		return r;                                                            \
+	}
+BT_SOLVER_LANE_OP(btSolverLaneAdd, a.m[i] + b.m[i])
+BT_SOLVER_LANE_OP(btSolverLaneSub, a.m[i] - b.m[i])
+BT_SOLVER_LANE_OP(btSolverLaneMul, a.m[i] * b.m[i])
+BT_SOLVER_LANE_OP(btSolverLaneLess, a.m[i] < b.m[i] ? btScalar(1.) : btScalar(0.))
+#undef BT_SOLVER_LANE_OP
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneNeg(btSolverLane a)
+{
+	btSolverLane r;
+	for (int i = 0; i < 4; ++i)
+	{
+		r.m[i] = -a.m[i];
+	}
+	return r;
+}
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneSelect(btSolverLane mask, btSolverLane a, btSolverLane b)
+{
+	btSolverLane r;
+	for (int i = 0; i < 4; ++i)
+	{
+		r.m[i] = mask.m[i] != btScalar(0.) ? a.m[i] : b.m[i];
+	}
+	return r;
+}
+static SIMD_FORCE_INLINE int btSolverLaneMoveMask(btSolverLane mask)
+{
+	int bits = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		bits |= mask.m[i] != btScalar(0.) ? (1 << i) : 0;
+	}
+	return bits;
+}
+#endif
+
+static SIMD_FORCE_INLINE void btSolverLaneGather3(const btVector3* const* v, btSolverLane* xyz)
+{
+	ATTRIBUTE_ALIGNED16(btScalar t[12]);
+	for (int i = 0; i < 4; ++i)
+	{
+		t[i] = v[i]->x();
+		t[4 + i] = v[i]->y();
+		t[8 + i] = v[i]->z();
+	}
+	xyz[0] = btSolverLaneLoad(&t[0]);
+	xyz[1] = btSolverLaneLoad(&t[4]);
+	xyz[2] = btSolverLaneLoad(&t[8]);
+}
+static SIMD_FORCE_INLINE void btSolverLaneScatter3(const btSolverLane* xyz, btVector3* const* v, int usedLanes)
+{
+	ATTRIBUTE_ALIGNED16(btScalar t[12]);
+	btSolverLaneStore(&t[0], xyz[0]);
+	btSolverLaneStore(&t[4], xyz[1]);
+	btSolverLaneStore(&t[8], xyz[2]);
+	for (int i = 0; i < 4; ++i)
+	{
+		if (usedLanes & (1 << i))
+		{
+			v[i]->setValue(t[i], t[4 + i], t[8 + i]);
+		}
+	}
+}
+#endif
+
+static SIMD_FORCE_INLINE void btSolverLaneLoad3(const btScalar (*p)[4], btSolverLane* xyz)
+{
+	xyz[0] = btSolverLaneLoad(p[0]);
+	xyz[1] = btSolverLaneLoad(p[1]);
+	xyz[2] = btSolverLaneLoad(p[2]);
+}
+
+//same order of operations as btSimdDot3
+static SIMD_FORCE_INLINE btSolverLane btSolverLaneDot3(const btSolverLane* a, const btSolverLane* b)
+{
+	return btSolverLaneAdd(btSolverLaneMul(a[0], b[0]), btSolverLaneAdd(btSolverLaneMul(a[1], b[1]), btSolverLaneMul(a[2], b[2])));
+}
+
+// the rows of a packet, the unused lanes repeat the row of the first lane
+static void btInitRowPacket(btSequentialImpulseConstraintSolverMt::RowPacket& packet, const int* contactIndices, const btConstraintArray& rows, int rowsPerContact, int rowOffset, const btAlignedObjectArray<btSolverBody>& bodies)
+{
+	packet.m_usedLanes = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		packet.m_usedLanes |= contactIndices[i] >= 0 ? (1 << i) : 0;
+		int iRow = (contactIndices[i] >= 0 ? contactIndices[i] : contactIndices[0]) * rowsPerContact + rowOffset;
+		const btSolverConstraint& c = rows[iRow];
+		const btVector3& invMassA = bodies[c.m_solverBodyIdA].internalGetInvMass();
+		const btVector3& invMassB = bodies[c.m_solverBodyIdB].internalGetInvMass();
+		for (int k = 0; k < 3; ++k)
+		{
+			packet.m_relpos1CrossNormal[k][i] = c.m_relpos1CrossNormal[k];
+			packet.m_contactNormal1[k][i] = c.m_contactNormal1[k];
+			packet.m_relpos2CrossNormal[k][i] = c.m_relpos2CrossNormal[k];
+			packet.m_contactNormal2[k][i] = c.m_contactNormal2[k];
+			packet.m_linearComponentA[k][i] = c.m_contactNormal1[k] * invMassA[k];
+			packet.m_linearComponentB[k][i] = c.m_contactNormal2[k] * invMassB[k];
+			packet.m_angularComponentA[k][i] = c.m_angularComponentA[k];
+			packet.m_angularComponentB[k][i] = c.m_angularComponentB[k];
+		}
+		packet.m_appliedImpulse[i] = c.m_appliedImpulse;
+		packet.m_rhs[i] = c.m_rhs;
+		packet.m_cfm[i] = c.m_cfm;
+		packet.m_jacDiagABInv[i] = c.m_jacDiagABInv;
+		packet.m_invJacDiagABInv[i] = btScalar(1.) / c.m_jacDiagABInv;
+		packet.m_lowerLimit[i] = c.m_lowerLimit;
+		packet.m_friction[i] = c.m_friction;
+		packet.m_solverBodyIdA[i] = c.m_solverBodyIdA;
+		packet.m_solverBodyIdB[i] = c.m_solverBodyIdB;
+		packet.m_constraintIndex[i] = iRow;
+	}
+}
+
+// Projected Gauss Seidel of one row per lane, like gResolveSingleConstraintRowGeneric_sse2 and gResolveSingleConstraintRowLowerLimit_sse2.
+// The rows of the packet must not share a dynamic body. The impulses only change in activeLanes.
+static btScalar btResolveRowPacket(btSolverBody* bodyPool, btSolverConstraint* rowPool, btSequentialImpulseConstraintSolverMt::RowPacket& packet, btSolverLane lowerLimit, btSolverLane upperLimit, bool clampUpperLimit, btSolverLane activeLanes)
+{
+	btSolverBody* bodyA[4];
+	btSolverBody* bodyB[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		bodyA[i] = &bodyPool[packet.m_solverBodyIdA[i]];
+		bodyB[i] = &bodyPool[packet.m_solverBodyIdB[i]];
+	}
+	const btVector3* v[4];
+	btVector3* out[4];
+#define BT_SOLVER_LANE_GATHER3(expr, xyz) \
+	for (int i = 0; i < 4; ++i)           \
+	{                                     \
+		v[i] = &(expr);                   \
+	}                                     \
+	btSolverLaneGather3(v, xyz)
+#define BT_SOLVER_LANE_SCATTER3(expr, xyz) \
+	for (int i = 0; i < 4; ++i)            \
+	{                                      \
+		out[i] = &(expr);                  \
+	}                                      \
+	btSolverLaneScatter3(xyz, out, packet.m_usedLanes)
+
+	btSolverLane deltaLinearVelocityA[3], deltaAngularVelocityA[3], deltaLinearVelocityB[3], deltaAngularVelocityB[3];
+	BT_SOLVER_LANE_GATHER3(bodyA[i]->internalGetDeltaLinearVelocity(), deltaLinearVelocityA);
+	BT_SOLVER_LANE_GATHER3(bodyA[i]->internalGetDeltaAngularVelocity(), deltaAngularVelocityA);
+	BT_SOLVER_LANE_GATHER3(bodyB[i]->internalGetDeltaLinearVelocity(), deltaLinearVelocityB);
+	BT_SOLVER_LANE_GATHER3(bodyB[i]->internalGetDeltaAngularVelocity(), deltaAngularVelocityB);
+
+	btSolverLane c1[3], c2[3];
+	const btSolverLane cpAppliedImp = btSolverLaneLoad(packet.m_appliedImpulse);
+	const btSolverLane jacDiagABInv = btSolverLaneLoad(packet.m_jacDiagABInv);
+	btSolverLane deltaImpulse = btSolverLaneSub(btSolverLaneLoad(packet.m_rhs), btSolverLaneMul(cpAppliedImp, btSolverLaneLoad(packet.m_cfm)));
+	btSolverLaneLoad3(packet.m_contactNormal1, c1);
+	btSolverLaneLoad3(packet.m_relpos1CrossNormal, c2);
+	const btSolverLane deltaVel1Dotn = btSolverLaneAdd(btSolverLaneDot3(c1, deltaLinearVelocityA), btSolverLaneDot3(c2, deltaAngularVelocityA));
+	btSolverLaneLoad3(packet.m_contactNormal2, c1);
+	btSolverLaneLoad3(packet.m_relpos2CrossNormal, c2);
+	const btSolverLane deltaVel2Dotn = btSolverLaneAdd(btSolverLaneDot3(c1, deltaLinearVelocityB), btSolverLaneDot3(c2, deltaAngularVelocityB));
+	deltaImpulse = btSolverLaneSub(deltaImpulse, btSolverLaneMul(deltaVel1Dotn, jacDiagABInv));
+	deltaImpulse = btSolverLaneSub(deltaImpulse, btSolverLaneMul(deltaVel2Dotn, jacDiagABInv));
+	const btSolverLane sum = btSolverLaneAdd(cpAppliedImp, deltaImpulse);
+	const btSolverLane resultLowerLess = btSolverLaneLess(sum, lowerLimit);
+	deltaImpulse = btSolverLaneSelect(resultLowerLess, btSolverLaneSub(lowerLimit, cpAppliedImp), deltaImpulse);
+	btSolverLane appliedImpulse = btSolverLaneSelect(resultLowerLess, lowerLimit, sum);
+	if (clampUpperLimit)
+	{
+		const btSolverLane resultUpperLess = btSolverLaneLess(sum, upperLimit);
+		deltaImpulse = btSolverLaneSelect(resultUpperLess, deltaImpulse, btSolverLaneSub(upperLimit, cpAppliedImp));
+		appliedImpulse = btSolverLaneSelect(resultUpperLess, appliedImpulse, upperLimit);
+	}
+	deltaImpulse = btSolverLaneSelect(activeLanes, deltaImpulse, btSolverLaneSplat(0.f));
+	appliedImpulse = btSolverLaneSelect(activeLanes, appliedImpulse, cpAppliedImp);
+
+	btSolverLaneLoad3(packet.m_linearComponentA, c1);
+	btSolverLaneLoad3(packet.m_angularComponentA, c2);
+	for (int k = 0; k < 3; ++k)
+	{
+		deltaLinearVelocityA[k] = btSolverLaneAdd(deltaLinearVelocityA[k], btSolverLaneMul(c1[k], deltaImpulse));
+		deltaAngularVelocityA[k] = btSolverLaneAdd(deltaAngularVelocityA[k], btSolverLaneMul(c2[k], deltaImpulse));
+	}
+	BT_SOLVER_LANE_SCATTER3(bodyA[i]->internalGetDeltaLinearVelocity(), deltaLinearVelocityA);
+	BT_SOLVER_LANE_SCATTER3(bodyA[i]->internalGetDeltaAngularVelocity(), deltaAngularVelocityA);
+	btSolverLaneLoad3(packet.m_linearComponentB, c1);
+	btSolverLaneLoad3(packet.m_angularComponentB, c2);
+	for (int k = 0; k < 3; ++k)
+	{
+		deltaLinearVelocityB[k] = btSolverLaneAdd(deltaLinearVelocityB[k], btSolverLaneMul(c1[k], deltaImpulse));
+		deltaAngularVelocityB[k] = btSolverLaneAdd(deltaAngularVelocityB[k], btSolverLaneMul(c2[k], deltaImpulse));
+	}
+	BT_SOLVER_LANE_SCATTER3(bodyB[i]->internalGetDeltaLinearVelocity(), deltaLinearVelocityB);
+	BT_SOLVER_LANE_SCATTER3(bodyB[i]->internalGetDeltaAngularVelocity(), deltaAngularVelocityB);
+#undef BT_SOLVER_LANE_GATHER3
+#undef BT_SOLVER_LANE_SCATTER3
+
+	ATTRIBUTE_ALIGNED16(btScalar residual[4]);
+	btSolverLaneStore(packet.m_appliedImpulse, appliedImpulse);
+	btSolverLaneStore(residual, btSolverLaneMul(deltaImpulse, btSolverLaneLoad(packet.m_invJacDiagABInv)));
+	btScalar leastSquaresResidual = 0.f;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (packet.m_usedLanes & (1 << i))
+		{
+			rowPool[packet.m_constraintIndex[i]].m_appliedImpulse = packet.m_appliedImpulse[i];
+			leastSquaresResidual += residual[i] * residual[i];
+		}
+	}
+	return leastSquaresResidual;
+}
+
+struct SetupContactRowPacketsLoop : public btIParallelForBody
+{
+	btSequentialImpulseConstraintSolverMt* m_solver;
+	bool m_init;  // false to group the rows into packets, true to fill in the packets
+
+	SetupContactRowPacketsLoop(btSequentialImpulseConstraintSolverMt* solver, bool init)
+	{
+		m_solver = solver;
+		m_init = init;
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		BT_PROFILE("SetupContactRowPacketsLoop");
+		for (int iBatch = iBegin; iBatch < iEnd; ++iBatch)
+		{
+			if (m_init)
+			{
+				m_solver->internalInitContactRowPackets(iBatch);
+			}
+			else
+			{
+				m_solver->internalSetupContactRowPackets(iBatch);
+			}
+		}
+	}
+};
+
+void btSequentialImpulseConstraintSolverMt::setupContactRowPackets()
+{
+	BT_PROFILE("setupContactRowPackets");
+	const btBatchedConstraints& batchedCons = m_batchedContactConstraints;
+	// a batch has at most one packet per row, so its packets are grouped starting at 4 times its first row
+	resizeSolverPool(m_contactRowPackets, batchedCons.m_constraintIndices.size() * 4, m_cachedSolverMode);
+	resizeSolverPool(m_contactBatchPackets, batchedCons.m_batches.size(), m_cachedSolverMode);
+	resizeSolverPool(m_contactRowPacketBodies, m_tmpSolverBodyPool.size() * 2, m_cachedSolverMode);
+	for (int i = 0; i < m_contactRowPacketBodies.size(); ++i)
+	{
+		m_contactRowPacketBodies[i] = -1;
+	}
+	// the batches of a phase do not share dynamic bodies, so they can group their rows in parallel
+	{
+		SetupContactRowPacketsLoop loop(this, false);
+		for (int iPhase = 0; iPhase < batchedCons.m_phases.size(); ++iPhase)
+		{
+			const btBatchedConstraints::Range& phase = batchedCons.m_phases[iPhase];
+			int grainSize = 1;
+			btParallelFor(phase.begin, phase.end, grainSize, loop);
+		}
+	}
+	int numPackets = 0;
+	for (int iBatch = 0; iBatch < m_contactBatchPackets.size(); ++iBatch)
+	{
+		int numBatchPackets = m_contactBatchPackets[iBatch].end;
+		m_contactBatchPackets[iBatch] = btBatchedConstraints::Range(numPackets, numPackets + numBatchPackets);
+		numPackets += numBatchPackets;
+	}
+	resizeSolverPool(m_contactRowPacketData, numPackets, m_cachedSolverMode);
+	resizeSolverPool(m_frictionRowPacketData, numPackets * m_numFrictionDirections, m_cachedSolverMode);
+	{
+		SetupContactRowPacketsLoop loop(this, true);
+		int grainSize = 1;
+		btParallelFor(0, m_contactBatchPackets.size(), grainSize, loop);
+	}
+}
+
+void btSequentialImpulseConstraintSolverMt::internalSetupContactRowPackets(int iBatch)
+{
+	// packets that are not full are searched for a free lane at most this far, before a new packet is started
+	const int maxPacketSearch = 8;
+
+	const btBatchedConstraints& batchedCons = m_batchedContactConstraints;
+	const btBatchedConstraints::Range& batch = batchedCons.m_batches[iBatch];
+	int* packets = &m_contactRowPackets[batch.begin * 4];
+	int numPackets = 0;
+	int firstOpenPacket = 0;  // the packets before it are full
+	for (int iiCons = batch.begin; iiCons < batch.end; ++iiCons)
+	{
+		int iContact = batchedCons.m_constraintIndices[iiCons];
+		const btSolverConstraint& c = m_tmpSolverContactConstraintPool[iContact];
+		int bodyIds[2] = {c.m_solverBodyIdA, c.m_solverBodyIdB};
+
+		// the row goes after the last packet of its dynamic bodies, which keeps the rows of each body in order
+		int iPacket = firstOpenPacket;
+		for (int j = 0; j < 2; ++j)
+		{
+			const int* bodyPacket = &m_contactRowPacketBodies[bodyIds[j] * 2];
+			if (bodyPacket[1] == iBatch)
+			{
+				iPacket = btMax(iPacket, bodyPacket[0] + 1);
+			}
+		}
+		int searchEnd = btMin(numPackets, iPacket + maxPacketSearch);
+		while (iPacket < searchEnd && packets[iPacket * 4 + 3] >= 0)
+		{
+			++iPacket;
+		}
+		if (iPacket >= searchEnd)
+		{
+			iPacket = numPackets++;
+			for (int i = 0; i < 4; ++i)
+			{
+				packets[iPacket * 4 + i] = -1;
+			}
+		}
+		int* lanes = &packets[iPacket * 4];
+		int iLane = 0;
+		while (lanes[iLane] >= 0)
+		{
+			++iLane;
+		}
+		lanes[iLane] = iContact;
+
+		for (int j = 0; j < 2; ++j)
+		{
+			const btRigidBody* rb = m_tmpSolverBodyPool[bodyIds[j]].m_originalBody;
+			// static and kinematic bodies do not move when an impulse is applied, any number of lanes may use them
+			if (rb && rb->getInvMass() > btScalar(0))
+			{
+				int* bodyPacket = &m_contactRowPacketBodies[bodyIds[j] * 2];
+				bodyPacket[0] = iPacket;
+				bodyPacket[1] = iBatch;
+			}
+		}
+		while (firstOpenPacket < numPackets && packets[firstOpenPacket * 4 + 3] >= 0)
+		{
+			++firstOpenPacket;
+		}
+	}
+	m_contactBatchPackets[iBatch] = btBatchedConstraints::Range(0, numPackets);
+}
+
+void btSequentialImpulseConstraintSolverMt::internalInitContactRowPackets(int iBatch)
+{
+	const btBatchedConstraints::Range& batch = m_batchedContactConstraints.m_batches[iBatch];
+	const btBatchedConstraints::Range& packets = m_contactBatchPackets[iBatch];
+	const int* contactIndices = &m_contactRowPackets[batch.begin * 4];
+	for (int iPacket = packets.begin; iPacket < packets.end; ++iPacket)
+	{
+		btInitRowPacket(m_contactRowPacketData[iPacket], contactIndices, m_tmpSolverContactConstraintPool, 1, 0, m_tmpSolverBodyPool);
+		for (int iDir = 0; iDir < m_numFrictionDirections; ++iDir)
+		{
+			btInitRowPacket(m_frictionRowPacketData[iPacket * m_numFrictionDirections + iDir], contactIndices, m_tmpSolverContactFrictionConstraintPool, m_numFrictionDirections, iDir, m_tmpSolverBodyPool);
+		}
+		contactIndices += 4;
+	}
+}
+
+btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactRowPackets(int packetBegin, int packetEnd)
+{
+	btScalar leastSquaresResidual = 0.f;
+	const btSolverLane allLanes = btSolverLaneLess(btSolverLaneSplat(0.f), btSolverLaneSplat(1.f));
+	for (int iPacket = packetBegin; iPacket < packetEnd; ++iPacket)
+	{
+		RowPacket& packet = m_contactRowPacketData[iPacket];
+		const btSolverLane lowerLimit = btSolverLaneLoad(packet.m_lowerLimit);
+		leastSquaresResidual += btResolveRowPacket(&m_tmpSolverBodyPool[0], &m_tmpSolverContactConstraintPool[0], packet, lowerLimit, lowerLimit, false, allLanes);
+	}
+	return leastSquaresResidual;
+}
+
+btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactFrictionRowPackets(int packetBegin, int packetEnd)
+{
+	btScalar leastSquaresResidual = 0.f;
+	for (int iPacket = packetBegin; iPacket < packetEnd; ++iPacket)
+	{
+		const RowPacket& contactPacket = m_contactRowPacketData[iPacket];
+		const btSolverLane totalImpulse = btSolverLaneLoad(contactPacket.m_appliedImpulse);
+
+		// apply sliding friction
+		const btSolverLane activeLanes = btSolverLaneLess(btSolverLaneSplat(0.f), totalImpulse);
+		if ((btSolverLaneMoveMask(activeLanes) & contactPacket.m_usedLanes) == 0)
+		{
+			continue;
+		}
+		for (int iDir = 0; iDir < m_numFrictionDirections; ++iDir)
+		{
+			RowPacket& packet = m_frictionRowPacketData[iPacket * m_numFrictionDirections + iDir];
+			const btSolverLane upperLimit = btSolverLaneMul(btSolverLaneLoad(packet.m_friction), totalImpulse);
+			leastSquaresResidual += btResolveRowPacket(&m_tmpSolverBodyPool[0], &m_tmpSolverContactFrictionConstraintPool[0], packet, btSolverLaneNeg(upperLimit), upperLimit, true, activeLanes);
+		}
+	}
+	return leastSquaresResidual;
+}
+
+btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactRowPacketsInterleaved(int packetBegin, int packetEnd)
+{
+	btScalar leastSquaresResidual = 0.f;
+	for (int iPacket = packetBegin; iPacket < packetEnd; ++iPacket)
+	{
+		// apply penetration constraint
+		leastSquaresResidual += resolveMultipleContactRowPackets(iPacket, iPacket + 1);
+
+		// apply sliding friction
+		leastSquaresResidual += resolveMultipleContactFrictionRowPackets(iPacket, iPacket + 1);
+
+		// apply rolling friction, one row at a time
+		const RowPacket& packet = m_contactRowPacketData[iPacket];
+		for (int i = 0; i < 4; ++i)
+		{
+			if (packet.m_usedLanes & (1 << i))
+			{
+				leastSquaresResidual += resolveContactRollingFrictionConstraints(packet.m_constraintIndex[i]);
+			}
+		}
+	}
+	return leastSquaresResidual;
+}
+
 void btSequentialImpulseConstraintSolverMt::randomizeBatchedConstraintOrdering(btBatchedConstraints* batchedConstraints)
 {
 	btBatchedConstraints& bc = *batchedConstraints;
@@ -1232,6 +1956,10 @@ void btSequentialImpulseConstraintSolverMt::randomizeConstraintOrdering(int iter
 	if (iteration < numIterations)
 	{
 		randomizeBatchedConstraintOrdering(&m_batchedContactConstraints);
+		if (m_useContactRowPackets)
+		{
+			setupContactRowPackets();
+		}
 	}
 }
 
@@ -1280,11 +2008,13 @@ struct ContactSolverLoop : public btIParallelSumBody
 {
 	btSequentialImpulseConstraintSolverMt* m_solver;
 	const btBatchedConstraints* m_bc;
+	const btAlignedObjectArray<btBatchedConstraints::Range>* m_batchPackets;  // SOLVER_SOA_CONTACT_ROWS packets per batch, or NULL
 
-	ContactSolverLoop(btSequentialImpulseConstraintSolverMt* solver, const btBatchedConstraints* bc)
+	ContactSolverLoop(btSequentialImpulseConstraintSolverMt* solver, const btBatchedConstraints* bc, const btAlignedObjectArray<btBatchedConstraints::Range>* batchPackets)
 	{
 		m_solver = solver;
 		m_bc = bc;
+		m_batchPackets = batchPackets;
 	}
 	btScalar sumLoop(int iBegin, int iEnd) const BT_OVERRIDE
 	{
@@ -1292,8 +2022,16 @@ struct ContactSolverLoop : public btIParallelSumBody
 		btScalar sum = 0;
 		for (int iBatch = iBegin; iBatch < iEnd; ++iBatch)
 		{
-			const btBatchedConstraints::Range& batch = m_bc->m_batches[iBatch];
-			sum += m_solver->resolveMultipleContactConstraints(m_bc->m_constraintIndices, batch.begin, batch.end);
+			if (m_batchPackets)
+			{
+				const btBatchedConstraints::Range& packets = (*m_batchPackets)[iBatch];
+				sum += m_solver->resolveMultipleContactRowPackets(packets.begin, packets.end);
+			}
+			else
+			{
+				const btBatchedConstraints::Range& batch = m_bc->m_batches[iBatch];
+				sum += m_solver->resolveMultipleContactConstraints(m_bc->m_constraintIndices, batch.begin, batch.end);
+			}
 		}
 		return sum;
 	}
@@ -1303,7 +2041,7 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveAllContactConstraints()
 {
 	BT_PROFILE("resolveAllContactConstraints");
 	const btBatchedConstraints& batchedCons = m_batchedContactConstraints;
-	ContactSolverLoop loop(this, &batchedCons);
+	ContactSolverLoop loop(this, &batchedCons, m_useContactRowPackets ? &m_contactBatchPackets : NULL);
 	btScalar leastSquaresResidual = 0.f;
 	for (int iiPhase = 0; iiPhase < batchedCons.m_phases.size(); ++iiPhase)
 	{
@@ -1319,11 +2057,13 @@ struct ContactFrictionSolverLoop : public btIParallelSumBody
 {
 	btSequentialImpulseConstraintSolverMt* m_solver;
 	const btBatchedConstraints* m_bc;
+	const btAlignedObjectArray<btBatchedConstraints::Range>* m_batchPackets;  // SOLVER_SOA_CONTACT_ROWS packets per batch, or NULL
 
-	ContactFrictionSolverLoop(btSequentialImpulseConstraintSolverMt* solver, const btBatchedConstraints* bc)
+	ContactFrictionSolverLoop(btSequentialImpulseConstraintSolverMt* solver, const btBatchedConstraints* bc, const btAlignedObjectArray<btBatchedConstraints::Range>* batchPackets)
 	{
 		m_solver = solver;
 		m_bc = bc;
+		m_batchPackets = batchPackets;
 	}
 	btScalar sumLoop(int iBegin, int iEnd) const BT_OVERRIDE
 	{
@@ -1331,8 +2071,16 @@ struct ContactFrictionSolverLoop : public btIParallelSumBody
 		btScalar sum = 0;
 		for (int iBatch = iBegin; iBatch < iEnd; ++iBatch)
 		{
-			const btBatchedConstraints::Range& batch = m_bc->m_batches[iBatch];
-			sum += m_solver->resolveMultipleContactFrictionConstraints(m_bc->m_constraintIndices, batch.begin, batch.end);
+			if (m_batchPackets)
+			{
+				const btBatchedConstraints::Range& packets = (*m_batchPackets)[iBatch];
+				sum += m_solver->resolveMultipleContactFrictionRowPackets(packets.begin, packets.end);
+			}
+			else
+			{
+				const btBatchedConstraints::Range& batch = m_bc->m_batches[iBatch];
+				sum += m_solver->resolveMultipleContactFrictionConstraints(m_bc->m_constraintIndices, batch.begin, batch.end);
+			}
 		}
 		return sum;
 	}
@@ -1342,7 +2090,7 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveAllContactFrictionConstra
 {
 	BT_PROFILE("resolveAllContactFrictionConstraints");
 	const btBatchedConstraints& batchedCons = m_batchedContactConstraints;
-	ContactFrictionSolverLoop loop(this, &batchedCons);
+	ContactFrictionSolverLoop loop(this, &batchedCons, m_useContactRowPackets ? &m_contactBatchPackets : NULL);
 	btScalar leastSquaresResidual = 0.f;
 	for (int iiPhase = 0; iiPhase < batchedCons.m_phases.size(); ++iiPhase)
 	{
@@ -1358,11 +2106,13 @@ struct InterleavedContactSolverLoop : public btIParallelSumBody
 {
 	btSequentialImpulseConstraintSolverMt* m_solver;
 	const btBatchedConstraints* m_bc;
+	const btAlignedObjectArray<btBatchedConstraints::Range>* m_batchPackets;  // SOLVER_SOA_CONTACT_ROWS packets per batch, or NULL
 
-	InterleavedContactSolverLoop(btSequentialImpulseConstraintSolverMt* solver, const btBatchedConstraints* bc)
+	InterleavedContactSolverLoop(btSequentialImpulseConstraintSolverMt* solver, const btBatchedConstraints* bc, const btAlignedObjectArray<btBatchedConstraints::Range>* batchPackets)
 	{
 		m_solver = solver;
 		m_bc = bc;
+		m_batchPackets = batchPackets;
 	}
 	btScalar sumLoop(int iBegin, int iEnd) const BT_OVERRIDE
 	{
@@ -1370,8 +2120,16 @@ struct InterleavedContactSolverLoop : public btIParallelSumBody
 		btScalar sum = 0;
 		for (int iBatch = iBegin; iBatch < iEnd; ++iBatch)
 		{
-			const btBatchedConstraints::Range& batch = m_bc->m_batches[iBatch];
-			sum += m_solver->resolveMultipleContactConstraintsInterleaved(m_bc->m_constraintIndices, batch.begin, batch.end);
+			if (m_batchPackets)
+			{
+				const btBatchedConstraints::Range& packets = (*m_batchPackets)[iBatch];
+				sum += m_solver->resolveMultipleContactRowPacketsInterleaved(packets.begin, packets.end);
+			}
+			else
+			{
+				const btBatchedConstraints::Range& batch = m_bc->m_batches[iBatch];
+				sum += m_solver->resolveMultipleContactConstraintsInterleaved(m_bc->m_constraintIndices, batch.begin, batch.end);
+			}
 		}
 		return sum;
 	}
@@ -1381,7 +2139,7 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveAllContactConstraintsInte
 {
 	BT_PROFILE("resolveAllContactConstraintsInterleaved");
 	const btBatchedConstraints& batchedCons = m_batchedContactConstraints;
-	InterleavedContactSolverLoop loop(this, &batchedCons);
+	InterleavedContactSolverLoop loop(this, &batchedCons, m_useContactRowPackets ? &m_contactBatchPackets : NULL);
 	btScalar leastSquaresResidual = 0.f;
 	for (int iiPhase = 0; iiPhase < batchedCons.m_phases.size(); ++iiPhase)
 	{
@@ -48,6 +48,13 @@ subject to the following restrictions:
 ///  is randomized, however it does not swap constraints between batches.
 ///  This is to avoid regenerating the batches for each solver iteration which would be quite costly in performance.
 ///
+///  When the SOLVER_SOA_CONTACT_ROWS flag is enabled, the contact and friction rows of each batch are grouped into packets
+///  of up to 4 rows that do not share a dynamic body, and the rows of a packet are solved in lock-step in the lanes of a SIMD register.
+///  The packets keep the order of the rows of each body, so the result is the same as solving the rows one by one, up to rounding.
+///  Like the SSE row solvers, the linear and angular factors of the bodies are only applied through the inverse mass and the
+///  angular components of the rows. Rolling friction, split impulse and joint rows are still solved one by one.
+///  With SOLVER_RANDMIZE_ORDER the packets are set up again after every shuffle, which takes about as long as an iteration.
+///
 ///  Note that a non-zero leastSquaresResidualThreshold could possibly affect the determinism of the simulation
 ///  if the task scheduler's parallelSum operation is non-deterministic. The parallelSum operation can be non-deterministic
 ///  because floating point addition is not associative due to rounding errors.
@@ -60,6 +67,7 @@ public:
 	virtual void solveGroupCacheFriendlySplitImpulseIterations(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer) BT_OVERRIDE;
 	virtual btScalar solveSingleIteration(int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer) BT_OVERRIDE;
 	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer) BT_OVERRIDE;
+	virtual void setupSolverIslands(const btContactSolverInfo& infoGlobal) BT_OVERRIDE;
 	virtual btScalar solveGroupCacheFriendlyFinish(btCollisionObject * *bodies, int numBodies, const btContactSolverInfo& infoGlobal) BT_OVERRIDE;
 
 	// temp struct used to collect info from persistent manifolds into a cache-friendly struct using multiple threads
@@ -81,6 +89,40 @@ public:
 		int m_solverBodyA;
 		int m_solverBodyB;
 	};
+	// up to 4 contact or friction rows in the lanes of a SIMD register, for SOLVER_SOA_CONTACT_ROWS
+	// unused lanes repeat the first row, and are not written back
+	ATTRIBUTE_ALIGNED16(struct)
+	RowPacket
+	{
+		btScalar m_relpos1CrossNormal[3][4];
+		btScalar m_contactNormal1[3][4];
+		btScalar m_relpos2CrossNormal[3][4];
+		btScalar m_contactNormal2[3][4];
+		btScalar m_linearComponentA[3][4];  // m_contactNormal1 times the inverse mass of body A
+		btScalar m_linearComponentB[3][4];
+		btScalar m_angularComponentA[3][4];
+		btScalar m_angularComponentB[3][4];
+		btScalar m_appliedImpulse[4];
+		btScalar m_rhs[4];
+		btScalar m_cfm[4];
+		btScalar m_jacDiagABInv[4];
+		btScalar m_invJacDiagABInv[4];  // for the residual
+		btScalar m_lowerLimit[4];
+		btScalar m_friction[4];
+		int m_solverBodyIdA[4];
+		int m_solverBodyIdB[4];
+		int m_constraintIndex[4];  // index of the row in its pool
+		int m_usedLanes;           // bit mask
+	};
+	// rows of a block of manifolds or joints during the setup, see allocAllContactConstraints
+	struct SetupBlock
+	{
+		int m_numRows;
+		int m_numRollingFrictionRows;
+		int m_rowOffset;
+		int m_rollingFrictionRowOffset;
+		bool m_hasMissingSolverBodies;  // some bodies of the block need a new solver body
+	};
 	void internalInitMultipleJoints(btTypedConstraint * *constraints, int iBegin, int iEnd);
 	void internalConvertMultipleJoints(const btAlignedObjectArray<JointParams>& jointParamsArray, btTypedConstraint** constraints, int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
 
@@ -94,6 +136,8 @@ public:
 
 protected:
 	static const int CACHE_LINE_SIZE = 64;
+	static const int CONTACT_SETUP_BLOCK_SIZE = 128;  // manifolds per setup block, independent of the number of threads
+	static const int JOINT_SETUP_BLOCK_SIZE = 32;
 
 	btBatchedConstraints m_batchedContactConstraints;
 	btBatchedConstraints m_batchedJointConstraints;
@@ -101,7 +145,15 @@ protected:
 	bool volatile m_useBatching;
 	bool m_useObsoleteJointConstraints;
 	btAlignedObjectArray<btContactManifoldCachedInfo> m_manifoldCachedInfoArray;
+	btAlignedObjectArray<JointParams> m_jointParamsArray;
+	btAlignedObjectArray<SetupBlock> m_setupBlocks;
 	btAlignedObjectArray<int> m_rollingFrictionIndexTable;  // lookup table mapping contact index to rolling friction index
+	bool m_useContactRowPackets;                             // SOLVER_SOA_CONTACT_ROWS
+	btAlignedObjectArray<int> m_contactRowPackets;           // contact indices of the packets, 4 per packet, -1 for unused lanes, each batch starting at 4 times its first row
+	btAlignedObjectArray<btBatchedConstraints::Range> m_contactBatchPackets;  // range of row packets per contact batch
+	btAlignedObjectArray<RowPacket> m_contactRowPacketData;
+	btAlignedObjectArray<RowPacket> m_frictionRowPacketData;  // m_numFrictionDirections per contact row packet
+	btAlignedObjectArray<int> m_contactRowPacketBodies;      // last packet and batch per solver body, while setting up the packets
 	btSpinMutex m_bodySolverArrayMutex;
 	char m_antiFalseSharingPadding[CACHE_LINE_SIZE];  // padding to keep mutexes in separate cachelines
 	btSpinMutex m_kinematicBodyUniqueIdToSolverBodyTableMutex;
@@ -116,11 +168,14 @@ protected:
 
 	virtual void setupBatchedContactConstraints();
 	virtual void setupBatchedJointConstraints();
+	virtual void setupContactRowPackets();
 	virtual void convertJoints(btTypedConstraint * *constraints, int numConstraints, const btContactSolverInfo& infoGlobal) BT_OVERRIDE;
 	virtual void convertContacts(btPersistentManifold * *manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal) BT_OVERRIDE;
 	virtual void convertBodies(btCollisionObject * *bodies, int numBodies, const btContactSolverInfo& infoGlobal) BT_OVERRIDE;
+	virtual size_t getPoolMemory() const BT_OVERRIDE;
 
 	int getOrInitSolverBodyThreadsafe(btCollisionObject & body, btScalar timeStep);
+	int findSolverBody(const btCollisionObject& body) const;
 	void allocAllContactConstraints(btPersistentManifold * *manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal);
 	void setupAllContactConstraints(const btContactSolverInfo& infoGlobal);
 	void randomizeBatchedConstraintOrdering(btBatchedConstraints * batchedConstraints);
@@ -131,16 +186,30 @@ public:
 	btSequentialImpulseConstraintSolverMt();
 	virtual ~btSequentialImpulseConstraintSolverMt();
 
+	// batches of the last solve, see btBatchedConstraints::getStatistics
+	const btBatchedConstraints& getBatchedContactConstraints() const { return m_batchedContactConstraints; }
+	const btBatchedConstraints& getBatchedJointConstraints() const { return m_batchedJointConstraints; }
+
 	btScalar resolveMultipleJointConstraints(const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd, int iteration);
 	btScalar resolveMultipleContactConstraints(const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd);
 	btScalar resolveMultipleContactSplitPenetrationImpulseConstraints(const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd);
 	btScalar resolveMultipleContactFrictionConstraints(const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd);
 	btScalar resolveMultipleContactRollingFrictionConstraints(const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd);
+	btScalar resolveContactRollingFrictionConstraints(int iContact);
 	btScalar resolveMultipleContactConstraintsInterleaved(const btAlignedObjectArray<int>& contactIndices, int batchBegin, int batchEnd);
+	btScalar resolveMultipleContactRowPackets(int packetBegin, int packetEnd);
+	btScalar resolveMultipleContactFrictionRowPackets(int packetBegin, int packetEnd);
+	btScalar resolveMultipleContactRowPacketsInterleaved(int packetBegin, int packetEnd);
 
 	void internalCollectContactManifoldCachedInfo(btContactManifoldCachedInfo * cachedInfoArray, btPersistentManifold * *manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal);
 	void internalAllocContactConstraints(const btContactManifoldCachedInfo* cachedInfoArray, int numManifolds);
+	void internalCollectContactSetupBlock(int iBlock, btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal);
+	void internalAllocContactSetupBlock(int iBlock, int numManifolds);
+	void internalInitJointSetupBlock(int iBlock, btTypedConstraint** constraints, int numConstraints);
+	void internalConvertJointSetupBlock(int iBlock, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal);
 	void internalSetupContactConstraints(int iContactConstraint, const btContactSolverInfo& infoGlobal);
+	void internalSetupContactRowPackets(int iBatch);
+	void internalInitContactRowPackets(int iBatch);
 	void internalConvertBodies(btCollisionObject * *bodies, int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
 	void internalWriteBackContacts(int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
 	void internalWriteBackJoints(int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
@@ -21,6 +21,7 @@ subject to the following restrictions:
 #include "BulletCollision/BroadphaseCollision/btCollisionAlgorithm.h"
 #include "BulletCollision/CollisionShapes/btCollisionShape.h"
 #include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
+#include "BulletCollision/CollisionDispatch/btSweptSphereBatch.h"
 #include "LinearMath/btTransformUtil.h"
 #include "LinearMath/btQuickprof.h"
 
@@ -88,6 +89,8 @@ struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCal
 	btAlignedObjectArray<btPersistentManifold*> m_manifolds;
 	btAlignedObjectArray<btTypedConstraint*> m_constraints;
 
+	btAlignedObjectArray<btSolverAnalyticsData> m_islandAnalyticsData;
+
 	InplaceSolverIslandCallback(
 		btConstraintSolver* solver,
 		btStackAlloc* stackAlloc,
@@ -118,6 +121,17 @@ struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCal
 		m_bodies.resize(0);
 		m_manifolds.resize(0);
 		m_constraints.resize(0);
+		m_islandAnalyticsData.resize(0);
+	}
+
+	void reportSolverAnalytics(int islandId)
+	{
+		btSolverAnalyticsData* analyticsData = (m_solverInfo->m_reportSolverAnalytics & 1) ? m_solver->getSolverAnalyticsData() : 0;
+		if (analyticsData)
+		{
+			analyticsData->m_islandId = islandId;
+			m_islandAnalyticsData.push_back(*analyticsData);
+		}
 	}
 
 	virtual void processIsland(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifolds, int numManifolds, int islandId)
@@ -126,6 +140,7 @@ struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCal
 		{
 			///we don't split islands, so all constraints/contact manifolds/bodies are passed into the solver regardless the island id
 			m_solver->solveGroup(bodies, numBodies, manifolds, numManifolds, &m_sortedConstraints[0], m_numConstraints, *m_solverInfo, m_debugDrawer, m_dispatcher);
+			reportSolverAnalytics(islandId);
 		}
 		else
 		{
@@ -155,6 +170,7 @@ struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCal
 			if (m_solverInfo->m_minimumSolverBatchSize <= 1)
 			{
 				m_solver->solveGroup(bodies, numBodies, manifolds, numManifolds, startConstraint, numCurConstraints, *m_solverInfo, m_debugDrawer, m_dispatcher);
+				reportSolverAnalytics(islandId);
 			}
 			else
 			{
@@ -182,6 +198,11 @@ struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCal
 		btTypedConstraint** constraints = m_constraints.size() ? &m_constraints[0] : 0;
 
 		m_solver->solveGroup(bodies, m_bodies.size(), manifold, m_manifolds.size(), constraints, m_constraints.size(), *m_solverInfo, m_debugDrawer, m_dispatcher);
+		if (m_bodies.size())
+		{
+			// a batch of small islands, btSolverAnalyticsData::m_islands has them separately with SOLVER_ADAPTIVE_ISLAND_ITERATIONS
+			reportSolverAnalytics(-1);
+		}
 		m_bodies.resize(0);
 		m_manifolds.resize(0);
 		m_constraints.resize(0);
@@ -199,7 +220,8 @@ btDiscreteDynamicsWorld::btDiscreteDynamicsWorld(btDispatcher* dispatcher, btBro
 	  m_synchronizeAllMotionStates(false),
 	  m_applySpeculativeContactRestitution(false),
 	  m_profileTimings(0),
-	  m_latencyMotionStateInterpolation(true)
+	  m_latencyMotionStateInterpolation(true),
+	  m_ccdBatch(0)
 
 {
 	if (!m_constraintSolver)
@@ -244,6 +266,22 @@ btDiscreteDynamicsWorld::~btDiscreteDynamicsWorld()
 		m_constraintSolver->~btConstraintSolver();
 		btAlignedFree(m_constraintSolver);
 	}
+	setBatchedCcd(false);
+}
+
+void btDiscreteDynamicsWorld::setBatchedCcd(bool batchedCcd)
+{
+	if (batchedCcd && !m_ccdBatch)
+	{
+		void* mem = btAlignedAlloc(sizeof(btSweptSphereBatch), 16);
+		m_ccdBatch = new (mem) btSweptSphereBatch();
+	}
+	else if (!batchedCcd && m_ccdBatch)
+	{
+		m_ccdBatch->~btSweptSphereBatch();
+		btAlignedFree(m_ccdBatch);
+		m_ccdBatch = 0;
+	}
 }
 
 void btDiscreteDynamicsWorld::saveKinematicState(btScalar timeStep)
@@ -942,12 +980,82 @@ void btDiscreteDynamicsWorld::createPredictiveContacts(btScalar timeStep)
 {
 	BT_PROFILE("createPredictiveContacts");
 	releasePredictiveContacts();
-	if (m_nonStaticRigidBodies.size() > 0)
+	if (m_ccdBatch)
+	{
+		createPredictiveContactsBatched(timeStep);
+	}
+	else if (m_nonStaticRigidBodies.size() > 0)
 	{
 		createPredictiveContactsInternal(&m_nonStaticRigidBodies[0], m_nonStaticRigidBodies.size(), timeStep);
 	}
 }
 
+void btDiscreteDynamicsWorld::sweepCcdBodies(btScalar timeStep)
+{
+	BT_PROFILE("sweepCcdBodies");
+	m_ccdBatch->reset(m_collisionObjects.size());
+	if (!getDispatchInfo().m_useContinuous)
+	{
+		return;
+	}
+	btTransform predictedTrans;
+	for (int i = 0; i < m_nonStaticRigidBodies.size(); i++)
+	{
+		btRigidBody* body = m_nonStaticRigidBodies[i];
+		if (body->isActive() && (!body->isStaticOrKinematicObject()) && body->getCcdSquareMotionThreshold() && body->getCollisionShape()->isConvex())
+		{
+			body->predictIntegratedTransform(timeStep, predictedTrans);
+
+			btScalar squareMotion = (predictedTrans.getOrigin() - body->getWorldTransform().getOrigin()).length2();
+
+			if (body->getCcdSquareMotionThreshold() < squareMotion)
+			{
+				gNumClampedCcdMotions++;
+				m_ccdBatch->addSweep(body, predictedTrans.getOrigin(), body->getCcdSweptSphereRadius());
+			}
+		}
+	}
+	m_ccdBatch->sweep(this, getDispatchInfo().m_allowedCcdPenetration);
+}
+
+void btDiscreteDynamicsWorld::createPredictiveContactsBatched(btScalar timeStep)
+{
+	for (int i = 0; i < m_nonStaticRigidBodies.size(); i++)
+	{
+		m_nonStaticRigidBodies[i]->setHitFraction(1.f);
+	}
+	sweepCcdBodies(timeStep);
+
+	//the manifolds are created in sweep order, which is the order of m_nonStaticRigidBodies
+	for (int i = 0; i < m_ccdBatch->getNumSweeps(); i++)
+	{
+		const btSweptSphereHit& hit = m_ccdBatch->getHit(i);
+		if (hit.m_hitFraction < 1.f)
+		{
+			const btSweptSphere& sweep = m_ccdBatch->getSweep(i);
+			btCollisionObject* body = sweep.m_collisionObject;
+			btVector3 distVec = (sweep.m_to - sweep.m_from) * hit.m_hitFraction;
+			btScalar distance = distVec.dot(-hit.m_hitNormalWorld);
+
+			btPersistentManifold* manifold = m_dispatcher1->getNewManifold(body, hit.m_hitCollisionObject);
+			m_predictiveManifolds.push_back(manifold);
+
+			btVector3 worldPointB = sweep.m_from + distVec;
+			btVector3 localPointB = hit.m_hitCollisionObject->getWorldTransform().inverse() * worldPointB;
+
+			btManifoldPoint newPoint(btVector3(0, 0, 0), localPointB, hit.m_hitNormalWorld, distance);
+
+			bool isPredictive = true;
+			int index = manifold->addManifoldPoint(newPoint, isPredictive);
+			btManifoldPoint& pt = manifold->getContactPoint(index);
+			pt.m_combinedRestitution = 0;
+			pt.m_combinedFriction = gCalculateCombinedFrictionCallback(body, hit.m_hitCollisionObject);
+			pt.m_positionWorldOnA = sweep.m_from;
+			pt.m_positionWorldOnB = worldPointB;
+		}
+	}
+}
+
 void btDiscreteDynamicsWorld::integrateTransformsInternal(btRigidBody** bodies, int numBodies, btScalar timeStep)
 {
 	btTransform predictedTrans;
@@ -965,7 +1073,20 @@ void btDiscreteDynamicsWorld::integrateTransformsInternal(btRigidBody** bodies,
 			if (getDispatchInfo().m_useContinuous && body->getCcdSquareMotionThreshold() && body->getCcdSquareMotionThreshold() < squareMotion)
 			{
 				BT_PROFILE("CCD motion clamping");
-				if (body->getCollisionShape()->isConvex())
+				if (m_ccdBatch)
+				{
+					//the sweep was done by sweepCcdBodies, before any body moved
+					int sweepIndex = m_ccdBatch->findSweep(body);
+					if (sweepIndex >= 0 && m_ccdBatch->getHit(sweepIndex).m_hitFraction < 1.f)
+					{
+						body->setHitFraction(m_ccdBatch->getHit(sweepIndex).m_hitFraction);
+						body->predictIntegratedTransform(timeStep * body->getHitFraction(), predictedTrans);
+						body->setHitFraction(0.f);
+						body->proceedToTransform(predictedTrans);
+						continue;
+					}
+				}
+				else if (body->getCollisionShape()->isConvex())
 				{
 					gNumClampedCcdMotions++;
 #ifdef USE_STATIC_ONLY
@@ -1047,6 +1168,10 @@ void btDiscreteDynamicsWorld::integrateTransformsInternal(btRigidBody** bodies,
 void btDiscreteDynamicsWorld::integrateTransforms(btScalar timeStep)
 {
 	BT_PROFILE("integrateTransforms");
+	if (m_ccdBatch)
+	{
+		sweepCcdBodies(timeStep);
+	}
 	if (m_nonStaticRigidBodies.size() > 0)
 	{
 		integrateTransformsInternal(&m_nonStaticRigidBodies[0], m_nonStaticRigidBodies.size(), timeStep);
@@ -1363,6 +1488,11 @@ btConstraintSolver* btDiscreteDynamicsWorld::getConstraintSolver()
 	return m_constraintSolver;
 }
 
+void btDiscreteDynamicsWorld::getAnalyticsData(btAlignedObjectArray<btSolverAnalyticsData>& islandAnalyticsData) const
+{
+	islandAnalyticsData = m_solverIslandCallback->m_islandAnalyticsData;
+}
+
 int btDiscreteDynamicsWorld::getNumConstraints() const
 {
 	return int(m_constraints.size());
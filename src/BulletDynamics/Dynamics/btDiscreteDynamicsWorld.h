@@ -25,6 +25,7 @@ class btTypedConstraint;
 class btActionInterface;
 class btPersistentManifold;
 class btIDebugDraw;
+class btSweptSphereBatch;
 
 struct InplaceSolverIslandCallback;
 
@@ -69,6 +70,8 @@ protected:
 	btAlignedObjectArray<btPersistentManifold*> m_predictiveManifolds;
 	btSpinMutex m_predictiveManifoldsMutex;  // used to synchronize threads creating predictive contacts
 
+	btSweptSphereBatch* m_ccdBatch;  // only created when batched CCD is enabled
+
 	virtual void predictUnconstraintMotion(btScalar timeStep);
 
 	void integrateTransformsInternal(btRigidBody * *bodies, int numBodies, btScalar timeStep);  // can be called in parallel
@@ -90,6 +93,9 @@ protected:
 	void createPredictiveContactsInternal(btRigidBody * *bodies, int numBodies, btScalar timeStep);  // can be called in parallel
 	virtual void createPredictiveContacts(btScalar timeStep);
 
+	void sweepCcdBodies(btScalar timeStep);  // fills m_ccdBatch with the CCD sweeps of all bodies and computes their hits
+	void createPredictiveContactsBatched(btScalar timeStep);
+
 	virtual void saveKinematicState(btScalar timeStep);
 
 	void serializeRigidBodies(btSerializer * serializer);
@@ -160,6 +166,9 @@ public:
 
 	virtual btConstraintSolver* getConstraintSolver();
 
+	///the btSolverAnalyticsData of every solver call of the last step, if getSolverInfo().m_reportSolverAnalytics is set
+	virtual void getAnalyticsData(btAlignedObjectArray<struct btSolverAnalyticsData> & islandAnalyticsData) const;
+
 	virtual int getNumConstraints() const;
 
 	virtual btTypedConstraint* getConstraint(int index);
@@ -216,6 +225,14 @@ public:
 		return m_applySpeculativeContactRestitution;
 	}
 
+	///when enabled, the CCD sweeps of all fast bodies are done together by a btSweptSphereBatch, with one candidate pass over the world and parallel time of impact computation.
+	///all sweeps of a step start from the transforms before integration, so the clamped motion and the predictive contacts do not depend on the body order or the number of threads
+	void setBatchedCcd(bool batchedCcd);
+	bool getBatchedCcd() const
+	{
+		return m_ccdBatch != 0;
+	}
+
 	///Preliminary serialization test for Bullet 2.76. Loading those files requires a separate parser (see Bullet/Demos/SerializeDemo)
 	virtual void serialize(btSerializer * serializer);
 
@@ -72,6 +72,7 @@ btConstraintSolverPoolMt::ThreadSolver* btConstraintSolverPoolMt::getAndLockThre
 void btConstraintSolverPoolMt::init(btConstraintSolver** solvers, int numSolvers)
 {
 	m_solverType = BT_SEQUENTIAL_IMPULSE_SOLVER;
+	m_threadAnalyticsData.resize(BT_MAX_THREAD_COUNT);
 	m_solvers.resize(numSolvers);
 	for (int i = 0; i < numSolvers; ++i)
 	{
@@ -126,10 +127,32 @@ btScalar btConstraintSolverPoolMt::solveGroup(btCollisionObject** bodies,
 {
 	ThreadSolver* ts = getAndLockThreadSolver();
 	ts->solver->solveGroup(bodies, numBodies, manifolds, numManifolds, constraints, numConstraints, info, debugDrawer, dispatcher);
+	if (info.m_reportSolverAnalytics & 1)
+	{
+		// another thread can lock this solver as soon as it is unlocked
+		const btSolverAnalyticsData* analyticsData = ts->solver->getSolverAnalyticsData();
+		if (analyticsData)
+		{
+			*getSolverAnalyticsData() = *analyticsData;
+		}
+	}
 	ts->mutex.unlock();
 	return 0.0f;
 }
 
+btSolverAnalyticsData* btConstraintSolverPoolMt::getSolverAnalyticsData()
+{
+	if (m_solvers.size() == 0 || m_solvers[0].solver->getSolverAnalyticsData() == NULL)
+	{
+		return NULL;
+	}
+	int i = 0;
+#if BT_THREADSAFE
+	i = btGetCurrentThreadIndex() % m_threadAnalyticsData.size();
+#endif  // #if BT_THREADSAFE
+	return &m_threadAnalyticsData[i];
+}
+
 void btConstraintSolverPoolMt::reset()
 {
 	for (int i = 0; i < m_solvers.size(); ++i)
@@ -189,6 +212,11 @@ void btDiscreteDynamicsWorldMt::solveConstraints(btContactSolverInfo& solverInfo
 	m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
 }
 
+void btDiscreteDynamicsWorldMt::getAnalyticsData(btAlignedObjectArray<btSolverAnalyticsData>& islandAnalyticsData) const
+{
+	islandAnalyticsData = static_cast<const btSimulationIslandManagerMt*>(m_islandManager)->getIslandAnalyticsData();
+}
+
 struct UpdaterUnconstrainedMotion : public btIParallelForBody
 {
 	btScalar timeStep;
@@ -226,7 +254,11 @@ void btDiscreteDynamicsWorldMt::createPredictiveContacts(btScalar timeStep)
 {
 	BT_PROFILE("createPredictiveContacts");
 	releasePredictiveContacts();
-	if (m_nonStaticRigidBodies.size() > 0)
+	if (m_ccdBatch)
+	{
+		createPredictiveContactsBatched(timeStep);
+	}
+	else if (m_nonStaticRigidBodies.size() > 0)
 	{
 		UpdaterCreatePredictiveContacts update;
 		update.world = this;
@@ -240,6 +272,10 @@ void btDiscreteDynamicsWorldMt::createPredictiveContacts(btScalar timeStep)
 void btDiscreteDynamicsWorldMt::integrateTransforms(btScalar timeStep)
 {
 	BT_PROFILE("integrateTransforms");
+	if (m_ccdBatch)
+	{
+		sweepCcdBodies(timeStep);
+	}
 	if (m_nonStaticRigidBodies.size() > 0)
 	{
 		UpdaterIntegrateTransforms update;
@@ -19,6 +19,7 @@ subject to the following restrictions:
 #include "btDiscreteDynamicsWorld.h"
 #include "btSimulationIslandManagerMt.h"
 #include "BulletDynamics/ConstraintSolver/btConstraintSolver.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"  // for btSolverAnalyticsData
 
 ///
 /// btConstraintSolverPoolMt - masquerades as a constraint solver, but really it is a threadsafe pool of them.
@@ -54,6 +55,9 @@ public:
 	virtual void reset() BT_OVERRIDE;
 	virtual btConstraintSolverType getSolverType() const BT_OVERRIDE { return m_solverType; }
 
+	///analytics of the last solveGroup call of the calling thread, so each thread gets the analytics of its own island
+	virtual btSolverAnalyticsData* getSolverAnalyticsData() BT_OVERRIDE;
+
 private:
 	const static size_t kCacheLineSize = 128;
 	struct ThreadSolver
@@ -64,6 +68,7 @@ private:
 	};
 	btAlignedObjectArray<ThreadSolver> m_solvers;
 	btConstraintSolverType m_solverType;
+	btAlignedObjectArray<btSolverAnalyticsData> m_threadAnalyticsData;  // per thread index, copied while the solver is locked
 
 	ThreadSolver* getAndLockThreadSolver();
 	void init(btConstraintSolver** solvers, int numSolvers);
@@ -126,6 +131,9 @@ public:
 	virtual ~btDiscreteDynamicsWorldMt();
 
 	virtual int stepSimulation(btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep) BT_OVERRIDE;
+
+	///the analytics of every island solved in the last step, collected by btSimulationIslandManagerMt
+	virtual void getAnalyticsData(btAlignedObjectArray<struct btSolverAnalyticsData> & islandAnalyticsData) const BT_OVERRIDE;
 };
 
 #endif  //BT_DISCRETE_DYNAMICS_WORLD_H
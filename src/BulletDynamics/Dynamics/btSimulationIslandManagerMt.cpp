@@ -44,6 +44,7 @@ btSimulationIslandManagerMt::btSimulationIslandManagerMt()
 	m_batchIslandMinBodyCount = 32;
 	m_islandDispatch = parallelIslandDispatch;
 	m_batchIsland = NULL;
+	m_parallelIslandBuilding = false;
 }
 
 btSimulationIslandManagerMt::~btSimulationIslandManagerMt()
@@ -172,7 +173,11 @@ void btSimulationIslandManagerMt::initIslandPools()
 btSimulationIslandManagerMt::Island* btSimulationIslandManagerMt::getIsland(int id)
 {
 	btAssert(id >= 0);
-	btAssert(id < m_lookupIslandFromId.size());
+	if (id >= m_lookupIslandFromId.size())
+	{
+		// sleeping island kept by the incremental mode
+		return NULL;
+	}
 	Island* island = m_lookupIslandFromId[id];
 	if (island == NULL)
 	{
@@ -265,6 +270,14 @@ void btSimulationIslandManagerMt::buildIslands(btDispatcher* dispatcher, btColli
 {
 	BT_PROFILE("buildIslands");
 
+#ifdef STATIC_SIMULATION_ISLAND_OPTIMIZATION
+	if (m_parallelIslandBuilding)
+	{
+		buildIslandsParallel(collisionWorld);
+		return;
+	}
+#endif  //STATIC_SIMULATION_ISLAND_OPTIMIZATION
+
 	btCollisionObjectArray& collisionObjects = collisionWorld->getCollisionObjectArray();
 
 	//we are going to sort the unionfind array, and store the element id in the size
@@ -330,6 +343,10 @@ void btSimulationIslandManagerMt::buildIslands(btDispatcher* dispatcher, btColli
 					colObj0->setActivationState(ISLAND_SLEEPING);
 				}
 			}
+			if (getIncrementalIslands())
+			{
+				addSleepingIsland(collisionObjects, startIslandIndex, endIslandIndex);
+			}
 		}
 		else
 		{
@@ -361,6 +378,13 @@ void btSimulationIslandManagerMt::buildIslands(btDispatcher* dispatcher, btColli
 
 void btSimulationIslandManagerMt::addBodiesToIslands(btCollisionWorld* collisionWorld)
 {
+#ifdef STATIC_SIMULATION_ISLAND_OPTIMIZATION
+	if (m_parallelIslandBuilding)
+	{
+		addBodiesToIslandsParallel(collisionWorld);
+		return;
+	}
+#endif  //STATIC_SIMULATION_ISLAND_OPTIMIZATION
 	btCollisionObjectArray& collisionObjects = collisionWorld->getCollisionObjectArray();
 	int endIslandIndex = 1;
 	int startIslandIndex;
@@ -406,6 +430,13 @@ void btSimulationIslandManagerMt::addBodiesToIslands(btCollisionWorld* collision
 
 void btSimulationIslandManagerMt::addManifoldsToIslands(btDispatcher* dispatcher)
 {
+#ifdef STATIC_SIMULATION_ISLAND_OPTIMIZATION
+	if (m_parallelIslandBuilding)
+	{
+		addManifoldsToIslandsParallel(dispatcher);
+		return;
+	}
+#endif  //STATIC_SIMULATION_ISLAND_OPTIMIZATION
 	// walk all the manifolds, activating bodies touched by kinematic objects, and add each manifold to its Island
 	int maxNumManifolds = dispatcher->getNumManifolds();
 	for (int i = 0; i < maxNumManifolds; i++)
@@ -466,6 +497,11 @@ void btSimulationIslandManagerMt::addConstraintsToIslands(btAlignedObjectArray<b
 
 void btSimulationIslandManagerMt::mergeIslands()
 {
+	if (m_parallelIslandBuilding)
+	{
+		mergeIslandsParallel();
+		return;
+	}
 	// sort islands in order of decreasing batch size
 	m_activeIslands.quickSort(IslandBatchSizeSortPredicate());
 
@@ -525,6 +561,874 @@ void btSimulationIslandManagerMt::mergeIslands()
 	}
 }
 
+static const int kIslandBlockSize = 1024;  // objects or union find elements per block of the prefix sums
+
+// exclusive prefix sum over the counts of the blocks, with the total at the end
+static int btPrefixSumBlocks(btAlignedObjectArray<int>& blockOffsets, int numBlocks)
+{
+	int sum = 0;
+	for (int i = 0; i < numBlocks; ++i)
+	{
+		int count = blockOffsets[i];
+		blockOffsets[i] = sum;
+		sum += count;
+	}
+	blockOffsets[numBlocks] = sum;
+	return sum;
+}
+
+struct CountDynamicObjectsLoop : public btIParallelForBody
+{
+	btCollisionObjectArray& m_collisionObjects;
+	btAlignedObjectArray<int>& m_blockOffsets;
+
+	CountDynamicObjectsLoop(btCollisionObjectArray& collisionObjects, btAlignedObjectArray<int>& blockOffsets)
+		: m_collisionObjects(collisionObjects), m_blockOffsets(blockOffsets)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int iBlock = iBegin; iBlock < iEnd; ++iBlock)
+		{
+			int iObjBegin = iBlock * kIslandBlockSize;
+			int iObjEnd = btMin(iObjBegin + kIslandBlockSize, m_collisionObjects.size());
+			int count = 0;
+			for (int i = iObjBegin; i < iObjEnd; ++i)
+			{
+				if (!m_collisionObjects[i]->isStaticOrKinematicObject())
+				{
+					count++;
+				}
+			}
+			m_blockOffsets[iBlock] = count;
+		}
+	}
+};
+
+struct InitUnionFindLoop : public btIParallelForBody
+{
+	btCollisionObjectArray& m_collisionObjects;
+	const btAlignedObjectArray<int>& m_blockOffsets;
+	btUnionFind& m_unionFind;
+	btAlignedObjectArray<int>& m_islandLabels;
+
+	InitUnionFindLoop(btCollisionObjectArray& collisionObjects, const btAlignedObjectArray<int>& blockOffsets, btUnionFind& unionFind, btAlignedObjectArray<int>& islandLabels)
+		: m_collisionObjects(collisionObjects), m_blockOffsets(blockOffsets), m_unionFind(unionFind), m_islandLabels(islandLabels)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int iBlock = iBegin; iBlock < iEnd; ++iBlock)
+		{
+			int iObjBegin = iBlock * kIslandBlockSize;
+			int iObjEnd = btMin(iObjBegin + kIslandBlockSize, m_collisionObjects.size());
+			int index = m_blockOffsets[iBlock];
+			for (int i = iObjBegin; i < iObjEnd; ++i)
+			{
+				btCollisionObject* collisionObject = m_collisionObjects[i];
+				if (!collisionObject->isStaticOrKinematicObject())
+				{
+					collisionObject->setIslandTag(index);
+					btElement& element = m_unionFind.getElement(index);
+					element.m_id = index;
+					element.m_sz = i;
+					m_islandLabels[index] = index;
+					index++;
+				}
+				collisionObject->setCompanionId(-1);
+				collisionObject->setHitFraction(btScalar(1.));
+			}
+		}
+	}
+};
+
+void btSimulationIslandManagerMt::updateActivationState(btCollisionWorld* colWorld, btDispatcher* dispatcher)
+{
+#ifdef STATIC_SIMULATION_ISLAND_OPTIMIZATION
+	if (m_parallelIslandBuilding && !getIncrementalIslands())
+	{
+		BT_PROFILE("updateActivationState");
+		// give the dynamic objects consecutive union find elements, in the order of the collision object array
+		btCollisionObjectArray& collisionObjects = colWorld->getCollisionObjectArray();
+		int numBlocks = (collisionObjects.size() + kIslandBlockSize - 1) / kIslandBlockSize;
+		m_blockOffsets.resizeNoInitialize(numBlocks + 1);
+		{
+			CountDynamicObjectsLoop loop(collisionObjects, m_blockOffsets);
+			int grainSize = 1;
+			btParallelFor(0, numBlocks, grainSize, loop);
+		}
+		int numElements = btPrefixSumBlocks(m_blockOffsets, numBlocks);
+		getUnionFind().allocate(numElements);
+		m_islandLabels.resizeNoInitialize(numElements);
+		{
+			InitUnionFindLoop loop(collisionObjects, m_blockOffsets, getUnionFind(), m_islandLabels);
+			int grainSize = 1;
+			btParallelFor(0, numBlocks, grainSize, loop);
+		}
+		findUnions(dispatcher, colWorld);
+		return;
+	}
+#endif  //STATIC_SIMULATION_ISLAND_OPTIMIZATION
+	btSimulationIslandManager::updateActivationState(colWorld, dispatcher);
+}
+
+struct FindUnionsLoop : public btIParallelForBody
+{
+	const btBroadphasePair* m_pairs;
+	btUnionFind& m_unionFind;
+	bool m_skipSleepingPairs;
+
+	FindUnionsLoop(const btBroadphasePair* pairs, btUnionFind& unionFind, bool skipSleepingPairs)
+		: m_pairs(pairs), m_unionFind(unionFind), m_skipSleepingPairs(skipSleepingPairs)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			const btBroadphasePair& collisionPair = m_pairs[i];
+			btCollisionObject* colObj0 = (btCollisionObject*)collisionPair.m_pProxy0->m_clientObject;
+			btCollisionObject* colObj1 = (btCollisionObject*)collisionPair.m_pProxy1->m_clientObject;
+
+			if (((colObj0) && ((colObj0)->mergesSimulationIslands())) &&
+				((colObj1) && ((colObj1)->mergesSimulationIslands())))
+			{
+				// both bodies in one sleeping island, see btSimulationIslandManager::findUnions
+				if (m_skipSleepingPairs && (colObj0->getIslandTag() == colObj1->getIslandTag()))
+				{
+					continue;
+				}
+				m_unionFind.uniteConcurrent((colObj0)->getIslandTag(),
+											(colObj1)->getIslandTag());
+			}
+		}
+	}
+};
+
+void btSimulationIslandManagerMt::findUnions(btDispatcher* dispatcher, btCollisionWorld* colWorld)
+{
+	if (!m_parallelIslandBuilding)
+	{
+		btSimulationIslandManager::findUnions(dispatcher, colWorld);
+		return;
+	}
+	BT_PROFILE("findUnions");
+	btOverlappingPairCache* pairCachePtr = colWorld->getPairCache();
+	const int numOverlappingPairs = pairCachePtr->getNumOverlappingPairs();
+	if (numOverlappingPairs)
+	{
+		FindUnionsLoop loop(pairCachePtr->getOverlappingPairArrayPtr(), getUnionFind(), getIncrementalIslands());
+		int grainSize = 250;
+		btParallelFor(0, numOverlappingPairs, grainSize, loop);
+	}
+}
+
+struct FindIslandLabelsLoop : public btIParallelForBody
+{
+	btUnionFind& m_unionFind;
+	btAlignedObjectArray<int>& m_elementRoots;
+	btAlignedObjectArray<int>& m_islandLabels;
+
+	FindIslandLabelsLoop(btUnionFind& unionFind, btAlignedObjectArray<int>& elementRoots, btAlignedObjectArray<int>& islandLabels)
+		: m_unionFind(unionFind), m_elementRoots(elementRoots), m_islandLabels(islandLabels)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			int root = m_unionFind.findConcurrent(i);
+			m_elementRoots[i] = root;
+			// the label of the root becomes the smallest element of its set
+			int volatile* label = &m_islandLabels[root];
+			int current = *label;
+			while (i < current)
+			{
+				int previous = btAtomicCompareExchange(label, current, i);
+				if (previous == current)
+				{
+					break;
+				}
+				current = previous;
+			}
+		}
+	}
+};
+
+struct StoreIslandTagsLoop : public btIParallelForBody
+{
+	btCollisionObjectArray& m_collisionObjects;
+	btUnionFind& m_unionFind;
+	const btAlignedObjectArray<int>& m_elementRoots;
+	const btAlignedObjectArray<int>& m_islandLabels;
+
+	StoreIslandTagsLoop(btCollisionObjectArray& collisionObjects, btUnionFind& unionFind, const btAlignedObjectArray<int>& elementRoots, const btAlignedObjectArray<int>& islandLabels)
+		: m_collisionObjects(collisionObjects), m_unionFind(unionFind), m_elementRoots(elementRoots), m_islandLabels(islandLabels)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btCollisionObject* collisionObject = m_collisionObjects[i];
+			if (!collisionObject->isStaticOrKinematicObject())
+			{
+				int index = collisionObject->getIslandTag();
+				int islandId = m_islandLabels[m_elementRoots[index]];
+				collisionObject->setIslandTag(islandId);
+				btElement& element = m_unionFind.getElement(index);
+				element.m_id = islandId;
+				//Set the correct object offset in Collision Object Array
+				element.m_sz = i;
+				collisionObject->setCompanionId(-1);
+			}
+			else
+			{
+				collisionObject->setIslandTag(-1);
+				collisionObject->setCompanionId(-2);
+			}
+		}
+	}
+};
+
+void btSimulationIslandManagerMt::storeIslandActivationState(btCollisionWorld* colWorld)
+{
+#ifdef STATIC_SIMULATION_ISLAND_OPTIMIZATION
+	if (m_parallelIslandBuilding && !getIncrementalIslands())
+	{
+		BT_PROFILE("storeIslandActivationState");
+		// the island id is the smallest element of the island, so it does not depend on the order of the unions
+		int numElements = getUnionFind().getNumElements();
+		m_elementRoots.resizeNoInitialize(numElements);
+		{
+			FindIslandLabelsLoop loop(getUnionFind(), m_elementRoots, m_islandLabels);
+			int grainSize = 250;
+			btParallelFor(0, numElements, grainSize, loop);
+		}
+		// put the islandId into m_tag, and into the union find elements as a root of its own
+		btCollisionObjectArray& collisionObjects = colWorld->getCollisionObjectArray();
+		StoreIslandTagsLoop loop(collisionObjects, getUnionFind(), m_elementRoots, m_islandLabels);
+		int grainSize = 250;
+		btParallelFor(0, collisionObjects.size(), grainSize, loop);
+		return;
+	}
+#endif  //STATIC_SIMULATION_ISLAND_OPTIMIZATION
+	btSimulationIslandManager::storeIslandActivationState(colWorld);
+}
+
+struct CountIslandElementsLoop : public btIParallelForBody
+{
+	const btUnionFind& m_unionFind;
+	btAlignedObjectArray<int>& m_islandCursors;
+
+	CountIslandElementsLoop(const btUnionFind& unionFind, btAlignedObjectArray<int>& islandCursors)
+		: m_unionFind(unionFind), m_islandCursors(islandCursors)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btAtomicFetchAdd(&m_islandCursors[m_unionFind.getElement(i).m_id], 1);
+		}
+	}
+};
+
+struct CountIslandsLoop : public btIParallelForBody
+{
+	const btAlignedObjectArray<int>& m_islandCursors;
+	btAlignedObjectArray<int>& m_blockOffsets;
+	btAlignedObjectArray<int>& m_blockIslandOffsets;
+
+	CountIslandsLoop(const btAlignedObjectArray<int>& islandCursors, btAlignedObjectArray<int>& blockOffsets, btAlignedObjectArray<int>& blockIslandOffsets)
+		: m_islandCursors(islandCursors), m_blockOffsets(blockOffsets), m_blockIslandOffsets(blockIslandOffsets)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int iBlock = iBegin; iBlock < iEnd; ++iBlock)
+		{
+			int idBegin = iBlock * kIslandBlockSize;
+			int idEnd = btMin(idBegin + kIslandBlockSize, m_islandCursors.size());
+			int numElements = 0;
+			int numIslands = 0;
+			for (int id = idBegin; id < idEnd; ++id)
+			{
+				int count = m_islandCursors[id];
+				numElements += count;
+				numIslands += (count > 0);
+			}
+			m_blockOffsets[iBlock] = numElements;
+			m_blockIslandOffsets[iBlock] = numIslands;
+		}
+	}
+};
+
+struct AssignIslandStartsLoop : public btIParallelForBody
+{
+	btAlignedObjectArray<int>& m_islandCursors;
+	const btAlignedObjectArray<int>& m_blockOffsets;
+	const btAlignedObjectArray<int>& m_blockIslandOffsets;
+	btAlignedObjectArray<int>& m_islandStarts;
+
+	AssignIslandStartsLoop(btAlignedObjectArray<int>& islandCursors, const btAlignedObjectArray<int>& blockOffsets, const btAlignedObjectArray<int>& blockIslandOffsets, btAlignedObjectArray<int>& islandStarts)
+		: m_islandCursors(islandCursors), m_blockOffsets(blockOffsets), m_blockIslandOffsets(blockIslandOffsets), m_islandStarts(islandStarts)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int iBlock = iBegin; iBlock < iEnd; ++iBlock)
+		{
+			int idBegin = iBlock * kIslandBlockSize;
+			int idEnd = btMin(idBegin + kIslandBlockSize, m_islandCursors.size());
+			int offset = m_blockOffsets[iBlock];
+			int iIsland = m_blockIslandOffsets[iBlock];
+			for (int id = idBegin; id < idEnd; ++id)
+			{
+				int count = m_islandCursors[id];
+				if (count > 0)
+				{
+					m_islandStarts[iIsland++] = offset;
+					m_islandCursors[id] = offset;
+					offset += count;
+				}
+			}
+		}
+	}
+};
+
+struct GatherIslandElementsLoop : public btIParallelForBody
+{
+	const btUnionFind& m_unionFind;
+	btAlignedObjectArray<int>& m_islandCursors;
+	btAlignedObjectArray<btElement>& m_sortedElements;
+
+	GatherIslandElementsLoop(const btUnionFind& unionFind, btAlignedObjectArray<int>& islandCursors, btAlignedObjectArray<btElement>& sortedElements)
+		: m_unionFind(unionFind), m_islandCursors(islandCursors), m_sortedElements(sortedElements)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btElement& element = m_unionFind.getElement(i);
+			int iDest = btAtomicFetchAdd(&m_islandCursors[element.m_id], 1);
+			m_sortedElements[iDest] = element;
+		}
+	}
+};
+
+class ElementObjectIndexSortPredicate
+{
+public:
+	bool operator()(const btElement& lhs, const btElement& rhs) const
+	{
+		return lhs.m_sz < rhs.m_sz;
+	}
+};
+
+struct UpdateIslandSleepingLoop : public btIParallelForBody
+{
+	btCollisionObjectArray& m_collisionObjects;
+	btUnionFind& m_unionFind;
+	btAlignedObjectArray<btElement>& m_sortedElements;
+	const btAlignedObjectArray<int>& m_islandStarts;
+	btAlignedObjectArray<char>& m_islandFlags;
+
+	UpdateIslandSleepingLoop(btCollisionObjectArray& collisionObjects, btUnionFind& unionFind, btAlignedObjectArray<btElement>& sortedElements, const btAlignedObjectArray<int>& islandStarts, btAlignedObjectArray<char>& islandFlags)
+		: m_collisionObjects(collisionObjects), m_unionFind(unionFind), m_sortedElements(sortedElements), m_islandStarts(islandStarts), m_islandFlags(islandFlags)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int iIsland = iBegin; iIsland < iEnd; ++iIsland)
+		{
+			int startIslandIndex = m_islandStarts[iIsland];
+			int endIslandIndex = m_islandStarts[iIsland + 1];
+			// the elements were gathered in any order, put the bodies back in the order of the collision object array
+			if (endIslandIndex - startIslandIndex > 1)
+			{
+				m_sortedElements.quickSortInternal(ElementObjectIndexSortPredicate(), startIslandIndex, endIslandIndex - 1);
+			}
+			for (int idx = startIslandIndex; idx < endIslandIndex; idx++)
+			{
+				m_unionFind.getElement(idx) = m_sortedElements[idx];
+			}
+			int islandId = m_unionFind.getElement(startIslandIndex).m_id;
+
+			bool allSleeping = true;
+			for (int idx = startIslandIndex; idx < endIslandIndex; idx++)
+			{
+				btCollisionObject* colObj0 = m_collisionObjects[m_unionFind.getElement(idx).m_sz];
+				btAssert((colObj0->getIslandTag() == islandId) || (colObj0->getIslandTag() == -1));
+				if (colObj0->getIslandTag() == islandId)
+				{
+					if (colObj0->getActivationState() == ACTIVE_TAG ||
+						colObj0->getActivationState() == DISABLE_DEACTIVATION)
+					{
+						allSleeping = false;
+						break;
+					}
+				}
+			}
+			for (int idx = startIslandIndex; idx < endIslandIndex; idx++)
+			{
+				btCollisionObject* colObj0 = m_collisionObjects[m_unionFind.getElement(idx).m_sz];
+				if (colObj0->getIslandTag() == islandId)
+				{
+					if (allSleeping)
+					{
+						colObj0->setActivationState(ISLAND_SLEEPING);
+					}
+					else if (colObj0->getActivationState() == ISLAND_SLEEPING)
+					{
+						colObj0->setActivationState(WANTS_DEACTIVATION);
+						colObj0->setDeactivationTime(0.f);
+					}
+				}
+			}
+			m_islandFlags[iIsland] = allSleeping;
+		}
+	}
+};
+
+void btSimulationIslandManagerMt::buildIslandsParallel(btCollisionWorld* collisionWorld)
+{
+	btCollisionObjectArray& collisionObjects = collisionWorld->getCollisionObjectArray();
+	btUnionFind& unionFind = getUnionFind();
+	int numElem = unionFind.getNumElements();
+
+	// count the elements of each island, the island id is one of its elements
+	m_islandCursors.resize(0);
+	m_islandCursors.resize(numElem, 0);
+	{
+		CountIslandElementsLoop loop(unionFind, m_islandCursors);
+		int grainSize = 250;
+		btParallelFor(0, numElem, grainSize, loop);
+	}
+	// prefix sums over the island ids give the first element of each island, the islands are in the order of their ids
+	int numBlocks = (numElem + kIslandBlockSize - 1) / kIslandBlockSize;
+	m_blockOffsets.resizeNoInitialize(numBlocks + 1);
+	m_blockIslandOffsets.resizeNoInitialize(numBlocks + 1);
+	{
+		CountIslandsLoop loop(m_islandCursors, m_blockOffsets, m_blockIslandOffsets);
+		int grainSize = 1;
+		btParallelFor(0, numBlocks, grainSize, loop);
+	}
+	btPrefixSumBlocks(m_blockOffsets, numBlocks);
+	int numIslands = btPrefixSumBlocks(m_blockIslandOffsets, numBlocks);
+	m_islandStarts.resizeNoInitialize(numIslands + 1);
+	m_islandStarts[numIslands] = numElem;
+	{
+		AssignIslandStartsLoop loop(m_islandCursors, m_blockOffsets, m_blockIslandOffsets, m_islandStarts);
+		int grainSize = 1;
+		btParallelFor(0, numBlocks, grainSize, loop);
+	}
+	// gather the elements of each island
+	m_sortedElements.resizeNoInitialize(numElem);
+	{
+		GatherIslandElementsLoop loop(unionFind, m_islandCursors, m_sortedElements);
+		int grainSize = 250;
+		btParallelFor(0, numElem, grainSize, loop);
+	}
+	// update the sleeping state of the bodies, and put the sorted elements back into the union find
+	m_islandFlags.resizeNoInitialize(numIslands);
+	{
+		UpdateIslandSleepingLoop loop(collisionObjects, unionFind, m_sortedElements, m_islandStarts, m_islandFlags);
+		int grainSize = 16;
+		btParallelFor(0, numIslands, grainSize, loop);
+	}
+	if (getIncrementalIslands())
+	{
+		for (int iIsland = 0; iIsland < numIslands; ++iIsland)
+		{
+			if (m_islandFlags[iIsland])
+			{
+				addSleepingIsland(collisionObjects, m_islandStarts[iIsland], m_islandStarts[iIsland + 1]);
+			}
+		}
+	}
+}
+
+struct FindActiveIslandsLoop : public btIParallelForBody
+{
+	btCollisionObjectArray& m_collisionObjects;
+	const btUnionFind& m_unionFind;
+	const btAlignedObjectArray<int>& m_islandStarts;
+	btAlignedObjectArray<char>& m_islandFlags;
+
+	FindActiveIslandsLoop(btCollisionObjectArray& collisionObjects, const btUnionFind& unionFind, const btAlignedObjectArray<int>& islandStarts, btAlignedObjectArray<char>& islandFlags)
+		: m_collisionObjects(collisionObjects), m_unionFind(unionFind), m_islandStarts(islandStarts), m_islandFlags(islandFlags)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int iIsland = iBegin; iIsland < iEnd; ++iIsland)
+		{
+			bool islandSleeping = true;
+			for (int iElem = m_islandStarts[iIsland]; iElem < m_islandStarts[iIsland + 1]; iElem++)
+			{
+				if (m_collisionObjects[m_unionFind.getElement(iElem).m_sz]->isActive())
+				{
+					islandSleeping = false;
+					break;
+				}
+			}
+			m_islandFlags[iIsland] = !islandSleeping;
+		}
+	}
+};
+
+struct CopyIslandBodiesLoop : public btIParallelForBody
+{
+	btCollisionObjectArray& m_collisionObjects;
+	const btUnionFind& m_unionFind;
+	const btAlignedObjectArray<int>& m_islandStarts;
+	const btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& m_islandTargets;
+	const btAlignedObjectArray<int>& m_islandTargetOffsets;
+
+	CopyIslandBodiesLoop(btCollisionObjectArray& collisionObjects, const btUnionFind& unionFind, const btAlignedObjectArray<int>& islandStarts, const btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& islandTargets, const btAlignedObjectArray<int>& islandTargetOffsets)
+		: m_collisionObjects(collisionObjects), m_unionFind(unionFind), m_islandStarts(islandStarts), m_islandTargets(islandTargets), m_islandTargetOffsets(islandTargetOffsets)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int iIsland = iBegin; iIsland < iEnd; ++iIsland)
+		{
+			if (btSimulationIslandManagerMt::Island* island = m_islandTargets[iIsland])
+			{
+				int iDest = m_islandTargetOffsets[iIsland];
+				for (int iElem = m_islandStarts[iIsland]; iElem < m_islandStarts[iIsland + 1]; iElem++)
+				{
+					island->bodyArray[iDest++] = m_collisionObjects[m_unionFind.getElement(iElem).m_sz];
+				}
+			}
+		}
+	}
+};
+
+void btSimulationIslandManagerMt::addBodiesToIslandsParallel(btCollisionWorld* collisionWorld)
+{
+	btCollisionObjectArray& collisionObjects = collisionWorld->getCollisionObjectArray();
+	const btUnionFind& unionFind = getUnionFind();
+	int numIslands = m_islandStarts.size() - 1;
+	{
+		FindActiveIslandsLoop loop(collisionObjects, unionFind, m_islandStarts, m_islandFlags);
+		int grainSize = 16;
+		btParallelFor(0, numIslands, grainSize, loop);
+	}
+	// allocate the islands in the order of their ids, and make room for their bodies
+	m_islandTargets.resizeNoInitialize(numIslands);
+	m_islandTargetOffsets.resizeNoInitialize(numIslands);
+	m_activeIslandFromId.resizeNoInitialize(unionFind.getNumElements());
+	for (int iIsland = 0; iIsland < numIslands; ++iIsland)
+	{
+		int startIslandIndex = m_islandStarts[iIsland];
+		int islandId = unionFind.getElement(startIslandIndex).m_id;
+		if (!m_islandFlags[iIsland])
+		{
+			m_islandTargets[iIsland] = NULL;
+			m_activeIslandFromId[islandId] = -1;
+			continue;
+		}
+		int numBodies = m_islandStarts[iIsland + 1] - startIslandIndex;
+		Island* island = allocateIsland(islandId, numBodies);
+		island->isSleeping = false;
+		// a new island or the current batch island
+		int iActive = m_activeIslands.size() - 1;
+		while (m_activeIslands[iActive] != island)
+		{
+			iActive--;
+		}
+		m_islandTargets[iIsland] = island;
+		m_islandTargetOffsets[iIsland] = island->bodyArray.size();
+		island->bodyArray.resizeNoInitialize(island->bodyArray.size() + numBodies);
+		m_activeIslandFromId[islandId] = iActive;
+	}
+	{
+		CopyIslandBodiesLoop loop(collisionObjects, unionFind, m_islandStarts, m_islandTargets, m_islandTargetOffsets);
+		int grainSize = 16;
+		btParallelFor(0, numIslands, grainSize, loop);
+	}
+}
+
+struct ClassifyManifoldsLoop : public btIParallelForBody
+{
+	btDispatcher* m_dispatcher;
+	const btAlignedObjectArray<int>& m_activeIslandFromId;
+	btAlignedObjectArray<int>& m_manifoldIslands;
+	btAlignedObjectArray<char>& m_manifoldWakes;
+	btAlignedObjectArray<int>& m_manifoldCursors;
+	int volatile* m_numWakes;
+
+	ClassifyManifoldsLoop(btDispatcher* dispatcher, const btAlignedObjectArray<int>& activeIslandFromId, btAlignedObjectArray<int>& manifoldIslands, btAlignedObjectArray<char>& manifoldWakes, btAlignedObjectArray<int>& manifoldCursors, int volatile* numWakes)
+		: m_dispatcher(dispatcher), m_activeIslandFromId(activeIslandFromId), m_manifoldIslands(manifoldIslands), m_manifoldWakes(manifoldWakes), m_manifoldCursors(manifoldCursors), m_numWakes(numWakes)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			btPersistentManifold* manifold = m_dispatcher->getManifoldByIndexInternal(i);
+
+			const btCollisionObject* colObj0 = static_cast<const btCollisionObject*>(manifold->getBody0());
+			const btCollisionObject* colObj1 = static_cast<const btCollisionObject*>(manifold->getBody1());
+
+			int iActive = -1;
+			char wakes = 0;
+			if (((colObj0) && colObj0->getActivationState() != ISLAND_SLEEPING) ||
+				((colObj1) && colObj1->getActivationState() != ISLAND_SLEEPING))
+			{
+				// the bodies are activated after the loop, other manifolds may still read their activation state
+				if (colObj0->isKinematicObject() && colObj0->getActivationState() != ISLAND_SLEEPING)
+				{
+					if (colObj0->hasContactResponse())
+						wakes |= 2;
+				}
+				if (colObj1->isKinematicObject() && colObj1->getActivationState() != ISLAND_SLEEPING)
+				{
+					if (colObj1->hasContactResponse())
+						wakes |= 1;
+				}
+				if (m_dispatcher->needsResponse(colObj0, colObj1))
+				{
+					// sleeping islands kept by the incremental mode have ids beyond the union find
+					int islandId = getIslandId(manifold);
+					if (islandId >= 0 && islandId < m_activeIslandFromId.size())
+					{
+						iActive = m_activeIslandFromId[islandId];
+					}
+				}
+			}
+			m_manifoldIslands[i] = iActive;
+			m_manifoldWakes[i] = wakes;
+			if (iActive >= 0)
+			{
+				btAtomicFetchAdd(&m_manifoldCursors[iActive], 1);
+			}
+			if (wakes)
+			{
+				btAtomicFetchAdd(m_numWakes, 1);
+			}
+		}
+	}
+};
+
+struct GatherIslandManifoldsLoop : public btIParallelForBody
+{
+	const btAlignedObjectArray<int>& m_manifoldIslands;
+	btAlignedObjectArray<int>& m_manifoldCursors;
+	btAlignedObjectArray<int>& m_sortedManifolds;
+
+	GatherIslandManifoldsLoop(const btAlignedObjectArray<int>& manifoldIslands, btAlignedObjectArray<int>& manifoldCursors, btAlignedObjectArray<int>& sortedManifolds)
+		: m_manifoldIslands(manifoldIslands), m_manifoldCursors(manifoldCursors), m_sortedManifolds(sortedManifolds)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			int iActive = m_manifoldIslands[i];
+			if (iActive >= 0)
+			{
+				int iDest = btAtomicFetchAdd(&m_manifoldCursors[iActive], 1);
+				m_sortedManifolds[iDest] = i;
+			}
+		}
+	}
+};
+
+struct CopyIslandManifoldsLoop : public btIParallelForBody
+{
+	btDispatcher* m_dispatcher;
+	btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& m_activeIslands;
+	const btAlignedObjectArray<int>& m_manifoldCursors;
+	btAlignedObjectArray<int>& m_sortedManifolds;
+
+	CopyIslandManifoldsLoop(btDispatcher* dispatcher, btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& activeIslands, const btAlignedObjectArray<int>& manifoldCursors, btAlignedObjectArray<int>& sortedManifolds)
+		: m_dispatcher(dispatcher), m_activeIslands(activeIslands), m_manifoldCursors(manifoldCursors), m_sortedManifolds(sortedManifolds)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int iActive = iBegin; iActive < iEnd; ++iActive)
+		{
+			// after the gathering, the cursor of an island is where the manifolds of the next one start
+			int iManifoldBegin = iActive > 0 ? m_manifoldCursors[iActive - 1] : 0;
+			int iManifoldEnd = m_manifoldCursors[iActive];
+			if (iManifoldEnd - iManifoldBegin > 1)
+			{
+				m_sortedManifolds.quickSortInternal(btAlignedObjectArray<int>::less(), iManifoldBegin, iManifoldEnd - 1);
+			}
+			btSimulationIslandManagerMt::Island* island = m_activeIslands[iActive];
+			for (int i = iManifoldBegin; i < iManifoldEnd; ++i)
+			{
+				island->manifoldArray[i - iManifoldBegin] = m_dispatcher->getManifoldByIndexInternal(m_sortedManifolds[i]);
+			}
+		}
+	}
+};
+
+void btSimulationIslandManagerMt::addManifoldsToIslandsParallel(btDispatcher* dispatcher)
+{
+	int maxNumManifolds = dispatcher->getNumManifolds();
+	int numActiveIslands = m_activeIslands.size();
+	m_manifoldIslands.resizeNoInitialize(maxNumManifolds);
+	m_manifoldWakes.resizeNoInitialize(maxNumManifolds);
+	m_manifoldCursors.resize(0);
+	m_manifoldCursors.resize(numActiveIslands, 0);
+	int numWakes = 0;
+	{
+		ClassifyManifoldsLoop loop(dispatcher, m_activeIslandFromId, m_manifoldIslands, m_manifoldWakes, m_manifoldCursors, &numWakes);
+		int grainSize = 250;
+		btParallelFor(0, maxNumManifolds, grainSize, loop);
+	}
+	//kinematic objects don't merge islands, but wake up all connected objects
+	if (numWakes)
+	{
+		for (int i = 0; i < maxNumManifolds; i++)
+		{
+			if (char wakes = m_manifoldWakes[i])
+			{
+				btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(i);
+				if (wakes & 1)
+				{
+					manifold->getBody0()->activate();
+				}
+				if (wakes & 2)
+				{
+					manifold->getBody1()->activate();
+				}
+			}
+		}
+	}
+	// gather the manifolds of each island, and keep them in the order of the dispatcher
+	int numManifolds = 0;
+	for (int iActive = 0; iActive < numActiveIslands; ++iActive)
+	{
+		int count = m_manifoldCursors[iActive];
+		m_activeIslands[iActive]->manifoldArray.resizeNoInitialize(count);
+		m_manifoldCursors[iActive] = numManifolds;
+		numManifolds += count;
+	}
+	m_sortedManifolds.resizeNoInitialize(numManifolds);
+	{
+		GatherIslandManifoldsLoop loop(m_manifoldIslands, m_manifoldCursors, m_sortedManifolds);
+		int grainSize = 250;
+		btParallelFor(0, maxNumManifolds, grainSize, loop);
+	}
+	{
+		CopyIslandManifoldsLoop loop(dispatcher, m_activeIslands, m_manifoldCursors, m_sortedManifolds);
+		int grainSize = 16;
+		btParallelFor(0, numActiveIslands, grainSize, loop);
+	}
+}
+
+struct MergeIslandsLoop : public btIParallelForBody
+{
+	btSimulationIslandManagerMt::Island** m_destIslands;
+	const btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& m_mergeSources;
+	const btAlignedObjectArray<int>& m_mergeSourceStarts;
+
+	MergeIslandsLoop(btSimulationIslandManagerMt::Island** destIslands, const btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& mergeSources, const btAlignedObjectArray<int>& mergeSourceStarts)
+		: m_destIslands(destIslands), m_mergeSources(mergeSources), m_mergeSourceStarts(mergeSourceStarts)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btSimulationIslandManagerMt::Island* island = m_destIslands[i];
+			for (int iSrc = m_mergeSourceStarts[i]; iSrc < m_mergeSourceStarts[i + 1]; ++iSrc)
+			{
+				island->append(*m_mergeSources[iSrc]);
+			}
+		}
+	}
+};
+
+void btSimulationIslandManagerMt::mergeIslandsParallel()
+{
+	// sort islands in order of decreasing batch size
+	m_activeIslands.quickSort(IslandBatchSizeSortPredicate());
+
+	// plan the same merges as mergeIslands, the islands merged into different islands are disjoint
+	int destIslandIndex = m_activeIslands.size();
+	for (int i = 0; i < m_activeIslands.size(); ++i)
+	{
+		if (calcBatchCost(m_activeIslands[i]) < m_minimumSolverBatchSize)
+		{
+			destIslandIndex = i;
+			break;
+		}
+	}
+	int firstDestIslandIndex = destIslandIndex;
+	m_mergeSources.resize(0);
+	m_mergeSourceStarts.resize(0);
+	int lastIndex = m_activeIslands.size() - 1;
+	while (destIslandIndex < lastIndex)
+	{
+		Island* island = m_activeIslands[destIslandIndex];
+		int numBodies = island->bodyArray.size();
+		int numManifolds = island->manifoldArray.size();
+		int numConstraints = island->constraintArray.size();
+		int firstIndex = lastIndex;
+		while (true)
+		{
+			Island* src = m_activeIslands[firstIndex];
+			numBodies += src->bodyArray.size();
+			numManifolds += src->manifoldArray.size();
+			numConstraints += src->constraintArray.size();
+			int batchCost = calcBatchCost(numBodies, numManifolds, numConstraints);
+			if (batchCost >= m_minimumSolverBatchSize)
+			{
+				break;
+			}
+			if (firstIndex - 1 == destIslandIndex)
+			{
+				break;
+			}
+			firstIndex--;
+		}
+		// reserve space here, so the islands can be merged in parallel without allocations
+		island->bodyArray.reserve(numBodies);
+		island->manifoldArray.reserve(numManifolds);
+		island->constraintArray.reserve(numConstraints);
+		m_mergeSourceStarts.push_back(m_mergeSources.size());
+		for (int i = firstIndex; i <= lastIndex; ++i)
+		{
+			m_mergeSources.push_back(m_activeIslands[i]);
+		}
+		m_activeIslands.resize(firstIndex);
+		lastIndex = firstIndex - 1;
+		destIslandIndex++;
+	}
+	int numMerges = m_mergeSourceStarts.size();
+	if (numMerges)
+	{
+		m_mergeSourceStarts.push_back(m_mergeSources.size());
+		MergeIslandsLoop loop(&m_activeIslands[firstDestIslandIndex], m_mergeSources, m_mergeSourceStarts);
+		int grainSize = 1;
+		btParallelFor(0, numMerges, grainSize, loop);
+	}
+}
+
 void btSimulationIslandManagerMt::solveIsland(btConstraintSolver* solver, Island& island, const SolverParams& solverParams)
 {
 	btPersistentManifold** manifolds = island.manifoldArray.size() ? &island.manifoldArray[0] : NULL;
@@ -538,6 +1442,16 @@ void btSimulationIslandManagerMt::solveIsland(btConstraintSolver* solver, Island
 					   *solverParams.m_solverInfo,
 					   solverParams.m_debugDrawer,
 					   solverParams.m_dispatcher);
+	if (solverParams.m_solverInfo->m_reportSolverAnalytics & 1)
+	{
+		// btConstraintSolverPoolMt returns the analytics of the call this thread just made
+		const btSolverAnalyticsData* analyticsData = solver->getSolverAnalyticsData();
+		if (analyticsData)
+		{
+			island.analyticsData = *analyticsData;
+			island.analyticsData.m_islandId = island.id;
+		}
+	}
 }
 
 void btSimulationIslandManagerMt::serialIslandDispatch(btAlignedObjectArray<Island*>* islandsPtr, const SolverParams& solverParams)
@@ -629,6 +1543,9 @@ void btSimulationIslandManagerMt::buildAndProcessIslands(btDispatcher* dispatche
 {
 	BT_PROFILE("buildAndProcessIslands");
 	btCollisionObjectArray& collisionObjects = collisionWorld->getCollisionObjectArray();
+	// the island dispatch can be replaced by one that records the islands without solving them
+	bool reportAnalytics = solverParams.m_solverInfo && (solverParams.m_solverInfo->m_reportSolverAnalytics & 1) != 0;
+	m_islandAnalyticsData.resize(0);
 
 	buildIslands(dispatcher, collisionWorld);
 
@@ -672,6 +1589,12 @@ void btSimulationIslandManagerMt::buildAndProcessIslands(btDispatcher* dispatche
 						   *solverParams.m_solverInfo,
 						   solverParams.m_debugDrawer,
 						   solverParams.m_dispatcher);
+		const btSolverAnalyticsData* analyticsData = reportAnalytics ? solver->getSolverAnalyticsData() : 0;
+		if (analyticsData)
+		{
+			m_islandAnalyticsData.push_back(*analyticsData);
+			m_islandAnalyticsData[0].m_islandId = -1;
+		}
 	}
 	else
 	{
@@ -690,7 +1613,21 @@ void btSimulationIslandManagerMt::buildAndProcessIslands(btDispatcher* dispatche
 		{
 			mergeIslands();
 		}
+		if (reportAnalytics)
+		{
+			for (int i = 0; i < m_activeIslands.size(); ++i)
+			{
+				m_activeIslands[i]->analyticsData = btSolverAnalyticsData();
+			}
+		}
 		// dispatch islands to solver
 		m_islandDispatch(&m_activeIslands, solverParams);
+		if (reportAnalytics)
+		{
+			for (int i = 0; i < m_activeIslands.size(); ++i)
+			{
+				m_islandAnalyticsData.push_back(m_activeIslands[i]->analyticsData);
+			}
+		}
 	}
 }
@@ -17,6 +17,7 @@ subject to the following restrictions:
 #define BT_SIMULATION_ISLAND_MANAGER_MT_H
 
 #include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"  // for btSolverAnalyticsData
 
 class btTypedConstraint;
 class btConstraintSolver;
@@ -32,6 +33,13 @@ class btIDebugDraw;
 ///                       of islands. If only a single island exists, then no parallelism is
 ///                       possible.
 ///
+///                       With setParallelIslandBuilding(true) the island building is multithreaded as well. The unions
+///                       of the overlapping pairs are done in parallel with btUnionFind::uniteConcurrent, and the id of
+///                       each island is its smallest union find element. The elements are gathered into islands by a
+///                       counting sort with prefix sums, and the bodies of each island are kept in the order of the
+///                       collision object array, so the islands do not depend on the number of threads. The serial
+///                       island building leaves the bodies of an island in the order of its quick sort instead.
+///
 class btSimulationIslandManagerMt : public btSimulationIslandManager
 {
 public:
@@ -44,6 +52,7 @@ public:
 		btAlignedObjectArray<btTypedConstraint*> constraintArray;
 		int id;  // island id
 		bool isSleeping;
+		btSolverAnalyticsData analyticsData;  // of the solver call of the island, if m_reportSolverAnalytics & 1
 
 		void append(const Island& other);  // add bodies, manifolds, constraints to my own
 	};
@@ -70,6 +79,26 @@ protected:
 	int m_minimumSolverBatchSize;
 	int m_batchIslandMinBodyCount;
 	IslandDispatchFunc m_islandDispatch;
+	btAlignedObjectArray<btSolverAnalyticsData> m_islandAnalyticsData;
+
+	bool m_parallelIslandBuilding;
+	btAlignedObjectArray<int> m_blockOffsets;           // prefix sums over fixed blocks of objects or union find elements
+	btAlignedObjectArray<int> m_blockIslandOffsets;     // prefix sums of the islands over fixed blocks of island ids
+	btAlignedObjectArray<int> m_elementRoots;           // per union find element
+	btAlignedObjectArray<int> m_islandLabels;           // per union find element, the smallest element of its set
+	btAlignedObjectArray<btElement> m_sortedElements;   // union find elements gathered by island
+	btAlignedObjectArray<int> m_islandCursors;          // per island id, where its next element goes
+	btAlignedObjectArray<int> m_islandStarts;           // first sorted element of each island, and the number of elements at the end
+	btAlignedObjectArray<char> m_islandFlags;           // per island, whether it is sleeping or active
+	btAlignedObjectArray<Island*> m_islandTargets;      // per island, the Island its bodies go to
+	btAlignedObjectArray<int> m_islandTargetOffsets;    // per island, where its bodies go in the Island
+	btAlignedObjectArray<int> m_activeIslandFromId;     // index in m_activeIslands per island id
+	btAlignedObjectArray<int> m_manifoldIslands;        // index in m_activeIslands per manifold, -1 if it is not solved
+	btAlignedObjectArray<char> m_manifoldWakes;         // per manifold, the bodies to activate for a kinematic object
+	btAlignedObjectArray<int> m_manifoldCursors;        // per active island, where its next manifold goes
+	btAlignedObjectArray<int> m_sortedManifolds;        // manifold indices gathered by active island
+	btAlignedObjectArray<Island*> m_mergeSources;       // islands merged into others by mergeIslands
+	btAlignedObjectArray<int> m_mergeSourceStarts;      // per island that others are merged into, the first of its merge sources
 
 	Island* getIsland(int id);
 	virtual Island* allocateIsland(int id, int numBodies);
@@ -79,6 +108,11 @@ protected:
 	virtual void addConstraintsToIslands(btAlignedObjectArray<btTypedConstraint*>& constraints);
 	virtual void mergeIslands();
 
+	void buildIslandsParallel(btCollisionWorld* collisionWorld);
+	void addBodiesToIslandsParallel(btCollisionWorld* collisionWorld);
+	void addManifoldsToIslandsParallel(btDispatcher* dispatcher);
+	void mergeIslandsParallel();
+
 public:
 	btSimulationIslandManagerMt();
 	virtual ~btSimulationIslandManagerMt();
@@ -90,6 +124,10 @@ public:
 
 	virtual void buildIslands(btDispatcher* dispatcher, btCollisionWorld* colWorld);
 
+	virtual void updateActivationState(btCollisionWorld* colWorld, btDispatcher* dispatcher);
+	virtual void storeIslandActivationState(btCollisionWorld* colWorld);
+	virtual void findUnions(btDispatcher* dispatcher, btCollisionWorld* colWorld);
+
 	int getMinimumSolverBatchSize() const
 	{
 		return m_minimumSolverBatchSize;
@@ -107,6 +145,21 @@ public:
 	{
 		m_islandDispatch = func;
 	}
+	bool getParallelIslandBuilding() const
+	{
+		return m_parallelIslandBuilding;
+	}
+	// build the islands with btParallelFor, see above
+	void setParallelIslandBuilding(bool parallelIslandBuilding)
+	{
+		m_parallelIslandBuilding = parallelIslandBuilding;
+	}
+	// the analytics of every island solved by the last buildAndProcessIslands, if m_reportSolverAnalytics & 1.
+	// A batch of small islands has the id of its first island
+	const btAlignedObjectArray<btSolverAnalyticsData>& getIslandAnalyticsData() const
+	{
+		return m_islandAnalyticsData;
+	}
 };
 
 #endif  //BT_SIMULATION_ISLAND_MANAGER_H
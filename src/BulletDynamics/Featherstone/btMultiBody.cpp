@@ -357,6 +357,10 @@ void btMultiBody::finalizeMultiDof()
 	{
 		m_vectorBuf[i].setValue(0, 0, 0);
 	}
+	//workspace of computeAccelerationsArticulatedBodyAlgorithmMultiDof, sized once here so that the per-step call does not resize it
+	m_abaVectorBuf.resize(8 * m_links.size() + 6);
+	m_abaMatrixBuf.resize(4 * m_links.size() + 4);
+	m_abaKinematicChain.resize(m_links.size());
 	updateLinksDofOffsets();
 }
 
@@ -760,16 +764,17 @@ void btMultiBody::computeAccelerationsArticulatedBodyAlgorithmMultiDof(btScalar
 	const btVector3 base_vel = getBaseVel();
 	const btVector3 base_omega = getBaseOmega();
 
-	// Temporary matrices/vectors -- use scratch space from caller
-	// so that we don't have to keep reallocating every frame
+	// Y and the output accelerations use scratch space from the caller, who reads the output back.
+	// The per-link temporaries live in the persistent workspace sized by finalizeMultiDof,
+	// so that we don't have to keep resizing every frame
 
 	scratch_r.resize(2 * m_dofCount + 7);  //multidof? ("Y"s use it and it is used to store qdd) => 2 x m_dofCount
-	scratch_v.resize(8 * num_links + 6);
-	scratch_m.resize(4 * num_links + 4);
+	btAssert(m_abaVectorBuf.size() == 8 * num_links + 6);
+	btAssert(m_abaMatrixBuf.size() == 4 * num_links + 4);
 
 	//btScalar * r_ptr = &scratch_r[0];
 	btScalar *output = &scratch_r[m_dofCount];  // "output" holds the q_double_dot results
-	btVector3 *v_ptr = &scratch_v[0];
+	btVector3 *v_ptr = &m_abaVectorBuf[0];
 
 	// vhat_i  (top = angular, bottom = linear part)
 	btSpatialMotionVector *spatVel = (btSpatialMotionVector *)v_ptr;
@@ -784,11 +789,14 @@ void btMultiBody::computeAccelerationsArticulatedBodyAlgorithmMultiDof(btScalar
 	v_ptr += num_links * 2;
 	//
 	// Ihat_i^A.
-	btSymmetricSpatialDyad *spatInertia = (btSymmetricSpatialDyad *)&scratch_m[num_links + 1];
+	btSymmetricSpatialDyad *spatInertia = (btSymmetricSpatialDyad *)&m_abaMatrixBuf[num_links + 1];
 
 	// Cached 3x3 rotation matrices from parent frame to this frame.
 	btMatrix3x3 *rot_from_parent = &m_matrixBuf[0];
-	btMatrix3x3 *rot_from_world = &scratch_m[0];
+	btMatrix3x3 *rot_from_world = &m_abaMatrixBuf[0];
+
+	// isLinkAndAllAncestorsKinematic per link; parents precede their children, so it is filled in the first loop
+	bool *kinematicChain = num_links > 0 ? &m_abaKinematicChain[0] : 0;
 
 	// hhat_i, ahat_i
 	// hhat is NOT stored for the base (but ahat is)
@@ -869,6 +877,7 @@ void btMultiBody::computeAccelerationsArticulatedBodyAlgorithmMultiDof(btScalar
 		const int parent = m_links[i].m_parent;
 		rot_from_parent[i + 1] = btMatrix3x3(m_links[i].m_cachedRotParentToThis);
 		rot_from_world[i + 1] = rot_from_parent[i + 1] * rot_from_world[parent + 1];
+		kinematicChain[i] = isLinkKinematic(i) && (parent < 0 ? isBaseKinematic() : kinematicChain[parent]);
 
 		fromParent.m_rotMat = rot_from_parent[i + 1];
 		fromParent.m_trnVec = m_links[i].m_cachedRVector;
@@ -902,9 +911,9 @@ void btMultiBody::computeAccelerationsArticulatedBodyAlgorithmMultiDof(btScalar
 
 		// calculate zhat_i^A
 		//
-		if (isLinkAndAllAncestorsKinematic(i))
+		if (kinematicChain[i])
 		{
-			zeroAccSpatFrc[i].setZero();
+			zeroAccSpatFrc[i + 1].setZero();
 		}
 		else{
 			//external forces
@@ -971,78 +980,93 @@ void btMultiBody::computeAccelerationsArticulatedBodyAlgorithmMultiDof(btScalar
 	// (part of TreeForwardDynamics in Mirtich.)
 	for (int i = num_links - 1; i >= 0; --i)
 	{
-		if(isLinkAndAllAncestorsKinematic(i))
+		if (kinematicChain[i])
 			continue;
 		const int parent = m_links[i].m_parent;
 		fromParent.m_rotMat = rot_from_parent[i + 1];
 		fromParent.m_trnVec = m_links[i].m_cachedRVector;
 
-		for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
+		btScalar *invDi = &invD[m_links[i].m_dofOffset * m_links[i].m_dofOffset];
+		if (m_links[i].m_dofCount == 1)
 		{
-			btSpatialForceVector &hDof = h[m_links[i].m_dofOffset + dof];
-			//
-			hDof = spatInertia[i + 1] * m_links[i].m_axes[dof];
-			//
-			Y[m_links[i].m_dofOffset + dof] = m_links[i].m_jointTorque[dof] - m_links[i].m_axes[dof].dot(zeroAccSpatFrc[i + 1]) - spatCoriolisAcc[i].dot(hDof);
+			//revolute and prismatic joints: D, D^{-1} and Y are scalars
+			const btSpatialMotionVector &axis = m_links[i].m_axes[0];
+			btSpatialForceVector &hDof = h[m_links[i].m_dofOffset];
+			hDof = spatInertia[i + 1] * axis;
+			Y[m_links[i].m_dofOffset] = m_links[i].m_jointTorque[0] - axis.dot(zeroAccSpatFrc[i + 1]) - spatCoriolisAcc[i].dot(hDof);
+
+			const btScalar D0 = axis.dot(hDof);
+			invDi[0] = D0 >= SIMD_EPSILON ? btScalar(1.0f) / D0 : btScalar(0);
+			spatForceVecTemps[0] = hDof * invDi[0];
 		}
-		for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
+		else
 		{
-			btScalar *D_row = &D[dof * m_links[i].m_dofCount];
-			for (int dof2 = 0; dof2 < m_links[i].m_dofCount; ++dof2)
+			for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
 			{
-				const btSpatialForceVector &hDof2 = h[m_links[i].m_dofOffset + dof2];
-				D_row[dof2] = m_links[i].m_axes[dof].dot(hDof2);
+				btSpatialForceVector &hDof = h[m_links[i].m_dofOffset + dof];
+				//
+				hDof = spatInertia[i + 1] * m_links[i].m_axes[dof];
+				//
+				Y[m_links[i].m_dofOffset + dof] = m_links[i].m_jointTorque[dof] - m_links[i].m_axes[dof].dot(zeroAccSpatFrc[i + 1]) - spatCoriolisAcc[i].dot(hDof);
 			}
-		}
-
-		btScalar *invDi = &invD[m_links[i].m_dofOffset * m_links[i].m_dofOffset];
-		switch (m_links[i].m_jointType)
-		{
-			case btMultibodyLink::ePrismatic:
-			case btMultibodyLink::eRevolute:
+			for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
 			{
-				if (D[0] >= SIMD_EPSILON)
-				{
-					invDi[0] = 1.0f / D[0];
-				}
-				else
+				btScalar *D_row = &D[dof * m_links[i].m_dofCount];
+				for (int dof2 = 0; dof2 < m_links[i].m_dofCount; ++dof2)
 				{
-					invDi[0] = 0;
+					const btSpatialForceVector &hDof2 = h[m_links[i].m_dofOffset + dof2];
+					D_row[dof2] = m_links[i].m_axes[dof].dot(hDof2);
 				}
-				break;
 			}
-			case btMultibodyLink::eSpherical:
-			case btMultibodyLink::ePlanar:
-			{
-				const btMatrix3x3 D3x3(D[0], D[1], D[2], D[3], D[4], D[5], D[6], D[7], D[8]);
-				const btMatrix3x3 invD3x3(D3x3.inverse());
 
-				//unroll the loop?
-				for (int row = 0; row < 3; ++row)
+			switch (m_links[i].m_jointType)
+			{
+				case btMultibodyLink::ePrismatic:
+				case btMultibodyLink::eRevolute:
 				{
-					for (int col = 0; col < 3; ++col)
+					if (D[0] >= SIMD_EPSILON)
 					{
-						invDi[row * 3 + col] = invD3x3[row][col];
+						invDi[0] = 1.0f / D[0];
 					}
+					else
+					{
+						invDi[0] = 0;
+					}
+					break;
 				}
+				case btMultibodyLink::eSpherical:
+				case btMultibodyLink::ePlanar:
+				{
+					const btMatrix3x3 D3x3(D[0], D[1], D[2], D[3], D[4], D[5], D[6], D[7], D[8]);
+					const btMatrix3x3 invD3x3(D3x3.inverse());
 
-				break;
-			}
-			default:
-			{
-			}
-		}
+					//unroll the loop?
+					for (int row = 0; row < 3; ++row)
+					{
+						for (int col = 0; col < 3; ++col)
+						{
+							invDi[row * 3 + col] = invD3x3[row][col];
+						}
+					}
 
-		//determine h*D^{-1}
-		for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
-		{
-			spatForceVecTemps[dof].setZero();
+					break;
+				}
+				default:
+				{
+				}
+			}
 
-			for (int dof2 = 0; dof2 < m_links[i].m_dofCount; ++dof2)
+			//determine h*D^{-1}
+			for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
 			{
-				const btSpatialForceVector &hDof2 = h[m_links[i].m_dofOffset + dof2];
-				//
-				spatForceVecTemps[dof] += hDof2 * invDi[dof2 * m_links[i].m_dofCount + dof];
+				spatForceVecTemps[dof].setZero();
+
+				for (int dof2 = 0; dof2 < m_links[i].m_dofCount; ++dof2)
+				{
+					const btSpatialForceVector &hDof2 = h[m_links[i].m_dofOffset + dof2];
+					//
+					spatForceVecTemps[dof] += hDof2 * invDi[dof2 * m_links[i].m_dofCount + dof];
+				}
 			}
 		}
 
@@ -1119,7 +1143,16 @@ void btMultiBody::computeAccelerationsArticulatedBodyAlgorithmMultiDof(btScalar
 
 		fromParent.transform(spatAcc[parent + 1], spatAcc[i + 1]);
 
-		if(!isLinkAndAllAncestorsKinematic(i))
+		if (!kinematicChain[i] && m_links[i].m_dofCount == 1)
+		{
+			const int dofOffset = m_links[i].m_dofOffset;
+			//D^{-1} * (Y - h^{T}*apar)
+			joint_accel[dofOffset] = invD[dofOffset * dofOffset] * (Y[dofOffset] - spatAcc[i + 1].dot(h[dofOffset]));
+
+			spatAcc[i + 1] += spatCoriolisAcc[i];
+			spatAcc[i + 1] += m_links[i].m_axes[0] * joint_accel[dofOffset];
+		}
+		else if (!kinematicChain[i])
 		{
 			for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
 			{
@@ -1141,8 +1174,9 @@ void btMultiBody::computeAccelerationsArticulatedBodyAlgorithmMultiDof(btScalar
 		{
 			m_internalNeedsJointFeedback = true;
 
-			btVector3 angularBotVec = (spatInertia[i + 1] * spatAcc[i + 1] + zeroAccSpatFrc[i + 1]).m_bottomVec;
-			btVector3 linearTopVec = (spatInertia[i + 1] * spatAcc[i + 1] + zeroAccSpatFrc[i + 1]).m_topVec;
+			const btSpatialForceVector reactionForce = spatInertia[i + 1] * spatAcc[i + 1] + zeroAccSpatFrc[i + 1];
+			btVector3 angularBotVec = reactionForce.m_bottomVec;
+			btVector3 linearTopVec = reactionForce.m_topVec;
 
 			if (jointFeedbackInJointFrame)
 			{
@@ -1458,6 +1492,9 @@ void btMultiBody::calcAccelerationDeltasMultiDof(const btScalar *force, btScalar
 	// Y_i (scratch), invD_i (cached)
 	const btScalar *invD = m_dofCount > 0 ? &m_realBuf[6 + m_dofCount] : 0;
 	btScalar *Y = r_ptr;
+
+	// links of a kinematic chain (cached from calcAccelerations)
+	const bool *kinematicChain = num_links > 0 ? &m_abaKinematicChain[0] : 0;
 	////////////////
 	//aux variables
 	btScalar invD_times_Y[6];                   //D^{-1} * Y [dofxdof x dofx1 = dofx1] <=> D^{-1} * u; better moved to buffers since it is recalced in calcAccelerationDeltasMultiDof; num_dof of btScalar would cover all bodies
@@ -1491,38 +1528,53 @@ void btMultiBody::calcAccelerationDeltasMultiDof(const btScalar *force, btScalar
 	// (part of TreeForwardDynamics in Mirtich.)
 	for (int i = num_links - 1; i >= 0; --i)
 	{
-		if(isLinkAndAllAncestorsKinematic(i))
+		if (kinematicChain[i])
 			continue;
 		const int parent = m_links[i].m_parent;
-		fromParent.m_rotMat = rot_from_parent[i + 1];
-		fromParent.m_trnVec = m_links[i].m_cachedRVector;
+		const int dofOffset = m_links[i].m_dofOffset;
 
+		bool hasForce = !zeroAccSpatFrc[i + 1].m_topVec.isZero() || !zeroAccSpatFrc[i + 1].m_bottomVec.isZero();
 		for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
 		{
-			Y[m_links[i].m_dofOffset + dof] = force[6 + m_links[i].m_dofOffset + dof] - m_links[i].m_axes[dof].dot(zeroAccSpatFrc[i + 1]);
+			Y[dofOffset + dof] = force[6 + dofOffset + dof] - m_links[i].m_axes[dof].dot(zeroAccSpatFrc[i + 1]);
+			hasForce = hasForce || force[6 + dofOffset + dof] != btScalar(0);
 		}
+		// the force of a contact row only acts on the links between the contact link and the root,
+		// a subtree without any force adds nothing to its parent
+		if (!hasForce)
+			continue;
 
-		btVector3 in_top, in_bottom, out_top, out_bottom;
-		const btScalar *invDi = &invD[m_links[i].m_dofOffset * m_links[i].m_dofOffset];
+		fromParent.m_rotMat = rot_from_parent[i + 1];
+		fromParent.m_trnVec = m_links[i].m_cachedRVector;
 
-		for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
-		{
-			invD_times_Y[dof] = 0.f;
-
-			for (int dof2 = 0; dof2 < m_links[i].m_dofCount; ++dof2)
-			{
-				invD_times_Y[dof] += invDi[dof * m_links[i].m_dofCount + dof2] * Y[m_links[i].m_dofOffset + dof2];
-			}
-		}
+		const btScalar *invDi = &invD[dofOffset * dofOffset];
 
 		// Zp += pXi * (Zi + hi*Yi/Di)
 		spatForceVecTemps[0] = zeroAccSpatFrc[i + 1];
 
-		for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
+		if (m_links[i].m_dofCount == 1)
 		{
-			const btSpatialForceVector &hDof = h[m_links[i].m_dofOffset + dof];
-			//
-			spatForceVecTemps[0] += hDof * invD_times_Y[dof];
+			//revolute and prismatic joints: D^{-1} and Y are scalars
+			spatForceVecTemps[0] += h[dofOffset] * (invDi[0] * Y[dofOffset]);
+		}
+		else
+		{
+			for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
+			{
+				invD_times_Y[dof] = 0.f;
+
+				for (int dof2 = 0; dof2 < m_links[i].m_dofCount; ++dof2)
+				{
+					invD_times_Y[dof] += invDi[dof * m_links[i].m_dofCount + dof2] * Y[dofOffset + dof2];
+				}
+			}
+
+			for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
+			{
+				const btSpatialForceVector &hDof = h[dofOffset + dof];
+				//
+				spatForceVecTemps[0] += hDof * invD_times_Y[dof];
+			}
 		}
 
 		fromParent.transformInverse(spatForceVecTemps[0], spatForceVecTemps[1]);
@@ -1549,26 +1601,34 @@ void btMultiBody::calcAccelerationDeltasMultiDof(const btScalar *force, btScalar
 	// now do the loop over the m_links
 	for (int i = 0; i < num_links; ++i)
 	{
-		if(isLinkAndAllAncestorsKinematic(i))
+		if (kinematicChain[i])
 			continue;
 		const int parent = m_links[i].m_parent;
+		const int dofOffset = m_links[i].m_dofOffset;
 		fromParent.m_rotMat = rot_from_parent[i + 1];
 		fromParent.m_trnVec = m_links[i].m_cachedRVector;
 
 		fromParent.transform(spatAcc[parent + 1], spatAcc[i + 1]);
 
+		const btScalar *invDi = &invD[dofOffset * dofOffset];
+		if (m_links[i].m_dofCount == 1)
+		{
+			joint_accel[dofOffset] = invDi[0] * (Y[dofOffset] - spatAcc[i + 1].dot(h[dofOffset]));
+			spatAcc[i + 1] += m_links[i].m_axes[0] * joint_accel[dofOffset];
+			continue;
+		}
+
 		for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
 		{
-			const btSpatialForceVector &hDof = h[m_links[i].m_dofOffset + dof];
+			const btSpatialForceVector &hDof = h[dofOffset + dof];
 			//
-			Y_minus_hT_a[dof] = Y[m_links[i].m_dofOffset + dof] - spatAcc[i + 1].dot(hDof);
+			Y_minus_hT_a[dof] = Y[dofOffset + dof] - spatAcc[i + 1].dot(hDof);
 		}
 
-		const btScalar *invDi = &invD[m_links[i].m_dofOffset * m_links[i].m_dofOffset];
-		mulMatrix(const_cast<btScalar *>(invDi), Y_minus_hT_a, m_links[i].m_dofCount, m_links[i].m_dofCount, m_links[i].m_dofCount, 1, &joint_accel[m_links[i].m_dofOffset]);
+		mulMatrix(const_cast<btScalar *>(invDi), Y_minus_hT_a, m_links[i].m_dofCount, m_links[i].m_dofCount, m_links[i].m_dofCount, 1, &joint_accel[dofOffset]);
 
 		for (int dof = 0; dof < m_links[i].m_dofCount; ++dof)
-			spatAcc[i + 1] += m_links[i].m_axes[dof] * joint_accel[m_links[i].m_dofOffset + dof];
+			spatAcc[i + 1] += m_links[i].m_axes[dof] * joint_accel[dofOffset + dof];
 	}
 
 	// transform base accelerations back to the world frame.
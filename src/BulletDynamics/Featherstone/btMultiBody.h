@@ -395,6 +395,11 @@ public:
 	// improvement, at least on Windows (where dynamic memory
 	// allocation appears to be fairly slow).
 	//
+	// The articulated body algorithm only uses scratch_r, for the Y
+	// values and the output accelerations at offset getNumDofs().
+	// Its per-link workspace is sized once in finalizeMultiDof and kept
+	// in the multibody, so scratch_v and scratch_m are left untouched.
+	//
 
 	void computeAccelerationsArticulatedBodyAlgorithmMultiDof(btScalar dt,
 															  btAlignedObjectArray<btScalar> & scratch_r,
@@ -796,11 +801,30 @@ private:
 	//  offset         size         array
 	//   0              num_links+1  rot_from_parent
 	//
+	// abaVectorBuf (persistent workspace of the articulated body algorithm):
+	//  offset         size             array
+	//   0              2*num_links+2    spatVel
+	//   2*num_links+2  2*num_links+2    zeroAccSpatFrc
+	//   4*num_links+4  2*num_links      spatCoriolisAcc
+	//   6*num_links+4  2*num_links+2    spatAcc
+	//
+	// abaMatrixBuf:
+	//  offset         size             array
+	//   0              num_links+1      rot_from_world
+	//   num_links+1    3*num_links+3    spatInertia
+	//
+	// abaKinematicChain:
+	//  offset         size             array
+	//   0              num_links        isLinkAndAllAncestorsKinematic, evaluated once per call and reused by calcAccelerationDeltasMultiDof
+	//
     btAlignedObjectArray<btScalar> m_splitV;
 	btAlignedObjectArray<btScalar> m_deltaV;
 	btAlignedObjectArray<btScalar> m_realBuf;
 	btAlignedObjectArray<btVector3> m_vectorBuf;
 	btAlignedObjectArray<btMatrix3x3> m_matrixBuf;
+	btAlignedObjectArray<btVector3> m_abaVectorBuf;
+	btAlignedObjectArray<btMatrix3x3> m_abaMatrixBuf;
+	btAlignedObjectArray<bool> m_abaKinematicChain;
 
 	btMatrix3x3 m_cachedInertiaTopLeft;
 	btMatrix3x3 m_cachedInertiaTopRight;
@@ -25,6 +25,13 @@ subject to the following restrictions:
 #include "BulletDynamics/Featherstone/btMultiBodySolverConstraint.h"
 #include "LinearMath/btScalar.h"
 
+btMultiBodyConstraintSolver::btMultiBodyConstraintSolver()
+	: m_tmpMultiBodyConstraints(0),
+	  m_tmpNumMultiBodyConstraints(0),
+	  m_minContactRowsForLinkResponses(8)
+{
+}
+
 btScalar btMultiBodyConstraintSolver::solveSingleIteration(int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
 {
 	btScalar leastSquaredResidual = btSequentialImpulseConstraintSolver::solveSingleIteration(iteration, bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
@@ -226,6 +233,15 @@ btScalar btMultiBodyConstraintSolver::solveGroupCacheFriendlySetup(btCollisionOb
 	return val;
 }
 
+void btMultiBodyConstraintSolver::setupSolverIslands(const btContactSolverInfo& infoGlobal)
+{
+	// the multibody rows are not split by island, and they can connect the islands of the rigid body rows
+	if (m_multiBodyNonContactConstraints.size() == 0 && m_multiBodyNormalContactConstraints.size() == 0)
+	{
+		btSequentialImpulseConstraintSolver::setupSolverIslands(infoGlobal);
+	}
+}
+
 void btMultiBodyConstraintSolver::applyDeltaVee(btScalar* delta_vee, btScalar impulse, int velocityIndex, int ndof)
 {
 	for (int i = 0; i < ndof; ++i)
@@ -595,9 +611,8 @@ void btMultiBodyConstraintSolver::setupMultiBodyContactConstraint(btMultiBodySol
 		btAssert(m_data.m_jacobians.size() == m_data.m_deltaVelocitiesUnitImpulse.size());
 
 		btScalar* jac1 = &m_data.m_jacobians[solverConstraint.m_jacAindex];
-		multiBodyA->fillContactJacobianMultiDof(solverConstraint.m_linkA, cp.getPositionWorldOnA(), contactNormal, jac1, m_data.scratch_r, m_data.scratch_v, m_data.scratch_m);
 		btScalar* delta = &m_data.m_deltaVelocitiesUnitImpulse[solverConstraint.m_jacAindex];
-		multiBodyA->calcAccelerationDeltasMultiDof(&m_data.m_jacobians[solverConstraint.m_jacAindex], delta, m_data.scratch_r, m_data.scratch_v);
+		fillMultiBodyContactJacobian(multiBodyA, solverConstraint.m_linkA, cp.getPositionWorldOnA(), btVector3(0, 0, 0), contactNormal, jac1, delta);
 
 		btVector3 torqueAxis0 = rel_pos1.cross(contactNormal);
 		solverConstraint.m_relpos1CrossNormal = torqueAxis0;
@@ -638,8 +653,7 @@ void btMultiBodyConstraintSolver::setupMultiBodyContactConstraint(btMultiBodySol
 		m_data.m_deltaVelocitiesUnitImpulse.resize(m_data.m_deltaVelocitiesUnitImpulse.size() + ndofB);
 		btAssert(m_data.m_jacobians.size() == m_data.m_deltaVelocitiesUnitImpulse.size());
 
-		multiBodyB->fillContactJacobianMultiDof(solverConstraint.m_linkB, cp.getPositionWorldOnB(), -contactNormal, &m_data.m_jacobians[solverConstraint.m_jacBindex], m_data.scratch_r, m_data.scratch_v, m_data.scratch_m);
-		multiBodyB->calcAccelerationDeltasMultiDof(&m_data.m_jacobians[solverConstraint.m_jacBindex], &m_data.m_deltaVelocitiesUnitImpulse[solverConstraint.m_jacBindex], m_data.scratch_r, m_data.scratch_v);
+		fillMultiBodyContactJacobian(multiBodyB, solverConstraint.m_linkB, cp.getPositionWorldOnB(), btVector3(0, 0, 0), -contactNormal, &m_data.m_jacobians[solverConstraint.m_jacBindex], &m_data.m_deltaVelocitiesUnitImpulse[solverConstraint.m_jacBindex]);
 
 		btVector3 torqueAxis1 = rel_pos2.cross(contactNormal);
 		solverConstraint.m_relpos2CrossNormal = -torqueAxis1;
@@ -949,9 +963,8 @@ void btMultiBodyConstraintSolver::setupMultiBodyTorsionalFrictionConstraint(btMu
 		btAssert(m_data.m_jacobians.size() == m_data.m_deltaVelocitiesUnitImpulse.size());
 
 		btScalar* jac1 = &m_data.m_jacobians[solverConstraint.m_jacAindex];
-		multiBodyA->fillConstraintJacobianMultiDof(solverConstraint.m_linkA, cp.getPositionWorldOnA(), constraintNormal, btVector3(0, 0, 0), jac1, m_data.scratch_r, m_data.scratch_v, m_data.scratch_m);
 		btScalar* delta = &m_data.m_deltaVelocitiesUnitImpulse[solverConstraint.m_jacAindex];
-		multiBodyA->calcAccelerationDeltasMultiDof(&m_data.m_jacobians[solverConstraint.m_jacAindex], delta, m_data.scratch_r, m_data.scratch_v);
+		fillMultiBodyContactJacobian(multiBodyA, solverConstraint.m_linkA, cp.getPositionWorldOnA(), constraintNormal, btVector3(0, 0, 0), jac1, delta);
 
 		btVector3 torqueAxis0 = constraintNormal;
 		solverConstraint.m_relpos1CrossNormal = torqueAxis0;
@@ -992,8 +1005,7 @@ void btMultiBodyConstraintSolver::setupMultiBodyTorsionalFrictionConstraint(btMu
 		m_data.m_deltaVelocitiesUnitImpulse.resize(m_data.m_deltaVelocitiesUnitImpulse.size() + ndofB);
 		btAssert(m_data.m_jacobians.size() == m_data.m_deltaVelocitiesUnitImpulse.size());
 
-		multiBodyB->fillConstraintJacobianMultiDof(solverConstraint.m_linkB, cp.getPositionWorldOnB(), -constraintNormal, btVector3(0, 0, 0), &m_data.m_jacobians[solverConstraint.m_jacBindex], m_data.scratch_r, m_data.scratch_v, m_data.scratch_m);
-		multiBodyB->calcAccelerationDeltasMultiDof(&m_data.m_jacobians[solverConstraint.m_jacBindex], &m_data.m_deltaVelocitiesUnitImpulse[solverConstraint.m_jacBindex], m_data.scratch_r, m_data.scratch_v);
+		fillMultiBodyContactJacobian(multiBodyB, solverConstraint.m_linkB, cp.getPositionWorldOnB(), -constraintNormal, btVector3(0, 0, 0), &m_data.m_jacobians[solverConstraint.m_jacBindex], &m_data.m_deltaVelocitiesUnitImpulse[solverConstraint.m_jacBindex]);
 
 		btVector3 torqueAxis1 = -constraintNormal;
 		solverConstraint.m_relpos2CrossNormal = torqueAxis1;
@@ -1416,8 +1428,112 @@ void btMultiBodyConstraintSolver::convertMultiBodyContact(btPersistentManifold*
 	}
 }
 
+// the rows that convertMultiBodyContact adds for each contact point, on each multibody link of the manifolds
+void btMultiBodyConstraintSolver::countMultiBodyContactRows(btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal)
+{
+	m_linkResponseOffsets.clear();
+	m_linkResponseIndices.resize(0);
+	m_linkResponses.resize(0);
+	for (int i = 0; i < numManifolds; i++)
+	{
+		btPersistentManifold* manifold = manifoldPtr[i];
+		const btMultiBodyLinkCollider* colliders[2] = {btMultiBodyLinkCollider::upcast(manifold->getBody0()), btMultiBodyLinkCollider::upcast(manifold->getBody1())};
+		int numRows = 0;
+		int rollingFriction = 4;
+		for (int j = 0; j < manifold->getNumContacts(); j++)
+		{
+			const btManifoldPoint& cp = manifold->getContactPoint(j);
+			if (cp.getDistance() <= manifold->getContactProcessingThreshold())
+			{
+				numRows += (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS) ? 3 : 2;
+				if (rollingFriction > 0)
+				{
+					numRows += (cp.m_combinedSpinningFriction > 0 ? 1 : 0) + (cp.m_combinedRollingFriction > 0 ? 2 : 0);
+					rollingFriction--;
+				}
+			}
+		}
+		for (int k = 0; k < 2; k++)
+		{
+			if (!colliders[k] || !numRows)
+				continue;
+			btMultiBody* mb = colliders[k]->m_multiBody;
+			const int* offset = m_linkResponseOffsets.find(mb);
+			int index;
+			if (offset)
+			{
+				index = *offset;
+			}
+			else
+			{
+				index = m_linkResponseIndices.size();
+				m_linkResponseOffsets.insert(mb, index);
+				m_linkResponseIndices.resize(index + mb->getNumLinks() + 1, 0);
+			}
+			m_linkResponseIndices[index + colliders[k]->m_link + 1] += numRows;
+		}
+	}
+	for (int i = 0; i < m_linkResponseIndices.size(); i++)
+	{
+		m_linkResponseIndices[i] = m_linkResponseIndices[i] >= m_minContactRowsForLinkResponses ? -2 : -1;
+	}
+}
+
+void btMultiBodyConstraintSolver::fillMultiBodyContactJacobian(btMultiBody* mb, int link, const btVector3& contactPoint, const btVector3& normalAng, const btVector3& normalLin, btScalar* jac, btScalar* deltaVelocities)
+{
+	const int* offset = m_linkResponseOffsets.find(mb);
+	int* index = offset ? &m_linkResponseIndices[*offset + link + 1] : 0;
+	if (!index || *index == -1)
+	{
+		mb->fillConstraintJacobianMultiDof(link, contactPoint, normalAng, normalLin, jac, m_data.scratch_r, m_data.scratch_v, m_data.scratch_m);
+		mb->calcAccelerationDeltasMultiDof(jac, deltaVelocities, m_data.scratch_r, m_data.scratch_v);
+		return;
+	}
+
+	// the Jacobian is linear in the spatial force at the base center of mass, in world coordinates, and so is the response
+	const int ndof = mb->getNumDofs() + 6;
+	if (*index == -2)
+	{
+		*index = m_linkResponses.size();
+		m_linkResponses.resize(*index + 12 * ndof);
+		for (int k = 0; k < 6; k++)
+		{
+			btVector3 unitAng(0, 0, 0);
+			btVector3 unitLin(0, 0, 0);
+			if (k < 3)
+				unitAng[k] = 1;
+			else
+				unitLin[k - 3] = 1;
+			btScalar* unitJac = &m_linkResponses[*index + k * ndof];
+			mb->fillConstraintJacobianMultiDof(link, mb->getBasePos(), unitAng, unitLin, unitJac, m_data.scratch_r, m_data.scratch_v, m_data.scratch_m);
+			mb->calcAccelerationDeltasMultiDof(unitJac, &m_linkResponses[*index + (6 + k) * ndof], m_data.scratch_r, m_data.scratch_v);
+		}
+	}
+
+	const btVector3 forceAng = normalAng + (contactPoint - mb->getBasePos()).cross(normalLin);
+	const btScalar force[6] = {forceAng[0], forceAng[1], forceAng[2], normalLin[0], normalLin[1], normalLin[2]};
+	const btScalar* unitJacs = &m_linkResponses[*index];
+	const btScalar* unitResponses = unitJacs + 6 * ndof;
+	for (int i = 0; i < ndof; i++)
+	{
+		jac[i] = 0;
+		deltaVelocities[i] = 0;
+	}
+	for (int k = 0; k < 6; k++)
+	{
+		if (force[k] == btScalar(0))
+			continue;
+		for (int i = 0; i < ndof; i++)
+		{
+			jac[i] += force[k] * unitJacs[k * ndof + i];
+			deltaVelocities[i] += force[k] * unitResponses[k * ndof + i];
+		}
+	}
+}
+
 void btMultiBodyConstraintSolver::convertContacts(btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal)
 {
+	countMultiBodyContactRows(manifoldPtr, numManifolds, infoGlobal);
 	for (int i = 0; i < numManifolds; i++)
 	{
 		btPersistentManifold* manifold = manifoldPtr[i];
@@ -18,6 +18,7 @@ subject to the following restrictions:
 
 #include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
 #include "btMultiBodySolverConstraint.h"
+#include "LinearMath/btHashMap.h"
 
 #define DIRECTLY_UPDATE_VELOCITY_DURING_SOLVER_ITERATIONS
 
@@ -42,6 +43,15 @@ protected:
 	btMultiBodyConstraint** m_tmpMultiBodyConstraints;
 	int m_tmpNumMultiBodyConstraints;
 
+	//Jacobians and responses of the 6 unit spatial forces on the links with many contact rows, valid during convertContacts
+	//m_linkResponseOffsets maps a multibody to the entry of its base in m_linkResponseIndices, followed by its links
+	//an entry is the number of contact rows of the link while counting, then -1 (no responses), -2 (not computed yet)
+	//or the offset of the 12 vectors of the link in m_linkResponses
+	btHashMap<btHashPtr, int> m_linkResponseOffsets;
+	btAlignedObjectArray<int> m_linkResponseIndices;
+	btAlignedObjectArray<btScalar> m_linkResponses;
+	int m_minContactRowsForLinkResponses;
+
 	btScalar resolveSingleConstraintRowGeneric(const btMultiBodySolverConstraint& c);
 
 	//solve 2 friction directions and clamp against the implicit friction cone
@@ -82,7 +92,11 @@ protected:
 												   bool isFriction, btScalar desiredVelocity = 0, btScalar cfmSlip = 0);
 
 	void convertMultiBodyContact(btPersistentManifold * manifold, const btContactSolverInfo& infoGlobal);
+	void countMultiBodyContactRows(btPersistentManifold * *manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal);
+	//fills the Jacobian of a contact row and the velocity response to a unit impulse along it
+	void fillMultiBodyContactJacobian(btMultiBody * mb, int link, const btVector3& contactPoint, const btVector3& normalAng, const btVector3& normalLin, btScalar* jac, btScalar* deltaVelocities);
 	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer);
+	virtual void setupSolverIslands(const btContactSolverInfo& infoGlobal);
 	//	virtual btScalar solveGroupCacheFriendlyIterations(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer);
 	virtual btScalar solveSingleIteration(int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer);
 	void applyDeltaVee(btScalar * deltaV, btScalar impulse, int velocityIndex, int ndof);
@@ -91,6 +105,14 @@ protected:
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
+	btMultiBodyConstraintSolver();
+
+	///the contact rows of a link with at least this many rows combine the responses of the link to 6 unit spatial forces,
+	///so the link costs 6 articulated body passes instead of one per row. The results differ from the per row passes by
+	///rounding only. The default of 8 is about where the 6 passes become cheaper.
+	void setMinContactRowsForLinkResponses(int numRows) { m_minContactRowsForLinkResponses = numRows; }
+	int getMinContactRowsForLinkResponses() const { return m_minContactRowsForLinkResponses; }
+
 	///this method should not be called, it was just used during porting/integration of Featherstone btMultiBody, providing backwards compatibility but no support for btMultiBodyConstraint (only contact constraints)
 	virtual btScalar solveGroup(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifold, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btDispatcher* dispatcher);
 	virtual btScalar solveGroupCacheFriendlyFinish(btCollisionObject * *bodies, int numBodies, const btContactSolverInfo& infoGlobal);
@@ -0,0 +1,494 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btMultiBodyConstraintSolverMt.h"
+#include "btMultiBody.h"
+
+#include "LinearMath/btQuickprof.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+
+bool btMultiBodyConstraintSolverMt::s_allowNestedParallelForLoops = false;  // some task schedulers don't like nested loops
+int btMultiBodyConstraintSolverMt::s_minimumRowsForBatching = 200;
+int btMultiBodyConstraintSolverMt::s_minBatchSize = 20;
+int btMultiBodyConstraintSolverMt::s_maxBatchSize = 60;
+
+btMultiBodyConstraintSolverMt::btMultiBodyConstraintSolverMt()
+{
+	btFullMemoryFence();
+	m_useBatching = false;
+	btFullMemoryFence();
+}
+
+btMultiBodyConstraintSolverMt::~btMultiBodyConstraintSolverMt()
+{
+}
+
+static void clearMultiBodyPosUpdated(const btMultiBodySolverConstraint& constraint)
+{
+	if (constraint.m_multiBodyA)
+		constraint.m_multiBodyA->setPosUpdated(false);
+	if (constraint.m_multiBodyB)
+		constraint.m_multiBodyB->setPosUpdated(false);
+}
+
+btScalar btMultiBodyConstraintSolverMt::resolveMultipleRows(int rowType, const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd)
+{
+	btScalar leastSquaredResidual = 0;
+	for (int iiCons = batchBegin; iiCons < batchEnd; ++iiCons)
+	{
+		int iCons = (rowType == ROW_TYPE_NON_CONTACT_REVERSED) ? consIndices[batchBegin + batchEnd - 1 - iiCons] : consIndices[iiCons];
+		btScalar residual = 0;
+		switch (rowType)
+		{
+			case ROW_TYPE_NON_CONTACT:
+			case ROW_TYPE_NON_CONTACT_REVERSED:
+			{
+				btMultiBodySolverConstraint& constraint = m_multiBodyNonContactConstraints[iCons];
+				residual = resolveSingleConstraintRowGeneric(constraint);
+				clearMultiBodyPosUpdated(constraint);
+				break;
+			}
+			case ROW_TYPE_NORMAL_CONTACT:
+			{
+				btMultiBodySolverConstraint& constraint = m_multiBodyNormalContactConstraints[iCons];
+				residual = resolveSingleConstraintRowGeneric(constraint);
+				clearMultiBodyPosUpdated(constraint);
+				break;
+			}
+			case ROW_TYPE_NORMAL_CONTACT_SKIPPED:
+			{
+				clearMultiBodyPosUpdated(m_multiBodyNormalContactConstraints[iCons]);
+				break;
+			}
+			case ROW_TYPE_SPINNING_FRICTION:
+			case ROW_TYPE_FRICTION:
+			{
+				btMultiBodySolverConstraint& frictionConstraint = (rowType == ROW_TYPE_SPINNING_FRICTION) ? m_multiBodySpinningFrictionContactConstraints[iCons] : m_multiBodyFrictionContactConstraints[iCons];
+				btScalar totalImpulse = m_multiBodyNormalContactConstraints[frictionConstraint.m_frictionIndex].m_appliedImpulse;
+				//adjust friction limits here
+				if (totalImpulse > btScalar(0))
+				{
+					frictionConstraint.m_lowerLimit = -(frictionConstraint.m_friction * totalImpulse);
+					frictionConstraint.m_upperLimit = frictionConstraint.m_friction * totalImpulse;
+					residual = resolveSingleConstraintRowGeneric(frictionConstraint);
+					clearMultiBodyPosUpdated(frictionConstraint);
+				}
+				break;
+			}
+			case ROW_TYPE_TORSIONAL_FRICTION:
+			case ROW_TYPE_CONE_FRICTION:
+			{
+				btMultiBodyConstraintArray& rows = (rowType == ROW_TYPE_TORSIONAL_FRICTION) ? m_multiBodyTorsionalFrictionContactConstraints : m_multiBodyFrictionContactConstraints;
+				btMultiBodySolverConstraint& frictionConstraint = rows[iCons];
+				btMultiBodySolverConstraint& frictionConstraintB = rows[iCons + 1];
+				btScalar totalImpulse = m_multiBodyNormalContactConstraints[frictionConstraint.m_frictionIndex].m_appliedImpulse;
+				btAssert(rowType == ROW_TYPE_TORSIONAL_FRICTION || frictionConstraint.m_frictionIndex == frictionConstraintB.m_frictionIndex);
+				// the torsional friction is only solved while the contact pushes, the friction of the contact plane always
+				if ((rowType == ROW_TYPE_CONE_FRICTION || totalImpulse > btScalar(0)) && frictionConstraint.m_frictionIndex == frictionConstraintB.m_frictionIndex)
+				{
+					frictionConstraint.m_lowerLimit = -(frictionConstraint.m_friction * totalImpulse);
+					frictionConstraint.m_upperLimit = frictionConstraint.m_friction * totalImpulse;
+					frictionConstraintB.m_lowerLimit = -(frictionConstraintB.m_friction * totalImpulse);
+					frictionConstraintB.m_upperLimit = frictionConstraintB.m_friction * totalImpulse;
+					residual = resolveConeFrictionConstraintRows(frictionConstraint, frictionConstraintB);
+					clearMultiBodyPosUpdated(frictionConstraint);
+					clearMultiBodyPosUpdated(frictionConstraintB);
+				}
+				break;
+			}
+		}
+		leastSquaredResidual = btMax(leastSquaredResidual, residual * residual);
+	}
+	return leastSquaredResidual;
+}
+
+struct MultiBodyRowSolverLoop : public btIParallelForBody
+{
+	btMultiBodyConstraintSolverMt* m_solver;
+	const btBatchedConstraints* m_bc;
+	btScalar* m_batchResiduals;
+	int m_rowType;
+
+	MultiBodyRowSolverLoop(btMultiBodyConstraintSolverMt* solver, const btBatchedConstraints* bc, btScalar* batchResiduals, int rowType)
+	{
+		m_solver = solver;
+		m_bc = bc;
+		m_batchResiduals = batchResiduals;
+		m_rowType = rowType;
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		BT_PROFILE("MultiBodyRowSolverLoop");
+		for (int iBatch = iBegin; iBatch < iEnd; ++iBatch)
+		{
+			const btBatchedConstraints::Range& batch = m_bc->m_batches[iBatch];
+			m_batchResiduals[iBatch] = m_solver->resolveMultipleRows(m_rowType, m_bc->m_constraintIndices, batch.begin, batch.end);
+		}
+	}
+};
+
+btScalar btMultiBodyConstraintSolverMt::resolveAllBatchedRows(const btBatchedConstraints& batchedConstraints, int rowType)
+{
+	const btBatchedConstraints& bc = batchedConstraints;
+	if (bc.m_batches.size() == 0)
+	{
+		return btScalar(0);
+	}
+	MultiBodyRowSolverLoop loop(this, &bc, &m_batchResiduals[0], rowType);
+	int numPhases = bc.m_phases.size();
+	for (int iiPhase = 0; iiPhase < numPhases; ++iiPhase)
+	{
+		// the rows within the batches are reversed as well, see resolveMultipleRows
+		int iPhase = (rowType == ROW_TYPE_NON_CONTACT_REVERSED) ? bc.m_phaseOrder[numPhases - 1 - iiPhase] : bc.m_phaseOrder[iiPhase];
+		const btBatchedConstraints::Range& phase = bc.m_phases[iPhase];
+		int grainSize = bc.m_phaseGrainSize[iPhase];
+		btParallelFor(phase.begin, phase.end, grainSize, loop);
+	}
+	// the max does not depend on the order, unlike a parallel sum
+	btScalar leastSquaredResidual = 0;
+	for (int iBatch = 0; iBatch < bc.m_batches.size(); ++iBatch)
+	{
+		leastSquaredResidual = btMax(leastSquaredResidual, m_batchResiduals[iBatch]);
+	}
+	return leastSquaredResidual;
+}
+
+btScalar btMultiBodyConstraintSolverMt::solveSingleIteration(int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
+{
+	bool useBatching = m_useBatching;
+	btFullMemoryFence();
+
+	if (!useBatching)
+	{
+		return btMultiBodyConstraintSolver::solveSingleIteration(iteration, bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+	}
+	BT_PROFILE("solveSingleIterationMt");
+	btScalar leastSquaredResidual = btSequentialImpulseConstraintSolver::solveSingleIteration(iteration, bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+
+	//solve featherstone non-contact constraints
+	btScalar nonContactResidual = 0;
+	for (int i = 0; i < infoGlobal.m_numNonContactInnerIterations; ++i)
+	{
+		nonContactResidual = resolveAllBatchedRows(m_batchedNonContactConstraints, (iteration & 1) ? ROW_TYPE_NON_CONTACT : ROW_TYPE_NON_CONTACT_REVERSED);
+	}
+	leastSquaredResidual = btMax(leastSquaredResidual, nonContactResidual);
+
+	//solve featherstone normal contact
+	btScalar contactResidual = resolveAllBatchedRows(m_batchedNormalContactConstraints, (iteration < infoGlobal.m_numIterations) ? ROW_TYPE_NORMAL_CONTACT : ROW_TYPE_NORMAL_CONTACT_SKIPPED);
+	leastSquaredResidual = btMax(leastSquaredResidual, contactResidual);
+
+	//solve featherstone frictional contact
+	if (iteration < infoGlobal.m_numIterations)
+	{
+		if (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS && ((infoGlobal.m_solverMode & SOLVER_DISABLE_IMPLICIT_CONE_FRICTION) == 0))
+		{
+			leastSquaredResidual = btMax(leastSquaredResidual, resolveAllBatchedRows(m_batchedSpinningFrictionConstraints, ROW_TYPE_SPINNING_FRICTION));
+			leastSquaredResidual = btMax(leastSquaredResidual, resolveAllBatchedRows(m_batchedTorsionalFrictionConstraints, ROW_TYPE_TORSIONAL_FRICTION));
+			leastSquaredResidual = btMax(leastSquaredResidual, resolveAllBatchedRows(m_batchedFrictionConstraints, ROW_TYPE_CONE_FRICTION));
+		}
+		else
+		{
+			leastSquaredResidual = btMax(leastSquaredResidual, resolveAllBatchedRows(m_batchedFrictionConstraints, ROW_TYPE_FRICTION));
+		}
+	}
+	return leastSquaredResidual;
+}
+
+int btMultiBodyConstraintSolverMt::getBatchingBodyKey(btMultiBody* multiBody, int deltaVelIndex, int solverBodyId) const
+{
+	if (multiBody)
+	{
+		// a row updates the delta velocities of all the links of the multibody, the companion ids are unique offsets
+		return m_tmpSolverBodyPool.size() + deltaVelIndex;
+	}
+	if (solverBodyId >= 0)
+	{
+		const btSolverBody& body = m_tmpSolverBodyPool[solverBodyId];
+		if (body.m_originalBody && body.m_originalBody->getInvMass() > btScalar(0))
+		{
+			return solverBodyId;
+		}
+	}
+	return -1;
+}
+
+struct MultiBodyBatchingRowInfoSortPredicate
+{
+	bool operator()(const btMultiBodyConstraintSolverMt::BatchingRowInfo& a, const btMultiBodyConstraintSolverMt::BatchingRowInfo& b) const
+	{
+		if (a.m_bodyKeys[0] != b.m_bodyKeys[0])
+		{
+			return a.m_bodyKeys[0] < b.m_bodyKeys[0];
+		}
+		if (a.m_bodyKeys[1] != b.m_bodyKeys[1])
+		{
+			return a.m_bodyKeys[1] < b.m_bodyKeys[1];
+		}
+		return a.m_rowIndex < b.m_rowIndex;
+	}
+};
+
+static bool haveSameBatchingKeys(const btMultiBodyConstraintSolverMt::BatchingRowInfo& a, const btMultiBodyConstraintSolverMt::BatchingRowInfo& b)
+{
+	return a.m_bodyKeys[0] == b.m_bodyKeys[0] && a.m_bodyKeys[1] == b.m_bodyKeys[1];
+}
+
+// The rows of the same pair of bodies are a unit that is solved by one thread, so a multibody with many contacts
+// does not need as many colors. The units are colored like setupGraphColoringBatches of btBatchedConstraints.
+void btMultiBodyConstraintSolverMt::setupBatchedRows(btBatchedConstraints* batchedConstraints, const btMultiBodyConstraintArray& rows, int rowsPerGroup)
+{
+	typedef btBatchedConstraints::Range Range;
+	const int maxNumColors = 32;
+	const int kSerialColor = -1;
+	int numGroups = rows.size() / rowsPerGroup;
+	int numKeys = m_tmpSolverBodyPool.size() + m_data.m_deltaVelocities.size();
+
+	btBatchedConstraints* bc = batchedConstraints;
+	bc->m_constraintIndices.resizeNoInitialize(numGroups);
+	bc->m_batches.resizeNoInitialize(0);
+	bc->m_phases.resizeNoInitialize(0);
+	bc->m_phaseGrainSize.resizeNoInitialize(0);
+	bc->m_phaseOrder.resizeNoInitialize(0);
+	if (numGroups == 0)
+	{
+		return;
+	}
+
+	btAlignedObjectArray<BatchingRowInfo>& infos = m_batchingRowInfos;
+	infos.resizeNoInitialize(numGroups);
+	for (int i = 0; i < numGroups; ++i)
+	{
+		const btMultiBodySolverConstraint& row = rows[i * rowsPerGroup];
+		int keyA = getBatchingBodyKey(row.m_multiBodyA, row.m_deltaVelAindex, row.m_solverBodyIdA);
+		int keyB = getBatchingBodyKey(row.m_multiBodyB, row.m_deltaVelBindex, row.m_solverBodyIdB);
+		BatchingRowInfo& info = infos[i];
+		info.m_bodyKeys[0] = btMin(keyA, keyB);
+		info.m_bodyKeys[1] = btMax(keyA, keyB);
+		info.m_rowIndex = i * rowsPerGroup;
+		info.m_color = kSerialColor;
+	}
+	infos.quickSort(MultiBodyBatchingRowInfoSortPredicate());
+
+	// count the units of each body, the masks are used as counters first
+	unsigned int* bodyColorMasks = NULL;
+	m_bodyColorMasks.resizeNoInitialize(numKeys);
+	if (numKeys > 0)
+	{
+		bodyColorMasks = &m_bodyColorMasks[0];
+	}
+	for (int iKey = 0; iKey < numKeys; ++iKey)
+	{
+		bodyColorMasks[iKey] = 0;
+	}
+	unsigned int maxBodyUnits = 1;
+	for (int iUnit = 0; iUnit < numGroups;)
+	{
+		const BatchingRowInfo& info = infos[iUnit];
+		for (int i = 0; i < 2; ++i)
+		{
+			int iKey = info.m_bodyKeys[i];
+			if (iKey >= 0 && (i == 0 || iKey != info.m_bodyKeys[0]))
+			{
+				maxBodyUnits = btMax(maxBodyUnits, ++bodyColorMasks[iKey]);
+			}
+		}
+		do
+		{
+			++iUnit;
+		} while (iUnit < numGroups && haveSameBatchingKeys(infos[iUnit], info));
+	}
+	for (int iKey = 0; iKey < numKeys; ++iKey)
+	{
+		bodyColorMasks[iKey] = 0;
+	}
+
+	// allow a quarter more than an even split, fewer colors means fewer phases
+	int numTargetColors = btMin(int(maxBodyUnits) + 1, maxNumColors);
+	int colorCapacity = (numGroups + numGroups / 4) / numTargetColors + 1;
+	int colorRows[maxNumColors];
+	for (int iColor = 0; iColor < maxNumColors; ++iColor)
+	{
+		colorRows[iColor] = 0;
+	}
+	for (int iUnit = 0; iUnit < numGroups;)
+	{
+		int unitEnd = iUnit + 1;
+		while (unitEnd < numGroups && haveSameBatchingKeys(infos[unitEnd], infos[iUnit]))
+		{
+			++unitEnd;
+		}
+		int numUnitRows = unitEnd - iUnit;
+		int iKey0 = infos[iUnit].m_bodyKeys[0];
+		int iKey1 = infos[iUnit].m_bodyKeys[1];
+		unsigned int usedColors = 0;
+		if (iKey0 >= 0)
+		{
+			usedColors |= bodyColorMasks[iKey0];
+		}
+		if (iKey1 >= 0)
+		{
+			usedColors |= bodyColorMasks[iKey1];
+		}
+		int color = kSerialColor;
+		int leastRowsColor = kSerialColor;
+		for (int iColor = 0; iColor < maxNumColors; ++iColor)
+		{
+			if ((usedColors & (1u << iColor)) == 0)
+			{
+				if (colorRows[iColor] + numUnitRows <= colorCapacity)
+				{
+					color = iColor;
+					break;
+				}
+				if (leastRowsColor == kSerialColor || colorRows[iColor] < colorRows[leastRowsColor])
+				{
+					leastRowsColor = iColor;
+				}
+			}
+		}
+		if (color == kSerialColor)
+		{
+			color = leastRowsColor;
+		}
+		if (color != kSerialColor)
+		{
+			unsigned int colorBit = 1u << color;
+			if (iKey0 >= 0)
+			{
+				bodyColorMasks[iKey0] |= colorBit;
+			}
+			if (iKey1 >= 0)
+			{
+				bodyColorMasks[iKey1] |= colorBit;
+			}
+			colorRows[color] += numUnitRows;
+		}
+		for (int i = iUnit; i < unitEnd; ++i)
+		{
+			infos[i].m_color = color;
+		}
+		iUnit = unitEnd;
+	}
+
+	// colors too small for 2 batches are solved in the serial phase
+	int colorBegin[maxNumColors + 1];
+	int serialBegin = 0;
+	for (int iColor = 0; iColor < maxNumColors; ++iColor)
+	{
+		if (colorRows[iColor] < 2 * s_minBatchSize)
+		{
+			colorRows[iColor] = 0;
+		}
+		colorBegin[iColor] = serialBegin;
+		serialBegin += colorRows[iColor];
+	}
+	colorBegin[maxNumColors] = serialBegin;
+
+	// the constraint indices hold the sorted infos until the batches are closed, the units stay contiguous
+	{
+		int serialEnd = serialBegin;
+		int colorEnd[maxNumColors];
+		for (int iColor = 0; iColor < maxNumColors; ++iColor)
+		{
+			colorEnd[iColor] = colorBegin[iColor];
+		}
+		for (int i = 0; i < numGroups; ++i)
+		{
+			int color = infos[i].m_color;
+			if (color != kSerialColor && colorRows[color] > 0)
+			{
+				bc->m_constraintIndices[colorEnd[color]++] = i;
+			}
+			else
+			{
+				bc->m_constraintIndices[serialEnd++] = i;
+			}
+		}
+		btAssert(serialEnd == numGroups);
+	}
+
+	int numThreads = btGetTaskScheduler()->getNumThreads();
+	for (int iColor = 0; iColor <= maxNumColors; ++iColor)
+	{
+		int begin = colorBegin[iColor];
+		int end = (iColor < maxNumColors) ? colorBegin[iColor + 1] : numGroups;
+		if (begin == end)
+		{
+			continue;
+		}
+		int numRows = end - begin;
+		int numBatches = 1;
+		if (iColor < maxNumColors)
+		{
+			numBatches = (numRows + s_maxBatchSize - 1) / s_maxBatchSize;
+			numBatches = btMax(numBatches, btMin(numThreads, numRows / s_minBatchSize));
+		}
+		int phaseBegin = bc->m_batches.size();
+		int batchBegin = begin;
+		for (int i = begin; i < end; ++i)
+		{
+			// close the batch at the end of a unit when it reaches its share of the rows of the phase
+			int iBatch = bc->m_batches.size() - phaseBegin;
+			if (iBatch < numBatches - 1 && i + 1 < end &&
+				!haveSameBatchingKeys(infos[bc->m_constraintIndices[i]], infos[bc->m_constraintIndices[i + 1]]) &&
+				i + 1 - begin >= (numRows * (iBatch + 1)) / numBatches)
+			{
+				bc->m_batches.push_back(Range(batchBegin, i + 1));
+				batchBegin = i + 1;
+			}
+		}
+		bc->m_batches.push_back(Range(batchBegin, end));
+		bc->m_phaseOrder.push_back(bc->m_phases.size());
+		bc->m_phases.push_back(Range(phaseBegin, bc->m_batches.size()));
+		bc->m_phaseGrainSize.push_back(1);
+	}
+	for (int i = 0; i < numGroups; ++i)
+	{
+		bc->m_constraintIndices[i] = infos[bc->m_constraintIndices[i]].m_rowIndex;
+	}
+}
+
+btScalar btMultiBodyConstraintSolverMt::solveGroupCacheFriendlySetup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
+{
+	btFullMemoryFence();
+	m_useBatching = false;
+	btFullMemoryFence();
+
+	btScalar val = btMultiBodyConstraintSolver::solveGroupCacheFriendlySetup(bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+
+	int numRows = m_multiBodyNonContactConstraints.size() + m_multiBodyNormalContactConstraints.size();
+	if (numRows >= s_minimumRowsForBatching &&
+		(s_allowNestedParallelForLoops || !btThreadsAreRunning()))
+	{
+		BT_PROFILE("setupBatchedMultiBodyRows");
+		bool useConeFriction = (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS) && ((infoGlobal.m_solverMode & SOLVER_DISABLE_IMPLICIT_CONE_FRICTION) == 0);
+		setupBatchedRows(&m_batchedNonContactConstraints, m_multiBodyNonContactConstraints, 1);
+		setupBatchedRows(&m_batchedNormalContactConstraints, m_multiBodyNormalContactConstraints, 1);
+		setupBatchedRows(&m_batchedSpinningFrictionConstraints, m_multiBodySpinningFrictionContactConstraints, 1);
+		setupBatchedRows(&m_batchedTorsionalFrictionConstraints, m_multiBodyTorsionalFrictionContactConstraints, 2);
+		setupBatchedRows(&m_batchedFrictionConstraints, m_multiBodyFrictionContactConstraints, useConeFriction ? 2 : 1);
+
+		int maxNumBatches = btMax(m_batchedNonContactConstraints.m_batches.size(), m_batchedNormalContactConstraints.m_batches.size());
+		maxNumBatches = btMax(maxNumBatches, m_batchedSpinningFrictionConstraints.m_batches.size());
+		maxNumBatches = btMax(maxNumBatches, m_batchedTorsionalFrictionConstraints.m_batches.size());
+		maxNumBatches = btMax(maxNumBatches, m_batchedFrictionConstraints.m_batches.size());
+		m_batchResiduals.resizeNoInitialize(maxNumBatches);
+
+		btFullMemoryFence();
+		m_useBatching = true;
+		btFullMemoryFence();
+	}
+	return val;
+}
@@ -0,0 +1,102 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_MULTIBODY_CONSTRAINT_SOLVER_MT_H
+#define BT_MULTIBODY_CONSTRAINT_SOLVER_MT_H
+
+#include "btMultiBodyConstraintSolver.h"
+#include "BulletDynamics/ConstraintSolver/btBatchedConstraints.h"
+#include "LinearMath/btThreads.h"
+
+///
+/// btMultiBodyConstraintSolverMt
+///
+///  A multithreaded variant of the multibody constraint solver, like btSequentialImpulseConstraintSolverMt for the
+///  multibody rows. The non-contact, contact and friction rows of the multibodies are grouped into batches and phases
+///  where each batch of rows within a given phase can be solved in parallel with the rest.
+///  This method works best on a large group of many multibodies, for example when all islands are solved as one group.
+///
+///  A multibody row reads and writes the delta velocities of all the degrees of freedom of its multibodies, so the
+///  batches are made conflict-free per multibody, not per link. Rows of the same pair of multibodies or dynamic rigid
+///  bodies are kept together in one batch in their original order. Static and kinematic bodies do not conflict.
+///  Friction pairs solved against the implicit friction cone are kept together as well.
+///
+///  The phases of a row type are solved in order, except the non-contact rows which alternate the order like the
+///  normal solver. The rows of the rigid bodies are solved by btSequentialImpulseConstraintSolver as before.
+///  The residual of the batches is combined with btMax, so the result does not depend on the number of threads.
+///
+ATTRIBUTE_ALIGNED16(class)
+btMultiBodyConstraintSolverMt : public btMultiBodyConstraintSolver
+{
+public:
+	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer) BT_OVERRIDE;
+	virtual btScalar solveSingleIteration(int iteration, btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer) BT_OVERRIDE;
+
+	// temp struct used to group the rows that touch the same bodies, see setupBatchedRows
+	struct BatchingRowInfo
+	{
+		int m_bodyKeys[2];  // dynamic rigid solver body, or multibody after the solver bodies, -1 if none
+		int m_rowIndex;     // first row of the group
+		int m_color;
+	};
+
+	// parameters to control batching
+	static bool s_allowNestedParallelForLoops;  // whether to allow nested parallel operations
+	static int s_minimumRowsForBatching;        // don't even try to batch if fewer multibody contact and non-contact rows than this
+	static int s_minBatchSize;                  // desired number of rows per batch
+	static int s_maxBatchSize;
+
+protected:
+	btBatchedConstraints m_batchedNonContactConstraints;
+	btBatchedConstraints m_batchedNormalContactConstraints;
+	btBatchedConstraints m_batchedSpinningFrictionConstraints;
+	btBatchedConstraints m_batchedTorsionalFrictionConstraints;  // first row of each pair
+	btBatchedConstraints m_batchedFrictionConstraints;           // first row of each pair with the implicit friction cone
+	btAlignedObjectArray<btScalar> m_batchResiduals;             // max squared residual of each batch of the last loop
+	btAlignedObjectArray<BatchingRowInfo> m_batchingRowInfos;
+	btAlignedObjectArray<unsigned int> m_bodyColorMasks;
+	bool volatile m_useBatching;
+
+	int getBatchingBodyKey(btMultiBody * multiBody, int deltaVelIndex, int solverBodyId) const;
+	virtual void setupBatchedRows(btBatchedConstraints * batchedConstraints, const btMultiBodyConstraintArray& rows, int rowsPerGroup);
+	virtual btScalar resolveAllBatchedRows(const btBatchedConstraints& batchedConstraints, int rowType);
+
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	enum RowType
+	{
+		ROW_TYPE_NON_CONTACT,
+		ROW_TYPE_NON_CONTACT_REVERSED,
+		ROW_TYPE_NORMAL_CONTACT,
+		ROW_TYPE_NORMAL_CONTACT_SKIPPED,  // after m_numIterations, only flags the multibodies
+		ROW_TYPE_SPINNING_FRICTION,
+		ROW_TYPE_TORSIONAL_FRICTION,
+		ROW_TYPE_CONE_FRICTION,
+		ROW_TYPE_FRICTION,
+	};
+
+	btMultiBodyConstraintSolverMt();
+	virtual ~btMultiBodyConstraintSolverMt();
+
+	// batches of the last solve, see btBatchedConstraints::getStatistics
+	const btBatchedConstraints& getBatchedNonContactConstraints() const { return m_batchedNonContactConstraints; }
+	const btBatchedConstraints& getBatchedNormalContactConstraints() const { return m_batchedNormalContactConstraints; }
+	const btBatchedConstraints& getBatchedFrictionConstraints() const { return m_batchedFrictionConstraints; }
+
+	btScalar resolveMultipleRows(int rowType, const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd);
+};
+
+#endif  //BT_MULTIBODY_CONSTRAINT_SOLVER_MT_H
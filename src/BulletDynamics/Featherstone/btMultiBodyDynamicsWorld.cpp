@@ -214,10 +214,18 @@ void btMultiBodyDynamicsWorld::setConstraintSolver(btConstraintSolver* solver)
 
 void btMultiBodyDynamicsWorld::forwardKinematics()
 {
-	for (int b = 0; b < m_multiBodies.size(); b++)
+	if (m_multiBodies.size() > 0)
 	{
-		btMultiBody* bod = m_multiBodies[b];
-		bod->forwardKinematics(m_scratch_world_to_local, m_scratch_local_origin);
+		forwardKinematicsInternal(&m_multiBodies[0], m_multiBodies.size(), m_scratch_world_to_local, m_scratch_local_origin);
+	}
+}
+
+void btMultiBodyDynamicsWorld::forwardKinematicsInternal(btMultiBody** bodies, int numBodies, btAlignedObjectArray<btQuaternion>& scratch_world_to_local, btAlignedObjectArray<btVector3>& scratch_local_origin)
+{
+	for (int b = 0; b < numBodies; b++)
+	{
+		btMultiBody* bod = bodies[b];
+		bod->forwardKinematics(scratch_world_to_local, scratch_local_origin);
 	}
 }
 void btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
@@ -239,48 +247,52 @@ void btMultiBodyDynamicsWorld::solveInternalConstraints(btContactSolverInfo& sol
 	m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
     {
         BT_PROFILE("btMultiBody stepVelocities");
-        for (int i = 0; i < this->m_multiBodies.size(); i++)
+        if (m_multiBodies.size() > 0)
         {
-            btMultiBody* bod = m_multiBodies[i];
-            
-            bool isSleeping = false;
-            
-            if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
-            {
+            applyMultiBodyDeltaVeeInternal(&m_multiBodies[0], m_multiBodies.size(), solverInfo, m_scratch_r, m_scratch_v, m_scratch_m);
+        }
+    }
+}
+
+void btMultiBodyDynamicsWorld::applyMultiBodyDeltaVeeInternal(btMultiBody** bodies, int numBodies, const btContactSolverInfo& solverInfo, btAlignedObjectArray<btScalar>& scratch_r, btAlignedObjectArray<btVector3>& scratch_v, btAlignedObjectArray<btMatrix3x3>& scratch_m)
+{
+    for (int i = 0; i < numBodies; i++)
+    {
+        btMultiBody* bod = bodies[i];
+        
+        bool isSleeping = false;
+        
+        if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
+        {
+            isSleeping = true;
+        }
+        for (int b = 0; b < bod->getNumLinks(); b++)
+        {
+            if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState() == ISLAND_SLEEPING)
                 isSleeping = true;
-            }
-            for (int b = 0; b < bod->getNumLinks(); b++)
-            {
-                if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState() == ISLAND_SLEEPING)
-                    isSleeping = true;
-            }
+        }
+        
+        if (!isSleeping)
+        {
+            //useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
+            scratch_r.resize(bod->getNumLinks() + 1);  //multidof? ("Y"s use it and it is used to store qdd)
+            scratch_v.resize(bod->getNumLinks() + 1);
+            scratch_m.resize(bod->getNumLinks() + 1);
             
-            if (!isSleeping)
+            if (bod->internalNeedsJointFeedback())
             {
-                //useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
-                m_scratch_r.resize(bod->getNumLinks() + 1);  //multidof? ("Y"s use it and it is used to store qdd)
-                m_scratch_v.resize(bod->getNumLinks() + 1);
-                m_scratch_m.resize(bod->getNumLinks() + 1);
-                
-                if (bod->internalNeedsJointFeedback())
+                if (!bod->isUsingRK4Integration())
                 {
-                    if (!bod->isUsingRK4Integration())
+                    if (bod->internalNeedsJointFeedback())
                     {
-                        if (bod->internalNeedsJointFeedback())
-                        {
-                            bool isConstraintPass = true;
-                            bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(solverInfo.m_timeStep, m_scratch_r, m_scratch_v, m_scratch_m, isConstraintPass,
-                                                                                      getSolverInfo().m_jointFeedbackInWorldSpace,
-                                                                                      getSolverInfo().m_jointFeedbackInJointFrame);
-                        }
+                        bool isConstraintPass = true;
+                        bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(solverInfo.m_timeStep, scratch_r, scratch_v, scratch_m, isConstraintPass,
+                                                                                  getSolverInfo().m_jointFeedbackInWorldSpace,
+                                                                                  getSolverInfo().m_jointFeedbackInJointFrame);
                     }
                 }
             }
         }
-    }
-    for (int i = 0; i < this->m_multiBodies.size(); i++)
-    {
-        btMultiBody* bod = m_multiBodies[i];
         bod->processDeltaVeeMultiDof2();
     }
 }
@@ -351,223 +363,235 @@ void btMultiBodyDynamicsWorld::solveExternalForces(btContactSolverInfo& solverIn
     }
 #endif  //BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
     
+    stepMultiBodyVelocities(solverInfo);
+}
+
+void btMultiBodyDynamicsWorld::stepMultiBodyVelocities(btContactSolverInfo& solverInfo)
+{
+    BT_PROFILE("btMultiBody stepVelocities");
+    if (m_multiBodies.size() > 0)
     {
-        BT_PROFILE("btMultiBody stepVelocities");
-        for (int i = 0; i < this->m_multiBodies.size(); i++)
+        stepMultiBodyVelocitiesInternal(&m_multiBodies[0], m_multiBodies.size(), solverInfo, m_scratch_r, m_scratch_v, m_scratch_m);
+    }
+}
+
+void btMultiBodyDynamicsWorld::stepMultiBodyVelocitiesInternal(btMultiBody** bodies, int numBodies, const btContactSolverInfo& solverInfo, btAlignedObjectArray<btScalar>& scratch_r, btAlignedObjectArray<btVector3>& scratch_v, btAlignedObjectArray<btMatrix3x3>& scratch_m)
+{
+    for (int i = 0; i < numBodies; i++)
+    {
+        btMultiBody* bod = bodies[i];
+        
+        bool isSleeping = false;
+        
+        if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
         {
-            btMultiBody* bod = m_multiBodies[i];
-            
-            bool isSleeping = false;
-            
-            if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
-            {
+            isSleeping = true;
+        }
+        for (int b = 0; b < bod->getNumLinks(); b++)
+        {
+            if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState() == ISLAND_SLEEPING)
                 isSleeping = true;
-            }
-            for (int b = 0; b < bod->getNumLinks(); b++)
-            {
-                if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState() == ISLAND_SLEEPING)
-                    isSleeping = true;
-            }
-            
-            if (!isSleeping)
+        }
+        
+        if (!isSleeping)
+        {
+            //useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
+            scratch_r.resize(bod->getNumLinks() + 1);  //multidof? ("Y"s use it and it is used to store qdd)
+            scratch_v.resize(bod->getNumLinks() + 1);
+            scratch_m.resize(bod->getNumLinks() + 1);
+            bool doNotUpdatePos = false;
+            bool isConstraintPass = false;
             {
-                //useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
-                m_scratch_r.resize(bod->getNumLinks() + 1);  //multidof? ("Y"s use it and it is used to store qdd)
-                m_scratch_v.resize(bod->getNumLinks() + 1);
-                m_scratch_m.resize(bod->getNumLinks() + 1);
-                bool doNotUpdatePos = false;
-                bool isConstraintPass = false;
+                if (!bod->isUsingRK4Integration())
+                {
+                    bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(solverInfo.m_timeStep,
+                                                                              scratch_r, scratch_v, scratch_m,isConstraintPass,
+                                                                              getSolverInfo().m_jointFeedbackInWorldSpace,
+                                                                              getSolverInfo().m_jointFeedbackInJointFrame);
+                }
+                else
                 {
-                    if (!bod->isUsingRK4Integration())
+                    //
+                    int numDofs = bod->getNumDofs() + 6;
+                    int numPosVars = bod->getNumPosVars() + 7;
+                    btAlignedObjectArray<btScalar> scratch_r2;
+                    scratch_r2.resize(2 * numPosVars + 8 * numDofs);
+                    //convenience
+                    btScalar* pMem = &scratch_r2[0];
+                    btScalar* scratch_q0 = pMem;
+                    pMem += numPosVars;
+                    btScalar* scratch_qx = pMem;
+                    pMem += numPosVars;
+                    btScalar* scratch_qd0 = pMem;
+                    pMem += numDofs;
+                    btScalar* scratch_qd1 = pMem;
+                    pMem += numDofs;
+                    btScalar* scratch_qd2 = pMem;
+                    pMem += numDofs;
+                    btScalar* scratch_qd3 = pMem;
+                    pMem += numDofs;
+                    btScalar* scratch_qdd0 = pMem;
+                    pMem += numDofs;
+                    btScalar* scratch_qdd1 = pMem;
+                    pMem += numDofs;
+                    btScalar* scratch_qdd2 = pMem;
+                    pMem += numDofs;
+                    btScalar* scratch_qdd3 = pMem;
+                    pMem += numDofs;
+                    btAssert((pMem - (2 * numPosVars + 8 * numDofs)) == &scratch_r2[0]);
+                    
+                    /////
+                    //copy q0 to scratch_q0 and qd0 to scratch_qd0
+                    scratch_q0[0] = bod->getWorldToBaseRot().x();
+                    scratch_q0[1] = bod->getWorldToBaseRot().y();
+                    scratch_q0[2] = bod->getWorldToBaseRot().z();
+                    scratch_q0[3] = bod->getWorldToBaseRot().w();
+                    scratch_q0[4] = bod->getBasePos().x();
+                    scratch_q0[5] = bod->getBasePos().y();
+                    scratch_q0[6] = bod->getBasePos().z();
+                    //
+                    for (int link = 0; link < bod->getNumLinks(); ++link)
                     {
-                        bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(solverInfo.m_timeStep,
-                                                                                  m_scratch_r, m_scratch_v, m_scratch_m,isConstraintPass,
-                                                                                  getSolverInfo().m_jointFeedbackInWorldSpace,
-                                                                                  getSolverInfo().m_jointFeedbackInJointFrame);
+                        for (int dof = 0; dof < bod->getLink(link).m_posVarCount; ++dof)
+                            scratch_q0[7 + bod->getLink(link).m_cfgOffset + dof] = bod->getLink(link).m_jointPos[dof];
                     }
-                    else
+                    //
+                    for (int dof = 0; dof < numDofs; ++dof)
+                        scratch_qd0[dof] = bod->getVelocityVector()[dof];
+                    ////
+                    struct
                     {
-                        //
-                        int numDofs = bod->getNumDofs() + 6;
-                        int numPosVars = bod->getNumPosVars() + 7;
-                        btAlignedObjectArray<btScalar> scratch_r2;
-                        scratch_r2.resize(2 * numPosVars + 8 * numDofs);
-                        //convenience
-                        btScalar* pMem = &scratch_r2[0];
-                        btScalar* scratch_q0 = pMem;
-                        pMem += numPosVars;
-                        btScalar* scratch_qx = pMem;
-                        pMem += numPosVars;
-                        btScalar* scratch_qd0 = pMem;
-                        pMem += numDofs;
-                        btScalar* scratch_qd1 = pMem;
-                        pMem += numDofs;
-                        btScalar* scratch_qd2 = pMem;
-                        pMem += numDofs;
-                        btScalar* scratch_qd3 = pMem;
-                        pMem += numDofs;
-                        btScalar* scratch_qdd0 = pMem;
-                        pMem += numDofs;
-                        btScalar* scratch_qdd1 = pMem;
-                        pMem += numDofs;
-                        btScalar* scratch_qdd2 = pMem;
-                        pMem += numDofs;
-                        btScalar* scratch_qdd3 = pMem;
-                        pMem += numDofs;
-                        btAssert((pMem - (2 * numPosVars + 8 * numDofs)) == &scratch_r2[0]);
+                        btMultiBody* bod;
+                        btScalar *scratch_qx, *scratch_q0;
                         
-                        /////
-                        //copy q0 to scratch_q0 and qd0 to scratch_qd0
-                        scratch_q0[0] = bod->getWorldToBaseRot().x();
-                        scratch_q0[1] = bod->getWorldToBaseRot().y();
-                        scratch_q0[2] = bod->getWorldToBaseRot().z();
-                        scratch_q0[3] = bod->getWorldToBaseRot().w();
-                        scratch_q0[4] = bod->getBasePos().x();
-                        scratch_q0[5] = bod->getBasePos().y();
-                        scratch_q0[6] = bod->getBasePos().z();
-                        //
-                        for (int link = 0; link < bod->getNumLinks(); ++link)
+                        void operator()()
                         {
-                            for (int dof = 0; dof < bod->getLink(link).m_posVarCount; ++dof)
-                                scratch_q0[7 + bod->getLink(link).m_cfgOffset + dof] = bod->getLink(link).m_jointPos[dof];
+                            for (int dof = 0; dof < bod->getNumPosVars() + 7; ++dof)
+                                scratch_qx[dof] = scratch_q0[dof];
                         }
-                        //
-                        for (int dof = 0; dof < numDofs; ++dof)
-                            scratch_qd0[dof] = bod->getVelocityVector()[dof];
-                        ////
-                        struct
-                        {
-                            btMultiBody* bod;
-                            btScalar *scratch_qx, *scratch_q0;
-                            
-                            void operator()()
-                            {
-                                for (int dof = 0; dof < bod->getNumPosVars() + 7; ++dof)
-                                    scratch_qx[dof] = scratch_q0[dof];
-                            }
-                        } pResetQx = {bod, scratch_qx, scratch_q0};
-                        //
-                        struct
-                        {
-                            void operator()(btScalar dt, const btScalar* pDer, const btScalar* pCurVal, btScalar* pVal, int size)
-                            {
-                                for (int i = 0; i < size; ++i)
-                                    pVal[i] = pCurVal[i] + dt * pDer[i];
-                            }
-                            
-                        } pEulerIntegrate;
-                        //
-                        struct
-                        {
-                            void operator()(btMultiBody* pBody, const btScalar* pData)
-                            {
-                                btScalar* pVel = const_cast<btScalar*>(pBody->getVelocityVector());
-                                
-                                for (int i = 0; i < pBody->getNumDofs() + 6; ++i)
-                                    pVel[i] = pData[i];
-                            }
-                        } pCopyToVelocityVector;
-                        //
-                        struct
-                        {
-                            void operator()(const btScalar* pSrc, btScalar* pDst, int start, int size)
-                            {
-                                for (int i = 0; i < size; ++i)
-                                    pDst[i] = pSrc[start + i];
-                            }
-                        } pCopy;
-                        //
-                        
-                        btScalar h = solverInfo.m_timeStep;
-#define output &m_scratch_r[bod->getNumDofs()]
-                        //calc qdd0 from: q0 & qd0
-                        bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., m_scratch_r, m_scratch_v, m_scratch_m,
-                                                                                  isConstraintPass,getSolverInfo().m_jointFeedbackInWorldSpace,
-                                                                                  getSolverInfo().m_jointFeedbackInJointFrame);
-                        pCopy(output, scratch_qdd0, 0, numDofs);
-                        //calc q1 = q0 + h/2 * qd0
-                        pResetQx();
-                        bod->stepPositionsMultiDof(btScalar(.5) * h, scratch_qx, scratch_qd0);
-                        //calc qd1 = qd0 + h/2 * qdd0
-                        pEulerIntegrate(btScalar(.5) * h, scratch_qdd0, scratch_qd0, scratch_qd1, numDofs);
-                        //
-                        //calc qdd1 from: q1 & qd1
-                        pCopyToVelocityVector(bod, scratch_qd1);
-                        bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., m_scratch_r, m_scratch_v, m_scratch_m,
-                                                                                  isConstraintPass,getSolverInfo().m_jointFeedbackInWorldSpace,
-                                                                                  getSolverInfo().m_jointFeedbackInJointFrame);
-                        pCopy(output, scratch_qdd1, 0, numDofs);
-                        //calc q2 = q0 + h/2 * qd1
-                        pResetQx();
-                        bod->stepPositionsMultiDof(btScalar(.5) * h, scratch_qx, scratch_qd1);
-                        //calc qd2 = qd0 + h/2 * qdd1
-                        pEulerIntegrate(btScalar(.5) * h, scratch_qdd1, scratch_qd0, scratch_qd2, numDofs);
-                        //
-                        //calc qdd2 from: q2 & qd2
-                        pCopyToVelocityVector(bod, scratch_qd2);
-                        bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., m_scratch_r, m_scratch_v, m_scratch_m,
-                                                                                  isConstraintPass,getSolverInfo().m_jointFeedbackInWorldSpace,
-                                                                                  getSolverInfo().m_jointFeedbackInJointFrame);
-                        pCopy(output, scratch_qdd2, 0, numDofs);
-                        //calc q3 = q0 + h * qd2
-                        pResetQx();
-                        bod->stepPositionsMultiDof(h, scratch_qx, scratch_qd2);
-                        //calc qd3 = qd0 + h * qdd2
-                        pEulerIntegrate(h, scratch_qdd2, scratch_qd0, scratch_qd3, numDofs);
-                        //
-                        //calc qdd3 from: q3 & qd3
-                        pCopyToVelocityVector(bod, scratch_qd3);
-                        bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., m_scratch_r, m_scratch_v, m_scratch_m,
-                                                                                  isConstraintPass,getSolverInfo().m_jointFeedbackInWorldSpace,
-                                                                                  getSolverInfo().m_jointFeedbackInJointFrame);
-                        pCopy(output, scratch_qdd3, 0, numDofs);
-                        
-                        //
-                        //calc q = q0 + h/6(qd0 + 2*(qd1 + qd2) + qd3)
-                        //calc qd = qd0 + h/6(qdd0 + 2*(qdd1 + qdd2) + qdd3)
-                        btAlignedObjectArray<btScalar> delta_q;
-                        delta_q.resize(numDofs);
-                        btAlignedObjectArray<btScalar> delta_qd;
-                        delta_qd.resize(numDofs);
-                        for (int i = 0; i < numDofs; ++i)
+                    } pResetQx = {bod, scratch_qx, scratch_q0};
+                    //
+                    struct
+                    {
+                        void operator()(btScalar dt, const btScalar* pDer, const btScalar* pCurVal, btScalar* pVal, int size)
                         {
-                            delta_q[i] = h / btScalar(6.) * (scratch_qd0[i] + 2 * scratch_qd1[i] + 2 * scratch_qd2[i] + scratch_qd3[i]);
-                            delta_qd[i] = h / btScalar(6.) * (scratch_qdd0[i] + 2 * scratch_qdd1[i] + 2 * scratch_qdd2[i] + scratch_qdd3[i]);
-                            //delta_q[i] = h*scratch_qd0[i];
-                            //delta_qd[i] = h*scratch_qdd0[i];
+                            for (int i = 0; i < size; ++i)
+                                pVal[i] = pCurVal[i] + dt * pDer[i];
                         }
-                        //
-                        pCopyToVelocityVector(bod, scratch_qd0);
-                        bod->applyDeltaVeeMultiDof(&delta_qd[0], 1);
-                        //
-                        if (!doNotUpdatePos)
+                        
+                    } pEulerIntegrate;
+                    //
+                    struct
+                    {
+                        void operator()(btMultiBody* pBody, const btScalar* pData)
                         {
-                            btScalar* pRealBuf = const_cast<btScalar*>(bod->getVelocityVector());
-                            pRealBuf += 6 + bod->getNumDofs() + bod->getNumDofs() * bod->getNumDofs();
-                            
-                            for (int i = 0; i < numDofs; ++i)
-                                pRealBuf[i] = delta_q[i];
+                            btScalar* pVel = const_cast<btScalar*>(pBody->getVelocityVector());
                             
-                            //bod->stepPositionsMultiDof(1, 0, &delta_q[0]);
-                            bod->setPosUpdated(true);
+                            for (int i = 0; i < pBody->getNumDofs() + 6; ++i)
+                                pVel[i] = pData[i];
                         }
-                        
-                        //ugly hack which resets the cached data to t0 (needed for constraint solver)
+                    } pCopyToVelocityVector;
+                    //
+                    struct
+                    {
+                        void operator()(const btScalar* pSrc, btScalar* pDst, int start, int size)
                         {
-                            for (int link = 0; link < bod->getNumLinks(); ++link)
-                                bod->getLink(link).updateCacheMultiDof();
-                            bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0, m_scratch_r, m_scratch_v, m_scratch_m,
-                                                                                      isConstraintPass,getSolverInfo().m_jointFeedbackInWorldSpace,
-                                                                                      getSolverInfo().m_jointFeedbackInJointFrame);
+                            for (int i = 0; i < size; ++i)
+                                pDst[i] = pSrc[start + i];
                         }
+                    } pCopy;
+                    //
+                    
+                    btScalar h = solverInfo.m_timeStep;
+#define output &scratch_r[bod->getNumDofs()]
+                    //calc qdd0 from: q0 & qd0
+                    bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m,
+                                                                              isConstraintPass,getSolverInfo().m_jointFeedbackInWorldSpace,
+                                                                              getSolverInfo().m_jointFeedbackInJointFrame);
+                    pCopy(output, scratch_qdd0, 0, numDofs);
+                    //calc q1 = q0 + h/2 * qd0
+                    pResetQx();
+                    bod->stepPositionsMultiDof(btScalar(.5) * h, scratch_qx, scratch_qd0);
+                    //calc qd1 = qd0 + h/2 * qdd0
+                    pEulerIntegrate(btScalar(.5) * h, scratch_qdd0, scratch_qd0, scratch_qd1, numDofs);
+                    //
+                    //calc qdd1 from: q1 & qd1
+                    pCopyToVelocityVector(bod, scratch_qd1);
+                    bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m,
+                                                                              isConstraintPass,getSolverInfo().m_jointFeedbackInWorldSpace,
+                                                                              getSolverInfo().m_jointFeedbackInJointFrame);
+                    pCopy(output, scratch_qdd1, 0, numDofs);
+                    //calc q2 = q0 + h/2 * qd1
+                    pResetQx();
+                    bod->stepPositionsMultiDof(btScalar(.5) * h, scratch_qx, scratch_qd1);
+                    //calc qd2 = qd0 + h/2 * qdd1
+                    pEulerIntegrate(btScalar(.5) * h, scratch_qdd1, scratch_qd0, scratch_qd2, numDofs);
+                    //
+                    //calc qdd2 from: q2 & qd2
+                    pCopyToVelocityVector(bod, scratch_qd2);
+                    bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m,
+                                                                              isConstraintPass,getSolverInfo().m_jointFeedbackInWorldSpace,
+                                                                              getSolverInfo().m_jointFeedbackInJointFrame);
+                    pCopy(output, scratch_qdd2, 0, numDofs);
+                    //calc q3 = q0 + h * qd2
+                    pResetQx();
+                    bod->stepPositionsMultiDof(h, scratch_qx, scratch_qd2);
+                    //calc qd3 = qd0 + h * qdd2
+                    pEulerIntegrate(h, scratch_qdd2, scratch_qd0, scratch_qd3, numDofs);
+                    //
+                    //calc qdd3 from: q3 & qd3
+                    pCopyToVelocityVector(bod, scratch_qd3);
+                    bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m,
+                                                                              isConstraintPass,getSolverInfo().m_jointFeedbackInWorldSpace,
+                                                                              getSolverInfo().m_jointFeedbackInJointFrame);
+                    pCopy(output, scratch_qdd3, 0, numDofs);
+#undef output
+                    
+                    //
+                    //calc q = q0 + h/6(qd0 + 2*(qd1 + qd2) + qd3)
+                    //calc qd = qd0 + h/6(qdd0 + 2*(qdd1 + qdd2) + qdd3)
+                    btAlignedObjectArray<btScalar> delta_q;
+                    delta_q.resize(numDofs);
+                    btAlignedObjectArray<btScalar> delta_qd;
+                    delta_qd.resize(numDofs);
+                    for (int i = 0; i < numDofs; ++i)
+                    {
+                        delta_q[i] = h / btScalar(6.) * (scratch_qd0[i] + 2 * scratch_qd1[i] + 2 * scratch_qd2[i] + scratch_qd3[i]);
+                        delta_qd[i] = h / btScalar(6.) * (scratch_qdd0[i] + 2 * scratch_qdd1[i] + 2 * scratch_qdd2[i] + scratch_qdd3[i]);
+                        //delta_q[i] = h*scratch_qd0[i];
+                        //delta_qd[i] = h*scratch_qdd0[i];
+                    }
+                    //
+                    pCopyToVelocityVector(bod, scratch_qd0);
+                    bod->applyDeltaVeeMultiDof(&delta_qd[0], 1);
+                    //
+                    if (!doNotUpdatePos)
+                    {
+                        btScalar* pRealBuf = const_cast<btScalar*>(bod->getVelocityVector());
+                        pRealBuf += 6 + bod->getNumDofs() + bod->getNumDofs() * bod->getNumDofs();
+                        
+                        for (int i = 0; i < numDofs; ++i)
+                            pRealBuf[i] = delta_q[i];
+                        
+                        //bod->stepPositionsMultiDof(1, 0, &delta_q[0]);
+                        bod->setPosUpdated(true);
+                    }
+                    
+                    //ugly hack which resets the cached data to t0 (needed for constraint solver)
+                    {
+                        for (int link = 0; link < bod->getNumLinks(); ++link)
+                            bod->getLink(link).updateCacheMultiDof();
+                        bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0, scratch_r, scratch_v, scratch_m,
+                                                                                  isConstraintPass,getSolverInfo().m_jointFeedbackInWorldSpace,
+                                                                                  getSolverInfo().m_jointFeedbackInJointFrame);
                     }
                 }
-                
+            }
+            
 #ifndef BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
-                bod->clearForcesAndTorques();
+            bod->clearForcesAndTorques();
 #endif         //BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
-            }  //if (!isSleeping)
-        }
+        }  //if (!isSleeping)
     }
 }
 
@@ -582,27 +606,34 @@ void btMultiBodyDynamicsWorld::integrateMultiBodyTransforms(btScalar timeStep)
 {
 		BT_PROFILE("btMultiBody stepPositions");
 		//integrate and update the Featherstone hierarchies
+		if (m_multiBodies.size() > 0)
+		{
+			integrateMultiBodyTransformsInternal(&m_multiBodies[0], m_multiBodies.size(), timeStep, m_scratch_world_to_local, m_scratch_local_origin);
+		}
+}
 
-		for (int b = 0; b < m_multiBodies.size(); b++)
+void btMultiBodyDynamicsWorld::integrateMultiBodyTransformsInternal(btMultiBody** bodies, int numBodies, btScalar timeStep, btAlignedObjectArray<btQuaternion>& scratch_world_to_local, btAlignedObjectArray<btVector3>& scratch_local_origin)
+{
+	for (int b = 0; b < numBodies; b++)
+	{
+		btMultiBody* bod = bodies[b];
+		bool isSleeping = false;
+		if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
 		{
-			btMultiBody* bod = m_multiBodies[b];
-			bool isSleeping = false;
-			if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
-			{
+			isSleeping = true;
+		}
+		for (int b = 0; b < bod->getNumLinks(); b++)
+		{
+			if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState() == ISLAND_SLEEPING)
 				isSleeping = true;
-			}
-			for (int b = 0; b < bod->getNumLinks(); b++)
-			{
-				if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState() == ISLAND_SLEEPING)
-					isSleeping = true;
-			}
+		}
 
-			if (!isSleeping)
-			{
-				bod->addSplitV();
-				int nLinks = bod->getNumLinks();
+		if (!isSleeping)
+		{
+			bod->addSplitV();
+			int nLinks = bod->getNumLinks();
 
-				///base + num m_links
+			///base + num m_links
                 if (!bod->isPosUpdated())
                     bod->stepPositionsMultiDof(timeStep);
                 else
@@ -615,26 +646,33 @@ void btMultiBodyDynamicsWorld::integrateMultiBodyTransforms(btScalar timeStep)
                 }
 
 
-				m_scratch_world_to_local.resize(nLinks + 1);
-				m_scratch_local_origin.resize(nLinks + 1);
-                bod->updateCollisionObjectWorldTransforms(m_scratch_world_to_local, m_scratch_local_origin);
-				bod->substractSplitV();
-			}
-			else
-			{
-				bod->clearVelocities();
-			}
+			scratch_world_to_local.resize(nLinks + 1);
+			scratch_local_origin.resize(nLinks + 1);
+                bod->updateCollisionObjectWorldTransforms(scratch_world_to_local, scratch_local_origin);
+			bod->substractSplitV();
+		}
+		else
+		{
+			bod->clearVelocities();
 		}
+	}
 }
 
 void btMultiBodyDynamicsWorld::predictMultiBodyTransforms(btScalar timeStep)
 {
     BT_PROFILE("btMultiBody stepPositions");
     //integrate and update the Featherstone hierarchies
-    
-    for (int b = 0; b < m_multiBodies.size(); b++)
+    if (m_multiBodies.size() > 0)
+    {
+        predictMultiBodyTransformsInternal(&m_multiBodies[0], m_multiBodies.size(), timeStep, m_scratch_world_to_local, m_scratch_local_origin);
+    }
+}
+
+void btMultiBodyDynamicsWorld::predictMultiBodyTransformsInternal(btMultiBody** bodies, int numBodies, btScalar timeStep, btAlignedObjectArray<btQuaternion>& scratch_world_to_local, btAlignedObjectArray<btVector3>& scratch_local_origin)
+{
+    for (int b = 0; b < numBodies; b++)
     {
-        btMultiBody* bod = m_multiBodies[b];
+        btMultiBody* bod = bodies[b];
         bool isSleeping = false;
         if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
         {
@@ -650,9 +688,9 @@ void btMultiBodyDynamicsWorld::predictMultiBodyTransforms(btScalar timeStep)
         {
             int nLinks = bod->getNumLinks();
             bod->predictPositionsMultiDof(timeStep);
-            m_scratch_world_to_local.resize(nLinks + 1);
-            m_scratch_local_origin.resize(nLinks + 1);
-            bod->updateCollisionObjectInterpolationWorldTransforms(m_scratch_world_to_local, m_scratch_local_origin);
+            scratch_world_to_local.resize(nLinks + 1);
+            scratch_local_origin.resize(nLinks + 1);
+            bod->updateCollisionObjectInterpolationWorldTransforms(scratch_world_to_local, scratch_local_origin);
         }
         else
         {
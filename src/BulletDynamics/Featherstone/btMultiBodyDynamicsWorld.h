@@ -48,7 +48,16 @@ protected:
 
 	virtual void calculateSimulationIslands();
 	virtual void updateActivationState(btScalar timeStep);
-	
+
+	// these iterate over a range of multibodies with the given scratch arrays, so they can be called in parallel
+	void forwardKinematicsInternal(btMultiBody** bodies, int numBodies, btAlignedObjectArray<btQuaternion>& scratch_world_to_local, btAlignedObjectArray<btVector3>& scratch_local_origin);
+	void stepMultiBodyVelocitiesInternal(btMultiBody** bodies, int numBodies, const btContactSolverInfo& solverInfo, btAlignedObjectArray<btScalar>& scratch_r, btAlignedObjectArray<btVector3>& scratch_v, btAlignedObjectArray<btMatrix3x3>& scratch_m);
+	void applyMultiBodyDeltaVeeInternal(btMultiBody** bodies, int numBodies, const btContactSolverInfo& solverInfo, btAlignedObjectArray<btScalar>& scratch_r, btAlignedObjectArray<btVector3>& scratch_v, btAlignedObjectArray<btMatrix3x3>& scratch_m);
+	void integrateMultiBodyTransformsInternal(btMultiBody** bodies, int numBodies, btScalar timeStep, btAlignedObjectArray<btQuaternion>& scratch_world_to_local, btAlignedObjectArray<btVector3>& scratch_local_origin);
+	void predictMultiBodyTransformsInternal(btMultiBody** bodies, int numBodies, btScalar timeStep, btAlignedObjectArray<btQuaternion>& scratch_world_to_local, btAlignedObjectArray<btVector3>& scratch_local_origin);
+
+	virtual void stepMultiBodyVelocities(btContactSolverInfo& solverInfo);
+
 
 	virtual void serializeMultiBodies(btSerializer* serializer);
 
@@ -106,7 +115,7 @@ public:
 
 	virtual void debugDrawMultiBodyConstraint(btMultiBodyConstraint* constraint);
 
-	void forwardKinematics();
+	virtual void forwardKinematics();
 	virtual void clearForces();
 	virtual void clearMultiBodyConstraintForces();
 	virtual void clearMultiBodyForces();
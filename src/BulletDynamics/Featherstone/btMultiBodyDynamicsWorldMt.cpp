@@ -0,0 +1,546 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btMultiBodyDynamicsWorldMt.h"
+#include "btMultiBody.h"
+#include "btMultiBodyLinkCollider.h"
+#include "btMultiBodyConstraint.h"
+#include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "LinearMath/btQuickprof.h"
+
+///
+/// btMultiBodyConstraintSolverPoolMt
+///
+
+btMultiBodyConstraintSolverPoolMt::ThreadSolver* btMultiBodyConstraintSolverPoolMt::getAndLockThreadSolver()
+{
+	int i = 0;
+#if BT_THREADSAFE
+	i = btGetCurrentThreadIndex() % m_solvers.size();
+#endif  // #if BT_THREADSAFE
+	while (true)
+	{
+		ThreadSolver& solver = m_solvers[i];
+		if (solver.mutex.tryLock())
+		{
+			return &solver;
+		}
+		// failed, try the next one
+		i = (i + 1) % m_solvers.size();
+	}
+	return NULL;
+}
+
+void btMultiBodyConstraintSolverPoolMt::init(btMultiBodyConstraintSolver** solvers, int numSolvers)
+{
+	m_solvers.resize(numSolvers);
+	for (int i = 0; i < numSolvers; ++i)
+	{
+		m_solvers[i].solver = solvers[i];
+	}
+}
+
+// create the solvers for me
+btMultiBodyConstraintSolverPoolMt::btMultiBodyConstraintSolverPoolMt(int numSolvers)
+{
+	btAlignedObjectArray<btMultiBodyConstraintSolver*> solvers;
+	solvers.reserve(numSolvers);
+	for (int i = 0; i < numSolvers; ++i)
+	{
+		btMultiBodyConstraintSolver* solver = new btMultiBodyConstraintSolver();
+		solvers.push_back(solver);
+	}
+	init(&solvers[0], numSolvers);
+}
+
+// pass in fully constructed solvers (destructor will delete them)
+btMultiBodyConstraintSolverPoolMt::btMultiBodyConstraintSolverPoolMt(btMultiBodyConstraintSolver** solvers, int numSolvers)
+{
+	init(solvers, numSolvers);
+}
+
+btMultiBodyConstraintSolverPoolMt::~btMultiBodyConstraintSolverPoolMt()
+{
+	// delete all solvers
+	for (int i = 0; i < m_solvers.size(); ++i)
+	{
+		ThreadSolver& solver = m_solvers[i];
+		delete solver.solver;
+		solver.solver = NULL;
+	}
+}
+
+btScalar btMultiBodyConstraintSolverPoolMt::solveGroup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifold, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btDispatcher* dispatcher)
+{
+	ThreadSolver* ts = getAndLockThreadSolver();
+	ts->solver->solveGroup(bodies, numBodies, manifold, numManifolds, constraints, numConstraints, info, debugDrawer, dispatcher);
+	ts->mutex.unlock();
+	return 0.0f;
+}
+
+void btMultiBodyConstraintSolverPoolMt::solveMultiBodyGroup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifold, int numManifolds, btTypedConstraint** constraints, int numConstraints, btMultiBodyConstraint** multiBodyConstraints, int numMultiBodyConstraints, const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btDispatcher* dispatcher)
+{
+	// the analytics of the pool are only meaningful when it is called from one thread, like MultiBodyInplaceSolverIslandCallback does
+	solveMultiBodyGroup(bodies, numBodies, manifold, numManifolds, constraints, numConstraints, multiBodyConstraints, numMultiBodyConstraints, info, debugDrawer, dispatcher, m_analyticsData);
+}
+
+void btMultiBodyConstraintSolverPoolMt::solveMultiBodyGroup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifold, int numManifolds, btTypedConstraint** constraints, int numConstraints, btMultiBodyConstraint** multiBodyConstraints, int numMultiBodyConstraints, const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btDispatcher* dispatcher, btSolverAnalyticsData& analyticsData)
+{
+	ThreadSolver* ts = getAndLockThreadSolver();
+	ts->solver->solveMultiBodyGroup(bodies, numBodies, manifold, numManifolds, constraints, numConstraints, multiBodyConstraints, numMultiBodyConstraints, info, debugDrawer, dispatcher);
+	if (info.m_reportSolverAnalytics & 1)
+	{
+		analyticsData = ts->solver->m_analyticsData;
+	}
+	ts->mutex.unlock();
+}
+
+void btMultiBodyConstraintSolverPoolMt::reset()
+{
+	for (int i = 0; i < m_solvers.size(); ++i)
+	{
+		ThreadSolver& solver = m_solvers[i];
+		solver.mutex.lock();
+		solver.solver->reset();
+		solver.mutex.unlock();
+	}
+}
+
+///
+/// MultiBodySolverIslandCallbackMt
+///
+
+// first constraint of the island in the constraints sorted by island, or numConstraints if there is none
+static int btFindFirstConstraintOfIsland(btTypedConstraint** sortedConstraints, int numConstraints, int islandId)
+{
+	int lo = 0;
+	int hi = numConstraints;
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (btGetConstraintIslandId2(sortedConstraints[mid]) < islandId)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static int btFindFirstMultiBodyConstraintOfIsland(btMultiBodyConstraint** sortedConstraints, int numConstraints, int islandId)
+{
+	int lo = 0;
+	int hi = numConstraints;
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (btGetMultiBodyConstraintIslandId(sortedConstraints[mid]) < islandId)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// whether a contact with the collider reaches a multibody that can be in another island
+static bool btIsSharedMultiBodyCollider(const btCollisionObject* colObj)
+{
+	return colObj->isStaticOrKinematicObject() && btMultiBodyLinkCollider::upcast(colObj) != NULL;
+}
+
+static bool btManifoldSharesMultiBodies(const btPersistentManifold* manifold)
+{
+	return btIsSharedMultiBodyCollider(manifold->getBody0()) || btIsSharedMultiBodyCollider(manifold->getBody1());
+}
+
+static bool btMultiBodyConstraintSharesMultiBodies(btMultiBodyConstraint* constraint)
+{
+	return (constraint->getMultiBodyA() && constraint->getIslandIdA() < 0) || (constraint->getMultiBodyB() && constraint->getIslandIdB() < 0);
+}
+
+MultiBodySolverIslandCallbackMt::MultiBodySolverIslandCallbackMt(btMultiBodyConstraintSolverPoolMt* solverPool, btDispatcher* dispatcher)
+	: MultiBodyInplaceSolverIslandCallback(solverPool, dispatcher),
+	  m_solverPool(solverPool)
+{
+	openBatch();
+}
+
+void MultiBodySolverIslandCallbackMt::setup(btContactSolverInfo* solverInfo, btTypedConstraint** sortedConstraints, int numConstraints, btMultiBodyConstraint** sortedMultiBodyConstraints, int numMultiBodyConstraints, btIDebugDraw* debugDrawer)
+{
+	MultiBodyInplaceSolverIslandCallback::setup(solverInfo, sortedConstraints, numConstraints, sortedMultiBodyConstraints, numMultiBodyConstraints, debugDrawer);
+	m_softBodies.resize(0);
+	m_batches.resize(0);
+	openBatch();
+}
+
+void MultiBodySolverIslandCallbackMt::closeBatch(int islandId)
+{
+	Batch& batch = m_openBatch;
+	batch.m_islandId = islandId;
+	batch.m_numBodies = m_bodies.size() - batch.m_bodyBegin;
+	batch.m_numManifolds = m_manifolds.size() - batch.m_manifoldBegin;
+	batch.m_numConstraints = m_constraints.size() - batch.m_constraintBegin;
+	batch.m_numMultiBodyConstraints = m_multiBodyConstraints.size() - batch.m_multiBodyConstraintBegin;
+	m_batches.push_back(batch);
+	openBatch();
+}
+
+void MultiBodySolverIslandCallbackMt::openBatch()
+{
+	Batch& batch = m_openBatch;
+	batch.m_islandId = -1;
+	batch.m_bodyBegin = m_bodies.size();
+	batch.m_manifoldBegin = m_manifolds.size();
+	batch.m_constraintBegin = m_constraints.size();
+	batch.m_multiBodyConstraintBegin = m_multiBodyConstraints.size();
+	batch.m_numBodies = 0;
+	batch.m_numManifolds = 0;
+	batch.m_numConstraints = 0;
+	batch.m_numMultiBodyConstraints = 0;
+	batch.m_sharesMultiBodies = false;
+}
+
+void MultiBodySolverIslandCallbackMt::processIsland(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifolds, int numManifolds, int islandId)
+{
+	int i;
+	int firstConstraint = 0;
+	int numCurConstraints = 0;
+	int firstMultiBodyConstraint = 0;
+	int numCurMultiBodyConstraints = 0;
+	if (islandId < 0)
+	{
+		///we don't split islands, so all constraints/contact manifolds/bodies are passed into the solver regardless the island id
+		numCurConstraints = m_numConstraints;
+		numCurMultiBodyConstraints = m_numMultiBodyConstraints;
+	}
+	else
+	{
+		//the constraints are sorted by island, so the constraints of this island are a range of them
+		firstConstraint = btFindFirstConstraintOfIsland(m_sortedConstraints, m_numConstraints, islandId);
+		for (i = firstConstraint; i < m_numConstraints && btGetConstraintIslandId2(m_sortedConstraints[i]) == islandId; i++)
+		{
+			numCurConstraints++;
+		}
+		firstMultiBodyConstraint = btFindFirstMultiBodyConstraintOfIsland(m_multiBodySortedConstraints, m_numMultiBodyConstraints, islandId);
+		for (i = firstMultiBodyConstraint; i < m_numMultiBodyConstraints && btGetMultiBodyConstraintIslandId(m_multiBodySortedConstraints[i]) == islandId; i++)
+		{
+			numCurMultiBodyConstraints++;
+		}
+	}
+
+	for (i = 0; i < numBodies; i++)
+	{
+		bool isSoftBodyType = (bodies[i]->getInternalType() & btCollisionObject::CO_SOFT_BODY);
+		if (!isSoftBodyType)
+		{
+			m_bodies.push_back(bodies[i]);
+		}
+		else
+		{
+			m_softBodies.push_back(bodies[i]);
+		}
+	}
+	for (i = 0; i < numManifolds; i++)
+	{
+		m_manifolds.push_back(manifolds[i]);
+		if (btManifoldSharesMultiBodies(manifolds[i]))
+		{
+			m_openBatch.m_sharesMultiBodies = true;
+		}
+	}
+	for (i = 0; i < numCurConstraints; i++)
+	{
+		m_constraints.push_back(m_sortedConstraints[firstConstraint + i]);
+	}
+	for (i = 0; i < numCurMultiBodyConstraints; i++)
+	{
+		btMultiBodyConstraint* constraint = m_multiBodySortedConstraints[firstMultiBodyConstraint + i];
+		m_multiBodyConstraints.push_back(constraint);
+		if (btMultiBodyConstraintSharesMultiBodies(constraint))
+		{
+			m_openBatch.m_sharesMultiBodies = true;
+		}
+	}
+
+	if (islandId < 0)
+	{
+		closeBatch(islandId);
+	}
+	else
+	{
+		//only close the batch once it is big enough, like MultiBodyInplaceSolverIslandCallback does
+		int numRows = (m_multiBodyConstraints.size() - m_openBatch.m_multiBodyConstraintBegin) + (m_constraints.size() - m_openBatch.m_constraintBegin) + (m_manifolds.size() - m_openBatch.m_manifoldBegin);
+		if (numRows > m_solverInfo->m_minimumSolverBatchSize)
+		{
+			closeBatch(islandId);
+		}
+	}
+}
+
+void MultiBodySolverIslandCallbackMt::solveBatch(int iBatch)
+{
+	const Batch& batch = m_batches[iBatch];
+	btCollisionObject** bodies = batch.m_numBodies ? &m_bodies[batch.m_bodyBegin] : 0;
+	btPersistentManifold** manifold = batch.m_numManifolds ? &m_manifolds[batch.m_manifoldBegin] : 0;
+	btTypedConstraint** constraints = batch.m_numConstraints ? &m_constraints[batch.m_constraintBegin] : 0;
+	btMultiBodyConstraint** multiBodyConstraints = batch.m_numMultiBodyConstraints ? &m_multiBodyConstraints[batch.m_multiBodyConstraintBegin] : 0;
+
+	if (m_solver == m_solverPool)
+	{
+		m_solverPool->solveMultiBodyGroup(bodies, batch.m_numBodies, manifold, batch.m_numManifolds, constraints, batch.m_numConstraints, multiBodyConstraints, batch.m_numMultiBodyConstraints, *m_solverInfo, m_debugDrawer, m_dispatcher, m_batchAnalyticsData[iBatch]);
+	}
+	else
+	{
+		m_solver->solveMultiBodyGroup(bodies, batch.m_numBodies, manifold, batch.m_numManifolds, constraints, batch.m_numConstraints, multiBodyConstraints, batch.m_numMultiBodyConstraints, *m_solverInfo, m_debugDrawer, m_dispatcher);
+		m_batchAnalyticsData[iBatch] = m_solver->m_analyticsData;
+	}
+	m_batchAnalyticsData[iBatch].m_islandId = batch.m_islandId;
+}
+
+struct SolveMultiBodyBatchesLoop : public btIParallelForBody
+{
+	MultiBodySolverIslandCallbackMt* m_callback;
+	const btAlignedObjectArray<int>& m_batchIndices;
+
+	SolveMultiBodyBatchesLoop(MultiBodySolverIslandCallbackMt* callback, const btAlignedObjectArray<int>& batchIndices) : m_callback(callback), m_batchIndices(batchIndices) {}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_callback->solveBatch(m_batchIndices[i]);
+		}
+	}
+};
+
+void MultiBodySolverIslandCallbackMt::processConstraints(int islandId)
+{
+	//the last batch is solved even when it is smaller than the minimum batch size
+	if (m_bodies.size() > m_openBatch.m_bodyBegin || m_manifolds.size() > m_openBatch.m_manifoldBegin ||
+		m_constraints.size() > m_openBatch.m_constraintBegin || m_multiBodyConstraints.size() > m_openBatch.m_multiBodyConstraintBegin)
+	{
+		closeBatch(islandId);
+	}
+
+	m_batchAnalyticsData.resize(m_batches.size());
+	m_parallelBatches.resize(0);
+	for (int i = 0; i < m_batches.size(); i++)
+	{
+		if (!m_batches[i].m_sharesMultiBodies)
+		{
+			m_parallelBatches.push_back(i);
+		}
+	}
+
+	if (m_solver == m_solverPool && m_parallelBatches.size() > 1)
+	{
+		BT_PROFILE("solveMultiBodyBatchesParallel");
+		SolveMultiBodyBatchesLoop loop(this, m_parallelBatches);
+		int grainSize = 1;
+		btParallelFor(0, m_parallelBatches.size(), grainSize, loop);
+	}
+	else
+	{
+		for (int i = 0; i < m_parallelBatches.size(); i++)
+		{
+			solveBatch(m_parallelBatches[i]);
+		}
+	}
+	//batches that reach multibodies of other islands are solved in order after the others
+	for (int i = 0; i < m_batches.size(); i++)
+	{
+		if (m_batches[i].m_sharesMultiBodies)
+		{
+			solveBatch(i);
+		}
+	}
+
+	if (m_solverInfo->m_reportSolverAnalytics & 1)
+	{
+		for (int i = 0; i < m_batches.size(); i++)
+		{
+			if (m_batches[i].m_numBodies)
+			{
+				m_islandAnalyticsData.push_back(m_batchAnalyticsData[i]);
+			}
+		}
+	}
+
+	m_batches.resize(0);
+	m_bodies.resize(0);
+	m_softBodies.resize(0);
+	m_manifolds.resize(0);
+	m_constraints.resize(0);
+	m_multiBodyConstraints.resize(0);
+	openBatch();
+}
+
+///
+/// btMultiBodyDynamicsWorldMt
+///
+
+btMultiBodyDynamicsWorldMt::btMultiBodyDynamicsWorldMt(btDispatcher* dispatcher,
+													   btBroadphaseInterface* pairCache,
+													   btMultiBodyConstraintSolverPoolMt* solverPool,
+													   btCollisionConfiguration* collisionConfiguration)
+	: btMultiBodyDynamicsWorld(dispatcher, pairCache, solverPool, collisionConfiguration)
+{
+	delete m_solverMultiBodyIslandCallback;
+	m_solverMultiBodyIslandCallback = new MultiBodySolverIslandCallbackMt(solverPool, dispatcher);
+#if BT_THREADSAFE
+	m_threadScratch.resize(BT_MAX_THREAD_COUNT);
+#else
+	m_threadScratch.resize(1);
+#endif
+}
+
+btMultiBodyDynamicsWorldMt::~btMultiBodyDynamicsWorldMt()
+{
+}
+
+void btMultiBodyDynamicsWorldMt::forwardKinematics()
+{
+	if (m_multiBodies.size() > 0)
+	{
+		UpdaterForwardKinematics update;
+		update.world = this;
+		update.multiBodies = &m_multiBodies[0];
+		int grainSize = 8;  // num of iterations per task for task scheduler
+		btParallelFor(0, m_multiBodies.size(), grainSize, update);
+	}
+}
+
+void btMultiBodyDynamicsWorldMt::stepMultiBodyVelocities(btContactSolverInfo& solverInfo)
+{
+	BT_PROFILE("btMultiBody stepVelocities");
+	if (m_multiBodies.size() > 0)
+	{
+		UpdaterStepMultiBodyVelocities update;
+		update.world = this;
+		update.solverInfo = &solverInfo;
+		update.multiBodies = &m_multiBodies[0];
+		int grainSize = 4;  // num of iterations per task for task scheduler
+		btParallelFor(0, m_multiBodies.size(), grainSize, update);
+	}
+}
+
+void btMultiBodyDynamicsWorldMt::solveInternalConstraints(btContactSolverInfo& solverInfo)
+{
+	/// solve all the constraints for this island
+	m_solverMultiBodyIslandCallback->processConstraints();
+	m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
+	{
+		BT_PROFILE("btMultiBody stepVelocities");
+		if (m_multiBodies.size() > 0)
+		{
+			UpdaterApplyMultiBodyDeltaVee update;
+			update.world = this;
+			update.solverInfo = &solverInfo;
+			update.multiBodies = &m_multiBodies[0];
+			int grainSize = 8;  // num of iterations per task for task scheduler
+			btParallelFor(0, m_multiBodies.size(), grainSize, update);
+		}
+	}
+}
+
+void btMultiBodyDynamicsWorldMt::predictUnconstraintMotion(btScalar timeStep)
+{
+	{
+		BT_PROFILE("predictUnconstraintMotion");
+		if (m_nonStaticRigidBodies.size() > 0)
+		{
+			UpdaterUnconstrainedMotion update;
+			update.timeStep = timeStep;
+			update.rigidBodies = &m_nonStaticRigidBodies[0];
+			int grainSize = 50;  // num of iterations per task for task scheduler
+			btParallelFor(0, m_nonStaticRigidBodies.size(), grainSize, update);
+		}
+	}
+	{
+		BT_PROFILE("btMultiBody stepPositions");
+		if (m_multiBodies.size() > 0)
+		{
+			UpdaterPredictMultiBodyTransforms update;
+			update.world = this;
+			update.timeStep = timeStep;
+			update.multiBodies = &m_multiBodies[0];
+			int grainSize = 8;  // num of iterations per task for task scheduler
+			btParallelFor(0, m_multiBodies.size(), grainSize, update);
+		}
+	}
+}
+
+void btMultiBodyDynamicsWorldMt::createPredictiveContacts(btScalar timeStep)
+{
+	BT_PROFILE("createPredictiveContacts");
+	releasePredictiveContacts();
+	if (m_ccdBatch)
+	{
+		createPredictiveContactsBatched(timeStep);
+	}
+	else if (m_nonStaticRigidBodies.size() > 0)
+	{
+		UpdaterCreatePredictiveContacts update;
+		update.world = this;
+		update.timeStep = timeStep;
+		update.rigidBodies = &m_nonStaticRigidBodies[0];
+		int grainSize = 50;  // num of iterations per task for task scheduler
+		btParallelFor(0, m_nonStaticRigidBodies.size(), grainSize, update);
+	}
+}
+
+void btMultiBodyDynamicsWorldMt::integrateTransforms(btScalar timeStep)
+{
+	{
+		BT_PROFILE("integrateTransforms");
+		if (m_ccdBatch)
+		{
+			sweepCcdBodies(timeStep);
+		}
+		if (m_nonStaticRigidBodies.size() > 0)
+		{
+			UpdaterIntegrateTransforms update;
+			update.world = this;
+			update.timeStep = timeStep;
+			update.rigidBodies = &m_nonStaticRigidBodies[0];
+			int grainSize = 50;  // num of iterations per task for task scheduler
+			btParallelFor(0, m_nonStaticRigidBodies.size(), grainSize, update);
+		}
+	}
+	{
+		BT_PROFILE("btMultiBody stepPositions");
+		//integrate and update the Featherstone hierarchies
+		if (m_multiBodies.size() > 0)
+		{
+			UpdaterIntegrateMultiBodyTransforms update;
+			update.world = this;
+			update.timeStep = timeStep;
+			update.multiBodies = &m_multiBodies[0];
+			int grainSize = 8;  // num of iterations per task for task scheduler
+			btParallelFor(0, m_multiBodies.size(), grainSize, update);
+		}
+	}
+}
+
+int btMultiBodyDynamicsWorldMt::stepSimulation(btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep)
+{
+	int numSubSteps = btMultiBodyDynamicsWorld::stepSimulation(timeStep, maxSubSteps, fixedTimeStep);
+	if (btITaskScheduler* scheduler = btGetTaskScheduler())
+	{
+		// tell Bullet's threads to sleep, so other threads can run
+		scheduler->sleepWorkerThreadsHint();
+	}
+	return numSubSteps;
+}
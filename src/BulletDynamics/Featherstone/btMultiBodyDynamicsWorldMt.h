@@ -0,0 +1,276 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_MULTIBODY_DYNAMICS_WORLD_MT_H
+#define BT_MULTIBODY_DYNAMICS_WORLD_MT_H
+
+#include "btMultiBodyDynamicsWorld.h"
+#include "btMultiBodyConstraintSolver.h"
+#include "btMultiBodyInplaceSolverIslandCallback.h"
+#include "LinearMath/btThreads.h"
+
+///
+/// btMultiBodyConstraintSolverPoolMt - like btConstraintSolverPoolMt, a threadsafe pool of multibody constraint solvers.
+///
+///  Each solver in the pool is protected by a mutex. When a group is solved from a thread, the pool locks a solver
+///  that isn't being used by another thread and dispatches the call to it.
+///
+ATTRIBUTE_ALIGNED16(class)
+btMultiBodyConstraintSolverPoolMt : public btMultiBodyConstraintSolver
+{
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	// create the solvers for me
+	explicit btMultiBodyConstraintSolverPoolMt(int numSolvers);
+
+	// pass in fully constructed solvers (destructor will delete them)
+	btMultiBodyConstraintSolverPoolMt(btMultiBodyConstraintSolver * *solvers, int numSolvers);
+
+	virtual ~btMultiBodyConstraintSolverPoolMt();
+
+	virtual btScalar solveGroup(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifold, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btDispatcher* dispatcher) BT_OVERRIDE;
+
+	virtual void solveMultiBodyGroup(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifold, int numManifolds, btTypedConstraint** constraints, int numConstraints, btMultiBodyConstraint** multiBodyConstraints, int numMultiBodyConstraints, const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btDispatcher* dispatcher) BT_OVERRIDE;
+
+	// same as above, and copies the analytics of the solver that solved the group, so it can be called from several threads
+	void solveMultiBodyGroup(btCollisionObject * *bodies, int numBodies, btPersistentManifold** manifold, int numManifolds, btTypedConstraint** constraints, int numConstraints, btMultiBodyConstraint** multiBodyConstraints, int numMultiBodyConstraints, const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btDispatcher* dispatcher, btSolverAnalyticsData& analyticsData);
+
+	virtual void reset() BT_OVERRIDE;
+
+private:
+	const static size_t kCacheLineSize = 128;
+	struct ThreadSolver
+	{
+		btMultiBodyConstraintSolver* solver;
+		btSpinMutex mutex;
+		char _cachelinePadding[kCacheLineSize - sizeof(btSpinMutex) - sizeof(void*)];  // keep mutexes from sharing a cache line
+	};
+	btAlignedObjectArray<ThreadSolver> m_solvers;
+
+	ThreadSolver* getAndLockThreadSolver();
+	void init(btMultiBodyConstraintSolver** solvers, int numSolvers);
+};
+
+///
+/// MultiBodySolverIslandCallbackMt - collects the islands into batches like MultiBodyInplaceSolverIslandCallback,
+///                                    and solves the batches in parallel when the constraints are processed.
+///
+///  The solver writes to every multibody that a contact or multibody constraint touches. A multibody can be reached
+///  through a static or kinematic link collider from other islands than its own, so batches with such contacts or
+///  constraints are solved in one thread after the others, in the order of the batches.
+///
+struct MultiBodySolverIslandCallbackMt : public MultiBodyInplaceSolverIslandCallback
+{
+	struct Batch
+	{
+		int m_islandId;
+		int m_bodyBegin;
+		int m_manifoldBegin;
+		int m_constraintBegin;
+		int m_multiBodyConstraintBegin;
+		int m_numBodies;
+		int m_numManifolds;
+		int m_numConstraints;
+		int m_numMultiBodyConstraints;
+		bool m_sharesMultiBodies;  // whether its islands reach multibodies of other islands
+	};
+
+	btMultiBodyConstraintSolverPoolMt* m_solverPool;
+
+	btAlignedObjectArray<Batch> m_batches;
+	btAlignedObjectArray<int> m_parallelBatches;
+	btAlignedObjectArray<btSolverAnalyticsData> m_batchAnalyticsData;
+	Batch m_openBatch;  // the islands that are collected but not yet in m_batches
+
+	MultiBodySolverIslandCallbackMt(btMultiBodyConstraintSolverPoolMt* solverPool, btDispatcher* dispatcher);
+
+	virtual void setup(btContactSolverInfo* solverInfo, btTypedConstraint** sortedConstraints, int numConstraints, btMultiBodyConstraint** sortedMultiBodyConstraints, int numMultiBodyConstraints, btIDebugDraw* debugDrawer) BT_OVERRIDE;
+
+	virtual void processIsland(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifolds, int numManifolds, int islandId) BT_OVERRIDE;
+
+	virtual void processConstraints(int islandId = -1) BT_OVERRIDE;
+
+	void openBatch();
+	void closeBatch(int islandId);
+	void solveBatch(int iBatch);
+};
+
+///
+/// btMultiBodyDynamicsWorldMt -- a version of btMultiBodyDynamicsWorld that steps the multibodies and solves the
+///                                simulation islands on multiple threads.
+///
+///  Steps the same scene as btMultiBodyDynamicsWorld. The loops over the multibodies run in parallel, each
+///  thread with its own scratch arrays:
+///     - forwardKinematics
+///     - the articulated body algorithm of stepVelocities, and the joint feedback after the solver
+///     - integrateMultiBodyTransforms and predictMultiBodyTransforms
+///  The rigid bodies are predicted and integrated in parallel like in btDiscreteDynamicsWorldMt.
+///
+///  The islands are batched like in btMultiBodyDynamicsWorld, and the batches are solved in parallel with the solvers
+///  of the pool. The batches that reach multibodies of other islands are solved after the others, in batch order, so
+///  the islands can be solved in another order than btMultiBodyDynamicsWorld and the results can differ slightly from
+///  it. They do not depend on the number of threads.
+///
+ATTRIBUTE_ALIGNED16(class)
+btMultiBodyDynamicsWorldMt : public btMultiBodyDynamicsWorld
+{
+protected:
+	struct ThreadScratch
+	{
+		btAlignedObjectArray<btQuaternion> m_worldToLocal;
+		btAlignedObjectArray<btVector3> m_localOrigin;
+		btAlignedObjectArray<btScalar> m_r;
+		btAlignedObjectArray<btVector3> m_v;
+		btAlignedObjectArray<btMatrix3x3> m_m;
+	};
+	btAlignedObjectArray<ThreadScratch> m_threadScratch;
+
+	ThreadScratch& getThreadScratch()
+	{
+		return m_threadScratch[btGetCurrentThreadIndex()];
+	}
+
+	struct UpdaterUnconstrainedMotion : public btIParallelForBody
+	{
+		btScalar timeStep;
+		btRigidBody** rigidBodies;
+
+		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+		{
+			for (int i = iBegin; i < iEnd; ++i)
+			{
+				btRigidBody* body = rigidBodies[i];
+				if (!body->isStaticOrKinematicObject())
+				{
+					//don't integrate/update velocities here, it happens in the constraint solver
+					body->applyDamping(timeStep);
+					body->predictIntegratedTransform(timeStep, body->getInterpolationWorldTransform());
+				}
+			}
+		}
+	};
+
+	struct UpdaterCreatePredictiveContacts : public btIParallelForBody
+	{
+		btScalar timeStep;
+		btRigidBody** rigidBodies;
+		btMultiBodyDynamicsWorldMt* world;
+
+		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+		{
+			world->createPredictiveContactsInternal(&rigidBodies[iBegin], iEnd - iBegin, timeStep);
+		}
+	};
+	virtual void createPredictiveContacts(btScalar timeStep) BT_OVERRIDE;
+
+	struct UpdaterIntegrateTransforms : public btIParallelForBody
+	{
+		btScalar timeStep;
+		btRigidBody** rigidBodies;
+		btMultiBodyDynamicsWorldMt* world;
+
+		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+		{
+			world->integrateTransformsInternal(&rigidBodies[iBegin], iEnd - iBegin, timeStep);
+		}
+	};
+
+	struct UpdaterForwardKinematics : public btIParallelForBody
+	{
+		btMultiBody** multiBodies;
+		btMultiBodyDynamicsWorldMt* world;
+
+		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+		{
+			ThreadScratch& scratch = world->getThreadScratch();
+			world->forwardKinematicsInternal(&multiBodies[iBegin], iEnd - iBegin, scratch.m_worldToLocal, scratch.m_localOrigin);
+		}
+	};
+
+	struct UpdaterStepMultiBodyVelocities : public btIParallelForBody
+	{
+		const btContactSolverInfo* solverInfo;
+		btMultiBody** multiBodies;
+		btMultiBodyDynamicsWorldMt* world;
+
+		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+		{
+			ThreadScratch& scratch = world->getThreadScratch();
+			world->stepMultiBodyVelocitiesInternal(&multiBodies[iBegin], iEnd - iBegin, *solverInfo, scratch.m_r, scratch.m_v, scratch.m_m);
+		}
+	};
+	virtual void stepMultiBodyVelocities(btContactSolverInfo & solverInfo) BT_OVERRIDE;
+
+	struct UpdaterApplyMultiBodyDeltaVee : public btIParallelForBody
+	{
+		const btContactSolverInfo* solverInfo;
+		btMultiBody** multiBodies;
+		btMultiBodyDynamicsWorldMt* world;
+
+		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+		{
+			ThreadScratch& scratch = world->getThreadScratch();
+			world->applyMultiBodyDeltaVeeInternal(&multiBodies[iBegin], iEnd - iBegin, *solverInfo, scratch.m_r, scratch.m_v, scratch.m_m);
+		}
+	};
+
+	struct UpdaterIntegrateMultiBodyTransforms : public btIParallelForBody
+	{
+		btScalar timeStep;
+		btMultiBody** multiBodies;
+		btMultiBodyDynamicsWorldMt* world;
+
+		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+		{
+			ThreadScratch& scratch = world->getThreadScratch();
+			world->integrateMultiBodyTransformsInternal(&multiBodies[iBegin], iEnd - iBegin, timeStep, scratch.m_worldToLocal, scratch.m_localOrigin);
+		}
+	};
+
+	struct UpdaterPredictMultiBodyTransforms : public btIParallelForBody
+	{
+		btScalar timeStep;
+		btMultiBody** multiBodies;
+		btMultiBodyDynamicsWorldMt* world;
+
+		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+		{
+			ThreadScratch& scratch = world->getThreadScratch();
+			world->predictMultiBodyTransformsInternal(&multiBodies[iBegin], iEnd - iBegin, timeStep, scratch.m_worldToLocal, scratch.m_localOrigin);
+		}
+	};
+
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btMultiBodyDynamicsWorldMt(btDispatcher * dispatcher,
+							   btBroadphaseInterface * pairCache,
+							   btMultiBodyConstraintSolverPoolMt * solverPool,  // Note this should be a solver-pool for multi-threading
+							   btCollisionConfiguration * collisionConfiguration);
+	virtual ~btMultiBodyDynamicsWorldMt();
+
+	virtual void solveInternalConstraints(btContactSolverInfo & solverInfo) BT_OVERRIDE;
+
+	virtual void integrateTransforms(btScalar timeStep) BT_OVERRIDE;
+
+	virtual void predictUnconstraintMotion(btScalar timeStep) BT_OVERRIDE;
+
+	virtual void forwardKinematics() BT_OVERRIDE;
+
+	virtual int stepSimulation(btScalar timeStep, int maxSubSteps = 1, btScalar fixedTimeStep = btScalar(1.) / btScalar(60.)) BT_OVERRIDE;
+};
+
+#endif  //BT_MULTIBODY_DYNAMICS_WORLD_MT_H
@@ -0,0 +1,303 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btMultiBodyWorldBatch.h"
+#include "btMultiBody.h"
+#include "btMultiBodyDynamicsWorld.h"
+#include "btMultiBodyLinkCollider.h"
+
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
+
+btMultiBodyWorldBatch::btMultiBodyWorldBatch()
+	: m_grainSize(1),
+	  m_parallelStep(true)
+{
+}
+
+btMultiBodyWorldBatch::~btMultiBodyWorldBatch()
+{
+}
+
+int btMultiBodyWorldBatch::addEnvironment(btMultiBodyDynamicsWorld* world, btMultiBody* multiBody)
+{
+	btAssert(world && multiBody);
+	if (m_multiBodies.size())
+	{
+		// the state arrays assume that all environments have the same topology
+		const btMultiBody* first = m_multiBodies[0];
+		btAssert(multiBody->getNumLinks() == first->getNumLinks());
+		btAssert(multiBody->getNumDofs() == first->getNumDofs());
+		btAssert(multiBody->getNumPosVars() == first->getNumPosVars());
+		(void)first;
+	}
+	m_worlds.push_back(world);
+	m_multiBodies.push_back(multiBody);
+	return m_worlds.size() - 1;
+}
+
+void btMultiBodyWorldBatch::removeAllEnvironments()
+{
+	m_worlds.resize(0);
+	m_multiBodies.resize(0);
+}
+
+int btMultiBodyWorldBatch::getNumPositions() const
+{
+	return m_multiBodies.size() ? 7 + m_multiBodies[0]->getNumPosVars() : 0;
+}
+
+int btMultiBodyWorldBatch::getNumVelocities() const
+{
+	return m_multiBodies.size() ? 6 + m_multiBodies[0]->getNumDofs() : 0;
+}
+
+int btMultiBodyWorldBatch::getNumDofs() const
+{
+	return m_multiBodies.size() ? m_multiBodies[0]->getNumDofs() : 0;
+}
+
+struct MultiBodyWorldBatchStepLoop : public btIParallelForBody
+{
+	btMultiBodyDynamicsWorld* const* m_worlds;
+	btScalar m_timeStep;
+	int m_maxSubSteps;
+	btScalar m_fixedTimeStep;
+
+	MultiBodyWorldBatchStepLoop(btMultiBodyDynamicsWorld* const* worlds, btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep)
+	{
+		m_worlds = worlds;
+		m_timeStep = timeStep;
+		m_maxSubSteps = maxSubSteps;
+		m_fixedTimeStep = fixedTimeStep;
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_worlds[i]->stepSimulation(m_timeStep, m_maxSubSteps, m_fixedTimeStep);
+		}
+	}
+};
+
+void btMultiBodyWorldBatch::stepSimulation(btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep)
+{
+	BT_PROFILE("btMultiBodyWorldBatch::stepSimulation");
+	if (m_worlds.size() == 0)
+	{
+		return;
+	}
+	MultiBodyWorldBatchStepLoop loop(&m_worlds[0], timeStep, maxSubSteps, fixedTimeStep);
+	if (m_parallelStep)
+	{
+		btParallelFor(0, m_worlds.size(), m_grainSize, loop);
+	}
+	else
+	{
+		// the worlds run their own parallel loops, which must not be nested in ours
+		loop.forLoop(0, m_worlds.size());
+	}
+}
+
+// the state of the environments is copied in chunks of environments, each chunk writes its own columns of the arrays
+struct MultiBodyWorldBatchStateLoop : public btIParallelForBody
+{
+	enum StateType
+	{
+		GET_POSITIONS,
+		SET_POSITIONS,
+		GET_VELOCITIES,
+		SET_VELOCITIES,
+		ADD_JOINT_TORQUES,
+	};
+	btMultiBody* const* m_multiBodies;
+	btScalar* m_state;
+	int m_numEnvironments;
+	int m_stateType;
+
+	MultiBodyWorldBatchStateLoop(btMultiBody* const* multiBodies, btScalar* state, int numEnvironments, int stateType)
+	{
+		m_multiBodies = multiBodies;
+		m_state = state;
+		m_numEnvironments = numEnvironments;
+		m_stateType = stateType;
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btAlignedObjectArray<btQuaternion> scratch_world_to_local;
+		btAlignedObjectArray<btVector3> scratch_local_origin;
+		const int stride = m_numEnvironments;
+		for (int env = iBegin; env < iEnd; ++env)
+		{
+			btMultiBody* mb = m_multiBodies[env];
+			btScalar* state = m_state + env;
+			switch (m_stateType)
+			{
+				case GET_POSITIONS:
+				{
+					const btVector3& pos = mb->getBasePos();
+					const btQuaternion& rot = mb->getWorldToBaseRot();
+					for (int k = 0; k < 3; ++k)
+					{
+						state[k * stride] = pos[k];
+					}
+					for (int k = 0; k < 4; ++k)
+					{
+						state[(3 + k) * stride] = rot[k];
+					}
+					state += 7 * stride;
+					for (int link = 0; link < mb->getNumLinks(); ++link)
+					{
+						const btScalar* q = mb->getJointPosMultiDof(link);
+						for (int k = 0; k < mb->getLink(link).m_posVarCount; ++k)
+						{
+							*state = q[k];
+							state += stride;
+						}
+					}
+					break;
+				}
+				case SET_POSITIONS:
+				{
+					mb->setBasePos(btVector3(state[0], state[stride], state[2 * stride]));
+					mb->setWorldToBaseRot(btQuaternion(state[3 * stride], state[4 * stride], state[5 * stride], state[6 * stride]));
+					state += 7 * stride;
+					btScalar q[7];
+					for (int link = 0; link < mb->getNumLinks(); ++link)
+					{
+						int posVarCount = mb->getLink(link).m_posVarCount;
+						btAssert(posVarCount <= 7);
+						for (int k = 0; k < posVarCount; ++k)
+						{
+							q[k] = *state;
+							state += stride;
+						}
+						mb->setJointPosMultiDof(link, q);
+					}
+					mb->forwardKinematics(scratch_world_to_local, scratch_local_origin);
+					mb->updateCollisionObjectWorldTransforms(scratch_world_to_local, scratch_local_origin);
+					wakeUpMultiBody(mb);
+					break;
+				}
+				case GET_VELOCITIES:
+				{
+					const btScalar* v = mb->getVelocityVector();
+					for (int k = 0; k < 6 + mb->getNumDofs(); ++k)
+					{
+						state[k * stride] = v[k];
+					}
+					break;
+				}
+				case SET_VELOCITIES:
+				{
+					mb->setBaseOmega(btVector3(state[0], state[stride], state[2 * stride]));
+					mb->setBaseVel(btVector3(state[3 * stride], state[4 * stride], state[5 * stride]));
+					state += 6 * stride;
+					for (int link = 0; link < mb->getNumLinks(); ++link)
+					{
+						btScalar* qdot = mb->getJointVelMultiDof(link);
+						for (int k = 0; k < mb->getLink(link).m_dofCount; ++k)
+						{
+							qdot[k] = *state;
+							state += stride;
+						}
+					}
+					wakeUpMultiBody(mb);
+					break;
+				}
+				case ADD_JOINT_TORQUES:
+				{
+					for (int link = 0; link < mb->getNumLinks(); ++link)
+					{
+						for (int k = 0; k < mb->getLink(link).m_dofCount; ++k)
+						{
+							mb->addJointTorqueMultiDof(link, k, *state);
+							state += stride;
+						}
+					}
+					break;
+				}
+			}
+		}
+	}
+	// like btMultiBodyDynamicsWorld::updateActivationState, the colliders of a sleeping island would skip the next solve
+	static void wakeUpMultiBody(btMultiBody* mb)
+	{
+		mb->wakeUp();
+		btMultiBodyLinkCollider* col = mb->getBaseCollider();
+		if (col && col->getActivationState() != DISABLE_DEACTIVATION)
+		{
+			col->setActivationState(ACTIVE_TAG);
+			col->setDeactivationTime(0.f);
+		}
+		for (int link = 0; link < mb->getNumLinks(); ++link)
+		{
+			col = mb->getLink(link).m_collider;
+			if (col && col->getActivationState() != DISABLE_DEACTIVATION)
+			{
+				col->setActivationState(ACTIVE_TAG);
+				col->setDeactivationTime(0.f);
+			}
+		}
+	}
+};
+
+// copying the state is cheap, only larger chunks are worth a task
+static const int kMultiBodyWorldBatchStateGrainSize = 64;
+
+void btMultiBodyWorldBatch::getPositions(btScalar* positions) const
+{
+	if (m_multiBodies.size())
+	{
+		MultiBodyWorldBatchStateLoop loop(&m_multiBodies[0], positions, m_multiBodies.size(), MultiBodyWorldBatchStateLoop::GET_POSITIONS);
+		btParallelFor(0, m_multiBodies.size(), kMultiBodyWorldBatchStateGrainSize, loop);
+	}
+}
+
+void btMultiBodyWorldBatch::setPositions(const btScalar* positions)
+{
+	if (m_multiBodies.size())
+	{
+		MultiBodyWorldBatchStateLoop loop(&m_multiBodies[0], const_cast<btScalar*>(positions), m_multiBodies.size(), MultiBodyWorldBatchStateLoop::SET_POSITIONS);
+		btParallelFor(0, m_multiBodies.size(), kMultiBodyWorldBatchStateGrainSize, loop);
+	}
+}
+
+void btMultiBodyWorldBatch::getVelocities(btScalar* velocities) const
+{
+	if (m_multiBodies.size())
+	{
+		MultiBodyWorldBatchStateLoop loop(&m_multiBodies[0], velocities, m_multiBodies.size(), MultiBodyWorldBatchStateLoop::GET_VELOCITIES);
+		btParallelFor(0, m_multiBodies.size(), kMultiBodyWorldBatchStateGrainSize, loop);
+	}
+}
+
+void btMultiBodyWorldBatch::setVelocities(const btScalar* velocities)
+{
+	if (m_multiBodies.size())
+	{
+		MultiBodyWorldBatchStateLoop loop(&m_multiBodies[0], const_cast<btScalar*>(velocities), m_multiBodies.size(), MultiBodyWorldBatchStateLoop::SET_VELOCITIES);
+		btParallelFor(0, m_multiBodies.size(), kMultiBodyWorldBatchStateGrainSize, loop);
+	}
+}
+
+void btMultiBodyWorldBatch::addJointTorques(const btScalar* torques)
+{
+	if (m_multiBodies.size())
+	{
+		MultiBodyWorldBatchStateLoop loop(&m_multiBodies[0], const_cast<btScalar*>(torques), m_multiBodies.size(), MultiBodyWorldBatchStateLoop::ADD_JOINT_TORQUES);
+		btParallelFor(0, m_multiBodies.size(), kMultiBodyWorldBatchStateGrainSize, loop);
+	}
+}
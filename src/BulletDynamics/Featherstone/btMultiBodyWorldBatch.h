@@ -0,0 +1,102 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_MULTIBODY_WORLD_BATCH_H
+#define BT_MULTIBODY_WORLD_BATCH_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btScalar.h"
+
+class btMultiBody;
+class btMultiBodyDynamicsWorld;
+
+///
+/// btMultiBodyWorldBatch - steps many independent environments together, for example for reinforcement learning.
+///
+///  Each environment is a btMultiBodyDynamicsWorld with one btMultiBody whose state is exposed, and all of these
+///  multibodies have the same topology. The worlds are stepped in parallel with btParallelFor, one environment per
+///  task, so the worlds must not share collision objects, broadphases, dispatchers or solvers. Collision shapes
+///  can be shared.
+///
+///  Only the state arrays are in structure-of-arrays layout. Each world still keeps its own multibody and runs its own
+///  collision detection, articulated body algorithm, solver and integration, so the speedup over a loop of
+///  stepSimulation calls comes from the threads, not from SIMD across environments. A step gives exactly the same
+///  result as stepping each world alone.
+///
+///  The task schedulers do not support nested parallel loops, so the worlds stepped in parallel must be
+///  single-threaded: a btMultiBodyDynamicsWorld with a btMultiBodyConstraintSolver, and no parallel dispatcher,
+///  broadphase or island building. To batch btMultiBodyDynamicsWorldMt worlds, call setParallelStep(false), the
+///  worlds are then stepped one after the other and each one uses the threads itself.
+///
+///  The states and actions of all environments are read and written as contiguous arrays in structure-of-arrays
+///  layout: element k of environment i is at [k * getNumEnvironments() + i], so a policy can process one element of
+///  all environments at once.
+///    - positions: the base position (3), the world to base rotation (4, x y z w) and the joint positions of the
+///      links in the order of getJointPosMultiDof, getNumPositions() per environment
+///    - velocities: the velocity vector of btMultiBody::getVelocityVector, the base angular and linear velocity
+///      followed by the joint velocities, getNumVelocities() per environment
+///    - torques: one per degree of freedom of the links, getNumDofs() per environment
+///
+///  The batch does not own the worlds or the multibodies.
+///
+ATTRIBUTE_ALIGNED16(class)
+btMultiBodyWorldBatch
+{
+protected:
+	btAlignedObjectArray<btMultiBodyDynamicsWorld*> m_worlds;
+	btAlignedObjectArray<btMultiBody*> m_multiBodies;
+	int m_grainSize;
+	bool m_parallelStep;
+
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btMultiBodyWorldBatch();
+	virtual ~btMultiBodyWorldBatch();
+
+	///returns the index of the new environment, the multibody must be in the world
+	int addEnvironment(btMultiBodyDynamicsWorld * world, btMultiBody * multiBody);
+	void removeAllEnvironments();
+
+	int getNumEnvironments() const { return m_worlds.size(); }
+	btMultiBodyDynamicsWorld* getWorld(int env) { return m_worlds[env]; }
+	btMultiBody* getMultiBody(int env) { return m_multiBodies[env]; }
+	const btMultiBody* getMultiBody(int env) const { return m_multiBodies[env]; }
+
+	int getNumPositions() const;
+	int getNumVelocities() const;
+	int getNumDofs() const;
+
+	///number of environments per task of the parallel loops
+	void setGrainSize(int grainSize) { m_grainSize = grainSize; }
+	int getGrainSize() const { return m_grainSize; }
+
+	///steps the worlds in parallel (the default), turn it off when the worlds are multithreaded themselves
+	void setParallelStep(bool parallelStep) { m_parallelStep = parallelStep; }
+	bool getParallelStep() const { return m_parallelStep; }
+
+	///calls stepSimulation of every world
+	virtual void stepSimulation(btScalar timeStep, int maxSubSteps = 1, btScalar fixedTimeStep = btScalar(1.) / btScalar(60.));
+
+	void getPositions(btScalar * positions) const;
+	///also updates the transforms of the link colliders and wakes the multibodies up, to reset the environments
+	void setPositions(const btScalar* positions);
+	void getVelocities(btScalar * velocities) const;
+	void setVelocities(const btScalar* velocities);
+	///added with btMultiBody::addJointTorqueMultiDof, so they act on the next internal step
+	void addJointTorques(const btScalar* torques);
+};
+
+#endif  //BT_MULTIBODY_WORLD_BATCH_H
@@ -91,6 +91,7 @@ btScalar btMLCPSolver::solveGroupCacheFriendlySetup(btCollisionObject** bodies,
 		if (!m_allConstraintPtrArray.size())
 		{
 			m_A.resize(0, 0);
+			m_sparseA.resize(0, 0);
 			m_b.resize(0);
 			m_x.resize(0);
 			m_lo.resize(0);
@@ -99,7 +100,12 @@ btScalar btMLCPSolver::solveGroupCacheFriendlySetup(btCollisionObject** bodies,
 		}
 	}
 
-	if (gUseMatrixMultiply)
+	if (m_solver->useSparseMatrix())
+	{
+		BT_PROFILE("createMLCPSparse");
+		createMLCPSparse(infoGlobal);
+	}
+	else if (gUseMatrixMultiply)
 	{
 		BT_PROFILE("createMLCP");
 		createMLCP(infoGlobal);
@@ -117,6 +123,18 @@ bool btMLCPSolver::solveMLCP(const btContactSolverInfo& infoGlobal)
 {
 	bool result = true;
 
+	if (m_solver->useSparseMatrix())
+	{
+		if (m_sparseA.rows() == 0)
+			return true;
+
+		//the sparse solvers don't modify A, so the split impulse LCP can use the same matrix
+		result = m_solver->solveSparseMLCP(m_sparseA, m_b, m_x, m_lo, m_hi, m_limitDependencies, infoGlobal.m_numIterations);
+		if (result && infoGlobal.m_splitImpulse)
+			result = m_solver->solveSparseMLCP(m_sparseA, m_bSplit, m_xSplit, m_lo, m_hi, m_limitDependencies, infoGlobal.m_numIterations);
+		return result;
+	}
+
 	if (m_A.rows() == 0)
 		return true;
 
@@ -455,6 +473,149 @@ void btMLCPSolver::createMLCPFast(const btContactSolverInfo& infoGlobal)
 	}
 }
 
+void btMLCPSolver::createMLCPSparse(const btContactSolverInfo& infoGlobal)
+{
+	int numConstraintRows = m_allConstraintPtrArray.size();
+	int n = numConstraintRows;
+	{
+		BT_PROFILE("init b (rhs)");
+		m_b.resize(numConstraintRows);
+		m_bSplit.resize(numConstraintRows);
+		m_b.setZero();
+		m_bSplit.setZero();
+		for (int i = 0; i < numConstraintRows; i++)
+		{
+			btScalar jacDiag = m_allConstraintPtrArray[i]->m_jacDiagABInv;
+			if (!btFuzzyZero(jacDiag))
+			{
+				btScalar rhs = m_allConstraintPtrArray[i]->m_rhs;
+				btScalar rhsPenetration = m_allConstraintPtrArray[i]->m_rhsPenetration;
+				m_b[i] = rhs / jacDiag;
+				m_bSplit[i] = rhsPenetration / jacDiag;
+			}
+		}
+	}
+
+	m_lo.resize(numConstraintRows);
+	m_hi.resize(numConstraintRows);
+	for (int i = 0; i < numConstraintRows; i++)
+	{
+		m_lo[i] = m_allConstraintPtrArray[i]->m_lowerLimit;
+		m_hi[i] = m_allConstraintPtrArray[i]->m_upperLimit;
+	}
+
+	//the rows that touch each body, as 2*row for the A side and 2*row+1 for the B side of the row
+	int numBodies = m_tmpSolverBodyPool.size();
+	btAlignedObjectArray<int>& bodyRowOffsets = m_scratchBodyRowOffsets;
+	btAlignedObjectArray<int>& bodyRows = m_scratchBodyRows;
+	{
+		BT_PROFILE("collect rows per body");
+		bodyRowOffsets.resize(0);
+		bodyRowOffsets.resize(numBodies + 1, 0);
+		for (int i = 0; i < numConstraintRows; i++)
+		{
+			const btSolverConstraint& c = *m_allConstraintPtrArray[i];
+			if (m_tmpSolverBodyPool[c.m_solverBodyIdA].m_originalBody)
+				bodyRowOffsets[c.m_solverBodyIdA + 1]++;
+			if (m_tmpSolverBodyPool[c.m_solverBodyIdB].m_originalBody)
+				bodyRowOffsets[c.m_solverBodyIdB + 1]++;
+		}
+		for (int b = 0; b < numBodies; b++)
+		{
+			bodyRowOffsets[b + 1] += bodyRowOffsets[b];
+		}
+		btAlignedObjectArray<int>& cursors = m_scratchOfs;
+		cursors.resize(0);
+		cursors.resizeNoInitialize(numBodies);
+		for (int b = 0; b < numBodies; b++)
+		{
+			cursors[b] = bodyRowOffsets[b];
+		}
+		bodyRows.resizeNoInitialize(bodyRowOffsets[numBodies]);
+		for (int i = 0; i < numConstraintRows; i++)
+		{
+			const btSolverConstraint& c = *m_allConstraintPtrArray[i];
+			if (m_tmpSolverBodyPool[c.m_solverBodyIdA].m_originalBody)
+				bodyRows[cursors[c.m_solverBodyIdA]++] = 2 * i;
+			if (m_tmpSolverBodyPool[c.m_solverBodyIdB].m_originalBody)
+				bodyRows[cursors[c.m_solverBodyIdB]++] = 2 * i + 1;
+		}
+	}
+
+	{
+		BT_PROFILE("Compute sparse A");
+		//A(i,j) is the sum of JinvM(i)*J(j) over the bodies that rows i and j share.
+		//rowMarkers[j] is the last row that has an element in column j, at colElements[j]
+		btAlignedObjectArray<int>& rowMarkers = m_scratchRowMarkers;
+		btAlignedObjectArray<int>& colElements = m_scratchColElements;
+		rowMarkers.resize(0);
+		rowMarkers.resize(n, -1);
+		colElements.resizeNoInitialize(n);
+
+		m_sparseA.resize(n, n);
+		m_sparseA.reserve(bodyRows.size() * 4);
+		btScalar cfm = infoGlobal.m_globalCfm / infoGlobal.m_timeStep;
+		for (int i = 0; i < n; i++)
+		{
+			const btSolverConstraint& c = *m_allConstraintPtrArray[i];
+			m_sparseA.beginRow();
+
+			//the diagonal is always stored, with the cfm
+			rowMarkers[i] = i;
+			colElements[i] = m_sparseA.addElem(i, cfm);
+
+			for (int side = 0; side < 2; side++)
+			{
+				int sb = side ? c.m_solverBodyIdB : c.m_solverBodyIdA;
+				btRigidBody* orgBody = m_tmpSolverBodyPool[sb].m_originalBody;
+				if (!orgBody)
+					continue;
+				btVector3 normalInvMass = (side ? c.m_contactNormal2 : c.m_contactNormal1) * orgBody->getInvMass();
+				btVector3 relPosCrossNormalInvInertia = (side ? c.m_relpos2CrossNormal : c.m_relpos1CrossNormal) * orgBody->getInvInertiaTensorWorld();
+
+				for (int h = bodyRowOffsets[sb]; h < bodyRowOffsets[sb + 1]; h++)
+				{
+					int j = bodyRows[h] >> 1;
+					const btSolverConstraint& other = *m_allConstraintPtrArray[j];
+					btScalar val = (bodyRows[h] & 1) ? normalInvMass.dot(other.m_contactNormal2) + relPosCrossNormalInvInertia.dot(other.m_relpos2CrossNormal)
+													 : normalInvMass.dot(other.m_contactNormal1) + relPosCrossNormalInvInertia.dot(other.m_relpos1CrossNormal);
+					if (rowMarkers[j] != i)
+					{
+						rowMarkers[j] = i;
+						colElements[j] = m_sparseA.addElem(j, val);
+					}
+					else
+					{
+						m_sparseA.getValue(colElements[j]) += val;
+					}
+				}
+			}
+		}
+		m_sparseA.endRows();
+	}
+
+	{
+		BT_PROFILE("resize/init x");
+		m_x.resize(numConstraintRows);
+		m_xSplit.resize(numConstraintRows);
+
+		if (infoGlobal.m_solverMode & SOLVER_USE_WARMSTARTING)
+		{
+			for (int i = 0; i < m_allConstraintPtrArray.size(); i++)
+			{
+				const btSolverConstraint& c = *m_allConstraintPtrArray[i];
+				m_x[i] = c.m_appliedImpulse;
+				m_xSplit[i] = c.m_appliedPushImpulse;
+			}
+		}
+		else
+		{
+			m_x.setZero();
+			m_xSplit.setZero();
+		}
+	}
+}
+
 void btMLCPSolver::createMLCP(const btContactSolverInfo& infoGlobal)
 {
 	int numBodies = this->m_tmpSolverBodyPool.size();
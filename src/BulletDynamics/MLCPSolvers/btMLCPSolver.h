@@ -25,6 +25,7 @@ class btMLCPSolver : public btSequentialImpulseConstraintSolver
 {
 protected:
 	btMatrixXu m_A;
+	btSparseMatrixXu m_sparseA;  // used instead of m_A when m_solver->useSparseMatrix()
 	btVectorXu m_b;
 	btVectorXu m_x;
 	btVectorXu m_lo;
@@ -51,12 +52,18 @@ protected:
 	btMatrixXu m_scratchJ;
 	btMatrixXu m_scratchJTranspose;
 	btMatrixXu m_scratchTmp;
+	btAlignedObjectArray<int> m_scratchBodyRowOffsets;
+	btAlignedObjectArray<int> m_scratchBodyRows;
+	btAlignedObjectArray<int> m_scratchRowMarkers;
+	btAlignedObjectArray<int> m_scratchColElements;
 
 	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer);
 	virtual btScalar solveGroupCacheFriendlyIterations(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer);
 
 	virtual void createMLCP(const btContactSolverInfo& infoGlobal);
 	virtual void createMLCPFast(const btContactSolverInfo& infoGlobal);
+	///builds the sparse m_sparseA instead of m_A, for solvers that use a sparse matrix
+	virtual void createMLCPSparse(const btContactSolverInfo& infoGlobal);
 
 	//return true is it solves the problem successfully
 	virtual bool solveMLCP(const btContactSolverInfo& infoGlobal);
@@ -28,6 +28,17 @@ public:
 
 	//return true is it solves the problem successfully
 	virtual bool solveMLCP(const btMatrixXu& A, const btVectorXu& b, btVectorXu& x, const btVectorXu& lo, const btVectorXu& hi, const btAlignedObjectArray<int>& limitDependency, int numIterations, bool useSparsity = true) = 0;
+
+	//return true if the solver prefers A in sparse format, btMLCPSolver then builds A as a btSparseMatrixXu and calls solveSparseMLCP
+	virtual bool useSparseMatrix() const
+	{
+		return false;
+	}
+
+	virtual bool solveSparseMLCP(const btSparseMatrixXu& A, const btVectorXu& b, btVectorXu& x, const btVectorXu& lo, const btVectorXu& hi, const btAlignedObjectArray<int>& limitDependency, int numIterations)
+	{
+		return false;
+	}
 };
 
 #endif  //BT_MLCP_SOLVER_INTERFACE_H
@@ -0,0 +1,92 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SOLVE_SPARSE_PROJECTED_GAUSS_SEIDEL_H
+#define BT_SOLVE_SPARSE_PROJECTED_GAUSS_SEIDEL_H
+
+#include "btSolveProjectedGaussSeidel.h"
+
+///Projected Gauss-Seidel on an A matrix in compressed sparse row format. btMLCPSolver builds the sparse A directly from
+///the Jacobians of the constraint rows, without the dense n*n matrix, so memory and time grow with the number of
+///non-zero elements instead of the square of the number of rows. The iterations are the same as btSolveProjectedGaussSeidel
+///with the rows in the same order. Dense matrices, for example from btMultiBodyMLCPConstraintSolver, are passed on to
+///btSolveProjectedGaussSeidel.
+class btSolveSparseProjectedGaussSeidel : public btSolveProjectedGaussSeidel
+{
+public:
+	virtual bool useSparseMatrix() const
+	{
+		return true;
+	}
+
+	virtual bool solveSparseMLCP(const btSparseMatrixXu& A, const btVectorXu& b, btVectorXu& x, const btVectorXu& lo, const btVectorXu& hi, const btAlignedObjectArray<int>& limitDependency, int numIterations)
+	{
+		if (!A.rows())
+			return true;
+
+		btAssert(A.rows() == b.rows());
+
+		int numRows = A.rows();
+
+		for (int k = 0; k < numIterations; k++)
+		{
+			m_leastSquaresResidual = 0.f;
+			for (int i = 0; i < numRows; i++)
+			{
+				btScalar delta = 0.f;
+				btScalar aDiag = 0.f;
+				for (int h = A.getRowBegin(i); h < A.getRowEnd(i); h++)
+				{
+					int j = A.getColIndex(h);
+					if (j != i)
+					{
+						delta += A.getValue(h) * x[j];
+					}
+					else
+					{
+						aDiag = A.getValue(h);
+					}
+				}
+
+				btScalar xOld = x[i];
+				x[i] = (b[i] - delta) / aDiag;
+				btScalar s = 1.f;
+
+				if (limitDependency[i] >= 0)
+				{
+					s = x[limitDependency[i]];
+					if (s < 0)
+						s = 1;
+				}
+
+				if (x[i] < lo[i] * s)
+					x[i] = lo[i] * s;
+				if (x[i] > hi[i] * s)
+					x[i] = hi[i] * s;
+				btScalar diff = x[i] - xOld;
+				m_leastSquaresResidual += diff * diff;
+			}
+
+			btScalar eps = m_leastSquaresResidualThreshold;
+			if ((m_leastSquaresResidual < eps) || (k >= (numIterations - 1)))
+			{
+				break;
+			}
+		}
+		return true;
+	}
+};
+
+#endif  //BT_SOLVE_SPARSE_PROJECTED_GAUSS_SEIDEL_H
@@ -21,6 +21,13 @@
 typedef unsigned long long btU64;
 static const int kCacheLineSize = 64;
 
+// index of the calling thread for getCurrentThreadIndex, the worker threads set it in WorkerThreadFunc
+#if defined(_MSC_VER)
+__declspec(thread) static int sCurrentThreadIndex = 0;
+#else
+static __thread int sCurrentThreadIndex = 0;
+#endif
+
 void btSpinPause()
 {
 #if defined(_WIN32)
@@ -360,6 +367,7 @@ static void WorkerThreadFunc(void* userPtr)
 
 	bool shouldSleep = false;
 	int threadId = localStorage->m_threadId;
+	sCurrentThreadIndex = threadId;
 	while (!shouldSleep)
 	{
 		// do work
@@ -532,6 +540,11 @@ public:
 		return m_numThreads;
 	}
 
+	virtual int getCurrentThreadIndex() const BT_OVERRIDE
+	{
+		return sCurrentThreadIndex;
+	}
+
 	virtual void setNumThreads(int numThreads) BT_OVERRIDE
 	{
 		m_numThreads = btMax(btMin(numThreads, int(m_maxNumThreads)), 1);
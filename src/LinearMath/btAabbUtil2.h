@@ -114,6 +114,66 @@ SIMD_FORCE_INLINE bool btRayAabb2(const btVector3& rayFrom,
 	return ((tmin < lambda_max) && (tmax > lambda_min));
 }
 
+///btRayAabbPacket4 tests 4 rays against one aabb and returns bit i set when ray i overlaps it for a ray parameter in [0,lambdaMax[i]].
+///rayFrom and rayInvDirection hold the rays axis by axis, stride scalars apart. all arrays are 16 byte aligned
+SIMD_FORCE_INLINE unsigned btRayAabbPacket4(const btScalar* rayFrom,
+											const btScalar* rayInvDirection,
+											int stride,
+											const btScalar* lambdaMax,
+											const btVector3& aabbMin,
+											const btVector3& aabbMax)
+{
+#if defined(BT_USE_SSE)
+	__m128 enter = _mm_setzero_ps();
+	__m128 exit = _mm_load_ps(lambdaMax);
+	for (int k = 0; k < 3; ++k)
+	{
+		const __m128 from = _mm_load_ps(rayFrom + k * stride);
+		const __m128 inv = _mm_load_ps(rayInvDirection + k * stride);
+		const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMin[k]), from), inv);
+		const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMax[k]), from), inv);
+		enter = _mm_max_ps(enter, _mm_min_ps(t0, t1));
+		exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+	}
+	return unsigned(_mm_movemask_ps(_mm_cmple_ps(enter, exit)));
+#elif defined(BT_USE_NEON)
+	static const uint32_t bits[4] = {1, 2, 4, 8};
+	float32x4_t enter = vdupq_n_f32(0);
+	float32x4_t exit = vld1q_f32(lambdaMax);
+	for (int k = 0; k < 3; ++k)
+	{
+		const float32x4_t from = vld1q_f32(rayFrom + k * stride);
+		const float32x4_t inv = vld1q_f32(rayInvDirection + k * stride);
+		const float32x4_t t0 = vmulq_f32(vsubq_f32(vdupq_n_f32(aabbMin[k]), from), inv);
+		const float32x4_t t1 = vmulq_f32(vsubq_f32(vdupq_n_f32(aabbMax[k]), from), inv);
+		enter = vmaxq_f32(enter, vminq_f32(t0, t1));
+		exit = vminq_f32(exit, vmaxq_f32(t0, t1));
+	}
+	const uint32x4_t rt = vandq_u32(vcleq_f32(enter, exit), vld1q_u32(bits));
+	const uint32x2_t rs = vorr_u32(vget_low_u32(rt), vget_high_u32(rt));
+	return unsigned(vget_lane_u32(rs, 0) | vget_lane_u32(rs, 1));
+#else
+	unsigned mask = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		btScalar enter = btScalar(0.);
+		btScalar exit = lambdaMax[i];
+		for (int k = 0; k < 3; ++k)
+		{
+			const btScalar t0 = (aabbMin[k] - rayFrom[k * stride + i]) * rayInvDirection[k * stride + i];
+			const btScalar t1 = (aabbMax[k] - rayFrom[k * stride + i]) * rayInvDirection[k * stride + i];
+			enter = btMax(enter, btMin(t0, t1));
+			exit = btMin(exit, btMax(t0, t1));
+		}
+		if (enter <= exit)
+		{
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+#endif
+}
+
 SIMD_FORCE_INLINE bool btRayAabb(const btVector3& rayFrom,
 								 const btVector3& rayTo,
 								 const btVector3& aabbMin,
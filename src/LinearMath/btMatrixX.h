@@ -464,11 +464,135 @@ struct btMatrixX
 	}
 };
 
+///btSparseMatrixX stores a matrix in compressed sparse row (CSR) format. The rows are appended in order: call beginRow
+///for each row, followed by addElem for its non-zero elements, and finish with endRows.
+template <typename T>
+struct btSparseMatrixX
+{
+	int m_rows;
+	int m_cols;
+
+	btAlignedObjectArray<int> m_rowOffsets;  // first element per row, and the number of elements at the end
+	btAlignedObjectArray<int> m_colIndices;
+	btAlignedObjectArray<T> m_values;
+
+	btSparseMatrixX()
+		: m_rows(0),
+		  m_cols(0)
+	{
+	}
+
+	int rows() const
+	{
+		return m_rows;
+	}
+	int cols() const
+	{
+		return m_cols;
+	}
+	int getNumNonZeroElements() const
+	{
+		return m_values.size();
+	}
+
+	///remove all elements, the allocated memory is kept
+	void resize(int rows, int cols)
+	{
+		m_rows = rows;
+		m_cols = cols;
+		m_rowOffsets.resize(0);
+		m_colIndices.resize(0);
+		m_values.resize(0);
+	}
+	void reserve(int numNonZeroElements)
+	{
+		m_rowOffsets.reserve(m_rows + 1);
+		m_colIndices.reserve(numNonZeroElements);
+		m_values.reserve(numNonZeroElements);
+	}
+	void beginRow()
+	{
+		btAssert(m_rowOffsets.size() < m_rows);
+		m_rowOffsets.push_back(m_values.size());
+	}
+	///returns the index of the element, to accumulate into it with getValue
+	int addElem(int col, T val)
+	{
+		btAssert(col >= 0 && col < m_cols);
+		m_colIndices.push_back(col);
+		m_values.push_back(val);
+		return m_values.size() - 1;
+	}
+	void endRows()
+	{
+		btAssert(m_rowOffsets.size() == m_rows);
+		m_rowOffsets.push_back(m_values.size());
+	}
+
+	int getRowBegin(int row) const
+	{
+		return m_rowOffsets[row];
+	}
+	int getRowEnd(int row) const
+	{
+		return m_rowOffsets[row + 1];
+	}
+	int getColIndex(int index) const
+	{
+		return m_colIndices[index];
+	}
+	const T& getValue(int index) const
+	{
+		return m_values[index];
+	}
+	T& getValue(int index)
+	{
+		return m_values[index];
+	}
+
+	///random access is a linear search through the row, use getRowBegin/getRowEnd in loops
+	T operator()(int row, int col) const
+	{
+		for (int h = m_rowOffsets[row]; h < m_rowOffsets[row + 1]; h++)
+		{
+			if (m_colIndices[h] == col)
+				return m_values[h];
+		}
+		return T(0);
+	}
+
+	void multiply(const btVectorX<T>& x, btVectorX<T>& y) const
+	{
+		btAssert(x.rows() == m_cols);
+		y.resize(m_rows);
+		for (int i = 0; i < m_rows; i++)
+		{
+			T sum = T(0);
+			for (int h = m_rowOffsets[i]; h < m_rowOffsets[i + 1]; h++)
+				sum += m_values[h] * x[m_colIndices[h]];
+			y[i] = sum;
+		}
+	}
+
+	void toDense(btMatrixX<T>& mat) const
+	{
+		mat.resize(m_rows, m_cols);
+		mat.setZero();
+		for (int i = 0; i < m_rows; i++)
+		{
+			for (int h = m_rowOffsets[i]; h < m_rowOffsets[i + 1]; h++)
+				mat.addElem(i, m_colIndices[h], m_values[h]);
+		}
+	}
+};
+
 typedef btMatrixX<float> btMatrixXf;
 typedef btVectorX<float> btVectorXf;
+typedef btSparseMatrixX<float> btSparseMatrixXf;
 
 typedef btMatrixX<double> btMatrixXd;
 typedef btVectorX<double> btVectorXd;
+typedef btSparseMatrixX<double> btSparseMatrixXd;
 
 #ifdef BT_DEBUG_OSTREAM
 template <typename T>
@@ -524,9 +648,11 @@ inline void setElem(btMatrixXf& mat, int row, int col, float val)
 #ifdef BT_USE_DOUBLE_PRECISION
 #define btVectorXu btVectorXd
 #define btMatrixXu btMatrixXd
+#define btSparseMatrixXu btSparseMatrixXd
 #else
 #define btVectorXu btVectorXf
 #define btMatrixXu btMatrixXf
+#define btSparseMatrixXu btSparseMatrixXf
 #endif  //BT_USE_DOUBLE_PRECISION
 
 #endif  //BT_MATRIX_H_H
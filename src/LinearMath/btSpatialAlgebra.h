@@ -333,23 +333,26 @@ struct btSpatialTransformationMatrix
 								  m_trnVec[2], 0, -m_trnVec[0],
 								  -m_trnVec[1], m_trnVec[0], 0);
 
+		//the shifted top left block is shared by the top left and bottom left blocks; transposeTimes avoids building the transposed matrices
+		const btMatrix3x3 topLeftShifted = inMat.m_topLeftMat - inMat.m_topRightMat * r_cross;
+
 		if (outOp == None)
 		{
-			outMat.m_topLeftMat = m_rotMat.transpose() * (inMat.m_topLeftMat - inMat.m_topRightMat * r_cross) * m_rotMat;
-			outMat.m_topRightMat = m_rotMat.transpose() * inMat.m_topRightMat * m_rotMat;
-			outMat.m_bottomLeftMat = m_rotMat.transpose() * (r_cross * (inMat.m_topLeftMat - inMat.m_topRightMat * r_cross) + inMat.m_bottomLeftMat - inMat.m_topLeftMat.transpose() * r_cross) * m_rotMat;
+			outMat.m_topLeftMat = m_rotMat.transposeTimes(topLeftShifted) * m_rotMat;
+			outMat.m_topRightMat = m_rotMat.transposeTimes(inMat.m_topRightMat) * m_rotMat;
+			outMat.m_bottomLeftMat = m_rotMat.transposeTimes(r_cross * topLeftShifted + inMat.m_bottomLeftMat - inMat.m_topLeftMat.transposeTimes(r_cross)) * m_rotMat;
 		}
 		else if (outOp == Add)
 		{
-			outMat.m_topLeftMat += m_rotMat.transpose() * (inMat.m_topLeftMat - inMat.m_topRightMat * r_cross) * m_rotMat;
-			outMat.m_topRightMat += m_rotMat.transpose() * inMat.m_topRightMat * m_rotMat;
-			outMat.m_bottomLeftMat += m_rotMat.transpose() * (r_cross * (inMat.m_topLeftMat - inMat.m_topRightMat * r_cross) + inMat.m_bottomLeftMat - inMat.m_topLeftMat.transpose() * r_cross) * m_rotMat;
+			outMat.m_topLeftMat += m_rotMat.transposeTimes(topLeftShifted) * m_rotMat;
+			outMat.m_topRightMat += m_rotMat.transposeTimes(inMat.m_topRightMat) * m_rotMat;
+			outMat.m_bottomLeftMat += m_rotMat.transposeTimes(r_cross * topLeftShifted + inMat.m_bottomLeftMat - inMat.m_topLeftMat.transposeTimes(r_cross)) * m_rotMat;
 		}
 		else if (outOp == Subtract)
 		{
-			outMat.m_topLeftMat -= m_rotMat.transpose() * (inMat.m_topLeftMat - inMat.m_topRightMat * r_cross) * m_rotMat;
-			outMat.m_topRightMat -= m_rotMat.transpose() * inMat.m_topRightMat * m_rotMat;
-			outMat.m_bottomLeftMat -= m_rotMat.transpose() * (r_cross * (inMat.m_topLeftMat - inMat.m_topRightMat * r_cross) + inMat.m_bottomLeftMat - inMat.m_topLeftMat.transpose() * r_cross) * m_rotMat;
+			outMat.m_topLeftMat -= m_rotMat.transposeTimes(topLeftShifted) * m_rotMat;
+			outMat.m_topRightMat -= m_rotMat.transposeTimes(inMat.m_topRightMat) * m_rotMat;
+			outMat.m_bottomLeftMat -= m_rotMat.transposeTimes(r_cross * topLeftShifted + inMat.m_bottomLeftMat - inMat.m_topLeftMat.transposeTimes(r_cross)) * m_rotMat;
 		}
 	}
 
@@ -148,6 +148,8 @@ public:
 
 #else // #if BT_THREADSAFE
 
+#define btFullMemoryFence()
+
 // These should not be called ever
 class btSpinMutex
 {
@@ -210,6 +212,47 @@ SIMD_FORCE_INLINE bool btMutexTryLock(btSpinMutex* mutex)
 #endif  // #if BT_THREADSAFE
 }
 
+//
+// NOTE: btAtomic* is for internal Bullet use only
+//
+// Same rules as btMutex*, these degrade to plain memory operations when BT_THREADSAFE is 0.
+//
+
+// returns the value of *ptr before the addition
+SIMD_FORCE_INLINE int btAtomicFetchAdd(int volatile* ptr, int value)
+{
+#if BT_THREADSAFE
+#if USE_MSVC_INTRINSICS
+	return InterlockedExchangeAdd(reinterpret_cast<long volatile*>(ptr), value);
+#else
+	return __sync_fetch_and_add(ptr, value);
+#endif
+#else
+	int old = *ptr;
+	*ptr = old + value;
+	return old;
+#endif  // #if BT_THREADSAFE
+}
+
+// stores exchange in *ptr if it equals comparand, returns the value of *ptr before the operation
+SIMD_FORCE_INLINE int btAtomicCompareExchange(int volatile* ptr, int comparand, int exchange)
+{
+#if BT_THREADSAFE
+#if USE_MSVC_INTRINSICS
+	return InterlockedCompareExchange(reinterpret_cast<long volatile*>(ptr), exchange, comparand);
+#else
+	return __sync_val_compare_and_swap(ptr, comparand, exchange);
+#endif
+#else
+	int old = *ptr;
+	if (old == comparand)
+	{
+		*ptr = exchange;
+	}
+	return old;
+#endif  // #if BT_THREADSAFE
+}
+
 //
 // btIParallelForBody -- subclass this to express work that can be done in parallel
 //
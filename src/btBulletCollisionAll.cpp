@@ -7,6 +7,7 @@
 #include "BulletCollision/BroadphaseCollision/btCollisionAlgorithm.cpp"
 #include "BulletCollision/BroadphaseCollision/btDispatcher.cpp"
 #include "BulletCollision/BroadphaseCollision/btSimpleBroadphase.cpp"
+#include "BulletCollision/BroadphaseCollision/btGridBroadphase.cpp"
 #include "BulletCollision/CollisionDispatch/SphereTriangleDetector.cpp"
 #include "BulletCollision/CollisionDispatch/btCompoundCollisionAlgorithm.cpp"
 #include "BulletCollision/CollisionDispatch/btHashedSimplePairCache.cpp"
@@ -34,11 +35,13 @@
 #include "BulletCollision/CollisionDispatch/btUnionFind.cpp"
 #include "BulletCollision/CollisionDispatch/btCollisionWorldImporter.cpp"
 #include "BulletCollision/CollisionDispatch/btGhostObject.cpp"
+#include "BulletCollision/CollisionDispatch/btSweptSphereBatch.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btContinuousConvexCollision.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btPolyhedralContactClipping.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btConvexCast.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btGjkPairDetector.cpp"
+#include "BulletCollision/NarrowPhaseCollision/btGjkBatch.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btGjkConvexCast.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btMinkowskiPenetrationDepthSolver.cpp"
@@ -21,22 +21,27 @@
 #include "BulletDynamics/ConstraintSolver/btGeneric6DofSpring2Constraint.cpp"
 #include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.cpp"
 #include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.cpp"
+#include "BulletDynamics/ConstraintSolver/btPartitionedConstraintSolverMt.cpp"
+#include "BulletDynamics/ConstraintSolver/btNNCGConstraintSolverMt.cpp"
 #include "BulletDynamics/MLCPSolvers/btDantzigLCP.cpp"
 #include "BulletDynamics/MLCPSolvers/btLemkeAlgorithm.cpp"
 #include "BulletDynamics/MLCPSolvers/btMLCPSolver.cpp"
 #include "BulletDynamics/Featherstone/btMultiBody.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.cpp"
+#include "BulletDynamics/Featherstone/btMultiBodyDynamicsWorldMt.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyJointMotor.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyGearConstraint.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyConstraint.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyFixedConstraint.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyPoint2Point.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyConstraintSolver.cpp"
+#include "BulletDynamics/Featherstone/btMultiBodyConstraintSolverMt.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyMLCPConstraintSolver.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyJointLimitConstraint.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodySliderConstraint.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodySphericalJointMotor.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodySphericalJointLimit.cpp"
+#include "BulletDynamics/Featherstone/btMultiBodyWorldBatch.cpp"
 #include "BulletDynamics/Vehicle/btRaycastVehicle.cpp"
 #include "BulletDynamics/Vehicle/btWheelInfo.cpp"
 #include "BulletDynamics/Character/btKinematicCharacterController.cpp"
@@ -0,0 +1,49 @@
+#ifndef BT_TEST_ALLOCATOR_H
+#define BT_TEST_ALLOCATOR_H
+
+#include "LinearMath/btAlignedAllocator.h"
+
+#include <stdlib.h>
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+///this tree has no default allocator, the tests install one before creating any Bullet object
+struct btTestAllocator
+{
+	static void* alignedAlloc(size_t size, int alignment)
+	{
+#if defined(_WIN32)
+		return _aligned_malloc(size, alignment);
+#else
+		void* ptr = 0;
+		if (posix_memalign(&ptr, alignment < int(sizeof(void*)) ? sizeof(void*) : alignment, size))
+		{
+			return 0;
+		}
+		return ptr;
+#endif
+	}
+
+	static void alignedFree(void* ptr)
+	{
+#if defined(_WIN32)
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+
+	static void* alloc(size_t size)
+	{
+		return malloc(size);
+	}
+
+	static void install()
+	{
+		btAlignedAllocSetCustomAligned(alignedAlloc, alignedFree);
+		btAlignedAllocSetCustom(alloc, free);
+	}
+};
+
+#endif  //BT_TEST_ALLOCATOR_H
@@ -0,0 +1,107 @@
+#ifndef BT_TEST_TASK_SCHEDULER_H
+#define BT_TEST_TASK_SCHEDULER_H
+
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btMinMax.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+///btTestTaskScheduler starts its threads in every parallel loop, so the tests run the requested number of threads
+///whatever the number of cores. Nested loops run on the calling thread.
+class btTestTaskScheduler : public btITaskScheduler
+{
+	int m_numThreads;
+	bool m_running;
+
+	static int& currentThreadIndex()
+	{
+		static thread_local int index = 0;
+		return index;
+	}
+
+	template <typename Work>
+	void run(const Work& work)
+	{
+		m_running = true;
+		std::vector<std::thread> threads;
+		for (int i = 1; i < m_numThreads; ++i)
+		{
+			threads.push_back(std::thread(work, i));
+		}
+		work(0);
+		for (size_t i = 0; i < threads.size(); ++i)
+		{
+			threads[i].join();
+		}
+		m_running = false;
+	}
+
+public:
+	btTestTaskScheduler() : btITaskScheduler("Test"), m_numThreads(1), m_running(false) {}
+
+	///btSetTaskScheduler can only be called once, so all tests of an executable share this scheduler
+	static btTestTaskScheduler* get()
+	{
+		static btTestTaskScheduler scheduler;
+		static bool installed = false;
+		if (!installed)
+		{
+			btSetTaskScheduler(&scheduler);
+			installed = true;
+		}
+		return &scheduler;
+	}
+
+	void setNumThreads(int numThreads) { m_numThreads = btMax(1, btMin(numThreads, int(BT_MAX_THREAD_COUNT))); }
+
+	virtual int getNumThreads() const BT_OVERRIDE { return m_numThreads; }
+	virtual int getCurrentThreadIndex() const BT_OVERRIDE { return currentThreadIndex(); }
+
+	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) BT_OVERRIDE
+	{
+		if (m_running || (m_numThreads == 1))
+		{
+			body.forLoop(iBegin, iEnd);
+			return;
+		}
+		const int grain = btMax(grainSize, 1);
+		std::atomic<int> next(iBegin);
+		run([&](int threadIndex) {
+			currentThreadIndex() = threadIndex;
+			for (int i = next.fetch_add(grain); i < iEnd; i = next.fetch_add(grain))
+			{
+				body.forLoop(i, btMin(i + grain, iEnd));
+			}
+			currentThreadIndex() = 0;
+		});
+	}
+
+	virtual btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) BT_OVERRIDE
+	{
+		if (m_running || (m_numThreads == 1))
+		{
+			return body.sumLoop(iBegin, iEnd);
+		}
+		const int grain = btMax(grainSize, 1);
+		std::atomic<int> next(iBegin);
+		std::vector<btScalar> sums(m_numThreads, btScalar(0));
+		run([&](int threadIndex) {
+			currentThreadIndex() = threadIndex;
+			for (int i = next.fetch_add(grain); i < iEnd; i = next.fetch_add(grain))
+			{
+				sums[threadIndex] += body.sumLoop(i, btMin(i + grain, iEnd));
+			}
+			currentThreadIndex() = 0;
+		});
+		btScalar sum = 0;
+		for (int i = 0; i < m_numThreads; ++i)
+		{
+			sum += sums[i];
+		}
+		return sum;
+	}
+};
+
+#endif  //BT_TEST_TASK_SCHEDULER_H
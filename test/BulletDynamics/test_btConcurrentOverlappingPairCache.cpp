@@ -0,0 +1,387 @@
+
+#include <BulletCollision/BroadphaseCollision/btAxisSweep3.h>
+#include <BulletCollision/BroadphaseCollision/btOverlappingPairCache.h>
+#include <LinearMath/btQuickprof.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include "btTestAllocator.h"
+
+#if BT_THREADSAFE
+
+#include "btTestTaskScheduler.h"
+
+namespace
+{
+void setNumThreads(int numThreads)
+{
+	btTestTaskScheduler::get()->setNumThreads(numThreads);
+}
+
+struct PairCacheTest : public ::testing::Test
+{
+	enum
+	{
+		NUM_PROXIES = 2000,
+		PAIRS_PER_PROXY = 4
+	};
+
+	btAlignedObjectArray<btBroadphaseProxy> m_proxies;
+
+	virtual void SetUp()
+	{
+		m_proxies.resize(NUM_PROXIES);
+		for (int i = 0; i < NUM_PROXIES; ++i)
+		{
+			m_proxies[i].m_uniqueId = i + 1;
+			m_proxies[i].m_collisionFilterGroup = btBroadphaseProxy::DefaultFilter;
+			m_proxies[i].m_collisionFilterMask = btBroadphaseProxy::AllFilter;
+		}
+	}
+
+	btBroadphaseProxy* getPartner(int i, int j)
+	{
+		return &m_proxies[((i + j * 397) % NUM_PROXIES + NUM_PROXIES) % NUM_PROXIES];
+	}
+};
+
+// adds the pairs of proxy i with its partners, and looks up the pairs that existed before the concurrent add
+struct ConcurrentAddLoop : public btIParallelForBody
+{
+	btConcurrentOverlappingPairCache* m_cache;
+	PairCacheTest* m_test;
+	int m_firstPartner;
+	int m_numPartners;
+	int m_numOldPartners;
+	int* m_numOldPairsFound;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			for (int j = m_firstPartner; j < m_firstPartner + m_numPartners; ++j)
+			{
+				// each pair is also added by the partner, likely from another thread, the duplicates must be merged
+				m_cache->addOverlappingPair(&m_test->m_proxies[i], m_test->getPartner(i, j));
+				m_cache->addOverlappingPair(m_test->getPartner(i, -j), &m_test->m_proxies[i]);
+			}
+			int found = 0;
+			for (int j = 1; j <= m_numOldPartners; ++j)
+			{
+				if (m_cache->findPair(&m_test->m_proxies[i], m_test->getPartner(i, j)))
+				{
+					++found;
+				}
+			}
+			m_numOldPairsFound[i] = found;
+		}
+	}
+};
+
+void concurrentAdd(btConcurrentOverlappingPairCache* cache, PairCacheTest* test, int firstPartner, int numPartners, int numOldPartners, int expectedNewPairs, btAlignedObjectArray<int>& numOldPairsFound)
+{
+	numOldPairsFound.resize(PairCacheTest::NUM_PROXIES);
+	ConcurrentAddLoop loop;
+	loop.m_cache = cache;
+	loop.m_test = test;
+	loop.m_firstPartner = firstPartner;
+	loop.m_numPartners = numPartners;
+	loop.m_numOldPartners = numOldPartners;
+	loop.m_numOldPairsFound = &numOldPairsFound[0];
+	cache->beginConcurrentAdd(expectedNewPairs);
+	btParallelFor(0, PairCacheTest::NUM_PROXIES, 50, loop);
+	cache->endConcurrentAdd();
+}
+
+void checkPairs(btConcurrentOverlappingPairCache* cache, PairCacheTest* test, int firstPartner, int numPartners, bool expectFound)
+{
+	for (int i = 0; i < PairCacheTest::NUM_PROXIES; ++i)
+	{
+		for (int j = firstPartner; j < firstPartner + numPartners; ++j)
+		{
+			btBroadphasePair* pair = cache->findPair(test->getPartner(i, j), &test->m_proxies[i]);
+			ASSERT_EQ(expectFound, pair != 0) << "proxy " << i << " partner " << j;
+		}
+	}
+}
+
+unsigned int gRandomSeed = 1;
+
+btScalar randomScalar(btScalar range)
+{
+	gRandomSeed = gRandomSeed * 1664525u + 1013904223u;
+	return btScalar((gRandomSeed >> 8) % 10000u) * range * btScalar(0.0001);
+}
+
+struct IntLess
+{
+	bool operator()(int a, int b) const
+	{
+		return a < b;
+	}
+};
+
+// the pairs of a broadphase as sorted indices of the proxies, stored in m_clientObject
+void getPairIndices(btOverlappingPairCache* cache, btAlignedObjectArray<int>& indices)
+{
+	int numPairs = cache->getNumOverlappingPairs();
+	btAlignedObjectArray<int> keys;
+	keys.resize(numPairs);
+	for (int i = 0; i < numPairs; ++i)
+	{
+		const btBroadphasePair& pair = cache->getOverlappingPairArray()[i];
+		int index0 = int(size_t(pair.m_pProxy0->m_clientObject));
+		int index1 = int(size_t(pair.m_pProxy1->m_clientObject));
+		keys[i] = btMin(index0, index1) * 65536 + btMax(index0, index1);
+	}
+	keys.quickSort(IntLess());
+	indices = keys;
+}
+
+// adds 8 pairs for each proxy, from one thread or with btParallelFor
+struct BenchmarkAddLoop : public btIParallelForBody
+{
+	btOverlappingPairCache* m_cache;
+	btBroadphaseProxy* m_proxies;
+	int m_numProxies;
+	int m_pairsPerProxy;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			for (int j = 1; j <= m_pairsPerProxy; ++j)
+			{
+				m_cache->addOverlappingPair(&m_proxies[i], &m_proxies[(i + j * 7) % m_numProxies]);
+			}
+		}
+	}
+};
+
+void runBenchmark(const char* name, btOverlappingPairCache* cache, BenchmarkAddLoop& loop, bool parallel)
+{
+	btClock clock;
+	loop.m_cache = cache;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		clock.reset();
+		if (parallel)
+		{
+			cache->beginConcurrentAdd(loop.m_numProxies * loop.m_pairsPerProxy);
+			btParallelFor(0, loop.m_numProxies, 256, loop);
+			cache->endConcurrentAdd();
+		}
+		else
+		{
+			loop.forLoop(0, loop.m_numProxies);
+		}
+		unsigned long long us = clock.getTimeMicroseconds();
+		printf("\t%s %s: %llu us (%d pairs)\n", name, pass ? "re-add" : "add", us, cache->getNumOverlappingPairs());
+	}
+	clock.reset();
+	int found = 0;
+	for (int i = 0; i < loop.m_numProxies; ++i)
+	{
+		if (cache->findPair(&loop.m_proxies[i], &loop.m_proxies[(i + 7) % loop.m_numProxies]))
+		{
+			++found;
+		}
+	}
+	unsigned long long us = clock.getTimeMicroseconds();
+	printf("\t%s find: %llu us (%d found)\n", name, us, found);
+}
+}  // namespace
+
+TEST_F(PairCacheTest, ConcurrentAddMatchesSerialAdd)
+{
+	btHashedOverlappingPairCache serial;
+	for (int i = 0; i < NUM_PROXIES; ++i)
+	{
+		for (int j = 1; j <= PAIRS_PER_PROXY; ++j)
+		{
+			serial.addOverlappingPair(&m_proxies[i], getPartner(i, j));
+		}
+	}
+	btBroadphasePairArray expectedPairs = serial.getOverlappingPairArray();
+	expectedPairs.quickSort(btBroadphasePairSortPredicate());
+
+	for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+	{
+		setNumThreads(numThreads);
+		btConcurrentOverlappingPairCache cache;
+		btAlignedObjectArray<int> numOldPairsFound;
+		concurrentAdd(&cache, this, 1, PAIRS_PER_PROXY, 0, NUM_PROXIES * PAIRS_PER_PROXY, numOldPairsFound);
+
+		ASSERT_EQ(expectedPairs.size(), cache.getNumOverlappingPairs());
+		checkPairs(&cache, this, 1, PAIRS_PER_PROXY, true);
+		// the new pairs are sorted, so the order does not depend on the threads
+		for (int i = 0; i < cache.getNumOverlappingPairs(); ++i)
+		{
+			EXPECT_EQ(expectedPairs[i].m_pProxy0, cache.getOverlappingPairArray()[i].m_pProxy0);
+			EXPECT_EQ(expectedPairs[i].m_pProxy1, cache.getOverlappingPairArray()[i].m_pProxy1);
+		}
+	}
+}
+
+TEST_F(PairCacheTest, ConcurrentAddGrowsTable)
+{
+	for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+	{
+		setNumThreads(numThreads);
+		btConcurrentOverlappingPairCache cache;
+		btAlignedObjectArray<int> numOldPairsFound;
+
+		// nothing reserved, most pairs overflow and are inserted by endConcurrentAdd
+		concurrentAdd(&cache, this, 1, 2, 0, 0, numOldPairsFound);
+		ASSERT_EQ(NUM_PROXIES * 2, cache.getNumOverlappingPairs());
+		checkPairs(&cache, this, 1, 2, true);
+
+		// grow again while looking up the pairs of the first add
+		concurrentAdd(&cache, this, 3, PAIRS_PER_PROXY - 2, 2, 0, numOldPairsFound);
+		ASSERT_EQ(NUM_PROXIES * PAIRS_PER_PROXY, cache.getNumOverlappingPairs());
+		checkPairs(&cache, this, 1, PAIRS_PER_PROXY, true);
+		for (int i = 0; i < NUM_PROXIES; ++i)
+		{
+			ASSERT_EQ(2, numOldPairsFound[i]) << "proxy " << i;
+		}
+	}
+}
+
+TEST_F(PairCacheTest, RemoveAndAddAgain)
+{
+	for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+	{
+		setNumThreads(numThreads);
+		btConcurrentOverlappingPairCache cache;
+		btAlignedObjectArray<int> numOldPairsFound;
+		concurrentAdd(&cache, this, 1, PAIRS_PER_PROXY, 0, 0, numOldPairsFound);
+
+		// removal is single-threaded, it moves the last pair into the hole
+		for (int i = 0; i < NUM_PROXIES; ++i)
+		{
+			cache.removeOverlappingPair(getPartner(i, 1), &m_proxies[i], 0);
+		}
+		ASSERT_EQ(NUM_PROXIES * (PAIRS_PER_PROXY - 1), cache.getNumOverlappingPairs());
+		checkPairs(&cache, this, 1, 1, false);
+		checkPairs(&cache, this, 2, PAIRS_PER_PROXY - 1, true);
+
+		for (int i = 0; i < NUM_PROXIES; ++i)
+		{
+			cache.removeOverlappingPairsContainingProxy(&m_proxies[i], 0);
+		}
+		ASSERT_EQ(0, cache.getNumOverlappingPairs());
+		checkPairs(&cache, this, 1, PAIRS_PER_PROXY, false);
+
+		// the slots of the removed pairs are reused
+		concurrentAdd(&cache, this, 1, PAIRS_PER_PROXY, 0, NUM_PROXIES, numOldPairsFound);
+		ASSERT_EQ(NUM_PROXIES * PAIRS_PER_PROXY, cache.getNumOverlappingPairs());
+		checkPairs(&cache, this, 1, PAIRS_PER_PROXY, true);
+	}
+}
+
+TEST(AxisSweepPairCacheTest, SamePairsAsHashedPairCache)
+{
+	const int numProxies = 1000;
+	const btVector3 worldMin(-100.f, -100.f, -100.f);
+	const btVector3 worldMax(100.f, 100.f, 100.f);
+	const btVector3 halfExtents(2.f, 2.f, 2.f);
+	btAxisSweep3 hashedSweep(worldMin, worldMax);
+	btConcurrentOverlappingPairCache concurrentCache;
+	btAxisSweep3 concurrentSweep(worldMin, worldMax, 16384, &concurrentCache);
+	btAlignedObjectArray<btBroadphaseProxy*> hashedProxies;
+	btAlignedObjectArray<btBroadphaseProxy*> concurrentProxies;
+	gRandomSeed = 3;
+	for (int step = 0; step < 5; ++step)
+	{
+		for (int i = 0; i < numProxies; ++i)
+		{
+			btVector3 center(randomScalar(80.f) - 40.f, randomScalar(80.f) - 40.f, randomScalar(80.f) - 40.f);
+			// most proxies move a little, some jump across the world
+			if (step > 0 && i % 10)
+			{
+				center = (hashedProxies[i]->m_aabbMin + hashedProxies[i]->m_aabbMax) * btScalar(0.5) + (center * btScalar(0.02));
+			}
+			if (step == 0)
+			{
+				void* clientObject = (void*)size_t(i);
+				hashedProxies.push_back(hashedSweep.createProxy(center - halfExtents, center + halfExtents, BOX_SHAPE_PROXYTYPE, clientObject, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, 0));
+				concurrentProxies.push_back(concurrentSweep.createProxy(center - halfExtents, center + halfExtents, BOX_SHAPE_PROXYTYPE, clientObject, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, 0));
+			}
+			else
+			{
+				hashedSweep.setAabb(hashedProxies[i], center - halfExtents, center + halfExtents, 0);
+				concurrentSweep.setAabb(concurrentProxies[i], center - halfExtents, center + halfExtents, 0);
+			}
+		}
+		hashedSweep.calculateOverlappingPairs(0);
+		concurrentSweep.calculateOverlappingPairs(0);
+
+		btAlignedObjectArray<int> expectedPairs;
+		getPairIndices(hashedSweep.getOverlappingPairCache(), expectedPairs);
+		ASSERT_GT(expectedPairs.size(), numProxies / 10);
+		btAlignedObjectArray<int> pairs;
+		getPairIndices(&concurrentCache, pairs);
+		ASSERT_EQ(expectedPairs.size(), pairs.size()) << "step " << step;
+		for (int i = 0; i < pairs.size(); ++i)
+		{
+			ASSERT_EQ(expectedPairs[i], pairs[i]) << "step " << step;
+		}
+	}
+	for (int i = 0; i < numProxies; ++i)
+	{
+		hashedSweep.destroyProxy(hashedProxies[i], 0);
+		concurrentSweep.destroyProxy(concurrentProxies[i], 0);
+	}
+	EXPECT_EQ(0, concurrentCache.getNumOverlappingPairs());
+}
+
+// compares btConcurrentOverlappingPairCache against btHashedOverlappingPairCache from 10^5 to 10^6 pairs,
+// run with --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+TEST(PairCacheBenchmark, DISABLED_CompareWithHashedPairCache)
+{
+	static const int pairCounts[] = {100000, 300000, 1000000};
+	static const int numExperiments = sizeof(pairCounts) / sizeof(pairCounts[0]);
+	const int pairsPerProxy = 8;
+	printf("Pair cache benchmark\n");
+	for (int iexp = 0; iexp < numExperiments; ++iexp)
+	{
+		const int numProxies = pairCounts[iexp] / pairsPerProxy;
+		btAlignedObjectArray<btBroadphaseProxy> proxies;
+		proxies.resize(numProxies);
+		for (int i = 0; i < numProxies; ++i)
+		{
+			proxies[i].m_uniqueId = i + 1;
+			proxies[i].m_collisionFilterGroup = btBroadphaseProxy::DefaultFilter;
+			proxies[i].m_collisionFilterMask = btBroadphaseProxy::AllFilter;
+		}
+		BenchmarkAddLoop loop;
+		loop.m_proxies = &proxies[0];
+		loop.m_numProxies = numProxies;
+		loop.m_pairsPerProxy = pairsPerProxy;
+		printf("Experiment #%d: %d pairs\n", iexp, pairCounts[iexp]);
+		{
+			btHashedOverlappingPairCache hashed;
+			runBenchmark("btHashedOverlappingPairCache", &hashed, loop, false);
+		}
+		{
+			btConcurrentOverlappingPairCache concurrent;
+			runBenchmark("btConcurrentOverlappingPairCache serial", &concurrent, loop, false);
+		}
+		for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+		{
+			setNumThreads(numThreads);
+			char name[64];
+			sprintf(name, "btConcurrentOverlappingPairCache %d threads", numThreads);
+			btConcurrentOverlappingPairCache concurrent;
+			runBenchmark(name, &concurrent, loop, true);
+		}
+	}
+}
+
+#endif  //BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+	btTestAllocator::install();
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
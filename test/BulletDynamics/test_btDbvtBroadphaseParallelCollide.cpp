@@ -0,0 +1,216 @@
+
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <BulletCollision/BroadphaseCollision/btOverlappingPairCache.h>
+#include <gtest/gtest.h>
+#include "btTestAllocator.h"
+
+#if BT_THREADSAFE
+
+#include "btTestTaskScheduler.h"
+
+namespace
+{
+void setNumThreads(int numThreads)
+{
+	btTestTaskScheduler::get()->setNumThreads(numThreads);
+}
+
+unsigned int gRandomSeed = 1;
+
+btScalar randomScalar(btScalar range)
+{
+	gRandomSeed = gRandomSeed * 1664525u + 1013904223u;
+	return btScalar((gRandomSeed >> 8) % 10000u) * range * btScalar(0.0001);
+}
+
+struct IntLess
+{
+	bool operator()(int a, int b) const
+	{
+		return a < b;
+	}
+};
+
+int getPairKey(const btBroadphasePair& pair)
+{
+	int index0 = int(size_t(pair.m_pProxy0->m_clientObject));
+	int index1 = int(size_t(pair.m_pProxy1->m_clientObject));
+	return btMin(index0, index1) * 65536 + btMax(index0, index1);
+}
+
+// boxes in a small volume, a third of them never move, so the broadphase moves them to its fixed tree
+struct ParallelCollideTest : public ::testing::Test
+{
+	enum
+	{
+		NUM_PROXIES = 1500,
+		NUM_STEPS = 8
+	};
+
+	// the centers of the boxes for every step
+	btAlignedObjectArray<btVector3> m_centers;
+	btVector3 m_halfExtents;
+
+	virtual void SetUp()
+	{
+		m_halfExtents.setValue(1.f, 1.f, 1.f);
+		gRandomSeed = 5;
+		m_centers.resize(NUM_PROXIES * NUM_STEPS);
+		for (int i = 0; i < NUM_PROXIES; ++i)
+		{
+			m_centers[i].setValue(randomScalar(50.f) - 25.f, randomScalar(50.f) - 25.f, randomScalar(50.f) - 25.f);
+		}
+		for (int step = 1; step < NUM_STEPS; ++step)
+		{
+			for (int i = 0; i < NUM_PROXIES; ++i)
+			{
+				btVector3 delta(0.f, 0.f, 0.f);
+				if (i % 3)
+				{
+					delta.setValue(randomScalar(1.f) - 0.5f, randomScalar(1.f) - 0.5f, randomScalar(1.f) - 0.5f);
+				}
+				m_centers[step * NUM_PROXIES + i] = m_centers[(step - 1) * NUM_PROXIES + i] + delta;
+			}
+		}
+	}
+
+	// steps the broadphase through the boxes, and returns the pair array of every step and the pairs of overlapping boxes
+	void run(btDbvtBroadphase* broadphase, btAlignedObjectArray<int>& pairArrays, btAlignedObjectArray<int>& overlappingPairs)
+	{
+		pairArrays.resize(0);
+		overlappingPairs.resize(0);
+		btAlignedObjectArray<btBroadphaseProxy*> proxies;
+		for (int step = 0; step < NUM_STEPS; ++step)
+		{
+			for (int i = 0; i < NUM_PROXIES; ++i)
+			{
+				const btVector3& center = m_centers[step * NUM_PROXIES + i];
+				if (step == 0)
+				{
+					proxies.push_back(broadphase->createProxy(center - m_halfExtents, center + m_halfExtents, BOX_SHAPE_PROXYTYPE, (void*)size_t(i), btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, 0));
+				}
+				else
+				{
+					broadphase->setAabb(proxies[i], center - m_halfExtents, center + m_halfExtents, 0);
+				}
+			}
+			broadphase->calculateOverlappingPairs(0);
+
+			// the pair cache also keeps pairs that stopped overlapping until the clean up reaches them
+			btOverlappingPairCache* cache = broadphase->getOverlappingPairCache();
+			btAlignedObjectArray<int> keys;
+			for (int i = 0; i < cache->getNumOverlappingPairs(); ++i)
+			{
+				const btBroadphasePair& pair = cache->getOverlappingPairArray()[i];
+				pairArrays.push_back(getPairKey(pair));
+				if (TestAabbAgainstAabb2(pair.m_pProxy0->m_aabbMin, pair.m_pProxy0->m_aabbMax, pair.m_pProxy1->m_aabbMin, pair.m_pProxy1->m_aabbMax))
+				{
+					keys.push_back(getPairKey(pair));
+				}
+			}
+			pairArrays.push_back(-1);
+			keys.quickSort(IntLess());
+			for (int i = 0; i < keys.size(); ++i)
+			{
+				overlappingPairs.push_back(keys[i]);
+			}
+			overlappingPairs.push_back(-1);
+		}
+		for (int i = 0; i < NUM_PROXIES; ++i)
+		{
+			broadphase->destroyProxy(proxies[i], 0);
+		}
+	}
+
+	// the pairs of overlapping boxes of every step, by brute force
+	void getExpectedPairs(btAlignedObjectArray<int>& overlappingPairs)
+	{
+		overlappingPairs.resize(0);
+		for (int step = 0; step < NUM_STEPS; ++step)
+		{
+			const btVector3* centers = &m_centers[step * NUM_PROXIES];
+			for (int i = 0; i < NUM_PROXIES; ++i)
+			{
+				for (int j = i + 1; j < NUM_PROXIES; ++j)
+				{
+					if (TestAabbAgainstAabb2(centers[i] - m_halfExtents, centers[i] + m_halfExtents, centers[j] - m_halfExtents, centers[j] + m_halfExtents))
+					{
+						overlappingPairs.push_back(i * 65536 + j);
+					}
+				}
+			}
+			overlappingPairs.push_back(-1);
+		}
+	}
+
+	void checkParallelCollide(bool concurrentPairCache)
+	{
+		btAlignedObjectArray<int> expectedPairs;
+		getExpectedPairs(expectedPairs);
+		ASSERT_GT(expectedPairs.size(), NUM_PROXIES * NUM_STEPS / 4);
+
+		btAlignedObjectArray<int> serialPairArrays;
+		btAlignedObjectArray<int> serialPairs;
+		{
+			btDbvtBroadphase broadphase;
+			run(&broadphase, serialPairArrays, serialPairs);
+		}
+		ASSERT_EQ(expectedPairs.size(), serialPairs.size());
+		for (int i = 0; i < serialPairs.size(); ++i)
+		{
+			ASSERT_EQ(expectedPairs[i], serialPairs[i]) << "serial pair " << i;
+		}
+
+		btAlignedObjectArray<int> singleThreadPairArrays;
+		for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+		{
+			setNumThreads(numThreads);
+			btConcurrentOverlappingPairCache* cache = concurrentPairCache ? new btConcurrentOverlappingPairCache() : 0;
+			btAlignedObjectArray<int> pairArrays;
+			btAlignedObjectArray<int> pairs;
+			{
+				btDbvtBroadphase broadphase(cache);
+				broadphase.setParallelCollide(true);
+				run(&broadphase, pairArrays, pairs);
+			}
+			delete cache;
+
+			// the same pairs as the serial collide
+			ASSERT_EQ(serialPairs.size(), pairs.size()) << "threads " << numThreads;
+			for (int i = 0; i < pairs.size(); ++i)
+			{
+				ASSERT_EQ(serialPairs[i], pairs[i]) << "pair " << i << " threads " << numThreads;
+			}
+			// in the same order whatever the number of threads
+			if (numThreads == 1)
+			{
+				singleThreadPairArrays = pairArrays;
+			}
+			ASSERT_EQ(singleThreadPairArrays.size(), pairArrays.size()) << "threads " << numThreads;
+			for (int i = 0; i < pairArrays.size(); ++i)
+			{
+				ASSERT_EQ(singleThreadPairArrays[i], pairArrays[i]) << "pair " << i << " threads " << numThreads;
+			}
+		}
+	}
+};
+}  // namespace
+
+TEST_F(ParallelCollideTest, SamePairsAsSerialCollide)
+{
+	checkParallelCollide(false);
+}
+
+TEST_F(ParallelCollideTest, SamePairsAsSerialCollideWithConcurrentPairCache)
+{
+	checkParallelCollide(true);
+}
+
+#endif  //BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+	btTestAllocator::install();
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,198 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <gtest/gtest.h>
+#include "btTestAllocator.h"
+
+#if BT_THREADSAFE
+
+#include "btTestTaskScheduler.h"
+
+namespace
+{
+void setNumThreads(int numThreads)
+{
+	btTestTaskScheduler::get()->setNumThreads(numThreads);
+}
+
+struct IslandIdLess
+{
+	bool operator()(const btSolverIslandAnalyticsData& a, const btSolverIslandAnalyticsData& b) const
+	{
+		return a.m_islandId < b.m_islandId;
+	}
+};
+
+// stacks of boxes on a static ground, far enough apart that every stack is an island of its own
+struct StackScene
+{
+	enum
+	{
+		NUM_STACKS = 12,
+		NUM_LEVELS = 3
+	};
+
+	btDefaultCollisionConfiguration* m_collisionConfiguration;
+	btCollisionDispatcher* m_dispatcher;
+	btDbvtBroadphase* m_broadphase;
+	btConstraintSolver* m_solver;
+	btConstraintSolverPoolMt* m_solverPool;
+	btDiscreteDynamicsWorld* m_world;
+	btBoxShape* m_boxShape;
+	btBoxShape* m_groundShape;
+	btAlignedObjectArray<btRigidBody*> m_bodies;
+
+	explicit StackScene(bool multithreaded)
+	{
+		m_collisionConfiguration = new btDefaultCollisionConfiguration();
+		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+		m_broadphase = new btDbvtBroadphase();
+		m_solver = 0;
+		m_solverPool = 0;
+		if (multithreaded)
+		{
+			m_solverPool = new btConstraintSolverPoolMt(BT_MAX_THREAD_COUNT);
+			m_world = new btDiscreteDynamicsWorldMt(m_dispatcher, m_broadphase, m_solverPool, 0, m_collisionConfiguration);
+		}
+		else
+		{
+			m_solver = new btSequentialImpulseConstraintSolver();
+			m_world = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+		}
+		m_world->setGravity(btVector3(0, -10, 0));
+		// the small islands are solved in batches, the analytics of each batch have its islands separately
+		m_world->getSolverInfo().m_solverMode |= SOLVER_ADAPTIVE_ISLAND_ITERATIONS;
+		m_world->getSolverInfo().m_leastSquaresResidualThreshold = btScalar(1e-4);
+		m_world->getSolverInfo().m_reportSolverAnalytics = 1;
+		m_boxShape = new btBoxShape(btVector3(0.5f, 0.5f, 0.5f));
+		m_groundShape = new btBoxShape(btVector3(50.f, 0.5f, 50.f));
+
+		addBody(0.f, m_groundShape, btVector3(0.f, -0.5f, 0.f));
+		for (int stack = 0; stack < NUM_STACKS; ++stack)
+		{
+			// stacks of different heights, so the islands have different sizes
+			for (int level = 0; level < 1 + stack % NUM_LEVELS; ++level)
+			{
+				addBody(1.f, m_boxShape, btVector3(btScalar(stack % 4) * 3.f, 0.5f + btScalar(level) * 1.01f, btScalar(stack / 4) * 3.f));
+			}
+		}
+	}
+
+	void addBody(btScalar mass, btCollisionShape* shape, const btVector3& position)
+	{
+		btVector3 inertia(0, 0, 0);
+		if (mass > 0)
+		{
+			shape->calculateLocalInertia(mass, inertia);
+		}
+		btTransform transform;
+		transform.setIdentity();
+		transform.setOrigin(position);
+		btRigidBody* body = new btRigidBody(mass, 0, shape, inertia);
+		body->setWorldTransform(transform);
+		body->setInterpolationWorldTransform(transform);
+		m_world->addRigidBody(body);
+		m_bodies.push_back(body);
+	}
+
+	~StackScene()
+	{
+		for (int i = 0; i < m_bodies.size(); ++i)
+		{
+			m_world->removeRigidBody(m_bodies[i]);
+			delete m_bodies[i];
+		}
+		delete m_world;
+		delete m_solver;
+		delete m_solverPool;
+		delete m_groundShape;
+		delete m_boxShape;
+		delete m_broadphase;
+		delete m_dispatcher;
+		delete m_collisionConfiguration;
+	}
+
+	void step(int numSteps)
+	{
+		for (int i = 0; i < numSteps; ++i)
+		{
+			m_world->stepSimulation(btScalar(1.) / btScalar(60.), 0);
+		}
+	}
+
+	// the islands of every solver call of the last step
+	void getIslandAnalyticsData(btAlignedObjectArray<btSolverIslandAnalyticsData>& islandData, int& numBodies) const
+	{
+		btAlignedObjectArray<btSolverAnalyticsData> analyticsData;
+		m_world->getAnalyticsData(analyticsData);
+		islandData.resize(0);
+		numBodies = 0;
+		for (int i = 0; i < analyticsData.size(); ++i)
+		{
+			numBodies += analyticsData[i].m_numBodies;
+			for (int j = 0; j < analyticsData[i].m_islands.size(); ++j)
+			{
+				islandData.push_back(analyticsData[i].m_islands[j]);
+			}
+		}
+		// the multithreaded world batches the islands in another order
+		islandData.quickSort(IslandIdLess());
+	}
+};
+
+const int kNumSteps = 10;
+}  // namespace
+
+TEST(DiscreteDynamicsWorldMtTest, AnalyticsMatchSerialWorld)
+{
+	btAlignedObjectArray<btSolverIslandAnalyticsData> expectedData;
+	int expectedNumBodies;
+	{
+		StackScene scene(false);
+		scene.step(kNumSteps);
+		scene.getIslandAnalyticsData(expectedData, expectedNumBodies);
+	}
+	ASSERT_EQ(StackScene::NUM_STACKS, expectedData.size());
+
+	btAlignedObjectArray<btSolverIslandAnalyticsData> singleThreadData;
+	for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+	{
+		setNumThreads(numThreads);
+		StackScene scene(true);
+		scene.step(kNumSteps);
+		btAlignedObjectArray<btSolverIslandAnalyticsData> islandData;
+		int numBodies;
+		scene.getIslandAnalyticsData(islandData, numBodies);
+		EXPECT_EQ(expectedNumBodies, numBodies) << "threads " << numThreads;
+		ASSERT_EQ(expectedData.size(), islandData.size()) << "threads " << numThreads;
+		for (int i = 0; i < islandData.size(); ++i)
+		{
+			const btSolverIslandAnalyticsData& expected = expectedData[i];
+			const btSolverIslandAnalyticsData& data = islandData[i];
+			EXPECT_EQ(expected.m_islandId, data.m_islandId) << "island " << i << " threads " << numThreads;
+			EXPECT_EQ(expected.m_numBodies, data.m_numBodies) << "island " << i << " threads " << numThreads;
+			// the rows of a batch are solved in another order than in the serial world, so an island can converge earlier or later
+			EXPECT_GT(data.m_numIterationsUsed, 0) << "island " << i << " threads " << numThreads;
+			EXPECT_LE(data.m_numIterationsUsed, scene.m_world->getSolverInfo().m_numIterations) << "island " << i << " threads " << numThreads;
+		}
+		// the batches do not depend on the number of threads
+		if (numThreads == 1)
+		{
+			singleThreadData = islandData;
+		}
+		for (int i = 0; i < islandData.size(); ++i)
+		{
+			EXPECT_EQ(singleThreadData[i].m_numIterationsUsed, islandData[i].m_numIterationsUsed) << "island " << i << " threads " << numThreads;
+			EXPECT_EQ(singleThreadData[i].m_remainingLeastSquaresResidual, islandData[i].m_remainingLeastSquaresResidual) << "island " << i << " threads " << numThreads;
+		}
+	}
+}
+
+#endif  //BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+	btTestAllocator::install();
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
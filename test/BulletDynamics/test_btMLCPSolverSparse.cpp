@@ -0,0 +1,228 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/MLCPSolvers/btMLCPSolver.h>
+#include <BulletDynamics/MLCPSolvers/btSolveProjectedGaussSeidel.h>
+#include <BulletDynamics/MLCPSolvers/btSolveSparseProjectedGaussSeidel.h>
+#include <gtest/gtest.h>
+#include "btTestAllocator.h"
+
+namespace
+{
+// builds the sparse A as usual, and also the dense A of createMLCPFast, then solves both with projected Gauss-Seidel
+class MLCPSparseComparisonSolver : public btMLCPSolver
+{
+	btSolveSparseProjectedGaussSeidel m_sparsePgs;
+	btSolveProjectedGaussSeidel m_densePgs;
+
+public:
+	int m_numComparedRows;
+	btScalar m_maxMatrixError;
+	btScalar m_maxImpulseError;
+	btScalar m_maxImpulse;
+	int m_maxRows;
+	int m_maxRowsNonZeroElements;
+
+	MLCPSparseComparisonSolver()
+		: btMLCPSolver(&m_sparsePgs),
+		  m_numComparedRows(0),
+		  m_maxMatrixError(0),
+		  m_maxImpulseError(0),
+		  m_maxImpulse(0),
+		  m_maxRows(0),
+		  m_maxRowsNonZeroElements(0)
+	{
+	}
+
+protected:
+	virtual void createMLCPSparse(const btContactSolverInfo& infoGlobal)
+	{
+		btMLCPSolver::createMLCPSparse(infoGlobal);
+		btVectorXu x = m_x;
+		createMLCPFast(infoGlobal);
+
+		int n = m_A.rows();
+		ASSERT_EQ(n, m_sparseA.rows());
+		btMatrixXu sparseToDense;
+		m_sparseA.toDense(sparseToDense);
+		btScalar maxElement = 0;
+		for (int i = 0; i < n; i++)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				maxElement = btMax(maxElement, btFabs(m_A(i, j)));
+			}
+		}
+		for (int i = 0; i < n; i++)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				m_maxMatrixError = btMax(m_maxMatrixError, btFabs(sparseToDense(i, j) - m_A(i, j)) / maxElement);
+			}
+		}
+
+		btVectorXu denseX = x;
+		m_densePgs.solveMLCP(m_A, m_b, denseX, m_lo, m_hi, m_limitDependencies, infoGlobal.m_numIterations);
+		btVectorXu sparseX = x;
+		m_sparsePgs.solveSparseMLCP(m_sparseA, m_b, sparseX, m_lo, m_hi, m_limitDependencies, infoGlobal.m_numIterations);
+		for (int i = 0; i < n; i++)
+		{
+			m_maxImpulse = btMax(m_maxImpulse, btFabs(denseX[i]));
+			m_maxImpulseError = btMax(m_maxImpulseError, btFabs(denseX[i] - sparseX[i]));
+		}
+		m_numComparedRows += n;
+		if (n > m_maxRows)
+		{
+			m_maxRows = n;
+			m_maxRowsNonZeroElements = m_sparseA.getNumNonZeroElements();
+		}
+	}
+};
+
+// stacks of boxes on a static ground, and a chain of boxes joined by hinges, so A has contact, friction and joint rows
+struct MLCPScene
+{
+	btDefaultCollisionConfiguration* m_collisionConfiguration;
+	btCollisionDispatcher* m_dispatcher;
+	btDbvtBroadphase* m_broadphase;
+	btConstraintSolver* m_solver;
+	btDiscreteDynamicsWorld* m_world;
+	btBoxShape* m_boxShape;
+	btBoxShape* m_groundShape;
+	btAlignedObjectArray<btRigidBody*> m_bodies;
+	btAlignedObjectArray<btTypedConstraint*> m_constraints;
+
+	explicit MLCPScene(btConstraintSolver* solver)
+	{
+		m_collisionConfiguration = new btDefaultCollisionConfiguration();
+		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+		m_broadphase = new btDbvtBroadphase();
+		m_solver = solver;
+		m_world = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+		m_world->setGravity(btVector3(0, -10, 0));
+		m_world->getSolverInfo().m_numIterations = 30;
+		m_boxShape = new btBoxShape(btVector3(0.5f, 0.5f, 0.5f));
+		m_groundShape = new btBoxShape(btVector3(50.f, 0.5f, 50.f));
+
+		addBody(0.f, m_groundShape, btVector3(0.f, -0.5f, 0.f));
+		for (int stack = 0; stack < 3; ++stack)
+		{
+			for (int level = 0; level < 4; ++level)
+			{
+				addBody(1.f, m_boxShape, btVector3(btScalar(stack) * 2.f, 0.5f + btScalar(level) * 1.01f, 0.f));
+			}
+		}
+		btRigidBody* previous = 0;
+		for (int link = 0; link < 3; ++link)
+		{
+			btRigidBody* body = addBody(1.f, m_boxShape, btVector3(-3.f + btScalar(link) * 1.2f, 4.f, 0.f));
+			btHingeConstraint* hinge;
+			if (previous)
+			{
+				hinge = new btHingeConstraint(*previous, *body, btVector3(0.6f, 0.f, 0.f), btVector3(-0.6f, 0.f, 0.f), btVector3(0, 0, 1), btVector3(0, 0, 1));
+			}
+			else
+			{
+				hinge = new btHingeConstraint(*body, btVector3(-0.6f, 0.f, 0.f), btVector3(0, 0, 1));
+			}
+			hinge->setLimit(-0.5f, 0.5f);
+			m_world->addConstraint(hinge, true);
+			m_constraints.push_back(hinge);
+			previous = body;
+		}
+	}
+
+	btRigidBody* addBody(btScalar mass, btCollisionShape* shape, const btVector3& position)
+	{
+		btVector3 inertia(0, 0, 0);
+		if (mass > 0)
+		{
+			shape->calculateLocalInertia(mass, inertia);
+		}
+		btTransform transform;
+		transform.setIdentity();
+		transform.setOrigin(position);
+		btRigidBody* body = new btRigidBody(mass, 0, shape, inertia);
+		body->setWorldTransform(transform);
+		body->setInterpolationWorldTransform(transform);
+		m_world->addRigidBody(body);
+		m_bodies.push_back(body);
+		return body;
+	}
+
+	~MLCPScene()
+	{
+		for (int i = 0; i < m_constraints.size(); ++i)
+		{
+			m_world->removeConstraint(m_constraints[i]);
+			delete m_constraints[i];
+		}
+		for (int i = 0; i < m_bodies.size(); ++i)
+		{
+			m_world->removeRigidBody(m_bodies[i]);
+			delete m_bodies[i];
+		}
+		delete m_world;
+		delete m_solver;
+		delete m_groundShape;
+		delete m_boxShape;
+		delete m_broadphase;
+		delete m_dispatcher;
+		delete m_collisionConfiguration;
+	}
+
+	void step(int numSteps)
+	{
+		for (int i = 0; i < numSteps; ++i)
+		{
+			m_world->stepSimulation(btScalar(1.) / btScalar(60.), 0);
+		}
+	}
+};
+}  // namespace
+
+TEST(MLCPSolverSparseTest, SparseMatrixMatchesDenseMatrix)
+{
+	MLCPSparseComparisonSolver* solver = new MLCPSparseComparisonSolver();
+	MLCPScene scene(solver);
+	scene.step(30);
+
+	ASSERT_GT(solver->m_numComparedRows, 1000);
+	EXPECT_LT(solver->m_maxMatrixError, btScalar(1e-5));
+	// rows that share no body have no element
+	EXPECT_LT(solver->m_maxRowsNonZeroElements, solver->m_maxRows * solver->m_maxRows / 4);
+	// the same iterations in the same row order, only the sums are done in another order
+	EXPECT_GT(solver->m_maxImpulse, btScalar(0.1));
+	EXPECT_LT(solver->m_maxImpulseError, solver->m_maxImpulse * btScalar(1e-3));
+}
+
+TEST(MLCPSolverSparseTest, SparseSolverMatchesDenseSolver)
+{
+	btAlignedObjectArray<btVector3> expectedPositions;
+	btSolveProjectedGaussSeidel densePgs;
+	{
+		MLCPScene scene(new btMLCPSolver(&densePgs));
+		scene.step(20);
+		for (int i = 0; i < scene.m_bodies.size(); ++i)
+		{
+			expectedPositions.push_back(scene.m_bodies[i]->getWorldTransform().getOrigin());
+		}
+	}
+	btSolveSparseProjectedGaussSeidel sparsePgs;
+	MLCPScene scene(new btMLCPSolver(&sparsePgs));
+	scene.step(20);
+	for (int i = 0; i < scene.m_bodies.size(); ++i)
+	{
+		const btVector3& position = scene.m_bodies[i]->getWorldTransform().getOrigin();
+		for (int k = 0; k < 3; ++k)
+		{
+			EXPECT_NEAR(expectedPositions[i][k], position[k], btScalar(1e-3)) << "body " << i;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	btTestAllocator::install();
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,247 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Featherstone/btMultiBody.h>
+#include <BulletDynamics/Featherstone/btMultiBodyConstraintSolver.h>
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h>
+#include <BulletDynamics/Featherstone/btMultiBodyLinkCollider.h>
+#include <gtest/gtest.h>
+#include "btTestAllocator.h"
+
+namespace
+{
+// keeps the Jacobians and responses of the rows of the last setup
+class RowRecordingSolver : public btMultiBodyConstraintSolver
+{
+public:
+	btAlignedObjectArray<btScalar> m_jacobians;
+	btAlignedObjectArray<btScalar> m_deltaVelocitiesUnitImpulse;
+	int m_numLinkResponseValues;
+
+	RowRecordingSolver() : m_numLinkResponseValues(0) {}
+
+protected:
+	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
+	{
+		btScalar result = btMultiBodyConstraintSolver::solveGroupCacheFriendlySetup(bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+		m_jacobians = m_data.m_jacobians;
+		m_deltaVelocitiesUnitImpulse = m_data.m_deltaVelocitiesUnitImpulse;
+		m_numLinkResponseValues = m_linkResponses.size();
+		return result;
+	}
+};
+
+// chains of boxes lying on the ground, so every link has a manifold of 4 points, with rolling and spinning friction
+struct LyingChainScene
+{
+	enum
+	{
+		NUM_CHAINS = 3,
+		NUM_LINKS = 4
+	};
+
+	btDefaultCollisionConfiguration* m_collisionConfiguration;
+	btCollisionDispatcher* m_dispatcher;
+	btDbvtBroadphase* m_broadphase;
+	RowRecordingSolver* m_solver;
+	btMultiBodyDynamicsWorld* m_world;
+	btBoxShape* m_linkShape;
+	btBoxShape* m_groundShape;
+	btRigidBody* m_ground;
+	btAlignedObjectArray<btMultiBody*> m_multiBodies;
+	btAlignedObjectArray<btMultiBodyLinkCollider*> m_colliders;
+
+	LyingChainScene(int minContactRowsForLinkResponses, int solverMode)
+	{
+		m_collisionConfiguration = new btDefaultCollisionConfiguration();
+		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+		m_broadphase = new btDbvtBroadphase();
+		m_solver = new RowRecordingSolver();
+		m_solver->setMinContactRowsForLinkResponses(minContactRowsForLinkResponses);
+		m_world = new btMultiBodyDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+		m_world->setGravity(btVector3(0, -10, 0));
+		m_world->getSolverInfo().m_solverMode = solverMode;
+		m_linkShape = new btBoxShape(btVector3(0.1f, 0.25f, 0.1f));
+		m_groundShape = new btBoxShape(btVector3(50.f, 0.5f, 50.f));
+
+		btTransform groundTransform;
+		groundTransform.setIdentity();
+		groundTransform.setOrigin(btVector3(0.f, -0.5f, 0.f));
+		m_ground = new btRigidBody(0.f, 0, m_groundShape, btVector3(0, 0, 0));
+		m_ground->setWorldTransform(groundTransform);
+		m_ground->setInterpolationWorldTransform(groundTransform);
+		m_world->addRigidBody(m_ground);
+
+		for (int i = 0; i < NUM_CHAINS; ++i)
+		{
+			addChain(btVector3(btScalar(i) * 1.f, 0.099f, 0.f));
+		}
+	}
+
+	void addChain(const btVector3& basePos)
+	{
+		btVector3 inertia;
+		m_linkShape->calculateLocalInertia(1.f, inertia);
+		btMultiBody* mb = new btMultiBody(NUM_LINKS, 1.f, inertia, false, false);
+		mb->setBasePos(basePos);
+		mb->setWorldToBaseRot(btQuaternion(btVector3(1, 0, 0), -SIMD_HALF_PI));
+		for (int link = 0; link < NUM_LINKS; ++link)
+		{
+			mb->setupRevolute(link, 1.f, inertia, link - 1, btQuaternion::getIdentity(), btVector3(0, 0, 1), btVector3(0, 0.26f, 0), btVector3(0, 0.26f, 0), true);
+		}
+		mb->finalizeMultiDof();
+		for (int link = 0; link < NUM_LINKS; ++link)
+		{
+			mb->setJointVel(link, 0.5f);
+		}
+		m_world->addMultiBody(mb);
+		m_multiBodies.push_back(mb);
+
+		btAlignedObjectArray<btQuaternion> scratchWorldToLocal;
+		btAlignedObjectArray<btVector3> scratchLocalOrigin;
+		mb->forwardKinematics(scratchWorldToLocal, scratchLocalOrigin);
+		for (int link = -1; link < NUM_LINKS; ++link)
+		{
+			btMultiBodyLinkCollider* collider = new btMultiBodyLinkCollider(mb, link);
+			collider->setCollisionShape(m_linkShape);
+			collider->setFriction(0.8f);
+			collider->setRollingFriction(0.01f);
+			collider->setSpinningFriction(0.01f);
+			if (link < 0)
+			{
+				mb->setBaseCollider(collider);
+			}
+			else
+			{
+				mb->getLink(link).m_collider = collider;
+			}
+			m_world->addCollisionObject(collider, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter);
+			m_colliders.push_back(collider);
+		}
+		mb->updateCollisionObjectWorldTransforms(scratchWorldToLocal, scratchLocalOrigin);
+	}
+
+	~LyingChainScene()
+	{
+		for (int i = 0; i < m_colliders.size(); ++i)
+		{
+			m_world->removeCollisionObject(m_colliders[i]);
+			delete m_colliders[i];
+		}
+		for (int i = 0; i < m_multiBodies.size(); ++i)
+		{
+			m_world->removeMultiBody(m_multiBodies[i]);
+			delete m_multiBodies[i];
+		}
+		m_world->removeRigidBody(m_ground);
+		delete m_ground;
+		delete m_world;
+		delete m_solver;
+		delete m_groundShape;
+		delete m_linkShape;
+		delete m_broadphase;
+		delete m_dispatcher;
+		delete m_collisionConfiguration;
+	}
+
+	void step(int numSteps)
+	{
+		for (int i = 0; i < numSteps; ++i)
+		{
+			m_world->stepSimulation(btScalar(1.) / btScalar(60.), 0);
+		}
+	}
+};
+
+// the largest difference relative to the largest value
+btScalar getRelativeError(const btAlignedObjectArray<btScalar>& expected, const btAlignedObjectArray<btScalar>& values)
+{
+	btScalar maxValue = 0;
+	btScalar maxError = 0;
+	for (int i = 0; i < expected.size(); ++i)
+	{
+		maxValue = btMax(maxValue, btFabs(expected[i]));
+		maxError = btMax(maxError, btFabs(expected[i] - values[i]));
+	}
+	return maxValue > 0 ? maxError / maxValue : maxError;
+}
+
+const int kPerRowPasses = 1 << 30;
+
+void checkRowsMatchPerRowPasses(int solverMode)
+{
+	LyingChainScene expectedScene(kPerRowPasses, solverMode);
+	expectedScene.step(1);
+	LyingChainScene scene(8, solverMode);
+	scene.step(1);
+
+	// a manifold of 4 points with spinning and rolling friction gives each link at least 5 rows per point
+	EXPECT_EQ(0, expectedScene.m_solver->m_numLinkResponseValues);
+	const int numResponseValues = 12 * (6 + LyingChainScene::NUM_LINKS);
+	EXPECT_EQ(LyingChainScene::NUM_CHAINS * (LyingChainScene::NUM_LINKS + 1) * numResponseValues, scene.m_solver->m_numLinkResponseValues);
+
+	const btAlignedObjectArray<btScalar>& expectedJacobians = expectedScene.m_solver->m_jacobians;
+	const btAlignedObjectArray<btScalar>& expectedDeltas = expectedScene.m_solver->m_deltaVelocitiesUnitImpulse;
+	ASSERT_GE(expectedJacobians.size(), 5 * 4 * LyingChainScene::NUM_CHAINS * (LyingChainScene::NUM_LINKS + 1) * (6 + LyingChainScene::NUM_LINKS));
+	ASSERT_EQ(expectedJacobians.size(), scene.m_solver->m_jacobians.size());
+	ASSERT_EQ(expectedDeltas.size(), scene.m_solver->m_deltaVelocitiesUnitImpulse.size());
+	EXPECT_LT(getRelativeError(expectedJacobians, scene.m_solver->m_jacobians), btScalar(1e-5));
+	EXPECT_LT(getRelativeError(expectedDeltas, scene.m_solver->m_deltaVelocitiesUnitImpulse), btScalar(1e-5));
+}
+
+void getJointPositions(const LyingChainScene& scene, btAlignedObjectArray<btScalar>& positions)
+{
+	positions.resize(0);
+	for (int i = 0; i < scene.m_multiBodies.size(); ++i)
+	{
+		const btMultiBody* mb = scene.m_multiBodies[i];
+		for (int k = 0; k < 3; ++k)
+		{
+			positions.push_back(mb->getBasePos()[k]);
+		}
+		for (int link = 0; link < mb->getNumLinks(); ++link)
+		{
+			positions.push_back(mb->getJointPos(link));
+		}
+	}
+}
+}  // namespace
+
+TEST(MultiBodyConstraintSolverTest, LinkResponsesMatchPerRowPasses)
+{
+	checkRowsMatchPerRowPasses(SOLVER_USE_WARMSTARTING | SOLVER_SIMD);
+}
+
+TEST(MultiBodyConstraintSolverTest, LinkResponsesMatchPerRowPassesWithTwoFrictionDirections)
+{
+	checkRowsMatchPerRowPasses(SOLVER_USE_WARMSTARTING | SOLVER_SIMD | SOLVER_USE_2_FRICTION_DIRECTIONS);
+}
+
+TEST(MultiBodyConstraintSolverTest, LinkResponsesSimulateLikePerRowPasses)
+{
+	const int solverMode = SOLVER_USE_WARMSTARTING | SOLVER_SIMD | SOLVER_USE_2_FRICTION_DIRECTIONS;
+	// the chains roll and slide on the ground, a change of 1e-7 in their velocities makes them differ by 0.02 after 16
+	// steps, so only the first steps are compared
+	const int numSteps = 8;
+	btAlignedObjectArray<btScalar> expectedPositions;
+	{
+		LyingChainScene scene(kPerRowPasses, solverMode);
+		scene.step(numSteps);
+		getJointPositions(scene, expectedPositions);
+	}
+	LyingChainScene scene(8, solverMode);
+	scene.step(numSteps);
+	btAlignedObjectArray<btScalar> positions;
+	getJointPositions(scene, positions);
+	ASSERT_EQ(expectedPositions.size(), positions.size());
+	for (int i = 0; i < positions.size(); ++i)
+	{
+		EXPECT_NEAR(expectedPositions[i], positions[i], btScalar(1e-4)) << "position " << i;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	btTestAllocator::install();
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
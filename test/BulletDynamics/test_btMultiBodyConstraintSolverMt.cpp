@@ -0,0 +1,237 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Featherstone/btMultiBody.h>
+#include <BulletDynamics/Featherstone/btMultiBodyConstraintSolverMt.h>
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h>
+#include <BulletDynamics/Featherstone/btMultiBodyJointLimitConstraint.h>
+#include <BulletDynamics/Featherstone/btMultiBodyJointMotor.h>
+#include <BulletDynamics/Featherstone/btMultiBodyLinkCollider.h>
+#include <gtest/gtest.h>
+#include "btTestAllocator.h"
+
+#if BT_THREADSAFE
+
+#include "btTestTaskScheduler.h"
+
+namespace
+{
+void setNumThreads(int numThreads)
+{
+	btTestTaskScheduler::get()->setNumThreads(numThreads);
+}
+
+// upright chains of boxes joined by revolute joints on a static ground, close enough to touch their neighbours when
+// the motor and the limit of each chain make them sway
+struct MultiBodyChainScene
+{
+	enum
+	{
+		NUM_CHAINS = 48,
+		NUM_LINKS = 3
+	};
+
+	btDefaultCollisionConfiguration* m_collisionConfiguration;
+	btCollisionDispatcher* m_dispatcher;
+	btDbvtBroadphase* m_broadphase;
+	btMultiBodyConstraintSolver* m_solver;
+	btMultiBodyDynamicsWorld* m_world;
+	btBoxShape* m_boxShape;
+	btBoxShape* m_groundShape;
+	btRigidBody* m_ground;
+	btAlignedObjectArray<btMultiBody*> m_multiBodies;
+	btAlignedObjectArray<btMultiBodyLinkCollider*> m_colliders;
+	btAlignedObjectArray<btMultiBodyConstraint*> m_constraints;
+
+	explicit MultiBodyChainScene(btMultiBodyConstraintSolver* solver)
+	{
+		m_collisionConfiguration = new btDefaultCollisionConfiguration();
+		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+		m_broadphase = new btDbvtBroadphase();
+		m_solver = solver;
+		m_world = new btMultiBodyDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+		m_world->setGravity(btVector3(0, -10, 0));
+		m_world->getSolverInfo().m_numIterations = 50;
+		m_boxShape = new btBoxShape(btVector3(0.2f, 0.2f, 0.2f));
+		m_groundShape = new btBoxShape(btVector3(50.f, 0.5f, 50.f));
+
+		btTransform groundTransform;
+		groundTransform.setIdentity();
+		groundTransform.setOrigin(btVector3(0.f, -0.5f, 0.f));
+		m_ground = new btRigidBody(0.f, 0, m_groundShape);
+		m_ground->setWorldTransform(groundTransform);
+		m_world->addRigidBody(m_ground);
+
+		for (int i = 0; i < NUM_CHAINS; ++i)
+		{
+			addChain(btVector3(btScalar(i % 8) * 0.42f, 0.2f, btScalar(i / 8) * 0.42f));
+		}
+	}
+
+	void addChain(const btVector3& basePos)
+	{
+		btVector3 inertia;
+		m_boxShape->calculateLocalInertia(1.f, inertia);
+		btMultiBody* mb = new btMultiBody(NUM_LINKS, 1.f, inertia, false, false);
+		mb->setBasePos(basePos);
+		const btVector3 hingeAxis(0, 0, 1);
+		const btVector3 halfOffset(0, 0.25f, 0);
+		for (int link = 0; link < NUM_LINKS; ++link)
+		{
+			mb->setupRevolute(link, 1.f, inertia, link - 1, btQuaternion::getIdentity(), hingeAxis, halfOffset, halfOffset, true);
+		}
+		mb->finalizeMultiDof();
+		mb->setJointPos(0, 0.3f);
+		m_world->addMultiBody(mb);
+		m_multiBodies.push_back(mb);
+
+		btAlignedObjectArray<btQuaternion> scratchWorldToLocal;
+		btAlignedObjectArray<btVector3> scratchLocalOrigin;
+		mb->forwardKinematics(scratchWorldToLocal, scratchLocalOrigin);
+		for (int link = -1; link < NUM_LINKS; ++link)
+		{
+			btMultiBodyLinkCollider* collider = new btMultiBodyLinkCollider(mb, link);
+			collider->setCollisionShape(m_boxShape);
+			m_world->addCollisionObject(collider, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter);
+			if (link < 0)
+			{
+				mb->setBaseCollider(collider);
+			}
+			else
+			{
+				mb->getLink(link).m_collider = collider;
+			}
+			m_colliders.push_back(collider);
+		}
+		mb->updateCollisionObjectWorldTransforms(scratchWorldToLocal, scratchLocalOrigin);
+
+		// non-contact rows
+		btMultiBodyConstraint* motor = new btMultiBodyJointMotor(mb, 1, 1.f, 5.f);
+		m_world->addMultiBodyConstraint(motor);
+		m_constraints.push_back(motor);
+		btMultiBodyConstraint* limit = new btMultiBodyJointLimitConstraint(mb, 2, -0.5f, 0.5f);
+		m_world->addMultiBodyConstraint(limit);
+		m_constraints.push_back(limit);
+	}
+
+	~MultiBodyChainScene()
+	{
+		for (int i = 0; i < m_constraints.size(); ++i)
+		{
+			m_world->removeMultiBodyConstraint(m_constraints[i]);
+			delete m_constraints[i];
+		}
+		for (int i = 0; i < m_colliders.size(); ++i)
+		{
+			m_world->removeCollisionObject(m_colliders[i]);
+			delete m_colliders[i];
+		}
+		for (int i = 0; i < m_multiBodies.size(); ++i)
+		{
+			m_world->removeMultiBody(m_multiBodies[i]);
+			delete m_multiBodies[i];
+		}
+		m_world->removeRigidBody(m_ground);
+		delete m_ground;
+		delete m_world;
+		delete m_solver;
+		delete m_groundShape;
+		delete m_boxShape;
+		delete m_broadphase;
+		delete m_dispatcher;
+		delete m_collisionConfiguration;
+	}
+
+	void step(int numSteps)
+	{
+		for (int i = 0; i < numSteps; ++i)
+		{
+			m_world->stepSimulation(btScalar(1.) / btScalar(60.), 0);
+		}
+	}
+
+	// base position, base rotation and joint positions of every chain
+	void getState(btAlignedObjectArray<btScalar>& state) const
+	{
+		state.resize(0);
+		for (int i = 0; i < m_multiBodies.size(); ++i)
+		{
+			const btMultiBody* mb = m_multiBodies[i];
+			for (int k = 0; k < 3; ++k)
+			{
+				state.push_back(mb->getBasePos()[k]);
+			}
+			for (int k = 0; k < 4; ++k)
+			{
+				state.push_back(mb->getWorldToBaseRot()[k]);
+			}
+			for (int link = 0; link < mb->getNumLinks(); ++link)
+			{
+				state.push_back(mb->getJointPos(link));
+			}
+		}
+	}
+};
+
+const int kNumSteps = 20;
+
+// the batched solver visits the rows in another order, so it converges to a slightly different solution
+const btScalar kTolerance = btScalar(0.01);
+}  // namespace
+
+TEST(MultiBodyConstraintSolverMtTest, BatchedRowsMatchSerialSolver)
+{
+	btAlignedObjectArray<btScalar> expectedState;
+	{
+		MultiBodyChainScene scene(new btMultiBodyConstraintSolver());
+		scene.step(kNumSteps);
+		scene.getState(expectedState);
+	}
+
+	// batch the small scene into many small batches
+	const int minimumRowsForBatching = btMultiBodyConstraintSolverMt::s_minimumRowsForBatching;
+	const int minBatchSize = btMultiBodyConstraintSolverMt::s_minBatchSize;
+	const int maxBatchSize = btMultiBodyConstraintSolverMt::s_maxBatchSize;
+	btMultiBodyConstraintSolverMt::s_minimumRowsForBatching = 1;
+	btMultiBodyConstraintSolverMt::s_minBatchSize = 4;
+	btMultiBodyConstraintSolverMt::s_maxBatchSize = 8;
+	btAlignedObjectArray<btScalar> singleThreadState;
+	for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+	{
+		setNumThreads(numThreads);
+		btMultiBodyConstraintSolverMt* solver = new btMultiBodyConstraintSolverMt();
+		MultiBodyChainScene scene(solver);
+		scene.step(kNumSteps);
+		// the chains touch the ground and each other, so contact and non-contact rows were batched in the last step
+		EXPECT_GT(solver->getBatchedNormalContactConstraints().m_batches.size(), 1);
+		EXPECT_GT(solver->getBatchedNonContactConstraints().m_batches.size(), 1);
+
+		btAlignedObjectArray<btScalar> state;
+		scene.getState(state);
+		ASSERT_EQ(expectedState.size(), state.size());
+		for (int i = 0; i < state.size(); ++i)
+		{
+			EXPECT_NEAR(expectedState[i], state[i], kTolerance) << "state " << i << " threads " << numThreads;
+		}
+		// the batches do not depend on the number of threads
+		if (numThreads == 1)
+		{
+			singleThreadState = state;
+		}
+		for (int i = 0; i < state.size(); ++i)
+		{
+			EXPECT_EQ(singleThreadState[i], state[i]) << "state " << i << " threads " << numThreads;
+		}
+	}
+	btMultiBodyConstraintSolverMt::s_minimumRowsForBatching = minimumRowsForBatching;
+	btMultiBodyConstraintSolverMt::s_minBatchSize = minBatchSize;
+	btMultiBodyConstraintSolverMt::s_maxBatchSize = maxBatchSize;
+}
+
+#endif  //BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+	btTestAllocator::install();
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,307 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Featherstone/btMultiBody.h>
+#include <BulletDynamics/Featherstone/btMultiBodyConstraintSolver.h>
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h>
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorldMt.h>
+#include <BulletDynamics/Featherstone/btMultiBodyJointMotor.h>
+#include <BulletDynamics/Featherstone/btMultiBodyLinkCollider.h>
+#include <gtest/gtest.h>
+#include "btTestAllocator.h"
+
+#if BT_THREADSAFE
+
+#include "btTestTaskScheduler.h"
+
+namespace
+{
+void setNumThreads(int numThreads)
+{
+	btTestTaskScheduler::get()->setNumThreads(numThreads);
+}
+
+// rows of posts, multibodies with a static base collider and two motorized links, each with a free chain lying
+// against its base, and boxes falling on the chains
+struct MultiBodyWorldScene
+{
+	enum
+	{
+		NUM_POSTS = 16,
+		NUM_CHAIN_LINKS = 2
+	};
+
+	btDefaultCollisionConfiguration* m_collisionConfiguration;
+	btCollisionDispatcher* m_dispatcher;
+	btDbvtBroadphase* m_broadphase;
+	btMultiBodyConstraintSolver* m_solver;
+	btMultiBodyConstraintSolverPoolMt* m_solverPool;
+	btMultiBodyDynamicsWorld* m_world;
+	btBoxShape* m_linkShape;
+	btBoxShape* m_postBaseShape;
+	btBoxShape* m_groundShape;
+	btAlignedObjectArray<btRigidBody*> m_rigidBodies;
+	btAlignedObjectArray<btMultiBody*> m_multiBodies;
+	btAlignedObjectArray<btMultiBodyLinkCollider*> m_colliders;
+	btAlignedObjectArray<btMultiBodyConstraint*> m_constraints;
+
+	explicit MultiBodyWorldScene(bool multithreaded)
+	{
+		m_collisionConfiguration = new btDefaultCollisionConfiguration();
+		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+		m_broadphase = new btDbvtBroadphase();
+		m_solver = 0;
+		m_solverPool = 0;
+		if (multithreaded)
+		{
+			m_solverPool = new btMultiBodyConstraintSolverPoolMt(BT_MAX_THREAD_COUNT);
+			m_world = new btMultiBodyDynamicsWorldMt(m_dispatcher, m_broadphase, m_solverPool, m_collisionConfiguration);
+		}
+		else
+		{
+			m_solver = new btMultiBodyConstraintSolver();
+			m_world = new btMultiBodyDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+		}
+		m_world->setGravity(btVector3(0, -10, 0));
+		m_world->getSolverInfo().m_numIterations = 50;
+		m_linkShape = new btBoxShape(btVector3(0.1f, 0.25f, 0.1f));
+		m_postBaseShape = new btBoxShape(btVector3(0.3f, 0.3f, 0.3f));
+		m_groundShape = new btBoxShape(btVector3(50.f, 0.5f, 50.f));
+
+		addRigidBody(0.f, m_groundShape, btVector3(0.f, -0.5f, 0.f));
+		for (int i = 0; i < NUM_POSTS; ++i)
+		{
+			btVector3 postPos(btScalar(i % 4) * 3.f, 0.3f, btScalar(i / 4) * 3.f);
+			addPost(postPos);
+			// a chain lying on the ground, pressed against the base of the post by its first link
+			addChain(postPos + btVector3(0.54f, -0.2f, 0.f));
+			addRigidBody(1.f, m_linkShape, postPos + btVector3(0.6f, 0.5f, 0.05f));
+		}
+	}
+
+	void addRigidBody(btScalar mass, btCollisionShape* shape, const btVector3& position)
+	{
+		btVector3 inertia(0, 0, 0);
+		if (mass > 0)
+		{
+			shape->calculateLocalInertia(mass, inertia);
+		}
+		btTransform transform;
+		transform.setIdentity();
+		transform.setOrigin(position);
+		btRigidBody* body = new btRigidBody(mass, 0, shape, inertia);
+		body->setWorldTransform(transform);
+		body->setInterpolationWorldTransform(transform);
+		m_world->addRigidBody(body);
+		m_rigidBodies.push_back(body);
+	}
+
+	void addColliders(btMultiBody* mb, btCollisionShape* baseShape, bool staticBase)
+	{
+		btAlignedObjectArray<btQuaternion> scratchWorldToLocal;
+		btAlignedObjectArray<btVector3> scratchLocalOrigin;
+		mb->forwardKinematics(scratchWorldToLocal, scratchLocalOrigin);
+		for (int link = -1; link < mb->getNumLinks(); ++link)
+		{
+			btMultiBodyLinkCollider* collider = new btMultiBodyLinkCollider(mb, link);
+			if (link < 0)
+			{
+				collider->setCollisionShape(baseShape);
+				mb->setBaseCollider(collider);
+			}
+			else
+			{
+				collider->setCollisionShape(m_linkShape);
+				mb->getLink(link).m_collider = collider;
+			}
+			if (link < 0 && staticBase)
+			{
+				collider->setCollisionFlags(collider->getCollisionFlags() | btCollisionObject::CF_STATIC_OBJECT);
+				m_world->addCollisionObject(collider, btBroadphaseProxy::StaticFilter, btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter);
+			}
+			else
+			{
+				m_world->addCollisionObject(collider, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter);
+			}
+			m_colliders.push_back(collider);
+		}
+		mb->updateCollisionObjectWorldTransforms(scratchWorldToLocal, scratchLocalOrigin);
+	}
+
+	void addPost(const btVector3& basePos)
+	{
+		btVector3 linkInertia;
+		m_linkShape->calculateLocalInertia(1.f, linkInertia);
+		btMultiBody* mb = new btMultiBody(2, 0.f, btVector3(0, 0, 0), true, false);
+		mb->setBasePos(basePos);
+		mb->setupRevolute(0, 1.f, linkInertia, -1, btQuaternion::getIdentity(), btVector3(0, 0, 1), btVector3(0, 0.32f, 0), btVector3(0, 0.25f, 0), true);
+		mb->setupRevolute(1, 1.f, linkInertia, 0, btQuaternion::getIdentity(), btVector3(1, 0, 0), btVector3(0, 0.25f, 0), btVector3(0, 0.25f, 0), true);
+		mb->finalizeMultiDof();
+		m_world->addMultiBody(mb);
+		m_multiBodies.push_back(mb);
+		addColliders(mb, m_postBaseShape, true);
+
+		btMultiBodyConstraint* motor = new btMultiBodyJointMotor(mb, 0, 0.5f, 10.f);
+		m_world->addMultiBodyConstraint(motor);
+		m_constraints.push_back(motor);
+	}
+
+	void addChain(const btVector3& basePos)
+	{
+		btVector3 inertia;
+		m_linkShape->calculateLocalInertia(1.f, inertia);
+		btMultiBody* mb = new btMultiBody(NUM_CHAIN_LINKS, 1.f, inertia, false, false);
+		btQuaternion lying(btVector3(0, 0, 1), -SIMD_HALF_PI);
+		mb->setBasePos(basePos);
+		mb->setWorldToBaseRot(lying);
+		for (int link = 0; link < NUM_CHAIN_LINKS; ++link)
+		{
+			mb->setupRevolute(link, 1.f, inertia, link - 1, btQuaternion::getIdentity(), btVector3(0, 0, 1), btVector3(0, 0.27f, 0), btVector3(0, 0.27f, 0), true);
+		}
+		mb->finalizeMultiDof();
+		m_world->addMultiBody(mb);
+		m_multiBodies.push_back(mb);
+		addColliders(mb, m_linkShape, false);
+	}
+
+	~MultiBodyWorldScene()
+	{
+		for (int i = 0; i < m_constraints.size(); ++i)
+		{
+			m_world->removeMultiBodyConstraint(m_constraints[i]);
+			delete m_constraints[i];
+		}
+		for (int i = 0; i < m_colliders.size(); ++i)
+		{
+			m_world->removeCollisionObject(m_colliders[i]);
+			delete m_colliders[i];
+		}
+		for (int i = 0; i < m_multiBodies.size(); ++i)
+		{
+			m_world->removeMultiBody(m_multiBodies[i]);
+			delete m_multiBodies[i];
+		}
+		for (int i = 0; i < m_rigidBodies.size(); ++i)
+		{
+			m_world->removeRigidBody(m_rigidBodies[i]);
+			delete m_rigidBodies[i];
+		}
+		delete m_world;
+		delete m_solver;
+		delete m_solverPool;
+		delete m_groundShape;
+		delete m_postBaseShape;
+		delete m_linkShape;
+		delete m_broadphase;
+		delete m_dispatcher;
+		delete m_collisionConfiguration;
+	}
+
+	void step(int numSteps)
+	{
+		for (int i = 0; i < numSteps; ++i)
+		{
+			m_world->stepSimulation(btScalar(1.) / btScalar(60.), 0);
+		}
+	}
+
+	// the contacts with a static base collider reach the multibody of the post from the island of the other body
+	int getNumStaticBaseContacts() const
+	{
+		int numContacts = 0;
+		for (int i = 0; i < m_dispatcher->getNumManifolds(); ++i)
+		{
+			const btPersistentManifold* manifold = m_dispatcher->getManifoldByIndexInternal(i);
+			const btCollisionObject* bodies[2] = {manifold->getBody0(), manifold->getBody1()};
+			for (int k = 0; k < 2; ++k)
+			{
+				if (bodies[k]->isStaticObject() && btMultiBodyLinkCollider::upcast(bodies[k]))
+				{
+					numContacts += manifold->getNumContacts();
+				}
+			}
+		}
+		return numContacts;
+	}
+
+	// base position, base rotation and joint positions of every multibody, and the positions of the rigid bodies
+	void getState(btAlignedObjectArray<btScalar>& state) const
+	{
+		state.resize(0);
+		for (int i = 0; i < m_multiBodies.size(); ++i)
+		{
+			const btMultiBody* mb = m_multiBodies[i];
+			for (int k = 0; k < 3; ++k)
+			{
+				state.push_back(mb->getBasePos()[k]);
+			}
+			for (int k = 0; k < 4; ++k)
+			{
+				state.push_back(mb->getWorldToBaseRot()[k]);
+			}
+			for (int link = 0; link < mb->getNumLinks(); ++link)
+			{
+				state.push_back(mb->getJointPos(link));
+			}
+		}
+		for (int i = 0; i < m_rigidBodies.size(); ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				state.push_back(m_rigidBodies[i]->getWorldTransform().getOrigin()[k]);
+			}
+		}
+	}
+};
+
+const int kNumSteps = 30;
+
+// the batches that touch the posts through their static base are solved after the others, which can be another order
+// than in btMultiBodyDynamicsWorld, so the results only have to be close
+const btScalar kTolerance = btScalar(0.01);
+}  // namespace
+
+TEST(MultiBodyDynamicsWorldMtTest, MatchesSerialWorld)
+{
+	btAlignedObjectArray<btScalar> expectedState;
+	{
+		MultiBodyWorldScene scene(false);
+		scene.step(kNumSteps);
+		scene.getState(expectedState);
+	}
+
+	btAlignedObjectArray<btScalar> singleThreadState;
+	for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+	{
+		setNumThreads(numThreads);
+		MultiBodyWorldScene scene(true);
+		scene.step(kNumSteps);
+		// the batches of these contacts are solved after the others
+		EXPECT_GT(scene.getNumStaticBaseContacts(), MultiBodyWorldScene::NUM_POSTS);
+
+		btAlignedObjectArray<btScalar> state;
+		scene.getState(state);
+		ASSERT_EQ(expectedState.size(), state.size());
+		for (int i = 0; i < state.size(); ++i)
+		{
+			EXPECT_NEAR(expectedState[i], state[i], kTolerance) << "state " << i << " threads " << numThreads;
+		}
+		// the batches do not depend on the number of threads
+		if (numThreads == 1)
+		{
+			singleThreadState = state;
+		}
+		for (int i = 0; i < state.size(); ++i)
+		{
+			EXPECT_EQ(singleThreadState[i], state[i]) << "state " << i << " threads " << numThreads;
+		}
+	}
+}
+
+#endif  //BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+	btTestAllocator::install();
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
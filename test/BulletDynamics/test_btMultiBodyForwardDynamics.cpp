@@ -0,0 +1,230 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Featherstone/btMultiBody.h>
+#include <BulletDynamics/Featherstone/btMultiBodyLinkCollider.h>
+#include <gtest/gtest.h>
+#include "btTestAllocator.h"
+
+namespace
+{
+enum ChainJointType
+{
+	CHAIN_REVOLUTE,
+	CHAIN_PRISMATIC,
+	CHAIN_SPHERICAL
+};
+
+const int kNumLinks = 5;
+
+// a chain of links with tilted joint frames, offset pivots and joint axes that change from link to link, with joint
+// positions, velocities and torques, the base velocity and gravity, so every term of the articulated body algorithm
+// contributes
+btMultiBody* createChain(ChainJointType jointType, bool fixedBase)
+{
+	const btVector3 inertia(0.1f, 0.2f, 0.15f);
+	const btVector3 axes[3] = {btVector3(0, 0, 1), btVector3(1, 0, 0), btVector3(0, 1, 0)};
+	btMultiBody* mb = new btMultiBody(kNumLinks, 2.f, btVector3(0.3f, 0.4f, 0.5f), fixedBase, false);
+	mb->setBasePos(btVector3(0.1f, 1.f, -0.2f));
+	mb->setWorldToBaseRot(btQuaternion(btVector3(1, 1, 0).normalized(), 0.3f));
+	for (int i = 0; i < kNumLinks; ++i)
+	{
+		const btScalar mass = 1.f + 0.25f * btScalar(i);
+		const btQuaternion rotParentToThis(btVector3(0, 1, 0), 0.1f * btScalar(i));
+		const btVector3 parentComToPivot(0.05f * btScalar(i), 0.3f, 0.f);
+		const btVector3 pivotToCom(0.f, 0.25f, 0.02f * btScalar(i));
+		if (jointType == CHAIN_REVOLUTE)
+		{
+			mb->setupRevolute(i, mass, inertia * mass, i - 1, rotParentToThis, axes[i % 3], parentComToPivot, pivotToCom, true);
+		}
+		else if (jointType == CHAIN_PRISMATIC)
+		{
+			mb->setupPrismatic(i, mass, inertia * mass, i - 1, rotParentToThis, axes[i % 3], parentComToPivot, pivotToCom, true);
+		}
+		else
+		{
+			mb->setupSpherical(i, mass, inertia * mass, i - 1, rotParentToThis, parentComToPivot, pivotToCom, true);
+		}
+	}
+	mb->finalizeMultiDof();
+
+	if (!fixedBase)
+	{
+		mb->setBaseVel(btVector3(0.2f, -0.1f, 0.3f));
+		mb->setBaseOmega(btVector3(0.1f, 0.4f, -0.2f));
+	}
+	for (int i = 0; i < kNumLinks; ++i)
+	{
+		const btScalar sign = (i % 2) ? -1.f : 1.f;
+		if (jointType == CHAIN_SPHERICAL)
+		{
+			const btQuaternion rotation(axes[(i + 1) % 3], sign * 0.2f * btScalar(i + 1));
+			btScalar pos[4] = {rotation.x(), rotation.y(), rotation.z(), rotation.w()};
+			mb->setJointPosMultiDof(i, pos);
+			btScalar vel[3] = {0.3f * sign, 0.2f, -0.1f * btScalar(i)};
+			mb->setJointVelMultiDof(i, vel);
+			mb->addJointTorqueMultiDof(i, 0, 0.1f);
+			mb->addJointTorqueMultiDof(i, 1, -0.2f * sign);
+			mb->addJointTorqueMultiDof(i, 2, 0.05f);
+		}
+		else
+		{
+			mb->setJointPos(i, sign * 0.15f * btScalar(i + 1));
+			mb->setJointVel(i, 0.4f * sign - 0.1f * btScalar(i));
+			mb->addJointTorque(i, 0.3f * sign);
+		}
+	}
+
+	// gravity, the way btMultiBodyDynamicsWorld applies it
+	const btVector3 gravity(0, -10, 0);
+	mb->addBaseForce(gravity * mb->getBaseMass());
+	for (int i = 0; i < kNumLinks; ++i)
+	{
+		mb->addLinkForce(i, gravity * mb->getLinkMass(i));
+	}
+	btAlignedObjectArray<btQuaternion> scratchWorldToLocal;
+	btAlignedObjectArray<btVector3> scratchLocalOrigin;
+	mb->forwardKinematics(scratchWorldToLocal, scratchLocalOrigin);
+	return mb;
+}
+
+// the base accelerations (angular, then linear, in the world frame) and the joint accelerations
+void computeAccelerations(btMultiBody* mb, btAlignedObjectArray<btScalar>& accelerations)
+{
+	btAlignedObjectArray<btScalar> scratch_r;
+	btAlignedObjectArray<btVector3> scratch_v;
+	btAlignedObjectArray<btMatrix3x3> scratch_m;
+	// sized like btMultiBodyDynamicsWorld does before each call
+	scratch_r.resize(mb->getNumLinks() + 1);
+	scratch_v.resize(mb->getNumLinks() + 1);
+	scratch_m.resize(mb->getNumLinks() + 1);
+	// no time step, so the velocities stay as they are
+	mb->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0.f, scratch_r, scratch_v, scratch_m, false, false, false);
+	accelerations.resize(6 + mb->getNumDofs());
+	for (int i = 0; i < accelerations.size(); ++i)
+	{
+		accelerations[i] = scratch_r[mb->getNumDofs() + i];
+	}
+}
+
+void checkAccelerations(ChainJointType jointType, bool fixedBase, const btScalar* expected, int numExpected)
+{
+	btMultiBody* mb = createChain(jointType, fixedBase);
+	btAlignedObjectArray<btScalar> accelerations;
+	// the second call reuses the workspace of the first
+	for (int call = 0; call < 2; ++call)
+	{
+		computeAccelerations(mb, accelerations);
+		ASSERT_EQ(numExpected, accelerations.size());
+		for (int i = 0; i < numExpected; ++i)
+		{
+			EXPECT_NEAR(expected[i], accelerations[i], btScalar(1e-4) * btMax(btScalar(1), btFabs(expected[i]))) << "acceleration " << i << " call " << call;
+		}
+	}
+	delete mb;
+}
+
+// computed by the articulated body algorithm of Bullet 3.25, before it kept its workspace in btMultiBody and gave the
+// 1-DOF joints their own path
+const btScalar kRevoluteFloating[] = {0.3283645f, -0.4438745f, -0.5457438f, 0.0966275f, -9.672001f, -0.2171728f, 0.8293546f, -0.4028987f, 1.117628f, -0.4280281f, 1.168787f};
+const btScalar kPrismaticFloating[] = {-0.05279767f, -0.2390795f, -0.1017062f, -0.01174883f, -10.10656f, -0.149158f, 0.2721488f, -0.6413308f, 0.1572578f, -0.3666391f, 0.7729025f};
+const btScalar kSphericalFloating[] = {-0.1770382f, 0.4768195f, -0.1105635f, -0.05755528f, -9.7102f, -0.01927432f, 0.6736763f, -2.496467f, 0.3778747f, -0.5404872f, 2.997318f, 0.5236213f, -0.7317956f, -2.107339f, -0.6527601f, 1.877628f, 1.566781f, 0.4700526f, -0.03327414f, -1.534819f, -0.5625085f};
+const btScalar kRevoluteFixed[] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 1.617262f, -3.43503f, 3.002526f, -9.695093f, 15.46869f};
+const btScalar kPrismaticFixed[] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f, -1.957797f, -0.4129167f, -9.73083f, -0.318653f, 0.3121881f};
+const btScalar kSphericalFixed[] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f, -3.40074f, -1.756348f, -1.249756f, 8.333291f, 2.866904f, -9.540751f, 3.088212f, -2.968383f, 23.59376f, -19.13301f, 11.53242f, -3.52381f, 9.562178f, -1.695192f, 4.333229f};
+
+// a pendulum under gravity on a fixed base, and optionally a kinematic link next to it, so both links are children of
+// the base
+btMultiBody* createPendulum(bool withKinematicLink, btAlignedObjectArray<btMultiBodyLinkCollider*>& colliders)
+{
+	const btVector3 inertia(0.1f, 0.2f, 0.15f);
+	btMultiBody* mb = new btMultiBody(withKinematicLink ? 2 : 1, 1.f, inertia, true, false);
+	for (int i = 0; i < mb->getNumLinks(); ++i)
+	{
+		mb->setupRevolute(i, 1.f, inertia, -1, btQuaternion::getIdentity(), btVector3(0, 0, 1), btVector3(0.5f * btScalar(i), 0.f, 0.f), btVector3(0.4f, 0.f, 0.f), true);
+	}
+	mb->finalizeMultiDof();
+	mb->setJointPos(0, 0.3f);
+	mb->setJointVel(0, 0.5f);
+
+	// a link is only kinematic with its collider, and its ancestors have to be kinematic too
+	for (int link = -1; link < mb->getNumLinks(); ++link)
+	{
+		btMultiBodyLinkCollider* collider = new btMultiBodyLinkCollider(mb, link);
+		if (link != 0)
+		{
+			collider->setCollisionFlags(collider->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+		}
+		if (link < 0)
+		{
+			mb->setBaseCollider(collider);
+		}
+		else
+		{
+			mb->getLink(link).m_collider = collider;
+		}
+		colliders.push_back(collider);
+	}
+
+	const btVector3 gravity(0, -10, 0);
+	for (int i = 0; i < mb->getNumLinks(); ++i)
+	{
+		mb->addLinkForce(i, gravity * mb->getLinkMass(i));
+	}
+	btAlignedObjectArray<btQuaternion> scratchWorldToLocal;
+	btAlignedObjectArray<btVector3> scratchLocalOrigin;
+	mb->forwardKinematics(scratchWorldToLocal, scratchLocalOrigin);
+	return mb;
+}
+
+btScalar computePendulumAcceleration(bool withKinematicLink)
+{
+	btAlignedObjectArray<btMultiBodyLinkCollider*> colliders;
+	btMultiBody* mb = createPendulum(withKinematicLink, colliders);
+	EXPECT_FALSE(mb->isLinkAndAllAncestorsKinematic(0));
+	EXPECT_EQ(withKinematicLink, mb->getNumLinks() > 1 && mb->isLinkAndAllAncestorsKinematic(1));
+	btAlignedObjectArray<btScalar> accelerations;
+	computeAccelerations(mb, accelerations);
+	const btScalar qdd = accelerations[6];
+	for (int i = 0; i < colliders.size(); ++i)
+	{
+		delete colliders[i];
+	}
+	delete mb;
+	return qdd;
+}
+
+#define NUM_ELEMENTS(array) int(sizeof(array) / sizeof(array[0]))
+}  // namespace
+
+TEST(MultiBodyForwardDynamicsTest, RevoluteChainMatchesReference)
+{
+	checkAccelerations(CHAIN_REVOLUTE, false, kRevoluteFloating, NUM_ELEMENTS(kRevoluteFloating));
+	checkAccelerations(CHAIN_REVOLUTE, true, kRevoluteFixed, NUM_ELEMENTS(kRevoluteFixed));
+}
+
+TEST(MultiBodyForwardDynamicsTest, PrismaticChainMatchesReference)
+{
+	checkAccelerations(CHAIN_PRISMATIC, false, kPrismaticFloating, NUM_ELEMENTS(kPrismaticFloating));
+	checkAccelerations(CHAIN_PRISMATIC, true, kPrismaticFixed, NUM_ELEMENTS(kPrismaticFixed));
+}
+
+TEST(MultiBodyForwardDynamicsTest, SphericalChainMatchesReference)
+{
+	checkAccelerations(CHAIN_SPHERICAL, false, kSphericalFloating, NUM_ELEMENTS(kSphericalFloating));
+	checkAccelerations(CHAIN_SPHERICAL, true, kSphericalFixed, NUM_ELEMENTS(kSphericalFixed));
+}
+
+TEST(MultiBodyForwardDynamicsTest, KinematicLinkKeepsForceOfOtherLinks)
+{
+	const btScalar expected = computePendulumAcceleration(false);
+	// gravity pulls the pendulum down
+	EXPECT_LT(expected, btScalar(-1));
+	EXPECT_NEAR(expected, computePendulumAcceleration(true), btScalar(1e-5) * btFabs(expected));
+}
+
+int main(int argc, char** argv)
+{
+	btTestAllocator::install();
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
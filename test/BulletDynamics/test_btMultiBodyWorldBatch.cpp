@@ -0,0 +1,372 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Featherstone/btMultiBody.h>
+#include <BulletDynamics/Featherstone/btMultiBodyConstraintSolver.h>
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h>
+#include <BulletDynamics/Featherstone/btMultiBodyLinkCollider.h>
+#include <BulletDynamics/Featherstone/btMultiBodyWorldBatch.h>
+#include <gtest/gtest.h>
+#include "btTestAllocator.h"
+
+#if BT_THREADSAFE
+#include "btTestTaskScheduler.h"
+#endif
+
+namespace
+{
+// the batch runs its loops with btParallelFor, which needs a task scheduler in a multithreaded build
+void setNumThreads(int numThreads)
+{
+#if BT_THREADSAFE
+	btTestTaskScheduler::get()->setNumThreads(numThreads);
+#else
+	(void)numThreads;
+#endif
+}
+
+// a world with a ground box and a floating multibody with a revolute, a spherical and a prismatic link, so the links
+// have 1, 4 and 1 position variables
+struct Environment
+{
+	btDefaultCollisionConfiguration* m_collisionConfiguration;
+	btCollisionDispatcher* m_dispatcher;
+	btDbvtBroadphase* m_broadphase;
+	btMultiBodyConstraintSolver* m_solver;
+	btMultiBodyDynamicsWorld* m_world;
+	btRigidBody* m_ground;
+	btMultiBody* m_multiBody;
+	btAlignedObjectArray<btMultiBodyLinkCollider*> m_colliders;
+
+	Environment(btCollisionShape* linkShape, btCollisionShape* groundShape)
+	{
+		m_collisionConfiguration = new btDefaultCollisionConfiguration();
+		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+		m_broadphase = new btDbvtBroadphase();
+		m_solver = new btMultiBodyConstraintSolver();
+		m_world = new btMultiBodyDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+		m_world->setGravity(btVector3(0, -10, 0));
+
+		btTransform groundTransform;
+		groundTransform.setIdentity();
+		groundTransform.setOrigin(btVector3(0.f, -0.5f, 0.f));
+		m_ground = new btRigidBody(0.f, 0, groundShape, btVector3(0, 0, 0));
+		m_ground->setWorldTransform(groundTransform);
+		m_ground->setInterpolationWorldTransform(groundTransform);
+		m_world->addRigidBody(m_ground);
+
+		btVector3 inertia;
+		linkShape->calculateLocalInertia(1.f, inertia);
+		m_multiBody = new btMultiBody(3, 1.f, inertia, false, false);
+		m_multiBody->setBasePos(btVector3(0.f, 1.f, 0.f));
+		m_multiBody->setupRevolute(0, 1.f, inertia, -1, btQuaternion::getIdentity(), btVector3(0, 0, 1), btVector3(0, 0.27f, 0), btVector3(0, 0.27f, 0), true);
+		m_multiBody->setupSpherical(1, 1.f, inertia, 0, btQuaternion::getIdentity(), btVector3(0, 0.27f, 0), btVector3(0, 0.27f, 0), true);
+		m_multiBody->setupPrismatic(2, 1.f, inertia, 1, btQuaternion::getIdentity(), btVector3(1, 0, 0), btVector3(0, 0.27f, 0), btVector3(0, 0.27f, 0), true);
+		m_multiBody->finalizeMultiDof();
+		m_world->addMultiBody(m_multiBody);
+
+		for (int link = -1; link < m_multiBody->getNumLinks(); ++link)
+		{
+			btMultiBodyLinkCollider* collider = new btMultiBodyLinkCollider(m_multiBody, link);
+			collider->setCollisionShape(linkShape);
+			if (link < 0)
+			{
+				m_multiBody->setBaseCollider(collider);
+			}
+			else
+			{
+				m_multiBody->getLink(link).m_collider = collider;
+			}
+			m_world->addCollisionObject(collider, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter);
+			m_colliders.push_back(collider);
+		}
+	}
+
+	~Environment()
+	{
+		for (int i = 0; i < m_colliders.size(); ++i)
+		{
+			m_world->removeCollisionObject(m_colliders[i]);
+			delete m_colliders[i];
+		}
+		m_world->removeMultiBody(m_multiBody);
+		delete m_multiBody;
+		m_world->removeRigidBody(m_ground);
+		delete m_ground;
+		delete m_world;
+		delete m_solver;
+		delete m_broadphase;
+		delete m_dispatcher;
+		delete m_collisionConfiguration;
+	}
+};
+
+struct MultiBodyWorldBatchTest : public ::testing::Test
+{
+	enum
+	{
+		NUM_ENVIRONMENTS = 7
+	};
+
+	btBoxShape* m_linkShape;
+	btBoxShape* m_groundShape;
+	btAlignedObjectArray<Environment*> m_environments;
+	btMultiBodyWorldBatch m_batch;
+
+	virtual void SetUp()
+	{
+		setNumThreads(1);
+		m_linkShape = new btBoxShape(btVector3(0.1f, 0.25f, 0.1f));
+		m_groundShape = new btBoxShape(btVector3(50.f, 0.5f, 50.f));
+		createEnvironments();
+	}
+
+	virtual void TearDown()
+	{
+		destroyEnvironments();
+		delete m_groundShape;
+		delete m_linkShape;
+	}
+
+	void createEnvironments()
+	{
+		for (int env = 0; env < NUM_ENVIRONMENTS; ++env)
+		{
+			Environment* environment = new Environment(m_linkShape, m_groundShape);
+			m_environments.push_back(environment);
+			EXPECT_EQ(env, m_batch.addEnvironment(environment->m_world, environment->m_multiBody));
+		}
+	}
+
+	void destroyEnvironments()
+	{
+		m_batch.removeAllEnvironments();
+		for (int i = 0; i < m_environments.size(); ++i)
+		{
+			delete m_environments[i];
+		}
+		m_environments.resize(0);
+	}
+
+	// a different pose and velocity for every environment, with normalized rotations
+	void getInitialState(btAlignedObjectArray<btScalar>& positions, btAlignedObjectArray<btScalar>& velocities)
+	{
+		const int n = NUM_ENVIRONMENTS;
+		positions.resize(m_batch.getNumPositions() * n);
+		velocities.resize(m_batch.getNumVelocities() * n);
+		for (int env = 0; env < n; ++env)
+		{
+			const btScalar s = btScalar(env);
+			const btVector3 basePos(0.3f * s, 1.f + 0.1f * s, -0.2f * s);
+			const btQuaternion baseRot(btVector3(1, 0, 1).normalized(), 0.1f * s);
+			const btQuaternion sphericalRot(btVector3(0, 1, 1).normalized(), 0.2f + 0.05f * s);
+			const btScalar q[7] = {basePos[0], basePos[1], basePos[2], baseRot[0], baseRot[1], baseRot[2], baseRot[3]};
+			for (int k = 0; k < 7; ++k)
+			{
+				positions[k * n + env] = q[k];
+			}
+			positions[7 * n + env] = 0.3f - 0.1f * s;
+			for (int k = 0; k < 4; ++k)
+			{
+				positions[(8 + k) * n + env] = sphericalRot[k];
+			}
+			positions[12 * n + env] = 0.05f * s;
+			for (int k = 0; k < m_batch.getNumVelocities(); ++k)
+			{
+				velocities[k * n + env] = 0.1f * btScalar(k % 5) - 0.05f * s;
+			}
+		}
+	}
+
+	void getTorques(int step, btAlignedObjectArray<btScalar>& torques)
+	{
+		const int n = NUM_ENVIRONMENTS;
+		torques.resize(m_batch.getNumDofs() * n);
+		for (int k = 0; k < m_batch.getNumDofs(); ++k)
+		{
+			for (int env = 0; env < n; ++env)
+			{
+				torques[k * n + env] = 0.5f * btScalar((k + env + step) % 3) - 0.5f;
+			}
+		}
+	}
+};
+
+const int kNumSteps = 40;
+const btScalar kTimeStep = btScalar(1.) / btScalar(60.);
+}  // namespace
+
+TEST_F(MultiBodyWorldBatchTest, StateRoundTrip)
+{
+	const int n = NUM_ENVIRONMENTS;
+	ASSERT_EQ(13, m_batch.getNumPositions());
+	ASSERT_EQ(6 + 5, m_batch.getNumVelocities());
+	ASSERT_EQ(5, m_batch.getNumDofs());
+
+	btAlignedObjectArray<btScalar> positions;
+	btAlignedObjectArray<btScalar> velocities;
+	getInitialState(positions, velocities);
+	m_batch.setPositions(&positions[0]);
+	m_batch.setVelocities(&velocities[0]);
+
+	// element k of environment i is at [k * n + i]
+	for (int env = 0; env < n; ++env)
+	{
+		const btMultiBody* mb = m_batch.getMultiBody(env);
+		for (int k = 0; k < 3; ++k)
+		{
+			EXPECT_EQ(positions[k * n + env], mb->getBasePos()[k]) << "environment " << env;
+		}
+		for (int k = 0; k < 4; ++k)
+		{
+			EXPECT_EQ(positions[(3 + k) * n + env], mb->getWorldToBaseRot()[k]) << "environment " << env;
+			EXPECT_EQ(positions[(8 + k) * n + env], mb->getJointPosMultiDof(1)[k]) << "environment " << env;
+		}
+		EXPECT_EQ(positions[7 * n + env], mb->getJointPos(0)) << "environment " << env;
+		EXPECT_EQ(positions[12 * n + env], mb->getJointPos(2)) << "environment " << env;
+		for (int k = 0; k < m_batch.getNumVelocities(); ++k)
+		{
+			EXPECT_EQ(velocities[k * n + env], mb->getVelocityVector()[k]) << "environment " << env;
+		}
+		// the colliders follow the new pose
+		EXPECT_EQ(mb->getBasePos(), mb->getBaseCollider()->getWorldTransform().getOrigin()) << "environment " << env;
+	}
+
+	btAlignedObjectArray<btScalar> readPositions;
+	btAlignedObjectArray<btScalar> readVelocities;
+	readPositions.resize(positions.size());
+	readVelocities.resize(velocities.size());
+	m_batch.getPositions(&readPositions[0]);
+	m_batch.getVelocities(&readVelocities[0]);
+	for (int i = 0; i < positions.size(); ++i)
+	{
+		EXPECT_EQ(positions[i], readPositions[i]) << "position " << i;
+	}
+	for (int i = 0; i < velocities.size(); ++i)
+	{
+		EXPECT_EQ(velocities[i], readVelocities[i]) << "velocity " << i;
+	}
+}
+
+TEST_F(MultiBodyWorldBatchTest, StepMatchesSeparateWorlds)
+{
+	const int n = NUM_ENVIRONMENTS;
+	btAlignedObjectArray<btScalar> initialPositions;
+	btAlignedObjectArray<btScalar> initialVelocities;
+	getInitialState(initialPositions, initialVelocities);
+
+	// each world stepped alone, with the state and torques set through the multibody
+	btAlignedObjectArray<btScalar> expectedPositions;
+	btAlignedObjectArray<btScalar> expectedVelocities;
+	{
+		btAlignedObjectArray<Environment*> environments;
+		btMultiBodyWorldBatch reader;
+		for (int env = 0; env < n; ++env)
+		{
+			environments.push_back(new Environment(m_linkShape, m_groundShape));
+			reader.addEnvironment(environments[env]->m_world, environments[env]->m_multiBody);
+		}
+		btAlignedObjectArray<btQuaternion> scratchWorldToLocal;
+		btAlignedObjectArray<btVector3> scratchLocalOrigin;
+		for (int env = 0; env < n; ++env)
+		{
+			btMultiBody* mb = environments[env]->m_multiBody;
+			const btScalar* q = &initialPositions[env];
+			mb->setBasePos(btVector3(q[0], q[n], q[2 * n]));
+			mb->setWorldToBaseRot(btQuaternion(q[3 * n], q[4 * n], q[5 * n], q[6 * n]));
+			mb->setJointPos(0, q[7 * n]);
+			btScalar spherical[4] = {q[8 * n], q[9 * n], q[10 * n], q[11 * n]};
+			mb->setJointPosMultiDof(1, spherical);
+			mb->setJointPos(2, q[12 * n]);
+			const btScalar* v = &initialVelocities[env];
+			mb->setBaseOmega(btVector3(v[0], v[n], v[2 * n]));
+			mb->setBaseVel(btVector3(v[3 * n], v[4 * n], v[5 * n]));
+			mb->setJointVel(0, v[6 * n]);
+			btScalar sphericalVel[3] = {v[7 * n], v[8 * n], v[9 * n]};
+			mb->setJointVelMultiDof(1, sphericalVel);
+			mb->setJointVel(2, v[10 * n]);
+			mb->forwardKinematics(scratchWorldToLocal, scratchLocalOrigin);
+			mb->updateCollisionObjectWorldTransforms(scratchWorldToLocal, scratchLocalOrigin);
+		}
+		btAlignedObjectArray<btScalar> torques;
+		for (int step = 0; step < kNumSteps; ++step)
+		{
+			getTorques(step, torques);
+			for (int env = 0; env < n; ++env)
+			{
+				btMultiBody* mb = environments[env]->m_multiBody;
+				int dof = 0;
+				for (int link = 0; link < mb->getNumLinks(); ++link)
+				{
+					for (int k = 0; k < mb->getLink(link).m_dofCount; ++k, ++dof)
+					{
+						mb->addJointTorqueMultiDof(link, k, torques[dof * n + env]);
+					}
+				}
+				environments[env]->m_world->stepSimulation(kTimeStep);
+			}
+		}
+		expectedPositions.resize(initialPositions.size());
+		expectedVelocities.resize(initialVelocities.size());
+		reader.getPositions(&expectedPositions[0]);
+		reader.getVelocities(&expectedVelocities[0]);
+		for (int env = 0; env < n; ++env)
+		{
+			delete environments[env];
+		}
+	}
+	// the multibodies fell on the ground and moved
+	for (int env = 0; env < n; ++env)
+	{
+		EXPECT_NE(initialPositions[env], expectedPositions[env]) << "environment " << env;
+		EXPECT_LT(expectedPositions[n + env], initialPositions[n + env]) << "environment " << env;
+	}
+
+	int maxNumThreads = 1;
+#if BT_THREADSAFE
+	maxNumThreads = 4;
+#endif
+	for (int numThreads = 1; numThreads <= maxNumThreads; numThreads *= 2)
+	{
+		setNumThreads(numThreads);
+		m_batch.setPositions(&initialPositions[0]);
+		m_batch.setVelocities(&initialVelocities[0]);
+		btAlignedObjectArray<btScalar> torques;
+		for (int step = 0; step < kNumSteps; ++step)
+		{
+			getTorques(step, torques);
+			m_batch.addJointTorques(&torques[0]);
+			m_batch.stepSimulation(kTimeStep);
+		}
+		btAlignedObjectArray<btScalar> positions;
+		btAlignedObjectArray<btScalar> velocities;
+		positions.resize(initialPositions.size());
+		velocities.resize(initialVelocities.size());
+		m_batch.getPositions(&positions[0]);
+		m_batch.getVelocities(&velocities[0]);
+		// the multibodies lie on the ground
+		for (int env = 0; env < n; ++env)
+		{
+			EXPECT_GT(m_environments[env]->m_dispatcher->getNumManifolds(), 0) << "environment " << env;
+		}
+		// the worlds do the same work in the same order, only on other threads
+		for (int i = 0; i < positions.size(); ++i)
+		{
+			EXPECT_EQ(expectedPositions[i], positions[i]) << "position " << i << " threads " << numThreads;
+		}
+		for (int i = 0; i < velocities.size(); ++i)
+		{
+			EXPECT_EQ(expectedVelocities[i], velocities[i]) << "velocity " << i << " threads " << numThreads;
+		}
+
+		// the next round starts from fresh worlds, without the contacts of this one
+		destroyEnvironments();
+		createEnvironments();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	btTestAllocator::install();
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,284 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionDispatch/btUnionFind.h>
+#include <BulletDynamics/Dynamics/btSimulationIslandManagerMt.h>
+#include <gtest/gtest.h>
+#include "btTestAllocator.h"
+
+#if BT_THREADSAFE
+
+#include "btTestTaskScheduler.h"
+
+namespace
+{
+void setNumThreads(int numThreads)
+{
+	btTestTaskScheduler::get()->setNumThreads(numThreads);
+}
+
+unsigned int gRandomSeed = 1;
+
+int randomInt(int range)
+{
+	gRandomSeed = gRandomSeed * 1664525u + 1013904223u;
+	return int((gRandomSeed >> 8) % unsigned(range));
+}
+
+struct UniteConcurrentLoop : public btIParallelForBody
+{
+	btUnionFind* m_unionFind;
+	const btAlignedObjectArray<int>* m_pairs;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_unionFind->uniteConcurrent((*m_pairs)[2 * i], (*m_pairs)[2 * i + 1]);
+		}
+	}
+};
+
+// the serial union find picks other roots, so its sets are compared through their smallest element
+void smallestElements(btUnionFind& unionFind, btAlignedObjectArray<int>& smallest)
+{
+	const int numElements = unionFind.getNumElements();
+	btAlignedObjectArray<int> rootSmallest;
+	rootSmallest.resize(numElements, numElements);
+	for (int i = 0; i < numElements; ++i)
+	{
+		int root = unionFind.find(i);
+		rootSmallest[root] = btMin(rootSmallest[root], i);
+	}
+	smallest.resize(numElements);
+	for (int i = 0; i < numElements; ++i)
+	{
+		smallest[i] = rootSmallest[unionFind.find(i)];
+	}
+}
+
+// the islands handed to the solver, recorded instead of solved
+struct RecordedIsland
+{
+	int m_id;
+	btAlignedObjectArray<const btCollisionObject*> m_bodies;
+	int m_numManifolds;
+};
+
+btAlignedObjectArray<RecordedIsland> gRecordedIslands;
+
+void recordIslands(btAlignedObjectArray<btSimulationIslandManagerMt::Island*>* islandsPtr, const btSimulationIslandManagerMt::SolverParams& /*solverParams*/)
+{
+	gRecordedIslands.resize(islandsPtr->size());
+	for (int i = 0; i < islandsPtr->size(); ++i)
+	{
+		const btSimulationIslandManagerMt::Island* island = (*islandsPtr)[i];
+		RecordedIsland& recorded = gRecordedIslands[i];
+		recorded.m_id = island->id;
+		recorded.m_bodies.resize(0);
+		for (int j = 0; j < island->bodyArray.size(); ++j)
+		{
+			recorded.m_bodies.push_back(island->bodyArray[j]);
+		}
+		recorded.m_numManifolds = island->manifoldArray.size();
+	}
+}
+
+// boxes dropped at random in a small volume, so they form clusters of overlapping boxes, on a static ground
+struct IslandWorldTest : public ::testing::Test
+{
+	enum
+	{
+		NUM_BOXES = 1500
+	};
+
+	btDefaultCollisionConfiguration* m_collisionConfiguration;
+	btCollisionDispatcher* m_dispatcher;
+	btDbvtBroadphase* m_broadphase;
+	btCollisionWorld* m_world;
+	btBoxShape* m_boxShape;
+	btBoxShape* m_groundShape;
+	btAlignedObjectArray<btRigidBody*> m_bodies;
+
+	virtual void SetUp()
+	{
+		m_collisionConfiguration = new btDefaultCollisionConfiguration();
+		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+		m_broadphase = new btDbvtBroadphase();
+		m_world = new btCollisionWorld(m_dispatcher, m_broadphase, m_collisionConfiguration);
+		m_boxShape = new btBoxShape(btVector3(0.5f, 0.5f, 0.5f));
+		m_groundShape = new btBoxShape(btVector3(50.f, 0.5f, 50.f));
+
+		btTransform transform;
+		transform.setIdentity();
+		gRandomSeed = 1;
+		for (int i = 0; i < NUM_BOXES; ++i)
+		{
+			// the ground goes in the middle of the collision object array
+			if (i == NUM_BOXES / 2)
+			{
+				transform.setOrigin(btVector3(0.f, -0.5f, 0.f));
+				addBody(0.f, m_groundShape, transform);
+			}
+			transform.setOrigin(btVector3(btScalar(randomInt(8000)) * 0.01f - 40.f, btScalar(randomInt(200)) * 0.01f, btScalar(randomInt(8000)) * 0.01f - 40.f));
+			addBody(1.f, m_boxShape, transform);
+		}
+		m_world->performDiscreteCollisionDetection();
+	}
+
+	void addBody(btScalar mass, btCollisionShape* shape, const btTransform& transform)
+	{
+		btRigidBody* body = new btRigidBody(mass, 0, shape);
+		body->setWorldTransform(transform);
+		// the AABB of a rigid body is swept from its interpolation transform
+		body->setInterpolationWorldTransform(transform);
+		m_world->addCollisionObject(body);
+		m_bodies.push_back(body);
+	}
+
+	virtual void TearDown()
+	{
+		for (int i = 0; i < m_bodies.size(); ++i)
+		{
+			m_world->removeCollisionObject(m_bodies[i]);
+			delete m_bodies[i];
+		}
+		m_bodies.resize(0);
+		delete m_world;
+		delete m_groundShape;
+		delete m_boxShape;
+		delete m_broadphase;
+		delete m_dispatcher;
+		delete m_collisionConfiguration;
+	}
+
+	void buildIslands(bool parallelIslandBuilding, btAlignedObjectArray<int>& islandTags)
+	{
+		btSimulationIslandManagerMt islandManager;
+		islandManager.setParallelIslandBuilding(parallelIslandBuilding);
+		islandManager.setIslandDispatchFunction(recordIslands);
+		// no batch islands, so the recorded islands are the islands of the union find
+		islandManager.setMinimumSolverBatchSize(1);
+		islandManager.updateActivationState(m_world, m_dispatcher);
+		islandManager.storeIslandActivationState(m_world);
+		islandTags.resize(m_bodies.size());
+		for (int i = 0; i < m_bodies.size(); ++i)
+		{
+			islandTags[i] = m_world->getCollisionObjectArray()[i]->getIslandTag();
+		}
+		btAlignedObjectArray<btTypedConstraint*> constraints;
+		btSimulationIslandManagerMt::SolverParams solverParams;
+		solverParams.m_solverPool = 0;
+		solverParams.m_solverMt = 0;
+		solverParams.m_solverInfo = 0;
+		solverParams.m_debugDrawer = 0;
+		solverParams.m_dispatcher = m_dispatcher;
+		islandManager.buildAndProcessIslands(m_dispatcher, m_world, constraints, solverParams);
+	}
+};
+}  // namespace
+
+TEST(UnionFindTest, UniteConcurrentMatchesUnite)
+{
+	const int numElements = 5000;
+	const int numPairs = 4000;
+	btAlignedObjectArray<int> pairs;
+	gRandomSeed = 7;
+	for (int i = 0; i < 2 * numPairs; ++i)
+	{
+		pairs.push_back(randomInt(numElements));
+	}
+
+	btUnionFind serial;
+	serial.reset(numElements);
+	for (int i = 0; i < numPairs; ++i)
+	{
+		serial.unite(pairs[2 * i], pairs[2 * i + 1]);
+	}
+	btAlignedObjectArray<int> expected;
+	smallestElements(serial, expected);
+
+	for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+	{
+		setNumThreads(numThreads);
+		btUnionFind concurrent;
+		concurrent.reset(numElements);
+		UniteConcurrentLoop loop;
+		loop.m_unionFind = &concurrent;
+		loop.m_pairs = &pairs;
+		btParallelFor(0, numPairs, 100, loop);
+
+		// the root of each set is its smallest element, whatever the order of the unions
+		for (int i = 0; i < numElements; ++i)
+		{
+			ASSERT_EQ(expected[i], concurrent.findConcurrent(i)) << "element " << i << " threads " << numThreads;
+		}
+	}
+}
+
+TEST_F(IslandWorldTest, ParallelIslandsMatchSerialIslands)
+{
+	btAlignedObjectArray<int> serialTags;
+	buildIslands(false, serialTags);
+	int numSerialIslands = gRecordedIslands.size();
+	int numMergedIslands = 0;
+	for (int i = 0; i < numSerialIslands; ++i)
+	{
+		numMergedIslands += (gRecordedIslands[i].m_bodies.size() > 1) ? 1 : 0;
+	}
+	ASSERT_GT(numMergedIslands, 10);
+
+	setNumThreads(1);
+	btAlignedObjectArray<int> parallelTags;
+	buildIslands(true, parallelTags);
+	ASSERT_EQ(numSerialIslands, gRecordedIslands.size());
+
+	// the same bodies share an island, the ids can differ
+	for (int i = 0; i < m_bodies.size(); ++i)
+	{
+		for (int j = i + 1; j < m_bodies.size(); j += 7)
+		{
+			ASSERT_EQ(serialTags[i] == serialTags[j], parallelTags[i] == parallelTags[j]) << "bodies " << i << " " << j;
+		}
+	}
+}
+
+TEST_F(IslandWorldTest, ParallelIslandsDoNotDependOnThreads)
+{
+	setNumThreads(1);
+	btAlignedObjectArray<int> expectedTags;
+	buildIslands(true, expectedTags);
+	btAlignedObjectArray<RecordedIsland> expectedIslands = gRecordedIslands;
+
+	for (int numThreads = 2; numThreads <= 4; numThreads *= 2)
+	{
+		setNumThreads(numThreads);
+		btAlignedObjectArray<int> islandTags;
+		buildIslands(true, islandTags);
+		for (int i = 0; i < m_bodies.size(); ++i)
+		{
+			ASSERT_EQ(expectedTags[i], islandTags[i]) << "body " << i << " threads " << numThreads;
+		}
+		ASSERT_EQ(expectedIslands.size(), gRecordedIslands.size());
+		for (int i = 0; i < expectedIslands.size(); ++i)
+		{
+			const RecordedIsland& expected = expectedIslands[i];
+			const RecordedIsland& island = gRecordedIslands[i];
+			ASSERT_EQ(expected.m_id, island.m_id);
+			ASSERT_EQ(expected.m_numManifolds, island.m_numManifolds);
+			ASSERT_EQ(expected.m_bodies.size(), island.m_bodies.size());
+			for (int j = 0; j < expected.m_bodies.size(); ++j)
+			{
+				EXPECT_EQ(expected.m_bodies[j], island.m_bodies[j]) << "island " << expected.m_id << " threads " << numThreads;
+			}
+		}
+	}
+}
+
+#endif  //BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+	btTestAllocator::install();
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}